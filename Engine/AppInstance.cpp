@@ -63,9 +63,11 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/Plugin.h"
 #include "Engine/Project.h"
 #include "Engine/ProcessHandler.h"
+#include "Engine/RenderBenchmark.h"
 #include "Engine/ReadNode.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/Settings.h"
+#include "Engine/Timer.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/WriteNode.h"
 
@@ -165,6 +167,9 @@ public:
 
     ProjectBeingLoadedInfo projectBeingLoaded;
 
+    // Only set while runRenderBenchmark() renders, read by the render threads
+    boost::scoped_ptr<RenderBenchmark> benchmark;
+
     AppInstancePrivate(int appID,
                        AppInstance* app)
 
@@ -183,6 +188,7 @@ public:
         , invalidExprKnobsMutex()
         , invalidExprKnobs()
         , projectBeingLoaded()
+        , benchmark()
     {
     }
 
@@ -651,7 +657,11 @@ AppInstance::loadInternal(const CLArgs& cl,
         }
 
         ///launch renders
-        if ( !writersWork.empty() ) {
+        if ( !cl.getBenchmarkReportFilePath().isEmpty() ) {
+            runRenderBenchmark(cl, writersWork);
+        } else if (cl.getRenderProcessesCount() > 1) {
+            runRenderProcesses(cl, writersWork);
+        } else if ( !writersWork.empty() ) {
             startWritersRendering(false, writersWork);
         } else {
             std::list<std::string> writers;
@@ -1645,7 +1655,8 @@ AppInstance::startWritersRendering(bool doBlockingRender,
     }
 
 
-    bool renderInSeparateProcess = appPTR->getCurrentSettings()->isRenderInSeparatedProcessEnabled();
+    // Frames rendered by another process could not be benchmarked
+    bool renderInSeparateProcess = !_imp->benchmark && appPTR->getCurrentSettings()->isRenderInSeparatedProcessEnabled();
     QString savePath;
     if (renderInSeparateProcess) {
         getProject()->saveProject_imp(QString(), QString::fromUtf8("RENDER_SAVE.ntp"), true, false, &savePath);
@@ -1710,6 +1721,105 @@ AppInstance::startWritersRendering(bool doBlockingRender,
     }
 } // AppInstance::startWritersRendering
 
+void
+AppInstance::runRenderBenchmark(const CLArgs& cl,
+                                const std::list<RenderWork>& writers)
+{
+    // Node stats are needed for the time spent in each node
+    std::list<RenderWork> work = writers;
+    for (std::list<RenderWork>::iterator it = work.begin(); it != work.end(); ++it) {
+        it->useRenderStats = true;
+    }
+
+    _imp->benchmark.reset( new RenderBenchmark() );
+    for (int i = 0; i < cl.getBenchmarkRuns(); ++i) {
+        bool isCacheCold = (i == 0);
+        if (isCacheCold) {
+            appPTR->clearNodeCache();
+            clearOpenFXPluginsCaches();
+        }
+        _imp->benchmark->startRun( isCacheCold, appPTR->getNodeCacheAccessStats() );
+        if ( !work.empty() ) {
+            startWritersRendering(true, work);
+        } else {
+            startWritersRenderingFromNames( true, true, std::list<std::string>(), cl.getFrameRanges() );
+        }
+        _imp->benchmark->endRun( appPTR->getNodeCacheAccessStats() );
+
+        std::cout << tr("Benchmark render %1/%2 (%3 cache): %4")
+            .arg(i + 1)
+            .arg( cl.getBenchmarkRuns() )
+            .arg( isCacheCold ? tr("cold") : tr("warm") )
+            .arg( Timer::printAsTime(_imp->benchmark->getRunWallTime(i), false) ).toStdString() << std::endl;
+    }
+
+    bool ok = _imp->benchmark->writeReport( cl.getBenchmarkReportFilePath().toStdString(), cl.getScriptFilename().toStdString() );
+    _imp->benchmark.reset();
+    if (!ok) {
+        throw std::runtime_error( tr("Could not write the benchmark report to %1").arg( cl.getBenchmarkReportFilePath() ).toStdString() );
+    }
+    std::cout << tr("Benchmark report written to %1").arg( cl.getBenchmarkReportFilePath() ).toStdString() << std::endl;
+} // AppInstance::runRenderBenchmark
+
+RenderBenchmark*
+AppInstance::getRenderBenchmark() const
+{
+    return _imp->benchmark.get();
+}
+
+void
+AppInstance::runRenderProcesses(const CLArgs& cl,
+                                const std::list<RenderWork>& writers)
+{
+    std::list<RenderWork> work = writers;
+
+    if ( work.empty() ) {
+        //render all writers found in the project
+        std::list<OutputEffectInstancePtr> projectWriters;
+        getProject()->getWriters(&projectWriters);
+
+        const std::list<std::pair<int, std::pair<int, int> > >& frameRanges = cl.getFrameRanges();
+        for (std::list<OutputEffectInstancePtr>::const_iterator it = projectWriters.begin(); it != projectWriters.end(); ++it) {
+            for (std::list<std::pair<int, std::pair<int, int> > >::const_iterator it2 = frameRanges.begin(); it2 != frameRanges.end(); ++it2) {
+                work.push_back( RenderWork( *it, it2->second.first, it2->second.second, it2->first, cl.areRenderStatsEnabled() ) );
+            }
+            if ( frameRanges.empty() ) {
+                work.push_back( RenderWork( *it, INT_MIN, INT_MAX, INT_MIN, cl.areRenderStatsEnabled() ) );
+            }
+        }
+    }
+    if ( work.empty() ) {
+        throw std::invalid_argument("Project file is missing a writer node. This project cannot render anything.");
+    }
+
+    // The processes load the project as modified by the command-line options
+    QString savePath;
+    getProject()->saveProject_imp(QString(), QString::fromUtf8("RENDER_SAVE.ntp"), true, false, &savePath);
+    if ( savePath.isEmpty() ) {
+        throw std::runtime_error( tr("Could not save the project to render it in several processes.").toStdString() );
+    }
+
+    for (std::list<RenderWork>::const_iterator it = work.begin(); it != work.end(); ++it) {
+        int firstFrame, lastFrame, frameStep;
+        if ( !_imp->validateRenderOptions(*it, &firstFrame, &lastFrame, &frameStep) ) {
+            continue;
+        }
+
+        RenderProcessGroup group(savePath, it->writer, firstFrame, lastFrame, frameStep, cl.getRenderProcessesCount(), it->useRenderStats, cl);
+        std::cout << tr("Rendering %1 from frame %2 to %3 in %4 processes")
+            .arg( QString::fromUtf8( it->writer->getScriptName_mt_safe().c_str() ) )
+            .arg(firstFrame)
+            .arg(lastFrame)
+            .arg( group.getProcessesCount() ).toStdString() << std::endl;
+
+        int returnCode = group.exec();
+        if (returnCode != 0) {
+            QString writerName = QString::fromUtf8( it->writer->getScriptName_mt_safe().c_str() );
+            throw std::runtime_error( ( returnCode == 2 ? tr("%1: A render process crashed.") : tr("%1: A render process failed.") ).arg(writerName).toStdString() );
+        }
+    }
+} // AppInstance::runRenderProcesses
+
 void
 AppInstancePrivate::getSequenceNameFromWriter(const OutputEffectInstancePtr& writer,
                                               QString* sequenceName)
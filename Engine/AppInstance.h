@@ -299,6 +299,23 @@ public:
                                         const std::list<std::pair<int, std::pair<int, int> > >& frameRanges);
     void startWritersRendering(bool doBlockingRender, const std::list<RenderWork>& writers);
 
+    /**
+     * @brief Renders the writers cl.getBenchmarkRuns() times, the first time with empty caches, and writes the
+     * timings of each render to cl.getBenchmarkReportFilePath(). If writers is empty, all Writers in the project
+     * are rendered using the frame ranges of cl.
+     **/
+    void runRenderBenchmark(const CLArgs& cl, const std::list<RenderWork>& writers);
+
+    // Returns the benchmark recording the frames rendered, or NULL if runRenderBenchmark() is not running
+    RenderBenchmark* getRenderBenchmark() const;
+
+    /**
+     * @brief Renders the writers one after another, splitting the frame range of each writer across
+     * cl.getRenderProcessesCount() background processes. If writers is empty, all Writers in the project
+     * are rendered using the frame ranges of cl. Throws if a process failed.
+     **/
+    void runRenderProcesses(const CLArgs& cl, const std::list<RenderWork>& writers);
+
 public:
 
     void addInvalidExpressionKnob(const KnobIPtr& knob);
@@ -77,6 +77,7 @@
 
 #include "Engine/AppInstance.h"
 #include "Engine/Backdrop.h"
+#include "Engine/BufferPool.h"
 #include "Engine/CLArgs.h"
 #include "Engine/DiskCacheNode.h"
 #include "Engine/Dot.h"
@@ -98,11 +99,13 @@
 #include "Engine/Project.h"
 #include "Engine/PrecompNode.h"
 #include "Engine/ReadNode.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoShapeRenderNode.h"
 #include "Engine/RotoShapeRenderCairo.h"
 #include "Engine/StandardPaths.h"
 #include "Engine/TrackerNode.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/ThreadPool.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerInstance.h" // RenderStatsMap
@@ -310,6 +313,7 @@ AppManager::load(int &argc,
     }
 
     _imp->idealThreadCount = QThread::idealThreadCount();
+    _imp->taskScheduler.reset( new TaskScheduler(_imp->idealThreadCount) );
 
 
     QThreadPool::globalInstance()->setExpiryTimeout(-1); //< make threads never exit on their own
@@ -368,13 +372,23 @@ AppManager::~AppManager()
     _imp->_backgroundIPC.reset();
 
     try {
-        _imp->saveCaches();
+        _imp->closeCaches();
     } catch (std::runtime_error) {
         // ignore errors
     }
 
     ///Caches may have launched some threads to delete images, wait for them to be done
     QThreadPool::globalInstance()->waitForDone();
+    _imp->taskScheduler.reset();
+
+    if ( !_imp->traceFilePath.isEmpty() ) {
+        RenderTrace::stop();
+        if ( RenderTrace::writeChromeTrace( _imp->traceFilePath.toStdString() ) ) {
+            std::cout << tr("Render trace written to %1").arg(_imp->traceFilePath).toStdString() << std::endl;
+        } else {
+            std::cerr << tr("Could not write the render trace to %1").arg(_imp->traceFilePath).toStdString() << std::endl;
+        }
+    }
 
     ///Kill caches now because decreaseNCacheFilesOpened can be called
     _imp->_nodeCache->waitForDeleterThread();
@@ -576,6 +590,12 @@ AppManager::loadInternal(const CLArgs& cl)
     std::setlocale(LC_NUMERIC, "C"); // set the locale for LC_NUMERIC only
     QLocale::setDefault( QLocale(QLocale::English, QLocale::UnitedStates) );
     Log::instance(); //< enable logging
+
+    // Start tracing as early as possible, so that the trace also covers the project loading
+    _imp->traceFilePath = cl.getTraceFilePath();
+    if ( !_imp->traceFilePath.isEmpty() ) {
+        RenderTrace::start();
+    }
     bool mustSetSignalsHandlers = true;
 #ifdef NATRON_USE_BREAKPAD
     //Enabled breakpad only if the process was spawned from the crash reporter
@@ -813,10 +833,14 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         size_t maxCacheRAM = _imp->_settings->getRamMaximumPercent() * getSystemTotalRAM();
         U64 viewerCacheSize = _imp->_settings->getMaximumViewerDiskCacheSize();
         U64 maxDiskCacheNode = _imp->_settings->getMaximumDiskCacheNodeSize();
-
-        _imp->_nodeCache.reset( new ImageCache("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1.) );
-        _imp->_diskCache.reset( new ImageCache("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0.) );
-        _imp->_viewerCache.reset( new FrameEntryCache("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0.) );
+        int nCacheShards = _imp->_settings->getCacheShardsCount();
+
+        _imp->_nodeCache.reset( new ImageCache("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1., nCacheShards) );
+        _imp->_nodeCache->setMaximumCompressedPercentage( _imp->_settings->getCompressedCachePercent() );
+        _imp->_nodeCache->setEvictionPolicy( _imp->_settings->getCacheEvictionPolicy() );
+        BufferPool::setMaximumRetainedSize( (std::size_t)(maxCacheRAM * NATRON_BUFFER_POOL_RETAINED_CACHE_FRACTION) );
+        _imp->_diskCache.reset( new ImageCache("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0., nCacheShards) );
+        _imp->_viewerCache.reset( new FrameEntryCache("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0., nCacheShards) );
         _imp->setViewerCacheTileSize();
     } catch (std::logic_error) {
         // ignore
@@ -834,6 +858,9 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
 
     setLoadingStatus( tr("Restoring the image cache...") );
 
+    // In background mode the caches are not persistent unless the disk cache should be reused
+    _imp->_diskCacheShared = isBackground() && cl.isDiskCacheReuseEnabled();
+
     if (oldCacheVersion != NATRON_CACHE_VERSION) {
         wipeAndCreateDiskCacheStructure();
     } else {
@@ -1126,6 +1153,7 @@ AppManager::clearNodeCache()
         (*it)->clearAllLastRenderedImages();
     }
     _imp->_nodeCache->clear();
+    BufferPool::trim();
 }
 
 void
@@ -1174,9 +1202,13 @@ AppManager::wipeAndCreateDiskCacheStructure()
     clearAllCaches();
 
     assert(_imp->_diskCache);
+    _imp->_diskCache->closeJournal();
     _imp->cleanUpCacheDiskStructure( _imp->_diskCache->getCachePath(), false );
     assert(_imp->_viewerCache);
+    _imp->_viewerCache->closeJournal();
     _imp->cleanUpCacheDiskStructure( _imp->_viewerCache->getCachePath() , true);
+
+    _imp->openCachesJournal();
 }
 
 AppInstancePtr
@@ -1239,6 +1271,19 @@ AppManager::setApplicationsCachesMaximumMemoryPercent(double p)
 
     _imp->_nodeCache->setMaximumCacheSize(maxCacheRAM);
     _imp->_nodeCache->setMaximumInMemorySize(1);
+    BufferPool::setMaximumRetainedSize( (std::size_t)(maxCacheRAM * NATRON_BUFFER_POOL_RETAINED_CACHE_FRACTION) );
+}
+
+void
+AppManager::setApplicationsCachesMaximumCompressedPercent(int p)
+{
+    _imp->_nodeCache->setMaximumCompressedPercentage(p);
+}
+
+void
+AppManager::setApplicationsCachesEvictionPolicy(CacheEvictionPolicyEnum policy)
+{
+    _imp->_nodeCache->setEvictionPolicy(policy);
 }
 
 void
@@ -2223,6 +2268,18 @@ AppManager::getCachesTotalMemorySize() const
     return  _imp->_nodeCache->getMemoryCacheSize();
 }
 
+CacheCompressionStats
+AppManager::getNodeCacheCompressionStats() const
+{
+    return _imp->_nodeCache->getCompressionStats();
+}
+
+CacheAccessStats
+AppManager::getNodeCacheAccessStats() const
+{
+    return _imp->_nodeCache->getAccessStats();
+}
+
 U64
 AppManager::getCachesTotalDiskSize() const
 {
@@ -2571,6 +2628,20 @@ AppManager::setNThreadsToRender(int nThreads)
     QMutexLocker l(&_imp->nThreadsMutex);
 
     _imp->nThreadsToRender = nThreads;
+
+    // The thread waiting on a batch of the task scheduler runs tasks too: it only needs the other threads as workers.
+    // -1 means no multi-threading, 0 means guess from the hardware
+    int nWorkers;
+    if (nThreads == -1) {
+        nWorkers = 0;
+    } else if (nThreads == 0) {
+        nWorkers = _imp->idealThreadCount - 1;
+    } else {
+        nWorkers = nThreads - 1;
+    }
+    if (_imp->taskScheduler) {
+        _imp->taskScheduler->setNumActiveWorkers(nWorkers);
+    }
 }
 
 void
@@ -2607,6 +2678,12 @@ AppManager::getUseThreadPool() const
     return _imp->useThreadPool;
 }
 
+TaskScheduler*
+AppManager::getTaskScheduler() const
+{
+    return _imp->taskScheduler.get();
+}
+
 void
 AppManager::fetchAndAddNRunningThreads(int nThreads)
 {
@@ -214,10 +214,16 @@ public:
 
     U64 getCachesTotalMemorySize() const;
     U64 getCachesTotalDiskSize() const;
+    CacheCompressionStats getNodeCacheCompressionStats() const;
+    CacheAccessStats getNodeCacheAccessStats() const;
     boost::shared_ptr<CacheSignalEmitter> getOrActivateViewerCacheSignalEmitter() const;
 
     void setApplicationsCachesMaximumMemoryPercent(double p);
 
+    void setApplicationsCachesMaximumCompressedPercent(int p);
+
+    void setApplicationsCachesEvictionPolicy(CacheEvictionPolicyEnum policy);
+
     void setApplicationsCachesMaximumViewerDiskSpace(unsigned long long size);
 
     void setApplicationsCachesMaximumDiskSpace(unsigned long long size);
@@ -377,6 +383,11 @@ public:
     void getNThreadsSettings(int* nThreadsToRender, int* nThreadsPerEffect) const;
     bool getUseThreadPool() const;
 
+    /**
+     * @brief Returns the scheduler used to render tiles, OpenFX multi-thread suite calls and viewer tiles concurrently.
+     **/
+    TaskScheduler* getTaskScheduler() const;
+
     /**
      * @brief Updates the global runningThreadsCount maintained across the whole application
      **/
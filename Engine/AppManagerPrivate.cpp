@@ -93,6 +93,7 @@ AppManagerPrivate::AppManagerPrivate()
     , _nodeCache()
     , _diskCache()
     , _viewerCache()
+    , _diskCacheShared(false)
     , diskCachesLocationMutex()
     , diskCachesLocation()
     , _backgroundIPC()
@@ -109,6 +110,8 @@ AppManagerPrivate::AppManagerPrivate()
     , nThreadsPerEffect(0)
     , useThreadPool(true)
     , nThreadsMutex()
+    , taskScheduler()
+    , traceFilePath()
     , runningThreadsCount()
     , lastProjectLoadedCreatedDuringRC2Or3(false)
     , args()
@@ -284,39 +287,38 @@ AppManagerPrivate::declareSettingsToPython()
     }
 }
 
-template <typename T>
 void
-saveCache(const boost::shared_ptr<Cache<T> >& cache)
+AppManagerPrivate::saveCaches()
 {
-    std::string cacheRestoreFilePath = cache->getRestoreFilePath();
-    FStreamsSupport::ofstream ofile;
-    FStreamsSupport::open(&ofile, cacheRestoreFilePath);
-
-    if (!ofile) {
-        std::cerr << "Failed to save cache to " << cacheRestoreFilePath.c_str() << std::endl;
-
-        return;
-    }
-
+    // Entries are journaled as they are stored on disk, just write the ones that were not yet
+    _viewerCache->syncJournal();
+    _diskCache->syncJournal();
+} // saveCaches
 
-    typename Cache<T>::CacheTOC toc;
-    cache->save(&toc);
-    unsigned int version = cache->cacheVersion();
-    try {
-        boost::archive::binary_oarchive oArchive(ofile);
-        oArchive << version;
-        oArchive << toc;
-    } catch (const std::exception & e) {
-        qDebug() << "Failed to serialize the cache table of contents:" << e.what();
-    }
+template <typename T>
+void
+closeCache(const boost::shared_ptr<Cache<T> >& cache)
+{
+    // Move the entries in memory to the disk portion so that they are journaled
+    cache->clearInMemoryPortion(false);
+    cache->closeJournal();
 }
 
 void
-AppManagerPrivate::saveCaches()
+AppManagerPrivate::closeCaches()
 {
-    saveCache<FrameEntry>( _viewerCache );
-    saveCache<Image>( _diskCache );
-} // saveCaches
+    closeCache<FrameEntry>( _viewerCache );
+    closeCache<Image>( _diskCache );
+} // closeCaches
+
+template <typename T>
+void
+openCacheJournal(const boost::shared_ptr<Cache<T> >& cache)
+{
+    if ( !cache->openJournal() ) {
+        std::cerr << "Failed to create the cache journal at: " << cache->getJournalFilePath() << std::endl;
+    }
+}
 
 template <typename T>
 void
@@ -324,39 +326,27 @@ restoreCache(AppManagerPrivate* p,
              const boost::shared_ptr<Cache<T> >& cache)
 {
     if ( p->checkForCacheDiskStructure( cache->getCachePath(), cache->isTileCache() ) ) {
-        std::string settingsFilePath = cache->getRestoreFilePath();
-        FStreamsSupport::ifstream ifile;
-        FStreamsSupport::open(&ifile, settingsFilePath);
-        if (!ifile) {
-            std::cerr << "Failure to open cache restore file at: " << settingsFilePath << std::endl;
-
+        if ( cache->restoreFromJournal() ) {
             return;
         }
-        typename Cache<T>::CacheTOC tableOfContents;
-        unsigned int cacheVersion = 0x1; //< default to 1 before NATRON_CACHE_VERSION was introduced
-        try {
-            boost::archive::binary_iarchive iArchive(ifile);
-            if (cache->cacheVersion() >= NATRON_CACHE_VERSION) {
-                iArchive >> cacheVersion;
-            }
-            //Only load caches with same version, otherwise wipe it!
-            if ( cacheVersion == cache->cacheVersion() ) {
-                iArchive >> tableOfContents;
-            } else {
-                p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
-            }
-        } catch (const std::exception & e) {
-            qDebug() << "Exception when reading disk cache TOC:" << e.what();
-            p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
-
-            return;
-        }
-
-        QFile restoreFile( QString::fromUtf8( settingsFilePath.c_str() ) );
-        restoreFile.remove();
+        // The journal was written by another version of the cache: wipe it!
+        p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
+    }
+    openCacheJournal(cache);
+}
 
-        cache->restore(tableOfContents);
+template <typename T>
+void
+restoreSharedCache(AppManagerPrivate* p,
+                   const boost::shared_ptr<Cache<T> >& cache)
+{
+    // Other processes may be using the cache: it is never wiped, the entries whose file was removed are just not restored
+    if ( cache->restoreFromJournal() ) {
+        return;
     }
+    // There is no journal yet, or it was written by another version of the cache
+    p->createCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
+    openCacheJournal(cache);
 }
 
 void
@@ -365,9 +355,22 @@ AppManagerPrivate::restoreCaches()
     if ( !appPTR->isBackground() ) {
         restoreCache<FrameEntry>( this, _viewerCache );
         restoreCache<Image>( this, _diskCache );
+    } else if (_diskCacheShared) {
+        restoreSharedCache<Image>( this, _diskCache );
     }
 } // restoreCaches
 
+void
+AppManagerPrivate::openCachesJournal()
+{
+    if ( !appPTR->isBackground() ) {
+        openCacheJournal<FrameEntry>( _viewerCache );
+        openCacheJournal<Image>( _diskCache );
+    } else if (_diskCacheShared) {
+        openCacheJournal<Image>( _diskCache );
+    }
+}
+
 bool
 AppManagerPrivate::checkForCacheDiskStructure(const QString & cachePath, bool isTiled)
 {
@@ -376,8 +379,7 @@ AppManagerPrivate::checkForCacheDiskStructure(const QString & cachePath, bool is
     if ( !settingsFilePath.endsWith( QChar::fromLatin1('/') ) ) {
         settingsFilePath += QChar::fromLatin1('/');
     }
-    settingsFilePath += QString::fromUtf8("restoreFile.");
-    settingsFilePath += QString::fromUtf8(NATRON_CACHE_FILE_EXT);
+    settingsFilePath += QString::fromUtf8(NATRON_CACHE_JOURNAL_FILE_NAME);
 
     if ( !QFile::exists(settingsFilePath) ) {
         cleanUpCacheDiskStructure(cachePath, isTiled);
@@ -392,7 +394,7 @@ AppManagerPrivate::checkForCacheDiskStructure(const QString & cachePath, bool is
 
         /*Now counting actual data files in the cache*/
         /*check if there's 256 subfolders, otherwise reset cache.*/
-        int count = 0; // -1 because of the restoreFile
+        int count = 0;
         int subFolderCount = 0;
         Q_FOREACH(const QString &file, files) {
             QString subFolder(cachePath);
@@ -437,7 +439,6 @@ AppManagerPrivate::cleanUpCacheDiskStructure(const QString & cachePath, bool isT
         cacheFolder.removeRecursively();
     }
 #endif
-    cacheFolder.mkpath( QChar::fromLatin1('.') );
 
     QStringList etr = cacheFolder.entryList(QDir::NoDotAndDotDot);
     // if not 256 subdirs, we re-create the cache
@@ -446,6 +447,15 @@ AppManagerPrivate::cleanUpCacheDiskStructure(const QString & cachePath, bool isT
             cacheFolder.rmdir(e);
         }
     }
+    createCacheDiskStructure(cachePath, isTiled);
+}
+
+void
+AppManagerPrivate::createCacheDiskStructure(const QString & cachePath, bool isTiled)
+{
+    QDir cacheFolder(cachePath);
+
+    cacheFolder.mkpath( QChar::fromLatin1('.') );
     if (!isTiled) {
         for (U32 i = 0x00; i <= 0xF; ++i) {
             for (U32 j = 0x00; j <= 0xF; ++j) {
@@ -68,6 +68,7 @@ GCC_DIAG_ON(deprecated)
 #include "Engine/Image.h"
 #include "Engine/GPUContextPool.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/EngineFwd.h"
 #include "Engine/TLSHolder.h"
 
@@ -95,6 +96,7 @@ public:
     ImageCachePtr  _nodeCache; //< Images cache
     ImageCachePtr  _diskCache; //< Images disk cache (used by DiskCache nodes)
     FrameEntryCachePtr _viewerCache; //< Viewer textures cache
+    bool _diskCacheShared; //< true if the disk cache is restored in background mode, and shared with other processes
     mutable QMutex diskCachesLocationMutex;
     QString diskCachesLocation;
     boost::scoped_ptr<ProcessInputChannel> _backgroundIPC; //< object used to communicate with the main app
@@ -113,6 +115,8 @@ public:
     int nThreadsPerEffect;  // the value held by the corresponding Knob in the Settings, stored here for faster access (3 RW lock vs 1 mutex here)
     bool useThreadPool; // whether the multi-thread suite should use the global thread pool (of QtConcurrent) or not
     mutable QMutex nThreadsMutex; // protects nThreadsToRender & nThreadsPerEffect & useThreadPool
+    boost::scoped_ptr<TaskScheduler> taskScheduler; //< work-stealing scheduler used to render tiles concurrently
+    QString traceFilePath; //< if not empty, the render trace is written to this file when exiting
 
     //The idea here is to keep track of the number of threads launched by Natron (except the ones of the global thread pool of QtConcurrent)
     //So that we can properly have an estimation of how much the cores of the CPU are used.
@@ -199,14 +203,21 @@ public:
 
     void saveCaches();
 
+    void closeCaches();
+
     void restoreCaches();
 
+    void openCachesJournal();
+
     static void addOpenGLRequirementsString(QString& str, OpenGLRequirementsTypeEnum type);
 
     bool checkForCacheDiskStructure(const QString & cachePath, bool isTiled);
 
     void cleanUpCacheDiskStructure(const QString & cachePath, bool isTiled);
 
+    // Creates the folders of the cache that do not exist, without removing anything
+    void createCacheDiskStructure(const QString & cachePath, bool isTiled);
+
     /**
      * @brief Called on startup to initialize the max opened files
      **/
@@ -701,28 +701,19 @@ recursiveBezier(const Point& p0, const Point& p1, const Point& p2, const Point&
 }
 #endif // #ifdef ROTO_BEZIER_EVAL_ITERATIVE
 
-// compute nbPointsperSegment points and update the bbox bounding box for the Bezier
-// segment from 'first' to 'last' evaluated at 'time'
-// If nbPointsPerSegment is -1 then it will be automatically computed
+// compute the control points of the Bezier segment from 'first' to 'last' evaluated at 'time',
+// transformed and scaled to the mipmap level
 static void
-bezierSegmentEval(bool useGuiCurves,
-                  const BezierCP & first,
-                  const BezierCP & last,
-                  double time,
-                  ViewIdx view,
-                  unsigned int mipMapLevel,
-#ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                  int nbPointsPerSegment,
-#else
-                  double errorScale,
-#endif
-                  const Transform::Matrix3x3& transform,
-                  std::vector< ParametricPoint >* points, ///< output
-                  RectD* bbox = NULL,
-                  bool* bboxSet = NULL) ///< input/output (optional)
+bezierSegmentControlPoints(bool useGuiCurves,
+                           const BezierCP & first,
+                           const BezierCP & last,
+                           double time,
+                           ViewIdx view,
+                           unsigned int mipMapLevel,
+                           const Transform::Matrix3x3& transform,
+                           Point controlPoints[4]) ///< output
 {
     Transform::Point3D p0M, p1M, p2M, p3M;
-    Point p0, p1, p2, p3;
 
     try {
         first.getPositionAtTime(useGuiCurves, time, view, &p0M.x, &p0M.y);
@@ -740,6 +731,10 @@ bezierSegmentEval(bool useGuiCurves,
     p2M = matApply(transform, p2M);
     p3M = matApply(transform, p3M);
 
+    Point& p0 = controlPoints[0];
+    Point& p1 = controlPoints[1];
+    Point& p2 = controlPoints[2];
+    Point& p3 = controlPoints[3];
     p0.x = p0M.x / p0M.z; p0.y = p0M.y / p0M.z;
     p1.x = p1M.x / p1M.z; p1.y = p1M.y / p1M.z;
     p2.x = p2M.x / p2M.z; p2.y = p2M.y / p2M.z;
@@ -760,6 +755,23 @@ bezierSegmentEval(bool useGuiCurves,
         p3.x /= pot;
         p3.y /= pot;
     }
+} // bezierSegmentControlPoints
+
+// compute nbPointsperSegment points of the Bezier segment defined by the given control points
+// If nbPointsPerSegment is -1 then it will be automatically computed
+static void
+bezierSegmentTessellate(const Point controlPoints[4],
+#ifdef ROTO_BEZIER_EVAL_ITERATIVE
+                        int nbPointsPerSegment,
+#else
+                        double errorScale,
+#endif
+                        std::vector< ParametricPoint >* points) ///< output
+{
+    const Point& p0 = controlPoints[0];
+    const Point& p1 = controlPoints[1];
+    const Point& p2 = controlPoints[2];
+    const Point& p3 = controlPoints[3];
 
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
     if (nbPointsPerSegment == -1) {
@@ -793,8 +805,58 @@ bezierSegmentEval(bool useGuiCurves,
     static const int maxRecursion = 32;
     recursiveBezier(p0, p1, p2, p3, errorScale, maxRecursion, points);
 #endif
+} // bezierSegmentTessellate
+
+// compute nbPointsperSegment points and update the bbox bounding box for the Bezier
+// segment from 'first' to 'last' evaluated at 'time'
+// If nbPointsPerSegment is -1 then it will be automatically computed
+// If a cache is given, the points are copied from it when the control points did not change
+static void
+bezierSegmentEval(bool useGuiCurves,
+                  const BezierCP & first,
+                  const BezierCP & last,
+                  double time,
+                  ViewIdx view,
+                  unsigned int mipMapLevel,
+#ifdef ROTO_BEZIER_EVAL_ITERATIVE
+                  int nbPointsPerSegment,
+#else
+                  double errorScale,
+#endif
+                  const Transform::Matrix3x3& transform,
+                  BezierTessellationCache* cache,
+                  std::vector< ParametricPoint >* points, ///< output
+                  RectD* bbox = NULL,
+                  bool* bboxSet = NULL) ///< input/output (optional)
+{
+    Point cps[4];
+
+    bezierSegmentControlPoints(useGuiCurves, first, last, time, view, mipMapLevel, transform, cps);
+
+    std::vector<ParametricPoint>* tessellatedPoints = points;
+    std::size_t firstPoint = 0;
+    if (cache) {
+        tessellatedPoints = &cache->getPoints();
+        firstPoint = tessellatedPoints->size();
+    }
+    if ( !cache || !cache->appendCachedSegment(cps) ) {
+        bezierSegmentTessellate(cps,
+#ifdef ROTO_BEZIER_EVAL_ITERATIVE
+                                nbPointsPerSegment,
+#else
+                                errorScale,
+#endif
+                                tessellatedPoints);
+        if (cache) {
+            cache->appendSegment(cps, firstPoint);
+        }
+    }
+    if (cache) {
+        points->insert( points->end(), tessellatedPoints->begin() + firstPoint, tessellatedPoints->end() );
+    }
+
     if (bbox) {
-        Bezier::bezierPointBboxUpdate(p0,  p1,  p2,  p3, bbox, bboxSet);
+        Bezier::bezierPointBboxUpdate(cps[0], cps[1], cps[2], cps[3], bbox, bboxSet);
     }
 } // bezierSegmentEval
 
@@ -1027,6 +1089,7 @@ Bezier::clearAllPoints()
     _imp->featherPoints.clear();
     _imp->isClockwiseOriented.clear();
     _imp->finished = false;
+    _imp->tessellationCache.clear();
 }
 
 void
@@ -2528,10 +2591,19 @@ Bezier::deCastelJau(bool useGuiCurves,
                     const Transform::Matrix3x3& transform,
                     std::vector<std::vector<ParametricPoint> >* points,
                     std::vector<ParametricPoint >* pointsSingleList,
-                    RectD* bbox)
+                    RectD* bbox,
+                    BezierTessellationCache* cache)
 {
     bool bboxSet = false;
     assert((points && !pointsSingleList) || (!points && pointsSingleList));
+    if (cache) {
+        BezierTessellationCache::Key key;
+        key.time = time;
+        key.mipMapLevel = mipMapLevel;
+        key.tessellation = nBPointsPerSegment;
+        key.useGuiCurves = useGuiCurves;
+        cache->begin(key);
+    }
     BezierCPs::const_iterator next = cps.begin();
 
     if ( next != cps.end() ) {
@@ -2551,11 +2623,11 @@ Bezier::deCastelJau(bool useGuiCurves,
         bool segbboxSet = false;
         if (points) {
             std::vector<ParametricPoint> segmentPoints;
-            bezierSegmentEval(useGuiCurves, *(*it), *(*next), time, ViewIdx(0), mipMapLevel, nBPointsPerSegment, transform, &segmentPoints, bbox ? &segbbox : 0, &segbboxSet);
+            bezierSegmentEval(useGuiCurves, *(*it), *(*next), time, ViewIdx(0), mipMapLevel, nBPointsPerSegment, transform, cache, &segmentPoints, bbox ? &segbbox : 0, &segbboxSet);
             points->push_back(segmentPoints);
         } else {
             assert(pointsSingleList);
-            bezierSegmentEval(useGuiCurves, *(*it), *(*next), time, ViewIdx(0), mipMapLevel, nBPointsPerSegment, transform, pointsSingleList, bbox ? &segbbox : 0, &segbboxSet);
+            bezierSegmentEval(useGuiCurves, *(*it), *(*next), time, ViewIdx(0), mipMapLevel, nBPointsPerSegment, transform, cache, pointsSingleList, bbox ? &segbbox : 0, &segbboxSet);
         }
 
         if (bbox) {
@@ -2572,6 +2644,9 @@ Bezier::deCastelJau(bool useGuiCurves,
             ++next;
         }
     } // for()
+    if (cache) {
+        cache->end();
+    }
 }
 
 void
@@ -2640,7 +2715,7 @@ Bezier::evaluateAtTime_DeCasteljau_internal(bool useGuiCurves,
 #else
                 errorScale,
 #endif
-                transform, points, pointsSingleList, bbox);
+                transform, points, pointsSingleList, bbox, &_imp->tessellationCache);
 }
 
 void
@@ -2716,6 +2791,18 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
     Transform::Matrix3x3 transform;
     getTransformAtTime(time, &transform);
 
+    BezierTessellationCache::Key key;
+    key.time = time;
+    key.mipMapLevel = mipMapLevel;
+#ifdef ROTO_BEZIER_EVAL_ITERATIVE
+    key.tessellation = nbPointsPerSegment;
+#else
+    key.tessellation = errorScale;
+#endif
+    key.useGuiCurves = useGuiPoints;
+    key.feather = true;
+    _imp->tessellationCache.begin(key);
+
     for (BezierCPs::const_iterator it = _imp->featherPoints.begin(); it != _imp->featherPoints.end();
          ++it) {
         if ( next == _imp->featherPoints.end() ) {
@@ -2738,7 +2825,7 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
 #else
                               errorScale,
 #endif
-                              transform, &segmentPoints, bbox);
+                              transform, &_imp->tessellationCache, &segmentPoints, bbox);
             points->push_back(segmentPoints);
         } else {
             assert(pointsSingleList);
@@ -2748,7 +2835,7 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
 #else
                               errorScale,
 #endif
-                              transform, pointsSingleList, bbox);
+                              transform, &_imp->tessellationCache, pointsSingleList, bbox);
         }
 
         // increment for next iteration
@@ -2762,6 +2849,7 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
             ++nextCp;
         }
     } // for(it)
+    _imp->tessellationCache.end();
 
 }
 
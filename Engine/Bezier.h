@@ -42,6 +42,7 @@ CLANG_DIAG_ON(deprecated-declarations)
 
 #include "Global/GlobalDefines.h"
 
+#include "Engine/BezierTessellationCache.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
@@ -66,11 +67,6 @@ NATRON_NAMESPACE_ENTER;
  * has at least a minimum of 1 keyframe.
  **/
 
-struct ParametricPoint
-{
-    double x,y,t;
-};
-
 struct BezierPrivate;
 class Bezier
     : public RotoDrawableItem
@@ -358,6 +354,10 @@ public:
      **/
     int getKeyframesCount() const;
 
+    /**
+     * @brief Evaluates the segments of the spline formed by cps. If a cache is given, only the segments whose control points
+     * changed since the tessellations it holds are evaluated.
+     **/
     static void deCastelJau(bool useGuiCurves,
                             const std::list<BezierCPPtr >& cps, double time, unsigned int mipMapLevel,
                             bool finished,
@@ -365,7 +365,8 @@ public:
                             const Transform::Matrix3x3& transform,
                             std::vector<std::vector<ParametricPoint> >* points,
                             std::vector<ParametricPoint >* pointsSingleList,
-                            RectD* bbox);
+                            RectD* bbox,
+                            BezierTessellationCache* cache = NULL);
     static void point_line_intersection(const Point &p1,
                                         const Point &p2,
                                         const Point &pos,
@@ -0,0 +1,246 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "BezierTessellationCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <list>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/atomic.hpp>
+#endif
+
+NATRON_NAMESPACE_ENTER;
+
+// Number of segments after the last reused one where a segment is looked up: enough to skip the segments
+// replaced when a control point is inserted or removed
+#define NATRON_BEZIER_TESSELLATION_CACHE_LOOKAHEAD 3
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+struct TessellatedSegment
+{
+    Point controlPoints[4];
+    std::size_t firstPoint;
+    std::size_t nPoints;
+};
+
+struct Tessellation
+{
+    BezierTessellationCache::Key key;
+    std::vector<TessellatedSegment> segments;
+
+    // The points of all segments, in order
+    std::vector<ParametricPoint> points;
+
+    void swap(Tessellation& other)
+    {
+        std::swap(key, other.key);
+        segments.swap(other.segments);
+        points.swap(other.points);
+    }
+};
+
+boost::atomic<U64> nTessellations(0);
+boost::atomic<U64> nSegmentsReused(0);
+boost::atomic<U64> nSegmentsEvaluated(0);
+
+bool
+sameControlPoints(const Point a[4],
+                  const Point b[4])
+{
+    for (int i = 0; i < 4; ++i) {
+        if ( (a[i].x != b[i].x) || (a[i].y != b[i].y) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+struct BezierTessellationCachePrivate
+{
+    // Most recently used first
+    std::list<Tessellation> entries;
+
+    // The tessellation being built: its buffers are recycled from evicted entries
+    Tessellation current;
+    bool building;
+
+    // The tessellation in which segments are looked up, and the index of the next segment expected to match
+    const Tessellation* reference;
+    std::size_t referenceIndex;
+
+    U64 nReused, nEvaluated;
+
+    BezierTessellationCachePrivate()
+        : entries()
+        , current()
+        , building(false)
+        , reference(0)
+        , referenceIndex(0)
+        , nReused(0)
+        , nEvaluated(0)
+    {
+    }
+};
+
+BezierTessellationCache::BezierTessellationCache()
+    : _imp( new BezierTessellationCachePrivate() )
+{
+}
+
+BezierTessellationCache::~BezierTessellationCache()
+{
+}
+
+void
+BezierTessellationCache::begin(const Key& key)
+{
+    assert(!_imp->building);
+    _imp->building = true;
+    _imp->current.key = key;
+    _imp->current.segments.clear();
+    _imp->current.points.clear();
+    _imp->reference = 0;
+    _imp->referenceIndex = 0;
+    _imp->nReused = 0;
+    _imp->nEvaluated = 0;
+
+    for (std::list<Tessellation>::const_iterator it = _imp->entries.begin(); it != _imp->entries.end(); ++it) {
+        if (it->key == key) {
+            _imp->reference = &*it;
+            break;
+        } else if ( !_imp->reference && it->key.isCompatible(key) ) {
+            _imp->reference = &*it;
+        }
+    }
+    if (_imp->reference) {
+        _imp->current.segments.reserve( _imp->reference->segments.size() );
+        _imp->current.points.reserve( _imp->reference->points.size() );
+    }
+}
+
+bool
+BezierTessellationCache::appendCachedSegment(const Point controlPoints[4])
+{
+    assert(_imp->building);
+    if (!_imp->reference) {
+        return false;
+    }
+    const std::vector<TessellatedSegment>& refSegments = _imp->reference->segments;
+    std::size_t endIndex = std::min(refSegments.size(), _imp->referenceIndex + NATRON_BEZIER_TESSELLATION_CACHE_LOOKAHEAD);
+    for (std::size_t i = _imp->referenceIndex; i < endIndex; ++i) {
+        const TessellatedSegment& refSegment = refSegments[i];
+        if ( !sameControlPoints(refSegment.controlPoints, controlPoints) ) {
+            continue;
+        }
+        TessellatedSegment segment = refSegment;
+        segment.firstPoint = _imp->current.points.size();
+        std::vector<ParametricPoint>::const_iterator refPoints = _imp->reference->points.begin() + refSegment.firstPoint;
+        _imp->current.points.insert(_imp->current.points.end(), refPoints, refPoints + refSegment.nPoints);
+        _imp->current.segments.push_back(segment);
+        _imp->referenceIndex = i + 1;
+        ++_imp->nReused;
+
+        return true;
+    }
+
+    return false;
+}
+
+std::vector<ParametricPoint>&
+BezierTessellationCache::getPoints()
+{
+    return _imp->current.points;
+}
+
+void
+BezierTessellationCache::appendSegment(const Point controlPoints[4],
+                                       std::size_t firstPoint)
+{
+    assert(_imp->building);
+    assert( firstPoint <= _imp->current.points.size() );
+    TessellatedSegment segment;
+    for (int i = 0; i < 4; ++i) {
+        segment.controlPoints[i] = controlPoints[i];
+    }
+    segment.firstPoint = firstPoint;
+    segment.nPoints = _imp->current.points.size() - firstPoint;
+    _imp->current.segments.push_back(segment);
+    ++_imp->nEvaluated;
+}
+
+void
+BezierTessellationCache::end()
+{
+    assert(_imp->building);
+    _imp->building = false;
+    _imp->reference = 0;
+
+    ++nTessellations;
+    nSegmentsReused += _imp->nReused;
+    nSegmentsEvaluated += _imp->nEvaluated;
+
+    // Replace the entry with the same key, otherwise the least recently used one if the cache is full
+    std::list<Tessellation>::iterator found = _imp->entries.begin();
+    for (; found != _imp->entries.end(); ++found) {
+        if (found->key == _imp->current.key) {
+            break;
+        }
+    }
+    if ( found == _imp->entries.end() ) {
+        if (_imp->entries.size() < NATRON_BEZIER_TESSELLATION_CACHE_MAX_ENTRIES) {
+            _imp->entries.push_front( Tessellation() );
+            found = _imp->entries.begin();
+        } else {
+            found = --_imp->entries.end();
+        }
+    }
+    _imp->entries.splice(_imp->entries.begin(), _imp->entries, found);
+    _imp->entries.front().swap(_imp->current);
+}
+
+void
+BezierTessellationCache::clear()
+{
+    assert(!_imp->building);
+    _imp->entries.clear();
+    _imp->current = Tessellation();
+}
+
+BezierTessellationStats
+BezierTessellationCache::getStats()
+{
+    BezierTessellationStats ret;
+
+    ret.tessellations = nTessellations.load();
+    ret.segmentsReused = nSegmentsReused.load();
+    ret.segmentsEvaluated = nSegmentsEvaluated.load();
+
+    return ret;
+}
+
+NATRON_NAMESPACE_EXIT;
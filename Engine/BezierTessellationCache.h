@@ -0,0 +1,182 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_BezierTessellationCache_h
+#define Natron_Engine_BezierTessellationCache_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+#include "Engine/EngineFwd.h"
+
+// Number of tessellations kept for each Bezier (e.g: the current frame at the viewer mipmap level and at full resolution)
+#define NATRON_BEZIER_TESSELLATION_CACHE_MAX_ENTRIES 4
+
+NATRON_NAMESPACE_ENTER;
+
+struct ParametricPoint
+{
+    double x,y,t;
+};
+
+/**
+ * @brief Counters of the segments tessellated by all Bezier, to measure how often the cache avoids evaluating them.
+ **/
+struct BezierTessellationStats
+{
+    // Number of times a Bezier or its feather was tessellated
+    U64 tessellations;
+
+    // Number of segments whose points were copied from a previous tessellation
+    U64 segmentsReused;
+
+    // Number of segments whose points had to be evaluated from their control points
+    U64 segmentsEvaluated;
+
+    BezierTessellationStats()
+        : tessellations(0)
+        , segmentsReused(0)
+        , segmentsEvaluated(0)
+    {
+    }
+
+    double getHitRate() const
+    {
+        return segmentsReused + segmentsEvaluated ? (double)segmentsReused / (segmentsReused + segmentsEvaluated) : 0.;
+    }
+};
+
+/**
+ * @brief Keeps the last tessellations of a Bezier (or of its feather), so that only the segments whose control points
+ * changed are evaluated again.
+ *
+ * A tessellation is identified by a Key. A segment is identified by its 4 control points, once transformed and scaled
+ * to the mipmap level: a segment of a previous tessellation with the same control points is reused, which covers
+ * changes of the time, of the transform, and edits of some of the control points.
+ * The points of all segments are stored in a single contiguous buffer.
+ *
+ * A tessellation is built with:
+ *
+ *     cache.begin(key);
+ *     for each segment:
+ *         std::size_t first = cache.getPoints().size();
+ *         if ( !cache.appendCachedSegment(controlPoints) ) {
+ *             // evaluate the segment and append its points to cache.getPoints()
+ *             cache.appendSegment(controlPoints, first);
+ *         }
+ *         // the points of the segment are in cache.getPoints() from first to the end
+ *     cache.end();
+ *
+ * This class is not thread-safe: the Bezier only uses it under its item mutex.
+ **/
+struct BezierTessellationCachePrivate;
+class BezierTessellationCache
+{
+public:
+
+    struct Key
+    {
+        double time;
+        unsigned int mipMapLevel;
+
+        // Number of points per segment (or error scale): a tessellation may only reuse segments of tessellations with the same value
+        double tessellation;
+        bool useGuiCurves;
+        bool feather;
+
+        Key()
+            : time(0.)
+            , mipMapLevel(0)
+            , tessellation(0.)
+            , useGuiCurves(false)
+            , feather(false)
+        {
+        }
+
+        bool operator==(const Key& other) const
+        {
+            return time == other.time && isCompatible(other);
+        }
+
+        // Whether the segments of a tessellation may be reused by the other
+        bool isCompatible(const Key& other) const
+        {
+            return mipMapLevel == other.mipMapLevel && tessellation == other.tessellation &&
+                   useGuiCurves == other.useGuiCurves && feather == other.feather;
+        }
+    };
+
+    BezierTessellationCache();
+
+    ~BezierTessellationCache();
+
+    /**
+     * @brief Starts a new tessellation. Segments are looked up in the tessellation with the same key if any,
+     * otherwise in the most recent compatible one.
+     **/
+    void begin(const Key& key);
+
+    /**
+     * @brief If a segment with the same control points was tessellated before, appends its points to getPoints()
+     * and returns true.
+     **/
+    bool appendCachedSegment(const Point controlPoints[4]);
+
+    /**
+     * @brief The points of the tessellation being built.
+     **/
+    std::vector<ParametricPoint>& getPoints();
+
+    /**
+     * @brief Records the points appended to getPoints() from firstPoint as the tessellation of the segment.
+     **/
+    void appendSegment(const Point controlPoints[4], std::size_t firstPoint);
+
+    /**
+     * @brief Stores the tessellation being built, evicting the least recently used one if needed.
+     **/
+    void end();
+
+    void clear();
+
+    /**
+     * @brief Returns the counters of all caches since the application started.
+     **/
+    static BezierTessellationStats getStats();
+
+private:
+
+    boost::scoped_ptr<BezierTessellationCachePrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_BezierTessellationCache_h
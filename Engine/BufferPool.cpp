@@ -0,0 +1,283 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <map>
+#include <new>
+
+#if defined(__NATRON_LINUX__)
+#include <sys/mman.h>
+#endif
+
+#include <QtCore/QMutex>
+
+// Until setMaximumRetainedSize() is called
+#define BUFFER_POOL_DEFAULT_MAX_RETAINED_SIZE (256 * 1024 * 1024)
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct RetainedBuffer
+{
+    void* ptr;
+    std::size_t size;
+};
+
+typedef std::list<RetainedBuffer> RetainedBufferList;
+
+struct BufferPoolPrivate
+{
+    QMutex lock;
+
+    // Buffers kept in the pool, from the least to the most recently released
+    RetainedBufferList buffers;
+
+    // The buffers by size. Buffers of the same size are in the same order as in the list
+    std::multimap<std::size_t, RetainedBufferList::iterator> bySize;
+    std::size_t retainedSize;
+    std::size_t maximumRetainedSize;
+    U64 nAllocations;
+    U64 nReused;
+
+    BufferPoolPrivate()
+        : lock()
+        , buffers()
+        , bySize()
+        , retainedSize(0)
+        , maximumRetainedSize(BUFFER_POOL_DEFAULT_MAX_RETAINED_SIZE)
+        , nAllocations(0)
+        , nReused(0)
+    {
+    }
+
+    // Frees the least recently released buffers until the pool fits in maxSize. The lock must be held.
+    void freeRetainedBuffers(std::size_t maxSize)
+    {
+        while ( retainedSize > maxSize && !buffers.empty() ) {
+            const RetainedBuffer& oldest = buffers.front();
+            // it is also the oldest buffer of its size
+            bySize.erase( bySize.lower_bound(oldest.size) );
+            retainedSize -= oldest.size;
+            free(oldest.ptr);
+            buffers.pop_front();
+        }
+    }
+};
+
+// Buffers may be released by static objects destroyed after this file's statics: the pool is never destroyed
+BufferPoolPrivate*
+getPool()
+{
+    static BufferPoolPrivate* pool = new BufferPoolPrivate;
+
+    return pool;
+}
+
+void*
+allocateFromSystem(std::size_t size)
+{
+#if defined(__NATRON_LINUX__) && defined(MADV_HUGEPAGE)
+    if (size >= NATRON_BUFFER_POOL_HUGE_PAGE_SIZE) {
+        void* ret = 0;
+        if (posix_memalign(&ret, NATRON_BUFFER_POOL_HUGE_PAGE_SIZE, size) != 0) {
+            return 0;
+        }
+        // Only a hint: this fails harmlessly if transparent huge pages are disabled
+        madvise(ret, size, MADV_HUGEPAGE);
+
+        return ret;
+    }
+#endif
+
+    return malloc(size);
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+namespace BufferPool {
+
+std::size_t
+getAllocatedSize(std::size_t size)
+{
+    if (size < NATRON_BUFFER_POOL_MIN_SIZE) {
+        return size;
+    }
+    // 8 size classes between each power of two, which wastes at most 12.5% of the size
+    std::size_t powerOfTwo = NATRON_BUFFER_POOL_MIN_SIZE;
+    while (powerOfTwo <= size / 2) {
+        powerOfTwo *= 2;
+    }
+    std::size_t step = powerOfTwo / 8;
+
+    return (size + step - 1) / step * step;
+}
+
+void*
+allocate(std::size_t size)
+{
+    if (size < NATRON_BUFFER_POOL_MIN_SIZE) {
+        void* ret = malloc(size);
+        if (!ret) {
+            throw std::bad_alloc();
+        }
+
+        return ret;
+    }
+
+    std::size_t allocatedSize = getAllocatedSize(size);
+    BufferPoolPrivate* pool = getPool();
+    {
+        QMutexLocker k(&pool->lock);
+        ++pool->nAllocations;
+
+        // Reuse the most recently released buffer of that size, its pages are the most likely to be resident
+        std::multimap<std::size_t, RetainedBufferList::iterator>::iterator found = pool->bySize.upper_bound(allocatedSize);
+        if ( found != pool->bySize.begin() ) {
+            --found;
+            if (found->first == allocatedSize) {
+                void* ret = found->second->ptr;
+                pool->buffers.erase(found->second);
+                pool->bySize.erase(found);
+                pool->retainedSize -= allocatedSize;
+                ++pool->nReused;
+
+                return ret;
+            }
+        }
+    }
+
+    void* ret = allocateFromSystem(allocatedSize);
+    if (!ret) {
+        // The buffers kept in the pool may be what prevents the allocation
+        trim();
+        ret = allocateFromSystem(allocatedSize);
+        if (!ret) {
+            throw std::bad_alloc();
+        }
+    }
+
+    return ret;
+}
+
+void
+release(void* ptr,
+        std::size_t size)
+{
+    if (!ptr) {
+        return;
+    }
+    if (size < NATRON_BUFFER_POOL_MIN_SIZE) {
+        free(ptr);
+
+        return;
+    }
+
+    std::size_t allocatedSize = getAllocatedSize(size);
+    BufferPoolPrivate* pool = getPool();
+    QMutexLocker k(&pool->lock);
+    if (allocatedSize > pool->maximumRetainedSize) {
+        free(ptr);
+
+        return;
+    }
+    RetainedBuffer buffer;
+    buffer.ptr = ptr;
+    buffer.size = allocatedSize;
+    RetainedBufferList::iterator it = pool->buffers.insert(pool->buffers.end(), buffer);
+    // inserted after the buffers of the same size
+    pool->bySize.insert( std::make_pair(allocatedSize, it) );
+    pool->retainedSize += allocatedSize;
+    pool->freeRetainedBuffers(pool->maximumRetainedSize);
+}
+
+void*
+reallocate(void* ptr,
+           std::size_t oldSize,
+           std::size_t newSize)
+{
+    if (!ptr) {
+        return allocate(newSize);
+    }
+    if ( (oldSize < NATRON_BUFFER_POOL_MIN_SIZE) && (newSize < NATRON_BUFFER_POOL_MIN_SIZE) ) {
+        void* ret = realloc(ptr, newSize);
+        if (!ret) {
+            throw std::bad_alloc();
+        }
+
+        return ret;
+    }
+    if ( getAllocatedSize(oldSize) == getAllocatedSize(newSize) ) {
+        return ptr;
+    }
+
+    void* ret = allocate(newSize);
+    std::memcpy( ret, ptr, std::min(oldSize, newSize) );
+    release(ptr, oldSize);
+
+    return ret;
+}
+
+void
+setMaximumRetainedSize(std::size_t size)
+{
+    BufferPoolPrivate* pool = getPool();
+    QMutexLocker k(&pool->lock);
+
+    pool->maximumRetainedSize = size;
+    pool->freeRetainedBuffers(size);
+}
+
+void
+trim()
+{
+    BufferPoolPrivate* pool = getPool();
+    QMutexLocker k(&pool->lock);
+
+    pool->freeRetainedBuffers(0);
+}
+
+BufferPoolStats
+getStats()
+{
+    BufferPoolPrivate* pool = getPool();
+    QMutexLocker k(&pool->lock);
+    BufferPoolStats ret;
+
+    ret.nAllocations = pool->nAllocations;
+    ret.nReused = pool->nReused;
+    ret.nRetainedBuffers = pool->buffers.size();
+    ret.retainedSize = pool->retainedSize;
+    ret.maximumRetainedSize = pool->maximumRetainedSize;
+
+    return ret;
+}
+} // namespace BufferPool
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,121 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_BufferPool_h
+#define Natron_Engine_BufferPool_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#include "Global/GlobalDefines.h"
+
+// Buffers smaller than that are allocated with malloc and never pooled
+#define NATRON_BUFFER_POOL_MIN_SIZE (256 * 1024)
+
+// Buffers at least that large are aligned so that the system can back them with huge pages
+#define NATRON_BUFFER_POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// The maximum size of the buffers kept in the pool, as a fraction of the RAM cache size
+#define NATRON_BUFFER_POOL_RETAINED_CACHE_FRACTION 0.1
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Counters of the buffer pool.
+ **/
+struct BufferPoolStats
+{
+    // Number of allocations large enough to be pooled
+    U64 nAllocations;
+
+    // Number of those allocations that reused a buffer of the pool
+    U64 nReused;
+
+    // Number of buffers kept in the pool, and their total size in bytes
+    std::size_t nRetainedBuffers;
+    std::size_t retainedSize;
+
+    // Maximum size of the buffers kept in the pool, in bytes
+    std::size_t maximumRetainedSize;
+
+    BufferPoolStats()
+        : nAllocations(0)
+        , nReused(0)
+        , nRetainedBuffers(0)
+        , retainedSize(0)
+        , maximumRetainedSize(0)
+    {
+    }
+};
+
+/**
+ * @brief A pool of large buffers backing RamBuffer, so that images of the same size allocated and freed over and over
+ * (e.g. during playback) reuse memory that is already mapped instead of going through the system allocator.
+ *
+ * Sizes are rounded up to size classes (8 per power of two) and freed buffers are kept per size class, up to a maximum
+ * total size, after which the least recently freed buffers are given back to the system.
+ * All functions are thread-safe.
+ **/
+namespace BufferPool {
+
+/**
+ * @brief Returns a buffer of at least size bytes, which must be released with release() or reallocate().
+ * Throws std::bad_alloc on failure.
+ **/
+void* allocate(std::size_t size);
+
+/**
+ * @brief Releases a buffer returned by allocate(). size must be the size that was passed to allocate().
+ **/
+void release(void* ptr,
+             std::size_t size);
+
+/**
+ * @brief Same as realloc() for buffers returned by allocate(). ptr may be NULL.
+ * Throws std::bad_alloc on failure, in which case ptr is left untouched.
+ **/
+void* reallocate(void* ptr,
+                 std::size_t oldSize,
+                 std::size_t newSize);
+
+// Returns the size of the buffer actually allocated for size bytes
+std::size_t getAllocatedSize(std::size_t size);
+
+/**
+ * @brief Sets the maximum total size of the buffers kept in the pool. Buffers exceeding it are freed.
+ **/
+void setMaximumRetainedSize(std::size_t size);
+
+/**
+ * @brief Frees all the buffers kept in the pool.
+ **/
+void trim();
+
+BufferPoolStats getStats();
+} // namespace BufferPool
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_BufferPool_h
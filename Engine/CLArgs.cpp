@@ -37,6 +37,7 @@
 #include "Global/GitVersion.h"
 #include "Global/QtCompat.h"
 #include "Engine/AppManager.h"
+#include "Engine/RenderBenchmark.h"
 
 NATRON_NAMESPACE_ENTER;
 
@@ -60,6 +61,11 @@ public:
     std::list<std::pair<int, std::pair<int, int> > > frameRanges;
     bool rangeSet;
     bool enableRenderStats;
+    bool reuseDiskCache;
+    QString traceFilePath;
+    QString benchmarkReportFilePath;
+    int benchmarkRuns;
+    int renderProcesses;
     bool isEmpty;
     mutable QString imageFilename;
     QString breakpadPipeFilePath;
@@ -84,6 +90,11 @@ public:
         , frameRanges()
         , rangeSet(false)
         , enableRenderStats(false)
+        , reuseDiskCache(false)
+        , traceFilePath()
+        , benchmarkReportFilePath()
+        , benchmarkRuns(NATRON_RENDER_BENCHMARK_DEFAULT_RUNS)
+        , renderProcesses(1)
         , isEmpty(true)
         , imageFilename()
         , breakpadPipeFilePath()
@@ -180,6 +191,11 @@ CLArgs::operator=(const CLArgs& other)
     _imp->frameRanges = other._imp->frameRanges;
     _imp->rangeSet = other._imp->rangeSet;
     _imp->enableRenderStats = other._imp->enableRenderStats;
+    _imp->reuseDiskCache = other._imp->reuseDiskCache;
+    _imp->traceFilePath = other._imp->traceFilePath;
+    _imp->benchmarkReportFilePath = other._imp->benchmarkReportFilePath;
+    _imp->benchmarkRuns = other._imp->benchmarkRuns;
+    _imp->renderProcesses = other._imp->renderProcesses;
     _imp->isEmpty = other._imp->isEmpty;
     _imp->imageFilename = other._imp->imageFilename;
     _imp->exportDocsPath = other._imp->exportDocsPath;
@@ -275,7 +291,34 @@ CLArgs::printUsage(const std::string& programName)
         "     breakdown contains informations about each nodes, render times etc...\n"
         "     This option is useful for debugging purposes or to control that a render\n"
         "     is working correctly.\n"
-        "     **Please note** that it does not work when writing video files."
+        "     **Please note** that it does not work when writing video files.\n"
+        "  --reuse-disk-cache\n"
+        "     Restore the images stored on disk by DiskCache nodes in previous\n"
+        "     sessions and keep the ones rendered, like the graphical user interface\n"
+        "     does. Several processes may share the disk cache at the same time.\n"
+        "     This is only useful with %1Renderer or the -b option.\n"
+        "  --trace <trace file path>\n"
+        "     Record the time spent by each thread rendering, in plug-in actions,\n"
+        "     looking up the cache and waiting, and write it when exiting to the\n"
+        "     given file in the Chrome trace event format (JSON). The file can be\n"
+        "     viewed in the chrome://tracing page of Chrome or with Perfetto.\n"
+        "  --benchmark <report file path>\n"
+        "     Render the frame range several times, first with an empty cache then\n"
+        "     with the images cached by the previous renders, and write the time\n"
+        "     spent rendering each frame and each node, the cache hits and misses,\n"
+        "     the peak memory use and the utilization of the threads of each render\n"
+        "     to the given file in the JSON format. The statistics files of the\n"
+        "     -s option are not written. This is only useful with %1Renderer or the\n"
+        "     -b option.\n"
+        "  --benchmark-runs <number of renders>\n"
+        "     The number of times the frame range is rendered by --benchmark.\n"
+        "     The default is 2.\n"
+        "  --processes <number of processes>\n"
+        "     Split the frame range of each Write node into contiguous parts rendered\n"
+        "     at the same time by this number of %1Renderer processes, each one\n"
+        "     loading the project. This is faster when the plug-ins cannot render\n"
+        "     several frames at once, but each process uses its own cache. Video\n"
+        "     files are always written by a single process. The default is 1.\n"
         "Sample uses:\n"
         "  %1 /Users/Me/MyNatronProjects/MyProject.ntp\n"
         "  %1 -b -w MyWriter /Users/Me/MyNatronProjects/MyProject.ntp\n"
@@ -439,6 +482,36 @@ CLArgs::areRenderStatsEnabled() const
     return _imp->enableRenderStats;
 }
 
+bool
+CLArgs::isDiskCacheReuseEnabled() const
+{
+    return _imp->reuseDiskCache;
+}
+
+const QString&
+CLArgs::getTraceFilePath() const
+{
+    return _imp->traceFilePath;
+}
+
+const QString&
+CLArgs::getBenchmarkReportFilePath() const
+{
+    return _imp->benchmarkReportFilePath;
+}
+
+int
+CLArgs::getBenchmarkRuns() const
+{
+    return _imp->benchmarkRuns;
+}
+
+int
+CLArgs::getRenderProcessesCount() const
+{
+    return _imp->renderProcesses;
+}
+
 bool
 CLArgs::isPythonScript() const
 {
@@ -701,6 +774,99 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("reuse-disk-cache"), QString() );
+        if ( it != args.end() ) {
+            reuseDiskCache = true;
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("trace"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            if ( next != args.end() ) {
+                traceFilePath = *next;
+#ifdef __NATRON_UNIX__
+                traceFilePath = AppManager::qt_tildeExpansion(traceFilePath);
+#endif
+                // The current directory may change before the trace is written
+                traceFilePath = QFileInfo(traceFilePath).absoluteFilePath();
+                it = args.erase(it);
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify the trace file path").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("benchmark"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            if ( next != args.end() ) {
+                benchmarkReportFilePath = *next;
+#ifdef __NATRON_UNIX__
+                benchmarkReportFilePath = AppManager::qt_tildeExpansion(benchmarkReportFilePath);
+#endif
+                benchmarkReportFilePath = QFileInfo(benchmarkReportFilePath).absoluteFilePath();
+                it = args.erase(it);
+                args.erase(it);
+            } else {
+                std::cout << tr("You must specify the benchmark report file path").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("benchmark-runs"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            if ( next != args.end() ) {
+                benchmarkRuns = next->toInt(&ok);
+            }
+            if ( !ok || (benchmarkRuns < 1) ) {
+                std::cout << tr("You must specify a positive number of benchmark runs").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            it = args.erase(it);
+            args.erase(it);
+        }
+    }
+
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("processes"), QString() );
+        if ( it != args.end() ) {
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            if ( next != args.end() ) {
+                renderProcesses = next->toInt(&ok);
+            }
+            if ( !ok || (renderProcesses < 1) ) {
+                std::cout << tr("You must specify a positive number of render processes").toStdString() << std::endl;
+                error = 1;
+
+                return;
+            }
+            it = args.erase(it);
+            args.erase(it);
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8(NATRON_BREAKPAD_PROCESS_PID), QString() );
         if ( it != args.end() ) {
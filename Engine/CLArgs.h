@@ -120,6 +120,19 @@ public:
 
     bool areRenderStatsEnabled() const;
 
+    // True if the DiskCache is restored and shared with other processes in background mode
+    bool isDiskCacheReuseEnabled() const;
+
+    // If not empty, the render pipeline is traced and the trace is written to this file when exiting
+    const QString& getTraceFilePath() const;
+
+    // If not empty, the writers render their frame range getBenchmarkRuns() times and the timings are written to this file
+    const QString& getBenchmarkReportFilePath() const;
+    int getBenchmarkRuns() const;
+
+    // The number of processes rendering parts of the frame range of each writer at the same time
+    int getRenderProcessesCount() const;
+
     const QString& getBreakpadProcessExecutableFilePath() const;
 
     qint64 getBreakpadProcessPID() const;
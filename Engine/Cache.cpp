@@ -25,9 +25,35 @@
 #include "Cache.h"
 
 #include <cassert>
+#include <sstream>
 #include <stdexcept>
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+
 NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// The pid alone does not identify a process: it may be reused by a later process while the journal
+// still references files created by this one
+const qint64 processStartTime = QDateTime::currentMSecsSinceEpoch();
+
+QAtomicInt cacheFilesCounter;
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+std::string
+CacheAPI::generateUniqueFileNameSuffix()
+{
+    std::stringstream ss;
+
+    ss << std::hex << QCoreApplication::applicationPid() << '-' << processStartTime << '-' << (unsigned int)cacheFilesCounter.fetchAndAddRelaxed(1);
+
+    return ss.str();
+}
+
 NATRON_NAMESPACE_EXIT;
 
 NATRON_NAMESPACE_USING;
@@ -32,6 +32,7 @@
 #include <fstream>
 #include <functional>
 #include <list>
+#include <map>
 #include <set>
 #include <cstddef>
 #include <utility>
@@ -48,23 +49,33 @@ GCC_DIAG_OFF(deprecated)
 #include <QtCore/QObject>
 #include <QtCore/QBuffer>
 #include <QtCore/QRunnable>
+#include <QtCore/QAtomicInt>
 GCC_DIAG_ON(deprecated)
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/atomic.hpp>
 #endif
 
 #include "Engine/AppManager.h" //for access to settings
 #include "Engine/Settings.h"
 #include "Engine/CacheEntry.h"
+#include "Engine/CacheJournal.h"
 #include "Engine/LRUHashTable.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/StandardPaths.h"
 #include "Engine/ImageLocker.h"
+#include "Engine/Timer.h"
 #include "Global/MemoryInfo.h"
 #include "Engine/EngineFwd.h"
 
 //Beyond that percentage of occupation, the cache will start evicting LRU entries
 #define NATRON_CACHE_LIMIT_PERCENT 0.9
 
+//Entries evicted from the RAM portion are kept compressed if their data compresses to that fraction of its size or less
+#define NATRON_CACHE_COMPRESSION_MAX_RATIO 0.5
+
 #define NATRON_TILE_CACHE_FILE_SIZE_BYTES 2000000000
 
 ///When defined, number of opened files, memory size and disk size of the cache are printed whenever there's activity.
@@ -374,6 +385,86 @@ Q_SIGNALS:
 };
 
 
+/**
+ * @brief Counters of the compressed portion of a cache, where entries evicted from RAM are kept compressed
+ * instead of being discarded.
+ **/
+struct CacheCompressionStats
+{
+    // Size of the compressed entries, in bytes
+    std::size_t compressedSize;
+
+    // Size the compressed entries would take uncompressed, in bytes
+    std::size_t originalSize;
+
+    // Number of compressed entries
+    std::size_t nEntries;
+
+    // Number of entries evicted from RAM that were compressed
+    U64 nCompressions;
+
+    // Number of entries evicted from RAM that did not compress well enough and were discarded
+    U64 nRejectedCompressions;
+
+    // Number of entries decompressed because they were requested again
+    U64 nDecompressions;
+
+    // Total time spent decompressing entries, in seconds
+    double decompressionTime;
+
+    CacheCompressionStats()
+        : compressedSize(0)
+        , originalSize(0)
+        , nEntries(0)
+        , nCompressions(0)
+        , nRejectedCompressions(0)
+        , nDecompressions(0)
+        , decompressionTime(0.)
+    {
+    }
+};
+
+/**
+ * @brief Counters of the lookups of a cache, to compare eviction policies.
+ **/
+struct CacheAccessStats
+{
+    // Number of lookups that found the entry in RAM
+    U64 memoryHits;
+
+    // Number of lookups that found the entry in the compressed portion
+    U64 compressedHits;
+
+    // Number of lookups that found the entry on disk
+    U64 diskHits;
+
+    // Number of lookups that did not find the entry
+    U64 misses;
+
+    // Number of hash keys of the in-memory portion seen only once recently (2Q policy only)
+    std::size_t probationEntries;
+
+    // Number of hash keys of the in-memory portion protected from scans (all of them with the LRU policy)
+    std::size_t protectedEntries;
+
+    CacheAccessStats()
+        : memoryHits(0)
+        , compressedHits(0)
+        , diskHits(0)
+        , misses(0)
+        , probationEntries(0)
+        , protectedEntries(0)
+    {
+    }
+
+    double getHitRate() const
+    {
+        U64 nHits = memoryHits + compressedHits + diskHits;
+
+        return nHits + misses ? (double)nHits / (nHits + misses) : 0.;
+    }
+};
+
 /*
  * ValueType must be derived of CacheEntryHelper
  */
@@ -391,10 +482,6 @@ public:
     typedef boost::shared_ptr<param_t> ParamsTypePtr;
     typedef boost::shared_ptr<EntryType> EntryTypePtr;
 
-    struct SerializedEntry;
-
-    typedef std::list< SerializedEntry > CacheTOC;
-
 public:
 
 
@@ -432,11 +519,8 @@ public:
 #else // !USE_VARIADIC_TEMPLATES
 
 #ifdef NATRON_CACHE_USE_BOOST
-#ifdef NATRON_CACHE_USE_HASH
-    typedef BoostLRUHashTable<hash_type, EntryTypePtr> CacheContainer;
-#else
-    typedef BoostLRUHashTable<hash_type, EntryTypePtr > CacheContainer;
-#endif
+    // The eviction policy of the in-memory portion can be changed with setEvictionPolicy()
+    typedef Boost2QHashTable<hash_type, EntryTypePtr> CacheContainer;
     typedef typename CacheContainer::container_type::left_iterator CacheIterator;
     typedef typename CacheContainer::container_type::left_const_iterator ConstCacheIterator;
     static std::list<EntryTypePtr> &  getValueFromIterator(CacheIterator it)
@@ -461,23 +545,75 @@ public:
 private:
 
 
-    std::size_t _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
-    std::size_t _maximumCacheSize;     // maximum size allowed for the cache
+    boost::atomic<std::size_t> _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
+    boost::atomic<std::size_t> _maximumCacheSize;     // maximum size allowed for the cache
 
     /*mutable because we need to change modify it in the sealEntryInternal function which
          is called by an external object that have a const ref to the cache.
      */
-    mutable std::size_t _memoryCacheSize;     // current size of the cache in bytes
-    mutable std::size_t _diskCacheSize;
-    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize
-    mutable QMutex _lock; //protects _memoryCache & _diskCache
-    mutable QMutex _getLock;  //prevents get() and getOrCreate() to be called simultaneously
+    /*The sizes are atomic counters so that allocating and freeing entries concurrently
+         does not serialize render threads on a mutex.*/
+    mutable boost::atomic<std::size_t> _memoryCacheSize;     // current size of the cache in bytes
+    mutable boost::atomic<std::size_t> _diskCacheSize;
+
+    // The maximum size of the compressed entries, in % of the in-memory portion. 0 disables compression
+    boost::atomic<int> _maximumCompressedPercent;
+
+    // Counters reported by getCompressionStats()
+    mutable boost::atomic<U64> _nCompressions;
+    mutable boost::atomic<U64> _nRejectedCompressions;
+    mutable boost::atomic<U64> _nDecompressions;
+    mutable boost::atomic<U64> _decompressionTimeUs;
+
+    // Counters reported by getAccessStats()
+    mutable boost::atomic<U64> _nMemoryHits;
+    mutable boost::atomic<U64> _nCompressedHits;
+    mutable boost::atomic<U64> _nDiskHits;
+    mutable boost::atomic<U64> _nMisses;
+
+    /**
+     * @brief A partition of the hash space of the cache. Each shard has its own locks and LRU containers
+     * so that threads looking up entries whose hash fall in different shards do not contend.
+     * All entries sharing the same hash live in the same shard, either in its memory or its disk container.
+     * When several shard locks would be needed, they are always taken one at a time.
+     **/
+    struct CacheShard
+    {
+        mutable QMutex lock; //protects memoryCache, compressedCache & diskCache
+        mutable QMutex getLock;  //prevents get() and getOrCreate() to be called simultaneously for this shard
+
+        /*These are mutable because we need to modify the LRU list even
+             when we call get() and we want this function to be const.*/
+        mutable CacheContainer memoryCache;
+        mutable CacheContainer diskCache;
+
+        // Entries evicted from memoryCache whose data is compressed, they are decompressed when requested again.
+        // Their size is counted in the in-memory portion of the cache.
+        mutable CacheContainer compressedCache;
+
+        // Size of the entries of compressedCache, compressed and uncompressed
+        mutable std::size_t compressedSize;
+        mutable std::size_t compressedOriginalSize;
+
+        CacheShard()
+            : lock()
+            , getLock()
+            , memoryCache()
+            , diskCache()
+            , compressedCache()
+            , compressedSize(0)
+            , compressedOriginalSize(0)
+        {
+        }
+    };
+
+    typedef boost::shared_ptr<CacheShard> CacheShardPtr;
 
+    // Never resized after the constructor, hence no lock is needed to access the vector itself
+    std::vector<CacheShardPtr> _shards;
 
-    /*These 2 are mutable because we need to modify the LRU list even
-         when we call get() and we want this function to be const.*/
-    mutable CacheContainer _memoryCache;
-    mutable CacheContainer _diskCache;
+    // Rotates the first shard visited when evicting so that equally filled shards are evicted in turn
+    mutable QAtomicInt _evictionShardIndex;
     const std::string _cacheName;
     const unsigned int _version;
 
@@ -489,7 +625,12 @@ private:
     std::size_t _maxPhysicalRAM;
     bool _tearingDown;
     mutable DeleterThread<EntryType> _deleterThread;
-    mutable QWaitCondition _memoryFullCondition; //< protected by _sizeLock
+    mutable QMutex _memoryFullMutex; // only used to wait on _memoryFullCondition
+    mutable QWaitCondition _memoryFullCondition; //< protected by _memoryFullMutex
+
+    // Number of threads waiting (or about to wait) on _memoryFullCondition, so that deallocations only lock
+    // _memoryFullMutex when someone must be woken up
+    mutable boost::atomic<int> _nMemoryFullWaiters;
     mutable CacheCleanerThread _cleanerThread;
 
     // If tiled, the cache will consist only of a few large files that each contain tiles of the same size.
@@ -507,31 +648,69 @@ private:
     // When set these are used for fast search of a free tile
     boost::weak_ptr<TileCacheFile> _nextAvailableCacheFile;
     int _nextAvailableCacheFileIndex;
+
+    // Serializes the key and params of an entry in a record of the journal. It is set when opening the journal
+    // so that this header does not depend on the serialization code, see CacheSerialization.h
+    typedef std::string (Cache::*JournalPayloadSerializer)(const EntryTypePtr& entry) const;
+    typedef std::map<const EntryType*, boost::weak_ptr<EntryType> > JournalPendingMap;
+
+    // Held by syncJournal() and while opening or closing the journal
+    mutable QMutex _journalSyncMutex;
+
+    // Protects the members below
+    mutable QMutex _journalMutex;
+
+    // The journal of the entries stored on disk, only opened for caches persisting across sessions
+    boost::scoped_ptr<CacheJournal> _journal;
+    JournalPayloadSerializer _journalPayloadSerializer;
+
+    // Entries stored on disk that are not journaled yet because they may still be written to
+    mutable JournalPendingMap _journalPending;
+
+    // Entries removed from the cache while syncJournal() is serializing pending entries
+    mutable std::set<const EntryType*> _journalCancelled;
+    mutable bool _journalSyncing;
+
+    // True while the journal is opened, so that caches without journal do not lock _journalMutex
+    boost::atomic<bool> _journalOpened;
 public:
 
 
+    /**
+     * @param nShards The number of independently locked partitions of the cache. With more than 1 shard
+     * the LRU order is only maintained per shard. A value <= 0 creates one shard per hardware thread.
+     **/
     Cache(const std::string & cacheName,
           unsigned int version,
           U64 maximumCacheSize,      // total size
-          double maximumInMemoryPercentage //how much should live in RAM
+          double maximumInMemoryPercentage, //how much should live in RAM
+          int nShards = 1
           )
         : CacheAPI()
-        , _maximumInMemorySize(maximumCacheSize * maximumInMemoryPercentage)
+        , _maximumInMemorySize( (std::size_t)(maximumCacheSize * maximumInMemoryPercentage) )
         , _maximumCacheSize(maximumCacheSize)
         , _memoryCacheSize(0)
         , _diskCacheSize(0)
-        , _sizeLock()
-        , _lock()
-        , _getLock()
-        , _memoryCache()
-        , _diskCache()
+        , _maximumCompressedPercent(0)
+        , _nCompressions(0)
+        , _nRejectedCompressions(0)
+        , _nDecompressions(0)
+        , _decompressionTimeUs(0)
+        , _nMemoryHits(0)
+        , _nCompressedHits(0)
+        , _nDiskHits(0)
+        , _nMisses(0)
+        , _shards()
+        , _evictionShardIndex(0)
         , _cacheName(cacheName)
         , _version(version)
         , _signalEmitter(new CacheSignalEmitter)
         , _maxPhysicalRAM( getSystemTotalRAM() )
         , _tearingDown(false)
         , _deleterThread(this)
+        , _memoryFullMutex()
         , _memoryFullCondition()
+        , _nMemoryFullWaiters(0)
         , _cleanerThread(this)
         , _tileCacheMutex()
         , _isTiled(false)
@@ -540,16 +719,39 @@ public:
         , _cacheFiles()
         , _nextAvailableCacheFile()
         , _nextAvailableCacheFileIndex(-1)
-    {
+        , _journalSyncMutex()
+        , _journalMutex()
+        , _journal()
+        , _journalPayloadSerializer(0)
+        , _journalPending()
+        , _journalCancelled()
+        , _journalSyncing(false)
+        , _journalOpened(false)
+    {
+        if (nShards <= 0) {
+            nShards = std::max(1, QThread::idealThreadCount());
+        }
+        _shards.resize(nShards);
+        for (int i = 0; i < nShards; ++i) {
+            _shards[i].reset(new CacheShard);
+        }
     }
 
     virtual ~Cache()
     {
-        QMutexLocker locker(&_lock);
-
+        closeJournal();
         _tearingDown = true;
-        _memoryCache.clear();
-        _diskCache.clear();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            QMutexLocker locker(&_shards[i]->lock);
+            _shards[i]->memoryCache.clear();
+            _shards[i]->compressedCache.clear();
+            _shards[i]->diskCache.clear();
+        }
+    }
+
+    int getShardsCount() const
+    {
+        return (int)_shards.size();
     }
 
     virtual bool isTileCache() const OVERRIDE FINAL
@@ -597,13 +799,25 @@ public:
     bool get(const typename EntryType::key_type & key,
              std::list<EntryTypePtr>* returnValue) const
     {
-        ///Be atomic, so it cannot be created by another thread in the meantime
-        QMutexLocker getlocker(&_getLock);
+        RenderTraceScope traceScope("cache", "get", _cacheName);
+        CacheShard& shard = getShard( key.getHash() );
+        std::list<EntryTypePtr> entriesToCompress;
+        bool ret;
+        {
+            ///Be atomic, so it cannot be created by another thread in the meantime
+            QMutexLocker getlocker(&shard.getLock);
 
-        ///lock the cache before reading it.
-        QMutexLocker locker(&_lock);
+            ///This locks the cache only to take the entries out of the compressed portion and put them back
+            bool decompressed = decompressEntries(shard, key);
 
-        return getInternal(key, returnValue);
+            ///lock the cache before reading it.
+            QMutexLocker locker(&shard.lock);
+
+            ret = getInternal(shard, key, decompressed, returnValue, &entriesToCompress);
+        }
+        compressEvictedEntries(entriesToCompress);
+
+        return ret;
     } // get
 
 private:
@@ -728,6 +942,9 @@ private:
              **/
     virtual void freeTile(const TileCacheFilePtr& file, std::size_t dataOffset) OVERRIDE FINAL
     {
+        // The removal of the entry that used the tile must be written before the tile is handed to another entry
+        flushJournal();
+
         QMutexLocker k(&_tileCacheMutex);
 
         assert(_isTiled);
@@ -771,7 +988,7 @@ private:
                         ImageLockerHelper<EntryType>* entryLocker,
                         EntryTypePtr* returnValue) const
     {
-        //_lock must not be taken here
+        //No shard lock must be taken here, only the getLock of the shard of the key
 
         ///Before allocating the memory check that there's enough space to fit in memory
         appPTR->checkCacheFreeMemoryIsGoodEnough();
@@ -790,37 +1007,28 @@ private:
             ++safeCounter;
         }
 
-        U64 memoryCacheSize, maximumInMemorySize;
+        U64 memoryCacheSize = _memoryCacheSize.load();
+        U64 maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize.load() );
         {
-            QMutexLocker k(&_sizeLock);
-            memoryCacheSize = _memoryCacheSize;
-            maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-        }
-        {
-            QMutexLocker locker(&_lock);
             std::list<EntryTypePtr> entriesToBeDeleted;
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             ///While the current cache size can't fit the new entry, erase the last recently used entries.
             ///Also if the total free RAM is under the limit of the system free RAM to keep free, erase LRU entries.
             while (occupationPercentage > NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
+                if ( !tryEvictFromAnyShard(true, deleted) ) {
                     break;
                 }
 
-                //Refresh now memory cache size && maximum in memory size as they might have been changed
-                //in tryEvictEntry
-                {
-                    QMutexLocker k(&_sizeLock);
-                    memoryCacheSize = _memoryCacheSize;
-                    maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-                }
-
-
                 for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
                     entriesToBeDeleted.push_back(*it);
                 }
 
+                //Refresh now memory cache size && maximum in memory size as they might have been changed
+                //in tryEvictEntry. Evicted entries may also have been compressed rather than deleted.
+                memoryCacheSize = getMemoryCacheSizeAfterDeletion(entriesToBeDeleted);
+                maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize.load() );
+
                 occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             }
 
@@ -833,33 +1041,30 @@ private:
                 entriesToBeDeleted.clear();
             }
         }
-        {
-            //If _maximumcacheSize == 0 we don't return 1 otherwise we would cause a deadlock
-            QMutexLocker k(&_sizeLock);
-            double occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+        if ( getMemoryOccupation() >= 1. ) {
+            QMutexLocker k(&_memoryFullMutex);
+
+            // Register before reading the sizes again: notifyMemoryDeallocated() decrements the sizes before
+            // checking for waiters, so either we see the new sizes or it sees us and wakes us up.
+            ++_nMemoryFullWaiters;
 
             //_memoryCacheSize member will get updated while images are being destroyed by the parallel thread.
             //we wait for cache memory occupation to be < 100% to be sure we don't hit swap here
-            while ( occupationPercentage >= 1. && _deleterThread.isWorking() ) {
-                _memoryFullCondition.wait(&_sizeLock);
-                occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+            while ( getMemoryOccupation() >= 1. && _deleterThread.isWorking() ) {
+                _memoryFullCondition.wait(&_memoryFullMutex);
             }
+            --_nMemoryFullWaiters;
         }
         if (_isTiled) {
 
-            QMutexLocker locker(&_lock);
             // For tiled caches, we insert directly into the disk cache, so make sure there is room for it
             std::list<EntryTypePtr> entriesToBeDeleted;
-            U64 diskCacheSize, maximumDiskCacheSize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
-            }
+            U64 diskCacheSize = _diskCacheSize.load();
+            U64 maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize.load() - _maximumInMemorySize.load() );
             double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
             while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
+                if ( !tryEvictFromAnyShard(false, deleted) ) {
                     break;
                 }
 
@@ -880,7 +1085,8 @@ private:
 
         }
         {
-            QMutexLocker locker(&_lock);
+            CacheShard& shard = getShard( key.getHash() );
+            QMutexLocker locker(&shard.lock);
 
             try {
                 returnValue->reset( new EntryType(key, params, this ) );
@@ -899,9 +1105,16 @@ private:
                 if (entryLocker) {
                     entryLocker->lock(*returnValue);
                 }
-                sealEntry(*returnValue, _isTiled ? false : true);
+                sealEntry(shard, *returnValue, _isTiled ? false : true);
+                if (_isTiled) {
+                    // Journaled once the tile is allocated and rendered, see syncJournal()
+                    journalAddEntry(*returnValue);
+                }
             }
         }
+
+        // Journal the entries that were stored on disk since the last call. Do not wait for another thread doing it.
+        syncJournal(false);
     } // createInternal
 
 public:
@@ -909,16 +1122,22 @@ public:
     void swapOrInsert(const EntryTypePtr& entryToBeEvicted,
                       const EntryTypePtr& newEntry)
     {
-        QMutexLocker locker(&_lock);
-
         const typename EntryType::key_type& key = entryToBeEvicted->getKey();
         typename EntryType::hash_type hash = entryToBeEvicted->getHashKey();
+        CacheShard& shard = getShard(hash);
+
+        // The new entry must have the same hash, otherwise it could not be inserted in the same shard
+        assert(newEntry->getHashKey() == hash);
+
+        QMutexLocker locker(&shard.lock);
+
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache(hash);
-        if ( memoryCached != _memoryCache.end() ) {
+        CacheIterator memoryCached = shard.memoryCache(hash);
+        if ( memoryCached != shard.memoryCache.end() ) {
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
             for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( ( (*it)->getKey() == key ) && ( (*it)->getParams() == entryToBeEvicted->getParams() ) ) {
+                    journalRemoveEntry(*it);
                     ret.erase(it);
                     break;
                 }
@@ -927,19 +1146,20 @@ public:
             ret.push_back(newEntry);
         } else {
             ///Look in disk cache
-            CacheIterator diskCached = _diskCache(hash);
-            if ( diskCached != _diskCache.end() ) {
+            CacheIterator diskCached = shard.diskCache(hash);
+            if ( diskCached != shard.diskCache.end() ) {
                 ///Remove the old entry
                 std::list<EntryTypePtr> & ret = getValueFromIterator(diskCached);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( ( (*it)->getKey() == key ) && ( (*it)->getParams() == entryToBeEvicted->getParams() ) ) {
+                        journalRemoveEntry(*it);
                         ret.erase(it);
                         break;
                     }
                 }
             }
             ///Insert in mem cache
-            _memoryCache.insert(hash, newEntry);
+            shard.memoryCache.insert(hash, newEntry);
         }
     }
 
@@ -979,14 +1199,20 @@ public:
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
 
         {
+            RenderTraceScope traceScope("cache", "getOrCreate", _cacheName);
+            CacheShard& shard = getShard( key.getHash() );
+
             ///Be atomic, so it cannot be created by another thread in the meantime
-            QMutexLocker getlocker(&_getLock);
+            QMutexLocker getlocker(&shard.getLock);
             std::list<EntryTypePtr> entries;
+            std::list<EntryTypePtr> entriesToCompress;
             bool didGetSucceed;
             {
-                QMutexLocker locker(&_lock);
-                didGetSucceed = getInternal(key, &entries);
+                bool decompressed = decompressEntries(shard, key);
+                QMutexLocker locker(&shard.lock);
+                didGetSucceed = getInternal(shard, key, decompressed, &entries, &entriesToCompress);
             }
+            compressEvictedEntries(entriesToCompress);
             if (didGetSucceed) {
                 for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
                     if (*(*it)->getParams() == *params) {
@@ -1019,13 +1245,18 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
-                evictedFromMemory.second->removeAnyBackingFile();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                journalRemoveEntry(evictedFromMemory.second);
+                if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
+                    evictedFromMemory.second->removeAnyBackingFile();
+                }
+                evictedFromMemory = shard.memoryCache.evict();
             }
-            evictedFromMemory = _memoryCache.evict();
+            clearCompressedPortion(shard);
         }
 
         if (_signalEmitter) {
@@ -1049,19 +1280,23 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-
-        /// An entry which has a use_count greater than 1 is not removable:
-        /// The backing file must not be removed because it might be read/written to
-        /// at the same time. The best we can do is just let it here in the cache.
-        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        while (evictedFromDisk.second) {
-            if (!_isTiled) {
-                evictedFromDisk.second->removeAnyBackingFile();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+
+            /// An entry which has a use_count greater than 1 is not removable:
+            /// The backing file must not be removed because it might be read/written to
+            /// at the same time. The best we can do is just let it here in the cache.
+            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            while (evictedFromDisk.second) {
+                journalRemoveEntry(evictedFromDisk.second);
+                if (!_isTiled) {
+                    evictedFromDisk.second->removeAnyBackingFile();
+                }
+                evictedFromDisk = shard.diskCache.evict();
             }
-            evictedFromDisk = _diskCache.evict();
         }
 
 
@@ -1078,51 +1313,52 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            // Move back the entry on disk if it can be store on disk
-            // For tiled caches, the tile is sharing the same file with other entries
-            // so we cannot close it, just remove the entry
-            if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
-                evictedFromMemory.second->deallocate();
-                /*insert it back into the disk portion */
-
-                U64 diskCacheSize, maximumCacheSize;
-                {
-                    QMutexLocker k(&_sizeLock);
-                    diskCacheSize = _diskCacheSize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
-
-                /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-                while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
-                    {
-                        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-                        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-                        //we'll let the user of these entries purge the extra entries left in the cache later on
-                        if (!evictedFromDisk.second) {
-                            break;
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                // Move back the entry on disk if it can be store on disk
+                // For tiled caches, the tile is sharing the same file with other entries
+                // so we cannot close it, just remove the entry
+                if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
+                    evictedFromMemory.second->deallocate();
+                    /*insert it back into the disk portion */
+
+                    U64 diskCacheSize = _diskCacheSize.load();
+                    U64 maximumCacheSize = _maximumCacheSize.load();
+
+                    /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
+                    while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
+                        {
+                            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+                            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+                            //we'll let the user of these entries purge the extra entries left in the cache later on
+                            if (!evictedFromDisk.second) {
+                                break;
+                            }
+                            ///Erase the file from the disk if we reach the limit.
+                            journalRemoveEntry(evictedFromDisk.second);
+                            evictedFromDisk.second->removeAnyBackingFile();
                         }
-                        ///Erase the file from the disk if we reach the limit.
-                        evictedFromDisk.second->removeAnyBackingFile();
+                        diskCacheSize = _diskCacheSize.load();
+                        maximumCacheSize = _maximumCacheSize.load();
                     }
-                    {
-                        QMutexLocker k(&_sizeLock);
-                        diskCacheSize = _diskCacheSize;
-                        maximumCacheSize = _maximumCacheSize;
+
+                    /*update the disk cache size*/
+                    CacheIterator existingDiskCacheEntry = shard.diskCache( evictedFromMemory.second->getHashKey() );
+                    /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
+                    if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                        shard.diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
+                        journalAddEntry(evictedFromMemory.second);
                     }
                 }
 
-                /*update the disk cache size*/
-                CacheIterator existingDiskCacheEntry = _diskCache( evictedFromMemory.second->getHashKey() );
-                /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-                if ( existingDiskCacheEntry == _diskCache.end() ) {
-                    _diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
-                }
+                evictedFromMemory = shard.memoryCache.evict();
             }
 
-            evictedFromMemory = _memoryCache.evict();
+            // Compressed entries are never stored on disk
+            clearCompressedPortion(shard);
         }
 
         _signalEmitter->blockSignals(false);
@@ -1138,39 +1374,28 @@ public:
         std::list<EntryTypePtr> entriesToBeDeleted;
 
         {
-            QMutexLocker locker(&_lock);
-            U64 memoryCacheSize, maximumInMemorySize;
-            {
-                QMutexLocker k(&_sizeLock);
-                memoryCacheSize = _memoryCacheSize;
-                maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-            }
+            U64 memoryCacheSize = _memoryCacheSize.load();
+            U64 maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize.load() );
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             while (occupationPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
+                if ( !tryEvictFromAnyShard(true, deleted) ) {
                     break;
                 }
 
                 for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    if ( !(*it)->isStoredOnDisk() ) {
-                        memoryCacheSize -= (*it)->size();
-                    }
                     entriesToBeDeleted.push_back(*it);
                 }
+                memoryCacheSize = getMemoryCacheSizeAfterDeletion(entriesToBeDeleted);
                 occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             }
 
-            U64 diskCacheSize, maximumDiskCacheSize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
-            }
+            U64 diskCacheSize = _diskCacheSize.load();
+            U64 maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize.load() - _maximumInMemorySize.load() );
             double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
             while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
+                if ( !tryEvictFromAnyShard(false, deleted) ) {
                     break;
                 }
 
@@ -1192,15 +1417,22 @@ public:
      **/
     void getCopy(std::list<EntryTypePtr>* copy) const
     {
-        QMutexLocker locker(&_lock);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
 
-        for (CacheIterator it = _memoryCache.begin(); it != _memoryCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
-        }
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
+            for (CacheIterator it = shard.memoryCache.begin(); it != shard.memoryCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
+            for (CacheIterator it = shard.compressedCache.begin(); it != shard.compressedCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
+            for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
         }
     }
 
@@ -1214,13 +1446,8 @@ public:
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
         std::list<EntryTypePtr> entriesToBeDeleted;
-        bool ret;
-        {
-            QMutexLocker locker(&_lock);
-            ret = tryEvictInMemoryEntry(entriesToBeDeleted);
-        }
 
-        return ret;
+        return tryEvictFromAnyShard(true, entriesToBeDeleted);
     }
 
     /**
@@ -1230,10 +1457,9 @@ public:
      **/
     bool evictLRUDiskEntry() const
     {
-
-        QMutexLocker locker(&_lock);
         std::list<EntryTypePtr> entriesToBeDeleted;
-        return tryEvictDiskEntry(entriesToBeDeleted);
+
+        return tryEvictFromAnyShard(false, entriesToBeDeleted);
     }
 
     /**
@@ -1243,22 +1469,17 @@ public:
     virtual void notifyEntrySizeChanged(std::size_t oldSize,
                                         std::size_t newSize) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache
-        QMutexLocker k(&_sizeLock);
-
         ///This function can only be called for RAM buffers or while a memory mapped file is mapped into the RAM, so
         ///we just have to modify the RAM size.
 
         ///Avoid overflows, _memoryCacheSize may not always fallback to 0
-        qint64 diff = (qint64)newSize - (qint64)oldSize;
-
-        if (diff < 0) {
-            _memoryCacheSize = diff > (qint64)_memoryCacheSize ? 0 : _memoryCacheSize + diff;
+        if (newSize < oldSize) {
+            subtractClamped(_memoryCacheSize, oldSize - newSize);
         } else {
-            _memoryCacheSize += diff;
+            _memoryCacheSize.fetch_add(newSize - oldSize);
         }
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
     }
 
@@ -1269,27 +1490,23 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache, hence the
-        ///lock should already be taken.
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeDisk) {
             if (_isTiled) {
                 // For tile caches, we do not control which portion of the cache is in memory, so just keep track of the disk portion
-                _diskCacheSize += size;
+                _diskCacheSize.fetch_add(size);
             } else {
-                _memoryCacheSize += size;
+                _memoryCacheSize.fetch_add(size);
                 appPTR->increaseNCacheFilesOpened();
             }
         } else {
-            _memoryCacheSize += size;
+            _memoryCacheSize.fetch_add(size);
         }
 
         _signalEmitter->emitAddedEntry(time);
 
 
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
     }
 
@@ -1300,17 +1517,15 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
+            subtractClamped(_memoryCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
         } else if (storage == eStorageModeDisk) {
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            subtractClamped(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
         }
 
@@ -1320,7 +1535,12 @@ public:
 
     virtual void notifyMemoryDeallocated() const OVERRIDE FINAL
     {
-        QMutexLocker k(&_sizeLock);
+        // The size counters were decremented before this call. Threads waiting in createInternal() register
+        // themselves before reading them, so if no thread is registered here, any later waiter will see the new sizes.
+        if (_nMemoryFullWaiters.load() == 0) {
+            return;
+        }
+        QMutexLocker k(&_memoryFullMutex);
 
         _memoryFullCondition.wakeAll();
     }
@@ -1339,33 +1559,32 @@ public:
         if (_tearingDown) {
             return;
         }
-        QMutexLocker k(&_sizeLock);
 
         assert(oldStorage != newStorage);
         assert(newStorage != eStorageModeNone);
         if (oldStorage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
-            _diskCacheSize += size;
+            subtractClamped(_memoryCacheSize, size);
+            _diskCacheSize.fetch_add(size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
             ///We switched from RAM to DISK that means the MemoryFile object has been destroyed hence the file has been closed.
             appPTR->decreaseNCacheFilesOpened();
         } else if (oldStorage == eStorageModeDisk) {
-            _memoryCacheSize += size;
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            _memoryCacheSize.fetch_add(size);
+            subtractClamped(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
             ///We switched from DISK to RAM that means the MemoryFile object has been created and the file opened
             appPTR->increaseNCacheFilesOpened();
         } else {
             if (newStorage == eStorageModeRAM) {
-                _memoryCacheSize += size;
+                _memoryCacheSize.fetch_add(size);
             } else if (newStorage == eStorageModeDisk) {
-                _diskCacheSize += size;
+                _diskCacheSize.fetch_add(size);
             }
         }
 
@@ -1404,56 +1623,111 @@ public:
         return cacheFolderName;
     }
 
-    std::string getRestoreFilePath() const
+    std::string getJournalFilePath() const
     {
         QString newCachePath( getCachePath() );
         Global::ensureLastPathSeparator(newCachePath);
 
-        newCachePath.append( QString::fromUtf8("restoreFile." NATRON_CACHE_FILE_EXT) );
+        newCachePath.append( QString::fromUtf8(NATRON_CACHE_JOURNAL_FILE_NAME) );
 
         return newCachePath.toStdString();
     }
 
     void setMaximumCacheSize(U64 newSize)
     {
-        QMutexLocker k(&_sizeLock);
-
-        _maximumCacheSize = newSize;
+        _maximumCacheSize.store(newSize);
     }
 
     void setMaximumInMemorySize(double percentage)
     {
-        QMutexLocker k(&_sizeLock);
-
-        _maximumInMemorySize = _maximumCacheSize * percentage;
+        _maximumInMemorySize.store( (std::size_t)(_maximumCacheSize.load() * percentage) );
     }
 
     std::size_t getMaximumSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _maximumCacheSize;
+        return _maximumCacheSize.load();
     }
 
     std::size_t getMaximumMemorySize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _maximumInMemorySize;
+        return _maximumInMemorySize.load();
     }
 
     std::size_t getMemoryCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _memoryCacheSize;
+        return _memoryCacheSize.load();
     }
 
     std::size_t getDiskCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
+        return _diskCacheSize.load();
+    }
+
+    /**
+     * @brief Sets the maximum size of the compressed entries, in % of the in-memory portion of the cache.
+     * Entries evicted from RAM are discarded (or moved to the disk portion) without being compressed if it is 0.
+     **/
+    void setMaximumCompressedPercentage(int percent)
+    {
+        _maximumCompressedPercent.store(percent);
+    }
 
-        return _diskCacheSize;
+    std::size_t getMaximumCompressedSize() const
+    {
+        return (std::size_t)( (double)_maximumInMemorySize.load() * _maximumCompressedPercent.load() / 100. );
+    }
+
+    CacheCompressionStats getCompressionStats() const
+    {
+        CacheCompressionStats ret;
+
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            ret.compressedSize += shard.compressedSize;
+            ret.originalSize += shard.compressedOriginalSize;
+            for (CacheIterator it = shard.compressedCache.begin(); it != shard.compressedCache.end(); ++it) {
+                ret.nEntries += getValueFromIterator(it).size();
+            }
+        }
+        ret.nCompressions = _nCompressions.load();
+        ret.nRejectedCompressions = _nRejectedCompressions.load();
+        ret.nDecompressions = _nDecompressions.load();
+        ret.decompressionTime = _decompressionTimeUs.load() / 1000000.;
+
+        return ret;
+    }
+
+    /**
+     * @brief Sets how entries are picked when the in-memory portion of the cache is full.
+     * The entries currently in memory are kept.
+     **/
+    void setEvictionPolicy(CacheEvictionPolicyEnum policy)
+    {
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            shard.memoryCache.setEvictionPolicy(policy);
+        }
+    }
+
+    CacheAccessStats getAccessStats() const
+    {
+        CacheAccessStats ret;
+
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::size_t nProbation = shard.memoryCache.getProbationSize();
+            ret.probationEntries += nProbation;
+            ret.protectedEntries += shard.memoryCache.size() - nProbation;
+        }
+        ret.memoryHits = _nMemoryHits.load();
+        ret.compressedHits = _nCompressedHits.load();
+        ret.diskHits = _nDiskHits.load();
+        ret.misses = _nMisses.load();
+
+        return ret;
     }
 
     boost::shared_ptr<CacheSignalEmitter> activateSignalEmitter() const
@@ -1473,37 +1747,56 @@ public:
         std::list<EntryTypePtr> toRemove;
 
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( entry->getHashKey() );
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShard( entry->getHashKey() );
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( entry->getHashKey() );
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( (*it)->getKey() == entry->getKey() ) {
+                        journalRemoveEntry(*it);
                         toRemove.push_back(*it);
                         ret.erase(it);
                         break;
                     }
                 }
                 if ( ret.empty() ) {
-                    _memoryCache.erase(existingEntry);
+                    shard.memoryCache.erase(existingEntry);
                 }
             } else {
-                existingEntry = _diskCache( entry->getHashKey() );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( entry->getHashKey() );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         if ( (*it)->getKey() == entry->getKey() ) {
+                            journalRemoveEntry(*it);
                             toRemove.push_back(*it);
                             ret.erase(it);
                             break;
                         }
                     }
                     if ( ret.empty() ) {
-                        _diskCache.erase(existingEntry);
+                        shard.diskCache.erase(existingEntry);
+                    }
+                } else {
+                    existingEntry = shard.compressedCache( entry->getHashKey() );
+                    if ( existingEntry != shard.compressedCache.end() ) {
+                        std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
+                        for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                            if ( (*it)->getKey() == entry->getKey() ) {
+                                onEntryLeftCompressedPortion(shard, *it);
+                                toRemove.push_back(*it);
+                                ret.erase(it);
+                                break;
+                            }
+                        }
+                        if ( ret.empty() ) {
+                            shard.compressedCache.erase(existingEntry);
+                        }
                     }
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
 
@@ -1517,25 +1810,37 @@ public:
     {
         std::list<EntryTypePtr> toRemove;
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( hash);
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShard(hash);
+            QMutexLocker l(&shard.lock);
+            CacheIterator compressedEntry = shard.compressedCache(hash);
+            if ( compressedEntry != shard.compressedCache.end() ) {
+                std::list<EntryTypePtr> & ret = getValueFromIterator(compressedEntry);
+                for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                    onEntryLeftCompressedPortion(shard, *it);
+                    toRemove.push_back(*it);
+                }
+                shard.compressedCache.erase(compressedEntry);
+            }
+            CacheIterator existingEntry = shard.memoryCache( hash);
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                    journalRemoveEntry(*it);
                     toRemove.push_back(*it);
                 }
-                _memoryCache.erase(existingEntry);
+                shard.memoryCache.erase(existingEntry);
             } else {
-                existingEntry = _diskCache( hash );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( hash );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                        journalRemoveEntry(*it);
                         toRemove.push_back(*it);
                     }
-                    _diskCache.erase(existingEntry);
+                    shard.diskCache.erase(existingEntry);
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
 
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
@@ -1546,13 +1851,113 @@ public:
         }
     }
 
-    /*Saves cache to disk as a settings file.
-     */
-    void save(CacheTOC* tableOfContents);
+    /**
+     * @brief Restores the entries listed in the journal of the cache and starts journaling the entries stored on disk.
+     * Returns false if there is no journal or if it was written by another version of the cache, in which case
+     * nothing is restored and the journal is not opened.
+     * The journal may be shared with other processes using the same cache, which also restored it.
+     **/
+    bool restoreFromJournal();
+
+    /**
+     * @brief Starts journaling the entries stored on disk in a new journal, replacing any existing one.
+     **/
+    bool openJournal();
+
+    /**
+     * @brief Journals the pending entries and closes the journal. The entries stored on disk are not journaled anymore.
+     **/
+    void closeJournal()
+    {
+        syncJournal(true);
 
+        QMutexLocker k(&_journalSyncMutex);
+        QMutexLocker l(&_journalMutex);
+        _journalOpened = false;
+        if (_journal) {
+            _journal->close();
+            _journal.reset();
+        }
+        _journalPending.clear();
+    }
+
+    /**
+     * @brief Appends to the journal the entries stored on disk since the last call whose data was written, that is
+     * the ones not used anywhere else than in the cache. Entries still in use are journaled by a later call.
+     * If blocking is false and another thread is already doing it, this returns immediately.
+     **/
+    void syncJournal(bool blocking = true) const
+    {
+        if ( !_journalOpened.load() ) {
+            return;
+        }
+        if (blocking) {
+            _journalSyncMutex.lock();
+        } else if ( !_journalSyncMutex.tryLock() ) {
+            return;
+        }
 
-    /*Restores the cache from disk.*/
-    void restore(const CacheTOC & tableOfContents);
+        JournalPendingMap pending;
+        {
+            QMutexLocker l(&_journalMutex);
+            if (!_journal) {
+                _journalSyncMutex.unlock();
+
+                return;
+            }
+            pending.swap(_journalPending);
+            _journalSyncing = true;
+        }
+
+        // Entries are serialized without holding _journalMutex, which is taken under the shard locks
+        std::list<std::pair<EntryTypePtr, CacheJournal::Record> > records;
+        JournalPendingMap notReady;
+        for (typename JournalPendingMap::iterator it = pending.begin(); it != pending.end(); ++it) {
+            EntryTypePtr entry = it->second.lock();
+            if (!entry) {
+                continue;
+            }
+            // The cache holds a reference and so do we: any other reference may still be writing to the entry
+            if ( (entry.use_count() > 2) || !entry->isStoredOnDisk() || entry->getFilePath().empty() ) {
+                notReady.insert(*it);
+                continue;
+            }
+            CacheJournal::Record record;
+            record.hash = entry->getHashKey();
+            record.filePath = entry->getFilePath();
+            record.dataOffset = entry->getOffsetInFile();
+            record.dataSize = entry->dataSize();
+            try {
+                record.payload = (this->*_journalPayloadSerializer)(entry);
+            } catch (const std::exception & e) {
+                qDebug() << "Failed to serialize cache entry:" << e.what();
+                continue;
+            }
+            entry->syncBackingFile();
+            records.push_back( std::make_pair(entry, record) );
+        }
+
+        {
+            QMutexLocker l(&_journalMutex);
+            for (typename std::list<std::pair<EntryTypePtr, CacheJournal::Record> >::iterator it = records.begin(); it != records.end(); ++it) {
+                if ( _journalCancelled.find( it->first.get() ) == _journalCancelled.end() ) {
+                    _journal->appendAdd(it->second);
+                }
+            }
+            for (typename JournalPendingMap::iterator it = notReady.begin(); it != notReady.end(); ++it) {
+                if ( _journalCancelled.find(it->first) == _journalCancelled.end() ) {
+                    _journalPending.insert(*it);
+                }
+            }
+            _journalCancelled.clear();
+            _journalSyncing = false;
+        }
+
+        // Also writes the removals recorded since the last call.
+        // The journal cannot be closed while _journalSyncMutex is held.
+        _journal->flush();
+        _journalSyncMutex.unlock();
+    } // syncJournal
 
 
     void removeAllEntriesWithDifferentNodeHashForHolderPublic(const CacheEntryHolder* holder,
@@ -1579,29 +1984,41 @@ public:
         *diskOccupied = 0;
 
         std::string holderID = holder->getCacheID();
-        QMutexLocker locker(&_lock);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
 
-        for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                if (front->getKey().getCacheHolderID() == holderID) {
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *ramOccupied += (*it)->size();
+                        }
+                    }
+                }
+            }
+
+            for (CacheIterator memIt = shard.compressedCache.begin(); memIt != shard.compressedCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() && (entries.front()->getKey().getCacheHolderID() == holderID) ) {
                     for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
                         *ramOccupied += (*it)->size();
                     }
                 }
             }
-        }
 
-        for (CacheIterator memIt = _diskCache.begin(); memIt != _diskCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+            for (CacheIterator memIt = shard.diskCache.begin(); memIt != shard.diskCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *diskOccupied += (*it)->size();
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *diskOccupied += (*it)->size();
+                        }
                     }
                 }
             }
@@ -1610,52 +2027,128 @@ public:
 
 private:
 
+    /**
+     * @brief Restores the entries of the given journal records in the disk portion of the cache.
+     * Records that could not be restored are removed from the list. If removeUnusedFiles is true, the files of
+     * the cache that are not referenced by any record are removed as well.
+     **/
+    void restore(std::vector<CacheJournal::Record>* records, bool removeUnusedFiles);
+
+    // Takes ownership of journal
+    bool startJournal(CacheJournal* journal, const std::vector<CacheJournal::Record>& records);
+
+    std::string serializeJournalPayload(const EntryTypePtr& entry) const;
+
+    /**
+     * @brief Marks the given entry, which was just moved to the disk portion, to be journaled by the next call to syncJournal().
+     **/
+    void journalAddEntry(const EntryTypePtr& entry) const
+    {
+        if ( !_journalOpened.load() ) {
+            return;
+        }
+        QMutexLocker l(&_journalMutex);
+        if (_journal) {
+            _journalPending[entry.get()] = entry;
+        }
+    }
+
+    /**
+     * @brief Records in the journal that the entry is removed from the cache.
+     * This must be called before its backing file is removed.
+     **/
+    /**
+     * @brief Writes the records of the journal that are still buffered, in particular the removals. This waits for
+     * the journal lock, unlike syncJournal(false) which gives up if another thread is syncing.
+     * Called before a tile is made available again: otherwise the tile could be overwritten by another entry while
+     * the journal file still lists the removed entry at its location, and a restore after a crash would give it
+     * the data of the other entry. The files of non tiled caches are never reused, see generateUniqueFileNameSuffix().
+     **/
+    void flushJournal() const
+    {
+        if ( !_journalOpened.load() ) {
+            return;
+        }
+        // Not _journalSyncMutex: syncJournal() may release the last reference to an entry, hence free its tile, while holding it
+        QMutexLocker l(&_journalMutex);
+        if (_journal) {
+            _journal->flush();
+        }
+    }
+
+    void journalRemoveEntry(const EntryTypePtr& entry) const
+    {
+        if ( !_journalOpened.load() ) {
+            return;
+        }
+        QMutexLocker l(&_journalMutex);
+        if (!_journal) {
+            return;
+        }
+        _journalPending.erase( entry.get() );
+        if (_journalSyncing) {
+            _journalCancelled.insert( entry.get() );
+        }
+        if ( entry->isStoredOnDisk() && !entry->getFilePath().empty() ) {
+            _journal->appendRemove( entry->getHashKey(), entry->getFilePath(), entry->getOffsetInFile() );
+        }
+    }
+
     virtual void removeAllEntriesWithDifferentNodeHashForHolderPrivate(const std::string & holderID,
                                                                        U64 nodeHash,
                                                                        bool removeAll) OVERRIDE FINAL
     {
         std::list<EntryTypePtr> toDelete;
-        CacheContainer newMemCache, newDiskCache;
-        {
-            QMutexLocker locker(&_lock);
-
-            for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-                if ( !entries.empty() ) {
-                    const EntryTypePtr & front = entries.front();
-
-                    if ( (front->getKey().getCacheHolderID() == holderID) &&
-                         ( ( front->getKey().getTreeVersion() != nodeHash) || removeAll ) ) {
-                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                            toDelete.push_back(*it);
-                        }
-                    } else {
-                        typename EntryType::hash_type hash = front->getHashKey();
-                        newMemCache.insert(hash, entries);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+
+            // Entries are removed in place so that the others keep their position in the eviction order
+            CacheIterator memIt = shard.memoryCache.begin();
+            while ( memIt != shard.memoryCache.end() ) {
+                CacheIterator next = memIt;
+                ++next;
+                if ( isEntryOfHolderToRemove(getValueFromIterator(memIt), holderID, nodeHash, removeAll) ) {
+                    std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                        journalRemoveEntry(*it);
+                        toDelete.push_back(*it);
                     }
+                    shard.memoryCache.erase(memIt);
                 }
+                memIt = next;
             }
 
-            for (CacheIterator dIt = _diskCache.begin(); dIt != _diskCache.end(); ++dIt) {
-                std::list<EntryTypePtr> & entries = getValueFromIterator(dIt);
-                if ( !entries.empty() ) {
-                    const EntryTypePtr & front = entries.front();
-
-                    if ( (front->getKey().getCacheHolderID() == holderID) &&
-                         ( ( front->getKey().getTreeVersion() != nodeHash) || removeAll ) ) {
-                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                            toDelete.push_back(*it);
-                        }
-                    } else {
-                        typename EntryType::hash_type hash = front->getHashKey();
-                        newDiskCache.insert(hash, entries);
+            CacheIterator cIt = shard.compressedCache.begin();
+            while ( cIt != shard.compressedCache.end() ) {
+                CacheIterator next = cIt;
+                ++next;
+                if ( isEntryOfHolderToRemove(getValueFromIterator(cIt), holderID, nodeHash, removeAll) ) {
+                    std::list<EntryTypePtr> & entries = getValueFromIterator(cIt);
+                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                        onEntryLeftCompressedPortion(shard, *it);
+                        toDelete.push_back(*it);
                     }
+                    shard.compressedCache.erase(cIt);
                 }
+                cIt = next;
             }
 
-            _memoryCache = newMemCache;
-            _diskCache = newDiskCache;
-        } // QMutexLocker locker(&_lock);
+            CacheIterator dIt = shard.diskCache.begin();
+            while ( dIt != shard.diskCache.end() ) {
+                CacheIterator next = dIt;
+                ++next;
+                if ( isEntryOfHolderToRemove(getValueFromIterator(dIt), holderID, nodeHash, removeAll) ) {
+                    std::list<EntryTypePtr> & entries = getValueFromIterator(dIt);
+                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                        journalRemoveEntry(*it);
+                        toDelete.push_back(*it);
+                    }
+                    shard.diskCache.erase(dIt);
+                }
+                dIt = next;
+            }
+        } // for each shard
 
         if ( !toDelete.empty() ) {
             _deleterThread.appendToQueue(toDelete);
@@ -1666,16 +2159,146 @@ private:
         }
     } // removeAllEntriesWithDifferentNodeHashForHolderPrivate
 
-    bool getInternal(const typename EntryType::key_type & key,
-                     std::list<EntryTypePtr>* returnValue) const
+    /**
+     * @brief Returns true if the entries sharing a hash key belong to the given holder and were computed with another
+     * node hash, or if they are empty.
+     **/
+    static bool isEntryOfHolderToRemove(const std::list<EntryTypePtr>& entries,
+                                        const std::string & holderID,
+                                        U64 nodeHash,
+                                        bool removeAll)
+    {
+        if ( entries.empty() ) {
+            return true;
+        }
+        const EntryTypePtr & front = entries.front();
+
+        return (front->getKey().getCacheHolderID() == holderID) &&
+               ( ( front->getKey().getTreeVersion() != nodeHash) || removeAll );
+    }
+
+    /**
+     * @brief Subtracts amount from the given counter without wrapping around below 0.
+     **/
+    static void subtractClamped(boost::atomic<std::size_t>& counter,
+                                std::size_t amount)
+    {
+        std::size_t current = counter.load();
+        std::size_t newValue;
+
+        do {
+            newValue = amount > current ? 0 : current - amount;
+        } while ( !counter.compare_exchange_weak(current, newValue) );
+    }
+
+    /**
+     * @brief Returns the ratio of the in-memory size over the maximum size of the cache.
+     * If _maximumCacheSize == 0 we don't return 1 otherwise we would cause a deadlock
+     **/
+    double getMemoryOccupation() const
+    {
+        std::size_t maximumCacheSize = _maximumCacheSize.load();
+
+        return maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize.load() / maximumCacheSize;
+    }
+
+    /**
+     * @brief Returns the shard in which entries with the given hash are stored.
+     **/
+    CacheShard& getShard(hash_type hash) const
+    {
+        if (_shards.size() == 1) {
+            return *_shards[0];
+        }
+        // Fold the upper bits so that hashes differing only in their high bits are spread as well
+        U64 h = (U64)hash;
+
+        return *_shards[(std::size_t)( (h ^ (h >> 32)) % _shards.size() )];
+    }
+
+    static bool shardOccupationGreater(const std::pair<std::size_t, std::size_t>& lhs,
+                                       const std::pair<std::size_t, std::size_t>& rhs)
+    {
+        return lhs.first > rhs.first;
+    }
+
+    /**
+     * @brief Evicts the LRU entry of the memory (or disk) portion of a shard. The LRU order is only local to
+     * each shard: the shards holding the most entries are tried first, which keeps shards balanced and
+     * approximates a global LRU order. Shards are locked one at a time, hence the caller must not hold any shard lock.
+     * Returns false if there's nothing left to evict.
+     **/
+    bool tryEvictFromAnyShard(bool inMemory,
+                              std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        const std::size_t nShards = _shards.size();
+
+        // Entries evicted from the memory portion are compressed once the shard lock is released
+        std::list<EntryTypePtr> entriesToCompress;
+
+        if (nShards == 1) {
+            CacheShard& shard = *_shards[0];
+            bool evicted;
+            {
+                QMutexLocker locker(&shard.lock);
+                evicted = inMemory ? tryEvictInMemoryEntry(shard, entriesToBeDeleted, &entriesToCompress) : tryEvictDiskEntry(shard, entriesToBeDeleted);
+            }
+            compressEvictedEntries(entriesToCompress, entriesToBeDeleted);
+
+            return evicted;
+        }
+
+        // Start at a rotating index so that shards with the same occupation are evicted in turn
+        std::size_t startIndex = (std::size_t)( (unsigned int)_evictionShardIndex.fetchAndAddRelaxed(1) % nShards );
+        std::vector<std::pair<std::size_t, std::size_t> > occupation(nShards);
+        for (std::size_t i = 0; i < nShards; ++i) {
+            std::size_t index = (startIndex + i) % nShards;
+            CacheShard& shard = *_shards[index];
+            QMutexLocker locker(&shard.lock);
+            occupation[i] = std::make_pair(inMemory ? shard.memoryCache.size() + shard.compressedCache.size() : shard.diskCache.size(), index);
+        }
+        std::stable_sort(occupation.begin(), occupation.end(), shardOccupationGreater);
+
+        for (std::size_t i = 0; i < nShards; ++i) {
+            if (occupation[i].first == 0) {
+                break;
+            }
+            CacheShard& shard = *_shards[occupation[i].second];
+            bool evicted;
+            {
+                QMutexLocker locker(&shard.lock);
+                evicted = inMemory ? tryEvictInMemoryEntry(shard, entriesToBeDeleted, &entriesToCompress) : tryEvictDiskEntry(shard, entriesToBeDeleted);
+            }
+            if (evicted) {
+                compressEvictedEntries(entriesToCompress, entriesToBeDeleted);
+
+                return true;
+            }
+        }
+
+        return false;
+    } // tryEvictFromAnyShard
+
+    /**
+     * @brief Looks up the key in the memory portion of the shard, then in its disk portion. decompressed tells whether
+     * decompressEntries() just put entries matching the key back into the memory portion.
+     * Entries evicted from the memory portion to make room are appended to entriesToCompress: the caller
+     * must pass them to compressEvictedEntries() once the shard lock is released.
+     **/
+    bool getInternal(CacheShard& shard,
+                     const typename EntryType::key_type & key,
+                     bool decompressed,
+                     std::list<EntryTypePtr>* returnValue,
+                     std::list<EntryTypePtr>* entriesToCompress) const
     {
         ///Private should be locked
-        assert( !_lock.tryLock() );
+        assert( !shard.lock.tryLock() );
+        assert( &shard == &getShard( key.getHash() ) );
 
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache( key.getHash() );
+        CacheIterator memoryCached = shard.memoryCache( key.getHash() );
 
-        if ( memoryCached != _memoryCache.end() ) {
+        if ( memoryCached != shard.memoryCache.end() ) {
             ///we found something with a matching hash key. There may be several entries linked to
             ///this key, we need to find one with matching params
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
@@ -1691,13 +2314,30 @@ private:
                 }
             }
 
-            return returnValue->size() > 0;
+            if (decompressed) {
+                evictExceedingInMemoryEntries(shard, entriesToCompress);
+            }
+
+            if ( returnValue->empty() ) {
+                ++_nMisses;
+
+                return false;
+            }
+            if (decompressed) {
+                ++_nCompressedHits;
+            } else {
+                ++_nMemoryHits;
+            }
+
+            return true;
         } else {
             ///fallback on the disk cache internal container
-            CacheIterator diskCached = _diskCache( key.getHash() );
+            CacheIterator diskCached = shard.diskCache( key.getHash() );
 
-            if ( diskCached == _diskCache.end() ) {
+            if ( diskCached == shard.diskCache.end() ) {
                 /*the entry was neither in memory or disk, just allocate a new one*/
+                ++_nMisses;
+
                 return false;
             } else {
                 /*we found something with a matching hash key. There may be several entries linked to
@@ -1717,40 +2357,22 @@ private:
                                 (*it)->reOpenFileMapping();
                             } catch (const std::exception & e) {
                                 qDebug() << "Error while reopening cache file: " << e.what();
+                                journalRemoveEntry(*it);
                                 ret.erase(it);
+                                ++_nMisses;
 
                                 return false;
                             } catch (...) {
                                 qDebug() << "Error while reopening cache file";
+                                journalRemoveEntry(*it);
                                 ret.erase(it);
+                                ++_nMisses;
 
                                 return false;
                             }
 
                             //put it back into the RAM
-                            _memoryCache.insert( (*it)->getHashKey(), *it );
-
-
-                            U64 memoryCacheSize, maximumInMemorySize;
-                            {
-                                QMutexLocker k(&_sizeLock);
-                                memoryCacheSize = _memoryCacheSize;
-                                maximumInMemorySize = _maximumInMemorySize;
-                            }
-                            std::list<EntryTypePtr> entriesToBeDeleted;
-
-                            //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
-                            while (memoryCacheSize > maximumInMemorySize) {
-                                if ( !tryEvictInMemoryEntry(entriesToBeDeleted) ) {
-                                    break;
-                                }
-
-                                {
-                                    QMutexLocker k(&_sizeLock);
-                                    memoryCacheSize = _memoryCacheSize;
-                                    maximumInMemorySize = _maximumInMemorySize;
-                                }
-                            }
+                            shard.memoryCache.insert( (*it)->getHashKey(), *it );
                         }
                         
                         returnValue->push_back(*it);
@@ -1760,12 +2382,17 @@ private:
                             _signalEmitter->emitAddedEntry( key.getTime() );
                         }
 
+                        ++_nDiskHits;
+
                         if (!_isTiled) {
 
                             ret.erase(it);
 
                             ///Remove it from the disk cache
-                            _diskCache.erase(diskCached);
+                            shard.diskCache.erase(diskCached);
+
+                            //now clear extra entries from the memory cache so it doesn't exceed the RAM limit.
+                            evictExceedingInMemoryEntries(shard, entriesToCompress);
                         }
 
                         return true;
@@ -1774,6 +2401,8 @@ private:
 
                 /*if we reache here it means no entries linked to the hash key matches the params,then
                    we allocate a new one*/
+                ++_nMisses;
+
                 return false;
             }
         }
@@ -1782,25 +2411,27 @@ private:
     /** @brief Inserts into the cache an entry that was previously allocated by the createInternal()
      * function. This is called directly by createInternal() if the allocation was successful
      **/
-    void sealEntry(const EntryTypePtr & entry,
+    void sealEntry(CacheShard& shard,
+                   const EntryTypePtr & entry,
                    bool inMemory) const
     {
-        assert( !_lock.tryLock() );   // must be locked
+        assert( !shard.lock.tryLock() );   // must be locked
         typename EntryType::hash_type hash = entry->getHashKey();
+        assert( &shard == &getShard(hash) );
 
         if (inMemory) {
             /*if the entry doesn't exist on the memory cache,make a new list and insert it*/
-            CacheIterator existingEntry = _memoryCache(hash);
-            if ( existingEntry == _memoryCache.end() ) {
-                _memoryCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.memoryCache(hash);
+            if ( existingEntry == shard.memoryCache.end() ) {
+                shard.memoryCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
             }
         } else {
-            CacheIterator existingEntry = _diskCache(hash);
-            if ( existingEntry == _diskCache.end() ) {
-                _diskCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.diskCache(hash);
+            if ( existingEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
@@ -1808,21 +2439,33 @@ private:
         }
     }
 
-    bool tryEvictInMemoryEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    /**
+     * @brief Evicts the LRU entry of the memory portion of the shard. An entry stored in RAM is appended to
+     * entriesToCompress if compression is enabled, since it cannot be compressed under the shard lock, otherwise
+     * it is appended to entriesToBeDeleted.
+     **/
+    bool tryEvictInMemoryEntry(CacheShard& shard,
+                               std::list<EntryTypePtr> & entriesToBeDeleted,
+                               std::list<EntryTypePtr>* entriesToCompress) const
     {
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _memoryCache.evict();
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.memoryCache.evict();
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
-            return false;
+            //the compressed entries are then the only ones that can make room
+            return tryEvictCompressedEntry(shard, entriesToBeDeleted);
         }
 
         // If it is stored on disk, remove it from memory
         // If the cache is tiled, the entry is sharing the same file with other entries so we cannot close the file.
         // Just deallocate it
         if ( !evicted.second->isStoredOnDisk()) {
-            entriesToBeDeleted.push_back(evicted.second);
+            if ( getMaximumCompressedSize() / _shards.size() > 0 ) {
+                entriesToCompress->push_back(evicted.second);
+            } else {
+                entriesToBeDeleted.push_back(evicted.second);
+            }
         } else {
 
             assert( evicted.second.unique() );
@@ -1833,16 +2476,13 @@ private:
             /*insert it back into the disk portion */
 
             U64 diskCacheSize, maximumCacheSize, maximumInMemorySize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumInMemorySize = _maximumInMemorySize;
-                maximumCacheSize = _maximumCacheSize;
-            }
+            diskCacheSize = _diskCacheSize.load();
+            maximumInMemorySize = _maximumInMemorySize.load();
+            maximumCacheSize = _maximumCacheSize.load();
 
             /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
             while ( ( diskCacheSize  + evicted.second->size() ) >= (maximumCacheSize - maximumInMemorySize) ) {
-                std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
+                std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
                 //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
                 //we'll let the user of these entries purge the extra entries left in the cache later on
                 if (!evictedFromDisk.second) {
@@ -1850,15 +2490,13 @@ private:
                 }
 
                 ///Erase the file from the disk if we reach the limit.
+                journalRemoveEntry(evictedFromDisk.second);
                 evictedFromDisk.second->removeAnyBackingFile();
 
                 entriesToBeDeleted.push_back(evictedFromDisk.second);
 
-                {
-                    QMutexLocker k(&_sizeLock);
-                    maximumInMemorySize = _maximumInMemorySize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
+                maximumInMemorySize = _maximumInMemorySize.load();
+                maximumCacheSize = _maximumCacheSize.load();
 
                 //The entry is not yet deleted for real since it's done in a separate thread when this function
                 ///size() will return 0 at this point, we have to recompute it
@@ -1866,28 +2504,253 @@ private:
                 diskCacheSize -= fsize;
             }
 
-            CacheIterator existingDiskCacheEntry = _diskCache(evicted.first);
+            CacheIterator existingDiskCacheEntry = shard.diskCache(evicted.first);
             /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-            if ( existingDiskCacheEntry == _diskCache.end() ) {
-                _diskCache.insert(evicted.first, evicted.second);
+            if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(evicted.first, evicted.second);
             } else {   /*append to the existing list*/
                 getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
             }
+            journalAddEntry(evicted.second);
         } // if (!evicted.second->isStoredOnDisk())
 
         return true;
     } // tryEvictEntry
 
-    bool tryEvictDiskEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    /**
+     * @brief Compresses entries evicted from the memoryCache of their shard and keeps them in its compressedCache, then
+     * evicts the LRU compressed entries if the shard exceeds its share of the maximum compressed size.
+     * No shard lock must be held: the entries are out of the cache while they are compressed and their shard is
+     * only locked to insert them. Entries that do not compress well enough, or that were created again in the
+     * meantime, are appended to entriesToBeDeleted.
+     * The getLock of the shard is not held (the caller may hold the getLock of any shard), so the key may still be
+     * created again right after the entry was inserted: decompressEntries() drops such stale compressed entries.
+     **/
+    void compressEvictedEntries(const std::list<EntryTypePtr> & entries,
+                                std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        for (typename std::list<EntryTypePtr>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+            const EntryTypePtr& entry = *it;
+            if ( !entry->compress(NATRON_CACHE_COMPRESSION_MAX_RATIO) ) {
+                ++_nRejectedCompressions;
+                entriesToBeDeleted.push_back(entry);
+                continue;
+            }
+            ++_nCompressions;
+
+            hash_type hash = entry->getHashKey();
+            CacheShard& shard = getShard(hash);
+            QMutexLocker locker(&shard.lock);
+
+            // A lookup may have missed the entry while it was compressed and created it again
+            if ( containsKey(shard.memoryCache, entry->getKey()) || containsKey(shard.diskCache, entry->getKey()) ) {
+                entriesToBeDeleted.push_back(entry);
+                continue;
+            }
+            shard.compressedCache.insert(hash, entry);
+            shard.compressedSize += entry->dataSize();
+            shard.compressedOriginalSize += entry->getSizeInBytesFromParams();
+
+            std::size_t maximumCompressedSize = getMaximumCompressedSize() / _shards.size();
+            while (shard.compressedSize > maximumCompressedSize) {
+                if ( !tryEvictCompressedEntry(shard, entriesToBeDeleted) ) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // Same as above, the entries to be deleted are handed to the deleter thread
+    void compressEvictedEntries(const std::list<EntryTypePtr> & entries) const
+    {
+        if ( entries.empty() ) {
+            return;
+        }
+        std::list<EntryTypePtr> entriesToBeDeleted;
+        compressEvictedEntries(entries, entriesToBeDeleted);
+        if ( !entriesToBeDeleted.empty() ) {
+            _deleterThread.appendToQueue(entriesToBeDeleted);
+        }
+    }
+
+    /**
+     * @brief Moves the compressed entries of the shard matching the key back to its memoryCache.
+     * The shard is locked to take the entries out of its compressedCache and to insert them back, but not while
+     * they are decompressed: the caller must hold the getLock of the shard, so that the key cannot be created
+     * meanwhile, and must not hold its lock. Entries that cannot be decompressed are removed from the cache.
+     * If the key is already resident in the memory or disk portion, the compressed entries are stale copies
+     * left by compressEvictedEntries() and are removed from the cache without being decompressed.
+     * Returns true if any entry was decompressed.
+     **/
+    bool decompressEntries(CacheShard& shard,
+                           const typename EntryType::key_type & key) const
+    {
+        std::list<EntryTypePtr> entries;
+        bool stale;
+        {
+            QMutexLocker locker(&shard.lock);
+            CacheIterator compressedCached = shard.compressedCache( key.getHash() );
+
+            if ( compressedCached == shard.compressedCache.end() ) {
+                return false;
+            }
+            std::list<EntryTypePtr> & cached = getValueFromIterator(compressedCached);
+            typename std::list<EntryTypePtr>::iterator it = cached.begin();
+            while ( it != cached.end() ) {
+                if ( !( (*it)->getKey() == key ) ) {
+                    ++it;
+                    continue;
+                }
+                onEntryLeftCompressedPortion(shard, *it);
+                entries.push_back(*it);
+                it = cached.erase(it);
+            }
+            if ( cached.empty() ) {
+                shard.compressedCache.erase(compressedCached);
+            }
+            stale = containsKey(shard.memoryCache, key) || containsKey(shard.diskCache, key);
+        }
+        if (stale) {
+            _deleterThread.appendToQueue(entries);
+
+            return false;
+        }
+
+        typename std::list<EntryTypePtr>::iterator it = entries.begin();
+        while ( it != entries.end() ) {
+            TimeLapse timer;
+            if ( !(*it)->decompress() ) {
+                qDebug() << "Failed to decompress cache entry, it is removed from the cache";
+                it = entries.erase(it);
+                continue;
+            }
+            _decompressionTimeUs.fetch_add( (U64)(timer.getTimeSinceCreation() * 1000000.) );
+            ++_nDecompressions;
+            ++it;
+        }
+        if ( entries.empty() ) {
+            return false;
+        }
+
+        QMutexLocker locker(&shard.lock);
+        for (it = entries.begin(); it != entries.end(); ++it) {
+            sealEntry(shard, *it, true);
+        }
+
+        return true;
+    }
+
+    // Returns true if the container holds an entry with the given key
+    static bool containsKey(CacheContainer& container,
+                            const typename EntryType::key_type & key)
+    {
+        CacheIterator found = container( key.getHash() );
+
+        if ( found == container.end() ) {
+            return false;
+        }
+        const std::list<EntryTypePtr> & entries = getValueFromIterator(found);
+        for (typename std::list<EntryTypePtr>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+            if ( (*it)->getKey() == key ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool tryEvictCompressedEntry(CacheShard& shard,
+                                 std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.compressedCache.evict();
+        if (!evicted.second) {
+            return false;
+        }
+        onEntryLeftCompressedPortion(shard, evicted.second);
+        entriesToBeDeleted.push_back(evicted.second);
+
+        return true;
+    }
+
+    // Removes the compressed entries of the shard that are not used anywhere else
+    void clearCompressedPortion(CacheShard& shard) const
+    {
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.compressedCache.evict();
+        while (evicted.second) {
+            onEntryLeftCompressedPortion(shard, evicted.second);
+            evicted = shard.compressedCache.evict();
+        }
+    }
+
+    // To be called whenever an entry is removed from the compressedCache of the shard
+    void onEntryLeftCompressedPortion(CacheShard& shard,
+                                      const EntryTypePtr& entry) const
+    {
+        std::size_t size = entry->dataSize();
+        std::size_t originalSize = entry->getSizeInBytesFromParams();
+
+        shard.compressedSize -= std::min(size, shard.compressedSize);
+        shard.compressedOriginalSize -= std::min(originalSize, shard.compressedOriginalSize);
+    }
+
+    /**
+     * @brief Evicts the LRU entries of the memory portion of the shard until the in-memory size of the cache
+     * fits its maximum size. Only this shard is locked: evicting from other shards here could deadlock, so
+     * its own LRU entries are evicted, the other shards are evicted by createInternal().
+     * The evicted entries to compress are appended to entriesToCompress, see getInternal().
+     **/
+    void evictExceedingInMemoryEntries(CacheShard& shard,
+                                       std::list<EntryTypePtr>* entriesToCompress) const
+    {
+        std::list<EntryTypePtr> entriesToBeDeleted;
+
+        // Entries pending compression are counted as freed, most of their memory will be
+        while ( getMemoryCacheSizeAfterDeletion(entriesToBeDeleted, *entriesToCompress) > _maximumInMemorySize.load() ) {
+            if ( !tryEvictInMemoryEntry(shard, entriesToBeDeleted, entriesToCompress) ) {
+                break;
+            }
+        }
+        if ( !entriesToBeDeleted.empty() ) {
+            _deleterThread.appendToQueue(entriesToBeDeleted);
+        }
+    }
+
+    /**
+     * @brief Returns the in-memory size of the cache once the given entries, evicted but not destroyed yet, are deleted
+     * and the entries pending compression are compressed.
+     **/
+    std::size_t getMemoryCacheSizeAfterDeletion(const std::list<EntryTypePtr> & entriesToBeDeleted,
+                                                const std::list<EntryTypePtr> & entriesToCompress = std::list<EntryTypePtr>()) const
+    {
+        std::size_t pendingSize = 0;
+
+        for (typename std::list<EntryTypePtr>::const_iterator it = entriesToBeDeleted.begin(); it != entriesToBeDeleted.end(); ++it) {
+            if ( !(*it)->isStoredOnDisk() ) {
+                pendingSize += (*it)->size();
+            }
+        }
+        for (typename std::list<EntryTypePtr>::const_iterator it = entriesToCompress.begin(); it != entriesToCompress.end(); ++it) {
+            pendingSize += (*it)->size();
+        }
+        std::size_t memoryCacheSize = _memoryCacheSize.load();
+
+        return pendingSize > memoryCacheSize ? 0 : memoryCacheSize - pendingSize;
+    }
+
+    bool tryEvictDiskEntry(CacheShard& shard,
+                           std::list<EntryTypePtr> & entriesToBeDeleted) const
     {
 
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _diskCache.evict();
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.diskCache.evict();
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
             return false;
         }
+        journalRemoveEntry(evicted.second);
         if (!_isTiled) {
             // Erase the file from the disk if we reach the limit.
             evicted.second->removeAnyBackingFile();
@@ -0,0 +1,228 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CacheCompression.h"
+
+#include <algorithm>
+#include <cstring>
+
+// The compressed data starts with the size of the original data (U64) and the number of 32-bit words between
+// a word and the same channel of the previous pixel (U32).
+// Then follow tokens made of a number of literal words (U32), a number of words repeating the previous pixel (U32)
+// and the literal words. The last bytes of the original data that do not fill a word are stored as is at the end.
+#define CACHE_COMPRESSION_HEADER_SIZE (8 + 4)
+#define CACHE_COMPRESSION_TOKEN_SIZE (4 + 4)
+
+// Shorter runs cost more than their literal words
+#define CACHE_COMPRESSION_MIN_RUN_WORDS 4
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// The smallest number of words made of whole pixels
+std::size_t
+getStrideWords(std::size_t pixelBytes)
+{
+    if (pixelBytes == 0) {
+        return 1;
+    }
+    std::size_t a = pixelBytes, b = 4;
+    while (b) {
+        std::size_t r = a % b;
+        a = b;
+        b = r;
+    }
+
+    return pixelBytes / a;
+}
+
+bool
+appendToken(const U32* literals,
+            std::size_t nLiterals,
+            std::size_t nRepeats,
+            std::size_t maxCompressedSize,
+            std::string* dst)
+{
+    if (dst->size() + CACHE_COMPRESSION_TOKEN_SIZE + nLiterals * 4 > maxCompressedSize) {
+        return false;
+    }
+    U32 counts[2] = { (U32)nLiterals, (U32)nRepeats };
+    dst->append( (const char*)counts, sizeof(counts) );
+    dst->append( (const char*)literals, nLiterals * 4 );
+
+    return true;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+namespace CacheCompression {
+
+bool
+compress(const void* src,
+         std::size_t size,
+         std::size_t pixelBytes,
+         std::size_t maxCompressedSize,
+         std::string* dst)
+{
+    dst->clear();
+
+    const std::size_t stride = getStrideWords(pixelBytes);
+    // Tokens store counts on 32 bits
+    const std::size_t nWords = size / 4;
+    if ( (nWords > 0xffffffffU) || (CACHE_COMPRESSION_HEADER_SIZE + size % 4 > maxCompressedSize) ) {
+        return false;
+    }
+    // Cache entries are allocated with malloc, which aligns them for any type
+    const U32* words = (const U32*)src;
+
+    U64 originalSize = size;
+    U32 strideWords = (U32)stride;
+    dst->append( (const char*)&originalSize, sizeof(originalSize) );
+    dst->append( (const char*)&strideWords, sizeof(strideWords) );
+
+    std::size_t i = 0;
+    std::size_t literalsStart = 0;
+    while (i < nWords) {
+        // The first pixel is compared to black
+        U32 previous = i >= stride ? words[i - stride] : 0;
+        if (words[i] != previous) {
+            ++i;
+            continue;
+        }
+        std::size_t j = i + 1;
+        for (std::size_t blackEnd = std::min(nWords, stride); j < blackEnd && words[j] == 0; ++j) {
+        }
+        if (j >= stride) {
+            while ( j < nWords && words[j] == words[j - stride] ) {
+                ++j;
+            }
+        }
+        if ( (j - i >= CACHE_COMPRESSION_MIN_RUN_WORDS) || (j == nWords) ) {
+            if ( !appendToken(words + literalsStart, i - literalsStart, j - i, maxCompressedSize, dst) ) {
+                dst->clear();
+
+                return false;
+            }
+            literalsStart = j;
+        }
+        i = j;
+    }
+    if ( (literalsStart < nWords) && !appendToken(words + literalsStart, nWords - literalsStart, 0, maxCompressedSize, dst) ) {
+        dst->clear();
+
+        return false;
+    }
+    dst->append( (const char*)src + nWords * 4, size % 4 );
+    if (dst->size() > maxCompressedSize) {
+        dst->clear();
+
+        return false;
+    }
+
+    // Do not keep the memory reserved while appending
+    if ( dst->capacity() > dst->size() + dst->size() / 4 ) {
+        std::string(*dst).swap(*dst);
+    }
+
+    return true;
+} // compress
+
+std::size_t
+getDecompressedSize(const std::string& src)
+{
+    if (src.size() < CACHE_COMPRESSION_HEADER_SIZE) {
+        return 0;
+    }
+    U64 originalSize;
+    std::memcpy( &originalSize, src.data(), sizeof(originalSize) );
+
+    return (std::size_t)originalSize;
+}
+
+bool
+decompress(const std::string& src,
+           void* dst,
+           std::size_t size)
+{
+    if ( (src.size() < CACHE_COMPRESSION_HEADER_SIZE) || (getDecompressedSize(src) != size) ) {
+        return false;
+    }
+    U32 strideWords;
+    std::memcpy( &strideWords, src.data() + 8, sizeof(strideWords) );
+    const std::size_t stride = strideWords;
+    if (stride == 0) {
+        return false;
+    }
+
+    const char* p = src.data() + CACHE_COMPRESSION_HEADER_SIZE;
+    const char* end = src.data() + src.size();
+    const std::size_t nWords = size / 4;
+    U32* words = (U32*)dst;
+    std::size_t i = 0;
+    while (i < nWords) {
+        if (end - p < CACHE_COMPRESSION_TOKEN_SIZE) {
+            return false;
+        }
+        U32 counts[2];
+        std::memcpy( counts, p, sizeof(counts) );
+        p += CACHE_COMPRESSION_TOKEN_SIZE;
+        std::size_t nLiterals = counts[0];
+        std::size_t nRepeats = counts[1];
+        if ( ( (nLiterals == 0) && (nRepeats == 0) ) || (nLiterals > nWords - i) || ( (std::size_t)(end - p) < nLiterals * 4 ) ) {
+            return false;
+        }
+        std::memcpy( words + i, p, nLiterals * 4 );
+        p += nLiterals * 4;
+        i += nLiterals;
+
+        if (nRepeats > nWords - i) {
+            return false;
+        }
+        std::size_t runEnd = i + nRepeats;
+        if (i < stride) {
+            std::size_t blackEnd = std::min(runEnd, stride);
+            std::memset( words + i, 0, (blackEnd - i) * 4 );
+            i = blackEnd;
+        }
+        // Copy the previous pixels, doubling the size of the copied block each time since the run repeats them
+        std::size_t distance = stride;
+        while (i < runEnd) {
+            std::size_t n = std::min(runEnd - i, distance);
+            std::memcpy( words + i, words + i - distance, n * 4 );
+            i += n;
+            distance += n;
+        }
+    }
+
+    if ( (std::size_t)(end - p) != size % 4 ) {
+        return false;
+    }
+    std::memcpy( (char*)dst + nWords * 4, p, size % 4 );
+
+    return true;
+} // decompress
+} // namespace CacheCompression
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,72 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_CacheCompression_h
+#define Natron_Engine_CacheCompression_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <string>
+
+#include "Global/GlobalDefines.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief A fast lossless codec for the pixels of cache entries kept in RAM.
+ *
+ * Images are compared to themselves one pixel apart: runs of pixels equal to the previous one (and pixels
+ * before the start of the buffer are considered black) are stored as a count, the other pixels as is.
+ * Black or constant areas, which make most of mattes and roto outputs, compress to almost nothing while
+ * compressing and decompressing run close to the speed of memcpy. Noisy images do not compress: compress()
+ * gives up as soon as the result would be larger than the allowed size.
+ **/
+namespace CacheCompression {
+
+/**
+ * @brief Compresses size bytes of src, made of pixels of pixelBytes bytes, into dst.
+ * Returns false if the compressed data would exceed maxCompressedSize, in which case dst is left empty.
+ **/
+bool compress(const void* src,
+              std::size_t size,
+              std::size_t pixelBytes,
+              std::size_t maxCompressedSize,
+              std::string* dst);
+
+// Returns the size of the data compressed in src, 0 if src is not compressed data
+std::size_t getDecompressedSize(const std::string& src);
+
+/**
+ * @brief Decompresses src, which was produced by compress(), into dst which must be getDecompressedSize(src) bytes long.
+ * Returns false if src is corrupted.
+ **/
+bool decompress(const std::string& src,
+                void* dst,
+                std::size_t size);
+} // namespace CacheCompression
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_CacheCompression_h
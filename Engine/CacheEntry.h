@@ -50,6 +50,8 @@
 #include <boost/scoped_ptr.hpp>
 #endif
 #include "Engine/Hash64.h"
+#include "Engine/BufferPool.h"
+#include "Engine/CacheCompression.h"
 #include "Engine/CacheEntryHolder.h"
 #include "Engine/MemoryFile.h"
 #include "Engine/NonKeyParams.h"
@@ -104,18 +106,9 @@ public:
         if (size == 0) {
             return;
         }
+        clear();
+        data = (T*)BufferPool::allocate( size * sizeof(T) );
         count = size;
-        if (data) {
-            free(data);
-            data = 0;
-        }
-        if (count == 0) {
-            return;
-        }
-        data = (T*)malloc( size * sizeof(T) );
-        if (!data) {
-            throw std::bad_alloc();
-        }
     }
 
     void resizeAndPreserve(U64 size)
@@ -123,28 +116,22 @@ public:
         if (size == 0 || size == count) {
             return;
         }
+        data = (T*)BufferPool::reallocate( data, count * sizeof(T), size * sizeof(T) );
         count = size;
-        data = (T*)realloc(data,size * sizeof(T));
-        if (!data) {
-            throw std::bad_alloc();
-        }
     }
 
     void clear()
     {
-        count = 0;
         if (data) {
-            free(data);
+            BufferPool::release( data, count * sizeof(T) );
             data = 0;
         }
+        count = 0;
     }
 
     ~RamBuffer()
     {
-        if (data) {
-            free(data);
-            data = 0;
-        }
+        clear();
     }
 };
 
@@ -167,6 +154,13 @@ class CacheAPI
 public:
     virtual ~CacheAPI() {}
 
+    /**
+     * @brief Returns a string that was never returned before by any process, appended to the hash of an entry to name its file.
+     * Several processes may share a disk cache: a file name must never be reused while another process may still reference
+     * the file of an entry that was removed.
+     **/
+    static std::string generateUniqueFileNameSuffix();
+
     /**
      * @brief Returns the path to the cache location on disk
      **/
@@ -366,6 +360,20 @@ public:
 
 };
 
+/**
+ * @brief Written after the data of each file of a disk cache, so that a file re-opened by Buffer::reOpenFileMapping()
+ * can be checked to still belong to the entry.
+ **/
+struct CacheFileFooter
+{
+    U64 magic;
+    U64 hash;
+    U64 dataSize;
+};
+
+// "NATRCACH"
+#define NATRON_CACHE_FILE_FOOTER_MAGIC ( ( (U64)0x4e415452 << 32 ) | (U64)0x43414348 )
+
 /** @brief Buffer represents  an internal buffer that can be allocated on different devices.
  * For now the class is simple and can only be either on disk using mmap or in RAM using malloc.
  * The cost parameter given to the allocate() function is a hint that the Buffer classes uses
@@ -389,7 +397,9 @@ public:
     Buffer()
         : _path()
         , _buffer()
+        , _compressed()
         , _backingFile()
+        , _fileHash(0)
         , _entry(0)
         , _cacheFile()
         , _cacheFileDataOffset(0)
@@ -414,33 +424,45 @@ public:
         _buffer->resize(count);
     }
 
-    void allocateMMAP(U64 count,
+    /**
+     * @brief Creates the file at the given path and maps it. Returns false if the file already exists: it may have
+     * been created by another process sharing the cache since the caller checked that it did not.
+     * The hash of the entry is written in the footer of the file.
+     **/
+    bool allocateMMAP(U64 count,
+                      U64 hash,
                       const std::string& path)
     {
         assert( _path.empty() );
         if (_backingFile) {
-            return;
+            return true;
         }
         _storageMode = eStorageModeDisk;
         _path = path;
+        _fileHash = hash;
         try {
-            _backingFile.reset( new MemoryFile(_path, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate) );
+            _backingFile.reset( new MemoryFile(_path, MemoryFile::eFileOpenModeEnumIfExistsFailElseCreate) );
         } catch (const std::runtime_error & r) {
-            qDebug() << r.what();
-            // if opening the file mapping failed, just call allocate again, but this time on RAM!
             _backingFile.reset();
             _path.clear();
+            if ( CacheAPI::fileExists(path) ) {
+                return false;
+            }
+            qDebug() << r.what();
+            // if opening the file mapping failed, just call allocate again, but this time on RAM!
             allocateRAM(count);
 
-            return;
+            return true;
         }
 
         assert(_backingFile);
 
         if ( !path.empty() && (count != 0) ) {
             //if the backing file has already the good size and we just wanted to re-open the mapping
-            _backingFile->resize(count);
+            resizeBackingFile(count);
         }
+
+        return true;
     }
 
     void allocateGLTexture(const RectI& rectangle,
@@ -519,18 +541,20 @@ public:
                 if (!_buffer) {
                     _buffer.reset( new RamBuffer<DataType>() );
                 }
-                _buffer->resize( other._backingFile->size() / sizeof(DataType) );
+                std::size_t dataSize = other.getBackingFileDataSize();
+                _buffer->resize( dataSize / sizeof(DataType) );
                 const char* src = other._backingFile->data();
                 char* dst = (char*)_buffer->getData();
-                std::memcpy( dst, src, other._backingFile->size() );
+                std::memcpy(dst, src, dataSize);
             }
         } else if (_storageMode == eStorageModeDisk) {
             if (other._storageMode == eStorageModeDisk) {
                 assert(_backingFile);
                 _backingFile.swap(other._backingFile);
                 _path = other._path;
+                _fileHash = other._fileHash;
             } else {
-                _backingFile->resize( other._buffer->size() * sizeof(DataType) );
+                resizeBackingFile( other._buffer->size() * sizeof(DataType) );
                 assert( _backingFile->data() );
                 const char* src = (const char*)other._buffer->getData();
                 char* dst = (char*)_backingFile->data();
@@ -552,15 +576,34 @@ public:
         return _cacheFileDataOffset;
     }
 
-    void reOpenFileMapping() const
+    /**
+     * @brief Maps again the file of an entry living only on disk. Throws an exception if the file was removed or if it is
+     * not the file of the entry with the given hash and size, e.g. a file written by an older version.
+     **/
+    void reOpenFileMapping(std::size_t dataSize,
+                           U64 hash) const
     {
         assert(!_backingFile && _storageMode == eStorageModeDisk);
         try{
-            _backingFile.reset( new MemoryFile(_path, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate) );
+            // The file may have been removed by another process sharing the cache: never re-create it empty
+            _backingFile.reset( new MemoryFile(_path, MemoryFile::eFileOpenModeEnumIfExistsKeepElseFail) );
         } catch (const std::exception & e) {
             _backingFile.reset();
             throw std::bad_alloc();
         }
+
+        // Never map pixels of the wrong size: accessing past the end of the file would raise SIGBUS
+        bool valid = _backingFile->data() && ( _backingFile->size() == (dataSize + sizeof(CacheFileFooter)) );
+        if (valid) {
+            CacheFileFooter footer;
+            std::memcpy( &footer, _backingFile->data() + dataSize, sizeof(CacheFileFooter) );
+            valid = (footer.magic == NATRON_CACHE_FILE_FOOTER_MAGIC) && (footer.hash == hash) && (footer.dataSize == dataSize);
+        }
+        if (!valid) {
+            _backingFile.reset();
+            throw std::runtime_error("The cache file " + _path + " does not belong to the entry");
+        }
+        _fileHash = hash;
     }
 
     void restoreBufferFromFile(const std::string & path, std::size_t dataOffset, AbstractCacheEntryBase* entry, bool isTileCache)
@@ -583,6 +626,7 @@ public:
             if (_buffer) {
                 _buffer->clear();
             }
+            std::string().swap(_compressed);
         } else if (_storageMode == eStorageModeDisk) {
             if (_backingFile) {
                 bool flushOk = _backingFile->flush(MemoryFile::eFlushTypeAsync, 0, 0);
@@ -636,10 +680,10 @@ public:
     size_t size() const
     {
         if (_storageMode == eStorageModeRAM) {
-            return _buffer ? _buffer->size() * sizeof(DataType) : 0;
+            return ( _buffer ? _buffer->size() * sizeof(DataType) : 0 ) + _compressed.size();
         } else if (_storageMode == eStorageModeDisk) {
             if (_backingFile) {
-                return _backingFile->size();
+                return getBackingFileDataSize();
             } else if (_cacheFile) {
                 assert(_entry);
                 return _entry->getCacheTileSizeBytes();
@@ -655,7 +699,57 @@ public:
 
     bool isAllocated() const
     {
-        return (_buffer && _buffer->size() > 0) || ( _backingFile && _backingFile->data() ) || _cacheFile || _glTexture;
+        return (_buffer && _buffer->size() > 0) || !_compressed.empty() || ( _backingFile && _backingFile->data() ) || _cacheFile || _glTexture;
+    }
+
+    /**
+     * @brief Compresses a RAM buffer and frees its data, which cannot be accessed until decompress() is called.
+     * Returns false and leaves the buffer untouched if it does not compress to maxCompressedSize bytes or less.
+     **/
+    bool compress(std::size_t pixelBytes,
+                  std::size_t maxCompressedSize)
+    {
+        if ( (_storageMode != eStorageModeRAM) || !_buffer || (_buffer->size() == 0) || !_compressed.empty() ) {
+            return false;
+        }
+        if ( !CacheCompression::compress(_buffer->getData(), _buffer->size() * sizeof(DataType), pixelBytes, maxCompressedSize, &_compressed) ) {
+            return false;
+        }
+        _buffer->clear();
+
+        return true;
+    }
+
+    bool isCompressed() const
+    {
+        return !_compressed.empty();
+    }
+
+    /**
+     * @brief Restores the data of a buffer compressed with compress(). Returns false if the compressed data
+     * was corrupted, in which case the buffer is left deallocated.
+     * WARNING: This function throws a std::bad_alloc if the allocation fails.
+     **/
+    bool decompress()
+    {
+        if ( _compressed.empty() ) {
+            return true;
+        }
+        std::size_t size = CacheCompression::getDecompressedSize(_compressed);
+        bool ok = size > 0 && (size % sizeof(DataType) == 0);
+        if (ok) {
+            if (!_buffer) {
+                _buffer.reset( new RamBuffer<DataType>() );
+            }
+            _buffer->resize( size / sizeof(DataType) );
+            ok = CacheCompression::decompress( _compressed, _buffer->getData(), size );
+            if (!ok) {
+                _buffer->clear();
+            }
+        }
+        std::string().swap(_compressed);
+
+        return ok;
     }
 
     DataType* writable()
@@ -726,13 +820,41 @@ public:
 
 private:
 
+    /**
+     * @brief Resizes the backing file to hold dataSize bytes followed by the footer.
+     **/
+    void resizeBackingFile(std::size_t dataSize)
+    {
+        _backingFile->resize( dataSize + sizeof(CacheFileFooter) );
+        CacheFileFooter footer;
+        footer.magic = NATRON_CACHE_FILE_FOOTER_MAGIC;
+        footer.hash = _fileHash;
+        footer.dataSize = dataSize;
+        std::memcpy( _backingFile->data() + dataSize, &footer, sizeof(CacheFileFooter) );
+    }
+
+    std::size_t getBackingFileDataSize() const
+    {
+        if ( !_backingFile || (_backingFile->size() < sizeof(CacheFileFooter)) ) {
+            return 0;
+        }
+
+        return _backingFile->size() - sizeof(CacheFileFooter);
+    }
+
     std::string _path;
     boost::scoped_ptr<RamBuffer<DataType> > _buffer;
 
+    // The data of a RAM buffer while it is compressed, _buffer is then empty
+    std::string _compressed;
+
     /*mutable so the reOpenFileMapping function can reopen the mmaped file. It doesn't
        change the underlying data*/
     mutable boost::scoped_ptr<MemoryFile> _backingFile;
 
+    // The hash of the entry, written in the footer of _backingFile
+    mutable U64 _fileHash;
+
     // Set if the cache is a tile cache
     AbstractCacheEntryBase* _entry;
     TileCacheFilePtr _cacheFile;
@@ -950,7 +1072,7 @@ public:
         }
         {
             QWriteLocker k(&_entryLock);
-            _data.reOpenFileMapping();
+            _data.reOpenFileMapping( getElementsCountFromParams(), getHashKey() );
         }
         if (_cache) {
             _cache->notifyEntryStorageChanged( eStorageModeDisk, eStorageModeRAM, getTime(), size() );
@@ -1038,6 +1160,59 @@ public:
         return _data.isAllocated();
     }
 
+    /**
+     * @brief Compresses the data of an entry stored in RAM, so that it takes less memory while it is not used.
+     * The data cannot be accessed until decompress() is called: this is only done by the cache on entries that are
+     * not referenced anywhere else. Returns false if the data does not compress to maxRatio of its size or less.
+     **/
+    bool compress(double maxRatio)
+    {
+        const CacheEntryStorageInfo& info = _params->getStorageInfo();
+        std::size_t oldSize = size();
+        bool compressed;
+        {
+            QWriteLocker k(&_entryLock);
+            std::size_t dataSize = _data.size();
+            compressed = _data.compress( info.dataTypeSize * info.numComponents * sizeof(DataType), (std::size_t)(dataSize * maxRatio) );
+        }
+        if (compressed && _cache) {
+            _cache->notifyEntrySizeChanged( oldSize, size() );
+        }
+
+        return compressed;
+    }
+
+    bool isCompressed() const
+    {
+        QReadLocker k(&_entryLock);
+
+        return _data.isCompressed();
+    }
+
+    /**
+     * @brief Restores the data of an entry compressed with compress().
+     * Returns false if it could not be restored, in which case the entry is left deallocated and should be discarded.
+     **/
+    bool decompress()
+    {
+        std::size_t oldSize = size();
+        bool ok;
+        {
+            QWriteLocker k(&_entryLock);
+            try {
+                ok = _data.decompress();
+            } catch (const std::bad_alloc &) {
+                _data.deallocate();
+                ok = false;
+            }
+        }
+        if (_cache) {
+            _cache->notifyEntrySizeChanged( oldSize, size() );
+        }
+
+        return ok;
+    }
+
     virtual void syncBackingFile() const OVERRIDE FINAL
     {
         QWriteLocker k(&_entryLock);
@@ -1199,25 +1374,21 @@ private:
                 }
 
                 assert( !fileName.empty() );
-                //Check if the filename already exists, if so append a 0-based index after the hash (separated by a '_')
-                //and try again
-                int index = 0;
-                if ( CacheAPI::fileExists(fileName) ) {
-                    fileName.insert(fileName.size() - 4, "_0");
-                }
-                while ( CacheAPI::fileExists(fileName) ) {
-                    ++index;
-                    std::stringstream ss;
-                    ss << index;
-                    fileName.replace( fileName.size() - 1, std::string::npos, ss.str() );
-                }
+                // Append a suffix unique across processes after the hash (separated by a '_'): a name is never reused,
+                // so another process sharing the cache that still references a removed file can never map the file of
+                // another entry in its place
+                U64 count = getElementsCountFromParams();
+                std::string baseFileName = fileName;
+                do {
+                    fileName = baseFileName;
+                    fileName.insert( fileName.size() - std::strlen("." NATRON_CACHE_FILE_EXT), '_' + CacheAPI::generateUniqueFileNameSuffix() );
 #ifdef DEBUG
-                if ( !CacheAPI::checkFileNameMatchesHash(fileName, hashKey) ) {
-                    qDebug() << "WARNING: Cache entry filename is not the same as the serialized hash key";
-                }
+                    if ( !CacheAPI::checkFileNameMatchesHash(fileName, hashKey) ) {
+                        qDebug() << "WARNING: Cache entry filename is not the same as the serialized hash key";
+                    }
 #endif
-                U64 count = getElementsCountFromParams();
-                _data.allocateMMAP(count, fileName);
+                    // The file is created atomically: another process sharing the cache may have created it meanwhile
+                } while ( !_data.allocateMMAP(count, hashKey, fileName) );
             }
         } else if (info.mode == eStorageModeRAM) {
             U64 count = getElementsCountFromParams();
@@ -0,0 +1,744 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CacheJournal.h"
+
+#ifdef __NATRON_WIN32__
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <utility>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/unordered_map.hpp>
+#endif
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+
+#include "Engine/FStreamsSupport.h"
+
+// The file starts with the magic followed by the version of the journal and its generation, which is incremented
+// each time the journal is compacted
+#define CACHE_JOURNAL_MAGIC "NTCJRNL1"
+#define CACHE_JOURNAL_MAGIC_SIZE 8
+#define CACHE_JOURNAL_HEADER_SIZE (CACHE_JOURNAL_MAGIC_SIZE + 4 + 4)
+
+// Processes using the same journal synchronize with locks on the bytes of a file next to it:
+// the first byte is locked exclusively to read or write the journal, all processes using the journal
+// hold a shared lock on the second one.
+#define CACHE_JOURNAL_LOCK_FILE_EXT ".lock"
+#define CACHE_JOURNAL_LOCK_WRITE 0
+#define CACHE_JOURNAL_LOCK_USERS 1
+
+// A record is: U32 body size, body, U32 checksum of the body.
+// The body is: U8 type, U64 hash, U64 data offset, U64 data size, U32 path length, path, U32 payload length, payload.
+#define CACHE_JOURNAL_RECORD_MIN_BODY_SIZE (1 + 8 + 8 + 8 + 4 + 4)
+
+// Larger sizes can only come from a corrupted file
+#define CACHE_JOURNAL_RECORD_MAX_BODY_SIZE (64 * 1024 * 1024)
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum RecordTypeEnum
+{
+    eRecordTypeAdd = 0,
+    eRecordTypeRemove
+};
+
+// Integers are stored in little-endian order whatever the platform
+void
+writeU32(std::string* buf,
+         U32 v)
+{
+    for (int i = 0; i < 4; ++i) {
+        buf->push_back( (char)( (v >> (i * 8) ) & 0xff ) );
+    }
+}
+
+void
+writeU64(std::string* buf,
+         U64 v)
+{
+    for (int i = 0; i < 8; ++i) {
+        buf->push_back( (char)( (v >> (i * 8) ) & 0xff ) );
+    }
+}
+
+U32
+readU32(const char* p)
+{
+    const unsigned char* u = (const unsigned char*)p;
+
+    return (U32)u[0] | ( (U32)u[1] << 8 ) | ( (U32)u[2] << 16 ) | ( (U32)u[3] << 24 );
+}
+
+U64
+readU64(const char* p)
+{
+    return (U64)readU32(p) | ( (U64)readU32(p + 4) << 32 );
+}
+
+// FNV-1a over 32-bit words: enough to detect a record that was only partially written
+U32
+checksum(const char* data,
+         std::size_t size)
+{
+    U32 h = 2166136261U;
+    std::size_t i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        h ^= readU32(data + i);
+        h *= 16777619U;
+    }
+    for (; i < size; ++i) {
+        h ^= (unsigned char)data[i];
+        h *= 16777619U;
+    }
+
+    return h;
+}
+
+// Identifies the location of an entry: its file and offset in that file
+U64
+locationDigest(const std::string& filePath,
+               U64 dataOffset)
+{
+    U64 h = 14695981039346656037ULL;
+
+    for (std::size_t i = 0; i < filePath.size(); ++i) {
+        h ^= (unsigned char)filePath[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h ^ ( dataOffset * 0x9e3779b97f4a7c15ULL );
+}
+
+void
+writeHeader(std::string* buf,
+            unsigned int version,
+            U32 generation)
+{
+    buf->append(CACHE_JOURNAL_MAGIC, CACHE_JOURNAL_MAGIC_SIZE);
+    writeU32(buf, version);
+    writeU32(buf, generation);
+}
+
+/**
+ * @brief Reads the header of a journal and returns its generation. Returns false if it is not a journal with the given version.
+ **/
+bool
+readHeader(FStreamsSupport::ifstream& ifile,
+           unsigned int version,
+           U32* generation)
+{
+    char header[CACHE_JOURNAL_HEADER_SIZE];
+
+    if ( !ifile.read(header, CACHE_JOURNAL_HEADER_SIZE) ||
+         std::memcmp(header, CACHE_JOURNAL_MAGIC, CACHE_JOURNAL_MAGIC_SIZE) ||
+         ( readU32(header + CACHE_JOURNAL_MAGIC_SIZE) != version ) ) {
+        return false;
+    }
+    *generation = readU32(header + CACHE_JOURNAL_MAGIC_SIZE + 4);
+
+    return true;
+}
+
+void
+writeRecord(std::string* buf,
+            RecordTypeEnum type,
+            U64 hash,
+            const std::string& filePath,
+            U64 dataOffset,
+            U64 dataSize,
+            const std::string& payload)
+{
+    std::size_t bodySize = CACHE_JOURNAL_RECORD_MIN_BODY_SIZE + filePath.size() + payload.size();
+
+    writeU32(buf, (U32)bodySize);
+    std::size_t bodyStart = buf->size();
+    buf->push_back( (char)type );
+    writeU64(buf, hash);
+    writeU64(buf, dataOffset);
+    writeU64(buf, dataSize);
+    writeU32(buf, (U32)filePath.size());
+    buf->append(filePath);
+    writeU32(buf, (U32)payload.size());
+    buf->append(payload);
+    writeU32( buf, checksum(buf->data() + bodyStart, bodySize) );
+}
+
+/**
+ * @brief Decodes the body of a record. Returns false if the lengths it contains are not consistent with its size.
+ **/
+bool
+parseRecordBody(const std::string& body,
+                std::size_t bodySize,
+                RecordTypeEnum* type,
+                CacheJournal::Record* record)
+{
+    const char* p = body.data();
+    const char* end = p + bodySize;
+
+    *type = (RecordTypeEnum)(unsigned char)p[0];
+    if ( (*type != eRecordTypeAdd) && (*type != eRecordTypeRemove) ) {
+        return false;
+    }
+    p += 1;
+    record->hash = readU64(p);
+    p += 8;
+    record->dataOffset = readU64(p);
+    p += 8;
+    record->dataSize = readU64(p);
+    p += 8;
+    U32 pathLen = readU32(p);
+    p += 4;
+    if ( (std::size_t)(end - p) < (std::size_t)pathLen + 4 ) {
+        return false;
+    }
+    record->filePath.assign(p, pathLen);
+    p += pathLen;
+    U32 payloadLen = readU32(p);
+    p += 4;
+    if ( (std::size_t)(end - p) != payloadLen ) {
+        return false;
+    }
+    record->payload.assign(p, payloadLen);
+
+    return true;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+struct CacheJournalPrivate
+{
+    const std::string filePath;
+    const unsigned int version;
+
+    // Protects file. Held while writing so that buffers are written in the order they were filled.
+    QMutex fileMutex;
+    FStreamsSupport::ofstream file;
+
+    // Protects buffer and opened
+    QMutex bufferMutex;
+    std::string buffer;
+    bool opened;
+
+    // The lock file shared with the other processes using the journal, opened on first use
+    mutable bool lockFileOpened;
+#ifdef __NATRON_WIN32__
+    mutable HANDLE lockFile;
+#else
+    mutable int lockFile;
+#endif
+
+    // The generation and size of the journal file when it was last replayed
+    mutable bool replayed;
+    mutable U32 replayedGeneration;
+    mutable U64 replayedSize;
+
+    CacheJournalPrivate(const std::string& filePath,
+                        unsigned int version)
+        : filePath(filePath)
+        , version(version)
+        , fileMutex()
+        , file()
+        , bufferMutex()
+        , buffer()
+        , opened(false)
+        , lockFileOpened(false)
+#ifdef __NATRON_WIN32__
+        , lockFile(INVALID_HANDLE_VALUE)
+#else
+        , lockFile(-1)
+#endif
+        , replayed(false)
+        , replayedGeneration(0)
+        , replayedSize(0)
+    {
+    }
+
+    ~CacheJournalPrivate()
+    {
+        // Closing the lock file releases the locks held on it
+#ifdef __NATRON_WIN32__
+        if (lockFile != INVALID_HANDLE_VALUE) {
+            ::CloseHandle(lockFile);
+        }
+#else
+        if (lockFile != -1) {
+            ::close(lockFile);
+        }
+#endif
+    }
+
+    bool lockRange(int range,
+                   bool exclusive,
+                   bool wait) const
+    {
+#ifdef __NATRON_WIN32__
+        OVERLAPPED overlapped;
+        std::memset( &overlapped, 0, sizeof(overlapped) );
+        overlapped.Offset = range;
+        DWORD flags = (exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0) | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+
+        return ::LockFileEx(lockFile, flags, 0, 1, 0, &overlapped) != 0;
+#else
+        struct flock fl;
+        std::memset( &fl, 0, sizeof(fl) );
+        fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+        fl.l_whence = SEEK_SET;
+        fl.l_start = range;
+        fl.l_len = 1;
+        int ret;
+        do {
+            ret = ::fcntl(lockFile, wait ? F_SETLKW : F_SETLK, &fl);
+        } while ( (ret == -1) && (errno == EINTR) );
+
+        return ret != -1;
+#endif
+    }
+
+    void unlockRange(int range) const
+    {
+#ifdef __NATRON_WIN32__
+        OVERLAPPED overlapped;
+        std::memset( &overlapped, 0, sizeof(overlapped) );
+        overlapped.Offset = range;
+        ::UnlockFileEx(lockFile, 0, 1, 0, &overlapped);
+#else
+        struct flock fl;
+        std::memset( &fl, 0, sizeof(fl) );
+        fl.l_type = F_UNLCK;
+        fl.l_whence = SEEK_SET;
+        fl.l_start = range;
+        fl.l_len = 1;
+        ::fcntl(lockFile, F_SETLK, &fl);
+#endif
+    }
+
+    /**
+     * @brief Opens the lock file and registers this process as a user of the journal.
+     * Returns false if the lock file cannot be created, in which case the journal is used without locking.
+     **/
+    bool openLockFile() const
+    {
+        if (lockFileOpened) {
+#ifdef __NATRON_WIN32__
+            return lockFile != INVALID_HANDLE_VALUE;
+#else
+            return lockFile != -1;
+#endif
+        }
+        lockFileOpened = true;
+        std::string lockFilePath = filePath + CACHE_JOURNAL_LOCK_FILE_EXT;
+#ifdef __NATRON_WIN32__
+        std::wstring wpath = Global::utf8_to_utf16(lockFilePath);
+        lockFile = ::CreateFileW(wpath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                 0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+        if (lockFile == INVALID_HANDLE_VALUE) {
+#else
+        lockFile = ::open(lockFilePath.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+        if (lockFile == -1) {
+#endif
+            qDebug() << "Failed to open" << lockFilePath.c_str() << ", the cache journal cannot be shared with other processes";
+
+            return false;
+        }
+        lockRange(CACHE_JOURNAL_LOCK_USERS, false, true);
+
+        return true;
+    }
+
+    bool isSoleUser() const
+    {
+        if ( !openLockFile() ) {
+            return true;
+        }
+#ifdef __NATRON_WIN32__
+        // Locks cannot be converted on Windows
+        unlockRange(CACHE_JOURNAL_LOCK_USERS);
+        bool ret = lockRange(CACHE_JOURNAL_LOCK_USERS, true, false);
+        if (ret) {
+            unlockRange(CACHE_JOURNAL_LOCK_USERS);
+        }
+        lockRange(CACHE_JOURNAL_LOCK_USERS, false, true);
+#else
+        // Converting the shared lock to an exclusive one only succeeds if no other process holds a lock
+        bool ret = lockRange(CACHE_JOURNAL_LOCK_USERS, true, false);
+        if (ret) {
+            lockRange(CACHE_JOURNAL_LOCK_USERS, false, true);
+        }
+#endif
+
+        return ret;
+    }
+
+    void writeBuffer();
+};
+
+/**
+ * @brief Locks the journal file against other processes, the locking thread must also hold fileMutex
+ * if the journal is shared between threads.
+ **/
+class JournalFileLocker
+{
+    const CacheJournalPrivate* _imp;
+    bool _locked;
+
+public:
+
+    JournalFileLocker(const CacheJournalPrivate* imp)
+        : _imp(imp)
+        , _locked(false)
+    {
+        if ( _imp->openLockFile() ) {
+            _locked = _imp->lockRange(CACHE_JOURNAL_LOCK_WRITE, true, true);
+        }
+    }
+
+    ~JournalFileLocker()
+    {
+        if (_locked) {
+            _imp->unlockRange(CACHE_JOURNAL_LOCK_WRITE);
+        }
+    }
+};
+
+void
+CacheJournalPrivate::writeBuffer()
+{
+    // fileMutex must be locked
+    std::string toWrite;
+    {
+        QMutexLocker k(&bufferMutex);
+        toWrite.swap(buffer);
+    }
+    if ( toWrite.empty() || !file.is_open() ) {
+        return;
+    }
+    // Other processes append to the same file
+    JournalFileLocker lock(this);
+    file.write( toWrite.data(), (std::streamsize)toWrite.size() );
+    // Hand the records to the OS right away so that they survive a crash of the application
+    file.flush();
+    if (!file) {
+        qDebug() << "Failed to write the cache journal" << filePath.c_str();
+    }
+}
+
+CacheJournal::CacheJournal(const std::string& filePath,
+                           unsigned int version)
+    : _imp( new CacheJournalPrivate(filePath, version) )
+{
+}
+
+CacheJournal::~CacheJournal()
+{
+    close();
+}
+
+const std::string&
+CacheJournal::getFilePath() const
+{
+    return _imp->filePath;
+}
+
+bool
+CacheJournal::isSoleUser() const
+{
+    return _imp->isSoleUser();
+}
+
+bool
+CacheJournal::replay(std::vector<Record>* records) const
+{
+    JournalFileLocker lock( _imp.get() );
+    FStreamsSupport::ifstream ifile;
+
+    _imp->replayed = false;
+    FStreamsSupport::open(&ifile, _imp->filePath, std::ios_base::in | std::ios_base::binary);
+    if (!ifile) {
+        return false;
+    }
+
+    ifile.seekg(0, std::ios_base::end);
+    U64 fileSize = (U64)ifile.tellg();
+    ifile.seekg(0, std::ios_base::beg);
+
+    U32 generation;
+    if ( !readHeader(ifile, _imp->version, &generation) ) {
+        return false;
+    }
+
+    // For each location, the index in all of the record that added the entry currently stored there.
+    // Locations are indexed by a digest of the path and offset, records with the same digest are told apart by comparing them.
+    typedef boost::unordered_multimap<U64, std::size_t> LocationMap;
+    LocationMap locations;
+    // A deque does not copy the records when growing
+    std::deque<Record> all;
+    std::vector<bool> alive;
+    std::string body;
+    Record record;
+    for (;;) {
+        char sizeBuf[4];
+        if ( !ifile.read(sizeBuf, 4) ) {
+            break;
+        }
+        U32 bodySize = readU32(sizeBuf);
+        if ( (bodySize < CACHE_JOURNAL_RECORD_MIN_BODY_SIZE) || (bodySize > CACHE_JOURNAL_RECORD_MAX_BODY_SIZE) ) {
+            qDebug() << "Corrupted record in the cache journal" << _imp->filePath.c_str() << ", ignoring the rest of it";
+            break;
+        }
+        body.resize(bodySize + 4);
+        if ( !ifile.read(&body[0], bodySize + 4) ) {
+            // The application was killed while writing the last record
+            break;
+        }
+        RecordTypeEnum type;
+        if ( ( checksum(body.data(), bodySize) != readU32(body.data() + bodySize) ) ||
+             !parseRecordBody(body, bodySize, &type, &record) ) {
+            qDebug() << "Corrupted record in the cache journal" << _imp->filePath.c_str() << ", ignoring the rest of it";
+            break;
+        }
+
+        if ( all.empty() ) {
+            // Avoid rehashing while loading large journals, assuming records have about the same size
+            std::size_t recordSize = bodySize + 8;
+            locations.reserve( (std::size_t)( fileSize / recordSize ) );
+        }
+
+        // Find the entry currently stored at the location of the record, if any
+        U64 digest = locationDigest(record.filePath, record.dataOffset);
+        LocationMap::iterator found = locations.end();
+        std::pair<LocationMap::iterator, LocationMap::iterator> range = locations.equal_range(digest);
+        for (LocationMap::iterator it = range.first; it != range.second; ++it) {
+            const Record& other = all[it->second];
+            if ( (other.dataOffset == record.dataOffset) && (other.filePath == record.filePath) ) {
+                found = it;
+                break;
+            }
+        }
+        if ( found != locations.end() ) {
+            alive[found->second] = false;
+            locations.erase(found);
+        }
+
+        if (type == eRecordTypeAdd) {
+            locations.insert( std::make_pair( digest, all.size() ) );
+            all.push_back( Record() );
+            std::swap(all.back(), record);
+            alive.push_back(true);
+        }
+    }
+
+    // Records appended by other processes from now on are kept when the journal is compacted, see open()
+    _imp->replayed = true;
+    _imp->replayedGeneration = generation;
+    _imp->replayedSize = fileSize;
+
+    records->clear();
+    records->reserve( locations.size() );
+    for (std::size_t i = 0; i < all.size(); ++i) {
+        if (alive[i]) {
+            records->push_back(Record());
+            std::swap(records->back(), all[i]);
+        }
+    }
+
+    return true;
+} // CacheJournal::replay
+
+bool
+CacheJournal::open(const std::vector<Record>& records)
+{
+    QMutexLocker k(&_imp->fileMutex);
+
+    if ( _imp->file.is_open() ) {
+        _imp->file.close();
+    }
+    {
+        QMutexLocker b(&_imp->bufferMutex);
+        _imp->buffer.clear();
+        _imp->opened = false;
+    }
+
+    JournalFileLocker lock( _imp.get() );
+    bool compact = true;
+    U32 generation = 0;
+    // The records appended by other processes since the journal was replayed
+    std::string tail;
+    {
+        FStreamsSupport::ifstream ifile;
+        FStreamsSupport::open(&ifile, _imp->filePath, std::ios_base::in | std::ios_base::binary);
+        U32 currentGeneration;
+        if ( ifile && readHeader(ifile, _imp->version, &currentGeneration) ) {
+            generation = currentGeneration + 1;
+            if (_imp->replayed) {
+                if (currentGeneration != _imp->replayedGeneration) {
+                    // Another process compacted the journal in-between: it already has the entries we restored
+                    compact = false;
+                } else {
+                    ifile.seekg(0, std::ios_base::end);
+                    U64 fileSize = (U64)ifile.tellg();
+                    if (fileSize > _imp->replayedSize) {
+                        tail.resize( (std::size_t)(fileSize - _imp->replayedSize) );
+                        ifile.seekg( (std::streamoff)_imp->replayedSize, std::ios_base::beg );
+                        if ( !ifile.read( &tail[0], (std::streamsize)tail.size() ) ) {
+                            tail.clear();
+                        }
+                    }
+                }
+            }
+        }
+    }
+    _imp->replayed = false;
+
+    if (compact) {
+        std::string buf;
+        writeHeader(&buf, _imp->version, generation);
+
+        // When no other process uses the journal, write the compacted journal next to the current one and swap them,
+        // so that a crash in-between leaves the current journal untouched. Otherwise it must be rewritten in place
+        // because the other processes keep appending to the opened file.
+        bool inPlace = !_imp->isSoleUser();
+        std::string writtenFilePath = inPlace ? _imp->filePath : _imp->filePath + ".tmp";
+        FStreamsSupport::ofstream ofile;
+        FStreamsSupport::open(&ofile, writtenFilePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        if (!ofile) {
+            qDebug() << "Failed to create the cache journal" << writtenFilePath.c_str();
+
+            return false;
+        }
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            const Record& r = records[i];
+            writeRecord(&buf, eRecordTypeAdd, r.hash, r.filePath, r.dataOffset, r.dataSize, r.payload);
+            if (buf.size() >= 1024 * 1024) {
+                ofile.write( buf.data(), (std::streamsize)buf.size() );
+                buf.clear();
+            }
+        }
+        buf.append(tail);
+        ofile.write( buf.data(), (std::streamsize)buf.size() );
+        ofile.close();
+        if (!ofile) {
+            qDebug() << "Failed to write the cache journal" << writtenFilePath.c_str();
+            if (!inPlace) {
+                QFile::remove( QString::fromUtf8( writtenFilePath.c_str() ) );
+            }
+
+            return false;
+        }
+
+        if (!inPlace) {
+            QString filePath = QString::fromUtf8( _imp->filePath.c_str() );
+            QFile::remove(filePath);
+            if ( !QFile::rename(QString::fromUtf8( writtenFilePath.c_str() ), filePath) ) {
+                qDebug() << "Failed to create the cache journal" << filePath;
+
+                return false;
+            }
+        }
+    }
+
+    FStreamsSupport::open(&_imp->file, _imp->filePath, std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+    if (!_imp->file) {
+        qDebug() << "Failed to open the cache journal" << _imp->filePath.c_str();
+        _imp->file.close();
+
+        return false;
+    }
+
+    QMutexLocker b(&_imp->bufferMutex);
+    _imp->opened = true;
+
+    return true;
+} // CacheJournal::open
+
+void
+CacheJournal::close()
+{
+    QMutexLocker k(&_imp->fileMutex);
+
+    _imp->writeBuffer();
+    if ( _imp->file.is_open() ) {
+        _imp->file.close();
+    }
+    QMutexLocker b(&_imp->bufferMutex);
+    _imp->opened = false;
+}
+
+bool
+CacheJournal::isOpen() const
+{
+    QMutexLocker b(&_imp->bufferMutex);
+
+    return _imp->opened;
+}
+
+void
+CacheJournal::appendAdd(const Record& record)
+{
+    QMutexLocker b(&_imp->bufferMutex);
+
+    if (!_imp->opened) {
+        return;
+    }
+    writeRecord(&_imp->buffer, eRecordTypeAdd, record.hash, record.filePath, record.dataOffset, record.dataSize, record.payload);
+}
+
+void
+CacheJournal::appendRemove(U64 hash,
+                           const std::string& filePath,
+                           U64 dataOffset)
+{
+    QMutexLocker b(&_imp->bufferMutex);
+
+    if (!_imp->opened) {
+        return;
+    }
+    writeRecord(&_imp->buffer, eRecordTypeRemove, hash, filePath, dataOffset, 0, std::string());
+}
+
+void
+CacheJournal::flush()
+{
+    QMutexLocker k(&_imp->fileMutex);
+
+    _imp->writeBuffer();
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,139 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_CacheJournal_h
+#define Natron_Engine_CacheJournal_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+#include "Engine/EngineFwd.h"
+
+#define NATRON_CACHE_JOURNAL_FILE_NAME "journal." NATRON_CACHE_FILE_EXT
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief An append-only log of the entries of a persistent cache, so that the cache can be restored at startup
+ * even if the application was not closed properly.
+ *
+ * Each record either adds an entry, whose data is stored in a backing file (at an offset for tiled caches), or
+ * removes the entry stored at that location. Replaying the journal keeps, for each location, the last entry added
+ * that was not removed afterwards. Records end with a checksum: replay stops at the first incomplete or corrupted
+ * record, which only loses the entries written last before a crash.
+ *
+ * The journal does not know about the type of the entries: their key and parameters are an opaque payload
+ * serialized by the cache.
+ * All functions are thread-safe. Appended records are buffered in memory until flush() is called.
+ *
+ * Several processes may use the same journal: reading, compacting and writing to the file is done under an exclusive
+ * lock of a file next to the journal, so that records of different processes are never interleaved.
+ **/
+struct CacheJournalPrivate;
+class CacheJournal
+{
+public:
+
+    struct Record
+    {
+        U64 hash;
+        std::string filePath;
+        U64 dataOffset;
+        U64 dataSize;
+        std::string payload;
+
+        Record()
+            : hash(0)
+            , filePath()
+            , dataOffset(0)
+            , dataSize(0)
+            , payload()
+        {
+        }
+    };
+
+    /**
+     * @brief The journal is stored in filePath. Journals written with a different version are discarded.
+     **/
+    CacheJournal(const std::string& filePath,
+                 unsigned int version);
+
+    // Flushes and closes the journal
+    ~CacheJournal();
+
+    const std::string& getFilePath() const;
+
+    /**
+     * @brief Returns true if no other process is using the journal. Otherwise the files of the cache that are not
+     * referenced by the journal must not be removed: they may belong to entries that other processes did not journal yet.
+     **/
+    bool isSoleUser() const;
+
+    /**
+     * @brief Reads the journal file and returns the entries it contains, in the order they were added.
+     * Returns false if the file does not exist or was not written by a journal with the same version.
+     **/
+    bool replay(std::vector<Record>* records) const;
+
+    /**
+     * @brief Rewrites the journal file with only the given records, then opens it so that new records can be appended.
+     * If the journal was replayed before, the records appended since by other processes are kept, and the file is
+     * left as is if another process rewrote it in-between.
+     * Returns false if the file could not be written, in which case the journal is closed.
+     **/
+    bool open(const std::vector<Record>& records);
+
+    /**
+     * @brief Flushes the pending records and closes the file. Records appended afterwards are ignored.
+     **/
+    void close();
+
+    bool isOpen() const;
+
+    void appendAdd(const Record& record);
+
+    void appendRemove(U64 hash,
+                      const std::string& filePath,
+                      U64 dataOffset);
+
+    /**
+     * @brief Writes the records appended since the last call to the file.
+     **/
+    void flush();
+
+private:
+
+    boost::scoped_ptr<CacheJournalPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_CacheJournal_h
@@ -51,10 +51,6 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/FrameParamsSerialization.h"
 #include "Engine/EngineFwd.h"
 
-// Note: these classes are used for cache serialization and do not have to maintain backward compatibility
-#define SERIALIZED_ENTRY_INTRODUCES_SIZE 2
-#define SERIALIZED_ENTRY_VERSION SERIALIZED_ENTRY_INTRODUCES_SIZE
-
 //Beyond that percentage of occupation, the cache will start evicting LRU entries
 #define NATRON_CACHE_LIMIT_PERCENT 0.9
 
@@ -63,58 +59,96 @@ GCC_DIAG_ON(unused-parameter)
 
 NATRON_NAMESPACE_ENTER;
 
-/*Saves cache to disk as a settings file.
- */
 template<typename EntryType>
-void
-Cache<EntryType>::save(CacheTOC* tableOfContents)
+std::string
+Cache<EntryType>::serializeJournalPayload(const EntryTypePtr& entry) const
 {
-    clearInMemoryPortion(false);
+    std::ostringstream ss;
     {
-        QMutexLocker l(&_lock);     // must be locked
-
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            std::list<EntryTypePtr> & listOfValues  = getValueFromIterator(it);
-            for (typename std::list<EntryTypePtr>::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
-                if ( (*it2)->isStoredOnDisk() ) {
-                    SerializedEntry serialization;
-                    serialization.hash = (*it2)->getHashKey();
-                    serialization.params = (*it2)->getParams();
-                    serialization.key = (*it2)->getKey();
-                    serialization.size = (*it2)->dataSize();
-                    serialization.filePath = (*it2)->getFilePath();
-                    serialization.dataOffsetInFile = (*it2)->getOffsetInFile();
-
-                    (*it2)->syncBackingFile();
-                    
-                    tableOfContents->push_back(serialization);
-#ifdef DEBUG
-                    if ( !_isTiled && !CacheAPI::checkFileNameMatchesHash(serialization.filePath, serialization.hash) ) {
-                        qDebug() << "WARNING: Cache entry filename is not the same as the serialized hash key";
-                    }
-#endif
-                }
-            }
-        }
+        // Each record has its own archive so that it can be read independently of the others
+        boost::archive::binary_oarchive oArchive(ss, boost::archive::no_header);
+        const typename EntryType::key_type& key = entry->getKey();
+        const ParamsTypePtr params = entry->getParams();
+        oArchive << key;
+        oArchive << params;
     }
+
+    return ss.str();
 }
 
-/*Restores the cache from disk.*/
 template<typename EntryType>
-void
-Cache<EntryType>::restore(const CacheTOC & tableOfContents)
+bool
+Cache<EntryType>::startJournal(CacheJournal* journal,
+                               const std::vector<CacheJournal::Record>& records)
+{
+    boost::scoped_ptr<CacheJournal> newJournal(journal);
+    QMutexLocker k(&_journalSyncMutex);
+    QMutexLocker l(&_journalMutex);
+
+    _journalOpened = false;
+    _journalPending.clear();
+    _journal.reset();
+    if ( !newJournal->open(records) ) {
+        return false;
+    }
+    _journal.swap(newJournal);
+    _journalPayloadSerializer = &Cache<EntryType>::serializeJournalPayload;
+    _journalOpened = true;
+
+    return true;
+}
+
+template<typename EntryType>
+bool
+Cache<EntryType>::openJournal()
 {
-    ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
-    ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
-    std::list<EntryTypePtr> entriesToBeDeleted;
+    return startJournal( new CacheJournal(getJournalFilePath(), _version), std::vector<CacheJournal::Record>() );
+}
 
+template<typename EntryType>
+bool
+Cache<EntryType>::restoreFromJournal()
+{
+    std::vector<CacheJournal::Record> records;
+    // The same journal replays and is opened, so that entries journaled meanwhile by other processes are not lost
+    boost::scoped_ptr<CacheJournal> journal( new CacheJournal(getJournalFilePath(), _version) );
+    if ( !journal->replay(&records) ) {
+        return false;
+    }
+
+    // Other processes using the cache may have stored entries that they did not journal yet
+    restore( &records, journal->isSoleUser() );
+
+    // The journal is rewritten with only the restored entries
+    return startJournal(journal.release(), records);
+}
+
+template<typename EntryType>
+void
+Cache<EntryType>::restore(std::vector<CacheJournal::Record>* records,
+                          bool removeUnusedFiles)
+{
     std::set<QString> usedFilePaths;
-    for (typename CacheTOC::const_iterator it =
-             tableOfContents.begin(); it != tableOfContents.end(); ++it) {
-        if ( it->hash != it->key.getHash() ) {
+    std::size_t nRestored = 0;
+
+    for (std::size_t i = 0; i < records->size(); ++i) {
+        CacheJournal::Record& record = (*records)[i];
+        typename EntryType::key_type key;
+        ParamsTypePtr params;
+        try {
+            std::istringstream ss(record.payload);
+            boost::archive::binary_iarchive iArchive(ss, boost::archive::no_header);
+            iArchive >> key;
+            iArchive >> params;
+        } catch (const std::exception & e) {
+            qDebug() << "Failed to read cache journal entry:" << e.what();
+            continue;
+        }
+
+        if ( record.hash != key.getHash() ) {
             /*
-             * If this warning is printed this means that the value computed by it->key()
-             * is different than the value stored prior to serialiazing this entry. In other words there're
+             * If this warning is printed this means that the value computed by key.getHash()
+             * is different than the value stored prior to journaling this entry. In other words there're
              * 2 possibilities:
              * 1) The key has changed since it has been added to the cache: maybe you forgot to serialize some
              * members of the key or you didn't save them correctly.
@@ -125,39 +159,53 @@ Cache<EntryType>::restore(const CacheTOC & tableOfContents)
         }
 
 #ifdef DEBUG
-        if ( !_isTiled && !checkFileNameMatchesHash(it->filePath, it->hash) ) {
+        if ( !_isTiled && !checkFileNameMatchesHash(record.filePath, record.hash) ) {
             qDebug() << "WARNING: Cache entry filename is not the same as the serialized hash key";
         }
 #endif
 
-        EntryType* value = NULL;
+        if ( _isTiled && (record.dataSize != getTileSizeBytes()) ) {
+            continue;
+        }
 
+        EntryTypePtr value;
         try {
-            value = new EntryType(it->key, it->params, this);
-            if (it->size != getTileSizeBytes()) {
-                continue;
-            }
+            value.reset( new EntryType(key, params, this) );
             ///This will not put the entry back into RAM, instead we just insert back the entry into the disk cache
-            value->restoreMetaDataFromFile(it->size, it->filePath, it->dataOffsetInFile);
+            value->restoreMetaDataFromFile(record.dataSize, record.filePath, record.dataOffset);
         } catch (const std::exception & e) {
             qDebug() << e.what();
             continue;
         }
-        const std::string& filePath = value->getFilePath();
-        usedFilePaths.insert(QString::fromUtf8(filePath.c_str()));
+        usedFilePaths.insert( QString::fromUtf8( record.filePath.c_str() ) );
         {
-            QMutexLocker locker(&_lock);
-            sealEntry(EntryTypePtr(value), false /*inMemory*/);
+            CacheShard& shard = getShard( value->getHashKey() );
+            QMutexLocker locker(&shard.lock);
+            sealEntry(shard, value, false /*inMemory*/);
+        }
+
+        // Keep the restored records at the front of the list
+        if (nRestored != i) {
+            std::swap( (*records)[nRestored], record );
         }
+        ++nRestored;
     }
+    records->resize(nRestored);
 
-    // Remove from the cache all files that are not referenced by the table of contents
+    if (!removeUnusedFiles) {
+        return;
+    }
+
+    // Remove from the cache all files that are not referenced by the journal
     QString cachePath = getCachePath();
     if (isTileCache()) {
         QDir cacheFolder(cachePath);
         QString absolutePath = cacheFolder.absolutePath();
         QStringList etr = cacheFolder.entryList(QDir::NoDotAndDotDot);
         for (QStringList::iterator it = etr.begin(); it!=etr.end(); ++it) {
+            if ( it->startsWith( QString::fromUtf8(NATRON_CACHE_JOURNAL_FILE_NAME) ) ) {
+                continue;
+            }
             QString entryFilePath = absolutePath + QLatin1Char('/') + *it;
 
             std::set<QString>::iterator foundUsed = usedFilePaths.find(entryFilePath);
@@ -189,40 +237,7 @@ Cache<EntryType>::restore(const CacheTOC & tableOfContents)
         }
 
     }
-}
-
-template<typename EntryType>
-struct Cache<EntryType>::SerializedEntry
-{
-    hash_type hash;
-    typename EntryType::key_type key;
-    ParamsTypePtr params;
-    std::size_t size; //< the data size in bytes
-    std::string filePath; //< we need to serialize it as several entries can have the same hash, hence we index them
-    std::size_t dataOffsetInFile;
-
-    SerializedEntry()
-        : hash(0)
-          , key()
-          , params()
-          , size(0)
-          , filePath()
-          , dataOffsetInFile(0)
-    {
-    }
-
-    template<class Archive>
-    void serialize(Archive & ar,
-                   const unsigned int /*version*/)
-    {
-        ar & ::boost::serialization::make_nvp("Hash", hash);
-        ar & ::boost::serialization::make_nvp("Key", key);
-        ar & ::boost::serialization::make_nvp("Params", params);
-        ar & ::boost::serialization::make_nvp("Size", size);
-        ar & ::boost::serialization::make_nvp("Filename", filePath);
-        ar & ::boost::serialization::make_nvp("Offset", dataOffsetInFile);
-    }
-};
+} // restore
 
 NATRON_NAMESPACE_EXIT;
 
@@ -53,23 +53,6 @@ struct KeyFrameCloner
     }
 };
 
-class KeyFrameTimePredicate
-{
-public:
-    KeyFrameTimePredicate(double t)
-        : _t(t)
-    {
-    };
-
-    bool operator()(const KeyFrame & f)
-    {
-        return f.getTime() == _t;
-    }
-
-private:
-    double _t;
-};
-
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 
@@ -279,6 +262,7 @@ Curve::clearKeyFrames()
     QMutexLocker l(&_imp->_lock);
 
     _imp->keyFrames.clear();
+    _imp->invalidateKeyFramesSnapshot();
 }
 
 bool
@@ -394,6 +378,40 @@ Curve::addKeyFrame(KeyFrame key)
     return it.second;
 }
 
+int
+Curve::addKeyFrames(const std::list<KeyFrame>& keys,
+                    std::list<double>* keysAdded)
+{
+    QMutexLocker l(&_imp->_lock);
+    bool constantInterp = (_imp->type == CurvePrivate::eCurveTypeBool) || (_imp->type == CurvePrivate::eCurveTypeString) ||
+                          (_imp->type == CurvePrivate::eCurveTypeIntConstantInterp);
+    std::vector<double> times;
+    int nAdded = 0;
+
+    for (std::list<KeyFrame>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        KeyFrame key(*it);
+        if (constantInterp) {
+            key.setInterpolation(eKeyframeTypeConstant);
+        }
+        std::pair<KeyFrameSet::iterator, bool> newKey = addKeyFrameNoUpdate(key);
+        times.push_back( newKey.first->getTime() );
+        if (newKey.second) {
+            ++nAdded;
+            if (keysAdded) {
+                keysAdded->push_back( newKey.first->getTime() );
+            }
+        }
+    }
+    if ( times.empty() ) {
+        return 0;
+    }
+    std::sort( times.begin(), times.end() );
+    refreshDerivativesAroundTimes(times);
+    onCurveChanged();
+
+    return nAdded;
+}
+
 std::pair<KeyFrameSet::iterator, bool> Curve::addKeyFrameNoUpdate(const KeyFrame & cp)
 {
     // PRIVATE - should not lock
@@ -535,6 +553,32 @@ Curve::removeKeyFramesAfterTime(double time,
     onCurveChanged();
 }
 
+void
+Curve::removeKeyFramesWithTimes(const std::list<double>& times,
+                                std::list<double>* keysRemoved)
+{
+    QMutexLocker l(&_imp->_lock);
+    std::vector<double> removedTimes;
+
+    for (std::list<double>::const_iterator it = times.begin(); it != times.end(); ++it) {
+        KeyFrameSet::iterator found = find(*it);
+        if ( found == _imp->keyFrames.end() ) {
+            continue;
+        }
+        _imp->keyFrames.erase(found);
+        removedTimes.push_back(*it);
+        if (keysRemoved) {
+            keysRemoved->push_back(*it);
+        }
+    }
+    if ( removedTimes.empty() ) {
+        return;
+    }
+    std::sort( removedTimes.begin(), removedTimes.end() );
+    refreshDerivativesAroundTimes(removedTimes);
+    onCurveChanged();
+}
+
 bool
 Curve::getKeyFrameWithIndex(int index,
                             KeyFrame* k) const
@@ -764,65 +808,143 @@ interParams(const KeyFrameSet &keyFrames,
     }
 }
 
-double
-Curve::getValueAt(double t,
-                  bool doClamp) const
+CurvePrivate::KeyFramesSnapshotPtr
+CurvePrivate::getKeyFramesSnapshot() const
 {
-    QMutexLocker l(&_imp->_lock);
+    KeyFramesSnapshotPtr snapshot = boost::atomic_load(&keyFramesSnapshot);
 
-    if ( _imp->keyFrames.empty() ) {
-        throw std::runtime_error("Curve has no control points!");
+    if (snapshot) {
+        return snapshot;
     }
 
-    double v;
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double>::const_iterator foundCached = _imp->resultCache.find(t);
-    if ( foundCached != _imp->resultCache.end() ) {
-        v = foundCached->second;
-    } else
-#endif
-    {
-        // even when there is only one keyframe, there may be tangents!
-        //if (_imp->keyFrames.size() == 1) {
-        //    //if there's only 1 keyframe, don't bother interpolating
-        //    return (*_imp->keyFrames.begin()).getValue();
-        //}
-        double tcur, tnext;
-        double vcurDerivRight, vnextDerivLeft, vcur, vnext;
-        KeyframeTypeEnum interp, interpNext;
-        KeyFrame k(t, 0.);
-        // find the first keyframe with time greater than t
-        KeyFrameSet::const_iterator itup;
-        itup = _imp->keyFrames.upper_bound(k);
-        interParams(_imp->keyFrames,
-                    t,
-                    itup,
-                    &tcur,
-                    &vcur,
-                    &vcurDerivRight,
-                    &interp,
-                    &tnext,
-                    &vnext,
-                    &vnextDerivLeft,
-                    &interpNext);
+    // The keyframes changed since the last snapshot was taken
+    QMutexLocker l(&_lock);
+    snapshot = boost::atomic_load(&keyFramesSnapshot);
+    if (!snapshot) {
+        boost::shared_ptr<KeyFramesSnapshot> newSnapshot(new KeyFramesSnapshot);
+        newSnapshot->times.reserve( keyFrames.size() );
+        newSnapshot->values.reserve( keyFrames.size() );
+        newSnapshot->leftDerivatives.reserve( keyFrames.size() );
+        newSnapshot->rightDerivatives.reserve( keyFrames.size() );
+        newSnapshot->interpolations.reserve( keyFrames.size() );
+        for (KeyFrameSet::const_iterator it = keyFrames.begin(); it != keyFrames.end(); ++it) {
+            newSnapshot->times.push_back( it->getTime() );
+            newSnapshot->values.push_back( it->getValue() );
+            newSnapshot->leftDerivatives.push_back( it->getLeftDerivative() );
+            newSnapshot->rightDerivatives.push_back( it->getRightDerivative() );
+            newSnapshot->interpolations.push_back( it->getInterpolation() );
+        }
+        newSnapshot->type = type;
+
+        std::size_t nKeys = newSnapshot->times.size();
+        newSnapshot->uniformTimes = false;
+        newSnapshot->firstTime = 0.;
+        newSnapshot->timeStep = 0.;
+        if (nKeys >= NATRON_CURVE_UNIFORM_LOOKUP_MIN_KEYFRAMES) {
+            double firstTime = newSnapshot->times.front();
+            double timeStep = (newSnapshot->times.back() - firstTime) / (nKeys - 1);
+            // The lookup corrects small errors, but the index computed from the time must be off by one at most
+            double tolerance = timeStep * 1e-3;
+            bool uniform = timeStep > 0.;
+            for (std::size_t i = 1; uniform && i < nKeys; ++i) {
+                uniform = std::abs(newSnapshot->times[i] - (firstTime + i * timeStep) ) <= tolerance;
+            }
+            newSnapshot->uniformTimes = uniform;
+            newSnapshot->firstTime = firstTime;
+            newSnapshot->timeStep = timeStep;
+        }
+        snapshot = newSnapshot;
+        boost::atomic_store(&keyFramesSnapshot, snapshot);
+    }
 
-        v = Interpolation::interpolate(tcur, vcur,
-                                       vcurDerivRight,
-                                       vnextDerivLeft,
-                                       tnext, vnext,
-                                       t,
-                                       interp,
-                                       interpNext);
-#ifdef NATRON_CURVE_USE_CACHE
-        _imp->resultCache[t] = v;
-#endif
+    return snapshot;
+}
+
+/// returns the index of the first keyframe of the snapshot with time > t,
+/// like std::upper_bound but in constant time if the keyframes are evenly spaced
+static std::size_t
+upperBoundSnapshot(const CurvePrivate::KeyFramesSnapshot& keys,
+                   double t)
+{
+    const std::vector<double>& times = keys.times;
+
+    if (!keys.uniformTimes) {
+        return std::upper_bound(times.begin(), times.end(), t) - times.begin();
     }
 
-    if ( doClamp && mustClamp() ) {
-        v = clampValueToCurveYRange(v);
+    std::size_t nKeys = times.size();
+    double index = std::floor( (t - keys.firstTime) / keys.timeStep ) + 1.;
+    std::size_t up;
+    if ( !(index > 0.) ) {
+        up = 0;
+    } else if (index >= (double)nKeys) {
+        up = nKeys;
+    } else {
+        up = (std::size_t)index;
+    }
+    // the keyframe times are not exactly on the grid
+    while ( (up < nKeys) && (times[up] <= t) ) {
+        ++up;
     }
+    while ( (up > 0) && (times[up - 1] > t) ) {
+        --up;
+    }
+
+    return up;
+}
+
+/// interpolate the keyframes of the snapshot at t, given the index
+/// of the next keyframe (the first with time > t), like interParams
+static double
+interpolateSnapshot(const CurvePrivate::KeyFramesSnapshot& keys,
+                    double t,
+                    std::size_t up)
+{
+    std::size_t nKeys = keys.times.size();
+
+    assert( up == nKeys || t < keys.times[up] );
+    if (up == 0) {
+        //if all keys have a greater time
+        // get the first keyframe
+        return Interpolation::interpolate(keys.times[0] - 1., keys.values[0],
+                                          0.,
+                                          keys.leftDerivatives[0],
+                                          keys.times[0], keys.values[0],
+                                          t,
+                                          eKeyframeTypeNone,
+                                          keys.interpolations[0]);
+    } else if (up == nKeys) {
+        //if we found no key that has a greater time
+        // get the last keyframe
+        std::size_t last = nKeys - 1;
+
+        return Interpolation::interpolate(keys.times[last], keys.values[last],
+                                          keys.rightDerivatives[last],
+                                          0.,
+                                          keys.times[last] + 1., keys.values[last],
+                                          t,
+                                          keys.interpolations[last],
+                                          eKeyframeTypeNone);
+    } else {
+        // between two keyframes
+        std::size_t cur = up - 1;
+        assert(keys.times[cur] <= t);
 
-    switch (_imp->type) {
+        return Interpolation::interpolate(keys.times[cur], keys.values[cur],
+                                          keys.rightDerivatives[cur],
+                                          keys.leftDerivatives[up],
+                                          keys.times[up], keys.values[up],
+                                          t,
+                                          keys.interpolations[cur],
+                                          keys.interpolations[up]);
+    }
+}
+
+static double
+roundValueToCurveType(CurvePrivate::CurveTypeEnum type,
+                      double v)
+{
+    switch (type) {
     case CurvePrivate::eCurveTypeString:
     case CurvePrivate::eCurveTypeInt:
 
@@ -837,8 +959,72 @@ Curve::getValueAt(double t,
 
         return v;
     }
+}
+
+double
+Curve::getValueAt(double t,
+                  bool doClamp) const
+{
+    CurvePrivate::KeyFramesSnapshotPtr keys = _imp->getKeyFramesSnapshot();
+
+    if ( keys->times.empty() ) {
+        throw std::runtime_error("Curve has no control points!");
+    }
+
+    // even when there is only one keyframe, there may be tangents!
+    // find the first keyframe with time greater than t
+    std::size_t up = upperBoundSnapshot(*keys, t);
+    double v = interpolateSnapshot(*keys, t, up);
+
+    if ( doClamp && mustClamp() ) {
+        v = clampValueToCurveYRange(v);
+    }
+
+    return roundValueToCurveType(keys->type, v);
 } // getValueAt
 
+void
+Curve::getValuesAt(const double* times,
+                   int nTimes,
+                   double* values,
+                   bool doClamp) const
+{
+    CurvePrivate::KeyFramesSnapshotPtr keys = _imp->getKeyFramesSnapshot();
+
+    if ( keys->times.empty() ) {
+        throw std::runtime_error("Curve has no control points!");
+    }
+
+    YRange minmax( -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() );
+    bool clamp = doClamp && mustClamp();
+    if (clamp) {
+        minmax = getCurveYRange();
+    }
+
+    const std::vector<double>& keyTimes = keys->times;
+    std::size_t up = 0;
+    for (int i = 0; i < nTimes; ++i) {
+        double t = times[i];
+        if (keys->uniformTimes) {
+            up = upperBoundSnapshot(*keys, t);
+        } else if ( (up > 0) && (t < keyTimes[up - 1]) ) {
+            // When times are increasing, the next keyframe is usually the same or one of the following ones
+            up = std::upper_bound(keyTimes.begin(), keyTimes.begin() + up, t) - keyTimes.begin();
+        } else if ( (up < keyTimes.size()) && (keyTimes[up] <= t) ) {
+            up = std::upper_bound(keyTimes.begin() + up, keyTimes.end(), t) - keyTimes.begin();
+        }
+        double v = interpolateSnapshot(*keys, t, up);
+        if (clamp) {
+            if (v > minmax.max) {
+                v = minmax.max;
+            } else if (v < minmax.min) {
+                v = minmax.min;
+            }
+        }
+        values[i] = roundValueToCurveType(keys->type, v);
+    }
+}
+
 double
 Curve::getDerivativeAt(double t) const
 {
@@ -1051,7 +1237,7 @@ Curve::clampValueToCurveYRange(double v) const
     if (v > minmax.max) {
         return minmax.max;
     } else if (v < minmax.min) {
-        return minmax.max;
+        return minmax.min;
     }
 
     return v;
@@ -1405,15 +1591,11 @@ Curve::refreshDerivatives(Curve::CurveChangedReasonEnum reason,
     newKey.setLeftDerivative(vcurDerivLeft);
     newKey.setRightDerivative(vcurDerivRight);
 
-    std::pair<KeyFrameSet::iterator, bool> newKeyIt = _imp->keyFrames.insert(newKey);
-
-    // keyframe at this time exists, erase and insert again
-    if (!newKeyIt.second) {
-        _imp->keyFrames.erase(newKeyIt.first);
-        newKeyIt = _imp->keyFrames.insert(newKey);
-        assert(newKeyIt.second);
-    }
-    key = newKeyIt.first;
+    // replace the keyframe, inserting the new one at the same position
+    KeyFrameSet::iterator hint = key;
+    ++hint;
+    _imp->keyFrames.erase(key);
+    key = _imp->keyFrames.insert(hint, newKey);
 
     if (reason != eCurveChangedReasonDerivativesChanged) {
         key = evaluateCurveChanged(eCurveChangedReasonDerivativesChanged, key);
@@ -1422,6 +1604,43 @@ Curve::refreshDerivatives(Curve::CurveChangedReasonEnum reason,
     return key;
 } // refreshDerivatives
 
+static bool
+hasAutomaticDerivatives(KeyframeTypeEnum interp)
+{
+    return interp != eKeyframeTypeBroken && interp != eKeyframeTypeFree && interp != eKeyframeTypeNone;
+}
+
+void
+Curve::refreshDerivativesAroundTimes(const std::vector<double>& times)
+{
+    // PRIVATE - should not lock
+    // Keyframes are refreshed in increasing time order, like adding the keyframes one after the other would.
+    // A keyframe is visited at most once, even if it is a neighbour of several times
+    bool hasVisited = false;
+    double lastVisitedTime = 0.;
+
+    for (std::vector<double>::const_iterator time = times.begin(); time != times.end(); ++time) {
+        // visit the previous keyframe, the keyframe at this time if any and the next keyframe
+        KeyFrameSet::iterator it = _imp->keyFrames.lower_bound( KeyFrame(*time, 0.) );
+        if ( it != _imp->keyFrames.begin() ) {
+            --it;
+        }
+        bool pastTime = false;
+        while ( it != _imp->keyFrames.end() && !pastTime ) {
+            double keyTime = it->getTime();
+            pastTime = keyTime > *time;
+            if ( !hasVisited || (keyTime > lastVisitedTime) ) {
+                if ( hasAutomaticDerivatives( it->getInterpolation() ) ) {
+                    it = refreshDerivatives(eCurveChangedReasonDerivativesChanged, it);
+                }
+                hasVisited = true;
+                lastVisitedTime = keyTime;
+            }
+            ++it;
+        }
+    }
+}
+
 KeyFrameSet::iterator
 Curve::evaluateCurveChanged(CurveChangedReasonEnum reason,
                             KeyFrameSet::iterator key)
@@ -1464,7 +1683,8 @@ KeyFrameSet::const_iterator
 Curve::findWithTime(const KeyFrameSet& keys,
                     double time)
 {
-    return std::find_if( keys.begin(), keys.end(), KeyFrameTimePredicate(time) );
+    // keyframes are ordered by time
+    return keys.find( KeyFrame(time, 0.) );
 }
 
 KeyFrameSet::const_iterator
@@ -1576,13 +1796,11 @@ void
 Curve::onCurveChanged()
 {
     // PRIVATE - should not lock
+    _imp->invalidateKeyFramesSnapshot();
     KnobIPtr owner = _imp->owner.lock();
     if (owner) {
-        owner->clearExpressionsResults(_imp->dimensionInOwner);
+        owner->invalidateExpressionsResults(_imp->dimensionInOwner);
     }
-#ifdef NATRON_CURVE_USE_CACHE
-    _imp->resultCache.clear();
-#endif
 }
 
 NATRON_NAMESPACE_EXIT;
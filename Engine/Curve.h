@@ -41,6 +41,10 @@
 
 #define NATRON_CURVE_X_SPACING_EPSILON 1e-6
 
+// Curves with at least this number of keyframes evenly spaced in time (e.g. a keyframe on every frame, as produced
+// by the tracker) find the keyframes surrounding a time in constant time instead of with a binary search
+#define NATRON_CURVE_UNIFORM_LOOKUP_MIN_KEYFRAMES 64
+
 NATRON_NAMESPACE_ENTER;
 
 /**
@@ -202,8 +206,22 @@ public:
     ///existing key at this time.
     bool addKeyFrame(KeyFrame key);
 
+    /**
+     * @brief Adds all the keys at once, replacing the keyframes existing at the same times. Unlike calling addKeyFrame
+     * for each key, the derivatives are refreshed once around the keys added and the curve is changed once.
+     * The times of the keyframes that did not exist before are appended to keysAdded if not NULL.
+     * @returns The number of keyframes that did not exist before.
+     **/
+    int addKeyFrames(const std::list<KeyFrame>& keys, std::list<double>* keysAdded = NULL);
+
     void removeKeyFrameWithTime(double time);
 
+    /**
+     * @brief Removes the keyframes at the given times, refreshing the derivatives once around the keyframes removed.
+     * Times without a keyframe are ignored. The times of the keyframes removed are appended to keysRemoved if not NULL.
+     **/
+    void removeKeyFramesWithTimes(const std::list<double>& times, std::list<double>* keysRemoved = NULL);
+
     void removeKeyFrameWithIndex(int index);
 
     void removeKeyFramesBeforeTime(double time, std::list<int>* keyframeRemoved);
@@ -239,6 +257,12 @@ public:
 
     double getValueAt(double t, bool clamp = true) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Same as getValueAt for each of the nTimes times, written to values. This is faster when the times
+     * are increasing, e.g. to draw the curve.
+     **/
+    void getValuesAt(const double* times, int nTimes, double* values, bool clamp = true) const;
+
     double getDerivativeAt(double t) const WARN_UNUSED_RETURN;
 
     double getIntegrateFromTo(double t1, double t2) const WARN_UNUSED_RETURN;
@@ -322,6 +346,12 @@ private:
      **/
     KeyFrameSet::iterator evaluateCurveChanged(CurveChangedReasonEnum reason, KeyFrameSet::iterator key) WARN_UNUSED_RETURN;
     KeyFrameSet::iterator refreshDerivatives(CurveChangedReasonEnum reason, KeyFrameSet::iterator key);
+
+    /**
+     * @brief Refreshes the derivatives of the keyframes at the given times and of their neighbours,
+     * each one once. The times must be sorted and may be the ones of keyframes that were removed.
+     **/
+    void refreshDerivativesAroundTimes(const std::vector<double>& times);
     KeyFrameSet::iterator setKeyFrameValueAndTimeNoUpdate(double value, double time, KeyFrameSet::iterator k) WARN_UNUSED_RETURN;
 
     bool hasYRange() const;
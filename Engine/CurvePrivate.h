@@ -27,6 +27,8 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
+
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #endif
@@ -39,8 +41,6 @@
 #include "Engine/KnobFile.h"
 #include "Engine/EngineFwd.h"
 
-//#define NATRON_CURVE_USE_CACHE
-
 NATRON_NAMESPACE_ENTER;
 
 struct CurvePrivate
@@ -55,11 +55,33 @@ struct CurvePrivate
         // and times
     };
 
+    /**
+     * @brief An immutable copy of the keyframes in flat arrays sorted by time. Render threads evaluate the curve
+     * with a binary search in the snapshot, without locking, while the keyframes are being edited.
+     * Dense curves whose keyframes are evenly spaced in time are looked up in constant time instead.
+     **/
+    struct KeyFramesSnapshot
+    {
+        std::vector<double> times;
+        std::vector<double> values;
+        std::vector<double> leftDerivatives;
+        std::vector<double> rightDerivatives;
+        std::vector<KeyframeTypeEnum> interpolations;
+        CurveTypeEnum type;
+
+        // True if there are at least NATRON_CURVE_UNIFORM_LOOKUP_MIN_KEYFRAMES keyframes and the time of
+        // keyframe i is firstTime + i * timeStep
+        bool uniformTimes;
+        double firstTime;
+        double timeStep;
+    };
+
+    typedef boost::shared_ptr<const KeyFramesSnapshot> KeyFramesSnapshotPtr;
+
     KeyFrameSet keyFrames;
 
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double> resultCache; //< a cache for interpolations
-#endif
+    // The snapshot of keyFrames, or NULL if it changed since the snapshot was taken. Accessed with boost::atomic_load/store
+    mutable KeyFramesSnapshotPtr keyFramesSnapshot;
 
     KnobIWPtr owner;
     int dimensionInOwner;
@@ -73,9 +95,7 @@ struct CurvePrivate
 
     CurvePrivate()
         : keyFrames()
-#ifdef NATRON_CURVE_USE_CACHE
-        , resultCache()
-#endif
+        , keyFramesSnapshot()
         , owner()
         , dimensionInOwner(-1)
         , type(eCurveTypeDouble)
@@ -98,6 +118,7 @@ struct CurvePrivate
     void operator=(const CurvePrivate & other)
     {
         keyFrames = other.keyFrames;
+        invalidateKeyFramesSnapshot();
         owner = other.owner;
         dimensionInOwner = other.dimensionInOwner;
         isParametric = other.isParametric;
@@ -108,6 +129,18 @@ struct CurvePrivate
         yMax = other.yMax;
         hasYRange = other.hasYRange;
     }
+
+    /**
+     * @brief Returns the snapshot of the keyframes, taking it first if the keyframes changed. Does not lock
+     * unless the snapshot has to be taken.
+     **/
+    KeyFramesSnapshotPtr getKeyFramesSnapshot() const;
+
+    // Must be called with _lock held whenever keyFrames or type change
+    void invalidateKeyFramesSnapshot()
+    {
+        boost::atomic_store( &keyFramesSnapshot, KeyFramesSnapshotPtr() );
+    }
 };
 
 NATRON_NAMESPACE_EXIT;
@@ -67,6 +67,7 @@ Curve::serialize(Archive & ar,
 {
     QMutexLocker l(&_imp->_lock);
     ar & ::boost::serialization::make_nvp("KeyFrameSet", _imp->keyFrames);
+    _imp->invalidateKeyFramesSnapshot();
 }
 
 NATRON_NAMESPACE_EXIT;
@@ -74,6 +74,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/PluginMemory.h"
 #include "Engine/Project.h"
 #include "Engine/RenderStats.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/ReadNode.h"
@@ -1995,6 +1996,8 @@ EffectInstance::allocateImagePlane(const ImageKey & key,
                                    ImagePtr* fullScaleImage,
                                    ImagePtr* downscaleImage)
 {
+    RenderTraceScope traceScope("cache", "allocateImagePlane", this);
+
     //If we're rendering full scale and with input images at full scale, don't cache the downscale image since it is cheap to
     //recreate, instead cache the full-scale image
     if (renderFullScaleThenDownscale) {
@@ -2178,11 +2181,23 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
                                                                         args.planes);
 
     //Exit of the host frame threading thread
-    appPTR->getAppTLS()->cleanupTLSForThread();
+    //If the calling thread rendered this tile itself, its TLS is still needed by the ongoing render
+    if (callingThread != curThread) {
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
 
     return ret;
 }
 
+void
+EffectInstance::Implementation::tiledRenderingTask(EffectInstance::Implementation::TiledRenderingFunctorArgs* args,
+                                                   const RectToRender* specificData,
+                                                   QThread* callingThread,
+                                                   EffectInstance::RenderingFunctorRetEnum* ret)
+{
+    *ret = tiledRenderingFunctor(*args, *specificData, callingThread);
+}
+
 static void tryShrinkRenderWindow(const EffectInstance::EffectDataTLSPtr &tls,
                                   const EffectInstance::RectToRender & rectToRender,
                                   const EffectInstance::PlaneToRender & firstPlaneToRender,
@@ -3849,6 +3864,7 @@ EffectInstance::render_public(const RenderActionArgs & args)
 {
     NON_RECURSIVE_ACTION();
     REPORT_CURRENT_THREAD_ACTION( "kOfxImageEffectActionRender", getNode() );
+    RenderTraceScope traceScope("action", "render", this);
     try {
         return render(args);
     } catch (...) {
@@ -3913,6 +3929,7 @@ EffectInstance::isIdentity_public(bool useIdentityCache, // only set to true whe
     } else {
         /// Don't call isIdentity if plugin is sequential only.
         if (getSequentialPreference() != eSequentialPreferenceOnlySequential) {
+            RenderTraceScope traceScope("action", "isIdentity", this);
             try {
                 *inputView = view;
                 ret = isIdentity(time, scale, renderWindow, view, inputTime, inputView, inputNb);
@@ -4015,7 +4032,7 @@ EffectInstance::getRegionOfDefinition_public(U64 hash,
         RenderScale scaleOne(1.);
         {
             RECURSIVE_ACTION();
-
+            RenderTraceScope traceScope("action", "getRegionOfDefinition", this);
 
             ret = getRegionOfDefinition(hash, time, supportsRenderScaleMaybe() == eSupportsNo ? scaleOne : scale, view, rod);
 
@@ -4081,6 +4098,7 @@ EffectInstance::getFramesNeeded_public(U64 hash,
     }
 
     try {
+        RenderTraceScope traceScope("action", "getFramesNeeded", this);
         framesNeeded = getFramesNeeded(time, view);
     } catch (std::exception &e) {
         if ( !hasPersistentMessage() ) { // plugin may already have set a message
@@ -5235,10 +5253,13 @@ EffectInstance::onNodeHashChanged(U64 hash)
     ///Invalidate actions cache
     _imp->actionsCache->invalidateAll(hash);
 
+    ///Expressions with tracked dependencies are invalidated only when one of the knobs they depend on changes
     const KnobsVec & knobs = getKnobs();
     for (KnobsVec::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
         for (int i = 0; i < (*it)->getDimension(); ++i) {
-            (*it)->clearExpressionsResults(i);
+            if ( !(*it)->hasExpressionWithTrackedDependencies(i) ) {
+                (*it)->invalidateExpressionsResults(i);
+            }
         }
     }
 }
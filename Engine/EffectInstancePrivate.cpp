@@ -30,6 +30,7 @@
 #include "Engine/AppInstance.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/ViewIdx.h"
 
 
@@ -523,7 +524,10 @@ EffectInstance::Implementation::waitForImageBeingRenderedElsewhereAndUnmark(cons
     {
         QMutexLocker kk(&ibr->lock);
         while (!ab && isBeingRenderedElseWhere && !ibr->renderFailed && ibr->refCount > 1) {
-            ibr->cond.wait(&ibr->lock);
+            {
+                RenderTraceScope traceScope("wait", "imageBeingRenderedElsewhere", _publicInterface);
+                ibr->cond.wait(&ibr->lock);
+            }
             isBeingRenderedElseWhere = false;
             img->getRestToRender_trimap(roi, restToRender, &isBeingRenderedElseWhere);
             ab = _publicInterface->aborted();
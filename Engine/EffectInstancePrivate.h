@@ -529,6 +529,14 @@ public:
     RenderingFunctorRetEnum tiledRenderingFunctor(TiledRenderingFunctorArgs & args,  const RectToRender & specificData,
                                                   QThread* callingThread);
 
+    /**
+     * @brief Same as tiledRenderingFunctor but stores the result in ret, so that it can be run as a TaskScheduler task.
+     **/
+    void tiledRenderingTask(TiledRenderingFunctorArgs* args,
+                            const RectToRender* specificData,
+                            QThread* callingThread,
+                            RenderingFunctorRetEnum* ret);
+
     ///These are the image passed to the plug-in to render
     /// - fullscaleMappedImage is the fullscale image remapped to what the plugin can support (components/bitdepth)
     /// - downscaledMappedImage is the downscaled image remapped to what the plugin can support (components/bitdepth wise)
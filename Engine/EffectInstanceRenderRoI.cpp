@@ -34,7 +34,6 @@
 
 #include <boost/scoped_ptr.hpp>
 
-#include <QtCore/QThreadPool>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QCoreApplication>
 #include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
@@ -72,9 +71,11 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/PluginMemory.h"
 #include "Engine/Project.h"
 #include "Engine/RenderStats.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/Settings.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/Timer.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewIdx.h"
@@ -2056,6 +2057,8 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         return _imp->mainInstance->renderRoI(args, outputPlanes);
     }
 
+    RenderTraceScope traceScope("render", "renderRoI", this);
+
     // Setup args for the render
     const FrameViewRequest* requestPassData;
     EffectDataTLSPtr tls;
@@ -2319,12 +2322,13 @@ EffectInstance::renderRoIInternal(const EffectInstancePtr& self,
     ///Just fall back to Fully_safe
     int nbThreads = appPTR->getCurrentSettings()->getNumberOfThreads();
     if (safety == eRenderSafetyFullySafeFrame) {
+        const TaskScheduler* scheduler = appPTR->getTaskScheduler();
         ///If the plug-in is eRenderSafetyFullySafeFrame that means it wants the host to perform SMP aka slice up the RoI into chunks
         ///but if the effect doesn't support tiles it won't work.
         ///Also check that the number of threads indicating by the settings are appropriate for this render mode.
         if ( !frameArgs->tilesSupported || (nbThreads == -1) || (nbThreads == 1) ||
              ( (nbThreads == 0) && (appPTR->getHardwareIdealThreadCount() == 1) ) ||
-             ( QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount() ) ||
+             ( scheduler->getNumBusyWorkers() >= scheduler->getNumActiveWorkers() ) ||
              self->isRotoPaintNode() ) {
             safety = eRenderSafetyFullySafe;
         }
@@ -2410,14 +2414,22 @@ EffectInstance::renderRoIInternal(const EffectInstancePtr& self,
 #else
 
 
-            QFuture<RenderingFunctorRetEnum> ret = QtConcurrent::mapped( planesToRender->rectsToRender,
-                                                                         boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
-                                                                                     self->_imp.get(),
-                                                                                     *tiledArgs,
-                                                                                     _1,
-                                                                                     currentThread) );
-            ret.waitForFinished();
-            QFuture<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
+            // The tiles are run by the work-stealing scheduler: this thread renders the tiles that were not
+            // stolen by idle workers instead of waiting for them, which also works for nested renders.
+            std::vector<EffectInstance::RenderingFunctorRetEnum> ret(planesToRender->rectsToRender.size(), eRenderingFunctorRetFailed);
+            std::vector<TaskScheduler::Task> tasks;
+            tasks.reserve( ret.size() );
+            int i = 0;
+            for (std::list<RectToRender>::const_iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it, ++i) {
+                tasks.push_back( boost::bind(&EffectInstance::Implementation::tiledRenderingTask,
+                                             self->_imp.get(),
+                                             tiledArgs.get(),
+                                             &(*it),
+                                             currentThread,
+                                             &ret[i]) );
+            }
+            appPTR->getTaskScheduler()->runAndWait(tasks);
+            std::vector<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
 
 #endif
             for (it2 = ret.begin(); it2 != ret.end(); ++it2) {
@@ -80,8 +80,12 @@ SOURCES += \
     Backdrop.cpp \
     Bezier.cpp \
     BezierCP.cpp \
+    BezierTessellationCache.cpp \
     BlockingBackgroundRender.cpp \
+    BufferPool.cpp \
     Cache.cpp \
+    CacheCompression.cpp \
+    CacheJournal.cpp \
     CLArgs.cpp \
     CoonsRegularization.cpp \
     CreateNodeArgs.cpp \
@@ -128,6 +132,7 @@ SOURCES += \
     Lut.cpp \
     Markdown.cpp \
     MemoryFile.cpp \
+    NativeExpression.cpp \
     Node.cpp \
     NodeGroup.cpp \
     NodeMetadata.cpp \
@@ -171,7 +176,9 @@ SOURCES += \
     ReadNode.cpp \
     RectD.cpp \
     RectI.cpp \
+    RenderBenchmark.cpp \
     RenderStats.cpp \
+    RenderTrace.cpp \
     RotoBezierTriangulation.cpp \
     RotoContext.cpp \
     RotoDrawableItem.cpp \
@@ -181,6 +188,7 @@ SOURCES += \
     RotoPaintInteract.cpp \
     RotoShapeRenderNode.cpp \
     RotoShapeRenderNodePrivate.cpp \
+    RotoShapeRenderCPU.cpp \
     RotoShapeRenderCairo.cpp \
     RotoShapeRenderGL.cpp \
     RotoStrokeItem.cpp \
@@ -189,6 +197,7 @@ SOURCES += \
     Settings.cpp \
     StandardPaths.cpp \
     StringAnimationManager.cpp \
+    TaskScheduler.cpp \
     Texture.cpp \
     TextureRect.cpp \
     ThreadPool.cpp \
@@ -205,6 +214,7 @@ SOURCES += \
     Transform.cpp \
     Utils.cpp \
     ViewerInstance.cpp \
+    ViewerTextureConvert.cpp \
     WriteNode.cpp \
     ../Global/glad_source.c \
     ../Global/ProcInfo.cpp \
@@ -271,12 +281,16 @@ HEADERS += \
     BezierCP.h \
     BezierCPPrivate.h \
     BezierCPSerialization.h \
+    BezierTessellationCache.h \
     BlockingBackgroundRender.h \
+    BufferPool.h \
     BufferableObject.h \
     CLArgs.h \
     Cache.h \
+    CacheCompression.h \
     CacheEntry.h \
     CacheEntryHolder.h \
+    CacheJournal.h \
     CacheSerialization.h \
     CoonsRegularization.h \
     CreateNodeArgs.h \
@@ -338,6 +352,7 @@ HEADERS += \
     Markdown.h \
     MemoryFile.h \
     MergingEnum.h \
+    NativeExpression.h \
     Node.h \
     NodeGroup.h \
     NodeGroupSerialization.h \
@@ -389,7 +404,9 @@ HEADERS += \
     RectDSerialization.h \
     RectI.h \
     RectISerialization.h \
+    RenderBenchmark.h \
     RenderStats.h \
+    RenderTrace.h \
     RotoBezierTriangulation.h \
     RotoContext.h \
     RotoContextPrivate.h \
@@ -405,6 +422,7 @@ HEADERS += \
     RotoPoint.h \
     RotoShapeRenderNode.h \
     RotoShapeRenderNodePrivate.h \
+    RotoShapeRenderCPU.h \
     RotoShapeRenderCairo.h \
     RotoShapeRenderGL.h \
     RotoStrokeItem.h \
@@ -415,6 +433,7 @@ HEADERS += \
     Singleton.h \
     StandardPaths.h \
     StringAnimationManager.h \
+    TaskScheduler.h \
     Texture.h \
     TextureRect.h \
     TextureRectSerialization.h \
@@ -441,6 +460,7 @@ HEADERS += \
     VariantSerialization.h \
     ViewerInstance.h \
     ViewerInstancePrivate.h \
+    ViewerTextureConvert.h \
     ViewIdx.h \
     WriteNode.h \
     ../Global/Enums.h \
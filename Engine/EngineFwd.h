@@ -112,10 +112,14 @@ class Backdrop;
 class Bezier;
 class BezierCP;
 class BezierSerialization;
+class BezierTessellationCache;
 class BlockingBackgroundRender;
 class BufferableObject;
 class CLArgs;
+struct CacheAccessStats;
+struct CacheCompressionStats;
 class CacheEntryHolder;
+class CacheJournal;
 class CacheSignalEmitter;
 class ChoiceExtraData;
 class CreateNodeArgs;
@@ -188,6 +192,7 @@ class NodeGraphI;
 class NodeGroup;
 class NodeGuiI;
 class NodeMetadata;
+class NodeRenderStats;
 class NodeSerialization;
 class NodeSettingsPanel;
 class NoOpBase;
@@ -221,6 +226,7 @@ class ProjectSerialization;
 class ReadNode;
 class RectD;
 class RectI;
+class RenderBenchmark;
 class RenderEngine;
 class RenderStats;
 class RenderingFlagSetter;
@@ -241,6 +247,7 @@ class RotoStrokeItemSerialization;
 class Settings;
 class StringAnimationManager;
 class TLSHolderBase;
+class TaskScheduler;
 class Texture;
 class TextureRect;
 class TimeLine;
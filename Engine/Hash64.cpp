@@ -24,36 +24,139 @@
 
 #include "Hash64.h"
 
-#include <algorithm>  // for std::for_each
 #include <cassert>
+#include <cstddef>
 #include <stdexcept>
 
-#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
-#include <boost/crc.hpp>
-#endif
 #include <QtCore/QString>
 
 #include "Engine/Node.h"
 
 NATRON_NAMESPACE_ENTER;
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+const U64 prime1 = 11400714785074694791ULL;
+const U64 prime2 = 14029467366897019727ULL;
+const U64 prime3 = 1609587929392839161ULL;
+const U64 prime4 = 9650029242287828579ULL;
+const U64 prime5 = 2870177450012600261ULL;
+
+// xxHash reads the input as little-endian words whatever the alignment and the byte order of the host
+U64
+readU64LE(const unsigned char* p)
+{
+    U64 v = 0;
+
+    for (int i = 7; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+
+    return v;
+}
+
+U64
+readU32LE(const unsigned char* p)
+{
+    return (U64)p[0] | ( (U64)p[1] << 8 ) | ( (U64)p[2] << 16 ) | ( (U64)p[3] << 24 );
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+U64
+Hash64::mergeAccumulators(const U64 acc[4])
+{
+    U64 h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+
+    for (int i = 0; i < 4; ++i) {
+        h ^= mixRound(0, acc[i]);
+        h = h * prime1 + prime4;
+    }
+
+    return h;
+}
+
+U64
+Hash64::avalanche(U64 h)
+{
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+
+    return h;
+}
+
 void
 Hash64::computeHash()
 {
-    if ( node_values.empty() ) {
+    if (nValues == 0) {
         return;
     }
 
-    const unsigned char* data = reinterpret_cast<const unsigned char*>( &node_values.front() );
-    boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> crc_64;
-    crc_64 = std::for_each( data, data + node_values.size() * sizeof(node_values[0]), crc_64 );
-    hash = crc_64();
+    // xxHash64 finalization, on a copy of the running state so that more
+    // values can still be appended afterwards
+    U64 h = (nValues >= 4) ? mergeAccumulators(acc) : prime5;
+    h += nValues * sizeof(U64);
+
+    for (unsigned int i = 0; i < nPending; ++i) {
+        h ^= mixRound(0, pending[i]);
+        h = rotl(h, 27) * prime1 + prime4;
+    }
+
+    hash = avalanche(h);
+}
+
+U64
+Hash64::xxHash64(const void* data,
+                 std::size_t size,
+                 U64 seed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    U64 h;
+
+    if (size >= 32) {
+        U64 v[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+        for (; p + 32 <= end; p += 32) {
+            for (int i = 0; i < 4; ++i) {
+                v[i] = mixRound( v[i], readU64LE(p + i * 8) );
+            }
+        }
+        h = mergeAccumulators(v);
+    } else {
+        h = seed + prime5;
+    }
+    h += (U64)size;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= mixRound( 0, readU64LE(p) );
+        h = rotl(h, 27) * prime1 + prime4;
+    }
+    if (p + 4 <= end) {
+        h ^= readU32LE(p) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= *p * prime5;
+        h = rotl(h, 11) * prime1;
+    }
+
+    return avalanche(h);
 }
 
 void
 Hash64::reset()
 {
-    node_values.clear();
+    // seed 0
+    acc[0] = 11400714785074694791ULL + 14029467366897019727ULL;
+    acc[1] = 14029467366897019727ULL;
+    acc[2] = 0;
+    acc[3] = 0 - 11400714785074694791ULL;
+    nPending = 0;
+    nValues = 0;
     hash = 0;
 }
 
@@ -61,9 +164,23 @@ void
 Hash64_appendQString(Hash64* hash,
                      const QString & str)
 {
-    Q_FOREACH (QChar ch, str) {
-        hash->append<unsigned short>( ch.unicode() );
+    // Pack 4 UTF-16 code units per appended value, and append the length so
+    // that consecutive strings cannot be confused with their concatenation
+    const ushort* data = str.utf16();
+    int n = str.size();
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        hash->append<U64>( (U64)data[i] | ( (U64)data[i + 1] << 16 ) | ( (U64)data[i + 2] << 32 ) | ( (U64)data[i + 3] << 48 ) );
+    }
+    if (i < n) {
+        U64 tail = 0;
+        for (int shift = 0; i < n; ++i, shift += 16) {
+            tail |= (U64)data[i] << shift;
+        }
+        hash->append<U64>(tail);
     }
+    hash->append<int>(n);
 }
 
 NATRON_NAMESPACE_EXIT;
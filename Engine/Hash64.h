@@ -38,9 +38,14 @@
 
 NATRON_NAMESPACE_ENTER;
 
-/*The hash of a Node is the checksum of the vector of data containing:
+/*The hash of a Node is the checksum of the sequence of data containing:
     - the values of the current knob for this node + the name of the node
     - the hash values for the  tree upstream
+
+   The checksum is a 64-bit xxHash computed incrementally over the appended
+   64-bit values: appending never allocates and computeHash() only has to
+   finalize the running state, so it may be called at any point and
+   appending may continue afterwards.
  */
 
 class Hash64
@@ -48,12 +53,11 @@ class Hash64
 public:
     Hash64()
     {
-        hash = 0;
+        reset();
     }
 
     ~Hash64()
     {
-        node_values.clear();
     }
 
     U64 value() const
@@ -65,6 +69,12 @@ public:
 
     void reset();
 
+    /**
+     * @brief Returns the xxHash64 of the given bytes. The value of a Hash64 is the xxHash64 with seed 0 of the
+     * little-endian bytes of the appended values.
+     **/
+    static U64 xxHash64(const void* data, std::size_t size, U64 seed = 0);
+
     bool valid() const
     {
         return hash != 0;
@@ -86,7 +96,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
     template<typename T>
     void append(T value)
     {
-        node_values.push_back( toU64(value) );
+        appendU64( toU64(value) );
     }
 
     bool operator== (const Hash64 & h) const
@@ -115,8 +125,49 @@ private:
         };
     };
 
+    static U64 rotl(U64 x,
+                    int r)
+    {
+        return (x << r) | ( x >> (64 - r) );
+    }
+
+    static U64 mixRound(U64 a,
+                        U64 input)
+    {
+        a += input * 14029467366897019727ULL;
+        a = rotl(a, 31);
+
+        return a * 11400714785074694791ULL;
+    }
+
+    // Combines the 4 stripe accumulators, when at least one full stripe was hashed
+    static U64 mergeAccumulators(const U64 acc[4]);
+
+    // Final mix of the bits of the hash
+    static U64 avalanche(U64 h);
+
+    void appendU64(U64 v)
+    {
+        pending[nPending++] = v;
+        if (nPending == 4) {
+            // a full 32 bytes stripe is available, feed the 4 accumulators
+            acc[0] = mixRound(acc[0], pending[0]);
+            acc[1] = mixRound(acc[1], pending[1]);
+            acc[2] = mixRound(acc[2], pending[2]);
+            acc[3] = mixRound(acc[3], pending[3]);
+            nPending = 0;
+        }
+        ++nValues;
+    }
+
     U64 hash;
-    std::vector<U64> node_values;
+
+    // xxHash64 running state: the 4 stripe accumulators, the values not yet
+    // forming a full stripe and the total number of values appended so far
+    U64 acc[4];
+    U64 pending[4];
+    unsigned int nPending;
+    U64 nValues;
 };
 
 void Hash64_appendQString(Hash64* hash, const QString & str);
@@ -27,113 +27,281 @@
 #include <algorithm> // min, max
 #include <cassert>
 #include <cstring> // for std::memcpy, std::memset
+#include <vector>
 #include <stdexcept>
 
+#ifdef NATRON_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 #include <QtCore/QDebug>
 
 #include "Engine/AppManager.h"
+#include "Engine/Lut.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/GPUContextPool.h"
 #include "Engine/OSGLContext.h"
 
 NATRON_NAMESPACE_ENTER;
 
-#define BM_GET(i, j) mapStart + ( i - _bounds.bottom() ) * _bounds.width() + ( j - _bounds.left() )
-
 #define PIXEL_UNAVAILABLE 2
 
+/*
+ * Bitmap word helpers: each 64-bit word holds the 2-bit state of 32 consecutive pixels, pixel i of the word
+ * being at bits 2*i and 2*i+1. The masks returned by matchPixels have the low bit of each matching pixel set.
+ */
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+static const U64 kBitmapLowBits = 0x5555555555555555ULL;
+
+enum BitmapMatchEnum
+{
+    eBitmapMatchZero = 0, // not rendered
+    eBitmapMatchNonZero, // rendered or being rendered
+    eBitmapMatchOne, // rendered
+    eBitmapMatchNotOne, // not rendered or being rendered
+    eBitmapMatchUnavailable // being rendered
+};
+
+template <int match>
+inline U64
+matchPixels(U64 word)
+{
+    const U64 lo = word & kBitmapLowBits;
+    const U64 hi = (word >> 1) & kBitmapLowBits;
+
+    switch (match) {
+    case eBitmapMatchZero:
+        return ~(lo | hi) & kBitmapLowBits;
+    case eBitmapMatchNonZero:
+        return lo | hi;
+    case eBitmapMatchOne:
+        return lo & ~hi;
+    case eBitmapMatchNotOne:
+        return (~lo | hi) & kBitmapLowBits;
+    case eBitmapMatchUnavailable:
+    default:
+        return hi & ~lo;
+    }
+}
+
+// Low bit of the pixels x1 <= x < x2 of a word, with 0 <= x1 < x2 <= 32
+inline U64
+pixelRangeMask(int x1,
+               int x2)
+{
+    const U64 below2 = (x2 == 32) ? ~(U64)0 : ( ( (U64)1 << (2 * x2) ) - 1 );
+    const U64 below1 = ( (U64)1 << (2 * x1) ) - 1;
+
+    return below2 & ~below1 & kBitmapLowBits;
+}
+
+inline int
+lowestSetBit(U64 v)
+{
+    assert(v);
+#ifdef __GNUC__
+    return __builtin_ctzll(v);
+#else
+    int n = 0;
+    while ( !(v & 1) ) {
+        v >>= 1;
+        ++n;
+    }
+
+    return n;
+#endif
+}
+
+inline int
+highestSetBit(U64 v)
+{
+    assert(v);
+#ifdef __GNUC__
+    return 63 - __builtin_clzll(v);
+#else
+    int n = 63;
+    while ( !(v >> 63) ) {
+        v <<= 1;
+        --n;
+    }
+
+    return n;
+#endif
+}
+
+/*
+ * Returns the first pixel x1 <= x < x2 of the row matching the predicate, or x2 if none does.
+ * Coordinates are relative to the left of the bitmap.
+ */
+template <int match>
+int
+findFirstPixel(const U64* row,
+               int x1,
+               int x2)
+{
+    if (x1 >= x2) {
+        return x2;
+    }
+    const int firstWord = x1 >> 5;
+    const int lastWord = (x2 - 1) >> 5;
+    for (int w = firstWord; w <= lastWord; ++w) {
+        const int a = (w == firstWord) ? (x1 & 31) : 0;
+        const int b = (w == lastWord) ? ( ( (x2 - 1) & 31 ) + 1 ) : 32;
+        const U64 m = matchPixels<match>(row[w]) & pixelRangeMask(a, b);
+        if (m) {
+            return (w << 5) + (lowestSetBit(m) >> 1);
+        }
+    }
+
+    return x2;
+}
+
+/*
+ * Returns the last pixel x1 <= x < x2 of the row matching the predicate, or x1 - 1 if none does.
+ */
+template <int match>
+int
+findLastPixel(const U64* row,
+              int x1,
+              int x2)
+{
+    if (x1 >= x2) {
+        return x1 - 1;
+    }
+    const int firstWord = x1 >> 5;
+    const int lastWord = (x2 - 1) >> 5;
+    for (int w = lastWord; w >= firstWord; --w) {
+        const int a = (w == firstWord) ? (x1 & 31) : 0;
+        const int b = (w == lastWord) ? ( ( (x2 - 1) & 31 ) + 1 ) : 32;
+        const U64 m = matchPixels<match>(row[w]) & pixelRangeMask(a, b);
+        if (m) {
+            return (w << 5) + (highestSetBit(m) >> 1);
+        }
+    }
+
+    return x1 - 1;
+}
+
+inline char
+getPixelState(const U64* row,
+              int x)
+{
+    return (char)( ( row[x >> 5] >> ( (x & 31) * 2 ) ) & 3 );
+}
+
+// Sets the state of the pixels x1 <= x < x2 of the row
+void
+fillPixels(U64* row,
+           int x1,
+           int x2,
+           char state)
+{
+    if (x1 >= x2) {
+        return;
+    }
+    const U64 pattern = kBitmapLowBits * (U64)state;
+    const int firstWord = x1 >> 5;
+    const int lastWord = (x2 - 1) >> 5;
+    for (int w = firstWord; w <= lastWord; ++w) {
+        const int a = (w == firstWord) ? (x1 & 31) : 0;
+        const int b = (w == lastWord) ? ( ( (x2 - 1) & 31 ) + 1 ) : 32;
+        if ( (a == 0) && (b == 32) ) {
+            row[w] = pattern;
+        } else {
+            const U64 mask = pixelRangeMask(a, b) * 3;
+            row[w] = (row[w] & ~mask) | (pattern & mask);
+        }
+    }
+}
+
+// Returns the state of the n <= 32 pixels starting at x, packed from bit 0
+inline U64
+readPixels(const U64* row,
+           int x,
+           int n)
+{
+    const int w = x >> 5;
+    const int s = (x & 31) * 2;
+    U64 v = row[w] >> s;
+
+    if ( s && ( (x & 31) + n > 32 ) ) {
+        v |= row[w + 1] << (64 - s);
+    }
+    if (n < 32) {
+        v &= ( (U64)1 << (2 * n) ) - 1;
+    }
+
+    return v;
+}
+
+// Copies the pixels srcX1 <= x < srcX1 + n of src to the pixels starting at dstX1 of dst
+void
+copyPixels(const U64* src,
+           int srcX1,
+           U64* dst,
+           int dstX1,
+           int n)
+{
+    while (n > 0) {
+        // write at most up to the end of the current dst word
+        const int a = dstX1 & 31;
+        const int chunk = std::min(n, 32 - a);
+        const U64 v = readPixels(src, srcX1, chunk);
+        const U64 mask = pixelRangeMask(a, a + chunk) * 3;
+        U64& word = dst[dstX1 >> 5];
+        word = (word & ~mask) | ( (v << (2 * a)) & mask );
+        srcX1 += chunk;
+        dstX1 += chunk;
+        n -= chunk;
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+#define BM_ROW(i) ( mapStart + (std::size_t)( (i) - _bounds.bottom() ) * rowWords )
+
 template <int trimap>
 RectI
 minimalNonMarkedBbox_internal(const RectI& roi,
                               const RectI& _bounds,
-                              const char* mapStart,
+                              const U64* mapStart,
+                              int rowWords,
                               bool* isBeingRenderedElsewhere)
 {
+    // A pixel is marked if it is rendered, or being rendered elsewhere for the trimap
+    const int unmarked = trimap ? eBitmapMatchZero : eBitmapMatchNotOne;
     RectI bbox;
 
     assert( _bounds.contains(roi) );
     bbox = roi;
 
+    // pixels coordinates relative to the bitmap
+    int x1 = bbox.x1 - _bounds.x1;
+    int x2 = bbox.x2 - _bounds.x1;
+
     //find bottom
     for (int i = bbox.bottom(); i < bbox.top(); ++i) {
-        const char* buf = BM_GET( i, bbox.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                ++bbox.y1;
-            } else {
-                ++bbox.y1;
-            }
-        } else {
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if ( !*buf || (*buf == PIXEL_UNAVAILABLE) ) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                ++bbox.y1;
-            }
+        const U64* row = BM_ROW(i);
+        if (findFirstPixel<unmarked>(row, x1, x2) < x2) {
+            break;
+        }
+        if ( trimap && (findFirstPixel<eBitmapMatchUnavailable>(row, x1, x2) < x2) ) {
+            *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
         }
+        ++bbox.y1;
     }
 
     //find top (will do zero iteration if the bbox is already empty)
     for (int i = bbox.top() - 1; i >= bbox.bottom(); --i) {
-        const char* buf = BM_GET( i, bbox.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                --bbox.y2;
-            } else {
-                --bbox.y2;
-            }
-        } else {
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if ( !*buf || (*buf == PIXEL_UNAVAILABLE) ) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                --bbox.y2;
-            }
+        const U64* row = BM_ROW(i);
+        if (findFirstPixel<unmarked>(row, x1, x2) < x2) {
+            break;
+        }
+        if ( trimap && (findFirstPixel<eBitmapMatchUnavailable>(row, x1, x2) < x2) ) {
+            *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
         }
+        --bbox.y2;
     }
 
     // avoid making bbox.width() iterations for nothing
@@ -141,70 +309,68 @@ minimalNonMarkedBbox_internal(const RectI& roi,
         return bbox;
     }
 
-    //find left
-    for (int j = bbox.left(); j < bbox.right(); ++j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
-        bool metUnavailablePixel = false;
-
-        for ( int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width() ) {
-            if (!*pix) {
-                pix = 0;
-                break;
-            } else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
-                }
-            }
-        }
-        if (pix) {
-            ++bbox.x1;
-            if (trimap && metUnavailablePixel) {
+    //find left: the first column containing an unmarked pixel
+    int newX1 = x2;
+    for (int i = bbox.bottom(); i < bbox.top() && newX1 > x1; ++i) {
+        newX1 = std::min( newX1, findFirstPixel<unmarked>(BM_ROW(i), x1, newX1) );
+    }
+    if (trimap) {
+        for (int i = bbox.bottom(); i < bbox.top() && !*isBeingRenderedElsewhere; ++i) {
+            if (findFirstPixel<eBitmapMatchUnavailable>(BM_ROW(i), x1, newX1) < newX1) {
                 *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
             }
-        } else {
-            break;
         }
     }
+    x1 = newX1;
 
-    //find right
-    for (int j = bbox.right() - 1; j >= bbox.left(); --j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
-        bool metUnavailablePixel = false;
-
-        for ( int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width() ) {
-            if (!*pix) {
-                pix = 0;
-                break;
-            } else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
-                }
-            }
-        }
-        if (pix) {
-            --bbox.x2;
-            if (trimap && metUnavailablePixel) {
+    //find right: the last column containing an unmarked pixel
+    int newX2 = x1;
+    for (int i = bbox.bottom(); i < bbox.top() && newX2 < x2; ++i) {
+        newX2 = std::max( newX2, findLastPixel<unmarked>(BM_ROW(i), newX2, x2) + 1 );
+    }
+    if (trimap) {
+        for (int i = bbox.bottom(); i < bbox.top() && !*isBeingRenderedElsewhere; ++i) {
+            if (findFirstPixel<eBitmapMatchUnavailable>(BM_ROW(i), newX2, x2) < x2) {
                 *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
             }
-        } else {
-            break;
         }
     }
+    x2 = newX2;
+
+    bbox.x1 = x1 + _bounds.x1;
+    bbox.x2 = x2 + _bounds.x1;
 
     return bbox;
 } // minimalNonMarkedBbox_internal
 
+/*
+ * Returns the first marked pixel of column x (relative) going upwards from row y1, or 0 if there is none.
+ */
+template <int trimap>
+char
+firstMarkedPixelInColumn(const RectI& _bounds,
+                         const U64* mapStart,
+                         int rowWords,
+                         int x,
+                         int y1,
+                         int y2)
+{
+    for (int i = y1; i < y2; ++i) {
+        char state = getPixelState(BM_ROW(i), x);
+        if ( (state == 1) || (trimap && state == PIXEL_UNAVAILABLE) ) {
+            return state;
+        }
+    }
+
+    return 0;
+}
+
 template <int trimap>
 void
 minimalNonMarkedRects_internal(const RectI & roi,
                                const RectI& _bounds,
-                               const char* mapStart,
+                               const U64* mapStart,
+                               int rowWords,
                                std::list<RectI>& ret,
                                bool* isBeingRenderedElsewhere)
 {
@@ -241,7 +407,7 @@ minimalNonMarkedRects_internal(const RectI & roi,
         return;
     }
 
-    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, _bounds, mapStart, isBeingRenderedElsewhere);
+    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, _bounds, mapStart, rowWords, isBeingRenderedElsewhere);
     assert( (trimap && isBeingRenderedElsewhere) || (!trimap && !isBeingRenderedElsewhere) );
 
     //#define NATRON_BITMAP_DISABLE_OPTIMIZATION
@@ -275,44 +441,27 @@ minimalNonMarkedRects_internal(const RectI & roi,
     // CXXXXXXXXXXDDD
     // AAAAAAAAAAAAAA
 
+    // A pixel stops the search if it is rendered, or being rendered elsewhere for the trimap
+    const int marked = trimap ? eBitmapMatchNonZero : eBitmapMatchOne;
+
     // First, find if there's an "A" rectangle, and push it to the result
     //find bottom
     RectI bboxX = bboxM;
     RectI bboxA = bboxX;
+    int x1 = bboxX.left() - _bounds.x1;
+    int x2 = bboxX.right() - _bounds.x1;
     bboxA.set_top( bboxX.bottom() );
     for (int i = bboxX.bottom(); i < bboxX.top(); ++i) {
-        const char* buf = BM_GET( i, bboxX.left() );
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if ( (*buf == PIXEL_UNAVAILABLE) && trimap ) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                break;
+        const U64* row = BM_ROW(i);
+        int firstMarked = findFirstPixel<marked>(row, x1, x2);
+        if (firstMarked < x2) {
+            if ( trimap && (getPixelState(row, firstMarked) == PIXEL_UNAVAILABLE) ) {
+                *isBeingRenderedElsewhere = true;
             }
+            break;
         }
+        ++bboxX.y1;
+        bboxA.y2 = bboxX.y1;
     }
     if ( !bboxA.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxA);
@@ -323,105 +472,56 @@ minimalNonMarkedRects_internal(const RectI & roi,
     RectI bboxB = bboxX;
     bboxB.set_bottom( bboxX.top() );
     for (int i = bboxX.top() - 1; i >= bboxX.bottom(); --i) {
-        const char* buf = BM_GET( i, bboxX.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if ( (*buf == PIXEL_UNAVAILABLE) && trimap ) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                break;
+        const U64* row = BM_ROW(i);
+        int firstMarked = findFirstPixel<marked>(row, x1, x2);
+        if (firstMarked < x2) {
+            if ( trimap && (getPixelState(row, firstMarked) == PIXEL_UNAVAILABLE) ) {
+                *isBeingRenderedElsewhere = true;
             }
+            break;
         }
+        --bboxX.y2;
+        bboxB.y1 = bboxX.y2;
     }
     if ( !bboxB.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxB);
     }
 
-    //find left
+    //find left: the first column containing a marked pixel
     RectI bboxC = bboxX;
     bboxC.set_right( bboxX.left() );
     if ( bboxX.bottom() < bboxX.top() ) {
-        for (int j = bboxX.left(); j < bboxX.right(); ++j) {
-            const char* pix = BM_GET(bboxX.bottom(), j);
-            bool metUnavailablePixel = false;
-
-            for ( int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width() ) {
-                if (*pix == 1) {
-                    pix = 0;
-                    break;
-                } else if ( trimap && (*pix == PIXEL_UNAVAILABLE) ) {
-                    pix = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-            }
-            if (pix) {
-                ++bboxX.x1;
-                bboxC.x2 = bboxX.x1;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
+        int newX1 = x2;
+        for (int i = bboxX.bottom(); i < bboxX.top() && newX1 > x1; ++i) {
+            newX1 = std::min( newX1, findFirstPixel<marked>(BM_ROW(i), x1, newX1) );
         }
+        if ( trimap && (newX1 < x2) &&
+             (firstMarkedPixelInColumn<trimap>(_bounds, mapStart, rowWords, newX1, bboxX.bottom(), bboxX.top()) == PIXEL_UNAVAILABLE) ) {
+            *isBeingRenderedElsewhere = true;
+        }
+        x1 = newX1;
+        bboxX.x1 = x1 + _bounds.x1;
+        bboxC.x2 = bboxX.x1;
     }
     if ( !bboxC.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxC);
     }
 
-    //find right
+    //find right: the last column containing a marked pixel
     RectI bboxD = bboxX;
     bboxD.set_left( bboxX.right() );
     if ( bboxX.bottom() < bboxX.top() ) {
-        for (int j = bboxX.right() - 1; j >= bboxX.left(); --j) {
-            const char* pix = BM_GET(bboxX.bottom(), j);
-            bool metUnavailablePixel = false;
-
-            for ( int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width() ) {
-                if (*pix == 1) {
-                    pix = 0;
-                    break;
-                } else if ( trimap && (*pix == PIXEL_UNAVAILABLE) ) {
-                    pix = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-            }
-            if (pix) {
-                --bboxX.x2;
-                bboxD.x1 = bboxX.x2;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
+        int newX2 = x1;
+        for (int i = bboxX.bottom(); i < bboxX.top() && newX2 < x2; ++i) {
+            newX2 = std::max( newX2, findLastPixel<marked>(BM_ROW(i), newX2, x2) + 1 );
+        }
+        if ( trimap && (newX2 > x1) &&
+             (firstMarkedPixelInColumn<trimap>(_bounds, mapStart, rowWords, newX2 - 1, bboxX.bottom(), bboxX.top()) == PIXEL_UNAVAILABLE) ) {
+            *isBeingRenderedElsewhere = true;
         }
+        x2 = newX2;
+        bboxX.x2 = x2 + _bounds.x1;
+        bboxD.x1 = bboxX.x2;
     }
     if ( !bboxD.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxD);
@@ -448,7 +548,7 @@ minimalNonMarkedRects_internal(const RectI & roi,
     assert( bboxD.bottom() == bboxX.bottom() );
 
     // get the bounding box of what's left (the X rectangle in the drawing above)
-    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX, _bounds, mapStart, isBeingRenderedElsewhere);
+    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX, _bounds, mapStart, rowWords, isBeingRenderedElsewhere);
 
     if ( !bboxX.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxX);
@@ -466,9 +566,9 @@ Bitmap::minimalNonMarkedBbox(const RectI & roi) const
             return RectI();
         }
 
-        return minimalNonMarkedBbox_internal<0>(realRoi, _bounds, _map.getData(), NULL);
+        return minimalNonMarkedBbox_internal<0>(realRoi, _bounds, _map.getData(), _rowWords, NULL);
     } else {
-        return minimalNonMarkedBbox_internal<0>(roi, _bounds, _map.getData(), NULL);
+        return minimalNonMarkedBbox_internal<0>(roi, _bounds, _map.getData(), _rowWords, NULL);
     }
 }
 
@@ -481,9 +581,9 @@ Bitmap::minimalNonMarkedRects(const RectI & roi,
         if ( !roi.intersect(_dirtyZone, &realRoi) ) {
             return;
         }
-        minimalNonMarkedRects_internal<0>(realRoi, _bounds, _map.getData(), ret, NULL);
+        minimalNonMarkedRects_internal<0>(realRoi, _bounds, _map.getData(), _rowWords, ret, NULL);
     } else {
-        minimalNonMarkedRects_internal<0>(roi, _bounds, _map.getData(), ret, NULL);
+        minimalNonMarkedRects_internal<0>(roi, _bounds, _map.getData(), _rowWords, ret, NULL);
     }
 }
 
@@ -500,9 +600,9 @@ Bitmap::minimalNonMarkedBbox_trimap(const RectI & roi,
             return RectI();
         }
 
-        return minimalNonMarkedBbox_internal<1>(realRoi, _bounds, _map.getData(), isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(realRoi, _bounds, _map.getData(), _rowWords, isBeingRenderedElsewhere);
     } else {
-        return minimalNonMarkedBbox_internal<1>(roi, _bounds, _map.getData(), isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(roi, _bounds, _map.getData(), _rowWords, isBeingRenderedElsewhere);
     }
 }
 
@@ -518,40 +618,44 @@ Bitmap::minimalNonMarkedRects_trimap(const RectI & roi,
 
             return;
         }
-        minimalNonMarkedRects_internal<1>(realRoi, _bounds, _map.getData(), ret, isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(realRoi, _bounds, _map.getData(), _rowWords, ret, isBeingRenderedElsewhere);
     } else {
-        minimalNonMarkedRects_internal<1>(roi, _bounds, _map.getData(), ret, isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(roi, _bounds, _map.getData(), _rowWords, ret, isBeingRenderedElsewhere);
     }
 }
 
 #endif
 
 void
-Bitmap::markForRendered(const RectI & roi)
+Bitmap::fill(const RectI & roi,
+             char state)
 {
-    char* mapStart = _map.getData();
-    char* buf = BM_GET( roi.bottom(), roi.left() );
-    int w = _bounds.width();
-    int roiw = roi.width();
+    if ( roi.isNull() ) {
+        return;
+    }
+    assert( _bounds.contains(roi) );
+    U64* mapStart = _map.getData();
+    const int rowWords = _rowWords;
+    const int x1 = roi.x1 - _bounds.x1;
+    const int x2 = roi.x2 - _bounds.x1;
 
-    for (int i = roi.y1; i < roi.y2; ++i, buf += w) {
-        std::memset( buf, 1, roiw);
+    for (int i = roi.y1; i < roi.y2; ++i) {
+        fillPixels(BM_ROW(i), x1, x2, state);
     }
 }
 
+void
+Bitmap::markForRendered(const RectI & roi)
+{
+    fill(roi, 1);
+}
+
 #if NATRON_ENABLE_TRIMAP
 void
 Bitmap::markForRendering(const RectI & roi)
 {
     assert(_map.size() > 0);
-    char* mapStart = _map.getData();
-    char* buf = BM_GET( roi.bottom(), roi.left() );
-    int w = _bounds.width();
-    int roiw = roi.width();
-
-    for (int i = roi.y1; i < roi.y2; ++i, buf += w) {
-        std::memset( buf, PIXEL_UNAVAILABLE, roiw );
-    }
+    fill(roi, PIXEL_UNAVAILABLE);
 }
 
 #endif
@@ -560,14 +664,7 @@ void
 Bitmap::clear(const RectI& roi)
 {
     assert(_map.size() > 0);
-    char* mapStart = _map.getData();
-    char* buf = BM_GET( roi.bottom(), roi.left() );
-    int w = _bounds.width();
-    int roiw = roi.width();
-
-    for (int i = roi.y1; i < roi.y2; ++i, buf += w) {
-        std::memset( buf, 0, roiw );
-    }
+    fill(roi, 0);
 }
 
 void
@@ -575,34 +672,11 @@ Bitmap::swap(Bitmap& other)
 {
     _map.swap(other._map);
     _bounds = other._bounds;
+    _rowWords = other._rowWords;
     _dirtyZone.clear(); //merge(other._dirtyZone);
     _dirtyZoneSet = false;
 }
 
-const char*
-Bitmap::getBitmapAt(int x,
-                    int y) const
-{
-    if ( ( x >= _bounds.left() ) && ( x < _bounds.right() ) && ( y >= _bounds.bottom() ) && ( y < _bounds.top() ) ) {
-        const char* mapStart = _map.getData();
-        return BM_GET(y, x);
-    } else {
-        return NULL;
-    }
-}
-
-char*
-Bitmap::getBitmapAt(int x,
-                    int y)
-{
-    if ( ( x >= _bounds.left() ) && ( x < _bounds.right() ) && ( y >= _bounds.bottom() ) && ( y < _bounds.top() ) ) {
-        char* mapStart = _map.getData();
-        return BM_GET(y, x);
-    } else {
-        return NULL;
-    }
-}
-
 #ifdef DEBUG
 void
 Image::printUnrenderedPixels(const RectI& roi) const
@@ -611,9 +685,6 @@ Image::printUnrenderedPixels(const RectI& roi) const
         return;
     }
     QReadLocker k(&_entryLock);
-    const char* bm = _bitmap.getBitmapAt(roi.x1, roi.y1);
-    int roiw = roi.x2 - roi.x1;
-    int boundsW = _bitmap.getBounds().width();
     RectD bboxUnrendered;
     bboxUnrendered.setupInfinity();
     RectD bboxUnavailable;
@@ -622,10 +693,10 @@ Image::printUnrenderedPixels(const RectI& roi) const
     bool hasUnrendered = false;
     bool hasUnavailable = false;
 
-    for ( int y = roi.y1; y < roi.y2; ++y,
-          bm += (boundsW - roiw) ) {
-        for (int x = roi.x1; x < roi.x2; ++x, ++bm) {
-            if (*bm == 0) {
+    for (int y = roi.y1; y < roi.y2; ++y) {
+        for (int x = roi.x1; x < roi.x2; ++x) {
+            char bm = _bitmap.getPixel(x, y);
+            if (bm == 0) {
                 if (x < bboxUnrendered.x1) {
                     bboxUnrendered.x1 = x;
                 }
@@ -639,7 +710,7 @@ Image::printUnrenderedPixels(const RectI& roi) const
                     bboxUnrendered.y2 = y;
                 }
                 hasUnrendered = true;
-            } else if (*bm == PIXEL_UNAVAILABLE) {
+            } else if (bm == PIXEL_UNAVAILABLE) {
                 if (x < bboxUnavailable.x1) {
                     bboxUnavailable.x1 = x;
                 }
@@ -1187,9 +1258,7 @@ Image::resizeInternal(const OSGLContextPtr& glContext,
                 std::size_t memsize = a * pixelSize;
                 std::memset(pix, 0, memsize);
                 if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
-                    char* bm = wacc.bitmapAt(aRect.x1, aRect.y1);
-                    assert(bm);
-                    std::memset(bm, 1, a);
+                    (*outputImage)->_bitmap.markForRendered(aRect);
                 }
             }
             if ( !cRect.isNull() ) {
@@ -1199,9 +1268,7 @@ Image::resizeInternal(const OSGLContextPtr& glContext,
                 std::size_t memsize = a * pixelSize;
                 std::memset(pix, 0, memsize);
                 if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
-                    char* bm = (char*)wacc.bitmapAt(cRect.x1, cRect.y1);
-                    assert(bm);
-                    std::memset(bm, 1, a);
+                    (*outputImage)->_bitmap.markForRendered(cRect);
                 }
             }
             if ( !bRect.isNull() ) {
@@ -1211,13 +1278,11 @@ Image::resizeInternal(const OSGLContextPtr& glContext,
                 std::size_t rowsize = mw * pixelSize;
                 int bw = bRect.width();
                 std::size_t rectRowSize = bw * pixelSize;
-                char* bm = ( setBitmapTo1 && (*outputImage)->usesBitMap() ) ? wacc.bitmapAt(bRect.x1, bRect.y1) : 0;
                 for (int y = bRect.y1; y < bRect.y2; ++y, pix += rowsize) {
                     std::memset(pix, 0, rectRowSize);
-                    if (bm) {
-                        std::memset(bm, 1, bw);
-                        bm += mw;
-                    }
+                }
+                if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
+                    (*outputImage)->_bitmap.markForRendered(bRect);
                 }
             }
             if ( !dRect.isNull() ) {
@@ -1227,13 +1292,11 @@ Image::resizeInternal(const OSGLContextPtr& glContext,
                 std::size_t rowsize = mw * pixelSize;
                 int dw = dRect.width();
                 std::size_t rectRowSize = dw * pixelSize;
-                char* bm = ( setBitmapTo1 && (*outputImage)->usesBitMap() ) ? wacc.bitmapAt(dRect.x1, dRect.y1) : 0;
                 for (int y = dRect.y1; y < dRect.y2; ++y, pix += rowsize) {
                     std::memset(pix, 0, rectRowSize);
-                    if (bm) {
-                        std::memset(bm, 1, dw);
-                        bm += mw;
-                    }
+                }
+                if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
+                    (*outputImage)->_bitmap.markForRendered(dRect);
                 }
             } // if (srcImg->getStorageMode() == eStorageModeGLTex) {
         }
@@ -1775,47 +1838,203 @@ Image::getRowElements() const
     return getComponentsCount() * _bounds.width();
 }
 
-// code proofread and fixed by @devernay on 4/12/2014
-template <typename PIX, int maxValue>
-void
-Image::halveRoIForDepth(const RectI & roi,
-                        bool copyBitMap,
-                        Image* output) const
+/*
+ * Box filter kernels used by halveRoIForDepth on the part of a row where the 2x2 source pixels
+ * of each destination pixel are all inside the source bounds.
+ * thisRow and nextRow point to the 2 source rows of the first destination pixel.
+ * They give exactly the same results as the generic code in halveRoIForDepth: the SSE2 versions
+ * sum the 4 values in the same order, and x * 0.25f equals x / 4 for floats.
+ */
+template <typename PIX, int nComps>
+static void
+halveRowInteriorForComponents(const PIX* thisRow,
+                              const PIX* nextRow,
+                              PIX* dst,
+                              int nPixels)
+{
+    for (int x = 0; x < nPixels; ++x, thisRow += 2 * nComps, nextRow += 2 * nComps, dst += nComps) {
+        for (int k = 0; k < nComps; ++k) {
+            dst[k] = (thisRow[k] + thisRow[k + nComps] + nextRow[k] + nextRow[k + nComps]) / 4;
+        }
+    }
+}
+
+#ifdef NATRON_USE_SSE2
+// The SSE2 kernels return the number of destination pixels processed, the remaining ones are
+// processed by halveRowInteriorForComponents
+
+static int
+halveRowInterior_SSE2(const float* thisRow,
+                      const float* nextRow,
+                      float* dst,
+                      int nPixels,
+                      int nComps)
 {
-    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) ||
-            (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) ||
-            (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    int x = 0;
 
-    ///handle case where there is only 1 column/row
-    if ( (roi.width() == 1) || (roi.height() == 1) ) {
-        assert( !(roi.width() == 1 && roi.height() == 1) ); /// can't be 1x1
-        halve1DImage(roi, output);
+    switch (nComps) {
+    case 1:
+        // 4 destination pixels per iteration
+        for (; x + 4 <= nPixels; x += 4, thisRow += 8, nextRow += 8, dst += 4) {
+            __m128 t0 = _mm_loadu_ps(thisRow);
+            __m128 t1 = _mm_loadu_ps(thisRow + 4);
+            __m128 n0 = _mm_loadu_ps(nextRow);
+            __m128 n1 = _mm_loadu_ps(nextRow + 4);
+            __m128 a = _mm_shuffle_ps( t0, t1, _MM_SHUFFLE(2, 0, 2, 0) );
+            __m128 b = _mm_shuffle_ps( t0, t1, _MM_SHUFFLE(3, 1, 3, 1) );
+            __m128 c = _mm_shuffle_ps( n0, n1, _MM_SHUFFLE(2, 0, 2, 0) );
+            __m128 d = _mm_shuffle_ps( n0, n1, _MM_SHUFFLE(3, 1, 3, 1) );
+            _mm_storeu_ps( dst, _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d), quarter) );
+        }
+        break;
+    case 2:
+        // 2 destination pixels per iteration
+        for (; x + 2 <= nPixels; x += 2, thisRow += 8, nextRow += 8, dst += 4) {
+            __m128 t0 = _mm_loadu_ps(thisRow);
+            __m128 t1 = _mm_loadu_ps(thisRow + 4);
+            __m128 n0 = _mm_loadu_ps(nextRow);
+            __m128 n1 = _mm_loadu_ps(nextRow + 4);
+            __m128 a = _mm_shuffle_ps( t0, t1, _MM_SHUFFLE(1, 0, 1, 0) );
+            __m128 b = _mm_shuffle_ps( t0, t1, _MM_SHUFFLE(3, 2, 3, 2) );
+            __m128 c = _mm_shuffle_ps( n0, n1, _MM_SHUFFLE(1, 0, 1, 0) );
+            __m128 d = _mm_shuffle_ps( n0, n1, _MM_SHUFFLE(3, 2, 3, 2) );
+            _mm_storeu_ps( dst, _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d), quarter) );
+        }
+        break;
+    case 4:
+        for (; x < nPixels; ++x, thisRow += 8, nextRow += 8, dst += 4) {
+            __m128 a = _mm_loadu_ps(thisRow);
+            __m128 b = _mm_loadu_ps(thisRow + 4);
+            __m128 c = _mm_loadu_ps(nextRow);
+            __m128 d = _mm_loadu_ps(nextRow + 4);
+            _mm_storeu_ps( dst, _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d), quarter) );
+        }
+        break;
+    default:
+        break;
+    }
 
-        return;
+    return x;
+}
+
+static int
+halveRowInterior_SSE2(const unsigned char* thisRow,
+                      const unsigned char* nextRow,
+                      unsigned char* dst,
+                      int nPixels,
+                      int nComps)
+{
+    if (nComps != 4) {
+        return 0;
     }
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
 
-    /// Take the lock for both bitmaps since we're about to read/write from them!
-    QWriteLocker k1(&output->_entryLock);
-    QReadLocker k2(&_entryLock);
+    // 2 RGBA destination pixels per iteration, sums are computed on 16 bits
+    for (; x + 2 <= nPixels; x += 2, thisRow += 16, nextRow += 16, dst += 8) {
+        __m128i t = _mm_loadu_si128( (const __m128i*)thisRow );
+        __m128i n = _mm_loadu_si128( (const __m128i*)nextRow );
+        __m128i lo = _mm_add_epi16( _mm_unpacklo_epi8(t, zero), _mm_unpacklo_epi8(n, zero) ); // columns 0 and 1
+        __m128i hi = _mm_add_epi16( _mm_unpackhi_epi8(t, zero), _mm_unpackhi_epi8(n, zero) ); // columns 2 and 3
+        __m128i sum = _mm_add_epi16( _mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi) );
+        __m128i avg = _mm_srli_epi16(sum, 2);
+        _mm_storel_epi64( (__m128i*)dst, _mm_packus_epi16(avg, avg) );
+    }
 
-    ///The source rectangle, intersected to this image region of definition in pixels
-    const RectI &srcBounds = _bounds;
-    const RectI &dstBounds = output->_bounds;
-    const RectI &srcBmBounds = _bitmap.getBounds();
-    const RectI &dstBmBounds = output->_bitmap.getBounds();
-    assert( !copyBitMap || usesBitMap() );
-    assert( !usesBitMap() || (srcBmBounds == srcBounds && dstBmBounds == dstBounds) );
+    return x;
+}
 
-    // the srcRoD of the output should be enclosed in half the roi.
-    // It does not have to be exactly half of the input.
-    //    assert(dstRoD.x1*2 >= roi.x1 &&
-    //           dstRoD.x2*2 <= roi.x2 &&
-    //           dstRoD.y1*2 >= roi.y1 &&
-    //           dstRoD.y2*2 <= roi.y2 &&
-    //           dstRoD.width()*2 <= roi.width() &&
-    //           dstRoD.height()*2 <= roi.height());
-    assert( getComponents() == output->getComponents() );
+static int
+halveRowInterior_SSE2(const unsigned short* thisRow,
+                      const unsigned short* nextRow,
+                      unsigned short* dst,
+                      int nPixels,
+                      int nComps)
+{
+    if (nComps != 4) {
+        return 0;
+    }
+    const __m128i zero = _mm_setzero_si128();
+    // no unsigned saturated pack from 32 to 16 bits in SSE2, see Color::convertDepthRow
+    const __m128i offset32 = _mm_set1_epi32(0x8000);
+    const __m128i offset16 = _mm_set1_epi16( (short)0x8000 );
+    int x = 0;
+
+    // 2 RGBA destination pixels per iteration, sums are computed on 32 bits
+    for (; x + 2 <= nPixels; x += 2, thisRow += 16, nextRow += 16, dst += 8) {
+        __m128i avg[2];
+        for (int i = 0; i < 2; ++i) {
+            __m128i t = _mm_loadu_si128( (const __m128i*)(thisRow + i * 8) );
+            __m128i n = _mm_loadu_si128( (const __m128i*)(nextRow + i * 8) );
+            __m128i sum = _mm_add_epi32( _mm_add_epi32( _mm_unpacklo_epi16(t, zero), _mm_unpackhi_epi16(t, zero) ),
+                                         _mm_add_epi32( _mm_unpacklo_epi16(n, zero), _mm_unpackhi_epi16(n, zero) ) );
+            avg[i] = _mm_sub_epi32(_mm_srli_epi32(sum, 2), offset32);
+        }
+        _mm_storeu_si128( (__m128i*)dst, _mm_xor_si128(_mm_packs_epi32(avg[0], avg[1]), offset16) );
+    }
+
+    return x;
+}
+
+#endif // NATRON_USE_SSE2
+
+template <typename PIX>
+static void
+halveRowInterior(const PIX* thisRow,
+                 const PIX* nextRow,
+                 PIX* dst,
+                 int nPixels,
+                 int nComps)
+{
+    int x = 0;
+
+#ifdef NATRON_USE_SSE2
+    if ( Color::isSIMDEnabled() ) {
+        x = halveRowInterior_SSE2(thisRow, nextRow, dst, nPixels, nComps);
+    }
+#endif
+    thisRow += x * 2 * nComps;
+    nextRow += x * 2 * nComps;
+    dst += x * nComps;
+    nPixels -= x;
+    switch (nComps) {
+    case 1:
+        halveRowInteriorForComponents<PIX, 1>(thisRow, nextRow, dst, nPixels);
+        break;
+    case 2:
+        halveRowInteriorForComponents<PIX, 2>(thisRow, nextRow, dst, nPixels);
+        break;
+    case 3:
+        halveRowInteriorForComponents<PIX, 3>(thisRow, nextRow, dst, nPixels);
+        break;
+    case 4:
+        halveRowInteriorForComponents<PIX, 4>(thisRow, nextRow, dst, nPixels);
+        break;
+    default:
+        break;
+    }
+}
 
+/*
+ * Halves the roi of the source buffer into the destination buffer. The data pointers point to the pixel (0,0),
+ * which may be outside of the buffers, and the bitmaps are only used if copyBitMap is true.
+ * This is the implementation of halveRoIForDepth, it is also used by buildMipMapLevel to build the
+ * intermediate levels in temporary buffers.
+ */
+template <typename PIX>
+static void
+halveRoIBuffer(const RectI & roi,
+               bool copyBitMap,
+               int nComps,
+               const RectI & srcBounds,
+               const PIX* const srcData,
+               int srcRowSize,
+               const Bitmap* srcBm,
+               PIX* const dstData,
+               int dstRowSize,
+               Bitmap* dstBm)
+{
     RectI dstRoI;
     RectI srcRoI = roi;
     srcRoI.intersect(srcBounds, &srcRoI); // intersect srcRoI with the region of definition
@@ -1825,27 +2044,9 @@ Image::halveRoIForDepth(const RectI & roi,
     dstRoI.x2 = std::ceil(srcRoI.x2 / 2.);
     dstRoI.y2 = std::ceil(srcRoI.y2 / 2.);
 
-
-    const PIX* const srcPixels      = (const PIX*)pixelAt(srcBounds.x1,   srcBounds.y1);
-    const char* const srcBmPixels   = _bitmap.getBitmapAt(srcBmBounds.x1, srcBmBounds.y1);
-    PIX* const dstPixels          = (PIX*)output->pixelAt(dstBounds.x1,   dstBounds.y1);
-    char* const dstBmPixels = output->_bitmap.getBitmapAt(dstBmBounds.x1, dstBmBounds.y1);
-    int srcRowSize = srcBounds.width() * _nbComponents;
-    int dstRowSize = dstBounds.width() * _nbComponents;
-
-    // offset pointers so that srcData and dstData correspond to pixel (0,0)
-    const PIX* const srcData = srcPixels - (srcBounds.x1 * _nbComponents + srcRowSize * srcBounds.y1);
-    PIX* const dstData       = dstPixels - (dstBounds.x1 * _nbComponents + dstRowSize * dstBounds.y1);
-    const int srcBmRowSize = srcBmBounds.width();
-    const int dstBmRowSize = dstBmBounds.width();
-    const char* const srcBmData = srcBmPixels - (srcBmBounds.x1 + srcBmRowSize * srcBmBounds.y1);
-    char* const dstBmData       = dstBmPixels - (dstBmBounds.x1 + dstBmRowSize * dstBmBounds.y1);
-
     for (int y = dstRoI.y1; y < dstRoI.y2; ++y) {
         const PIX* const srcLineStart    = srcData + y * 2 * srcRowSize;
         PIX* const dstLineStart          = dstData + y     * dstRowSize;
-        const char* const srcBmLineStart = srcBmData + y * 2 * srcBmRowSize;
-        char* const dstBmLineStart       = dstBmData + y     * dstBmRowSize;
 
         // The current dst row, at y, covers the src rows y*2 (thisRow) and y*2+1 (nextRow).
         // Check that if are within srcBounds.
@@ -1855,11 +2056,32 @@ Image::halveRoIForDepth(const RectI & roi,
         int sumH = (int)pickNextRow + (int)pickThisRow;
         assert(sumH == 1 || sumH == 2);
 
+        // The dst columns for which the 4 src pixels are inside srcBounds are computed by the box filter kernel,
+        // the generic code below only handles the borders (and the bitmap).
+        int interiorX1 = dstRoI.x2, interiorX2 = dstRoI.x2;
+        if (sumH == 2) {
+            interiorX1 = std::max( dstRoI.x1, (int)std::ceil(srcBounds.x1 / 2.) );
+            interiorX2 = std::min( dstRoI.x2, (int)std::floor(srcBounds.x2 / 2.) );
+            if (interiorX1 < interiorX2) {
+                halveRowInterior(srcLineStart + interiorX1 * 2 * nComps,
+                                 srcLineStart + interiorX1 * 2 * nComps + srcRowSize,
+                                 dstLineStart + interiorX1 * nComps,
+                                 interiorX2 - interiorX1,
+                                 nComps);
+            } else {
+                interiorX1 = interiorX2 = dstRoI.x2;
+            }
+        }
+
         for (int x = dstRoI.x1; x < dstRoI.x2; ++x) {
-            const PIX* const srcPixStart    = srcLineStart   + x * 2 * _nbComponents;
-            const char* const srcBmPixStart = srcBmLineStart + x * 2;
-            PIX* const dstPixStart          = dstLineStart   + x * _nbComponents;
-            char* const dstBmPixStart       = dstBmLineStart + x;
+            const bool interiorPixel = x >= interiorX1 && x < interiorX2;
+            if (interiorPixel && !copyBitMap) {
+                x = interiorX2 - 1;
+                continue;
+            }
+
+            const PIX* const srcPixStart    = srcLineStart   + x * 2 * nComps;
+            PIX* const dstPixStart          = dstLineStart   + x * nComps;
 
             // The current dst col, at y, covers the src cols x*2 (thisCol) and x*2+1 (nextCol).
             // Check that if are within srcBounds.
@@ -1872,23 +2094,23 @@ Image::halveRoIForDepth(const RectI & roi,
             assert(0 < sum && sum <= 4);
 
             if (sum == 0) { // never happens
-                for (int k = 0; k < _nbComponents; ++k) {
+                for (int k = 0; k < nComps; ++k) {
                     dstPixStart[k] = 0;
                 }
                 if (copyBitMap) {
-                    dstBmPixStart[0] = 0;
+                    dstBm->setPixel(x, y, 0);
                 }
                 continue;
             }
 
-            for (int k = 0; k < _nbComponents; ++k) {
+            for (int k = 0; k < nComps && !interiorPixel; ++k) {
                 ///a b
                 ///c d
 
                 const PIX a = (pickThisCol && pickThisRow) ? *(srcPixStart + k) : 0;
-                const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + _nbComponents) : 0;
+                const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + nComps) : 0;
                 const PIX c = (pickThisCol && pickNextRow) ? *(srcPixStart + k + srcRowSize) : 0;
-                const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + _nbComponents)  : 0;
+                const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + nComps)  : 0;
 
                 assert( sumW == 2 || ( sumW == 1 && ( (a == 0 && c == 0) || (b == 0 && d == 0) ) ) );
                 assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
@@ -1899,10 +2121,10 @@ Image::halveRoIForDepth(const RectI & roi,
                 ///a b
                 ///c d
 
-                char a = (pickThisCol && pickThisRow) ? *(srcBmPixStart) : 0;
-                char b = (pickNextCol && pickThisRow) ? *(srcBmPixStart + 1) : 0;
-                char c = (pickThisCol && pickNextRow) ? *(srcBmPixStart + srcBmRowSize) : 0;
-                char d = (pickNextCol && pickNextRow) ? *(srcBmPixStart + srcBmRowSize  + 1)  : 0;
+                char a = (pickThisCol && pickThisRow) ? srcBm->getPixel(srcx, srcy) : 0;
+                char b = (pickNextCol && pickThisRow) ? srcBm->getPixel(srcx + 1, srcy) : 0;
+                char c = (pickThisCol && pickNextRow) ? srcBm->getPixel(srcx, srcy + 1) : 0;
+                char d = (pickNextCol && pickNextRow) ? srcBm->getPixel(srcx + 1, srcy + 1)  : 0;
 #if NATRON_ENABLE_TRIMAP
                 /*
                    The only correct solution is to convert pixels being rendered to 0 otherwise the caller
@@ -1925,11 +2147,63 @@ Image::halveRoIForDepth(const RectI & roi,
                 assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
                 assert(a + b + c + d <= sum); // bitmaps are 0 or 1
                 // the following is an integer division, the result can be 0 or 1
-                dstBmPixStart[0] = (a + b + c + d) / sum;
-                assert(dstBmPixStart[0] == 0 || dstBmPixStart[0] == 1);
+                dstBm->setPixel( x, y, (char)( (a + b + c + d) / sum ) );
             }
         }
     }
+} // halveRoIBuffer
+
+// code proofread and fixed by @devernay on 4/12/2014
+template <typename PIX, int maxValue>
+void
+Image::halveRoIForDepth(const RectI & roi,
+                        bool copyBitMap,
+                        Image* output) const
+{
+    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) ||
+            (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) ||
+            (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
+
+    ///handle case where there is only 1 column/row
+    if ( (roi.width() == 1) || (roi.height() == 1) ) {
+        assert( !(roi.width() == 1 && roi.height() == 1) ); /// can't be 1x1
+        halve1DImage(roi, output);
+
+        return;
+    }
+
+    /// Take the lock for both bitmaps since we're about to read/write from them!
+    QWriteLocker k1(&output->_entryLock);
+    QReadLocker k2(&_entryLock);
+
+    ///The source rectangle, intersected to this image region of definition in pixels
+    const RectI &srcBounds = _bounds;
+    const RectI &dstBounds = output->_bounds;
+    assert( !copyBitMap || usesBitMap() );
+    assert( !usesBitMap() || (_bitmap.getBounds() == srcBounds && output->_bitmap.getBounds() == dstBounds) );
+
+    // the srcRoD of the output should be enclosed in half the roi.
+    // It does not have to be exactly half of the input.
+    //    assert(dstRoD.x1*2 >= roi.x1 &&
+    //           dstRoD.x2*2 <= roi.x2 &&
+    //           dstRoD.y1*2 >= roi.y1 &&
+    //           dstRoD.y2*2 <= roi.y2 &&
+    //           dstRoD.width()*2 <= roi.width() &&
+    //           dstRoD.height()*2 <= roi.height());
+    assert( getComponents() == output->getComponents() );
+
+    const PIX* const srcPixels      = (const PIX*)pixelAt(srcBounds.x1,   srcBounds.y1);
+    PIX* const dstPixels          = (PIX*)output->pixelAt(dstBounds.x1,   dstBounds.y1);
+    int srcRowSize = srcBounds.width() * _nbComponents;
+    int dstRowSize = dstBounds.width() * _nbComponents;
+
+    // offset pointers so that srcData and dstData correspond to pixel (0,0)
+    const PIX* const srcData = srcPixels - (srcBounds.x1 * _nbComponents + srcRowSize * srcBounds.y1);
+    PIX* const dstData       = dstPixels - (dstBounds.x1 * _nbComponents + dstRowSize * dstBounds.y1);
+
+    halveRoIBuffer<PIX>(roi, copyBitMap, _nbComponents,
+                        srcBounds, srcData, srcRowSize, &_bitmap,
+                        dstData, dstRowSize, &output->_bitmap);
 } // halveRoIForDepth
 
 // code proofread and fixed by @devernay on 8/8/2014
@@ -2055,7 +2329,7 @@ Image::downscaleMipMap(const RectD& dstRod,
 //    roiCanonical.toPixelEnclosing(toLevel, par , &dstRoI);
     unsigned int downscaleLvls = toLevel - fromLevel;
 
-    assert( !copyBitMap || _bitmap.getBitmap() );
+    assert( !copyBitMap || _bitmap.getMemorySize() > 0 );
 
     RectI dstRoI  = roi.downscalePowerOfTwoSmallestEnclosing(downscaleLvls);
     ImagePtr tmpImg( new Image( getComponents(), dstRod, dstRoI, toLevel, par, getBitDepth(), getPremultiplication(), getFieldingOrder(), true) );
@@ -2102,6 +2376,83 @@ Image::checkForNaNs(const RectI& roi)
     return hasnan;
 }
 
+template <typename PIX, int nComps>
+static void
+replicatePixelForComponents(const PIX* srcPix,
+                            PIX* dstPix,
+                            int count)
+{
+    for (int i = 0; i < count; ++i, dstPix += nComps) {
+        for (int c = 0; c < nComps; ++c) {
+            dstPix[c] = srcPix[c];
+        }
+    }
+}
+
+/*
+ * Writes count copies of the source pixel, used by upscaleMipMapForDepth
+ */
+template <typename PIX>
+static void
+replicatePixel(const PIX* srcPix,
+               PIX* dstPix,
+               int count,
+               int nComps)
+{
+    switch (nComps) {
+    case 1:
+        std::fill(dstPix, dstPix + count, *srcPix);
+        break;
+    case 2:
+        replicatePixelForComponents<PIX, 2>(srcPix, dstPix, count);
+        break;
+    case 3:
+        replicatePixelForComponents<PIX, 3>(srcPix, dstPix, count);
+        break;
+    case 4:
+        replicatePixelForComponents<PIX, 4>(srcPix, dstPix, count);
+        break;
+    default:
+        break;
+    }
+}
+
+#ifdef NATRON_USE_SSE2
+template <>
+void
+replicatePixel(const float* srcPix,
+               float* dstPix,
+               int count,
+               int nComps)
+{
+    if ( (nComps == 4) && Color::isSIMDEnabled() ) {
+        const __m128 v = _mm_loadu_ps(srcPix);
+        for (int i = 0; i < count; ++i, dstPix += 4) {
+            _mm_storeu_ps(dstPix, v);
+        }
+
+        return;
+    }
+    switch (nComps) {
+    case 1:
+        std::fill(dstPix, dstPix + count, *srcPix);
+        break;
+    case 2:
+        replicatePixelForComponents<float, 2>(srcPix, dstPix, count);
+        break;
+    case 3:
+        replicatePixelForComponents<float, 3>(srcPix, dstPix, count);
+        break;
+    case 4:
+        replicatePixelForComponents<float, 4>(srcPix, dstPix, count);
+        break;
+    default:
+        break;
+    }
+}
+
+#endif
+
 // code proofread and fixed by @devernay on 8/8/2014
 template <typename PIX, int maxValue>
 void
@@ -2164,16 +2515,8 @@ Image::upscaleMipMapForDepth(const RectI & roi,
             xcount = std::min(xcount, dstRoi.x2 - xo);
             //assert(0 < xcount && xcount <= scale);
             // replicate srcPix as many times as necessary
-            PIX * dstPix = dstPixFirst;
-            //assert((srcPix-(PIX*)pixelAt(srcRoi.x1, srcRoi.y1)) % components == 0);
-            for (int i = 0; i < xcount; ++i, dstPix += _nbComponents) {
-                assert( ( dstPix - (PIX*)output->pixelAt(dstRoi.x1, dstRoi.y1) ) % _nbComponents == 0 );
-                assert(dstPix >= (PIX*)output->pixelAt(xo, yo) && dstPix < (PIX*)output->pixelAt(xo, yo) + xcount * _nbComponents);
-                for (int c = 0; c < _nbComponents; ++c) {
-                    dstPix[c] = srcPix[c];
-                }
-            }
-            //assert(dstPix == dstPixFirst + xcount*components);
+            assert( dstPixFirst == (PIX*)output->pixelAt(xo, yo) );
+            replicatePixel(srcPix, dstPixFirst, xcount, _nbComponents);
         }
         PIX * dstLineStart = dstLineBatchStart + dstRowSize; // first line was filled already
         // now replicate the line as many times as necessary
@@ -2233,6 +2576,25 @@ Image::buildMipMapLevel(const RectD& dstRoD,
         return;
     }
 
+    bool done = false;
+    switch ( getBitDepth() ) {
+    case eImageBitDepthByte:
+        done = buildMipMapLevelForDepth<unsigned char>(roi, level, copyBitMap, output);
+        break;
+    case eImageBitDepthShort:
+        done = buildMipMapLevelForDepth<unsigned short>(roi, level, copyBitMap, output);
+        break;
+    case eImageBitDepthFloat:
+        done = buildMipMapLevelForDepth<float>(roi, level, copyBitMap, output);
+        break;
+    case eImageBitDepthHalf:
+    case eImageBitDepthNone:
+        break;
+    }
+    if (done) {
+        return;
+    }
+
     const Image* srcImg = this;
     Image* dstImg = NULL;
     bool mustFreeSrc = false;
@@ -2272,6 +2634,76 @@ Image::buildMipMapLevel(const RectD& dstRoD,
     }
 } // buildMipMapLevel
 
+template <typename PIX>
+bool
+Image::buildMipMapLevelForDepth(const RectI & roi,
+                                unsigned int level,
+                                bool copyBitMap,
+                                Image* output) const
+{
+    ///The roi at each level
+    std::vector<RectI> levelRoIs(level + 1);
+
+    levelRoIs[0] = roi;
+    for (unsigned int i = 1; i <= level; ++i) {
+        levelRoIs[i] = levelRoIs[i - 1].downscalePowerOfTwoSmallestEnclosing(1);
+    }
+    for (unsigned int i = 0; i < level; ++i) {
+        if ( (levelRoIs[i].width() <= 1) || (levelRoIs[i].height() <= 1) ) {
+            // 1D images are handled by halve1DImage
+            return false;
+        }
+    }
+    assert( !copyBitMap || (usesBitMap() && output->usesBitMap()) );
+
+    QWriteLocker k1(&output->_entryLock);
+    QReadLocker k2(&_entryLock);
+
+    ///The intermediate levels are written alternately to 2 temporary buffers instead of images,
+    ///the last one is written directly to the output
+    std::vector<PIX> buffers[2];
+    Bitmap bmBuffers[2];
+
+    // data pointers correspond to pixel (0,0), see halveRoIBuffer
+    RectI srcBounds = _bounds;
+    int srcRowSize = srcBounds.width() * _nbComponents;
+    const PIX* srcData = (const PIX*)pixelAt(srcBounds.x1, srcBounds.y1) - (srcBounds.x1 * _nbComponents + srcRowSize * srcBounds.y1);
+    const Bitmap* srcBm = &_bitmap;
+
+    for (unsigned int i = 1; i <= level; ++i) {
+        RectI dstBounds;
+        PIX* dstPixels;
+        Bitmap* dstBm;
+        if (i == level) {
+            dstBounds = output->_bounds;
+            dstPixels = (PIX*)output->pixelAt(dstBounds.x1, dstBounds.y1);
+            dstBm = &output->_bitmap;
+        } else {
+            dstBounds = levelRoIs[i];
+            std::vector<PIX>& buffer = buffers[i % 2];
+            buffer.resize( (std::size_t)dstBounds.area() * _nbComponents );
+            dstPixels = &buffer[0];
+            dstBm = &bmBuffers[i % 2];
+            if (copyBitMap) {
+                dstBm->initialize(dstBounds);
+            }
+        }
+        int dstRowSize = dstBounds.width() * _nbComponents;
+        PIX* dstData = dstPixels - (dstBounds.x1 * _nbComponents + dstRowSize * dstBounds.y1);
+
+        halveRoIBuffer<PIX>(levelRoIs[i - 1], copyBitMap, _nbComponents,
+                            srcBounds, srcData, srcRowSize, srcBm,
+                            dstData, dstRowSize, dstBm);
+
+        srcBounds = dstBounds;
+        srcData = dstData;
+        srcRowSize = dstRowSize;
+        srcBm = dstBm;
+    }
+
+    return true;
+} // buildMipMapLevelForDepth
+
 double
 Image::getScaleFromMipMapLevel(unsigned int level)
 {
@@ -2306,15 +2738,14 @@ Bitmap::copyRowPortion(int x1,
                        int y,
                        const Bitmap& other)
 {
-    const char* srcBitmap = other.getBitmapAt(x1, y);
-    char* dstBitmap = getBitmapAt(x1, y);
-    const char* end = dstBitmap + (x2 - x1);
-
-    while (dstBitmap < end) {
-        *dstBitmap = /**srcBitmap == PIXEL_UNAVAILABLE ? 0 : */ *srcBitmap;
-        ++dstBitmap;
-        ++srcBitmap;
+    assert(x1 >= _bounds.x1 && x2 <= _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2);
+    assert(x1 >= other._bounds.x1 && x2 <= other._bounds.x2 && y >= other._bounds.y1 && y < other._bounds.y2);
+    if (x1 >= x2) {
+        return;
     }
+    const U64* srcRow = other._map.getData() + (std::size_t)(y - other._bounds.y1) * other._rowWords;
+    U64* dstRow = _map.getData() + (std::size_t)(y - _bounds.y1) * _rowWords;
+    copyPixels(srcRow, x1 - other._bounds.x1, dstRow, x1 - _bounds.x1, x2 - x1);
 }
 
 void
@@ -2331,22 +2762,8 @@ Bitmap::copyBitmapPortion(const RectI& roi,
     assert(roi.x1 >= _bounds.x1 && roi.x2 <= _bounds.x2 && roi.y1 >= _bounds.y1 && roi.y2 <= _bounds.y2);
     assert(roi.x1 >= other._bounds.x1 && roi.x2 <= other._bounds.x2 && roi.y1 >= other._bounds.y1 && roi.y2 <= other._bounds.y2);
 
-    int srcRowSize = other._bounds.width();
-    int dstRowSize = _bounds.width();
-    const char* srcBitmap = other.getBitmapAt(roi.x1, roi.y1);
-    char* dstBitmap = getBitmapAt(roi.x1, roi.y1);
-
-    for (int y = roi.y1; y < roi.y2; ++y,
-         srcBitmap += srcRowSize,
-         dstBitmap += dstRowSize) {
-        const char* srcCur = srcBitmap;
-        const char* srcEnd = srcBitmap + roi.width();
-        char* dstCur = dstBitmap;
-        while (srcCur < srcEnd) {
-            *dstCur = /**srcCur == PIXEL_UNAVAILABLE ? 0 : */ *srcCur;
-            ++srcCur;
-            ++dstCur;
-        }
+    for (int y = roi.y1; y < roi.y2; ++y) {
+        copyRowPortion(roi.x1, roi.x2, y, other);
     }
 }
 
@@ -63,11 +63,18 @@ public:
     }
 };
 
+/**
+ * @brief The render state of each pixel of an image: 0 if not rendered, 1 if rendered and 2 if being rendered
+ * by another thread (only with NATRON_ENABLE_TRIMAP).
+ * Each pixel takes 2 bits and each row starts on a 64-bit word, so that the bitmap is 4 times smaller than
+ * with a byte per pixel and the search functions can test 32 pixels at once.
+ **/
 class Bitmap
 {
 public:
     Bitmap(const RectI & bounds)
-        : _bounds(bounds)
+        : _bounds()
+        , _rowWords(0)
         , _map()
         , _dirtyZone()
         , _dirtyZoneSet(false)
@@ -76,12 +83,12 @@ public:
         // "identities" images (i.e: images that are just a link to another image). See EffectInstance :
         // "!!!Note that if isIdentity is true it will allocate an empty image object with 0 bytes of data."
         //assert(!rod.isNull());
-        _map.resize(bounds.area());
-        memset(_map.getData(), 0, _map.size());
+        initialize(bounds);
     }
 
     Bitmap()
         : _bounds()
+        , _rowWords(0)
         , _map()
         , _dirtyZone()
         , _dirtyZoneSet(false)
@@ -91,8 +98,9 @@ public:
     void initialize(const RectI & bounds)
     {
         _bounds = bounds;
-        _map.resize( _bounds.area() );
-        memset(_map.getData(), 0, _map.size());
+        _rowWords = ( std::max(_bounds.width(), 0) + 31 ) / 32;
+        _map.resize( (U64)_rowWords * std::max(_bounds.height(), 0) );
+        memset( _map.getData(), 0, _map.size() * sizeof(U64) );
     }
 
     ~Bitmap()
@@ -101,7 +109,8 @@ public:
 
     void setTo1()
     {
-        memset(_map.getData(), 1, _map.size());
+        // 01 for each pixel
+        memset( _map.getData(), 0x55, _map.size() * sizeof(U64) );
     }
 
     const RectI & getBounds() const
@@ -109,6 +118,14 @@ public:
         return _bounds;
     }
 
+    /**
+     * @brief Returns the number of bytes used to store the pixels state
+     **/
+    std::size_t getMemorySize() const
+    {
+        return _map.size() * sizeof(U64);
+    }
+
 #if NATRON_ENABLE_TRIMAP
     void minimalNonMarkedRects_trimap(const RectI & roi, std::list<RectI>& ret, bool* isBeingRenderedElsewhere) const;
     RectI minimalNonMarkedBbox_trimap(const RectI & roi, bool* isBeingRenderedElsewhere) const;
@@ -130,19 +147,31 @@ public:
 
     void swap(Bitmap& other);
 
-    const char* getBitmap() const
+    /**
+     * @brief Returns the state of the pixel at (x,y), which must be inside the bounds.
+     **/
+    char getPixel(int x,
+                  int y) const
     {
-        return _map.getData();
+        assert(x >= _bounds.x1 && x < _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2);
+        int rx = x - _bounds.x1;
+        U64 word = _map.getData()[(std::size_t)(y - _bounds.y1) * _rowWords + (rx >> 5)];
+
+        return (char)( ( word >> ( (rx & 31) * 2 ) ) & 3 );
     }
 
-    char* getBitmap()
+    void setPixel(int x,
+                  int y,
+                  char state)
     {
-        return _map.getData();
+        assert(x >= _bounds.x1 && x < _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2);
+        assert(state >= 0 && state <= 2);
+        int rx = x - _bounds.x1;
+        U64& word = _map.getData()[(std::size_t)(y - _bounds.y1) * _rowWords + (rx >> 5)];
+        int shift = (rx & 31) * 2;
+        word = ( word & ~( (U64)3 << shift ) ) | ( (U64)state << shift );
     }
 
-    const char* getBitmapAt(int x, int y) const;
-    char* getBitmapAt(int x, int y);
-
     void copyRowPortion(int x1, int x2, int y, const Bitmap& other);
 
     void copyBitmapPortion(const RectI& roi, const Bitmap& other);
@@ -154,8 +183,12 @@ public:
     }
 
 private:
+
+    void fill(const RectI& roi, char state);
+
     RectI _bounds;
-    RamBuffer<char> _map;
+    int _rowWords; // number of 64-bit words per row
+    RamBuffer<U64> _map;
 
     /**
      * This represents the zone that has potentially something to render. In minimalNonMarkedRects
@@ -360,7 +393,7 @@ public:
         std::size_t dt = dataSize();
         bool got = _entryLock.tryLockForRead();
 
-        dt += _bitmap.getBounds().area();
+        dt += _bitmap.getMemorySize();
         if (got) {
             _entryLock.unlock();
         }
@@ -467,14 +500,6 @@ public:
 
             return img->pixelAt(x, y);
         }
-
-        const char* bitmapAt(int x,
-                             int y) const
-        {
-            assert(img);
-
-            return img->getBitmapAt(x, y);
-        }
     };
 
     /**
@@ -517,14 +542,6 @@ public:
         {
             return img->pixelAt(x, y);
         }
-
-        char* bitmapAt(int x,
-                       int y) const
-        {
-            assert(img);
-
-            return img->getBitmapAt(x, y);
-        }
     };
 
     ReadAccess getReadRights() const
@@ -554,18 +571,6 @@ private:
      * of an image.
      **/
 
-    const char* getBitmapAt(int x,
-                            int y) const
-    {
-        return this->_bitmap.getBitmapAt(x, y);
-    }
-
-    char* getBitmapAt(int x,
-                      int y)
-    {
-        return this->_bitmap.getBitmapAt(x, y);
-    }
-
     /**
      * @brief Access pixels. The pointer must be cast to the appropriate type afterwards.
      **/
@@ -1048,6 +1053,13 @@ private:
     void buildMipMapLevel(const RectD& dstRoD, const RectI & roiCanonical, unsigned int level, bool copyBitMap,
                           Image* output) const;
 
+    /**
+     * @brief Builds all the mipmap levels in a single pass, with temporary buffers for the intermediate levels
+     * instead of images. Returns false if it could not be used (if one of the levels is 1D).
+     **/
+    template <typename PIX>
+    bool buildMipMapLevelForDepth(const RectI & roi, unsigned int level, bool copyBitMap, Image* output) const;
+
 
     /**
      * @brief Halve the given roi of this image into output.
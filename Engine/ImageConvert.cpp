@@ -162,6 +162,20 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
     if ( intersection.isNull() ) {
         return;
     }
+    if (!srcLut && !dstLut) {
+        ///No color-space conversion: this is a plain depth conversion of the rows
+        int rowValues = intersection.width() * nComp;
+        for (int y = 0; y < intersection.height(); ++y) {
+            const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(intersection.x1, intersection.y1 + y);
+            DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(intersection.x1, intersection.y1 + y);
+            Color::convertDepthRow(srcPixels, dstPixels, rowValues);
+            if (copyBitmap) {
+                dstImg.copyBitmapRowPortion(intersection.x1, intersection.x2, intersection.y1 + y, srcImg);
+            }
+        }
+
+        return;
+    }
     for (int y = 0; y < intersection.height(); ++y) {
         // coverity[dont_call]
         int start = rand() % intersection.width();
@@ -306,6 +320,20 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
     const Color::Lut* const srcLut = useColorspaces ? lutFromColorspace( (ViewerColorSpaceEnum)srcColorSpace ) : 0;
     const Color::Lut* const dstLut = useColorspaces ? lutFromColorspace( (ViewerColorSpaceEnum)dstColorSpace ) : 0;
 
+    if ( (srcNComps == 3) && (dstNComps == 4) && (srcMaxValue == 1) && (dstMaxValue == 1) && !srcLut && !dstLut ) {
+        ///Float RGB to RGBA without color-space conversion: just expand the rows
+        for (int y = 0; y < renderWindow.height(); ++y) {
+            const float* srcPixels = (const float*)srcImg.pixelAt(renderWindow.x1, renderWindow.y1 + y);
+            float* dstPixels = (float*)dstImg.pixelAt(renderWindow.x1, renderWindow.y1 + y);
+            Color::expandRGBToRGBARow(srcPixels, dstPixels, renderWindow.width(), useAlpha0 ? 0.f : 1.f);
+        }
+        if (copyBitmap) {
+            dstImg.copyBitmapPortion(renderWindow, srcImg);
+        }
+
+        return;
+    }
+
     for (int y = 0; y < renderWindow.height(); ++y) {
         ///Start of the line for error diffusion
         // coverity[dont_call]
@@ -27,8 +27,11 @@
 
 #include <algorithm> // min, max
 #include <cassert>
+#include <set>
 #include <stdexcept>
 
+#include <boost/atomic.hpp>
+
 #include <QtCore/QDataStream>
 #include <QtCore/QDateTime>
 #include <QtCore/QByteArray>
@@ -47,6 +50,7 @@
 #include "Engine/KnobSerialization.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/LibraryBinary.h"
+#include "Engine/NativeExpression.h"
 #include "Engine/Node.h"
 #include "Engine/Project.h"
 #include "Engine/StringAnimationManager.h"
@@ -213,6 +217,27 @@ typedef std::vector< std::pair< int, KnobIWPtr > > MastersMap;
 ///a curve for each dimension
 typedef std::vector< CurvePtr > CurvesMap;
 
+/**
+ * @brief An expression compiled to be evaluated without Python, with the parameters it uses in the order of their index
+ **/
+struct NativeKnobExpression
+{
+    NativeExpression program;
+    std::vector<KnobIWPtr> params;
+
+    // False if the expression uses the values of thisParam, which are not tracked as a dependency
+    bool hasTrackedDependencies;
+
+    NativeKnobExpression()
+        : program()
+        , params()
+        , hasTrackedDependencies(true)
+    {
+    }
+};
+
+typedef boost::shared_ptr<NativeKnobExpression> NativeKnobExpressionPtr;
+
 struct Expr
 {
     std::string expression; //< the one modified by Natron
@@ -225,8 +250,152 @@ struct Expr
 
     //PyObject* code;
 
+    ///Non-NULL if the expression can be evaluated without Python
+    NativeKnobExpressionPtr native;
+
     Expr()
-        : expression(), originalExpression(), exprInvalid(), hasRet(false) /*, code(0)*/ {}
+        : expression(), originalExpression(), exprInvalid(), hasRet(false) /*, code(0)*/, native() {}
+};
+
+/**
+ * @brief Resolves the names of an expression the same way as the variables declared by
+ * KnobHelperPrivate::declarePythonVariables()
+ **/
+class KnobExpressionScope
+    : public NativeExpression::Scope
+{
+public:
+
+    KnobExpressionScope(const KnobIPtr& thisParam,
+                        const NodePtr& node,
+                        NativeKnobExpression* expr)
+        : _thisParam(thisParam)
+        , _node(node)
+        , _expr(expr)
+    {
+    }
+
+    virtual ~KnobExpressionScope() {}
+
+    virtual bool isNameDeclared(const std::string& name) const OVERRIDE FINAL
+    {
+        // dimension is declared as well, but with the same meaning as natively
+        if ( (name == "thisNode") || (name == "thisGroup") || (name == "thisParam") || (name == "app") ||
+             (name == "random") || (name == "randomInt") || (name == "curve") ) {
+            return true;
+        }
+
+        return (bool)getSibling(name);
+    }
+
+    virtual int getParamIndex(const std::string& nodeName,
+                              const std::string& paramName,
+                              NativeExpression::ParamTypeEnum* type,
+                              int* nDims) OVERRIDE FINAL
+    {
+        KnobIPtr knob;
+
+        if (nodeName == "thisParam") {
+            knob = _thisParam;
+        } else {
+            NodePtr node;
+            if (nodeName == "thisNode") {
+                node = _node;
+            } else if (nodeName == "thisGroup") {
+                NodeGroupPtr isParentGrp = toNodeGroup( _node->getGroup() );
+                if (isParentGrp) {
+                    node = isParentGrp->getNode();
+                }
+            } else {
+                node = getSibling(nodeName);
+            }
+            if (node) {
+                knob = node->getKnobByName(paramName);
+            }
+        }
+        if (!knob) {
+            return -1;
+        }
+        if ( toKnobChoice(knob) ) {
+            *type = NativeExpression::eParamTypeChoice;
+        } else if ( toKnobInt(knob) ) {
+            *type = NativeExpression::eParamTypeInt;
+        } else if ( toKnobColor(knob) ) {
+            *type = NativeExpression::eParamTypeColor;
+        } else if ( toKnobDouble(knob) ) {
+            *type = NativeExpression::eParamTypeDouble;
+        } else if ( toKnobBool(knob) ) {
+            *type = NativeExpression::eParamTypeBool;
+        } else {
+            return -1;
+        }
+        *nDims = knob->getDimension();
+        if (knob == _thisParam) {
+            _expr->hasTrackedDependencies = false;
+        }
+        _expr->params.push_back(knob);
+
+        return (int)_expr->params.size() - 1;
+    }
+
+private:
+
+    NodePtr getSibling(const std::string& name) const
+    {
+        NodeCollectionPtr collection = _node->getGroup();
+        NodePtr ret = collection ? collection->getNodeByName(name) : NodePtr();
+
+        if ( ret && ( !ret->isActivated() || ret->getParentMultiInstance() ) ) {
+            return NodePtr();
+        }
+
+        return ret;
+    }
+
+    KnobIPtr _thisParam;
+    NodePtr _node;
+    NativeKnobExpression* _expr;
+};
+
+class KnobExpressionContext
+    : public NativeExpression::Context
+{
+public:
+
+    KnobExpressionContext(const std::vector<KnobIWPtr>& params)
+        : _params(params)
+    {
+    }
+
+    virtual ~KnobExpressionContext() {}
+
+    virtual bool getParamValue(int paramIndex,
+                               int dimension,
+                               bool atTime,
+                               double time,
+                               double* value) OVERRIDE FINAL
+    {
+        KnobIPtr knob = _params[paramIndex].lock();
+
+        if (!knob) {
+            return false;
+        }
+        if ( KnobDoubleBase* isDouble = dynamic_cast<KnobDoubleBase*>( knob.get() ) ) {
+            *value = atTime ? isDouble->getValueAtTime(time, dimension) : isDouble->getValue(dimension);
+        } else if ( KnobIntBase* isInt = dynamic_cast<KnobIntBase*>( knob.get() ) ) {
+            *value = atTime ? isInt->getValueAtTime(time, dimension) : isInt->getValue(dimension);
+        } else if ( KnobBoolBase* isBool = dynamic_cast<KnobBoolBase*>( knob.get() ) ) {
+            *value = atTime ? isBool->getValueAtTime(time, dimension) : isBool->getValue(dimension);
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+private:
+
+    const std::vector<KnobIWPtr>& _params;
 };
 
 struct KnobHelperPrivate
@@ -319,6 +488,10 @@ struct KnobHelperPrivate
     int listenersNotificationBlocked; // protected by valueChangedBlockedMutex
     bool isClipPreferenceSlave;
 
+    // Lookups of the results of the expressions, see KnobHelper::getExpressionsResultsStats()
+    boost::atomic<U64> nExpressionsResultsHits;
+    boost::atomic<U64> nExpressionsResultsMisses;
+
     KnobHelperPrivate(KnobHelper* publicInterface_,
                       const KnobHolderPtr& holder_,
                       int dimension_,
@@ -384,6 +557,8 @@ struct KnobHelperPrivate
         , valueChangedBlocked(0)
         , listenersNotificationBlocked(0)
         , isClipPreferenceSlave(false)
+        , nExpressionsResultsHits(0)
+        , nExpressionsResultsMisses(0)
     {
         {
             KnobHolderPtr h = holder.lock();
@@ -741,20 +916,13 @@ KnobHelper::deleteValuesAtTime(CurveChangeReason curveChangeReason,
         copyValuesFromCurve(dimension);
     }
 
-    try {
-        for (std::list<double>::const_iterator it = times.begin(); it != times.end(); ++it) {
-            curve->removeKeyFrameWithTime(*it);
-        }
-    } catch (const std::exception & e) {
-        //qDebug() << e.what();
-    }
+    // Remove all keyframes at once so that the derivatives are refreshed only once around them
+    curve->removeKeyFramesWithTimes(times);
 
     if (!useGuiCurve && hasGui) {
         CurvePtr guiCurve = hasGui->getCurve(view, dimension);
         assert(guiCurve);
-        for (std::list<double>::const_iterator it = times.begin(); it != times.end(); ++it) {
-            guiCurve->removeKeyFrameWithTime(*it);
-        }
+        guiCurve->removeKeyFramesWithTimes(times);
     }
 
 
@@ -1701,6 +1869,15 @@ KnobHelper::evaluateValueChangeInternal(int dimension,
     /// the application responsiveness
     onInternalValueChanged(dimension, time, view);
 
+    ///The results of the expressions depending on this knob are obsolete, even if listeners are not notified
+    if (originalReason != eValueChangedReasonTimeChanged) {
+        for (int i = 0; i < getDimension(); ++i) {
+            if ( (dimension == -1) || (dimension == i) ) {
+                invalidateExpressionsResults(i);
+            }
+        }
+    }
+
     bool ret = false;
     if ( ( (originalReason != eValueChangedReasonTimeChanged) || evaluateValueChangeOnTimeChange() ) && holder ) {
         holder->beginChanges();
@@ -2631,10 +2808,25 @@ KnobHelper::setExpressionInternal(int dimension,
         }
     }
 
+    // Single-line expressions using only what NativeExpression supports are evaluated without the GIL
+    NativeKnobExpressionPtr native;
+    KnobHolderPtr holder = getHolder();
+    EffectInstancePtr effect = toEffectInstance(holder);
+    if ( exprInvalid.empty() && !hasRetVariable && effect &&
+         ( dynamic_cast<KnobDoubleBase*>(this) || dynamic_cast<KnobIntBase*>(this) || dynamic_cast<KnobBoolBase*>(this) ) ) {
+        native.reset(new NativeKnobExpression);
+        KnobExpressionScope scope(shared_from_this(), effect->getNode(), native.get());
+        std::string nativeError;
+        if ( !native->program.compile(expression, scope, &nativeError) ) {
+            native.reset();
+        }
+    }
+
     //Set internal fields
 
     {
         QMutexLocker k(&_imp->expressionMutex);
+        _imp->expressions[dimension].native = native;
         _imp->expressions[dimension].hasRet = hasRetVariable;
         _imp->expressions[dimension].expression = exprCpy;
         _imp->expressions[dimension].originalExpression = expression;
@@ -2644,7 +2836,6 @@ KnobHelper::setExpressionInternal(int dimension,
         //NATRON_PYTHON_NAMESPACE::compilePyScript(exprCpy, &_imp->expressions[dimension].code);
     }
 
-    KnobHolderPtr holder = getHolder();
     if (holder) {
         //Parse listeners of the expression, to keep track of dependencies to indicate them to the user.
 
@@ -2732,6 +2923,7 @@ KnobHelper::clearExpression(int dimension,
         _imp->expressions[dimension].expression.clear();
         _imp->expressions[dimension].originalExpression.clear();
         _imp->expressions[dimension].exprInvalid.clear();
+        _imp->expressions[dimension].native.reset();
         //Py_XDECREF(_imp->expressions[dimension].code); //< new ref
         //_imp->expressions[dimension].code = 0;
     }
@@ -2887,6 +3079,89 @@ KnobHelper::executeExpression(double time,
     return true;
 }
 
+bool
+KnobHelper::evaluateNativeExpression(double time,
+                                     ViewIdx view,
+                                     int dimension,
+                                     double* value,
+                                     bool* isInt) const
+{
+    NativeKnobExpressionPtr native;
+    {
+        QMutexLocker k(&_imp->expressionMutex);
+        native = _imp->expressions[dimension].native;
+    }
+    if (!native) {
+        return false;
+    }
+    KnobExpressionContext context(native->params);
+
+    return native->program.evaluate(time, view, dimension, context, value, isInt);
+}
+
+bool
+KnobHelper::hasExpressionWithTrackedDependencies(int dimension) const
+{
+    QMutexLocker k(&_imp->expressionMutex);
+    const NativeKnobExpressionPtr& native = _imp->expressions[dimension].native;
+
+    return native && native->hasTrackedDependencies;
+}
+
+static void
+invalidateExpressionsResultsRecursive(KnobI* knob,
+                                      int dimension,
+                                      std::set<std::pair<KnobI*, int> >* visited)
+{
+    if ( !visited->insert( std::make_pair(knob, dimension) ).second ) {
+        return;
+    }
+    knob->clearExpressionsResults(dimension);
+
+    KnobI::ListenerDimsMap listeners;
+    knob->getListeners(listeners);
+    for (KnobI::ListenerDimsMap::iterator it = listeners.begin(); it != listeners.end(); ++it) {
+        KnobIPtr listener = it->first.lock();
+        if (!listener) {
+            continue;
+        }
+        for (std::size_t i = 0; i < it->second.size(); ++i) {
+            const KnobI::ListenerDim& dim = it->second[i];
+            // Other expressions are cleared when the hash of their node changes
+            if ( dim.isListening && dim.isExpr && ( (dim.targetDim == dimension) || (dim.targetDim == -1) ) &&
+                 listener->hasExpressionWithTrackedDependencies( (int)i ) ) {
+                invalidateExpressionsResultsRecursive(listener.get(), (int)i, visited);
+            }
+        }
+    }
+}
+
+void
+KnobHelper::invalidateExpressionsResults(int dimension)
+{
+    std::set<std::pair<KnobI*, int> > visited;
+
+    invalidateExpressionsResultsRecursive(this, dimension, &visited);
+}
+
+void
+KnobHelper::countExpressionResultLookup(bool found) const
+{
+    if (found) {
+        ++_imp->nExpressionsResultsHits;
+    } else {
+        ++_imp->nExpressionsResultsMisses;
+    }
+}
+
+void
+KnobHelper::getExpressionsResultsStats(U64* hits,
+                                       U64* misses) const
+{
+    *hits = _imp->nExpressionsResultsHits.load();
+    *misses = _imp->nExpressionsResultsMisses.load();
+}
+
 std::string
 KnobHelper::getExpression(int dimension) const
 {
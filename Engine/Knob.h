@@ -667,6 +667,19 @@ public:
                                              const std::string& oldName,
                                              const std::string& newName) = 0;
     virtual void clearExpressionsResults(int dimension) = 0;
+
+    /**
+     * @brief Clears the results of the expression of the given dimension, as well as the results of the expressions
+     * with tracked dependencies that depend on it, recursively.
+     **/
+    virtual void invalidateExpressionsResults(int dimension) = 0;
+
+    /**
+     * @brief Returns true if the expression of the given dimension only depends on the values of other knobs
+     * that are tracked as listeners, so that its results only have to be cleared when one of these knobs changes
+     * rather than whenever the hash of the node changes.
+     **/
+    virtual bool hasExpressionWithTrackedDependencies(int dimension) const = 0;
     virtual void clearExpression(int dimension, bool clearResults) = 0;
     virtual std::string getExpression(int dimension) const = 0;
 
@@ -707,6 +720,13 @@ public:
     virtual bool onKeyFrameSet(double time, ViewSpec view, const KeyFrame& key, int dimension) = 0;
     virtual bool setKeyFrame(const KeyFrame& key, ViewSpec view,  int dimension, ValueChangedReasonEnum reason) = 0;
 
+    /**
+     * @brief Same as calling setKeyFrame for each key, except that the curve and the knob are changed only once.
+     * This should be used to set the keyframes of a whole sequence, e.g. tracking results.
+     * @returns The number of keyframes that did not exist before.
+     **/
+    virtual int setKeyFrames(const std::list<KeyFrame>& keys, ViewSpec view, int dimension, ValueChangedReasonEnum reason) = 0;
+
     /**
      * @brief Called when the current time of the timeline changes.
      * It must get the value at the given time and notify  the gui it must
@@ -1573,6 +1593,14 @@ protected:
     ///The return value must be Py_DECRREF
     bool executeExpression(double time, ViewIdx view, int dimension, PyObject** ret, std::string* error) const;
 
+    /**
+     * @brief Evaluates the expression without Python if it could be compiled natively. Returns false if it must be
+     * evaluated by executeExpression() instead. isInt is set to true if Python would have returned an int.
+     **/
+    bool evaluateNativeExpression(double time, ViewIdx view, int dimension, double* value, bool* isInt) const;
+
+    void countExpressionResultLookup(bool found) const;
+
 public:
 
     virtual std::pair<int, KnobIPtr > getMaster(int dimension) const OVERRIDE FINAL WARN_UNUSED_RETURN;
@@ -1590,6 +1618,15 @@ public:
     virtual void getAllExpressionDependenciesRecursive(std::set<NodePtr >& nodes) const OVERRIDE FINAL;
     virtual void getListeners(KnobI::ListenerDimsMap& listeners) const OVERRIDE FINAL;
     virtual void clearExpressionsResults(int /*dimension*/) OVERRIDE {}
+    virtual void invalidateExpressionsResults(int dimension) OVERRIDE FINAL;
+    virtual bool hasExpressionWithTrackedDependencies(int dimension) const OVERRIDE FINAL WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the number of values of the expressions of this knob that were found in the results cache
+     * and the number of values that had to be evaluated.
+     **/
+    void getExpressionsResultsStats(U64* hits,
+                                    U64* misses) const;
 
     void incrementExpressionRecursionLevel() const;
 
@@ -1812,6 +1849,7 @@ public:
                                               bool hasChanged = false); //!< set to true if any previous dimension of the same knob have changed
 
     virtual bool setKeyFrame(const KeyFrame& key, ViewSpec view, int dimension, ValueChangedReasonEnum reason) OVERRIDE FINAL;
+    virtual int setKeyFrames(const std::list<KeyFrame>& keys, ViewSpec view, int dimension, ValueChangedReasonEnum reason) OVERRIDE FINAL;
 
     /**
      * @brief Set the value of the knob in the given dimension with the given reason.
@@ -2047,7 +2085,7 @@ public:
     void getExpressionResults(int dim,
                               FrameValueMap& map)
     {
-        QMutexLocker k(&_valueMutex);
+        QReadLocker k(&_exprResMutex);
 
         map = _exprRes[dim];
     }
@@ -2101,9 +2139,10 @@ private:
 
     virtual void clearExpressionsResults(int dimension) OVERRIDE FINAL
     {
-        QMutexLocker k(&_valueMutex);
+        QWriteLocker k(&_exprResMutex);
 
         _exprRes[dimension].clear();
+        ++_exprResAge[dimension];
     }
 
 
@@ -2189,7 +2228,7 @@ private:
 
 
     ///Here is all the stuff we couldn't get rid of the template parameter
-    mutable QMutex _valueMutex; //< protects _values & _guiValues & _defaultValues & ExprResults
+    mutable QMutex _valueMutex; //< protects _values & _guiValues & _defaultValues
     std::vector<T> _values, _guiValues;
 
     struct DefaultValue
@@ -2198,8 +2237,14 @@ private:
         bool defaultValueSet;
     };
     std::vector<DefaultValue> _defaultValues;
+
+    // Render threads looking up the result of an expression at the same time only take a read lock
+    mutable QReadWriteLock _exprResMutex; //< protects _exprRes & _exprResAge
     mutable ExprResults _exprRes;
 
+    // Incremented each time the results of a dimension are cleared, so that a result evaluated meanwhile is not cached
+    mutable std::vector<U64> _exprResAge;
+
     //Only for double and int
     mutable QReadWriteLock _minMaxMutex;
     std::vector<T>  _minimums, _maximums, _displayMins, _displayMaxs;
@@ -30,6 +30,7 @@
 #include "Knob.h"
 
 #include <cfloat>
+#include <climits>
 #include <stdexcept>
 #include <string>
 #include <algorithm> // min, max
@@ -106,7 +107,9 @@ Knob<T>::Knob(const KnobHolderPtr& holder,
     , _values(dimension)
     , _guiValues(dimension)
     , _defaultValues(dimension)
+    , _exprResMutex()
     , _exprRes(dimension)
+    , _exprResAge(dimension, 0)
     , _minMaxMutex(QReadWriteLock::Recursive)
     , _minimums(dimension)
     , _maximums(dimension)
@@ -417,6 +420,48 @@ hashFunction(unsigned int a)
     return a;
 }
 
+// Converts the result of a native expression the same way as pyObjectToType() converts an int or a float
+template <typename T>
+static bool
+nativeExpressionResultToType(double result,
+                             T* value)
+{
+    *value = (T)result;
+
+    return true;
+}
+
+template <>
+bool
+nativeExpressionResultToType(double result,
+                             int* value)
+{
+    if ( (result <= (double)INT_MIN - 1.) || (result >= (double)INT_MAX + 1.) ) {
+        return false;
+    }
+    *value = (int)result;
+
+    return true;
+}
+
+template <>
+bool
+nativeExpressionResultToType(double result,
+                             bool* value)
+{
+    *value = result != 0.;
+
+    return true;
+}
+
+template <>
+bool
+nativeExpressionResultToType(double /*result*/,
+                             std::string* /*value*/)
+{
+    return false;
+}
+
 template <typename T>
 bool
 Knob<T>::evaluateExpression(double time,
@@ -425,6 +470,13 @@ Knob<T>::evaluateExpression(double time,
                             T* value,
                             std::string* error)
 {
+    double nativeResult;
+    bool nativeResultIsInt;
+    if ( evaluateNativeExpression(time, view, dimension, &nativeResult, &nativeResultIsInt) &&
+         nativeExpressionResultToType<T>(nativeResult, value) ) {
+        return true;
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -447,6 +499,21 @@ Knob<T>::evaluateExpression_pod(double time,
                                 double* value,
                                 std::string* error)
 {
+    double nativeResult;
+    bool nativeResultIsInt;
+    int nativeIntResult;
+    if ( evaluateNativeExpression(time, view, dimension, &nativeResult, &nativeResultIsInt) ) {
+        if (!nativeResultIsInt) {
+            *value = nativeResult;
+
+            return true;
+        } else if ( nativeExpressionResultToType<int>(nativeResult, &nativeIntResult) ) {
+            *value = nativeIntResult;
+
+            return true;
+        }
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -489,15 +556,19 @@ Knob<T>::getValueFromExpression(double time,
 
     ///Check first if a value was already computed:
 
+    U64 age;
     {
-        QMutexLocker k(&_valueMutex);
-        typename FrameValueMap::iterator found = _exprRes[dimension].find(time);
+        QReadLocker k(&_exprResMutex);
+        typename FrameValueMap::const_iterator found = _exprRes[dimension].find(time);
         if ( found != _exprRes[dimension].end() ) {
             *ret = found->second;
+            countExpressionResultLookup(true);
 
             return true;
         }
+        age = _exprResAge[dimension];
     }
+    countExpressionResultLookup(false);
 
     bool exprWasValid = isExpressionValid(dimension, 0);
     {
@@ -519,8 +590,10 @@ Knob<T>::getValueFromExpression(double time,
         *ret =  clampToMinMax(*ret, dimension);
     }
 
-    QMutexLocker k(&_valueMutex);
-    _exprRes[dimension].insert( std::make_pair(time, *ret) );
+    QWriteLocker k(&_exprResMutex);
+    if (_exprResAge[dimension] == age) {
+        _exprRes[dimension].insert( std::make_pair(time, *ret) );
+    }
 
     return true;
 }
@@ -577,14 +650,19 @@ Knob<T>::getValueFromExpression_pod(double time,
 
     ///Check first if a value was already computed:
 
+    U64 age;
+    {
+        QReadLocker k(&_exprResMutex);
+        typename FrameValueMap::const_iterator found = _exprRes[dimension].find(time);
+        if ( found != _exprRes[dimension].end() ) {
+            *ret = found->second;
+            countExpressionResultLookup(true);
 
-    QMutexLocker k(&_valueMutex);
-    typename FrameValueMap::iterator found = _exprRes[dimension].find(time);
-    if ( found != _exprRes[dimension].end() ) {
-        *ret = found->second;
-
-        return true;
+            return true;
+        }
+        age = _exprResAge[dimension];
     }
+    countExpressionResultLookup(false);
 
 
     bool exprWasValid = isExpressionValid(dimension, 0);
@@ -607,8 +685,10 @@ Knob<T>::getValueFromExpression_pod(double time,
         *ret =  clampToMinMax(*ret, dimension);
     }
 
-    //QWriteLocker k(&_valueMutex);
-    _exprRes[dimension].insert( std::make_pair(time, *ret) );
+    QWriteLocker k(&_exprResMutex);
+    if (_exprResAge[dimension] == age) {
+        _exprRes[dimension].insert( std::make_pair(time, *ret) );
+    }
 
     return true;
 }
@@ -2225,6 +2305,46 @@ Knob<T>::setKeyFrame(const KeyFrame& key,
     return ret;
 }
 
+template<typename T>
+int
+Knob<T>::setKeyFrames(const std::list<KeyFrame>& keys,
+                      ViewSpec view,
+                      int dimension,
+                      ValueChangedReasonEnum reason)
+{
+    if ( keys.empty() ) {
+        return 0;
+    }
+
+    CurvePtr curve;
+    KnobHolderPtr holder = getHolder();
+    bool useGuiCurve = ( !holder || !holder->isSetValueCurrentlyPossible() ) && getKnobGuiPointer();
+
+    if (!useGuiCurve) {
+        assert(holder);
+        curve = getCurve(view, dimension);
+    } else {
+        curve = getGuiCurve(view, dimension);
+        setGuiCurveHasChanged(view, dimension, true);
+    }
+
+    std::list<double> keysAdded;
+    int ret = curve->addKeyFrames(keys, &keysAdded);
+
+    if (!useGuiCurve) {
+        if (holder) {
+            holder->setHasAnimation(true);
+        }
+        guiCurveCloneInternalCurve(eCurveChangeReasonInternal, view, dimension, reason);
+        if ( _signalSlotHandler && !keysAdded.empty() ) {
+            _signalSlotHandler->s_multipleKeyFramesSet(keysAdded, view, dimension, (int)reason);
+        }
+        evaluateValueChange(dimension, keys.front().getTime(), view, reason);
+    }
+
+    return ret;
+}
+
 template<typename T>
 bool
 Knob<T>::onKeyFrameSet(double /*time*/,
@@ -2694,8 +2814,9 @@ Knob<T>::cloneExpressionsResults(const KnobIPtr& other,
         for (int i = 0; i < dimMin; ++i) {
             FrameValueMap results;
             otherKnob->getExpressionResults(i, results);
-            QMutexLocker k(&_valueMutex);
+            QWriteLocker k(&_exprResMutex);
             _exprRes[i] = results;
+            ++_exprResAge[i];
         }
     } else {
         if (otherDimension == -1) {
@@ -2703,8 +2824,9 @@ Knob<T>::cloneExpressionsResults(const KnobIPtr& other,
         }
         FrameValueMap results;
         otherKnob->getExpressionResults(otherDimension, results);
-        QMutexLocker k(&_valueMutex);
+        QWriteLocker k(&_exprResMutex);
         _exprRes[dimension] = results;
+        ++_exprResAge[dimension];
     }
 }
 
@@ -42,6 +42,7 @@
 //ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
 //OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
+#include <algorithm>
 #include <map>
 #include <list>
 #include <utility>
@@ -53,11 +54,13 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/bimap/set_of.hpp>
 #include <boost/bimap/unordered_set_of.hpp>
 #include <boost/bimap.hpp>
+#include <boost/unordered_map.hpp>
 CLANG_DIAG_ON(redeclared-class-member)
 CLANG_DIAG_ON(unknown-pragmas)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
 
+#include "Global/Enums.h"
 #include "Engine/EngineFwd.h"
 
 
@@ -672,6 +675,317 @@ private:
 };
 
 #    endif // !NATRON_CACHE_USE_HASH
+
+// With the 2Q policy, a key seen for the first time enters the probation queue, which is at most that fraction of the keys
+#define NATRON_CACHE_2Q_PROBATION_FRACTION 0.25
+
+// Keys evicted from the probation queue are remembered, up to that many times the number of keys (and at least
+// NATRON_CACHE_2Q_MIN_GHOSTS). Only the key is kept, so that a flipbook longer than the cache does not make it
+// forget the working set it evicted.
+#define NATRON_CACHE_2Q_GHOST_FRACTION 2
+#define NATRON_CACHE_2Q_MIN_GHOSTS 1024
+
+/**
+ * @brief Same as BoostLRUHashTable, but the eviction policy can be switched to 2Q (Johnson & Shasha, 1994).
+ *
+ * With the 2Q policy, keys inserted for the first time go to a FIFO probation queue and accessing them there does not
+ * change their order: a scan (e.g. a flipbook render or a tracking pass) touching each key only for a short while
+ * only cycles through the probation queue. The keys evicted from it are remembered (without their value) for a while,
+ * and if they are inserted again they go to the protected queue, which is ordered by LRU.
+ * Keys are evicted from the probation queue first while it holds more than NATRON_CACHE_2Q_PROBATION_FRACTION of the keys.
+ *
+ * Both queues are stored in the same list: protected keys from the least to the most recently used, followed by
+ * the probation keys from the oldest to the newest. The info of each record tells whether it is in probation.
+ **/
+template <typename K, typename V>
+class Boost2QHashTable
+{
+public:
+    typedef K key_type;
+    typedef std::list<V> value_type;
+#    ifdef NATRON_CACHE_USE_HASH
+    typedef boost::bimaps::unordered_set_of<key_type> key_set_type;
+#    else
+    typedef boost::bimaps::set_of<key_type> key_set_type;
+#    endif
+    typedef boost::bimaps::bimap<key_set_type, boost::bimaps::list_of<value_type>, boost::bimaps::with_info<bool> > container_type;
+    typedef typename container_type::left_iterator left_iterator;
+    typedef typename container_type::right_iterator right_iterator;
+
+    Boost2QHashTable()
+        : _container()
+        , _policy(NATRON_NAMESPACE::eCacheEvictionPolicyLRU)
+        , _probationBegin( _container.right.end() )
+        , _nProbation(0)
+        , _ghostKeys()
+        , _ghosts()
+    {
+    }
+
+    Boost2QHashTable(const Boost2QHashTable& other)
+        : _container(other._container)
+        , _policy(NATRON_NAMESPACE::eCacheEvictionPolicyLRU)
+        , _probationBegin( _container.right.end() )
+        , _nProbation(0)
+        , _ghostKeys()
+        , _ghosts()
+    {
+        // Iterators of other cannot be copied: the probation queue is rebuilt from the info of the records
+        setEvictionPolicy(other._policy);
+    }
+
+    Boost2QHashTable& operator=(const Boost2QHashTable& other)
+    {
+        if (this != &other) {
+            _container = other._container;
+            _policy = NATRON_NAMESPACE::eCacheEvictionPolicyLRU;
+            _probationBegin = _container.right.end();
+            _nProbation = 0;
+            clearGhosts();
+            setEvictionPolicy(other._policy);
+        }
+
+        return *this;
+    }
+
+    /**
+     * @brief Switching to LRU moves all keys to the protected queue, in their current order.
+     * Switching to 2Q keeps the keys in the protected queue.
+     **/
+    void setEvictionPolicy(NATRON_NAMESPACE::CacheEvictionPolicyEnum policy)
+    {
+        if (policy == NATRON_NAMESPACE::eCacheEvictionPolicyLRU) {
+            for (right_iterator it = _container.right.begin(); it != _container.right.end(); ++it) {
+                it->info = false;
+            }
+            _probationBegin = _container.right.end();
+            _nProbation = 0;
+            clearGhosts();
+        } else if (_policy == NATRON_NAMESPACE::eCacheEvictionPolicyLRU) {
+            // Happens only when copying: records flagged in probation are moved after the protected ones
+            _probationBegin = _container.right.end();
+            _nProbation = 0;
+            right_iterator it = _container.right.begin();
+            while ( it != _container.right.end() ) {
+                right_iterator next = it;
+                ++next;
+                if (it->info) {
+                    _container.right.relocate(_container.right.end(), it);
+                    if ( _probationBegin == _container.right.end() ) {
+                        _probationBegin = it;
+                    }
+                    ++_nProbation;
+                }
+                it = next;
+                if (it == _probationBegin) {
+                    break;
+                }
+            }
+        }
+        _policy = policy;
+    }
+
+    NATRON_NAMESPACE::CacheEvictionPolicyEnum getEvictionPolicy() const
+    {
+        return _policy;
+    }
+
+    // Returns the record of k without changing its order, end() if not found
+    left_iterator find(const key_type & k)
+    {
+        return _container.left.find(k);
+    }
+
+    // Returns the record of k, which is then considered as used, end() if not found
+    left_iterator operator()(const key_type & k)
+    {
+        left_iterator it = _container.left.find(k);
+
+        // Using a key in probation does not change its order
+        if ( ( it != _container.left.end() ) && !it->info ) {
+            _container.right.relocate( _probationBegin, _container.project_right(it) );
+        }
+
+        return it;
+    }
+
+    void erase(left_iterator it)
+    {
+        if (it->info) {
+            right_iterator rit = _container.project_right(it);
+            if (rit == _probationBegin) {
+                ++_probationBegin;
+            }
+            --_nProbation;
+        }
+        _container.left.erase(it);
+    }
+
+    left_iterator end()
+    {
+        return _container.left.end();
+    }
+
+    left_iterator begin()
+    {
+        return _container.left.begin();
+    }
+
+    void insert(const key_type & k,
+                const value_type& list)
+    {
+        insertKey(k, list);
+    }
+
+    void insert(const key_type & k,
+                const V & v)
+    {
+        left_iterator found = this->operator ()(k);
+
+        if ( found != _container.left.end() ) {
+            found->second.push_back(v);
+        } else {
+            value_type list;
+            list.push_back(v);
+            insertKey(k, list);
+        }
+    }
+
+    void clear()
+    {
+        _container.clear();
+        _probationBegin = _container.right.end();
+        _nProbation = 0;
+        clearGhosts();
+    }
+
+    /**
+     * @brief Removes and returns a value not used anywhere else, that is whose use_count() is 1, of the first key
+     * that has one in eviction order. Returns a NULL value if all values are used.
+     **/
+    std::pair<key_type, V> evict()
+    {
+        bool fromProbation = _nProbation > _container.size() * NATRON_CACHE_2Q_PROBATION_FRACTION;
+        std::pair<key_type, V> ret = evictFromQueue(fromProbation);
+
+        if (!ret.second) {
+            ret = evictFromQueue(!fromProbation);
+        }
+
+        return ret;
+    }
+
+    unsigned int size()
+    {
+        return _container.size();
+    }
+
+    // Number of keys in the probation queue
+    std::size_t getProbationSize() const
+    {
+        return _nProbation;
+    }
+
+private:
+
+    void insertKey(const key_type & k,
+                   const value_type& list)
+    {
+        bool probation = false;
+
+        if (_policy == NATRON_NAMESPACE::eCacheEvictionPolicy2Q) {
+            // Keys evicted from probation and used again are protected
+            typename GhostMap::iterator ghost = _ghosts.find(k);
+            if ( ghost != _ghosts.end() ) {
+                _ghostKeys.erase(ghost->second);
+                _ghosts.erase(ghost);
+            } else {
+                probation = true;
+            }
+        }
+        std::pair<typename container_type::iterator, bool> inserted = _container.insert( typename container_type::value_type(k, list, probation) );
+        if (!inserted.second) {
+            return;
+        }
+        right_iterator rit = _container.project_right(inserted.first);
+        if (probation) {
+            // New records are appended at the end of the list, which is the end of the probation queue
+            if ( _probationBegin == _container.right.end() ) {
+                _probationBegin = rit;
+            }
+            ++_nProbation;
+        } else {
+            _container.right.relocate(_probationBegin, rit);
+        }
+    }
+
+    std::pair<key_type, V> evictFromQueue(bool probation)
+    {
+        right_iterator it = probation ? _probationBegin : _container.right.begin();
+        right_iterator last = probation ? _container.right.end() : _probationBegin;
+
+        for (; it != last; ++it) {
+            for (typename std::list<V>::iterator it2 = it->first.begin(); it2 != it->first.end(); ++it2) {
+                if (it2->use_count() == 1) {
+                    std::pair<key_type, V> ret = std::make_pair(it->second, *it2);
+                    if (it->first.size() == 1) {
+                        if (probation) {
+                            rememberEvictedKey(it->second);
+                            if (it == _probationBegin) {
+                                ++_probationBegin;
+                            }
+                            --_nProbation;
+                        }
+                        _container.right.erase(it);
+                    } else {
+                        it->first.erase(it2);
+                    }
+
+                    return ret;
+                }
+            }
+        }
+
+        return std::make_pair( key_type(), V() );
+    }
+
+    void rememberEvictedKey(const key_type & k)
+    {
+        typename GhostMap::iterator ghost = _ghosts.find(k);
+
+        if ( ghost != _ghosts.end() ) {
+            _ghostKeys.erase(ghost->second);
+            _ghosts.erase(ghost);
+        }
+        _ghosts.insert( std::make_pair( k, _ghostKeys.insert(_ghostKeys.end(), k) ) );
+
+        std::size_t maxGhosts = std::max( (std::size_t)NATRON_CACHE_2Q_MIN_GHOSTS, (std::size_t)(_container.size() * NATRON_CACHE_2Q_GHOST_FRACTION) );
+        while (_ghosts.size() > maxGhosts) {
+            _ghosts.erase( _ghostKeys.front() );
+            _ghostKeys.pop_front();
+        }
+    }
+
+    void clearGhosts()
+    {
+        _ghostKeys.clear();
+        _ghosts.clear();
+    }
+
+    typedef boost::unordered_map<key_type, typename std::list<key_type>::iterator> GhostMap;
+
+    container_type _container;
+    NATRON_NAMESPACE::CacheEvictionPolicyEnum _policy;
+
+    // First record of the probation queue, end() if it is empty
+    right_iterator _probationBegin;
+    std::size_t _nProbation;
+
+    // Keys recently evicted from the probation queue, from the oldest to the newest
+    std::list<key_type> _ghostKeys;
+    GhostMap _ghosts;
+};
+
 #  endif // NATRON_CACHE_USE_BOOST
 
 #endif // !USE_VARIADIC_TEMPLATES
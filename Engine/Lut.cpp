@@ -29,6 +29,10 @@
 #include <cassert>
 #include <stdexcept>
 
+#ifdef NATRON_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "Engine/RectI.h"
 
 /*
@@ -1660,6 +1664,367 @@ hsv_to_rgb(float h,
         break;
     }
 } // hsv_to_rgb
+
+///////////////////////
+/////////////////////////////////////////// ROW CONVERTERS //////////////////////////////////////////////
+///////////////////////
+
+#ifdef NATRON_USE_SSE2
+static bool simdEnabled = true;
+#else
+static bool simdEnabled = false;
+#endif
+
+bool
+isSIMDAvailable()
+{
+#ifdef NATRON_USE_SSE2
+
+    return true;
+#else
+
+    return false;
+#endif
+}
+
+void
+setSIMDEnabled(bool enabled)
+{
+    simdEnabled = enabled && isSIMDAvailable();
+}
+
+bool
+isSIMDEnabled()
+{
+    return simdEnabled;
+}
+
+#ifdef NATRON_USE_SSE2
+// The SSE2 versions below process the bulk of the row, 8 or 16 values at a time, and return the number of
+// values processed: the remaining ones are converted by the scalar code.
+// Divisions are used on purpose instead of multiplications by the reciprocal, so that results are bit-exact
+// with intToFloat. In floatToInt, v * (numvals - 1) + 0.5 is exact in single precision as well in the [0,1] range.
+
+static int
+convertDepthRow_SSE2(const unsigned char* from,
+                     float* to,
+                     int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 maxValue = _mm_set1_ps(255.f);
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i v8 = _mm_loadu_si128( (const __m128i*)(from + i) );
+        __m128i lo16 = _mm_unpacklo_epi8(v8, zero);
+        __m128i hi16 = _mm_unpackhi_epi8(v8, zero);
+        _mm_storeu_ps( to + i, _mm_div_ps(_mm_cvtepi32_ps( _mm_unpacklo_epi16(lo16, zero) ), maxValue) );
+        _mm_storeu_ps( to + i + 4, _mm_div_ps(_mm_cvtepi32_ps( _mm_unpackhi_epi16(lo16, zero) ), maxValue) );
+        _mm_storeu_ps( to + i + 8, _mm_div_ps(_mm_cvtepi32_ps( _mm_unpacklo_epi16(hi16, zero) ), maxValue) );
+        _mm_storeu_ps( to + i + 12, _mm_div_ps(_mm_cvtepi32_ps( _mm_unpackhi_epi16(hi16, zero) ), maxValue) );
+    }
+
+    return i;
+}
+
+static int
+convertDepthRow_SSE2(const unsigned short* from,
+                     float* to,
+                     int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 maxValue = _mm_set1_ps(65535.f);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i v16 = _mm_loadu_si128( (const __m128i*)(from + i) );
+        _mm_storeu_ps( to + i, _mm_div_ps(_mm_cvtepi32_ps( _mm_unpacklo_epi16(v16, zero) ), maxValue) );
+        _mm_storeu_ps( to + i + 4, _mm_div_ps(_mm_cvtepi32_ps( _mm_unpackhi_epi16(v16, zero) ), maxValue) );
+    }
+
+    return i;
+}
+
+// floatToInt for 4 values: clamp to [0,1], scale, round and truncate
+static inline __m128i
+floatToInt_SSE2(__m128 v,
+                __m128 maxValue)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    // _mm_max_ps returns its second operand if the first one is a NaN
+    v = _mm_min_ps( _mm_max_ps( v, _mm_setzero_ps() ), _mm_set1_ps(1.f) );
+
+    return _mm_cvttps_epi32( _mm_add_ps(_mm_mul_ps(v, maxValue), half) );
+}
+
+static int
+convertDepthRow_SSE2(const float* from,
+                     unsigned char* to,
+                     int n)
+{
+    const __m128 maxValue = _mm_set1_ps(255.f);
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = floatToInt_SSE2(_mm_loadu_ps(from + i), maxValue);
+        __m128i b = floatToInt_SSE2(_mm_loadu_ps(from + i + 4), maxValue);
+        __m128i c = floatToInt_SSE2(_mm_loadu_ps(from + i + 8), maxValue);
+        __m128i d = floatToInt_SSE2(_mm_loadu_ps(from + i + 12), maxValue);
+        __m128i v8 = _mm_packus_epi16( _mm_packs_epi32(a, b), _mm_packs_epi32(c, d) );
+        _mm_storeu_si128( (__m128i*)(to + i), v8 );
+    }
+
+    return i;
+}
+
+static int
+convertDepthRow_SSE2(const float* from,
+                     unsigned short* to,
+                     int n)
+{
+    const __m128 maxValue = _mm_set1_ps(65535.f);
+    // there is no unsigned saturated pack from 32 to 16 bits in SSE2: pack signed values
+    // offset by 0x8000 and restore the offset afterwards
+    const __m128i offset32 = _mm_set1_epi32(0x8000);
+    const __m128i offset16 = _mm_set1_epi16( (short)0x8000 );
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_sub_epi32(floatToInt_SSE2(_mm_loadu_ps(from + i), maxValue), offset32);
+        __m128i b = _mm_sub_epi32(floatToInt_SSE2(_mm_loadu_ps(from + i + 4), maxValue), offset32);
+        _mm_storeu_si128( (__m128i*)(to + i), _mm_xor_si128(_mm_packs_epi32(a, b), offset16) );
+    }
+
+    return i;
+}
+
+static int
+convertDepthRow_SSE2(const unsigned short* from,
+                     unsigned char* to,
+                     int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(128);
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i packed[2];
+        for (int j = 0; j < 2; ++j) {
+            __m128i v16 = _mm_loadu_si128( (const __m128i*)(from + i + j * 8) );
+            // same as uint16ToChar: ((q + 128) - ((q + 128) >> 8)) >> 8
+            __m128i lo = _mm_add_epi32(_mm_unpacklo_epi16(v16, zero), rounding);
+            __m128i hi = _mm_add_epi32(_mm_unpackhi_epi16(v16, zero), rounding);
+            lo = _mm_srli_epi32(_mm_sub_epi32( lo, _mm_srli_epi32(lo, 8) ), 8);
+            hi = _mm_srli_epi32(_mm_sub_epi32( hi, _mm_srli_epi32(hi, 8) ), 8);
+            packed[j] = _mm_packs_epi32(lo, hi);
+        }
+        _mm_storeu_si128( (__m128i*)(to + i), _mm_packus_epi16(packed[0], packed[1]) );
+    }
+
+    return i;
+}
+
+static int
+convertDepthRow_SSE2(const unsigned char* from,
+                     unsigned short* to,
+                     int n)
+{
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i v8 = _mm_loadu_si128( (const __m128i*)(from + i) );
+        // interleaving each byte with itself gives (q << 8) | q
+        _mm_storeu_si128( (__m128i*)(to + i), _mm_unpacklo_epi8(v8, v8) );
+        _mm_storeu_si128( (__m128i*)(to + i + 8), _mm_unpackhi_epi8(v8, v8) );
+    }
+
+    return i;
+}
+
+static int
+expandRGBToRGBARow_SSE2(const float* from,
+                        float* to,
+                        int n,
+                        float alpha)
+{
+    int i = 0;
+
+    // 4 pixels (12 floats in, 16 floats out) per iteration
+    for (; i + 4 <= n; i += 4) {
+        const float* src = from + i * 3;
+        float* dst = to + i * 4;
+        __m128 a = _mm_loadu_ps(src);     // r0 g0 b0 r1
+        __m128 b = _mm_loadu_ps(src + 4); // g1 b1 r2 g2
+        __m128 c = _mm_loadu_ps(src + 8); // b2 r3 g3 b3
+        // r1 r1 g1 b1 -> r1 g1 b1 x
+        __m128 p1 = _mm_shuffle_ps(_mm_shuffle_ps( a, b, _MM_SHUFFLE(1, 0, 3, 3) ), b, _MM_SHUFFLE(3, 1, 2, 0));
+        // r2 g2 b2 x
+        __m128 p2 = _mm_shuffle_ps( b, c, _MM_SHUFFLE(0, 0, 3, 2) );
+        // r3 g3 b3 x
+        __m128 p3 = _mm_shuffle_ps( c, c, _MM_SHUFFLE(3, 3, 2, 1) );
+
+        _mm_storeu_ps(dst, a);
+        _mm_storeu_ps(dst + 4, p1);
+        _mm_storeu_ps(dst + 8, p2);
+        _mm_storeu_ps(dst + 12, p3);
+        dst[3] = alpha;
+        dst[7] = alpha;
+        dst[11] = alpha;
+        dst[15] = alpha;
+    }
+
+    return i;
+}
+
+#endif // NATRON_USE_SSE2
+
+void
+convertDepthRow(const unsigned char* from,
+                float* to,
+                int n)
+{
+    int i = 0;
+
+#ifdef NATRON_USE_SSE2
+    if (simdEnabled) {
+        i = convertDepthRow_SSE2(from, to, n);
+    }
+#endif
+    for (; i < n; ++i) {
+        to[i] = intToFloat<256>(from[i]);
+    }
+}
+
+void
+convertDepthRow(const unsigned short* from,
+                float* to,
+                int n)
+{
+    int i = 0;
+
+#ifdef NATRON_USE_SSE2
+    if (simdEnabled) {
+        i = convertDepthRow_SSE2(from, to, n);
+    }
+#endif
+    for (; i < n; ++i) {
+        to[i] = intToFloat<65536>(from[i]);
+    }
+}
+
+void
+convertDepthRow(const float* from,
+                unsigned char* to,
+                int n)
+{
+    int i = 0;
+
+#ifdef NATRON_USE_SSE2
+    if (simdEnabled) {
+        i = convertDepthRow_SSE2(from, to, n);
+    }
+#endif
+    for (; i < n; ++i) {
+        to[i] = (unsigned char)floatToInt<256>(from[i]);
+    }
+}
+
+void
+convertDepthRow(const float* from,
+                unsigned short* to,
+                int n)
+{
+    int i = 0;
+
+#ifdef NATRON_USE_SSE2
+    if (simdEnabled) {
+        i = convertDepthRow_SSE2(from, to, n);
+    }
+#endif
+    for (; i < n; ++i) {
+        to[i] = (unsigned short)floatToInt<65536>(from[i]);
+    }
+}
+
+void
+convertDepthRow(const unsigned short* from,
+                unsigned char* to,
+                int n)
+{
+    int i = 0;
+
+#ifdef NATRON_USE_SSE2
+    if (simdEnabled) {
+        i = convertDepthRow_SSE2(from, to, n);
+    }
+#endif
+    for (; i < n; ++i) {
+        to[i] = uint16ToChar(from[i]);
+    }
+}
+
+void
+convertDepthRow(const unsigned char* from,
+                unsigned short* to,
+                int n)
+{
+    int i = 0;
+
+#ifdef NATRON_USE_SSE2
+    if (simdEnabled) {
+        i = convertDepthRow_SSE2(from, to, n);
+    }
+#endif
+    for (; i < n; ++i) {
+        to[i] = charToUint16(from[i]);
+    }
+}
+
+void
+convertDepthRow(const unsigned char* from,
+                unsigned char* to,
+                int n)
+{
+    std::memcpy( to, from, n * sizeof(unsigned char) );
+}
+
+void
+convertDepthRow(const unsigned short* from,
+                unsigned short* to,
+                int n)
+{
+    std::memcpy( to, from, n * sizeof(unsigned short) );
+}
+
+void
+convertDepthRow(const float* from,
+                float* to,
+                int n)
+{
+    std::memcpy( to, from, n * sizeof(float) );
+}
+
+void
+expandRGBToRGBARow(const float* from,
+                   float* to,
+                   int n,
+                   float alpha)
+{
+    int i = 0;
+
+#ifdef NATRON_USE_SSE2
+    if (simdEnabled) {
+        i = expandRGBToRGBARow_SSE2(from, to, n, alpha);
+    }
+#endif
+    for (; i < n; ++i) {
+        to[i * 4] = from[i * 3];
+        to[i * 4 + 1] = from[i * 3 + 1];
+        to[i * 4 + 2] = from[i * 3 + 2];
+        to[i * 4 + 3] = alpha;
+    }
+}
 }     // namespace Color {
 NATRON_NAMESPACE_EXIT;
 
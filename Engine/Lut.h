@@ -578,6 +578,38 @@ charToUint8xx(unsigned char quantum)
      */
     return (unsigned short) (quantum << 8);
 }
+
+/**
+ * @brief Row converters between bit depths, without any color-space conversion. n is the number of values
+ * (not pixels) to convert. They give exactly the same results as intToFloat, floatToInt, uint16ToChar and
+ * charToUint16 above, but use SSE2 when Natron was compiled with it and SIMD is enabled.
+ **/
+void convertDepthRow(const unsigned char* from, float* to, int n);
+void convertDepthRow(const unsigned short* from, float* to, int n);
+void convertDepthRow(const float* from, unsigned char* to, int n);
+void convertDepthRow(const float* from, unsigned short* to, int n);
+void convertDepthRow(const unsigned short* from, unsigned char* to, int n);
+void convertDepthRow(const unsigned char* from, unsigned short* to, int n);
+void convertDepthRow(const unsigned char* from, unsigned char* to, int n);
+void convertDepthRow(const unsigned short* from, unsigned short* to, int n);
+void convertDepthRow(const float* from, float* to, int n);
+
+/**
+ * @brief Expands n RGB float pixels to RGBA, setting alpha to the given value.
+ **/
+void expandRGBToRGBARow(const float* from, float* to, int n, float alpha);
+
+/**
+ * @brief Returns true if the row converters above were compiled with SIMD instructions.
+ **/
+bool isSIMDAvailable();
+
+/**
+ * @brief When disabled, the row converters above use their scalar implementation. This is only
+ * meant to check the SIMD implementations against the scalar ones.
+ **/
+void setSIMDEnabled(bool enabled);
+bool isSIMDEnabled();
 }     //namespace Color
 
 NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,956 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "NativeExpression.h"
+
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846264338327950288
+#endif
+#ifndef M_E
+#define M_E 2.71828182845904523536028747135266250
+#endif
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum OpcodeEnum
+{
+    eOpcodeConstant = 0, // pushes the constant
+    eOpcodeFrame,
+    eOpcodeView,
+    eOpcodeDimension,
+    eOpcodeParamValue, // pushes the value of the dimension arg2 of the parameter arg at the current time
+    eOpcodeParamValueAtTime, // pops the time and pushes the value of the dimension arg2 of the parameter arg at that time
+    eOpcodeNegate,
+    eOpcodeAdd,
+    eOpcodeSubtract,
+    eOpcodeMultiply,
+    eOpcodeDivide,
+    eOpcodeFloorDivide,
+    eOpcodeModulo,
+    eOpcodePower,
+    eOpcodeLess,
+    eOpcodeLessEqual,
+    eOpcodeGreater,
+    eOpcodeGreaterEqual,
+    eOpcodeEqual,
+    eOpcodeNotEqual,
+    eOpcodeCall // pops arg2 arguments and pushes the result of the function arg
+};
+
+enum FunctionEnum
+{
+    eFunctionSin = 0,
+    eFunctionCos,
+    eFunctionTan,
+    eFunctionAsin,
+    eFunctionAcos,
+    eFunctionAtan,
+    eFunctionAtan2,
+    eFunctionSinh,
+    eFunctionCosh,
+    eFunctionTanh,
+    eFunctionExp,
+    eFunctionLog,
+    eFunctionLog10,
+    eFunctionSqrt,
+    eFunctionPow,
+    eFunctionFabs,
+    eFunctionFloor,
+    eFunctionCeil,
+    eFunctionFmod,
+    eFunctionHypot,
+    eFunctionDegrees,
+    eFunctionRadians,
+    eFunctionAbs,
+    eFunctionMin,
+    eFunctionMax,
+    eFunctionInt,
+    eFunctionFloat,
+    eFunctionRound
+};
+
+struct FunctionDefinition
+{
+    const char* name;
+    FunctionEnum function;
+    int minArgs;
+    int maxArgs;
+};
+
+const FunctionDefinition functions[] = {
+    { "sin", eFunctionSin, 1, 1 },
+    { "cos", eFunctionCos, 1, 1 },
+    { "tan", eFunctionTan, 1, 1 },
+    { "asin", eFunctionAsin, 1, 1 },
+    { "acos", eFunctionAcos, 1, 1 },
+    { "atan", eFunctionAtan, 1, 1 },
+    { "atan2", eFunctionAtan2, 2, 2 },
+    { "sinh", eFunctionSinh, 1, 1 },
+    { "cosh", eFunctionCosh, 1, 1 },
+    { "tanh", eFunctionTanh, 1, 1 },
+    { "exp", eFunctionExp, 1, 1 },
+    { "log", eFunctionLog, 1, 2 },
+    { "log10", eFunctionLog10, 1, 1 },
+    { "sqrt", eFunctionSqrt, 1, 1 },
+    { "pow", eFunctionPow, 2, 2 },
+    { "fabs", eFunctionFabs, 1, 1 },
+    { "floor", eFunctionFloor, 1, 1 },
+    { "ceil", eFunctionCeil, 1, 1 },
+    { "fmod", eFunctionFmod, 2, 2 },
+    { "hypot", eFunctionHypot, 2, 2 },
+    { "degrees", eFunctionDegrees, 1, 1 },
+    { "radians", eFunctionRadians, 1, 1 },
+    { "abs", eFunctionAbs, 1, 1 },
+    { "min", eFunctionMin, 2, NATRON_NATIVE_EXPRESSION_MAX_STACK_DEPTH },
+    { "max", eFunctionMax, 2, NATRON_NATIVE_EXPRESSION_MAX_STACK_DEPTH },
+    { "int", eFunctionInt, 1, 1 },
+    { "float", eFunctionFloat, 1, 1 },
+    { "round", eFunctionRound, 1, 1 },
+    { 0, eFunctionSin, 0, 0 }
+};
+
+// A Python int or float
+struct Value
+{
+    double v;
+    bool isInt;
+};
+
+enum TokenTypeEnum
+{
+    eTokenTypeEnd = 0,
+    eTokenTypeNumber,
+    eTokenTypeName,
+    eTokenTypeOperator
+};
+
+struct Token
+{
+    TokenTypeEnum type;
+    std::string text;
+    double number;
+    bool isInt;
+};
+
+void
+tokenize(const std::string& expression,
+         std::vector<Token>* tokens)
+{
+    std::size_t i = 0;
+    const std::size_t n = expression.size();
+
+    while (i < n) {
+        char c = expression[i];
+        if ( (c == ' ') || (c == '\t') ) {
+            ++i;
+            continue;
+        }
+        Token token;
+        token.number = 0.;
+        token.isInt = false;
+        std::size_t start = i;
+        if ( std::isdigit( (unsigned char)c ) || ( ( c == '.') && ( i + 1 < n) && std::isdigit( (unsigned char)expression[i + 1] ) ) ) {
+            bool isInt = true;
+            while ( i < n && std::isdigit( (unsigned char)expression[i] ) ) {
+                ++i;
+            }
+            if ( (i < n) && (expression[i] == '.') ) {
+                isInt = false;
+                ++i;
+                while ( i < n && std::isdigit( (unsigned char)expression[i] ) ) {
+                    ++i;
+                }
+            }
+            if ( ( i < n) && ( (expression[i] == 'e') || (expression[i] == 'E') ) ) {
+                isInt = false;
+                ++i;
+                if ( ( i < n) && ( (expression[i] == '+') || (expression[i] == '-') ) ) {
+                    ++i;
+                }
+                if ( (i >= n) || !std::isdigit( (unsigned char)expression[i] ) ) {
+                    throw std::invalid_argument("invalid number");
+                }
+                while ( i < n && std::isdigit( (unsigned char)expression[i] ) ) {
+                    ++i;
+                }
+            }
+            // hexadecimal, long and complex literals
+            if ( ( i < n) && ( std::isalpha( (unsigned char)expression[i] ) || (expression[i] == '_') ) ) {
+                throw std::invalid_argument("unsupported number literal");
+            }
+            token.text = expression.substr(start, i - start);
+            // Python 2 reads integers starting with 0 as octal
+            if ( isInt && (token.text.size() > 1) && (token.text[0] == '0') ) {
+                throw std::invalid_argument("unsupported octal literal");
+            }
+            token.type = eTokenTypeNumber;
+            token.number = std::strtod(token.text.c_str(), 0);
+            token.isInt = isInt;
+        } else if ( std::isalpha( (unsigned char)c ) || (c == '_') ) {
+            while ( i < n && ( std::isalnum( (unsigned char)expression[i] ) || (expression[i] == '_') ) ) {
+                ++i;
+            }
+            token.type = eTokenTypeName;
+            token.text = expression.substr(start, i - start);
+        } else {
+            static const char* twoCharsOperators[] = { "**", "//", "<=", ">=", "==", "!=", 0 };
+            token.type = eTokenTypeOperator;
+            for (int j = 0; twoCharsOperators[j]; ++j) {
+                if ( expression.compare(i, 2, twoCharsOperators[j]) == 0 ) {
+                    token.text = twoCharsOperators[j];
+                    break;
+                }
+            }
+            if ( token.text.empty() ) {
+                if ( !std::strchr("+-*/%<>()[],.", c) ) {
+                    throw std::invalid_argument( std::string("unsupported character \'") + c + '\'' );
+                }
+                token.text = std::string(1, c);
+            }
+            i += token.text.size();
+        }
+        tokens->push_back(token);
+    }
+
+    Token end;
+    end.type = eTokenTypeEnd;
+    end.number = 0.;
+    end.isInt = false;
+    tokens->push_back(end);
+} // tokenize
+
+// Python 2 rounds halfway cases away from zero
+double
+roundHalfAwayFromZero(double x)
+{
+    if (x < 0) {
+        return -roundHalfAwayFromZero(-x);
+    }
+    double ret = std::floor(x);
+    if (x - ret >= 0.5) {
+        ret += 1.;
+    }
+
+    return ret;
+}
+
+// ret may point to the first argument
+bool
+callFunction(FunctionEnum function,
+             const Value* args,
+             int nArgs,
+             Value* ret)
+{
+    const Value arg = args[0];
+    const double x = arg.v;
+
+    ret->isInt = false;
+    switch (function) {
+    case eFunctionSin:
+        ret->v = std::sin(x);
+        break;
+    case eFunctionCos:
+        ret->v = std::cos(x);
+        break;
+    case eFunctionTan:
+        ret->v = std::tan(x);
+        break;
+    case eFunctionAsin:
+        ret->v = std::asin(x);
+        break;
+    case eFunctionAcos:
+        ret->v = std::acos(x);
+        break;
+    case eFunctionAtan:
+        ret->v = std::atan(x);
+        break;
+    case eFunctionAtan2:
+        ret->v = std::atan2(x, args[1].v);
+        break;
+    case eFunctionSinh:
+        ret->v = std::sinh(x);
+        break;
+    case eFunctionCosh:
+        ret->v = std::cosh(x);
+        break;
+    case eFunctionTanh:
+        ret->v = std::tanh(x);
+        break;
+    case eFunctionExp:
+        ret->v = std::exp(x);
+        break;
+    case eFunctionLog:
+        ret->v = nArgs == 2 ? std::log(x) / std::log(args[1].v) : std::log(x);
+        break;
+    case eFunctionLog10:
+        ret->v = std::log10(x);
+        break;
+    case eFunctionSqrt:
+        ret->v = std::sqrt(x);
+        break;
+    case eFunctionPow:
+        ret->v = std::pow(x, args[1].v);
+        break;
+    case eFunctionFabs:
+        ret->v = std::fabs(x);
+        break;
+    case eFunctionFloor:
+        ret->v = std::floor(x);
+        break;
+    case eFunctionCeil:
+        ret->v = std::ceil(x);
+        break;
+    case eFunctionFmod:
+        ret->v = std::fmod(x, args[1].v);
+        break;
+    case eFunctionHypot:
+        ret->v = std::sqrt(x * x + args[1].v * args[1].v);
+        break;
+    case eFunctionDegrees:
+        ret->v = x * 180. / M_PI;
+        break;
+    case eFunctionRadians:
+        ret->v = x * M_PI / 180.;
+        break;
+    case eFunctionAbs:
+        ret->v = std::fabs(x);
+        ret->isInt = arg.isInt;
+        break;
+    case eFunctionMin:
+    case eFunctionMax: {
+        // like Python, the first of the smallest (or largest) values is returned
+        Value best = arg;
+        for (int i = 1; i < nArgs; ++i) {
+            if ( (function == eFunctionMin) ? (args[i].v < best.v) : (args[i].v > best.v) ) {
+                best = args[i];
+            }
+        }
+        *ret = best;
+        break;
+    }
+    case eFunctionInt:
+        ret->v = x < 0 ? std::ceil(x) : std::floor(x);
+        ret->isInt = true;
+        break;
+    case eFunctionFloat:
+        ret->v = x;
+        break;
+    case eFunctionRound:
+        ret->v = roundHalfAwayFromZero(x);
+        break;
+    } // switch
+
+    return true;
+} // callFunction
+
+// The operands are copied, ret pointing to a
+bool
+applyBinaryOperator(OpcodeEnum op,
+                    const Value a,
+                    const Value b,
+                    Value* ret)
+{
+    ret->isInt = a.isInt && b.isInt;
+    switch (op) {
+    case eOpcodeAdd:
+        ret->v = a.v + b.v;
+        break;
+    case eOpcodeSubtract:
+        ret->v = a.v - b.v;
+        break;
+    case eOpcodeMultiply:
+        ret->v = a.v * b.v;
+        break;
+    case eOpcodeDivide:
+    case eOpcodeFloorDivide:
+        if (b.v == 0.) {
+            // ZeroDivisionError
+            return false;
+        }
+        // Python 2 divides ints with a floor division
+        ret->v = (ret->isInt || op == eOpcodeFloorDivide) ? std::floor(a.v / b.v) : a.v / b.v;
+        break;
+    case eOpcodeModulo:
+        if (b.v == 0.) {
+            return false;
+        }
+        // The result has the sign of the divisor
+        ret->v = std::fmod(a.v, b.v);
+        if ( (ret->v != 0.) && ( (ret->v < 0.) != (b.v < 0.) ) ) {
+            ret->v += b.v;
+        }
+        break;
+    case eOpcodePower:
+        if ( (a.v == 0.) && (b.v < 0.) ) {
+            return false;
+        }
+        if ( (a.v < 0.) && (b.v != std::floor(b.v)) ) {
+            // negative number cannot be raised to a fractional power
+            return false;
+        }
+        ret->v = std::pow(a.v, b.v);
+        ret->isInt = ret->isInt && b.v >= 0.;
+        break;
+    case eOpcodeLess:
+        ret->v = a.v < b.v;
+        ret->isInt = true;
+        break;
+    case eOpcodeLessEqual:
+        ret->v = a.v <= b.v;
+        ret->isInt = true;
+        break;
+    case eOpcodeGreater:
+        ret->v = a.v > b.v;
+        ret->isInt = true;
+        break;
+    case eOpcodeGreaterEqual:
+        ret->v = a.v >= b.v;
+        ret->isInt = true;
+        break;
+    case eOpcodeEqual:
+        ret->v = a.v == b.v;
+        ret->isInt = true;
+        break;
+    case eOpcodeNotEqual:
+        ret->v = a.v != b.v;
+        ret->isInt = true;
+        break;
+    default:
+        assert(false);
+
+        return false;
+    } // switch
+
+    return true;
+} // applyBinaryOperator
+
+bool
+isFinite(double v)
+{
+    return v - v == 0.;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+/**
+ * @brief A recursive descent parser following the grammar of Python expressions, emitting the code as it goes.
+ * Throws std::invalid_argument for anything not supported.
+ **/
+class NativeExpression::Parser
+{
+public:
+
+    Parser(const std::vector<Token>& tokens,
+           NativeExpression::Scope& scope,
+           std::vector<NativeExpression::Instruction>* code)
+        : _tokens(tokens)
+        , _pos(0)
+        , _scope(scope)
+        , _code(code)
+    {
+    }
+
+    void parse()
+    {
+        parseComparison();
+        if (peek().type != eTokenTypeEnd) {
+            throw std::invalid_argument("unsupported syntax near \"" + peek().text + "\"");
+        }
+    }
+
+private:
+
+    const Token& peek() const
+    {
+        return _tokens[_pos];
+    }
+
+    bool isOperator(const char* op) const
+    {
+        return peek().type == eTokenTypeOperator && peek().text == op;
+    }
+
+    bool acceptOperator(const char* op)
+    {
+        if ( isOperator(op) ) {
+            ++_pos;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void expectOperator(const char* op)
+    {
+        if ( !acceptOperator(op) ) {
+            throw std::invalid_argument(std::string("expected \"") + op + '"');
+        }
+    }
+
+    std::string expectName()
+    {
+        if (peek().type != eTokenTypeName) {
+            throw std::invalid_argument("expected a name");
+        }
+
+        return _tokens[_pos++].text;
+    }
+
+    int expectIntLiteral()
+    {
+        if ( (peek().type != eTokenTypeNumber) || !peek().isInt ) {
+            throw std::invalid_argument("expected an integer");
+        }
+
+        return (int)_tokens[_pos++].number;
+    }
+
+    void emit(OpcodeEnum opcode,
+              int arg = 0,
+              int arg2 = 0,
+              double constant = 0.,
+              bool isInt = false)
+    {
+        NativeExpression::Instruction instr;
+
+        instr.opcode = opcode;
+        instr.arg = arg;
+        instr.arg2 = arg2;
+        instr.constant = constant;
+        instr.isInt = isInt;
+        _code->push_back(instr);
+    }
+
+    void parseComparison()
+    {
+        static const char* operators[] = { "<", "<=", ">", ">=", "==", "!=", 0 };
+        static const OpcodeEnum opcodes[] = { eOpcodeLess, eOpcodeLessEqual, eOpcodeGreater, eOpcodeGreaterEqual, eOpcodeEqual, eOpcodeNotEqual };
+
+        parseArithmetic();
+        for (int i = 0; operators[i]; ++i) {
+            if ( acceptOperator(operators[i]) ) {
+                parseArithmetic();
+                emit(opcodes[i]);
+                for (int j = 0; operators[j]; ++j) {
+                    if ( isOperator(operators[j]) ) {
+                        throw std::invalid_argument("unsupported chained comparison");
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    void parseArithmetic()
+    {
+        parseTerm();
+        for (;;) {
+            if ( acceptOperator("+") ) {
+                parseTerm();
+                emit(eOpcodeAdd);
+            } else if ( acceptOperator("-") ) {
+                parseTerm();
+                emit(eOpcodeSubtract);
+            } else {
+                break;
+            }
+        }
+    }
+
+    void parseTerm()
+    {
+        parseUnary();
+        for (;;) {
+            if ( acceptOperator("*") ) {
+                parseUnary();
+                emit(eOpcodeMultiply);
+            } else if ( acceptOperator("/") ) {
+                parseUnary();
+                emit(eOpcodeDivide);
+            } else if ( acceptOperator("//") ) {
+                parseUnary();
+                emit(eOpcodeFloorDivide);
+            } else if ( acceptOperator("%") ) {
+                parseUnary();
+                emit(eOpcodeModulo);
+            } else {
+                break;
+            }
+        }
+    }
+
+    void parseUnary()
+    {
+        if ( acceptOperator("-") ) {
+            parseUnary();
+            emit(eOpcodeNegate);
+        } else if ( acceptOperator("+") ) {
+            parseUnary();
+        } else {
+            parsePower();
+        }
+    }
+
+    void parsePower()
+    {
+        parsePrimary();
+        if ( acceptOperator("**") ) {
+            // the exponent may be negated: 2**-1
+            parseUnary();
+            emit(eOpcodePower);
+        }
+    }
+
+    void parsePrimary()
+    {
+        const Token& token = peek();
+
+        if (token.type == eTokenTypeNumber) {
+            ++_pos;
+            emit(eOpcodeConstant, 0, 0, token.number, token.isInt);
+        } else if ( acceptOperator("(") ) {
+            parseComparison();
+            expectOperator(")");
+        } else if (token.type == eTokenTypeName) {
+            ++_pos;
+            parseName(token.text);
+        } else {
+            throw std::invalid_argument("unexpected \"" + token.text + "\"");
+        }
+
+        // attributes, subscripts or calls of a number
+        if ( isOperator(".") || isOperator("[") || isOperator("(") ) {
+            throw std::invalid_argument("unsupported syntax near \"" + peek().text + "\"");
+        }
+    }
+
+    void parseName(const std::string& name)
+    {
+        if ( isOperator(".") ) {
+            parseParamValue(name);
+
+            return;
+        }
+        if ( _scope.isNameDeclared(name) ) {
+            throw std::invalid_argument("unsupported use of \"" + name + "\"");
+        }
+        if ( acceptOperator("(") ) {
+            parseCall(name);
+        } else if (name == "frame") {
+            emit(eOpcodeFrame);
+        } else if (name == "view") {
+            emit(eOpcodeView);
+        } else if (name == "dimension") {
+            emit(eOpcodeDimension);
+        } else if (name == "pi") {
+            emit(eOpcodeConstant, 0, 0, M_PI, false);
+        } else if (name == "e") {
+            emit(eOpcodeConstant, 0, 0, M_E, false);
+        } else {
+            throw std::invalid_argument("unsupported name \"" + name + "\"");
+        }
+    }
+
+    void parseCall(const std::string& name)
+    {
+        const FunctionDefinition* function = 0;
+
+        for (int i = 0; functions[i].name; ++i) {
+            if (name == functions[i].name) {
+                function = &functions[i];
+                break;
+            }
+        }
+        if (!function) {
+            throw std::invalid_argument("unsupported function \"" + name + "\"");
+        }
+        int nArgs = 0;
+        if ( !acceptOperator(")") ) {
+            do {
+                parseComparison();
+                ++nArgs;
+            } while ( acceptOperator(",") );
+            expectOperator(")");
+        }
+        if ( (nArgs < function->minArgs) || (nArgs > function->maxArgs) ) {
+            throw std::invalid_argument("wrong number of arguments for \"" + name + "\"");
+        }
+        emit(eOpcodeCall, (int)function->function, nArgs);
+    }
+
+    // node.param.method(...) or thisParam.method(...), the current token being the first dot
+    void parseParamValue(const std::string& nodeName)
+    {
+        std::string paramName;
+
+        expectOperator(".");
+        if (nodeName != "thisParam") {
+            paramName = expectName();
+            expectOperator(".");
+        }
+        std::string method = expectName();
+        expectOperator("(");
+
+        NativeExpression::ParamTypeEnum type;
+        int nDims = 0;
+        int paramIndex = _scope.getParamIndex(nodeName, paramName, &type, &nDims);
+        if (paramIndex < 0) {
+            throw std::invalid_argument("unsupported parameter \"" + nodeName + "." + paramName + "\"");
+        }
+        bool isIntParam = (type == NativeExpression::eParamTypeInt || type == NativeExpression::eParamTypeBool || type == NativeExpression::eParamTypeChoice);
+        // Only these have a dimension argument
+        bool isMultiDimParam = (type == NativeExpression::eParamTypeInt || type == NativeExpression::eParamTypeDouble || type == NativeExpression::eParamTypeColor);
+        if ( isMultiDimParam && ( (nDims < 1) || (nDims > 4) || ( (nDims == 4) && (type != NativeExpression::eParamTypeColor) ) ) ) {
+            // such parameters have no Python counterpart
+            throw std::invalid_argument("unsupported parameter \"" + nodeName + "." + paramName + "\"");
+        }
+
+        std::size_t codeStart = _code->size();
+        bool atTime = false;
+        int dimension = 0;
+        if (method == "get") {
+            if ( !acceptOperator(")") ) {
+                parseComparison();
+                atTime = true;
+                expectOperator(")");
+            }
+            bool isTuple = (type == NativeExpression::eParamTypeColor) || ( isMultiDimParam && (nDims > 1) );
+            if (isTuple) {
+                if (type == NativeExpression::eParamTypeColor && nDims < 3) {
+                    throw std::invalid_argument("unsupported color parameter");
+                }
+                int tupleSize = type == NativeExpression::eParamTypeColor ? 4 : nDims;
+                if ( acceptOperator("[") ) {
+                    dimension = expectIntLiteral();
+                    expectOperator("]");
+                } else if ( acceptOperator(".") ) {
+                    std::string field = expectName();
+                    const char* fields = type == NativeExpression::eParamTypeColor ? "rgba" : "xyz";
+                    const char* found = field.size() == 1 ? std::strchr(fields, field[0]) : 0;
+                    if (!found) {
+                        throw std::invalid_argument("unsupported field \"" + field + "\"");
+                    }
+                    dimension = (int)(found - fields);
+                } else {
+                    throw std::invalid_argument("unsupported use of a tuple");
+                }
+                if ( (dimension < 0) || (dimension >= tupleSize) ) {
+                    throw std::invalid_argument("tuple index out of range");
+                }
+                if (dimension >= nDims) {
+                    // alpha of a RGB color
+                    _code->resize(codeStart);
+                    emit(eOpcodeConstant, 0, 0, 1., false);
+
+                    return;
+                }
+            }
+        } else if ( (method == "getValue") || (method == "getValueAtTime") ) {
+            atTime = method == "getValueAtTime";
+            if (atTime) {
+                parseComparison();
+            }
+            if ( isMultiDimParam && ( atTime ? acceptOperator(",") : !isOperator(")") ) ) {
+                dimension = expectIntLiteral();
+                if (dimension >= nDims) {
+                    throw std::invalid_argument("dimension out of range");
+                }
+            }
+            expectOperator(")");
+        } else {
+            throw std::invalid_argument("unsupported function \"" + method + "\"");
+        }
+        emit(atTime ? eOpcodeParamValueAtTime : eOpcodeParamValue, paramIndex, dimension, 0., isIntParam);
+    } // parseParamValue
+
+    const std::vector<Token>& _tokens;
+    std::size_t _pos;
+    NativeExpression::Scope& _scope;
+    std::vector<NativeExpression::Instruction>* _code;
+};
+
+NativeExpression::NativeExpression()
+    : _code()
+{
+}
+
+NativeExpression::~NativeExpression()
+{
+}
+
+bool
+NativeExpression::compile(const std::string& expression,
+                          Scope& scope,
+                          std::string* error)
+{
+    _code.clear();
+    try {
+        std::vector<Token> tokens;
+        tokenize(expression, &tokens);
+        if (tokens.size() == 1) {
+            throw std::invalid_argument("empty expression");
+        }
+        Parser parser(tokens, scope, &_code);
+        parser.parse();
+    } catch (const std::invalid_argument& e) {
+        _code.clear();
+        if (error) {
+            *error = e.what();
+        }
+
+        return false;
+    }
+
+    int depth = 0;
+    for (std::size_t i = 0; i < _code.size(); ++i) {
+        switch (_code[i].opcode) {
+        case eOpcodeConstant:
+        case eOpcodeFrame:
+        case eOpcodeView:
+        case eOpcodeDimension:
+        case eOpcodeParamValue:
+            ++depth;
+            break;
+        case eOpcodeParamValueAtTime:
+        case eOpcodeNegate:
+            break;
+        case eOpcodeCall:
+            depth -= _code[i].arg2 - 1;
+            break;
+        default:
+            --depth;
+            break;
+        }
+        if (depth > NATRON_NATIVE_EXPRESSION_MAX_STACK_DEPTH) {
+            _code.clear();
+            if (error) {
+                *error = "expression too complex";
+            }
+
+            return false;
+        }
+    }
+    assert(depth == 1);
+
+    return true;
+} // NativeExpression::compile
+
+bool
+NativeExpression::isCompiled() const
+{
+    return !_code.empty();
+}
+
+bool
+NativeExpression::evaluate(double frame,
+                           int view,
+                           int dimension,
+                           Context& context,
+                           double* value,
+                           bool* isInt) const
+{
+    if ( _code.empty() ) {
+        return false;
+    }
+
+    Value stack[NATRON_NATIVE_EXPRESSION_MAX_STACK_DEPTH];
+    int top = 0;
+    for (std::vector<Instruction>::const_iterator it = _code.begin(); it != _code.end(); ++it) {
+        switch (it->opcode) {
+        case eOpcodeConstant:
+            stack[top].v = it->constant;
+            stack[top].isInt = it->isInt;
+            ++top;
+            break;
+        case eOpcodeFrame:
+            // the frame is passed to Python as an int when it is one
+            stack[top].v = frame;
+            stack[top].isInt = frame == std::floor(frame);
+            ++top;
+            break;
+        case eOpcodeView:
+            stack[top].v = view;
+            stack[top].isInt = true;
+            ++top;
+            break;
+        case eOpcodeDimension:
+            stack[top].v = dimension;
+            stack[top].isInt = true;
+            ++top;
+            break;
+        case eOpcodeParamValue:
+            if ( !context.getParamValue(it->arg, it->arg2, false, 0., &stack[top].v) ) {
+                return false;
+            }
+            stack[top].isInt = it->isInt;
+            ++top;
+            break;
+        case eOpcodeParamValueAtTime:
+            if ( !context.getParamValue(it->arg, it->arg2, true, stack[top - 1].v, &stack[top - 1].v) ) {
+                return false;
+            }
+            stack[top - 1].isInt = it->isInt;
+            break;
+        case eOpcodeNegate:
+            stack[top - 1].v = -stack[top - 1].v;
+            break;
+        case eOpcodeCall:
+            top -= it->arg2;
+            if ( !callFunction( (FunctionEnum)it->arg, &stack[top], it->arg2, &stack[top] ) ) {
+                return false;
+            }
+            ++top;
+            break;
+        default:
+            if ( !applyBinaryOperator( (OpcodeEnum)it->opcode, stack[top - 2], stack[top - 1], &stack[top - 2] ) ) {
+                return false;
+            }
+            --top;
+            break;
+        } // switch
+        // Overflows and math domain errors raise exceptions in Python
+        if ( !isFinite(stack[top - 1].v) ) {
+            return false;
+        }
+    }
+    assert(top == 1);
+    *value = stack[0].v;
+    if (isInt) {
+        *isInt = stack[0].isInt;
+    }
+
+    return true;
+} // NativeExpression::evaluate
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,156 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_NativeExpression_h
+#define Natron_Engine_NativeExpression_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#include "Engine/EngineFwd.h"
+
+// Expressions needing a deeper evaluation stack are left to Python
+#define NATRON_NATIVE_EXPRESSION_MAX_STACK_DEPTH 32
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief A single-line parameter expression compiled to be evaluated without the Python interpreter, so that
+ * render threads evaluating expressions do not have to take the GIL in turn.
+ *
+ * Only the most common subset of Python is supported:
+ * - int and float literals, the frame, view and dimension variables, and the pi and e constants
+ * - the + - * / // % ** operators, unary + and -, and a single comparison (< <= > >= == !=)
+ * - the functions of the math module (without the "math." prefix, as in the expressions scope), and abs, min, max, int,
+ * float and round
+ * - the values of parameters: node.param.get(), get()[i], get().x, getValue(dimension),
+ * getValueAtTime(time, dimension)..., where node is thisNode, thisGroup or a node of the same group, and
+ * thisParam.getValue()...
+ *
+ * Values follow the Python 2 semantics of int and float (e.g. 7 / 2 is 3). compile() fails for anything else, and the
+ * expression must then be evaluated by Python. evaluate() fails where Python would raise an exception (division by
+ * zero, math domain errors...), so that Python evaluates the expression again and reports the error.
+ **/
+class NativeExpression
+{
+public:
+
+    enum ParamTypeEnum
+    {
+        eParamTypeInt = 0,
+        eParamTypeDouble,
+        eParamTypeBool,
+        eParamTypeChoice,
+        eParamTypeColor
+    };
+
+    /**
+     * @brief The names visible to an expression when it is compiled
+     **/
+    class Scope
+    {
+    public:
+        virtual ~Scope() {}
+
+        /**
+         * @brief Returns true if name is declared in the scope of the expression (e.g. the name of a node), in which
+         * case it hides the variables, constants and functions with the same name.
+         **/
+        virtual bool isNameDeclared(const std::string& name) const = 0;
+
+        /**
+         * @brief Returns an index identifying the parameter paramName of the node nodeName, or -1 if it does not exist
+         * or is not of a supported type. nodeName is "thisParam" and paramName empty for the parameter holding the
+         * expression.
+         **/
+        virtual int getParamIndex(const std::string& nodeName,
+                                  const std::string& paramName,
+                                  ParamTypeEnum* type,
+                                  int* nDims) = 0;
+    };
+
+    /**
+     * @brief Gives the values of the parameters to an expression when it is evaluated
+     **/
+    class Context
+    {
+    public:
+        virtual ~Context() {}
+
+        /**
+         * @brief Returns in value the value of the given dimension of a parameter returned by Scope::getParamIndex(),
+         * at the current time if atTime is false. Returns false if it could not be evaluated.
+         **/
+        virtual bool getParamValue(int paramIndex,
+                                   int dimension,
+                                   bool atTime,
+                                   double time,
+                                   double* value) = 0;
+    };
+
+    NativeExpression();
+
+    ~NativeExpression();
+
+    /**
+     * @brief Compiles the expression. Returns false if it is not supported, with the reason in error.
+     **/
+    bool compile(const std::string& expression,
+                 Scope& scope,
+                 std::string* error);
+
+    bool isCompiled() const;
+
+    /**
+     * @brief Evaluates the compiled expression. If isInt is not NULL, it is set to true if the result is a Python int.
+     * Returns false if the expression could not be evaluated.
+     **/
+    bool evaluate(double frame,
+                  int view,
+                  int dimension,
+                  Context& context,
+                  double* value,
+                  bool* isInt = 0) const;
+
+private:
+
+    struct Instruction
+    {
+        int opcode;
+        int arg;
+        int arg2;
+        double constant;
+        bool isInt;
+    };
+
+    class Parser;
+
+    std::vector<Instruction> _code;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_NativeExpression_h
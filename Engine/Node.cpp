@@ -84,6 +84,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/PrecompNode.h"
 #include "Engine/Project.h"
 #include "Engine/ReadNode.h"
+#include "Engine/RenderStats.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoStrokeItem.h"
@@ -264,6 +265,10 @@ public:
         , renderInstancesSharedMutex(QMutex::Recursive)
         , knobsAge(0)
         , knobsAgeMutex()
+        , hash()
+        , localHash(0)
+        , localHashValid(false)
+        , localHashCreationTime(0)
         , masterNodeMutex()
         , masterNode()
         , nodeLinks()
@@ -446,8 +451,11 @@ public:
     QMutex renderInstancesSharedMutex; //< see eRenderSafetyInstanceSafe in EffectInstance::renderRoI
     //only 1 clone can render at any time
     U64 knobsAge; //< the age of the knobs in this effect. It gets incremented every times the effect has its evaluate() function called.
-    mutable QReadWriteLock knobsAgeMutex; //< protects knobsAge and hash
-    Hash64 hash; //< recomputed everytime knobsAge is changed.
+    mutable QReadWriteLock knobsAgeMutex; //< protects knobsAge, hash and the local hash
+    Hash64 hash; //< recomputed everytime knobsAge is changed or an input hash changes.
+    U64 localHash; //< hash of what belongs to this node only (knobs age, name, project creation time), see computeHashInternal
+    bool localHashValid; //< false when the knobs age or the script name changed since localHash was computed
+    qint64 localHashCreationTime; //< the project creation time that was used to compute localHash
     mutable QMutex masterNodeMutex; //< protects masterNode and nodeLinks
     NodeWPtr masterNode; //< this points to the master when the node is a clone
     KnobLinkList nodeLinks; //< these point to the parents of the params links
@@ -1501,7 +1509,7 @@ Node::getCacheID() const
 }
 
 bool
-Node::computeHashInternal()
+Node::computeHashInternal(int* nLocalRehashed)
 {
     if (!_imp->effect) {
         return false;
@@ -1518,11 +1526,40 @@ Node::computeHashInternal()
 
         oldHash = _imp->hash.value();
 
+        ///Also append the project's creation time in the hash because 2 projects openend concurrently
+        ///could reproduce the same (especially simple graphs like Viewer-Reader)
+        qint64 creationTime =  getApp()->getProject()->getProjectCreationTime();
+
+        ///The local part of the hash only changes when this node is edited: when only an input changed
+        ///we just have to combine it again with the inputs hash.
+        if ( !_imp->localHashValid || (_imp->localHashCreationTime != creationTime) ) {
+            Hash64 local;
+
+            ///append the effect's own age
+            local.append(_imp->knobsAge);
+
+            // We do not append the roto age any longer since now every tool in the RotoContext is backed-up by nodes which
+            // have their own age. Instead each action in the Rotocontext is followed by a incrementNodesAge() call so that each
+            // node respecitively have their hash correctly set.
+
+            ///Also append the effect's label to distinguish 2 instances with the same parameters
+            Hash64_appendQString( &local, QString::fromUtf8( getScriptName().c_str() ) );
+
+            local.append(creationTime);
+            local.computeHash();
+
+            _imp->localHash = local.value();
+            _imp->localHashCreationTime = creationTime;
+            _imp->localHashValid = true;
+            if (nLocalRehashed) {
+                ++*nLocalRehashed;
+            }
+        }
+
         ///reset the hash value
         _imp->hash.reset();
 
-        ///append the effect's own age
-        _imp->hash.append(_imp->knobsAge);
+        _imp->hash.append(_imp->localHash);
 
         ///append all inputs hash
         {
@@ -1552,18 +1589,6 @@ Node::computeHashInternal()
             }
         }
 
-        // We do not append the roto age any longer since now every tool in the RotoContext is backed-up by nodes which
-        // have their own age. Instead each action in the Rotocontext is followed by a incrementNodesAge() call so that each
-        // node respecitively have their hash correctly set.
-
-        ///Also append the effect's label to distinguish 2 instances with the same parameters
-        Hash64_appendQString( &_imp->hash, QString::fromUtf8( getScriptName().c_str() ) );
-
-        ///Also append the project's creation time in the hash because 2 projects openend concurrently
-        ///could reproduce the same (especially simple graphs like Viewer-Reader)
-        qint64 creationTime =  getApp()->getProject()->getProjectCreationTime();
-        _imp->hash.append(creationTime);
-
         _imp->hash.computeHash();
 
         newHash = _imp->hash.value();
@@ -1585,14 +1610,14 @@ Node::computeHashInternal()
 } // Node::computeHashInternal
 
 void
-Node::computeHashRecursive(std::list<NodePtr>& marked)
+Node::computeHashRecursive(std::set<Node*>& marked,
+                           int* nLocalRehashed)
 {
-    if ( std::find(marked.begin(), marked.end(), shared_from_this()) != marked.end() ) {
+    if ( !marked.insert(this).second ) {
         return;
     }
 
-    bool hasChanged = computeHashInternal();
-    marked.push_back( shared_from_this() );
+    bool hasChanged = computeHashInternal(nLocalRehashed);
     if (!hasChanged) {
         //Nothing changed, no need to recurse on outputs
         return;
@@ -1612,7 +1637,7 @@ Node::computeHashRecursive(std::list<NodePtr>& marked)
         if ( isRotoPaint && attachedStroke && (attachedStroke->getContext()->getNode().get() == this) ) {
             continue;
         }
-        (*it)->computeHashRecursive(marked);
+        (*it)->computeHashRecursive(marked, nLocalRehashed);
     }
 
 
@@ -1621,7 +1646,7 @@ Node::computeHashRecursive(std::list<NodePtr>& marked)
         NodesList allItems;
         _imp->rotoContext->getRotoPaintTreeNodes(&allItems);
         for (NodesList::iterator it = allItems.begin(); it != allItems.end(); ++it) {
-            (*it)->computeHashRecursive(marked);
+            (*it)->computeHashRecursive(marked, nLocalRehashed);
         }
     }
 }
@@ -1679,8 +1704,10 @@ Node::computeHash()
 
         return;
     }
-    std::list<NodePtr> marked;
-    computeHashRecursive(marked);
+    std::set<Node*> marked;
+    int nLocalRehashed = 0;
+    computeHashRecursive(marked, &nLocalRehashed);
+    RenderStats::setNodesRehashedByLastEdit(nLocalRehashed);
 } // computeHash
 
 void
@@ -2365,6 +2392,7 @@ Node::setKnobsAge(U64 newAge)
         changed = _imp->knobsAge != newAge || !_imp->hash.value();
         if (changed) {
             _imp->knobsAge = newAge;
+            _imp->localHashValid = false;
         }
     }
     if (changed) {
@@ -2386,6 +2414,7 @@ Node::incrementKnobsAge_internal()
             appPTR->clearAllCaches();
             _imp->knobsAge = 0;
         }
+        _imp->localHashValid = false;
     }
 }
 
@@ -2403,6 +2432,7 @@ Node::incrementKnobsAge()
             appPTR->clearAllCaches();
             _imp->knobsAge = 0;
         }
+        _imp->localHashValid = false;
         newAge = _imp->knobsAge;
     }
     Q_EMIT knobsAgeChanged(newAge);
@@ -3089,6 +3119,12 @@ Node::setNameInternal(const std::string& name,
         }
     }
 
+    {
+        // The name is part of the local hash
+        QWriteLocker l(&_imp->knobsAgeMutex);
+        _imp->localHashValid = false;
+    }
+
     bool mustSetCacheID;
     {
         QMutexLocker l(&_imp->nameMutex);
@@ -8702,12 +8738,14 @@ Node::onEffectKnobValueChanged(const KnobIPtr& what,
             ///When a group is disabled we have to force a hash change of all nodes inside otherwise the image will stay cached
 
             NodesList nodes = isGroup->getNodes();
-            std::list<NodePtr> markedNodes;
+            std::set<Node*> markedNodes;
+            int nLocalRehashed = 0;
             for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
                 //This will not trigger a hash recomputation
                 (*it)->incrementKnobsAge_internal();
-                (*it)->computeHashRecursive(markedNodes);
+                (*it)->computeHashRecursive(markedNodes, &nLocalRehashed);
             }
+            RenderStats::setNodesRehashedByLastEdit(nLocalRehashed);
         }
     } else if ( what == _imp->nodeLabelKnob.lock() ) {
         Q_EMIT nodeExtraLabelChanged( QString::fromUtf8( _imp->nodeLabelKnob.lock()->getValue().c_str() ) );
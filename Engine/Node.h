@@ -31,6 +31,7 @@
 #include <string>
 #include <map>
 #include <list>
+#include <set>
 #include <bitset>
 
 CLANG_DIAG_OFF(deprecated)
@@ -1325,13 +1326,18 @@ private:
 
     bool setStreamWarningInternal(StreamWarningEnum warning, const QString& message);
 
-    void computeHashRecursive(std::list<NodePtr>& marked);
+    /**
+     * @brief Refreshes the hash of this node and of all its outputs whose hash changed.
+     * nLocalRehashed is incremented for each node whose local part of the hash had to be recomputed.
+     **/
+    void computeHashRecursive(std::set<Node*>& marked, int* nLocalRehashed);
 
     /**
      * @brief Refreshes the node hash depending on its context (knobs age, inputs etc...)
+     * If nLocalRehashed is not NULL, it is incremented if the local part of the hash had to be recomputed.
      * @return True if the hash has changed, false otherwise
      **/
-    bool computeHashInternal() WARN_UNUSED_RETURN;
+    bool computeHashInternal(int* nLocalRehashed = 0) WARN_UNUSED_RETURN;
 
     void refreshEnabledKnobsLabel(const ImageComponents& layer);
 
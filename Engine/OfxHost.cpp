@@ -109,6 +109,7 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/Settings.h"
 #include "Engine/StandardPaths.h"
 #include "Engine/TLSHolder.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/ThreadPool.h"
 
 //An effect may not use more than this amount of threads
@@ -1162,12 +1163,13 @@ NATRON_NAMESPACE_ANONYMOUS_ENTER
 ///We think this is because Furnace must keep an internal thread-local state that becomes then dirty
 ///if we re-use the same thread.
 
-static OfxStatus
+static void
 threadFunctionWrapper(OfxThreadFunctionV1 func,
                       unsigned int threadIndex,
                       unsigned int threadMax,
                       QThread* spawnerThread,
-                      void *customArg)
+                      void *customArg,
+                      OfxStatus* stat)
 {
     assert(threadIndex < threadMax);
     OfxHost::OfxHostDataTLSPtr tls = appPTR->getOFXHost()->getTLSData();
@@ -1178,13 +1180,13 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
         appPTR->getAppTLS()->softCopy(spawnerThread, spawnedThread);
     }
 
-    OfxStatus ret = kOfxStatOK;
+    *stat = kOfxStatOK;
     try {
         func(threadIndex, threadMax, customArg);
     } catch (const std::bad_alloc & ba) {
-        ret =  kOfxStatErrMemory;
+        *stat =  kOfxStatErrMemory;
     } catch (...) {
-        ret =  kOfxStatFailed;
+        *stat =  kOfxStatFailed;
     }
 
     ///reset back the index otherwise it could mess up the indexes if the same thread is re-used
@@ -1193,8 +1195,6 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
     if (spawnedThread != spawnerThread) {
         appPTR->getAppTLS()->cleanupTLSForThread();
     }
-
-    return ret;
 }
 
 class OfxThread
@@ -1298,22 +1298,18 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
     bool useThreadPool = appPTR->getUseThreadPool();
 
     if (useThreadPool) {
-        std::vector<unsigned int> threadIndexes(nThreads);
+        /// The calls are run by the work-stealing scheduler: the spawner thread runs the calls that were not
+        /// taken by idle workers instead of waiting for them
+        std::vector<OfxStatus> status(nThreads, kOfxStatFailed);
+        std::vector<TaskScheduler::Task> tasks(nThreads);
         for (unsigned int i = 0; i < nThreads; ++i) {
-            threadIndexes[i] = i;
+            tasks[i] = boost::bind(threadFunctionWrapper, func, i, nThreads, spawnerThread, customArg, &status[i]);
         }
+        appPTR->getTaskScheduler()->runAndWait(tasks);
 
-        /// DON'T set the maximum thread count, this is a global application setting, and see the documentation excerpt above
-        //QThreadPool::globalInstance()->setMaxThreadCount(nThreads);
-        QFuture<OfxStatus> future = QtConcurrent::mapped( threadIndexes, boost::bind(threadFunctionWrapper, func, _1, nThreads, spawnerThread, customArg) );
-        future.waitForFinished();
-        ///DON'T reset back to the original value the maximum thread count
-        //QThreadPool::globalInstance()->setMaxThreadCount(QThread::idealThreadCount());
-
-        for (QFuture<OfxStatus>::const_iterator it = future.begin(); it != future.end(); ++it) {
-            OfxStatus stat = *it;
-            if (stat != kOfxStatOK) {
-                return stat;
+        for (std::vector<OfxStatus>::const_iterator it = status.begin(); it != status.end(); ++it) {
+            if (*it != kOfxStatOK) {
+                return *it;
             }
         }
     } else {
@@ -410,6 +410,7 @@ void
 OutputEffectInstance::reportStats(int time,
                                   ViewIdx view,
                                   double wallTime,
+                                  int nodesRehashedByLastEdit,
                                   const std::map<NodePtr, NodeRenderStats > & stats)
 {
     std::string filename;
@@ -445,6 +446,7 @@ OutputEffectInstance::reportStats(int time,
     }
 
     ofile << "Time spent to render frame (wall clock time): " << Timer::printAsTime(wallTime, false).toStdString() << std::endl;
+    ofile << "Nodes rehashed by the last edit: " << nodesRehashedByLastEdit << std::endl;
     for (std::map<NodePtr, NodeRenderStats >::const_iterator it = stats.begin(); it != stats.end(); ++it) {
         ofile << "------------------------------- " << it->first->getScriptName_mt_safe() << "------------------------------- " << std::endl;
         ofile << "Time spent rendering: " << Timer::printAsTime(it->second.getTotalTimeSpentRendering(), false).toStdString() << std::endl;
@@ -120,7 +120,7 @@ public:
 
 
     virtual void initializeData() OVERRIDE FINAL;
-    virtual void reportStats(int time, ViewIdx view, double wallTime, const std::map<NodePtr, NodeRenderStats > & stats);
+    virtual void reportStats(int time, ViewIdx view, double wallTime, int nodesRehashedByLastEdit, const std::map<NodePtr, NodeRenderStats > & stats);
 
 protected:
 
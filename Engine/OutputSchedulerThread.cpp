@@ -56,6 +56,7 @@
 #include "Engine/OpenGLViewerI.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
 #include "Engine/Project.h"
+#include "Engine/RenderBenchmark.h"
 #include "Engine/RenderStats.h"
 #include "Engine/RotoContext.h"
 #include "Engine/Settings.h"
@@ -168,15 +169,19 @@ public:
     virtual ~OutputSchedulerThreadExecMTArgs() {}
 };
 
-#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
-static bool
-isBufferFull(int nbBufferedElement,
-             int hardwardIdealThreadCount)
+static int
+getPlaybackReadAheadFrames()
 {
-    return nbBufferedElement >= hardwardIdealThreadCount * 3;
-}
+    int nFrames = appPTR->getCurrentSettings()->getPlaybackReadAheadFrames();
 
-#endif
+    if (nFrames <= 0) {
+        ///Limit the size of the internal buffer: if the rendering of the output node (the writer or viewer)
+        ///is much slower than things upstream we would keep too many images in RAM
+        nFrames = appPTR->getHardwareIdealThreadCount() * 3;
+    }
+
+    return std::max(1, nFrames);
+}
 
 struct OutputSchedulerThreadPrivate
 {
@@ -226,6 +231,12 @@ struct OutputSchedulerThreadPrivate
     ///Protected by framesToRenderMutex
     int lastFramePushedIndex;
     int expectFrameToRender;
+
+    ///Maximum number of frames rendered ahead of expectFrameToRender and the number of frames currently pushed
+    ///(queued, being rendered or buffered) that were not processed yet.
+    ///Protected by framesToRenderMutex
+    int readAheadFrames;
+    int nFramesAhead;
     boost::weak_ptr<OutputEffectInstance> outputEffect; //< The effect used as output device
     RenderEngine* engine;
 
@@ -239,6 +250,9 @@ struct OutputSchedulerThreadPrivate
     QMutex bufferedOutputMutex;
     int lastBufferedOutputSize;
 
+    // Protected by bufMutex
+    PlaybackBufferStats playbackStats;
+
 
     OutputSchedulerThreadPrivate(RenderEngine* engine,
                                  const OutputEffectInstancePtr& effect,
@@ -269,6 +283,8 @@ struct OutputSchedulerThreadPrivate
         , framesToRenderMutex()
         , lastFramePushedIndex(0)
         , expectFrameToRender(0)
+        , readAheadFrames(1)
+        , nFramesAhead(0)
         , outputEffect(effect)
         , engine(engine)
 #ifdef NATRON_SCHEDULER_SPAWN_THREADS_WITH_TIMER
@@ -278,6 +294,7 @@ struct OutputSchedulerThreadPrivate
 #endif
         , bufferedOutputMutex()
         , lastBufferedOutputSize(0)
+        , playbackStats()
     {
     }
 
@@ -302,6 +319,33 @@ struct OutputSchedulerThreadPrivate
         value.frame = image;
         value.stats = stats;
         buf.insert( std::make_pair(key, value) );
+
+        playbackStats.bufferedFrames = (int)buf.size();
+        playbackStats.maxBufferedFrames = std::max(playbackStats.maxBufferedFrames, playbackStats.bufferedFrames);
+    }
+
+    /**
+     * @brief Removes from the buffer the frames whose time is not in the given window, e.g: frames that were being rendered
+     * when the playhead jumped elsewhere. Returns the number of frames removed.
+     **/
+    int discardBufferedFramesOutsideWindow(const std::set<int>& window)
+    {
+        ///Private, shouldn't lock
+        assert( !bufMutex.tryLock() );
+
+        int nDiscarded = 0;
+        for (FrameBuffer::iterator it = buf.begin(); it != buf.end(); ) {
+            if ( window.find( (int)it->first.time ) == window.end() ) {
+                buf.erase(it++);
+                ++nDiscarded;
+            } else {
+                ++it;
+            }
+        }
+        playbackStats.bufferedFrames = (int)buf.size();
+        playbackStats.cancelledFrames += nDiscarded;
+
+        return nDiscarded;
     }
 
     struct ViewUniqueIDPair
@@ -429,6 +473,18 @@ struct OutputSchedulerThreadPrivate
                                      int lastFrame,
                                      int* nextFrame);
 
+    /**
+     * @brief Returns the frames that will be displayed in the next nFrames steps of the playback, starting at frame (included).
+     **/
+    static void getFramesInWindow(PlaybackModeEnum pMode,
+                                  RenderDirectionEnum direction,
+                                  int frame,
+                                  int firstFrame,
+                                  int lastFrame,
+                                  unsigned int frameStep,
+                                  int nFrames,
+                                  std::set<int>* frames);
+
 
     void waitForRenderThreadsToBeDone()
     {
@@ -541,6 +597,7 @@ OutputSchedulerThread::OutputSchedulerThread(RenderEngine* engine,
     , _imp( new OutputSchedulerThreadPrivate(engine, effect, mode) )
 {
     QObject::connect( _imp->timer.get(), SIGNAL(fpsChanged(double,double)), _imp->engine, SIGNAL(fpsChanged(double,double)) );
+    QObject::connect( _imp->timer.get(), SIGNAL(fpsChanged(double,double)), this, SLOT(onFpsChanged()) );
 
 
 #ifdef NATRON_SCHEDULER_SPAWN_THREADS_WITH_TIMER
@@ -666,6 +723,24 @@ OutputSchedulerThreadPrivate::getNearestInSequence(RenderDirectionEnum direction
     }
 }
 
+void
+OutputSchedulerThreadPrivate::getFramesInWindow(PlaybackModeEnum pMode,
+                                                RenderDirectionEnum direction,
+                                                int frame,
+                                                int firstFrame,
+                                                int lastFrame,
+                                                unsigned int frameStep,
+                                                int nFrames,
+                                                std::set<int>* frames)
+{
+    for (int i = 0; i < nFrames; ++i) {
+        frames->insert(frame);
+        if ( !getNextFrameInSequence(pMode, direction, frame, firstFrame, lastFrame, frameStep, &frame, &direction) ) {
+            break;
+        }
+    }
+}
+
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
 void
 OutputSchedulerThread::pushFramesToRender(int startingFrame,
@@ -674,10 +749,46 @@ OutputSchedulerThread::pushFramesToRender(int startingFrame,
     QMutexLocker l(&_imp->framesToRenderMutex);
 
     _imp->lastFramePushedIndex = startingFrame;
+    _imp->nFramesAhead = 0;
 
     pushFramesToRenderInternal(startingFrame, nThreads);
 }
 
+void
+OutputSchedulerThread::seekReadAheadWindow(int startingFrame,
+                                           int nThreads)
+{
+    boost::shared_ptr<OutputSchedulerThreadStartArgs> runArgs = _imp->runArgs.lock();
+
+    assert(runArgs);
+    PlaybackModeEnum pMode = _imp->engine->getPlaybackMode();
+    std::set<int> window;
+    int nCancelled;
+    {
+        QMutexLocker l(&_imp->framesToRenderMutex);
+        OutputSchedulerThreadPrivate::getFramesInWindow(pMode, runArgs->processTimelineDirection, startingFrame,
+                                                        runArgs->firstFrame, runArgs->lastFrame, runArgs->frameStep,
+                                                        _imp->readAheadFrames, &window);
+
+        ///Frames already picked by render threads cannot be cancelled: they will be discarded when they reach the buffer
+        ///if they are not in the window
+        nCancelled = (int)_imp->framesToRender.size();
+        _imp->framesToRender.clear();
+        _imp->expectFrameToRender = startingFrame;
+        _imp->lastFramePushedIndex = startingFrame;
+        _imp->nFramesAhead = 0;
+        runArgs->pushTimelineDirection = runArgs->processTimelineDirection;
+#ifdef TRACE_SCHEDULER
+        qDebug() << "Scheduler Thread: Playhead moved to" << startingFrame << ", cancelling" << nCancelled << "queued frames";
+#endif
+        pushFramesToRenderInternal(startingFrame, nThreads);
+    }
+
+    QMutexLocker l(&_imp->bufMutex);
+    _imp->discardBufferedFramesOutsideWindow(window);
+    _imp->playbackStats.cancelledFrames += nCancelled;
+}
+
 void
 OutputSchedulerThread::pushFramesToRenderInternal(int startingFrame,
                                                   int nThreads)
@@ -701,15 +812,20 @@ OutputSchedulerThread::pushFramesToRenderInternal(int startingFrame,
     PlaybackModeEnum pMode = _imp->engine->getPlaybackMode();
     RenderDirectionEnum newDirection = direction;
     if (firstFrame == lastFrame) {
-        _imp->framesToRender.push_back(startingFrame);
+        if (_imp->nFramesAhead < _imp->readAheadFrames) {
+            _imp->framesToRender.push_back(startingFrame);
 #ifdef TRACE_SCHEDULER
-        qDebug() << "Scheduler Thread: Pushing frame to render: " << startingFrame;
+            qDebug() << "Scheduler Thread: Pushing frame to render: " << startingFrame;
 #endif
-        _imp->lastFramePushedIndex = startingFrame;
+            _imp->lastFramePushedIndex = startingFrame;
+            ++_imp->nFramesAhead;
+        }
     } else {
-        ///Push 2x the count of threads to be sure no one will be waiting
-        while ( (int)_imp->framesToRender.size() < nThreads * 2 ) {
+        ///Push 2x the count of threads to be sure no one will be waiting, but never more than the read-ahead window.
+        ///Frames are queued in playback order so that render threads always pick the frame closest to the playhead first.
+        while ( (int)_imp->framesToRender.size() < nThreads * 2 && _imp->nFramesAhead < _imp->readAheadFrames ) {
             _imp->framesToRender.push_back(startingFrame);
+            ++_imp->nFramesAhead;
 #ifdef TRACE_SCHEDULER
             QString pushDirectionStr = newDirection == eRenderDirectionForward ? QLatin1String("Forward") : QLatin1String("Backward");
             qDebug() << "Scheduler Thread:  Pushing frame to render: " << startingFrame << ", new push direction is " << pushDirectionStr;
@@ -1100,9 +1216,16 @@ OutputSchedulerThread::startRender()
         }
     }
 
+    int readAheadFrames = getPlaybackReadAheadFrames();
     {
         QMutexLocker k(&_imp->framesToRenderMutex);
         _imp->expectFrameToRender = startingFrame;
+        _imp->readAheadFrames = readAheadFrames;
+    }
+    {
+        QMutexLocker k(&_imp->bufMutex);
+        _imp->playbackStats = PlaybackBufferStats();
+        _imp->playbackStats.readAheadFrames = readAheadFrames;
     }
     SchedulingPolicyEnum policy = getSchedulingPolicy();
     if (policy == eSchedulingPolicyFFA) {
@@ -1197,6 +1320,12 @@ OutputSchedulerThread::stopRender()
     {
         QMutexLocker k(&_imp->bufMutex);
         _imp->buf.clear();
+#ifdef TRACE_SCHEDULER
+        qDebug() << "Scheduler Thread: read-ahead" << _imp->playbackStats.readAheadFrames << "frames, processed" << _imp->playbackStats.framesProcessed
+                 << ", underruns" << _imp->playbackStats.underruns << ", cancelled" << _imp->playbackStats.cancelledFrames
+                 << ", max buffered" << _imp->playbackStats.maxBufferedFrames;
+#endif
+        _imp->playbackStats.bufferedFrames = 0;
     }
 
     _imp->renderTimer.reset();
@@ -1217,6 +1346,9 @@ OutputSchedulerThread::threadLoopOnce(const ThreadStartArgsPtr &inArgs)
     // but this is not the frame this thread expects to render. If it reaches a certain amount, we detected a stall and abort.
     int nbIterationsWithoutProcessing = 0;
 
+    // The last frame for which an underrun of the read-ahead buffer was counted
+    int underrunTime = INT_MIN;
+
     startRender();
 
     for (;; ) {
@@ -1271,10 +1403,29 @@ OutputSchedulerThread::threadLoopOnce(const ThreadStartArgsPtr &inArgs)
             } else {
                 nbIterationsWithoutProcessing = 0;
             }
+            ///Frames that are not going to be displayed in the read-ahead window were rendered before the playhead
+            ///jumped: drop them so they do not hold RAM
+            std::set<int> readAheadWindow;
+            {
+                int readAheadFrames;
+                {
+                    QMutexLocker k(&_imp->framesToRenderMutex);
+                    readAheadFrames = _imp->readAheadFrames;
+                }
+                OutputSchedulerThreadPrivate::getFramesInWindow(_imp->engine->getPlaybackMode(), args->processTimelineDirection,
+                                                                expectedTimeToRender, args->firstFrame, args->lastFrame, args->frameStep,
+                                                                readAheadFrames, &readAheadWindow);
+            }
+
             boost::shared_ptr<OutputSchedulerThreadExecMTArgs> framesToRender( new OutputSchedulerThreadExecMTArgs() );
             {
                 QMutexLocker l(&_imp->bufMutex);
+                _imp->discardBufferedFramesOutsideWindow(readAheadWindow);
                 _imp->getFromBufferAndErase(expectedTimeToRender, framesToRender->frames);
+                if ( !framesToRender->frames.empty() ) {
+                    ++_imp->playbackStats.framesProcessed;
+                    _imp->playbackStats.bufferedFrames = (int)_imp->buf.size();
+                }
             }
 
             ///The expected frame is not yet ready, go to sleep again
@@ -1332,6 +1483,8 @@ OutputSchedulerThread::threadLoopOnce(const ThreadStartArgsPtr &inArgs)
                     {
                         QMutexLocker k(&_imp->framesToRenderMutex);
                         _imp->expectFrameToRender = nextFrameToRender;
+                        ///The frame left the read-ahead window, leave room for one more
+                        _imp->nFramesAhead = std::max(0, _imp->nFramesAhead - 1);
                     }
 
 #ifndef NATRON_SCHEDULER_SPAWN_THREADS_WITH_TIMER
@@ -1343,22 +1496,8 @@ OutputSchedulerThread::threadLoopOnce(const ThreadStartArgsPtr &inArgs)
                     adjustNumberOfThreads(&newNThreads, &lastNThreads);
 
                     ///////////
-                    /////Append render requests for the render threads
-
-                    ///Simple heuristic to limit the size of the internal buffer.
-                    ///If the buffer grows too much, we will keep shared ptr to images, hence keep them in RAM which
-                    ///can lead to RAM issue for the end user.
-                    ///We can end up in this situation for very simple graphs where the rendering of the output node (the writer or viewer)
-                    ///is much slower than things upstream, hence the buffer grows quickly, and fills up the RAM.
-                    bool bufferFull;
-                    {
-                        QMutexLocker k(&_imp->bufMutex);
-                        int nbThreadsHardware = appPTR->getHardwareIdealThreadCount();
-                        bufferFull = isBufferFull(_imp->buf.size(), nbThreadsHardware);
-                    }
-                    if (!bufferFull) {
-                        pushFramesToRender(newNThreads);
-                    }
+                    /////Append render requests for the render threads, this does nothing if the read-ahead window is full
+                    pushFramesToRender(newNThreads);
 #else
                     startTasksFromLastStartedFrame();
 #endif
@@ -1396,6 +1535,12 @@ OutputSchedulerThread::threadLoopOnce(const ThreadStartArgsPtr &inArgs)
                 ///Timeline might have changed if another thread moved the playhead
                 int timelineCurrentTime = timelineGetTime();
                 if (timelineCurrentTime != expectedTimeToRender) {
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+                    ///The user jumped: restart the read-ahead window from the new playhead position
+                    OutputSchedulerThreadPrivate::getNearestInSequence(args->processTimelineDirection, timelineCurrentTime,
+                                                                       args->firstFrame, args->lastFrame, &timelineCurrentTime);
+                    seekReadAheadWindow( timelineCurrentTime, std::max( 1, getNRenderThreads() ) );
+#endif
                     timelineGoTo(timelineCurrentTime);
                 } else {
                     timelineGoTo(nextFrameToRender);
@@ -1431,7 +1576,16 @@ OutputSchedulerThread::threadLoopOnce(const ThreadStartArgsPtr &inArgs)
 
         if (!renderFinished) {
             assert(state == eThreadStateActive);
+            {
+                QMutexLocker k(&_imp->framesToRenderMutex);
+                expectedTimeToRender = _imp->expectFrameToRender;
+            }
             QMutexLocker bufLocker (&_imp->bufMutex);
+            ///The output device is ready but the frame it expects is not rendered yet
+            if ( (_imp->playbackStats.framesProcessed > 0) && (expectedTimeToRender != underrunTime) ) {
+                ++_imp->playbackStats.underruns;
+                underrunTime = expectedTimeToRender;
+            }
             // Wait here for more frames to be rendered, we will be woken up once appendToBuffer(...) is called
             _imp->bufEmptyCondition.wait(&_imp->bufMutex);
         } else {
@@ -1557,8 +1711,11 @@ OutputSchedulerThread::notifyFrameRendered(int frame,
     if (stats) {
         double timeSpentForFrame;
         std::map<NodePtr, NodeRenderStats > statResults = stats->getStats(&timeSpentForFrame);
-        if ( !statResults.empty() ) {
-            effect->reportStats(frame, viewIndex, timeSpentForFrame, statResults);
+        RenderBenchmark* benchmark = effect->getApp()->getRenderBenchmark();
+        if (benchmark) {
+            benchmark->addFrame(effect->getNode()->getFullyQualifiedName(), frame, viewIndex, timeSpentForFrame, statResults);
+        } else if ( !statResults.empty() ) {
+            effect->reportStats(frame, viewIndex, timeSpentForFrame, stats->getNodesRehashedByLastEdit(), statResults);
         }
     }
 
@@ -1794,6 +1951,22 @@ OutputSchedulerThread::getDesiredFPS() const
     return _imp->timer->getDesiredFrameRate();
 }
 
+PlaybackBufferStats
+OutputSchedulerThread::getPlaybackBufferStats() const
+{
+    QMutexLocker k(&_imp->bufMutex);
+
+    return _imp->playbackStats;
+}
+
+void
+OutputSchedulerThread::onFpsChanged()
+{
+    PlaybackBufferStats stats = getPlaybackBufferStats();
+
+    _imp->engine->s_playbackBufferStatsChanged( stats.bufferedFrames, stats.readAheadFrames, (int)stats.underruns, (int)stats.cancelledFrames );
+}
+
 void
 OutputSchedulerThread::getLastRunArgs(RenderDirectionEnum* direction,
                                       std::vector<ViewIdx>* viewsToRender) const
@@ -2315,7 +2488,8 @@ private:
                 tlsArgs->isDoingRotoNeatRender = false;
                 tlsArgs->isAnalysis = false;
                 tlsArgs->draftMode = false;
-                tlsArgs->stats = RenderStatsPtr();
+                // The nodes only fill the stats if in-depth profiling is enabled
+                tlsArgs->stats = stats;
 
                 ParallelRenderArgsSetter frameRenderArgs(tlsArgs);
 
@@ -3362,6 +3536,12 @@ RenderEngine::getDesiredFPS() const
     return _imp->scheduler ? _imp->scheduler->getDesiredFPS() : 24;
 }
 
+PlaybackBufferStats
+RenderEngine::getPlaybackBufferStats() const
+{
+    return _imp->scheduler ? _imp->scheduler->getPlaybackBufferStats() : PlaybackBufferStats();
+}
+
 void
 RenderEngine::notifyFrameProduced(const BufferableObjectList& frames,
                                   const RenderStatsPtr& stats,
@@ -3787,7 +3967,7 @@ ViewerCurrentFrameRequestSchedulerPrivate::processProducedFrame(const RenderStat
             if (stats) {
                 double timeSpent;
                 std::map<NodePtr, NodeRenderStats > ret = stats->getStats(&timeSpent);
-                viewer->reportStats(0, ViewIdx(0), timeSpent, ret);
+                viewer->reportStats(0, ViewIdx(0), timeSpent, stats->getNodesRehashedByLastEdit(), ret);
             }
 
             viewer->updateViewer(params);
@@ -3943,7 +4123,7 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
                 if ( stats && (i == 0) ) {
                     double timeSpent;
                     std::map<NodePtr, NodeRenderStats > statResults = stats->getStats(&timeSpent);
-                    _imp->viewer->reportStats(frame, view, timeSpent, statResults);
+                    _imp->viewer->reportStats(frame, view, timeSpent, stats->getNodesRehashedByLastEdit(), statResults);
                 }
                 _imp->viewer->updateViewer(args[i]->params);
                 args[i].reset();
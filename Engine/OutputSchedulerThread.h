@@ -69,6 +69,40 @@ struct BufferedFrame
 };
 
 typedef std::list<BufferedFrame> BufferedFrames;
+
+/**
+ * @brief Counters of the playback read-ahead buffer, they are reset each time a playback starts.
+ **/
+struct PlaybackBufferStats
+{
+    // Maximum number of frames rendered ahead of the playhead
+    int readAheadFrames;
+
+    // Number of frames rendered and waiting to be displayed
+    int bufferedFrames;
+
+    // Highest value reached by bufferedFrames
+    int maxBufferedFrames;
+
+    // Number of frames processed by the output device
+    U64 framesProcessed;
+
+    // Number of times the output device was ready for a frame that was not rendered yet
+    U64 underruns;
+
+    // Number of frames queued or rendered that were discarded because the playhead jumped away from them
+    U64 cancelledFrames;
+
+    PlaybackBufferStats()
+        : readAheadFrames(0)
+        , bufferedFrames(0)
+        , maxBufferedFrames(0)
+        , framesProcessed(0)
+        , underruns(0)
+        , cancelledFrames(0)
+    {
+    }
+};
 class CurrentFrameFunctorArgs;
 class ViewerCurrentFrameRequestSchedulerStartArgs
     : public GenericThreadStartArgs
@@ -320,12 +354,20 @@ public:
      **/
     double getDesiredFPS() const;
 
+    /**
+     * @brief Returns the counters of the read-ahead buffer of the current (or last) playback
+     **/
+    PlaybackBufferStats getPlaybackBufferStats() const;
+
     void runCallbackWithVariables(const QString& callback);
 
 private Q_SLOTS:
 
     void onThreadSpawnsTimerTriggered();
 
+    // Forwards the read-ahead buffer counters to the RenderEngine each time the fps is refreshed
+    void onFpsChanged();
+
 
 Q_SIGNALS:
 
@@ -450,6 +492,12 @@ private:
 
     void pushAllFrameRange();
 
+    /**
+     * @brief Called by the scheduler thread when the playhead was moved during playback: the frames queued or buffered
+     * that are not in the read-ahead window starting at startingFrame are discarded and the window is filled from there.
+     **/
+    void seekReadAheadWindow(int startingFrame, int nThreads);
+
     /**
      * @brief Starts/stops more threads according to CPU activity and user preferences
      * @param optimalNThreads[out] Will be set to the new number of threads
@@ -693,6 +741,11 @@ public:
      **/
     double getDesiredFPS() const;
 
+    /**
+     * @brief Returns the counters of the read-ahead buffer of the current (or last) playback
+     **/
+    PlaybackBufferStats getPlaybackBufferStats() const;
+
     /**
      * @brief Quit all processing, making sure all threads are finished, this is not blocking
      **/
@@ -798,6 +851,11 @@ Q_SIGNALS:
      **/
     void fpsChanged(double actualFps, double desiredFps);
 
+    /**
+     * @brief Emitted along with fpsChanged with the counters of the read-ahead buffer, see PlaybackBufferStats
+     **/
+    void playbackBufferStatsChanged(int bufferedFrames, int readAheadFrames, int underruns, int cancelledFrames);
+
     /**
      * @brief Emitted after a frame is rendered.
      * This will not be emitted after calling renderCurrentFrame
@@ -846,6 +904,11 @@ private:
     void s_fpsChanged(double actual,
                       double desired) { Q_EMIT fpsChanged(actual, desired); }
 
+    void s_playbackBufferStatsChanged(int bufferedFrames,
+                                      int readAheadFrames,
+                                      int underruns,
+                                      int cancelledFrames) { Q_EMIT playbackBufferStatsChanged(bufferedFrames, readAheadFrames, underruns, cancelledFrames); }
+
     void s_frameRendered(int time,
                          double progress) { Q_EMIT frameRendered(time, progress); }
 
@@ -24,7 +24,9 @@
 
 #include "ProcessHandler.h"
 
+#include <algorithm>
 #include <cassert>
+#include <iostream>
 #include <stdexcept>
 
 #include <QtCore/QProcess>
@@ -35,17 +37,26 @@
 #include <QtCore/QWaitCondition>
 #include <QtCore/QMutex>
 #include <QtCore/QDir>
+#include <QtCore/QFileInfo>
 #include <QtCore/QDebug>
+#include <QtCore/QEventLoop>
 
 #include "Engine/AppInstance.h"
 #include "Engine/AppManager.h"
+#include "Engine/CLArgs.h"
 #include "Engine/Node.h"
 #include "Engine/OutputEffectInstance.h"
+#include "Engine/Timer.h"
 
 NATRON_NAMESPACE_ENTER;
 
 ProcessHandler::ProcessHandler(const QString & projectPath,
-                               const OutputEffectInstancePtr& writer)
+                               const OutputEffectInstancePtr& writer,
+                               int firstFrame,
+                               int lastFrame,
+                               int frameStep,
+                               bool enableRenderStats,
+                               const QStringList& extraArgs)
     : _process(new QProcess)
     , _writer(writer)
     , _ipcServer(0)
@@ -91,6 +102,18 @@ ProcessHandler::ProcessHandler(const QString & projectPath,
 
 
     _processArgs << QString::fromUtf8("-b") << QString::fromUtf8("-w") << QString::fromUtf8( writer->getScriptName_mt_safe().c_str() );
+    if (firstFrame != INT_MIN) {
+        // In the format parsed by CLArgs: <firstFrame>-<lastFrame>:<frameStep>
+        QString range = QString::number(firstFrame) + QLatin1Char('-') + QString::number(lastFrame);
+        if (frameStep != INT_MIN) {
+            range += QLatin1Char(':') + QString::number(frameStep);
+        }
+        _processArgs << range;
+    }
+    if (enableRenderStats) {
+        _processArgs << QString::fromUtf8("-s");
+    }
+    _processArgs << extraArgs;
     _processArgs << QString::fromUtf8("--IPCpipe") <<  tmpFileName;
     _processArgs << projectPath;
 
@@ -156,47 +179,50 @@ ProcessHandler::onDataWrittenToSocket()
     ///always running in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    QString str = QString::fromUtf8( _bgProcessOutputSocket->readLine() );
-    while ( str.endsWith( QLatin1Char('\n') ) ) {
-        str.chop(1);
-    }
-    _processLog.append( QString::fromUtf8("Message received: ") + str + QLatin1Char('\n') );
-    if ( str.startsWith( QString::fromUtf8(kFrameRenderedStringShort) ) ) {
-        str = str.remove( QString::fromUtf8(kFrameRenderedStringShort) );
-
-        double progressPercent = 0.;
-        int foundProgress = str.lastIndexOf( QString::fromUtf8(kProgressChangedStringShort) );
-        if (foundProgress != -1) {
-            QString progressStr = str.mid(foundProgress);
-            progressStr.remove( QString::fromUtf8(kProgressChangedStringShort) );
-            progressPercent = progressStr.toDouble();
-            str = str.mid(0, foundProgress);
+    // Several messages may be received at once when frames are rendered quickly
+    while ( _bgProcessOutputSocket->canReadLine() ) {
+        QString str = QString::fromUtf8( _bgProcessOutputSocket->readLine() );
+        while ( str.endsWith( QLatin1Char('\n') ) ) {
+            str.chop(1);
         }
-        if ( !str.isEmpty() ) {
-            //The report does not have extended timer infos
-            Q_EMIT frameRendered(str.toInt(), progressPercent);
-        }
-    } else if ( str.startsWith( QString::fromUtf8(kRenderingFinishedStringShort) ) ) {
-        ///don't do anything
-    } else if ( str.startsWith( QString::fromUtf8(kBgProcessServerCreatedShort) ) ) {
-        str = str.remove( QString::fromUtf8(kBgProcessServerCreatedShort) );
-        ///the bg process wants us to create the pipe for its input
-        if (!_bgProcessInputSocket) {
-            _bgProcessInputSocket = new QLocalSocket();
-            QObject::connect( _bgProcessInputSocket, SIGNAL(connected()), this, SLOT(onInputPipeConnectionMade()) );
-            _bgProcessInputSocket->connectToServer(str, QLocalSocket::ReadWrite);
-        }
-    } else if ( str.startsWith( QString::fromUtf8(kRenderingStartedShort) ) ) {
-        ///if the user pressed cancel prior to the pipe being created, wait for it to be created and send the abort
-        ///message right away
-        if (_earlyCancel) {
-            _bgProcessInputSocket->waitForConnected(5000);
-            _earlyCancel = false;
-            onProcessCanceled();
+        _processLog.append( QString::fromUtf8("Message received: ") + str + QLatin1Char('\n') );
+        if ( str.startsWith( QString::fromUtf8(kFrameRenderedStringShort) ) ) {
+            str = str.remove( QString::fromUtf8(kFrameRenderedStringShort) );
+
+            double progressPercent = 0.;
+            int foundProgress = str.lastIndexOf( QString::fromUtf8(kProgressChangedStringShort) );
+            if (foundProgress != -1) {
+                QString progressStr = str.mid(foundProgress);
+                progressStr.remove( QString::fromUtf8(kProgressChangedStringShort) );
+                progressPercent = progressStr.toDouble();
+                str = str.mid(0, foundProgress);
+            }
+            if ( !str.isEmpty() ) {
+                //The report does not have extended timer infos
+                Q_EMIT frameRendered(str.toInt(), progressPercent);
+            }
+        } else if ( str.startsWith( QString::fromUtf8(kRenderingFinishedStringShort) ) ) {
+            ///don't do anything
+        } else if ( str.startsWith( QString::fromUtf8(kBgProcessServerCreatedShort) ) ) {
+            str = str.remove( QString::fromUtf8(kBgProcessServerCreatedShort) );
+            ///the bg process wants us to create the pipe for its input
+            if (!_bgProcessInputSocket) {
+                _bgProcessInputSocket = new QLocalSocket();
+                QObject::connect( _bgProcessInputSocket, SIGNAL(connected()), this, SLOT(onInputPipeConnectionMade()) );
+                _bgProcessInputSocket->connectToServer(str, QLocalSocket::ReadWrite);
+            }
+        } else if ( str.startsWith( QString::fromUtf8(kRenderingStartedShort) ) ) {
+            ///if the user pressed cancel prior to the pipe being created, wait for it to be created and send the abort
+            ///message right away
+            if (_earlyCancel) {
+                _bgProcessInputSocket->waitForConnected(5000);
+                _earlyCancel = false;
+                onProcessCanceled();
+            }
+        } else {
+            _processLog.append( QString::fromUtf8("Error: Unable to interpret message.\n") );
+            throw std::runtime_error("ProcessHandler::onDataWrittenToSocket() received erroneous message");
         }
-    } else {
-        _processLog.append( QString::fromUtf8("Error: Unable to interpret message.\n") );
-        throw std::runtime_error("ProcessHandler::onDataWrittenToSocket() received erroneous message");
     }
 }
 
@@ -249,6 +275,8 @@ ProcessHandler::onProcessError(QProcess::ProcessError err)
 {
     if (err == QProcess::FailedToStart) {
         Dialogs::errorDialog( _writer->getScriptName(), tr("The render process failed to start.").toStdString() );
+        // finished() is not emitted by QProcess in this case
+        Q_EMIT processFinished(1);
     } else if (err == QProcess::Crashed) {
         //@TODO: find out a way to get the backtrace
     }
@@ -262,12 +290,188 @@ ProcessHandler::onProcessEnd(int exitCode,
 
     if (stat == QProcess::CrashExit) {
         returnCode = 2;
-    } else if (exitCode == 1) {
+    } else if (exitCode != 0) {
         returnCode = 1;
     }
     Q_EMIT processFinished(returnCode);
 }
 
+RenderProcessGroup::RenderProcessGroup(const QString & projectPath,
+                                       const OutputEffectInstancePtr& writer,
+                                       int firstFrame,
+                                       int lastFrame,
+                                       int frameStep,
+                                       int nProcesses,
+                                       bool enableRenderStats,
+                                       const CLArgs& parentArgs)
+    : QObject()
+    , _processes()
+    , _writer(writer)
+    , _nFrames(0)
+    , _nFramesRendered(0)
+    , _nProcessesRunning(0)
+    , _returnCode(0)
+    , _timer()
+{
+    // Negative frames cannot be given on the command-line: a single process renders the frame range of the writer
+    bool canSplit = !writer->isVideoWriter() && (firstFrame >= 0);
+    std::vector<std::pair<int, int> > ranges;
+    splitFrameRange(firstFrame, lastFrame, frameStep, canSplit ? nProcesses : 1, &ranges);
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+        _nFrames += (ranges[i].second - ranges[i].first) / std::max(1, frameStep) + 1;
+
+        QStringList extraArgs = getProcessArgs(parentArgs, (int)i);
+        ProcessHandler* process;
+        if (firstFrame < 0) {
+            process = new ProcessHandler(projectPath, writer, INT_MIN, INT_MAX, INT_MIN, enableRenderStats, extraArgs);
+        } else {
+            process = new ProcessHandler(projectPath, writer, ranges[i].first, ranges[i].second, frameStep, enableRenderStats, extraArgs);
+        }
+        QObject::connect( process, SIGNAL(frameRendered(int,double)), this, SLOT(onFrameRendered(int,double)) );
+        QObject::connect( process, SIGNAL(processFinished(int)), this, SLOT(onProcessFinished(int)) );
+        _processes.push_back(process);
+    }
+}
+
+RenderProcessGroup::~RenderProcessGroup()
+{
+    for (std::size_t i = 0; i < _processes.size(); ++i) {
+        delete _processes[i];
+    }
+}
+
+int
+RenderProcessGroup::getProcessesCount() const
+{
+    return (int)_processes.size();
+}
+
+void
+RenderProcessGroup::splitFrameRange(int firstFrame,
+                                    int lastFrame,
+                                    int frameStep,
+                                    int nParts,
+                                    std::vector<std::pair<int, int> >* ranges)
+{
+    ranges->clear();
+    frameStep = std::max(1, frameStep);
+    if (lastFrame < firstFrame) {
+        return;
+    }
+    int nFrames = (lastFrame - firstFrame) / frameStep + 1;
+    nParts = std::max( 1, std::min(nParts, nFrames) );
+
+    // The first parts hold one more frame when the frames cannot be evenly split
+    int nFramesPerPart = nFrames / nParts;
+    int nPartsWithOneMoreFrame = nFrames % nParts;
+    int firstIndex = 0;
+    for (int i = 0; i < nParts; ++i) {
+        int nPartFrames = nFramesPerPart + (i < nPartsWithOneMoreFrame ? 1 : 0);
+        ranges->push_back( std::make_pair( firstFrame + firstIndex * frameStep, firstFrame + (firstIndex + nPartFrames - 1) * frameStep ) );
+        firstIndex += nPartFrames;
+    }
+}
+
+QStringList
+RenderProcessGroup::getProcessArgs(const CLArgs& parentArgs,
+                                   int processIndex)
+{
+    QStringList args;
+
+    const std::list<std::string>& commands = parentArgs.getPythonCommands();
+    for (std::list<std::string>::const_iterator it = commands.begin(); it != commands.end(); ++it) {
+        args << QString::fromUtf8("-c") << QString::fromUtf8( it->c_str() );
+    }
+    const QString& onLoadScript = parentArgs.getDefaultOnProjectLoadedScript();
+    if ( !onLoadScript.isEmpty() ) {
+        args << QString::fromUtf8("-l") << onLoadScript;
+    }
+    if ( parentArgs.isDiskCacheReuseEnabled() ) {
+        args << QString::fromUtf8("--reuse-disk-cache");
+    }
+    const QString& traceFilePath = parentArgs.getTraceFilePath();
+    if ( !traceFilePath.isEmpty() ) {
+        // trace.json is written as trace_1.json, trace_2.json...
+        QFileInfo info(traceFilePath);
+        QString fileName = info.completeBaseName() + QLatin1Char('_') + QString::number(processIndex + 1);
+        if ( !info.suffix().isEmpty() ) {
+            fileName += QLatin1Char('.') + info.suffix();
+        }
+        args << QString::fromUtf8("--trace") << info.dir().filePath(fileName);
+    }
+
+    return args;
+}
+
+int
+RenderProcessGroup::exec()
+{
+    ///always running in the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+
+    if ( _processes.empty() ) {
+        return 0;
+    }
+
+    QEventLoop loop;
+    QObject::connect( this, SIGNAL(allProcessesFinished()), &loop, SLOT(quit()) );
+
+    _nFramesRendered = 0;
+    _returnCode = 0;
+    _nProcessesRunning = (int)_processes.size();
+    _timer.reset( new TimeLapse() );
+    for (std::size_t i = 0; i < _processes.size(); ++i) {
+        _processes[i]->startProcess();
+    }
+
+    // A process failing to start is finished right away
+    if (_nProcessesRunning > 0) {
+        loop.exec();
+    }
+
+    return _returnCode;
+}
+
+void
+RenderProcessGroup::onFrameRendered(int frame,
+                                    double /*progress*/)
+{
+    ++_nFramesRendered;
+
+    double timeElapsed = _timer->getTimeSinceCreation();
+    double fps = timeElapsed > 0 ? _nFramesRendered / timeElapsed : 0.;
+    double timeRemaining = fps > 0 ? std::max(0, _nFrames - _nFramesRendered) / fps : 0.;
+    std::cout << _writer->getScriptName_mt_safe() << tr(" ==> Frame: ").toStdString() << frame
+              << tr(", Progress: ").toStdString() << QString::number(100. * _nFramesRendered / std::max(1, _nFrames), 'f', 1).toStdString()
+              << "%, " << QString::number(fps, 'f', 1).toStdString() << tr(" Fps, Time Remaining: ").toStdString()
+              << Timer::printAsTime(timeRemaining, true).toStdString() << std::endl;
+}
+
+void
+RenderProcessGroup::onProcessFinished(int returnCode)
+{
+    ProcessHandler* process = qobject_cast<ProcessHandler*>( sender() );
+
+    if (returnCode != 0) {
+        if (process) {
+            std::cerr << process->getProcessLog().toStdString() << std::endl;
+        }
+        // The render failed anyway, do not wait for the other processes
+        if (_returnCode == 0) {
+            for (std::size_t i = 0; i < _processes.size(); ++i) {
+                if (_processes[i] != process) {
+                    _processes[i]->onProcessCanceled();
+                }
+            }
+        }
+    }
+    _returnCode = std::max(_returnCode, returnCode);
+    --_nProcessesRunning;
+    if (_nProcessesRunning == 0) {
+        Q_EMIT allProcessesFinished();
+    }
+}
+
 ProcessInputChannel::ProcessInputChannel(const QString & mainProcessServerName)
     : QThread()
     , _mainProcessServerName(mainProcessServerName)
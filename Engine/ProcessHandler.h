@@ -27,6 +27,10 @@
 
 #include "Global/Macros.h"
 
+#include <climits>
+#include <vector>
+#include <utility>
+
 CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QProcess>
 #include <QtCore/QThread>
@@ -102,9 +106,17 @@ public:
     /**
      * @brief Starts a new process which will load the project specified by "projectPath".
      * The process will render using the effect specified by writer.
+     * If firstFrame is not INT_MIN, only the frames from firstFrame to lastFrame, every frameStep frames, are rendered,
+     * otherwise the process renders the frame range of the writer.
+     * extraArgs are passed to the process before the project path, @see RenderProcessGroup::getProcessArgs().
      **/
     ProcessHandler(const QString & projectPath,
-                   const OutputEffectInstancePtr& writer);
+                   const OutputEffectInstancePtr& writer,
+                   int firstFrame = INT_MIN,
+                   int lastFrame = INT_MAX,
+                   int frameStep = INT_MIN,
+                   bool enableRenderStats = false,
+                   const QStringList& extraArgs = QStringList());
 
     virtual ~ProcessHandler();
 
@@ -183,6 +195,86 @@ Q_SIGNALS:
     void processFinished(int);
 };
 
+/**
+ * @brief Renders the frame range of a writer in several background processes on this computer, each one loading the
+ * project and rendering a contiguous part of the range. Processes do not share their plug-in instances and their
+ * Python interpreter, so this scales with the number of cores even when the plug-ins cannot render several frames
+ * concurrently.
+ * The processes are started with a ProcessHandler and the frames they render are reported as the progress of a
+ * single render.
+ **/
+class RenderProcessGroup
+    : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @brief The frames from firstFrame to lastFrame, every frameStep frames, are split into at most nProcesses
+     * parts. Video files cannot be written by several processes, so they are always rendered by a single process.
+     * The processes are given the options of the command-line of this process that they need, see getProcessArgs().
+     **/
+    RenderProcessGroup(const QString & projectPath,
+                       const OutputEffectInstancePtr& writer,
+                       int firstFrame,
+                       int lastFrame,
+                       int frameStep,
+                       int nProcesses,
+                       bool enableRenderStats,
+                       const CLArgs& parentArgs);
+
+    virtual ~RenderProcessGroup();
+
+    int getProcessesCount() const;
+
+    /**
+     * @brief Starts the processes and returns once they are all finished. Must be called on the main thread.
+     * As soon as a process fails, the others are aborted.
+     * Returns the highest return code of the processes, as in ProcessHandler::processFinished.
+     **/
+    int exec();
+
+    /**
+     * @brief Splits the frames from firstFrame to lastFrame, every frameStep frames, into at most nParts contiguous
+     * ranges holding the same number of frames give or take one.
+     **/
+    static void splitFrameRange(int firstFrame,
+                                int lastFrame,
+                                int frameStep,
+                                int nParts,
+                                std::vector<std::pair<int, int> >* ranges);
+
+    /**
+     * @brief Returns the options of the command-line of this process that must be passed to the render process
+     * of the given index: the Python commands (-c) and the script run once the project is loaded (-l), which may
+     * define functions the project calls, --reuse-disk-cache, and --trace with a file name of its own for each
+     * process so that they do not overwrite each other's trace.
+     **/
+    static QStringList getProcessArgs(const CLArgs& parentArgs,
+                                      int processIndex);
+
+public Q_SLOTS:
+
+    void onFrameRendered(int frame, double progress);
+
+    void onProcessFinished(int returnCode);
+
+Q_SIGNALS:
+
+    void allProcessesFinished();
+
+private:
+
+    std::vector<ProcessHandler*> _processes;
+    OutputEffectInstancePtr _writer;
+    int _nFrames;
+    int _nFramesRendered;
+    int _nProcessesRunning;
+    int _returnCode;
+    TimeLapsePtr _timer;
+};
+
 /**
  * @brief This class represents the "input" pipe of the background process, this is where the background
  * app expect messages from the "main" process to come. It listen to messages from the main app to take decisions.
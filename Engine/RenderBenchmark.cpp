@@ -0,0 +1,349 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderBenchmark.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+
+#include "Global/MemoryInfo.h" // getPeakRSS, also includes the headers of getrusage() and GetProcessTimes()
+
+#include "Engine/Cache.h"
+#include "Engine/FStreamsSupport.h"
+#include "Engine/Node.h"
+#include "Engine/RenderStats.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct BenchmarkRun
+{
+    bool isCacheCold;
+    double wallTime;
+    double cpuTime;
+    std::size_t peakRSS;
+
+    // Lookups of the node cache during the run
+    CacheAccessStats cacheStats;
+    std::vector<RenderBenchmark::Frame> frames;
+
+    BenchmarkRun()
+        : isCacheCold(false)
+        , wallTime(0.)
+        , cpuTime(0.)
+        , peakRSS(0)
+        , cacheStats()
+        , frames()
+    {
+    }
+};
+
+// Returns the user and system time spent by all the threads of the process so far, in seconds
+double
+getProcessCPUTime()
+{
+#if defined(__NATRON_WIN32__)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if ( !GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime) ) {
+        return 0.;
+    }
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+
+    // in units of 100 nanoseconds
+    return (kernel.QuadPart + user.QuadPart) * 1e-7;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.;
+    }
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+bool
+frameLess(const RenderBenchmark::Frame& lhs,
+          const RenderBenchmark::Frame& rhs)
+{
+    if (lhs.writerName != rhs.writerName) {
+        return lhs.writerName < rhs.writerName;
+    }
+    if (lhs.time != rhs.time) {
+        return lhs.time < rhs.time;
+    }
+
+    return lhs.view < rhs.view;
+}
+
+void
+writeJSONString(FStreamsSupport::ofstream& ofile,
+                const std::string& str)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    ofile << '"';
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        unsigned char c = (unsigned char)str[i];
+        if ( (c == '"') || (c == '\\') ) {
+            ofile << '\\' << str[i];
+        } else if (c < 0x20) {
+            ofile << "\\u00" << hexDigits[c >> 4] << hexDigits[c & 0xf];
+        } else {
+            ofile << str[i];
+        }
+    }
+    ofile << '"';
+}
+
+void
+writeCacheStats(FStreamsSupport::ofstream& ofile,
+                const CacheAccessStats& stats)
+{
+    ofile << "{\"memoryHits\": " << stats.memoryHits
+          << ", \"compressedHits\": " << stats.compressedHits
+          << ", \"diskHits\": " << stats.diskHits
+          << ", \"misses\": " << stats.misses
+          << ", \"hitRate\": " << stats.getHitRate() << "}";
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+struct RenderBenchmarkPrivate
+{
+    mutable QMutex lock;
+    std::vector<BenchmarkRun> runs;
+    bool isRunning;
+
+    // Measures of the current run when it started
+    TimeLapse runTimer;
+    double runStartCPUTime;
+    CacheAccessStats runStartCacheStats;
+
+    RenderBenchmarkPrivate()
+        : lock()
+        , runs()
+        , isRunning(false)
+        , runTimer()
+        , runStartCPUTime(0.)
+        , runStartCacheStats()
+    {
+    }
+};
+
+RenderBenchmark::RenderBenchmark()
+    : _imp( new RenderBenchmarkPrivate() )
+{
+}
+
+RenderBenchmark::~RenderBenchmark()
+{
+}
+
+void
+RenderBenchmark::startRun(bool isCacheCold,
+                          const CacheAccessStats& cacheStats)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(!_imp->isRunning);
+    _imp->runs.push_back( BenchmarkRun() );
+    _imp->runs.back().isCacheCold = isCacheCold;
+    _imp->runStartCacheStats = cacheStats;
+    _imp->runStartCPUTime = getProcessCPUTime();
+    _imp->isRunning = true;
+    _imp->runTimer.getTimeElapsedReset();
+}
+
+void
+RenderBenchmark::endRun(const CacheAccessStats& cacheStats)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->isRunning);
+    if (!_imp->isRunning) {
+        return;
+    }
+    BenchmarkRun& run = _imp->runs.back();
+    run.wallTime = _imp->runTimer.getTimeElapsedReset();
+    run.cpuTime = std::max(0., getProcessCPUTime() - _imp->runStartCPUTime);
+    run.peakRSS = getPeakRSS();
+    run.cacheStats.memoryHits = cacheStats.memoryHits - _imp->runStartCacheStats.memoryHits;
+    run.cacheStats.compressedHits = cacheStats.compressedHits - _imp->runStartCacheStats.compressedHits;
+    run.cacheStats.diskHits = cacheStats.diskHits - _imp->runStartCacheStats.diskHits;
+    run.cacheStats.misses = cacheStats.misses - _imp->runStartCacheStats.misses;
+    std::sort(run.frames.begin(), run.frames.end(), frameLess);
+    _imp->isRunning = false;
+}
+
+int
+RenderBenchmark::getRunsCount() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return (int)_imp->runs.size();
+}
+
+double
+RenderBenchmark::getRunWallTime(int runIndex) const
+{
+    QMutexLocker k(&_imp->lock);
+
+    if ( (runIndex < 0) || ( runIndex >= (int)_imp->runs.size() ) ) {
+        return 0.;
+    }
+
+    return _imp->runs[runIndex].wallTime;
+}
+
+std::vector<RenderBenchmark::Frame>
+RenderBenchmark::getRunFrames(int runIndex) const
+{
+    QMutexLocker k(&_imp->lock);
+
+    if ( (runIndex < 0) || ( runIndex >= (int)_imp->runs.size() ) ) {
+        return std::vector<Frame>();
+    }
+
+    return _imp->runs[runIndex].frames;
+}
+
+void
+RenderBenchmark::addFrame(const Frame& frame)
+{
+    QMutexLocker k(&_imp->lock);
+
+    if (!_imp->isRunning) {
+        return;
+    }
+    _imp->runs.back().frames.push_back(frame);
+}
+
+void
+RenderBenchmark::addFrame(const std::string& writerName,
+                          int time,
+                          ViewIdx view,
+                          double wallTime,
+                          const std::map<NodePtr, NodeRenderStats>& stats)
+{
+    Frame frame;
+
+    frame.writerName = writerName;
+    frame.time = time;
+    frame.view = view;
+    frame.wallTime = wallTime;
+    for (std::map<NodePtr, NodeRenderStats>::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+        NodeTime nodeTime;
+        nodeTime.nodeName = it->first->getFullyQualifiedName();
+        nodeTime.timeSpent = it->second.getTotalTimeSpentRendering();
+        it->second.getCacheAccessInfos(&nodeTime.cacheMisses, &nodeTime.cacheHits, &nodeTime.cacheHitsDownscaled);
+        frame.nodes.push_back(nodeTime);
+    }
+    addFrame(frame);
+}
+
+bool
+RenderBenchmark::writeReport(const std::string& filePath,
+                             const std::string& projectName) const
+{
+    FStreamsSupport::ofstream ofile;
+
+    FStreamsSupport::open(&ofile, filePath, std::ios_base::out | std::ios_base::trunc);
+    if (!ofile) {
+        return false;
+    }
+
+    const int nThreads = QThread::idealThreadCount();
+    QMutexLocker k(&_imp->lock);
+
+    ofile << "{\n";
+    ofile << "\"version\": 1,\n";
+    ofile << "\"application\": ";
+    writeJSONString(ofile, NATRON_APPLICATION_NAME " " NATRON_VERSION_STRING);
+    ofile << ",\n\"project\": ";
+    writeJSONString(ofile, projectName);
+    ofile << ",\n\"hardwareThreads\": " << nThreads << ",\n";
+    ofile << "\"runs\": [";
+    for (std::size_t i = 0; i < _imp->runs.size(); ++i) {
+        const BenchmarkRun& run = _imp->runs[i];
+
+        // Time spent by each node over the whole run
+        std::map<std::string, double> nodesTime;
+        for (std::vector<Frame>::const_iterator it = run.frames.begin(); it != run.frames.end(); ++it) {
+            for (std::vector<NodeTime>::const_iterator it2 = it->nodes.begin(); it2 != it->nodes.end(); ++it2) {
+                nodesTime[it2->nodeName] += it2->timeSpent;
+            }
+        }
+
+        ofile << (i == 0 ? "\n" : ",\n");
+        ofile << "{\"run\": " << i
+              << ", \"cacheCold\": " << (run.isCacheCold ? "true" : "false")
+              << ", \"wallTime\": " << run.wallTime
+              << ", \"cpuTime\": " << run.cpuTime
+              << ", \"threadUtilization\": " << ( (run.wallTime > 0.) && (nThreads > 0) ? run.cpuTime / (run.wallTime * nThreads) : 0. )
+              << ", \"framesPerSecond\": " << (run.wallTime > 0. ? run.frames.size() / run.wallTime : 0.)
+              << ", \"peakRSS\": " << (U64)run.peakRSS
+              << ",\n \"nodeCache\": ";
+        writeCacheStats(ofile, run.cacheStats);
+        ofile << ",\n \"nodes\": {";
+        for (std::map<std::string, double>::const_iterator it = nodesTime.begin(); it != nodesTime.end(); ++it) {
+            ofile << (it == nodesTime.begin() ? "" : ", ");
+            writeJSONString(ofile, it->first);
+            ofile << ": " << it->second;
+        }
+        ofile << "},\n \"frames\": [";
+        for (std::vector<Frame>::const_iterator it = run.frames.begin(); it != run.frames.end(); ++it) {
+            ofile << (it == run.frames.begin() ? "\n  " : ",\n  ");
+            ofile << "{\"writer\": ";
+            writeJSONString(ofile, it->writerName);
+            ofile << ", \"frame\": " << it->time << ", \"view\": " << it->view << ", \"wallTime\": " << it->wallTime << ", \"nodes\": [";
+            for (std::vector<NodeTime>::const_iterator it2 = it->nodes.begin(); it2 != it->nodes.end(); ++it2) {
+                ofile << (it2 == it->nodes.begin() ? "" : ", ");
+                ofile << "{\"node\": ";
+                writeJSONString(ofile, it2->nodeName);
+                ofile << ", \"time\": " << it2->timeSpent
+                      << ", \"cacheHits\": " << it2->cacheHits
+                      << ", \"cacheMisses\": " << it2->cacheMisses
+                      << ", \"cacheHitsDownscaled\": " << it2->cacheHitsDownscaled << "}";
+            }
+            ofile << "]}";
+        }
+        ofile << "\n ]}";
+    }
+    ofile << "\n]\n}\n";
+    ofile.flush();
+
+    return !ofile.fail();
+} // RenderBenchmark::writeReport
+
+NATRON_NAMESPACE_EXIT;
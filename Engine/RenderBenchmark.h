@@ -0,0 +1,142 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_RenderBenchmark_h
+#define Natron_Engine_RenderBenchmark_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+// Number of times the frame range is rendered by default in benchmark mode: once with a cold cache, once with a warm cache
+#define NATRON_RENDER_BENCHMARK_DEFAULT_RUNS 2
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Collects the timings of the frames rendered by the command-line renderer when it renders the same frame range
+ * several times (the first time with a cold cache, then with a warm cache), and writes them to a JSON report that
+ * can be compared across builds and machines.
+ *
+ * Each run records the wall time of each frame, the time spent in each node with its cache hits and misses, the
+ * lookups of the node cache, the CPU time of the process, from which the utilization of the render threads is
+ * deduced, and the peak resident memory.
+ * addFrame() may be called from any thread.
+ **/
+struct RenderBenchmarkPrivate;
+class RenderBenchmark
+{
+public:
+
+    struct NodeTime
+    {
+        std::string nodeName;
+        double timeSpent;
+        int cacheHits;
+        int cacheMisses;
+        int cacheHitsDownscaled;
+
+        NodeTime()
+            : nodeName()
+            , timeSpent(0.)
+            , cacheHits(0)
+            , cacheMisses(0)
+            , cacheHitsDownscaled(0)
+        {
+        }
+    };
+
+    struct Frame
+    {
+        std::string writerName;
+        int time;
+        int view;
+        double wallTime;
+        std::vector<NodeTime> nodes;
+
+        Frame()
+            : writerName()
+            , time(0)
+            , view(0)
+            , wallTime(0.)
+            , nodes()
+        {
+        }
+    };
+
+    RenderBenchmark();
+
+    ~RenderBenchmark();
+
+    /**
+     * @brief Starts a new run. cacheStats are the lookups of the node cache so far.
+     **/
+    void startRun(bool isCacheCold,
+                  const CacheAccessStats& cacheStats);
+
+    void endRun(const CacheAccessStats& cacheStats);
+
+    int getRunsCount() const;
+
+    // Returns the wall time of a run that ended, in seconds
+    double getRunWallTime(int runIndex) const;
+
+    // Returns the frames rendered during a run, sorted by writer, time and view
+    std::vector<Frame> getRunFrames(int runIndex) const;
+
+    /**
+     * @brief Records a frame rendered during the current run. Frames rendered outside of a run are ignored.
+     **/
+    void addFrame(const Frame& frame);
+
+    void addFrame(const std::string& writerName,
+                  int time,
+                  ViewIdx view,
+                  double wallTime,
+                  const std::map<NodePtr, NodeRenderStats>& stats);
+
+    /**
+     * @brief Writes all the runs to a JSON file. Returns false if the file could not be written.
+     **/
+    bool writeReport(const std::string& filePath,
+                     const std::string& projectName) const;
+
+private:
+
+    boost::scoped_ptr<RenderBenchmarkPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_RenderBenchmark_h
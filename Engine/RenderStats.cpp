@@ -29,6 +29,7 @@
 #include <stdexcept>
 
 #include <QtCore/QMutex>
+#include <QtCore/QAtomicInt>
 
 #include "Engine/Node.h"
 #include "Engine/Timer.h"
@@ -301,6 +302,9 @@ NodeRenderStats::getOutputPremult() const
     return _imp->outputPremult;
 }
 
+//Written by the main-thread each time a change is propagated to the nodes hash
+static QAtomicInt nodesRehashedByLastEditCounter;
+
 struct RenderStatsPrivate
 {
     mutable QMutex lock;
@@ -314,12 +318,15 @@ struct RenderStatsPrivate
     typedef std::map<NodeWPtr, NodeRenderStats > NodeInfosMap;
     NodeInfosMap nodeInfos;
 
+    //Number of nodes whose local hash was recomputed by the last edit before the frame started
+    int nodesRehashedByLastEdit;
 
     RenderStatsPrivate()
         : lock()
         , totalTimeSpentForFrameTimer()
         , doNodesProfiling(false)
         , nodeInfos()
+        , nodesRehashedByLastEdit(0)
     {
     }
 
@@ -355,6 +362,7 @@ RenderStats::RenderStats(bool enableInDepthProfiling)
     : _imp( new RenderStatsPrivate() )
 {
     _imp->doNodesProfiling = enableInDepthProfiling;
+    _imp->nodesRehashedByLastEdit = (int)nodesRehashedByLastEditCounter;
 }
 
 RenderStats::~RenderStats()
@@ -453,4 +461,16 @@ RenderStats::getStats(double *totalTimeSpent) const
     return ret;
 }
 
+int
+RenderStats::getNodesRehashedByLastEdit() const
+{
+    return _imp->nodesRehashedByLastEdit;
+}
+
+void
+RenderStats::setNodesRehashedByLastEdit(int nNodes)
+{
+    nodesRehashedByLastEditCounter.fetchAndStoreRelaxed(nNodes);
+}
+
 NATRON_NAMESPACE_EXIT;
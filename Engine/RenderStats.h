@@ -144,6 +144,17 @@ public:
 
     std::map<NodePtr, NodeRenderStats > getStats(double *totalTimeSpent) const;
 
+    /**
+     * @brief Returns the number of nodes whose local part of the hash (knobs age, script name) had to be recomputed
+     * by the last edit of the node graph before this frame started rendering.
+     **/
+    int getNodesRehashedByLastEdit() const;
+
+    /**
+     * @brief Called by Node::computeHash() on the main-thread once an edit has been propagated to the nodes hash.
+     **/
+    static void setNodesRehashedByLastEdit(int nNodes);
+
 private:
 
     boost::scoped_ptr<RenderStatsPrivate> _imp;
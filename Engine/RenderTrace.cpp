@@ -0,0 +1,366 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderTrace.h"
+
+#include <list>
+#include <sstream>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/atomic.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
+
+#include "Engine/EffectInstance.h"
+#include "Engine/FStreamsSupport.h"
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+struct TraceEvent
+{
+    const char* category;
+    const char* name;
+    std::string detail;
+    U64 beginTimestamp;
+    U64 endTimestamp;
+};
+
+/**
+ * @brief The events of a thread. Only that thread appends to it, the lock is only contended while the trace is
+ * being written or cleared.
+ **/
+struct ThreadEvents
+{
+    QMutex lock;
+    std::vector<TraceEvent> events;
+    std::string threadName;
+    int threadIndex;
+    U64 nDropped;
+
+    ThreadEvents()
+        : lock()
+        , events()
+        , threadName()
+        , threadIndex(0)
+        , nDropped(0)
+    {
+    }
+};
+
+typedef boost::shared_ptr<ThreadEvents> ThreadEventsPtr;
+
+struct RenderTracePrivate
+{
+    boost::atomic<bool> enabled;
+    QElapsedTimer timer;
+
+    // Protects the fields below
+    QMutex lock;
+
+    // The events of all threads that recorded events, kept after the threads are destroyed so that they can be written
+    std::list<ThreadEventsPtr> threads;
+    int nextThreadIndex;
+
+    // Each thread holds a reference on its events
+    QThreadStorage<ThreadEventsPtr> threadEvents;
+
+    RenderTracePrivate()
+        : enabled(false)
+        , timer()
+        , lock()
+        , threads()
+        , nextThreadIndex(1)
+        , threadEvents()
+    {
+        timer.start();
+    }
+};
+
+// Scopes may be destroyed by threads still running after the statics of this file are destroyed: the trace is never destroyed
+RenderTracePrivate*
+getTrace()
+{
+    static RenderTracePrivate* trace = new RenderTracePrivate;
+
+    return trace;
+}
+
+ThreadEvents*
+getCurrentThreadEvents(RenderTracePrivate* trace)
+{
+    if ( trace->threadEvents.hasLocalData() ) {
+        return trace->threadEvents.localData().get();
+    }
+
+    ThreadEventsPtr events = boost::make_shared<ThreadEvents>();
+    QThread* thread = QThread::currentThread();
+    if ( thread && !thread->objectName().isEmpty() ) {
+        events->threadName = thread->objectName().toStdString();
+    } else if ( QCoreApplication::instance() && ( thread == QCoreApplication::instance()->thread() ) ) {
+        events->threadName = "Main";
+    } else {
+        events->threadName = "Thread";
+    }
+    {
+        QMutexLocker k(&trace->lock);
+        events->threadIndex = trace->nextThreadIndex++;
+        trace->threads.push_back(events);
+    }
+    trace->threadEvents.setLocalData(events);
+
+    return events.get();
+}
+
+void
+writeJSONString(FStreamsSupport::ofstream& ofile,
+                const std::string& str)
+{
+    ofile << '"';
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        unsigned char c = (unsigned char)str[i];
+        if ( (c == '"') || (c == '\\') ) {
+            ofile << '\\' << str[i];
+        } else if (c < 0x20) {
+            static const char hexDigits[] = "0123456789abcdef";
+            ofile << "\\u00" << hexDigits[c >> 4] << hexDigits[c & 0xf];
+        } else {
+            ofile << str[i];
+        }
+    }
+    ofile << '"';
+}
+
+// Trace timestamps are in microseconds
+void
+writeMicroseconds(FStreamsSupport::ofstream& ofile,
+                  U64 nanoseconds)
+{
+    unsigned int fraction = (unsigned int)(nanoseconds % 1000);
+
+    ofile << nanoseconds / 1000 << '.' << fraction / 100 << fraction / 10 % 10 << fraction % 10;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+namespace RenderTrace {
+
+void
+start()
+{
+    RenderTracePrivate* trace = getTrace();
+    QMutexLocker k(&trace->lock);
+
+    for (std::list<ThreadEventsPtr>::iterator it = trace->threads.begin(); it != trace->threads.end(); ) {
+        // Forget threads that were destroyed
+        if ( it->unique() ) {
+            it = trace->threads.erase(it);
+            continue;
+        }
+        QMutexLocker l(&(*it)->lock);
+        (*it)->events.clear();
+        (*it)->nDropped = 0;
+        ++it;
+    }
+    trace->enabled = true;
+}
+
+void
+stop()
+{
+    getTrace()->enabled = false;
+}
+
+bool
+isEnabled()
+{
+    return getTrace()->enabled.load(boost::memory_order_relaxed);
+}
+
+U64
+getTimestamp()
+{
+    return (U64)getTrace()->timer.nsecsElapsed();
+}
+
+void
+addSpan(const char* category,
+        const char* name,
+        const std::string& detail,
+        U64 beginTimestamp,
+        U64 endTimestamp)
+{
+    ThreadEvents* events = getCurrentThreadEvents( getTrace() );
+    QMutexLocker k(&events->lock);
+
+    if (events->events.size() >= NATRON_RENDER_TRACE_MAX_EVENTS_PER_THREAD) {
+        ++events->nDropped;
+
+        return;
+    }
+    events->events.push_back( TraceEvent() );
+    TraceEvent& e = events->events.back();
+    e.category = category;
+    e.name = name;
+    e.detail = detail;
+    e.beginTimestamp = beginTimestamp;
+    e.endTimestamp = endTimestamp;
+}
+
+std::size_t
+getEventsCount()
+{
+    RenderTracePrivate* trace = getTrace();
+    QMutexLocker k(&trace->lock);
+    std::size_t ret = 0;
+
+    for (std::list<ThreadEventsPtr>::iterator it = trace->threads.begin(); it != trace->threads.end(); ++it) {
+        QMutexLocker l(&(*it)->lock);
+        ret += (*it)->events.size();
+    }
+
+    return ret;
+}
+
+bool
+writeChromeTrace(const std::string& filePath)
+{
+    FStreamsSupport::ofstream ofile;
+
+    FStreamsSupport::open(&ofile, filePath, std::ios_base::out | std::ios_base::trunc);
+    if (!ofile) {
+        return false;
+    }
+
+    const long long pid = (long long)QCoreApplication::applicationPid();
+    RenderTracePrivate* trace = getTrace();
+    std::list<ThreadEventsPtr> threads;
+    {
+        QMutexLocker k(&trace->lock);
+        threads = trace->threads;
+    }
+
+    ofile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (std::list<ThreadEventsPtr>::iterator it = threads.begin(); it != threads.end(); ++it) {
+        QMutexLocker l(&(*it)->lock);
+        const ThreadEvents& thread = **it;
+        if ( thread.events.empty() && (thread.nDropped == 0) ) {
+            continue;
+        }
+
+        std::string threadName = thread.threadName;
+        if (thread.nDropped > 0) {
+            std::stringstream ss;
+            ss << " (" << thread.nDropped << " events dropped)";
+            threadName += ss.str();
+        }
+        ofile << (first ? "\n" : ",\n");
+        first = false;
+        ofile << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << thread.threadIndex << ",\"args\":{\"name\":";
+        writeJSONString(ofile, threadName);
+        ofile << "}}";
+
+        for (std::vector<TraceEvent>::const_iterator e = thread.events.begin(); e != thread.events.end(); ++e) {
+            ofile << ",\n{\"ph\":\"X\",\"cat\":";
+            writeJSONString(ofile, e->category);
+            ofile << ",\"name\":";
+            writeJSONString( ofile, e->detail.empty() ? std::string(e->name) : std::string(e->name) + ' ' + e->detail );
+            ofile << ",\"pid\":" << pid << ",\"tid\":" << thread.threadIndex << ",\"ts\":";
+            writeMicroseconds(ofile, e->beginTimestamp);
+            ofile << ",\"dur\":";
+            writeMicroseconds(ofile, e->endTimestamp > e->beginTimestamp ? e->endTimestamp - e->beginTimestamp : 0);
+            ofile << '}';
+        }
+    }
+    ofile << "\n]}\n";
+    ofile.flush();
+
+    return !ofile.fail();
+}
+} // namespace RenderTrace
+
+RenderTraceScope::RenderTraceScope(const char* category,
+                                   const char* name)
+    : _category(category)
+    , _name(name)
+    , _detail()
+    , _beginTimestamp(0)
+    , _enabled( RenderTrace::isEnabled() )
+{
+    if (_enabled) {
+        _beginTimestamp = RenderTrace::getTimestamp();
+    }
+}
+
+RenderTraceScope::RenderTraceScope(const char* category,
+                                   const char* name,
+                                   const EffectInstance* effect)
+    : _category(category)
+    , _name(name)
+    , _detail()
+    , _beginTimestamp(0)
+    , _enabled( RenderTrace::isEnabled() )
+{
+    if (_enabled) {
+        if (effect) {
+            _detail = effect->getScriptName_mt_safe();
+        }
+        _beginTimestamp = RenderTrace::getTimestamp();
+    }
+}
+
+RenderTraceScope::RenderTraceScope(const char* category,
+                                   const char* name,
+                                   const std::string& detail)
+    : _category(category)
+    , _name(name)
+    , _detail()
+    , _beginTimestamp(0)
+    , _enabled( RenderTrace::isEnabled() )
+{
+    if (_enabled) {
+        _detail = detail;
+        _beginTimestamp = RenderTrace::getTimestamp();
+    }
+}
+
+RenderTraceScope::~RenderTraceScope()
+{
+    if (_enabled) {
+        RenderTrace::addSpan( _category, _name, _detail, _beginTimestamp, RenderTrace::getTimestamp() );
+    }
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,119 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_RenderTrace_h
+#define Natron_Engine_RenderTrace_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <string>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/EngineFwd.h"
+
+// Events recorded by a thread beyond that are dropped, which caps the memory used by a trace to a few hundred MB
+#define NATRON_RENDER_TRACE_MAX_EVENTS_PER_THREAD 1000000
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Records timestamped spans of the render pipeline (renderRoI, plugin actions, cache lookups, tasks of the
+ * TaskScheduler, waits...) on each thread, to be written as a Chrome trace-event JSON file that can be opened in
+ * chrome://tracing or Perfetto.
+ *
+ * When tracing is disabled, a RenderTraceScope only costs an atomic load. When enabled, each thread appends its
+ * events to its own buffer, so that threads never contend when recording.
+ * All functions are thread-safe.
+ **/
+namespace RenderTrace {
+
+/**
+ * @brief Discards the events recorded so far and starts recording.
+ **/
+void start();
+
+/**
+ * @brief Stops recording. The events recorded are kept until the next call to start().
+ **/
+void stop();
+
+bool isEnabled();
+
+// Returns the number of nanoseconds elapsed since the first call to start()
+U64 getTimestamp();
+
+/**
+ * @brief Records a span of the calling thread. category and name must be string literals. detail may be empty.
+ **/
+void addSpan(const char* category,
+             const char* name,
+             const std::string& detail,
+             U64 beginTimestamp,
+             U64 endTimestamp);
+
+// Returns the number of events recorded since the last call to start(), excluding the dropped ones
+std::size_t getEventsCount();
+
+/**
+ * @brief Writes the events recorded since the last call to start() to filePath, in the Chrome trace-event format.
+ * Returns false if the file could not be written.
+ **/
+bool writeChromeTrace(const std::string& filePath);
+} // namespace RenderTrace
+
+/**
+ * @brief Records a span from its construction to its destruction, if tracing is enabled when it is constructed.
+ * The span of an effect action is detailed with the script name of the node.
+ * category and name must be string literals.
+ **/
+class RenderTraceScope
+{
+public:
+
+    RenderTraceScope(const char* category,
+                     const char* name);
+
+    RenderTraceScope(const char* category,
+                     const char* name,
+                     const EffectInstance* effect);
+
+    RenderTraceScope(const char* category,
+                     const char* name,
+                     const std::string& detail);
+
+    ~RenderTraceScope();
+
+private:
+
+    const char* _category;
+    const char* _name;
+    std::string _detail;
+    U64 _beginTimestamp;
+    bool _enabled;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_RenderTrace_h
@@ -142,7 +142,7 @@ NATRON_NAMESPACE_ANONYMOUS_EXIT;
 
 void
 RotoBezierTriangulation::computeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel, double featherDist,
-                                             PolygonData* outArgs)
+                                             PolygonData* outArgs, bool tessellateInternalShape)
 {
     ///Note that we do not use the opacity when rendering the bezier, it is rendered with correct floating point opacity/color when converting
     ///to the Natron image.
@@ -337,6 +337,23 @@ RotoBezierTriangulation::computeTriangles(const Bezier * bezier, double time, un
 
 
 
+    // Join the internal polygon into a single vector of vertices now that we don't need per-bezier segments separation.
+    // we will need the indices for libtess
+    for (std::vector<std::vector<ParametricPoint> >::const_iterator it = outArgs->bezierPolygon.begin(); it != outArgs->bezierPolygon.end(); ++it) {
+
+        // don't add the first vertex which is the same as the last vertex of the last segment
+        std::vector<ParametricPoint>::const_iterator start = it->begin();
+        ++start;
+        outArgs->bezierPolygonJoined.insert(outArgs->bezierPolygonJoined.end(), start, it->end());
+
+
+    }
+    outArgs->bezierPolygon.clear();
+
+    if (!tessellateInternalShape) {
+        return;
+    }
+
     // Now tesselate the internal bezier using glu
     libtess_GLUtesselator* tesselator = libtess_gluNewTess();
 
@@ -352,19 +369,6 @@ RotoBezierTriangulation::computeTriangles(const Bezier * bezier, double time, un
     libtess_gluTessBeginPolygon(tesselator, (void*)outArgs);
     libtess_gluTessBeginContour(tesselator);
 
-    // Join the internal polygon into a single vector of vertices now that we don't need per-bezier segments separation.
-    // we will need the indices for libtess
-    for (std::vector<std::vector<ParametricPoint> >::const_iterator it = outArgs->bezierPolygon.begin(); it != outArgs->bezierPolygon.end(); ++it) {
-
-        // don't add the first vertex which is the same as the last vertex of the last segment
-        std::vector<ParametricPoint>::const_iterator start = it->begin();
-        ++start;
-        outArgs->bezierPolygonJoined.insert(outArgs->bezierPolygonJoined.end(), start, it->end());
-
-
-    }
-    outArgs->bezierPolygon.clear();
-
     outArgs->bezierPolygonIndices.resize(outArgs->bezierPolygonJoined.size());
 
     for (std::size_t i = 0; i < outArgs->bezierPolygonIndices.size(); ++i) {
@@ -100,7 +100,11 @@ public:
         unsigned int error;
     };
 
-    static void computeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel,  double featherDist, PolygonData* outArgs);
+    /**
+     * @brief Computes the feather mesh and the internal polygon of the bezier. If tessellateInternalShape is false the internal
+     * polygon is not split into triangles: only bezierPolygonJoined is filled, which is enough for renderers that fill polygons.
+     **/
+    static void computeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel,  double featherDist, PolygonData* outArgs, bool tessellateInternalShape = true);
 
 };
 
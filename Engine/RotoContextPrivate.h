@@ -56,6 +56,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/AppManager.h"
 #include "Engine/BezierCP.h"
 #include "Engine/Bezier.h"
+#include "Engine/BezierTessellationCache.h"
 #include "Engine/Curve.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Image.h"
@@ -400,6 +401,9 @@ struct BezierPrivate
     mutable QMutex guiCopyMutex;
     bool mustCopyGui;
 
+    // The last tessellations of the curve and of the feather, protected by the item mutex
+    BezierTessellationCache tessellationCache;
+
     BezierPrivate(bool isOpenBezier)
         : points()
         , featherPoints()
@@ -412,6 +416,7 @@ struct BezierPrivate
         , isOpenBezier(isOpenBezier)
         , guiCopyMutex()
         , mustCopyGui(false)
+        , tessellationCache()
     {
     }
 
@@ -0,0 +1,893 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RotoShapeRenderCPU.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cmath>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#endif
+
+#ifdef NATRON_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "Engine/AppManager.h"
+#include "Engine/Bezier.h"
+#include "Engine/Image.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/RotoShapeRenderNodePrivate.h"
+#include "Engine/RotoStrokeItem.h"
+#include "Engine/TaskScheduler.h"
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// Same functions as the feather ramp shader of RotoShapeRenderGL
+inline float
+applyRamp(RampTypeEnum type,
+          float t)
+{
+    switch (type) {
+    case eRampTypeLinear:
+        return t;
+    case eRampTypePLinear:
+        return t * t * t;
+    case eRampTypeEaseIn:
+        return t * t * (2.f - t);
+    case eRampTypeEaseOut:
+        return t * (1.f + t * (1.f - t));
+    case eRampTypeSmooth:
+        return t * t * (3.f - 2.f * t);
+    }
+
+    return t;
+}
+
+/*
+ * The internal polygon is rendered with an accumulation buffer, see
+ * https://medium.com/@raphlinus/inside-the-fastest-font-renderer-in-the-world-75ae5270c445
+ * Each line adds to the cells it crosses the signed area it covers on their right, and the amount of the line height
+ * it covers to the next cell, so that the prefix sum of a row gives the winding number integrated over each pixel.
+ * Rows have 2 extra cells for the lines on the right edge of the tile.
+ */
+
+// Adds a line whose coordinates are relative to the tile, with 0 <= x <= width and 0 <= y <= height
+void
+accumulateLine(double x0,
+               double y0,
+               double x1,
+               double y1,
+               int height,
+               int rowStride,
+               float* acc)
+{
+    if (y0 == y1) {
+        return;
+    }
+    double dir = 1.;
+    if (y0 > y1) {
+        dir = -1.;
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+    const double dxdy = (x1 - x0) / (y1 - y0);
+    double x = x0;
+    const int yEnd = std::min( height, (int)std::ceil(y1) );
+
+    for (int y = std::max(0, (int)y0); y < yEnd; ++y) {
+        float* row = acc + y * rowStride;
+        const double dy = std::min( (double)(y + 1), y1 ) - std::max( (double)y, y0 );
+        const double xNext = x + dxdy * dy;
+        const double d = dy * dir;
+        const double xMin = std::min(x, xNext);
+        const double xMax = std::max(x, xNext);
+        const double xMinFloor = std::floor(xMin);
+        const int xMinI = (int)xMinFloor;
+        const double xMaxCeil = std::ceil(xMax);
+        const int xMaxI = (int)xMaxCeil;
+
+        if (xMaxI <= xMinI + 1) {
+            // The line stays within a pixel
+            const double xmf = 0.5 * (x + xNext) - xMinFloor;
+            row[xMinI] += (float)(d - d * xmf);
+            row[xMinI + 1] += (float)(d * xmf);
+        } else {
+            const double s = 1. / (xMax - xMin);
+            const double x0f = xMin - xMinFloor;
+            const double a0 = 0.5 * s * (1. - x0f) * (1. - x0f);
+            const double x1f = xMax - xMaxCeil + 1.;
+            const double am = 0.5 * s * x1f * x1f;
+            row[xMinI] += (float)(d * a0);
+            if (xMaxI == xMinI + 2) {
+                row[xMinI + 1] += (float)( d * (1. - a0 - am) );
+            } else {
+                const double a1 = s * (1.5 - x0f);
+                row[xMinI + 1] += (float)( d * (a1 - a0) );
+                for (int xi = xMinI + 2; xi < xMaxI - 1; ++xi) {
+                    row[xi] += (float)(d * s);
+                }
+                const double a2 = a1 + (xMaxI - xMinI - 3) * s;
+                row[xMaxI - 1] += (float)( d * (1. - a2 - am) );
+            }
+            row[xMaxI] += (float)(d * am);
+        }
+        x = xNext;
+    }
+} // accumulateLine
+
+// Adds an edge of the polygon, with coordinates relative to the tile.
+// The parts of the edge on the left of the tile still change the winding number of the pixels of the tile: they are moved
+// on its left border. The parts on its right do not change the pixels of the tile.
+void
+accumulateEdge(double x0,
+               double y0,
+               double x1,
+               double y1,
+               int width,
+               int height,
+               int rowStride,
+               float* acc)
+{
+    if ( (y0 == y1) || ( (y0 <= 0) && (y1 <= 0) ) || ( (y0 >= height) && (y1 >= height) ) ||
+         ( (x0 >= width) && (x1 >= width) ) ) {
+        return;
+    }
+
+    // Clip to the rows of the tile
+    const double dxdy = (x1 - x0) / (y1 - y0);
+    if (y0 < 0) {
+        x0 -= y0 * dxdy;
+        y0 = 0;
+    } else if (y0 > height) {
+        x0 -= (y0 - height) * dxdy;
+        y0 = height;
+    }
+    if (y1 < 0) {
+        x1 -= y1 * dxdy;
+        y1 = 0;
+    } else if (y1 > height) {
+        x1 -= (y1 - height) * dxdy;
+        y1 = height;
+    }
+
+    // Split where the edge crosses the left and right borders
+    double xs[4] = {x0, 0., 0., x1};
+    double ys[4] = {y0, 0., 0., y1};
+    int n = 1;
+    const double borders[2] = {0., (double)width};
+    const double dydx = (x1 != x0) ? (y1 - y0) / (x1 - x0) : 0.;
+    if (x0 <= x1) {
+        for (int i = 0; i < 2; ++i) {
+            if ( (x0 < borders[i]) && (borders[i] < x1) ) {
+                xs[n] = borders[i];
+                ys[n] = y0 + (borders[i] - x0) * dydx;
+                ++n;
+            }
+        }
+    } else {
+        for (int i = 1; i >= 0; --i) {
+            if ( (x1 < borders[i]) && (borders[i] < x0) ) {
+                xs[n] = borders[i];
+                ys[n] = y0 + (borders[i] - x0) * dydx;
+                ++n;
+            }
+        }
+    }
+    xs[n] = x1;
+    ys[n] = y1;
+
+    for (int i = 0; i < n; ++i) {
+        const double xMid = 0.5 * (xs[i] + xs[i + 1]);
+        if (xMid >= width) {
+            continue;
+        }
+        if (xMid <= 0) {
+            accumulateLine(0., ys[i], 0., ys[i + 1], height, rowStride, acc);
+        } else {
+            accumulateLine(std::max( 0., std::min(xs[i], (double)width) ), ys[i],
+                           std::max( 0., std::min(xs[i + 1], (double)width) ), ys[i + 1],
+                           height, rowStride, acc);
+        }
+    }
+} // accumulateEdge
+
+// Coverage of a pixel with the nonzero winding rule, like the Cairo renderer: any non-zero winding number is covered,
+// so that self-overlapping shapes have no holes, and fractional values on the edges are the covered area
+inline float
+nonZeroCoverage(float winding)
+{
+    return std::min(std::fabs(winding), 1.f);
+}
+
+// Computes the prefix sum of a row of the accumulation buffer and merges its coverage into dst
+void
+accumulateRow(const float* acc,
+              int width,
+              float* dst)
+{
+    int x = 0;
+
+#ifdef NATRON_USE_SSE2
+    const __m128 signMask = _mm_castsi128_ps( _mm_set1_epi32(0x7fffffff) );
+    const __m128 one = _mm_set1_ps(1.f);
+    __m128 offset = _mm_setzero_ps();
+    for (; x + 4 <= width; x += 4) {
+        // prefix sum of 4 cells
+        __m128 v = _mm_loadu_ps(acc + x);
+        v = _mm_add_ps( v, _mm_castsi128_ps( _mm_slli_si128(_mm_castps_si128(v), 4) ) );
+        v = _mm_add_ps( v, _mm_castsi128_ps( _mm_slli_si128(_mm_castps_si128(v), 8) ) );
+        v = _mm_add_ps(v, offset);
+        offset = _mm_shuffle_ps( v, v, _MM_SHUFFLE(3, 3, 3, 3) );
+
+        // see nonZeroCoverage
+        __m128 w = _mm_min_ps(_mm_and_ps(v, signMask), one);
+        _mm_storeu_ps( dst + x, _mm_max_ps(_mm_loadu_ps(dst + x), w) );
+    }
+    float sum = _mm_cvtss_f32(offset);
+#else
+    float sum = 0.f;
+#endif
+    for (; x < width; ++x) {
+        sum += acc[x];
+        dst[x] = std::max( dst[x], nonZeroCoverage(sum) );
+    }
+}
+
+void
+renderInternalShape(const std::vector<ParametricPoint>& polygon,
+                    const RectI& tile,
+                    float* coverage,
+                    std::vector<float>* accumulation)
+{
+    const int width = tile.width();
+    const int height = tile.height();
+    const int rowStride = width + 2;
+
+    accumulation->assign( (std::size_t)rowStride * height, 0.f );
+    float* acc = &accumulation->front();
+
+    // The polygon is closed: its last point is connected to its first one
+    const std::size_t nPoints = polygon.size();
+    for (std::size_t i = 0; i < nPoints; ++i) {
+        const ParametricPoint& p0 = polygon[i];
+        const ParametricPoint& p1 = polygon[i + 1 < nPoints ? i + 1 : 0];
+        accumulateEdge(p0.x - tile.x1, p0.y - tile.y1, p1.x - tile.x1, p1.y - tile.y1, width, height, rowStride, acc);
+    }
+
+    for (int y = 0; y < height; ++y) {
+        accumulateRow(acc + y * rowStride, width, coverage + y * width);
+    }
+}
+
+void
+renderFeather(const std::vector<RotoBezierTriangulation::RotoFeatherVertex>& mesh,
+              RampTypeEnum type,
+              double fallOff,
+              const RectI& tile,
+              float* coverage)
+{
+    const int width = tile.width();
+    const bool applyFallOff = (fallOff != 1.);
+
+    assert(mesh.size() % 3 == 0);
+    for (std::size_t i = 0; i + 2 < mesh.size(); i += 3) {
+        const RotoBezierTriangulation::RotoFeatherVertex* v[3] = {&mesh[i], &mesh[i + 1], &mesh[i + 2]};
+
+        double yMin = std::min( v[0]->y, std::min(v[1]->y, v[2]->y) );
+        double yMax = std::max( v[0]->y, std::max(v[1]->y, v[2]->y) );
+        double xMin = std::min( v[0]->x, std::min(v[1]->x, v[2]->x) );
+        double xMax = std::max( v[0]->x, std::max(v[1]->x, v[2]->x) );
+
+        // Pixels whose center lies in the triangle
+        const int yStart = std::max( tile.y1, (int)std::ceil(yMin - 0.5) );
+        const int yEnd = std::min( tile.y2 - 1, (int)std::floor(yMax - 0.5) );
+        if ( (yStart > yEnd) || (xMax + 0.5 < tile.x1) || (xMin - 0.5 >= tile.x2) ) {
+            continue;
+        }
+
+        // The coverage is 1 on the inner vertices and 0 on the outter ones, it varies linearly on the triangle
+        const double t0 = v[0]->isInner ? 1. : 0.;
+        const double t1 = v[1]->isInner ? 1. : 0.;
+        const double t2 = v[2]->isInner ? 1. : 0.;
+        const double e1x = v[1]->x - v[0]->x, e1y = v[1]->y - v[0]->y;
+        const double e2x = v[2]->x - v[0]->x, e2y = v[2]->y - v[0]->y;
+        const double area = e1x * e2y - e2x * e1y;
+        if (std::fabs(area) < 1e-12) {
+            continue;
+        }
+        const double dtdx = ( (t1 - t0) * e2y - (t2 - t0) * e1y ) / area;
+        const double dtdy = ( (t2 - t0) * e1x - (t1 - t0) * e2x ) / area;
+
+        for (int y = yStart; y <= yEnd; ++y) {
+            const double yc = y + 0.5;
+
+            // Intersection of the row with the triangle
+            double xl = xMax, xr = xMin;
+            for (int e = 0; e < 3; ++e) {
+                const RotoBezierTriangulation::RotoFeatherVertex* a = v[e];
+                const RotoBezierTriangulation::RotoFeatherVertex* b = v[(e + 1) % 3];
+                if ( (a->y == b->y) || (yc < std::min(a->y, b->y)) || (yc > std::max(a->y, b->y)) ) {
+                    continue;
+                }
+                double x = a->x + (yc - a->y) * (b->x - a->x) / (b->y - a->y);
+                xl = std::min(xl, x);
+                xr = std::max(xr, x);
+            }
+            const int xStart = std::max( tile.x1, (int)std::ceil(xl - 0.5) );
+            const int xEnd = std::min( tile.x2 - 1, (int)std::floor(xr - 0.5) );
+            if (xStart > xEnd) {
+                continue;
+            }
+
+            float* dst = coverage + (y - tile.y1) * width + (xStart - tile.x1);
+            double t = t0 + dtdx * (xStart + 0.5 - v[0]->x) + dtdy * (yc - v[0]->y);
+            for (int x = xStart; x <= xEnd; ++x, ++dst, t += dtdx) {
+                float value = applyRamp( type, (float)std::max( 0., std::min(t, 1.) ) );
+                if (applyFallOff) {
+                    value = (float)std::pow( (double)value, fallOff );
+                }
+                *dst = std::max(*dst, value);
+            }
+        }
+    }
+} // renderFeather
+
+// Converts the coverage to the destination pixels, with the same conversion as the Cairo renderer
+void
+writeCoverage(const float* coverage,
+              const RectI& tile,
+              const double shapeColor[3],
+              double opacity,
+              float* dstPixels,
+              std::size_t dstRowElements,
+              int dstNComps)
+{
+    const float r = (float)(shapeColor[0] * opacity);
+    const float g = (float)(shapeColor[1] * opacity);
+    const float b = (float)(shapeColor[2] * opacity);
+    const float a = (float)opacity;
+    const int width = tile.width();
+    const float* src = coverage;
+
+    for (int y = 0; y < tile.height(); ++y, src += width) {
+        float* dst = dstPixels + (std::size_t)y * dstRowElements;
+        switch (dstNComps) {
+        case 1:
+            for (int x = 0; x < width; ++x) {
+                dst[x] = src[x] * a;
+            }
+            break;
+        case 2:
+            for (int x = 0; x < width; ++x, dst += 2) {
+                dst[0] = src[x] * r;
+                dst[1] = src[x] * g;
+            }
+            break;
+        case 3:
+            for (int x = 0; x < width; ++x, dst += 3) {
+                dst[0] = src[x] * r;
+                dst[1] = src[x] * g;
+                dst[2] = src[x] * b;
+            }
+            break;
+        case 4:
+            for (int x = 0; x < width; ++x, dst += 4) {
+                dst[0] = src[x] * r;
+                dst[1] = src[x] * g;
+                dst[2] = src[x] * b;
+                dst[3] = src[x] * a;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+} // writeCoverage
+
+// Inverse of writeCoverage without opacity: retrieves the coverage of the strokes already painted in the destination pixels
+void
+readCoverage(const float* dstPixels,
+             std::size_t dstRowElements,
+             int dstNComps,
+             const double shapeColor[3],
+             const RectI& tile,
+             float* coverage)
+{
+    const int width = tile.width();
+    int channel = 0;
+    float scale = 1.f;
+
+    if (dstNComps == 4) {
+        channel = 3;
+    } else if (dstNComps > 1) {
+        // No alpha channel: use the first color channel which is not zero
+        while ( channel < dstNComps - 1 && shapeColor[channel] == 0. ) {
+            ++channel;
+        }
+        scale = shapeColor[channel] == 0. ? 0.f : (float)(1. / shapeColor[channel]);
+    }
+    for (int y = 0; y < tile.height(); ++y, coverage += width) {
+        const float* src = dstPixels + (std::size_t)y * dstRowElements + channel;
+        for (int x = 0; x < width; ++x, src += dstNComps) {
+            coverage[x] = *src * scale;
+        }
+    }
+}
+
+typedef boost::shared_ptr<RotoBezierTriangulation::PolygonData> PolygonDataPtr;
+
+struct RenderBezierArgs
+{
+    // One per motion blur sample
+    std::vector<PolygonDataPtr> samples;
+    std::vector<double> fallOffs;
+    RampTypeEnum type;
+    double shapeColor[3];
+    double opacity;
+
+    // The pixel at the bottom-left corner of the RoI in the destination image
+    float* dstPixels;
+    std::size_t dstRowElements;
+    int dstNComps;
+};
+
+void
+renderBezierTile(const RenderBezierArgs* args,
+                 const RectI& tile)
+{
+    const std::size_t nPixels = (std::size_t)tile.width() * tile.height();
+    std::vector<float> coverage(nPixels, 0.f);
+    std::vector<float> accumulation;
+
+    if (args->samples.size() == 1) {
+        RotoShapeRenderCPU::renderCoverage_cpu(*args->samples[0], args->type, args->fallOffs[0], tile, &coverage.front(), &accumulation);
+    } else {
+        std::vector<float> sampleCoverage(nPixels);
+        const float weight = 1.f / args->samples.size();
+        for (std::size_t i = 0; i < args->samples.size(); ++i) {
+            std::fill(sampleCoverage.begin(), sampleCoverage.end(), 0.f);
+            RotoShapeRenderCPU::renderCoverage_cpu(*args->samples[i], args->type, args->fallOffs[i], tile, &sampleCoverage.front(), &accumulation);
+            for (std::size_t p = 0; p < nPixels; ++p) {
+                coverage[p] += sampleCoverage[p] * weight;
+            }
+        }
+    }
+
+    writeCoverage(&coverage.front(), tile, args->shapeColor, args->opacity, args->dstPixels, args->dstRowElements, args->dstNComps);
+} // renderBezierTile
+
+// Same approximation of a gaussian as the Cairo renderer
+inline double
+hardnessGaussLookup(double f)
+{
+    //2 hyperbolas + 1 parabola to approximate a gauss function
+    if (f < -0.5) {
+        f = -1. - f;
+
+        return (2. * f * f);
+    }
+
+    if (f < 0.5) {
+        return (1. - 2. * f * f);
+    }
+    f = 1. - f;
+
+    return (2. * f * f);
+}
+
+struct RenderStrokeCPUData
+{
+    double brushSizePixel;
+    double brushSpacing;
+    double brushHardness;
+    bool pressureAffectsOpacity;
+    bool pressureAffectsHardness;
+    bool pressureAffectsSize;
+    double opacity;
+
+    // The fall-off of the dots, computed when first needed: one per pressure level if the pressure affects the hardness
+    std::vector<std::vector<float> > falloffs;
+    std::vector<RotoShapeRenderCPU::StrokeDot> dots;
+};
+
+void
+renderStrokeBegin_cpu(RotoShapeRenderNodePrivate::RenderStrokeDataPtr userData,
+                      double brushSizePixel,
+                      double brushSpacing,
+                      double brushHardness,
+                      bool pressureAffectsOpacity,
+                      bool pressureAffectsHardness,
+                      bool pressureAffectsSize,
+                      bool /*buildUp*/,
+                      double /*shapeColor*/[3],
+                      double opacity)
+{
+    RenderStrokeCPUData* myData = (RenderStrokeCPUData*)userData;
+
+    myData->brushSizePixel = brushSizePixel;
+    myData->brushSpacing = brushSpacing;
+    myData->brushHardness = brushHardness;
+    myData->pressureAffectsOpacity = pressureAffectsOpacity;
+    myData->pressureAffectsHardness = pressureAffectsHardness;
+    myData->pressureAffectsSize = pressureAffectsSize;
+    myData->opacity = opacity;
+    myData->falloffs.clear();
+    myData->falloffs.resize(pressureAffectsHardness ? ROTO_PRESSURE_LEVELS : 1);
+}
+
+void
+renderStrokeEnd_cpu(RotoShapeRenderNodePrivate::RenderStrokeDataPtr /*userData*/)
+{
+}
+
+// Only records the dot: they are all rendered at once by renderStroke_cpu
+bool
+renderStrokeRenderDot_cpu(RotoShapeRenderNodePrivate::RenderStrokeDataPtr userData,
+                          const Point & /*prevCenter*/,
+                          const Point &center,
+                          double pressure,
+                          double* spacing)
+{
+    RenderStrokeCPUData* myData = (RenderStrokeCPUData*)userData;
+    double brushSizePixel = myData->brushSizePixel;
+    double brushHardness = myData->brushHardness;
+    double alpha = myData->opacity;
+    int level = 0;
+
+    if (myData->pressureAffectsSize) {
+        brushSizePixel *= pressure;
+    }
+    if (myData->pressureAffectsHardness) {
+        // sometimes, Qt gives a pressure level > 1... so we clamp it
+        level = int(std::max( 0., std::min(pressure, 1.) ) * (ROTO_PRESSURE_LEVELS - 1) + 0.5);
+        brushHardness *= (double)level / (ROTO_PRESSURE_LEVELS - 1);
+    }
+    if (myData->pressureAffectsOpacity) {
+        alpha *= pressure;
+    }
+
+    RotoShapeRenderCPU::StrokeDot dot;
+    dot.x = center.x;
+    dot.y = center.y;
+    dot.internalRadius = std::max(brushSizePixel * brushHardness, 1.) / 2.;
+    dot.externalRadius = std::max(brushSizePixel, 1.) / 2.;
+    // Like the Cairo renderer, dots without fall-off ignore the pressure
+    dot.alpha = (float)(brushHardness != 1. ? alpha : myData->opacity);
+    *spacing = dot.externalRadius * 2. * myData->brushSpacing;
+
+    std::vector<float>& falloff = myData->falloffs[level];
+    if ( falloff.empty() ) {
+        RotoShapeRenderCPU::computeDotFalloff(brushHardness, &falloff);
+    }
+    dot.falloff = &falloff.front();
+    myData->dots.push_back(dot);
+
+    return true;
+}
+
+struct RenderStrokeArgs
+{
+    double shapeColor[3];
+    bool doBuildUp;
+    bool isDuringPainting;
+
+    // The pixel at the bottom-left corner of the RoI in the destination image
+    float* dstPixels;
+    int dstY1;
+    std::size_t dstRowElements;
+    int dstNComps;
+};
+
+void
+renderStrokeTile(const RenderStrokeArgs* args,
+                 const std::vector<RotoShapeRenderCPU::StrokeDot>* dots,
+                 const RectI& tile)
+{
+    std::vector<float> coverage( (std::size_t)tile.width() * tile.height(), 0.f );
+    float* dstPixels = args->dstPixels + (std::size_t)(tile.y1 - args->dstY1) * args->dstRowElements;
+
+    if (args->isDuringPainting) {
+        readCoverage(dstPixels, args->dstRowElements, args->dstNComps, args->shapeColor, tile, &coverage.front());
+    }
+    RotoShapeRenderCPU::renderDots_cpu(*dots, args->doBuildUp, tile, &coverage.front());
+    writeCoverage(&coverage.front(), tile, args->shapeColor, 1., dstPixels, args->dstRowElements, args->dstNComps);
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+RotoShapeRenderCPU::renderCoverage_cpu(const RotoBezierTriangulation::PolygonData& data,
+                                       RampTypeEnum type,
+                                       double fallOff,
+                                       const RectI& tile,
+                                       float* coverage,
+                                       std::vector<float>* accumulation)
+{
+    if ( tile.isNull() ) {
+        return;
+    }
+    if ( !data.bezierPolygonJoined.empty() ) {
+        renderInternalShape(data.bezierPolygonJoined, tile, coverage, accumulation);
+    }
+    renderFeather(data.featherMesh, type, fallOff, tile, coverage);
+}
+
+void
+RotoShapeRenderCPU::renderBezier_cpu(const Bezier* bezier,
+                                     double opacity,
+                                     double time,
+                                     double startTime,
+                                     double endTime,
+                                     double mbFrameStep,
+                                     unsigned int mipmapLevel,
+                                     const RectI& roi,
+                                     const ImagePtr& dstImage)
+{
+    assert(dstImage->getBitDepth() == eImageBitDepthFloat);
+    if ( roi.isNull() ) {
+        return;
+    }
+
+    RenderBezierArgs args;
+    args.type = (RampTypeEnum)bezier->getFallOffRampTypeKnob()->getValue();
+    bezier->getColor(time, args.shapeColor);
+    args.opacity = opacity;
+    for (double t = startTime; t <= endTime; t += mbFrameStep) {
+        double featherDist = bezier->getFeatherDistance(t);
+
+        ///Adjust the feather distance so it takes the mipmap level into account
+        if (mipmapLevel != 0) {
+            featherDist /= (1 << mipmapLevel);
+        }
+
+        PolygonDataPtr data(new RotoBezierTriangulation::PolygonData);
+        RotoBezierTriangulation::computeTriangles(bezier, t, mipmapLevel, featherDist, data.get(), false);
+        args.samples.push_back(data);
+        args.fallOffs.push_back( bezier->getFeatherFallOff(t) );
+    }
+    if ( args.samples.empty() ) {
+        return;
+    }
+
+    // The tiles write to separate rows of the image: the lock is taken once for all of them
+    Image::WriteAccess acc( dstImage.get() );
+    args.dstPixels = (float*)acc.pixelAt(roi.x1, roi.y1);
+    assert(args.dstPixels);
+    args.dstRowElements = dstImage->getRowElements();
+    args.dstNComps = (int)dstImage->getComponentsCount();
+
+    std::vector<RectI> tiles;
+    for (int y = roi.y1; y < roi.y2; y += ROTO_SHAPE_RENDER_CPU_TILE_ROWS) {
+        tiles.push_back( RectI( roi.x1, y, roi.x2, std::min(y + ROTO_SHAPE_RENDER_CPU_TILE_ROWS, roi.y2) ) );
+    }
+    std::vector<TaskScheduler::Task> tasks;
+    std::vector<RenderBezierArgs> tilesArgs( tiles.size(), args );
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        tilesArgs[i].dstPixels += (std::size_t)(tiles[i].y1 - roi.y1) * args.dstRowElements;
+        tasks.push_back( boost::bind(renderBezierTile, &tilesArgs[i], tiles[i]) );
+    }
+    if (tasks.size() == 1) {
+        tasks.front()();
+    } else {
+        appPTR->getTaskScheduler()->runAndWait(tasks);
+    }
+} // RotoShapeRenderCPU::renderBezier_cpu
+
+void
+RotoShapeRenderCPU::computeDotFalloff(double brushHardness,
+                                      std::vector<float>* falloff)
+{
+    falloff->resize(ROTO_SHAPE_RENDER_CPU_FALLOFF_SAMPLES);
+    if (brushHardness == 1.) {
+        std::fill(falloff->begin(), falloff->end(), 1.f);
+
+        return;
+    }
+
+    // The stops of the radial gradient of the Cairo renderer, which are linearly interpolated
+    const int maxStops = 8;
+    double stops[maxStops + 1];
+    const double exp = 0.4 / (1.0 - brushHardness);
+    for (int i = 0; i <= maxStops; ++i) {
+        stops[i] = hardnessGaussLookup( std::pow( (double)i / maxStops, exp ) );
+    }
+    for (int i = 0; i < ROTO_SHAPE_RENDER_CPU_FALLOFF_SAMPLES; ++i) {
+        double pos = (double)i / (ROTO_SHAPE_RENDER_CPU_FALLOFF_SAMPLES - 1) * maxStops;
+        int stop = std::min( (int)pos, maxStops - 1 );
+        double t = pos - stop;
+        (*falloff)[i] = (float)(stops[stop] * (1. - t) + stops[stop + 1] * t);
+    }
+}
+
+void
+RotoShapeRenderCPU::renderDots_cpu(const std::vector<StrokeDot>& dots,
+                                   bool doBuildUp,
+                                   const RectI& tile,
+                                   float* coverage)
+{
+    const int width = tile.width();
+    const float maxIndex = ROTO_SHAPE_RENDER_CPU_FALLOFF_SAMPLES - 1;
+
+#ifdef NATRON_USE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 maxIndexV = _mm_set1_ps(maxIndex);
+    const __m128 xOffsets = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+#endif
+
+    for (std::vector<StrokeDot>::const_iterator it = dots.begin(); it != dots.end(); ++it) {
+        const double radius = it->externalRadius;
+
+        // Pixels whose center lies in the dot, like the non antialiased fill of the Cairo renderer
+        const int yStart = std::max( tile.y1, (int)std::ceil(it->y - radius - 0.5) );
+        const int yEnd = std::min( tile.y2 - 1, (int)std::floor(it->y + radius - 0.5) );
+        if ( (yStart > yEnd) || (it->x + radius + 0.5 < tile.x1) || (it->x - radius - 0.5 >= tile.x2) ) {
+            continue;
+        }
+
+        // Index in the fall-off of a pixel at distance d from the center: (d - internalRadius) * scale
+        const double falloffWidth = it->externalRadius - it->internalRadius;
+        const float scale = falloffWidth > 0. ? (float)(maxIndex / falloffWidth) : 0.f;
+        const float internalRadius = (float)it->internalRadius;
+        const float alpha = it->alpha;
+        const float* falloff = it->falloff;
+
+        for (int y = yStart; y <= yEnd; ++y) {
+            const double dy = y + 0.5 - it->y;
+            const double halfSpan2 = radius * radius - dy * dy;
+            if (halfSpan2 < 0.) {
+                continue;
+            }
+            const double halfSpan = std::sqrt(halfSpan2);
+            const int xStart = std::max( tile.x1, (int)std::ceil(it->x - halfSpan - 0.5) );
+            const int xEnd = std::min( tile.x2 - 1, (int)std::floor(it->x + halfSpan - 0.5) );
+            const float dy2 = (float)(dy * dy);
+            float* dst = coverage + (y - tile.y1) * width + (xStart - tile.x1);
+            int x = xStart;
+
+#ifdef NATRON_USE_SSE2
+            const __m128 dy2V = _mm_set1_ps(dy2);
+            const __m128 internalRadiusV = _mm_set1_ps(internalRadius);
+            const __m128 scaleV = _mm_set1_ps(scale);
+            const __m128 alphaV = _mm_set1_ps(alpha);
+            for (; x + 3 <= xEnd; x += 4, dst += 4) {
+                __m128 dx = _mm_add_ps( _mm_set1_ps( (float)(x + 0.5 - it->x) ), xOffsets );
+                __m128 dist = _mm_sqrt_ps( _mm_add_ps(_mm_mul_ps(dx, dx), dy2V) );
+                __m128 index = _mm_mul_ps(_mm_sub_ps(dist, internalRadiusV), scaleV);
+                index = _mm_min_ps(_mm_max_ps(index, zero), maxIndexV);
+                int indices[4];
+                _mm_storeu_si128( (__m128i*)indices, _mm_cvttps_epi32( _mm_add_ps(index, half) ) );
+                __m128 value = _mm_mul_ps(_mm_set_ps(falloff[indices[3]], falloff[indices[2]], falloff[indices[1]], falloff[indices[0]]), alphaV);
+                __m128 prev = _mm_loadu_ps(dst);
+                if (doBuildUp) {
+                    // over
+                    _mm_storeu_ps( dst, _mm_add_ps( value, _mm_mul_ps( prev, _mm_sub_ps(one, value) ) ) );
+                } else {
+                    // lighten
+                    _mm_storeu_ps( dst, _mm_max_ps(prev, value) );
+                }
+            }
+#endif
+            for (; x <= xEnd; ++x, ++dst) {
+                const float dx = (float)(x + 0.5 - it->x);
+                const float dist = std::sqrt(dx * dx + dy2);
+                const float index = std::min( std::max( (dist - internalRadius) * scale, 0.f ), maxIndex );
+                const float value = falloff[(int)(index + 0.5f)] * alpha;
+                if (doBuildUp) {
+                    *dst = value + *dst * (1.f - value);
+                } else {
+                    *dst = std::max(*dst, value);
+                }
+            }
+        }
+    }
+} // RotoShapeRenderCPU::renderDots_cpu
+
+void
+RotoShapeRenderCPU::renderStroke_cpu(const RotoDrawableItem* item,
+                                     const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                     double distToNextIn,
+                                     const Point& lastCenterPointIn,
+                                     bool doBuildUp,
+                                     double opacity,
+                                     double time,
+                                     unsigned int mipmapLevel,
+                                     bool isDuringPainting,
+                                     const RectI& roi,
+                                     const ImagePtr& dstImage,
+                                     double* distToNextOut,
+                                     Point* lastCenterPointOut)
+{
+    assert(dstImage->getBitDepth() == eImageBitDepthFloat);
+
+    RenderStrokeCPUData data;
+    RotoShapeRenderNodePrivate::renderStroke_generic((RotoShapeRenderNodePrivate::RenderStrokeDataPtr)&data,
+                                                     renderStrokeBegin_cpu,
+                                                     renderStrokeRenderDot_cpu,
+                                                     renderStrokeEnd_cpu,
+                                                     strokes,
+                                                     distToNextIn,
+                                                     lastCenterPointIn,
+                                                     item,
+                                                     doBuildUp,
+                                                     opacity,
+                                                     time,
+                                                     mipmapLevel,
+                                                     distToNextOut,
+                                                     lastCenterPointOut);
+    if ( roi.isNull() ) {
+        return;
+    }
+
+    // Sort the dots in the bands of the RoI they intersect, keeping their order
+    const int nBands = (roi.height() + ROTO_SHAPE_RENDER_CPU_TILE_ROWS - 1) / ROTO_SHAPE_RENDER_CPU_TILE_ROWS;
+    std::vector<std::vector<StrokeDot> > bandsDots(nBands);
+    for (std::vector<StrokeDot>::const_iterator it = data.dots.begin(); it != data.dots.end(); ++it) {
+        const int y1 = std::max( roi.y1, (int)std::floor(it->y - it->externalRadius) );
+        const int y2 = std::min( roi.y2 - 1, (int)std::ceil(it->y + it->externalRadius) );
+        if ( (y1 > y2) || (it->x + it->externalRadius + 0.5 < roi.x1) || (it->x - it->externalRadius - 0.5 >= roi.x2) ) {
+            continue;
+        }
+        for (int band = (y1 - roi.y1) / ROTO_SHAPE_RENDER_CPU_TILE_ROWS; band <= (y2 - roi.y1) / ROTO_SHAPE_RENDER_CPU_TILE_ROWS; ++band) {
+            bandsDots[band].push_back(*it);
+        }
+    }
+
+    RenderStrokeArgs args;
+    item->getColor(time, args.shapeColor);
+    args.doBuildUp = doBuildUp;
+    args.isDuringPainting = isDuringPainting;
+
+    // The tiles write to separate rows of the image: the lock is taken once for all of them
+    Image::WriteAccess acc( dstImage.get() );
+    args.dstPixels = (float*)acc.pixelAt(roi.x1, roi.y1);
+    assert(args.dstPixels);
+    args.dstY1 = roi.y1;
+    args.dstRowElements = dstImage->getRowElements();
+    args.dstNComps = (int)dstImage->getComponentsCount();
+
+    std::vector<TaskScheduler::Task> tasks;
+    for (int band = 0; band < nBands; ++band) {
+        const int y = roi.y1 + band * ROTO_SHAPE_RENDER_CPU_TILE_ROWS;
+        RectI tile( roi.x1, y, roi.x2, std::min(y + ROTO_SHAPE_RENDER_CPU_TILE_ROWS, roi.y2) );
+        tasks.push_back( boost::bind(renderStrokeTile, &args, &bandsDots[band], tile) );
+    }
+    if (tasks.size() == 1) {
+        tasks.front()();
+    } else {
+        appPTR->getTaskScheduler()->runAndWait(tasks);
+    }
+} // RotoShapeRenderCPU::renderStroke_cpu
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,147 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef ROTOSHAPERENDERCPU_H
+#define ROTOSHAPERENDERCPU_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <list>
+#include <utility>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/EngineFwd.h"
+
+#include "Engine/RotoBezierTriangulation.h"
+#include "Engine/RotoShapeRenderGL.h"
+
+// Number of rows of the bands of the RoI rendered concurrently
+#define ROTO_SHAPE_RENDER_CPU_TILE_ROWS 32
+
+// Number of samples of the brush fall-off lookup table, from the internal to the external radius of a dot
+#define ROTO_SHAPE_RENDER_CPU_FALLOFF_SAMPLES 256
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Native rasterizer of closed Beziers and brush strokes, used by the CPU render of RotoShapeRenderNode: it does not need
+ * Cairo nor OSMesa.
+ *
+ * It renders the same geometry as the OpenGL renderer (see RotoBezierTriangulation):
+ * - The internal polygon is filled with the nonzero winding rule, like the Cairo renderer, with an exact area coverage of the
+ * pixels on its edges.
+ * - The feather triangles are sampled at the pixel centers: the coverage is interpolated from 1 on the internal polygon to 0 on the
+ * feather polygon, mapped through the ramp and raised to the power of the fall-off, and merged with the maximum of the coverage
+ * already rendered, like the GL_MAX blending of the OpenGL renderer.
+ *
+ * Strokes are rendered like the Cairo renderer did, one dot at a time: the radial gradient of a dot is precomputed once as a
+ * fall-off lookup table, and all the dots of the strokes are collected before being splatted, so that each band of the RoI only
+ * composites the dots that intersect it.
+ *
+ * The RoI is split in bands of rows which are rendered concurrently by the task scheduler.
+ **/
+class RotoShapeRenderCPU
+{
+public:
+
+    /**
+     * @brief A dot of a brush stroke, in pixel coordinates.
+     **/
+    struct StrokeDot
+    {
+        double x, y;
+        double internalRadius, externalRadius;
+        float alpha;
+
+        // ROTO_SHAPE_RENDER_CPU_FALLOFF_SAMPLES values of the opacity from the internal radius to the external radius
+        const float* falloff;
+    };
+
+    RotoShapeRenderCPU()
+    {
+    }
+
+    /**
+     * @brief Low level: rasterizes the triangulated bezier (computed without tessellating its internal shape) into the coverage buffer,
+     * which holds the rows of tile, from bottom to top. The buffer must be initialized by the caller, the coverage of the shape is
+     * merged with the maximum of its values.
+     * accumulation is a temporary buffer, which can be reused across calls to avoid allocations.
+     **/
+    static void renderCoverage_cpu(const RotoBezierTriangulation::PolygonData& data,
+                                   RampTypeEnum type,
+                                   double fallOff,
+                                   const RectI& tile,
+                                   float* coverage,
+                                   std::vector<float>* accumulation);
+
+    /**
+     * @brief High level: renders the given bezier, with its color at time and motion blur, into the roi of dstImage, whose depth must be float.
+     * The motion blur samples are averaged.
+     **/
+    static void renderBezier_cpu(const Bezier* bezier,
+                                 double opacity,
+                                 double time,
+                                 double startTime,
+                                 double endTime,
+                                 double mbFrameStep,
+                                 unsigned int mipmapLevel,
+                                 const RectI& roi,
+                                 const ImagePtr& dstImage);
+
+    /**
+     * @brief Computes the opacity of a dot with the given hardness from its internal radius to its external radius,
+     * with the same gradient as the Cairo renderer.
+     **/
+    static void computeDotFalloff(double brushHardness, std::vector<float>* falloff);
+
+    /**
+     * @brief Low level: composites the dots intersecting tile into the coverage buffer, which holds the rows of tile, from bottom to top.
+     * With build-up the dots are composited over each other, otherwise the maximum of their opacity is kept.
+     **/
+    static void renderDots_cpu(const std::vector<StrokeDot>& dots,
+                               bool doBuildUp,
+                               const RectI& tile,
+                               float* coverage);
+
+    /**
+     * @brief High level: renders the dots placed along the strokes (see RotoShapeRenderNodePrivate::renderStroke_generic) into the roi
+     * of dstImage, whose depth must be float. While painting, the dots are composited over the content of dstImage.
+     **/
+    static void renderStroke_cpu(const RotoDrawableItem* item,
+                                 const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                 double distToNextIn,
+                                 const Point& lastCenterPointIn,
+                                 bool doBuildUp,
+                                 double opacity,
+                                 double time,
+                                 unsigned int mipmapLevel,
+                                 bool isDuringPainting,
+                                 const RectI& roi,
+                                 const ImagePtr& dstImage,
+                                 double* distToNextOut,
+                                 Point* lastCenterPointOut);
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // ROTOSHAPERENDERCPU_H
@@ -35,6 +35,7 @@
 #include "Engine/RotoContext.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/RotoShapeRenderNodePrivate.h"
+#include "Engine/RotoShapeRenderCPU.h"
 #include "Engine/RotoShapeRenderCairo.h"
 #include "Engine/RotoShapeRenderGL.h"
 #include "Engine/ParallelRenderArgs.h"
@@ -70,6 +71,21 @@ RotoShapeRenderNode::canCPUImplementationSupportOSMesa() const
 #endif
 }
 
+bool
+RotoShapeRenderNode::shouldCacheOutput(bool isFrameVaryingOrAnimated,
+                                       double time,
+                                       ViewIdx view,
+                                       int visitsCount) const
+{
+    RotoDrawableItemPtr rotoItem = getNode()->getAttachedRotoItem();
+
+    if ( rotoItem && dynamic_cast<RotoStrokeItem*>( rotoItem.get() ) ) {
+        return true;
+    }
+
+    return EffectInstance::shouldCacheOutput(isFrameVaryingOrAnimated, time, view, visitsCount);
+}
+
 
 void
 RotoShapeRenderNode::addAcceptedComponents(int /*inputNb*/,
@@ -201,18 +217,6 @@ StatusEnum
 RotoShapeRenderNode::render(const RenderActionArgs& args)
 {
 
-#if !defined(ROTO_SHAPE_RENDER_ENABLE_CAIRO) && !defined(HAVE_OSMESA)
-    setPersistentMessage(eMessageTypeError, tr("Roto requires either OSMesa (CONFIG += enable-osmesa) or Cairo (CONFIG += enable-cairo) in order to render on CPU").toStdString());
-    return eStatusFailed;
-#endif
-
-#if !defined(ROTO_SHAPE_RENDER_ENABLE_CAIRO)
-    if (!args.useOpenGL) {
-        setPersistentMessage(eMessageTypeError, tr("An OpenGL context is required to draw with the Roto node. This might be because you are trying to render an image too big for OpenGL.").toStdString());
-        return eStatusFailed;
-    }
-#endif
-
     RotoDrawableItemPtr rotoItem = getNode()->getAttachedRotoItem();
     assert(rotoItem);
     if (!rotoItem) {
@@ -228,6 +232,22 @@ RotoShapeRenderNode::render(const RenderActionArgs& args)
         return eStatusFailed;
     }
 
+    // Solid shapes are rendered on CPU by RotoShapeRenderCPU, which needs neither Cairo nor OSMesa
+    const bool renderSolidCPU = !args.useOpenGL && type == eRotoShapeRenderTypeSolid;
+    if (!renderSolidCPU) {
+#if !defined(ROTO_SHAPE_RENDER_ENABLE_CAIRO) && !defined(HAVE_OSMESA)
+        setPersistentMessage(eMessageTypeError, tr("Roto requires either OSMesa (CONFIG += enable-osmesa) or Cairo (CONFIG += enable-cairo) in order to render smears on CPU").toStdString());
+        return eStatusFailed;
+#endif
+
+#if !defined(ROTO_SHAPE_RENDER_ENABLE_CAIRO)
+        if (!args.useOpenGL) {
+            setPersistentMessage(eMessageTypeError, tr("An OpenGL context is required to draw with the Roto node. This might be because you are trying to render an image too big for OpenGL.").toStdString());
+            return eStatusFailed;
+        }
+#endif
+    }
+
     // Check that the item is really activated... it should have been caught in isIdentity otherwise.
     assert(rotoItem->isActivated(args.time) && (!isBezier || (isBezier->isCurveFinished() && ( isBezier->getControlPointsCount() > 1 ))));
 
@@ -348,14 +368,18 @@ RotoShapeRenderNode::render(const RenderActionArgs& args)
             }
 #endif
 
-#ifdef ROTO_SHAPE_RENDER_ENABLE_CAIRO
-            if (!args.useOpenGL) {
-                RotoShapeRenderCairo::renderMaskInternal_cairo(rotoItem, args.roi, outputPlane.first, startTime, endTime, mbFrameStep, args.time, outputPlane.second->getBitDepth(), mipmapLevel, isDuringPainting, distNextIn, lastCenterIn, strokes, outputPlane.second, &distToNextOut, &lastCenterOut);
-                if (isDuringPainting) {
-                    getApp()->updateStrokeData(lastCenterOut, distToNextOut);
+            if (renderSolidCPU) {
+                double opacity = rotoItem->getOpacity(args.time);
+                if ( isBezier && !isBezier->isOpenBezier() ) {
+                    RotoShapeRenderCPU::renderBezier_cpu(isBezier, opacity, args.time, startTime, endTime, mbFrameStep, mipmapLevel, args.roi, outputPlane.second);
+                } else {
+                    bool doBuildUp = isStroke ? rotoItem->getBuildupKnob()->getValueAtTime(args.time) : true;
+                    RotoShapeRenderCPU::renderStroke_cpu(rotoItem.get(), strokes, distNextIn, lastCenterIn, doBuildUp, opacity, args.time, mipmapLevel, isDuringPainting, args.roi, outputPlane.second, &distToNextOut, &lastCenterOut);
+                    if (isDuringPainting) {
+                        getApp()->updateStrokeData(lastCenterOut, distToNextOut);
+                    }
                 }
             }
-#endif
             if (args.useOpenGL) {
                 double shapeColor[3];
                 rotoItem->getColor(args.time, shapeColor);
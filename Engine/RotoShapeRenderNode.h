@@ -155,6 +155,12 @@ public:
 
     virtual bool canCPUImplementationSupportOSMesa() const OVERRIDE FINAL WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Strokes are always cached so that their dots are only rendered again when the stroke changes,
+     * and not each time the frame changes or another stroke is painted.
+     **/
+    virtual bool shouldCacheOutput(bool isFrameVaryingOrAnimated, double time, ViewIdx view, int visitsCount) const OVERRIDE FINAL WARN_UNUSED_RETURN;
+
 private:
 
     virtual void initializeKnobs() OVERRIDE FINAL;
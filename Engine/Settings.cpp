@@ -330,6 +330,20 @@ Settings::initializeKnobsThreading()
     _numberOfParallelRenders->setMinimum(0);
     _numberOfParallelRenders->disableSlider();
     _threadingPage->addKnob(_numberOfParallelRenders);
+
+    _playbackReadAhead = AppManager::createKnob<KnobInt>( shared_from_this(), tr("Playback read-ahead (0=\"guess\")") );
+    _playbackReadAhead->setHintToolTip( tr("Maximum number of frames rendered ahead of the playhead during playback, in the playback direction. "
+                                           "Frames closest to the playhead are rendered first and frames that fall out of this window "
+                                           "when the playhead is moved are discarded. "
+                                           "A larger value smooths playback of graphs whose render time varies from frame to frame "
+                                           "at the expense of more RAM. "
+                                           "During playback the viewer displays the number of buffered frames next to the fps, "
+                                           "its tooltip shows the number of frames that were not rendered in time. "
+                                           "A value of 0 indicates that %1 should use 3 frames per CPU core.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
+    _playbackReadAhead->setName("playbackReadAhead");
+    _playbackReadAhead->setMinimum(0);
+    _playbackReadAhead->disableSlider();
+    _threadingPage->addKnob(_playbackReadAhead);
 #endif
 
     _useThreadPool = AppManager::createKnob<KnobBool>( shared_from_this(), tr("Effects use thread-pool") );
@@ -1306,6 +1320,36 @@ Settings::initializeKnobsCaching()
     _unreachableRAMLabel->setAsLabel();
     _cachingTab->addKnob(_unreachableRAMLabel);
 
+    _compressedCachePercent = AppManager::createKnob<KnobInt>( shared_from_this(), tr("Compressed memory cache (% of RAM cache)") );
+    _compressedCachePercent->setName("compressedCachePercent");
+    _compressedCachePercent->disableSlider();
+    _compressedCachePercent->setMinimum(0);
+    _compressedCachePercent->setMaximum(90);
+    _compressedCachePercent->setHintToolTip( tr("Images evicted from the RAM cache are kept compressed in RAM if they compress to half their size "
+                                                "or less, which is typically the case of mattes, roto shapes and images with large black areas. "
+                                                "They are decompressed when they are needed again, which is much faster than rendering them again.
+"
+                                                "This sets the maximum amount of RAM taken by the compressed images, in percentage of the RAM cache. "
+                                                "Set it to 0 to discard images evicted from the RAM cache without compressing them.") );
+    _cachingTab->addKnob(_compressedCachePercent);
+
+    _cacheEvictionPolicy = AppManager::createKnob<KnobChoice>( shared_from_this(), tr("RAM cache eviction policy") );
+    _cacheEvictionPolicy->setName("cacheEvictionPolicy");
+    {
+        std::vector<std::string> entries;
+        std::vector<std::string> helps;
+        assert(entries.size() == (int)eCacheEvictionPolicyLRU);
+        entries.push_back("LRU");
+        helps.push_back( tr("The least recently used images are evicted first.").toStdString() );
+        assert(entries.size() == (int)eCacheEvictionPolicy2Q);
+        entries.push_back("Scan resistant (2Q)");
+        helps.push_back( tr("Images used only once recently are evicted before the images used several times, so that "
+                            "playing back or tracking a long sequence does not evict the images of the frames being worked on.").toStdString() );
+        _cacheEvictionPolicy->populateChoices(entries, helps);
+    }
+    _cacheEvictionPolicy->setHintToolTip( tr("Select which images are evicted from the RAM cache first when it is full.") );
+    _cachingTab->addKnob(_cacheEvictionPolicy);
+
     _maxViewerDiskCacheGB = AppManager::createKnob<KnobInt>( shared_from_this(), tr("Maximum playback disk cache size (GiB)") );
     _maxViewerDiskCacheGB->setName("maxViewerDiskCache");
     _maxViewerDiskCacheGB->disableSlider();
@@ -1322,6 +1366,20 @@ Settings::initializeKnobsCaching()
     _maxDiskCacheNodeGB->setHintToolTip( tr("The maximum size that may be used by the DiskCache node on disk (in GiB)") );
     _cachingTab->addKnob(_maxDiskCacheNodeGB);
 
+    _cacheShardsCount = AppManager::createKnob<KnobInt>( shared_from_this(), tr("Cache lookup shards") );
+    _cacheShardsCount->setName("cacheShardsCount");
+    _cacheShardsCount->disableSlider();
+    _cacheShardsCount->setMinimum(0);
+    _cacheShardsCount->setMaximum(256);
+    _cacheShardsCount->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                          "The number of independently locked partitions each cache is split into. "
+                                          "With a single partition, all render threads share one lock when looking up "
+                                          "images in the cache, which may become a bottleneck on machines with many cores. "
+                                          "Each partition has its own least-recently-used list, hence eviction order is "
+                                          "only approximately least-recently-used across the whole cache when using more than 1 partition.\n"
+                                          "A value of 0 uses one partition per hardware thread.") );
+    _cachingTab->addKnob(_cacheShardsCount);
+
 
     _diskCachePath = AppManager::createKnob<KnobPath>( shared_from_this(), tr("Disk cache path (empty = default)") );
     _diskCachePath->setName("diskCachePath");
@@ -1500,6 +1558,7 @@ Settings::setDefaultValues()
     _osmesaRenderers->setDefaultValue(defaultMesaDriver);
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
     _numberOfParallelRenders->setDefaultValue(0, 0);
+    _playbackReadAhead->setDefaultValue(0, 0);
 #endif
     _nOpenGLContexts->setDefaultValue(2);
     _enableOpenGL->setDefaultValue((int)eEnableOpenGLEnabled);
@@ -1541,8 +1600,11 @@ Settings::setDefaultValues()
     _aggressiveCaching->setDefaultValue(false);
     _maxRAMPercent->setDefaultValue(50, 0);
     _unreachableRAMPercent->setDefaultValue(5);
+    _compressedCachePercent->setDefaultValue(25);
+    _cacheEvictionPolicy->setDefaultValue( (int)eCacheEvictionPolicyLRU );
     _maxViewerDiskCacheGB->setDefaultValue(5, 0);
     _maxDiskCacheNodeGB->setDefaultValue(10, 0);
+    _cacheShardsCount->setDefaultValue(1);
     setCachingLabels();
     _autoScroll->setDefaultValue(false);
     _autoTurbo->setDefaultValue(false);
@@ -2239,6 +2301,14 @@ Settings::onKnobValueChanged(const KnobIPtr& k,
             appPTR->setApplicationsCachesMaximumMemoryPercent( getRamMaximumPercent() );
         }
         setCachingLabels();
+    } else if ( k == _compressedCachePercent ) {
+        if (!_restoringSettings) {
+            appPTR->setApplicationsCachesMaximumCompressedPercent( getCompressedCachePercent() );
+        }
+    } else if ( k == _cacheEvictionPolicy ) {
+        if (!_restoringSettings) {
+            appPTR->setApplicationsCachesEvictionPolicy( getCacheEvictionPolicy() );
+        }
     } else if ( k == _diskCachePath ) {
         appPTR->setDiskCacheLocation( QString::fromUtf8( _diskCachePath->getValue().c_str() ) );
     } else if ( k == _wipeDiskCache ) {
@@ -2477,6 +2547,24 @@ Settings::getMaximumDiskCacheNodeSize() const
     return (U64)( _maxDiskCacheNodeGB->getValue() ) * std::pow(1024., 3.);
 }
 
+int
+Settings::getCacheShardsCount() const
+{
+    return _cacheShardsCount->getValue();
+}
+
+int
+Settings::getCompressedCachePercent() const
+{
+    return _compressedCachePercent->getValue();
+}
+
+CacheEvictionPolicyEnum
+Settings::getCacheEvictionPolicy() const
+{
+    return (CacheEvictionPolicyEnum)_cacheEvictionPolicy->getValue();
+}
+
 ///////////////////////////////////////////////////
 
 double
@@ -2998,6 +3086,18 @@ Settings::setNumberOfParallelRenders(int nb)
 #endif
 }
 
+int
+Settings::getPlaybackReadAheadFrames() const
+{
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+
+    return _playbackReadAhead->getValue();
+#else
+
+    return 0;
+#endif
+}
+
 bool
 Settings::areRGBPixelComponentsSupported() const
 {
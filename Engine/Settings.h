@@ -118,6 +118,12 @@ public:
 
     U64 getMaximumDiskCacheNodeSize() const;
 
+    int getCacheShardsCount() const;
+
+    int getCompressedCachePercent() const;
+
+    CacheEvictionPolicyEnum getCacheEvictionPolicy() const;
+
     double getUnreachableRamPercent() const;
 
     bool getColorPickerLinear() const;
@@ -130,6 +136,8 @@ public:
 
     void setNumberOfParallelRenders(int nb);
 
+    int getPlaybackReadAheadFrames() const;
+
     int getNumberOfThreadsPerEffect() const;
 
     bool useGlobalThreadPool() const;
@@ -432,6 +440,7 @@ private:
     KnobPagePtr _threadingPage;
     KnobIntPtr _numberOfThreads;
     KnobIntPtr _numberOfParallelRenders;
+    KnobIntPtr _playbackReadAhead;
     KnobBoolPtr _useThreadPool;
     KnobIntPtr _nThreadsPerEffect;
     KnobBoolPtr _renderInSeparateProcess;
@@ -507,9 +516,16 @@ private:
     KnobIntPtr _unreachableRAMPercent;
     KnobStringPtr _unreachableRAMLabel;
 
+    ///The maximum size of the images kept compressed in RAM once evicted from the RAM cache, in % of the RAM cache
+    KnobIntPtr _compressedCachePercent;
+    KnobChoicePtr _cacheEvictionPolicy;
+
     ///The total disk space allowed for all Natron's caches
     KnobIntPtr _maxViewerDiskCacheGB;
     KnobIntPtr _maxDiskCacheNodeGB;
+
+    ///The number of independently locked partitions of each cache, 0 means one per hardware thread
+    KnobIntPtr _cacheShardsCount;
     KnobPathPtr _diskCachePath;
     KnobButtonPtr _wipeDiskCache;
 
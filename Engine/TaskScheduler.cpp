@@ -0,0 +1,426 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TaskScheduler.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <deque>
+#include <new> // bad_alloc
+#include <stdexcept>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/RenderTrace.h"
+#include "Engine/ThreadPool.h"
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief The tasks passed to a single call of runAndWait().
+ * Each task may be referenced by the deque of a worker and by the waiting thread: whoever claims it first runs it.
+ **/
+struct TaskBatch
+{
+    std::vector<TaskScheduler::Task> tasks;
+    boost::scoped_array<QAtomicInt> claimed;
+    QAtomicInt remaining;
+    QMutex doneMutex;
+    QWaitCondition doneCond;
+
+    // The first exception thrown by a task, protected by doneMutex
+    bool failed;
+    bool failedWithBadAlloc;
+    std::string errorMessage;
+
+    TaskBatch(const std::vector<TaskScheduler::Task>& tasksToRun)
+        : tasks(tasksToRun)
+        , claimed( new QAtomicInt[tasksToRun.size()] )
+        , remaining( (int)tasksToRun.size() )
+        , doneMutex()
+        , doneCond()
+        , failed(false)
+        , failedWithBadAlloc(false)
+        , errorMessage()
+    {
+    }
+
+    void setFailed(bool badAlloc,
+                   const std::string& message)
+    {
+        QMutexLocker k(&doneMutex);
+
+        if (!failed) {
+            failed = true;
+            failedWithBadAlloc = badAlloc;
+            errorMessage = message;
+        }
+    }
+
+    /**
+     * @brief Runs the task at the given index if nobody took it yet. Returns true if it was run by this thread.
+     **/
+    bool tryRun(int index)
+    {
+        if ( !claimed[index].testAndSetOrdered(0, 1) ) {
+            return false;
+        }
+        try {
+            RenderTraceScope traceScope("task", "tile");
+            tasks[index]();
+        } catch (const std::bad_alloc& e) {
+            setFailed( true, e.what() );
+        } catch (const std::exception& e) {
+            setFailed( false, e.what() );
+        } catch (...) {
+            setFailed(false, "Unknown exception in a task of the TaskScheduler");
+        }
+        if ( !remaining.deref() ) {
+            QMutexLocker k(&doneMutex);
+            doneCond.wakeAll();
+        }
+
+        return true;
+    }
+};
+
+typedef boost::shared_ptr<TaskBatch> TaskBatchPtr;
+
+struct TaskItem
+{
+    TaskBatchPtr batch;
+    int index;
+};
+
+struct WorkerQueue
+{
+    QMutex mutex;
+    std::deque<TaskItem> items;
+};
+
+typedef boost::shared_ptr<WorkerQueue> WorkerQueuePtr;
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+class TaskSchedulerWorker;
+
+struct TaskSchedulerPrivate
+{
+    std::vector<WorkerQueuePtr> queues;
+    std::vector<TaskSchedulerWorker*> workers;
+
+    // Protects nQueued and mustQuit, idle workers sleep on sleepCond
+    QMutex sleepMutex;
+    QWaitCondition sleepCond;
+    int nQueued;
+    bool mustQuit;
+
+    // Workers whose index is greater or equal sleep and do not take tasks
+    QAtomicInt nActiveWorkers;
+
+    // Workers currently running a task
+    QAtomicInt nBusyWorkers;
+
+    // Where the tasks pushed by threads that are not workers start being distributed
+    QAtomicInt nextQueue;
+
+    TaskSchedulerPrivate()
+        : queues()
+        , workers()
+        , sleepMutex()
+        , sleepCond()
+        , nQueued(0)
+        , mustQuit(false)
+        , nActiveWorkers()
+        , nBusyWorkers()
+        , nextQueue()
+    {
+    }
+
+    int getCurrentWorkerIndex() const;
+
+    bool popOrSteal(int workerIndex, TaskItem* item);
+
+    void push(int workerIndex, const TaskBatchPtr& batch);
+
+    void workerLoop(int workerIndex);
+};
+
+class TaskSchedulerWorker
+    : public QThread
+      , public AbortableThread
+{
+public:
+
+    TaskSchedulerWorker(TaskSchedulerPrivate* scheduler,
+                        int index)
+        : QThread()
+        , AbortableThread(this)
+        , _scheduler(scheduler)
+        , _index(index)
+    {
+        setThreadName("Task Scheduler Worker");
+    }
+
+    virtual ~TaskSchedulerWorker() {}
+
+    TaskSchedulerPrivate* getScheduler() const
+    {
+        return _scheduler;
+    }
+
+    int getIndex() const
+    {
+        return _index;
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        _scheduler->workerLoop(_index);
+    }
+
+    TaskSchedulerPrivate* _scheduler;
+    int _index;
+};
+
+int
+TaskSchedulerPrivate::getCurrentWorkerIndex() const
+{
+    TaskSchedulerWorker* worker = dynamic_cast<TaskSchedulerWorker*>( QThread::currentThread() );
+
+    if ( !worker || (worker->getScheduler() != this) ) {
+        return -1;
+    }
+
+    return worker->getIndex();
+}
+
+bool
+TaskSchedulerPrivate::popOrSteal(int workerIndex,
+                                 TaskItem* item)
+{
+    bool found = false;
+    {
+        // Own tasks are taken from the back: the most recently pushed ones are the most likely to be hot in cache
+        WorkerQueue& own = *queues[workerIndex];
+        QMutexLocker k(&own.mutex);
+        if ( !own.items.empty() ) {
+            *item = own.items.back();
+            own.items.pop_back();
+            found = true;
+        }
+    }
+    // Steal the oldest task of the other workers
+    for (std::size_t i = 1; !found && i < queues.size(); ++i) {
+        WorkerQueue& victim = *queues[(workerIndex + i) % queues.size()];
+        QMutexLocker k(&victim.mutex);
+        if ( !victim.items.empty() ) {
+            *item = victim.items.front();
+            victim.items.pop_front();
+            found = true;
+        }
+    }
+    if (found) {
+        QMutexLocker k(&sleepMutex);
+        --nQueued;
+    }
+
+    return found;
+}
+
+void
+TaskSchedulerPrivate::push(int workerIndex,
+                           const TaskBatchPtr& batch)
+{
+    int nTasks = (int)batch->tasks.size();
+    // Only distribute to the active workers: they also steal from the deques of the inactive ones
+    int nQueues = std::max(1, (int)nActiveWorkers);
+
+    if (workerIndex != -1) {
+        WorkerQueue& own = *queues[workerIndex];
+        QMutexLocker k(&own.mutex);
+        for (int i = 0; i < nTasks; ++i) {
+            TaskItem item;
+            item.batch = batch;
+            item.index = i;
+            own.items.push_back(item);
+        }
+    } else {
+        unsigned int first = (unsigned int)nextQueue.fetchAndAddRelaxed(1);
+        for (int i = 0; i < nTasks; ++i) {
+            TaskItem item;
+            item.batch = batch;
+            item.index = i;
+            WorkerQueue& queue = *queues[(first + i) % (unsigned int)nQueues];
+            QMutexLocker k(&queue.mutex);
+            queue.items.push_back(item);
+        }
+    }
+
+    QMutexLocker k(&sleepMutex);
+    nQueued += nTasks;
+    if ( (nTasks >= nQueues) || ( (int)nActiveWorkers < (int)workers.size() ) ) {
+        // wakeOne() could wake an inactive worker which would go back to sleep
+        sleepCond.wakeAll();
+    } else {
+        for (int i = 0; i < nTasks; ++i) {
+            sleepCond.wakeOne();
+        }
+    }
+}
+
+void
+TaskSchedulerPrivate::workerLoop(int workerIndex)
+{
+    for (;;) {
+        TaskItem item;
+        if ( ( workerIndex < (int)nActiveWorkers ) && popOrSteal(workerIndex, &item) ) {
+            // The task may already have been run by the thread waiting on its batch, in which case this does nothing
+            nBusyWorkers.ref();
+            item.batch->tryRun(item.index);
+            nBusyWorkers.deref();
+            continue;
+        }
+
+        QMutexLocker k(&sleepMutex);
+        while ( ( (nQueued == 0) || ( workerIndex >= (int)nActiveWorkers ) ) && !mustQuit ) {
+            sleepCond.wait(&sleepMutex);
+        }
+        if (mustQuit) {
+            return;
+        }
+    }
+}
+
+TaskScheduler::TaskScheduler(int nWorkers)
+    : _imp( new TaskSchedulerPrivate() )
+{
+    _imp->nActiveWorkers.fetchAndStoreOrdered(nWorkers);
+    for (int i = 0; i < nWorkers; ++i) {
+        _imp->queues.push_back( WorkerQueuePtr( new WorkerQueue() ) );
+    }
+    for (int i = 0; i < nWorkers; ++i) {
+        TaskSchedulerWorker* worker = new TaskSchedulerWorker(_imp.get(), i);
+        _imp->workers.push_back(worker);
+        worker->start();
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        QMutexLocker k(&_imp->sleepMutex);
+        _imp->mustQuit = true;
+        _imp->sleepCond.wakeAll();
+    }
+    for (std::size_t i = 0; i < _imp->workers.size(); ++i) {
+        _imp->workers[i]->wait();
+        delete _imp->workers[i];
+    }
+}
+
+int
+TaskScheduler::getNumWorkers() const
+{
+    return (int)_imp->workers.size();
+}
+
+void
+TaskScheduler::setNumActiveWorkers(int nWorkers)
+{
+    nWorkers = std::max( 0, std::min(nWorkers, (int)_imp->workers.size()) );
+
+    QMutexLocker k(&_imp->sleepMutex);
+    _imp->nActiveWorkers.fetchAndStoreOrdered(nWorkers);
+    // Workers that became active may have tasks to take
+    _imp->sleepCond.wakeAll();
+}
+
+int
+TaskScheduler::getNumActiveWorkers() const
+{
+    return (int)_imp->nActiveWorkers;
+}
+
+int
+TaskScheduler::getNumBusyWorkers() const
+{
+    return (int)_imp->nBusyWorkers;
+}
+
+bool
+TaskScheduler::isWorkerThread() const
+{
+    return _imp->getCurrentWorkerIndex() != -1;
+}
+
+void
+TaskScheduler::runAndWait(const std::vector<Task>& tasks)
+{
+    if ( tasks.empty() ) {
+        return;
+    }
+    if ( (tasks.size() == 1) || ( (int)_imp->nActiveWorkers == 0 ) ) {
+        for (std::size_t i = 0; i < tasks.size(); ++i) {
+            tasks[i]();
+        }
+
+        return;
+    }
+
+    TaskBatchPtr batch( new TaskBatch(tasks) );
+    _imp->push(_imp->getCurrentWorkerIndex(), batch);
+
+    // Help with our own batch instead of blocking: start from the end, since thieves take tasks from the front
+    for (int i = (int)tasks.size() - 1; i >= 0; --i) {
+        batch->tryRun(i);
+    }
+
+    // All remaining tasks are being executed by other threads
+    QMutexLocker k(&batch->doneMutex);
+    while ( (int)batch->remaining > 0 ) {
+        RenderTraceScope traceScope("wait", "taskBatch");
+        batch->doneCond.wait(&batch->doneMutex);
+    }
+    if (batch->failed) {
+        if (batch->failedWithBadAlloc) {
+            throw std::bad_alloc();
+        }
+        throw std::runtime_error(batch->errorMessage);
+    }
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,109 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_TaskScheduler_h
+#define Natron_Engine_TaskScheduler_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief A work-stealing scheduler used to split a render into small independent tasks (tiles of an effect
+ * doing host frame threading, calls of the OpenFX multi-thread suite, viewer tiles).
+ *
+ * Each worker thread owns a deque of tasks: it pushes and pops its own tasks at the back and, when idle,
+ * steals tasks from the front of the other workers' deques.
+ * The thread calling runAndWait() does not sit idle while the batch runs: it executes the tasks of its
+ * own batch that were not taken yet, and only sleeps when all of them are being executed by other threads.
+ * A render thread that starts a nested render (e.g. a tile that renders an upstream node) thus always makes
+ * progress on its own tasks, which cannot deadlock even when all the workers are busy.
+ *
+ * A thread that is waiting on a batch never executes tasks of another batch, so that the thread-local
+ * storage of the render it is waiting on is never clobbered.
+ **/
+struct TaskSchedulerPrivate;
+class TaskScheduler
+{
+public:
+
+    typedef boost::function0<void> Task;
+
+    /**
+     * @brief Creates a scheduler with nWorkers threads, which are all active. With 0 workers all tasks are run by the calling thread.
+     **/
+    explicit TaskScheduler(int nWorkers);
+
+    ~TaskScheduler();
+
+    int getNumWorkers() const;
+
+    /**
+     * @brief Limits the number of workers running tasks, e.g. to honour the number of render threads of the settings.
+     * The other workers sleep until the limit is raised again. The value is clamped to [0, getNumWorkers()].
+     * With 0 active workers all tasks are run by the calling thread.
+     **/
+    void setNumActiveWorkers(int nWorkers);
+
+    int getNumActiveWorkers() const;
+
+    /**
+     * @brief Returns the number of workers currently running a task. When it reaches getNumActiveWorkers(), tasks
+     * passed to runAndWait() are mostly run by the calling thread.
+     **/
+    int getNumBusyWorkers() const;
+
+    /**
+     * @brief Runs all the given tasks, possibly concurrently, and returns once they have all finished.
+     * If the calling thread is a worker of this scheduler, the tasks are pushed on its own deque, otherwise
+     * they are distributed across the deques of the active workers.
+     * If a task throws, the other tasks are still run and the exception is reported to the caller once they all finished:
+     * std::bad_alloc is thrown again as is, any other exception is thrown as a std::runtime_error with the same message.
+     **/
+    void runAndWait(const std::vector<Task>& tasks);
+
+    /**
+     * @brief Returns true if the calling thread is one of the workers of this scheduler.
+     **/
+    bool isWorkerThread() const;
+
+private:
+
+    boost::scoped_ptr<TaskSchedulerPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_TaskScheduler_h
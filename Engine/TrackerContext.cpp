@@ -32,6 +32,7 @@ CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QWaitCondition>
 #include <QtCore/QThread>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
@@ -48,6 +49,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/Transform.h"
 #include "Engine/TrackMarker.h"
 #include "Engine/TrackerContextPrivate.h"
+#include "Engine/TrackerFrameAccessor.h"
 #include "Engine/TrackerSerialization.h"
 #include "Engine/ViewerInstance.h"
 
@@ -1668,6 +1670,18 @@ TrackArgs::getEnabledChannels(bool* r,
     _imp->fa->getEnabledChannels(r, g, b);
 }
 
+void
+TrackArgs::prefetchFrames(int time) const
+{
+    _imp->fa->prefetchFrames(time, _imp->step, _imp->end);
+}
+
+TrackerPrefetchStats
+TrackArgs::getPrefetchStats() const
+{
+    return _imp->fa->getPrefetchStats();
+}
+
 void
 TrackArgs::getRedrawAreasNeeded(int time,
                                 std::list<RectD>* canonicalRects) const
@@ -1873,6 +1887,9 @@ TrackScheduler::threadLoopOnce(const ThreadStartArgsPtr& inArgs)
 
 
         while (cur != end) {
+            // Decode the next frames while the tracks are computed on this one
+            args->prefetchFrames(cur);
+
             ///Launch parallel thread for each track using the global thread pool
             QFuture<bool> future = QtConcurrent::mapped( trackIndexes,
                                                          boost::bind(&TrackSchedulerPrivate::trackStepFunctor,
@@ -1957,6 +1974,15 @@ TrackScheduler::threadLoopOnce(const ThreadStartArgsPtr& inArgs)
             }
         } // while (cur != end) {
     } // IsTrackingFlagSetter_RAII
+
+#ifdef TRACE_LIB_MV
+    TrackerPrefetchStats prefetchStats = args->getPrefetchStats();
+    qDebug() << QThread::currentThread() << "TrackScheduler:" << "Tracked" << std::abs(lastValidFrame - start) / std::max(1, std::abs(frameStep)) + 1
+             << "frames:" << prefetchStats.getHitRate() * 100. << "% of the images were prefetched (" << prefetchStats.hits << "prefetched,"
+             << prefetchStats.misses << "rendered when requested)," << prefetchStats.framesPrefetched << "frames prefetched,"
+             << prefetchStats.stallTime << "s spent waiting for frames being prefetched";
+#endif
+
     TrackerContext* isContext = dynamic_cast<TrackerContext*>(_imp->paramsProvider);
     if (isContext) {
         isContext->solveTransformParams();
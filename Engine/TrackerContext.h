@@ -431,6 +431,7 @@ private:
     boost::scoped_ptr<TrackerContextPrivate> _imp;
 };
 
+struct TrackerPrefetchStats;
 struct TrackArgsPrivate;
 class TrackArgs
     : public GenericThreadStartArgs
@@ -477,6 +478,16 @@ public:
 
     void getEnabledChannels(bool* r, bool* g, bool* b) const;
 
+    /**
+     * @brief Starts rendering in the background the frames following time that the tracks will need
+     **/
+    void prefetchFrames(int time) const;
+
+    /**
+     * @brief Returns how often the images requested by the tracks were prefetched since the track operation started
+     **/
+    TrackerPrefetchStats getPrefetchStats() const;
+
     void getRedrawAreasNeeded(int time, std::list<RectD>* canonicalRects) const;
 
 private:
@@ -2021,9 +2021,10 @@ TrackerContextPrivate::computeCornerParamsFromTracksEnd(double refTime,
     }
 
     // Create temporary curves and clone the toPoint internal curves at once because setValueAtTime will be slow since it emits
-    // signals to create keyframes in keyframeSet
-    Curve tmpToPointsCurveX[4], tmpToPointsCurveY[4];
-    Curve tmpFittingErrorCurve;
+    // signals to create keyframes in keyframeSet. The keyframes are added to the temporary curves at once as well, so that
+    // derivatives are computed once per keyframe
+    std::list<KeyFrame> toPointsKeysX[4], toPointsKeysY[4];
+    std::list<KeyFrame> fittingErrorKeys;
     bool mustShowFittingWarn = false;
     for (QList<CornerPinData>::const_iterator itResults = validResults.begin(); itResults != validResults.end(); ++itResults) {
         const CornerPinData& dataAtTime = *itResults;
@@ -2033,7 +2034,7 @@ TrackerContextPrivate::computeCornerParamsFromTracksEnd(double refTime,
             if (dataAtTime.rms >= maxFittingError) {
                 mustShowFittingWarn = true;
             }
-            tmpFittingErrorCurve.addKeyFrame(kf);
+            fittingErrorKeys.push_back(kf);
         }
 
         if (smoothJitter > 1) {
@@ -2113,8 +2114,8 @@ TrackerContextPrivate::computeCornerParamsFromTracksEnd(double refTime,
                 for (int c = 0; c < 4; ++c) {
                     KeyFrame kx(dataAtTime.time, avgTos[c].x);
                     KeyFrame ky(dataAtTime.time, avgTos[c].y);
-                    tmpToPointsCurveX[c].addKeyFrame(kx);
-                    tmpToPointsCurveY[c].addKeyFrame(ky);
+                    toPointsKeysX[c].push_back(kx);
+                    toPointsKeysY[c].push_back(ky);
                 }
             }
         } else {
@@ -2123,15 +2124,20 @@ TrackerContextPrivate::computeCornerParamsFromTracksEnd(double refTime,
                 toPoint = applyHomography(refFrom[c], dataAtTime.h);
                 KeyFrame kx(dataAtTime.time, toPoint.x);
                 KeyFrame ky(dataAtTime.time, toPoint.y);
-                tmpToPointsCurveX[c].addKeyFrame(kx);
-                tmpToPointsCurveY[c].addKeyFrame(ky);
+                toPointsKeysX[c].push_back(kx);
+                toPointsKeysY[c].push_back(ky);
                 //toPoints[c]->setValuesAtTime(dataAtTime[i].time, toPoint.x, toPoint.y, ViewSpec::all(), eValueChangedReasonNatronInternalEdited);
             }
         }
     } // for (std::size_t i = 0; i < dataAtTime.size(); ++i)
     fittingWarningKnob->setSecret(!mustShowFittingWarn);
+    Curve tmpToPointsCurveX[4], tmpToPointsCurveY[4];
+    Curve tmpFittingErrorCurve;
+    tmpFittingErrorCurve.addKeyFrames(fittingErrorKeys);
     fittingErrorKnob->cloneCurve( ViewSpec::all(), 0, tmpFittingErrorCurve);
     for (int c = 0; c < 4; ++c) {
+        tmpToPointsCurveX[c].addKeyFrames(toPointsKeysX[c]);
+        tmpToPointsCurveY[c].addKeyFrames(toPointsKeysY[c]);
         toPointsKnob[c]->cloneCurve(ViewSpec::all(), 0, tmpToPointsCurveX[c]);
         toPointsKnob[c]->cloneCurve(ViewSpec::all(), 1, tmpToPointsCurveY[c]);
     }
@@ -2249,7 +2255,7 @@ TrackerContextPrivate::computeTransformParamsFromTracksEnd(double refTime,
     animatedKnobsChanged.push_back(fittingErrorKnob);
 
 
-    Curve tmpTXCurve, tmpTYCurve, tmpRotateCurve, tmpScaleCurve, tmpFittingErrorCurve;
+    std::list<KeyFrame> txKeys, tyKeys, rotateKeys, scaleKeys, fittingErrorKeys;
     bool mustShowFittingWarn = false;
     for (QList<TransformData>::const_iterator itResults = validResults.begin(); itResults != validResults.end(); ++itResults) {
         const TransformData& dataAtTime = *itResults;
@@ -2258,7 +2264,7 @@ TrackerContextPrivate::computeTransformParamsFromTracksEnd(double refTime,
             if (dataAtTime.rms >= maxFittingError) {
                 mustShowFittingWarn = true;
             }
-            tmpFittingErrorCurve.addKeyFrame(kf);
+            fittingErrorKeys.push_back(kf);
         }
 
         if (smoothTJitter > 1) {
@@ -2315,15 +2321,15 @@ TrackerContextPrivate::computeTransformParamsFromTracksEnd(double refTime,
             }
             KeyFrame kx(dataAtTime.time, avgT.x);
             KeyFrame ky(dataAtTime.time, avgT.y);
-            tmpTXCurve.addKeyFrame(kx);
-            tmpTYCurve.addKeyFrame(ky);
+            txKeys.push_back(kx);
+            tyKeys.push_back(ky);
             //translationKnob->setValueAtTime(dataAtTime[i].time, avgT.x, ViewSpec::all(), 0);
             //translationKnob->setValueAtTime(dataAtTime[i].time, avgT.y, ViewSpec::all(), 1);
         } else {
             KeyFrame kx(dataAtTime.time, dataAtTime.translation.x);
             KeyFrame ky(dataAtTime.time, dataAtTime.translation.y);
-            tmpTXCurve.addKeyFrame(kx);
-            tmpTYCurve.addKeyFrame(ky);
+            txKeys.push_back(kx);
+            tyKeys.push_back(ky);
             //translationKnob->setValueAtTime(dataAtTime[i].time, dataAtTime[i].data.translation.x, ViewSpec::all(), 0);
             //translationKnob->setValueAtTime(dataAtTime[i].time, dataAtTime[i].data.translation.y, ViewSpec::all(), 1);
         }
@@ -2382,7 +2388,7 @@ TrackerContextPrivate::computeTransformParamsFromTracksEnd(double refTime,
             if (nSamples) {
                 avg /= nSamples;
                 KeyFrame k(dataAtTime.time, avg);
-                tmpRotateCurve.addKeyFrame(k);
+                rotateKeys.push_back(k);
             }
 
 
@@ -2390,7 +2396,7 @@ TrackerContextPrivate::computeTransformParamsFromTracksEnd(double refTime,
         } else {
             if (dataAtTime.hasRotationAndScale) {
                 KeyFrame k(dataAtTime.time, dataAtTime.rotation);
-                tmpRotateCurve.addKeyFrame(k);
+                rotateKeys.push_back(k);
 
                 //  rotationKnob->setValueAtTime(dataAtTime[i].time, dataAtTime[i].data.rotation, ViewSpec::all(), 0);
             }
@@ -2450,19 +2456,26 @@ TrackerContextPrivate::computeTransformParamsFromTracksEnd(double refTime,
                 avg /= nSamples;
 
                 KeyFrame k(dataAtTime.time, avg);
-                tmpScaleCurve.addKeyFrame(k);
+                scaleKeys.push_back(k);
                 //scaleKnob->setValueAtTime(dataAtTime[i].time, avg, ViewSpec::all(), 0);
             }
         } else {
             if (dataAtTime.hasRotationAndScale) {
                 KeyFrame k(dataAtTime.time, dataAtTime.scale);
-                tmpScaleCurve.addKeyFrame(k);
+                scaleKeys.push_back(k);
                 //scaleKnob->setValueAtTime(dataAtTime[i].time, dataAtTime[i].data.scale, ViewSpec::all(), 0);
             }
         }
     } // for (std::size_t i = 0; i < dataAtTime.size(); ++i)
 
     fittingWarningKnob->setSecret(!mustShowFittingWarn);
+    // Add the keyframes at once so that derivatives are computed once per keyframe
+    Curve tmpTXCurve, tmpTYCurve, tmpRotateCurve, tmpScaleCurve, tmpFittingErrorCurve;
+    tmpFittingErrorCurve.addKeyFrames(fittingErrorKeys);
+    tmpTXCurve.addKeyFrames(txKeys);
+    tmpTYCurve.addKeyFrames(tyKeys);
+    tmpRotateCurve.addKeyFrames(rotateKeys);
+    tmpScaleCurve.addKeyFrames(scaleKeys);
     fittingErrorKnob->cloneCurve(ViewSpec::all(), 0, tmpFittingErrorCurve);
     translationKnob->cloneCurve(ViewSpec::all(), 0, tmpTXCurve);
     translationKnob->cloneCurve(ViewSpec::all(), 1, tmpTYCurve);
@@ -24,6 +24,11 @@
 
 #include "TrackerFrameAccessor.h"
 
+#include <algorithm> // min, max
+#include <cstring> // memcpy
+#include <list>
+#include <map>
+
 GCC_DIAG_OFF(unused-function)
 GCC_DIAG_OFF(unused-parameter)
 #include <libmv/image/array_nd.h>
@@ -33,6 +38,9 @@ GCC_DIAG_ON(unused-function)
 GCC_DIAG_ON(unused-parameter)
 
 #include <QtCore/QDebug>
+#include <QtCore/QWaitCondition>
+#include <QFuture>
+#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 
 #include "Engine/AbortableRenderInfo.h"
 #include "Engine/AppInstance.h"
@@ -41,6 +49,7 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/EffectInstance.h"
 #include "Engine/Image.h"
 #include "Engine/Node.h"
+#include "Engine/Timer.h"
 #include "Engine/TrackerContext.h"
 
 NATRON_NAMESPACE_ENTER;
@@ -121,6 +130,53 @@ struct FrameAccessorCacheEntry
 
 typedef std::multimap<FrameAccessorCacheKey, FrameAccessorCacheEntry, CacheKey_compare_less > FrameAccessorCache;
 
+/**
+ * @brief A frame rendered ahead of time by the prefetcher, in a region enclosing the images the tracks are expected to request.
+ **/
+struct PrefetchedFrame
+{
+    enum StateEnum
+    {
+        // Waiting for a thread of the pool
+        eStateQueued,
+
+        // Being rendered, either by the prefetcher or by the track that requested it first
+        eStateRendering,
+
+        eStateDone
+    };
+
+    FrameAccessorCacheKey key;
+
+    // The region that was requested, and the bounds of the image which were rendered (the region clipped to the source image)
+    RectI roi;
+    RectI bounds;
+
+    // Null if the render failed
+    boost::shared_ptr<MvFloatImage> image;
+    StateEnum state;
+};
+
+typedef boost::shared_ptr<PrefetchedFrame> PrefetchedFramePtr;
+
+// Copies the pixels of bounds from the image src, whose bounds are srcBounds
+void
+copyMvFloatImage(const MvFloatImage& src,
+                 const RectI& srcBounds,
+                 const RectI& bounds,
+                 MvFloatImage& dst)
+{
+    assert( srcBounds.contains(bounds) );
+    const int srcWidth = srcBounds.width();
+    const float* srcPixels = src.Data() + (bounds.y1 - srcBounds.y1) * srcWidth + (bounds.x1 - srcBounds.x1);
+    float* dstPixels = dst.Data();
+    const int width = bounds.width();
+
+    for (int y = 0; y < bounds.height(); ++y, srcPixels += srcWidth, dstPixels += width) {
+        std::memcpy( dstPixels, srcPixels, width * sizeof(float) );
+    }
+}
+
 
 template <bool doR, bool doG, bool doB>
 void
@@ -212,6 +268,21 @@ struct TrackerFrameAccessorPrivate
     bool enabledChannels[3];
     int formatHeight;
 
+    // Protects all fields below
+    mutable QMutex prefetchMutex;
+
+    // Signaled when a prefetched frame is done
+    QWaitCondition prefetchDone;
+    std::list<PrefetchedFramePtr> prefetchedFrames;
+    std::list<QFuture<void> > prefetchFutures;
+
+    // For each mipmap level, the union of the regions requested since the last call to prefetchFrames
+    std::map<int, RectI> requestedRegions;
+
+    // The largest width or height of these regions
+    int requestedRegionsMaxSize;
+    TrackerPrefetchStats prefetchStats;
+
     TrackerFrameAccessorPrivate(const TrackerContext* context,
                                 bool enabledChannels[3],
                                 int formatHeight)
@@ -221,6 +292,13 @@ struct TrackerFrameAccessorPrivate
         , cache()
         , enabledChannels()
         , formatHeight(formatHeight)
+        , prefetchMutex()
+        , prefetchDone()
+        , prefetchedFrames()
+        , prefetchFutures()
+        , requestedRegions()
+        , requestedRegionsMaxSize(0)
+        , prefetchStats()
     {
         trackerInput = context->getNode()->getInput(0);
         assert(trackerInput);
@@ -228,8 +306,226 @@ struct TrackerFrameAccessorPrivate
             this->enabledChannels[i] = enabledChannels[i];
         }
     }
+
+    /**
+     * @brief Renders the input of the tracker in roi (or in its full region of definition if fullImage is true) and converts it
+     * to a MONO image. This may be called from any thread.
+     **/
+    bool renderImage(int frame,
+                     int downscale,
+                     bool fullImage,
+                     RectI roi,
+                     boost::shared_ptr<MvFloatImage>* image,
+                     RectI* bounds);
+
+    void prefetchFrame(const PrefetchedFramePtr& prefetched);
+
+    /**
+     * @brief Returns in prefetched the frame rendered ahead of time which contains roi, waiting for it if it is still being rendered.
+     * Returns false if there is none.
+     **/
+    bool getPrefetchedFrame(const FrameAccessorCacheKey& key,
+                            const RectI& roi,
+                            PrefetchedFramePtr* prefetched);
 };
 
+bool
+TrackerFrameAccessorPrivate::renderImage(int frame,
+                                         int downscale,
+                                         bool fullImage,
+                                         RectI roi,
+                                         boost::shared_ptr<MvFloatImage>* image,
+                                         RectI* bounds)
+{
+    EffectInstancePtr effect;
+    if (trackerInput) {
+        effect = trackerInput->getEffectInstance();
+    }
+    if (!effect) {
+        return false;
+    }
+
+    // Not in accessor cache, call renderRoI
+    RenderScale scale;
+    scale.y = scale.x = Image::getScaleFromMipMapLevel( (unsigned int)downscale );
+
+
+    RectD precomputedRoD;
+    if (fullImage) {
+        bool isProjectFormat;
+        StatusEnum stat = effect->getRegionOfDefinition_public(trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
+        if (stat == eStatusFailed) {
+            return false;
+        }
+        double par = effect->getAspectRatio(-1);
+        precomputedRoD.toPixelEnclosing( (unsigned int)downscale, par, &roi );
+    }
+
+    std::list<ImageComponents> components;
+    components.push_back( ImageComponents::getRGBComponents() );
+
+    NodePtr node = context->getNode();
+    const bool isRenderUserInteraction = true;
+    const bool isSequentialRender = false;
+    AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(false, 0);
+    AbortableThread* isAbortable = dynamic_cast<AbortableThread*>( QThread::currentThread() );
+    if (isAbortable) {
+        isAbortable->setAbortInfo( isRenderUserInteraction, abortInfo, node->getEffectInstance() );
+    }
+
+
+    ParallelRenderArgsSetter::CtorArgsPtr tlsArgs(new ParallelRenderArgsSetter::CtorArgs);
+    tlsArgs->time = frame;
+    tlsArgs->view = ViewIdx(0);
+    tlsArgs->isRenderUserInteraction = isRenderUserInteraction;
+    tlsArgs->isSequential = isSequentialRender;
+    tlsArgs->abortInfo = abortInfo;
+    tlsArgs->treeRoot = node;
+    tlsArgs->textureIndex = 0;
+    tlsArgs->timeline = node->getApp()->getTimeLine();
+    tlsArgs->activeRotoPaintNode = NodePtr();
+    tlsArgs->activeRotoDrawableItem = RotoDrawableItemPtr();
+    tlsArgs->isDoingRotoNeatRender = false;
+    tlsArgs->isAnalysis = true;
+    tlsArgs->draftMode = false;
+    tlsArgs->stats = RenderStatsPtr();
+    ParallelRenderArgsSetter frameRenderArgs(tlsArgs); // Stats
+    EffectInstance::RenderRoIArgs args( frame,
+                                        scale,
+                                        downscale,
+                                        ViewIdx(0),
+                                        false,
+                                        roi,
+                                        precomputedRoD,
+                                        components,
+                                        eImageBitDepthFloat,
+                                        true,
+                                        context->getNode()->getEffectInstance(),
+                                        eStorageModeRAM /*returnOpenGLTex*/,
+                                        frame);
+    std::map<ImageComponents, ImagePtr> planes;
+    EffectInstance::RenderRoIRetCode stat = effect->renderRoI(args, &planes);
+    if ( (stat != EffectInstance::eRenderRoIRetCodeOk) || planes.empty() ) {
+#ifdef TRACE_LIB_MV
+        qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Failed to call renderRoI on input at frame" << frame << "with RoI x1="
+                 << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2;
+#endif
+
+        return false;
+    }
+
+    assert( !planes.empty() );
+    const ImagePtr& sourceImage = planes.begin()->second;
+    RectI sourceBounds = sourceImage->getBounds();
+    RectI intersectedRoI;
+    if ( !roi.intersect(sourceBounds, &intersectedRoI) ) {
+#ifdef TRACE_LIB_MV
+        qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "RoI does not intersect the source image bounds (RoI x1="
+                 << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2 << ")";
+#endif
+
+        return false;
+    }
+
+#ifdef TRACE_LIB_MV
+    qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "renderRoi (frame" << frame << ") OK  (BOUNDS= x1="
+             << sourceBounds.x1 << "y1=" << sourceBounds.y1 << "x2=" << sourceBounds.x2 << "y2=" << sourceBounds.y2 << ") (ROI = " << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2 << ")";
+#endif
+
+    /*
+       Copy the Natron image to the LivMV float image
+     */
+    image->reset( new MvFloatImage( intersectedRoI.height(), intersectedRoI.width() ) );
+    *bounds = intersectedRoI;
+    natronImageToLibMvFloatImage(enabledChannels,
+                                 sourceImage.get(),
+                                 intersectedRoI,
+                                 **image);
+    // we ignore the transform parameter and do it in natronImageToLibMvFloatImage instead
+
+    return true;
+} // TrackerFrameAccessorPrivate::renderImage
+
+void
+TrackerFrameAccessorPrivate::prefetchFrame(const PrefetchedFramePtr& prefetched)
+{
+    {
+        QMutexLocker k(&prefetchMutex);
+        if (prefetched->state != PrefetchedFrame::eStateQueued) {
+            // A track requested it before this thread started, or the accessor is being destroyed
+            return;
+        }
+        prefetched->state = PrefetchedFrame::eStateRendering;
+    }
+
+    boost::shared_ptr<MvFloatImage> image;
+    RectI bounds;
+    if ( !renderImage(prefetched->key.frame, prefetched->key.mipMapLevel, false, prefetched->roi, &image, &bounds) ) {
+        image.reset();
+    }
+
+    QMutexLocker k(&prefetchMutex);
+    prefetched->image = image;
+    prefetched->bounds = bounds;
+    prefetched->state = PrefetchedFrame::eStateDone;
+    ++prefetchStats.framesPrefetched;
+    prefetchDone.wakeAll();
+}
+
+bool
+TrackerFrameAccessorPrivate::getPrefetchedFrame(const FrameAccessorCacheKey& key,
+                                                const RectI& roi,
+                                                PrefetchedFramePtr* prefetched)
+{
+    QMutexLocker k(&prefetchMutex);
+
+    for (std::list<PrefetchedFramePtr>::const_iterator it = prefetchedFrames.begin(); it != prefetchedFrames.end(); ++it) {
+        const PrefetchedFrame& cur = **it;
+        if ( (cur.key.frame == key.frame) && (cur.key.mipMapLevel == key.mipMapLevel) && (cur.key.mode == key.mode) &&
+             cur.roi.contains(roi) ) {
+            *prefetched = *it;
+            break;
+        }
+    }
+    if (!*prefetched) {
+        ++prefetchStats.misses;
+
+        return false;
+    }
+
+    PrefetchedFrame& frame = **prefetched;
+    if (frame.state == PrefetchedFrame::eStateQueued) {
+        // No thread of the pool started rendering it yet: render it here rather than waiting for a thread,
+        // all of them may be running tracks waiting for it
+        frame.state = PrefetchedFrame::eStateRendering;
+        k.unlock();
+        boost::shared_ptr<MvFloatImage> image;
+        RectI bounds;
+        if ( !renderImage(frame.key.frame, frame.key.mipMapLevel, false, frame.roi, &image, &bounds) ) {
+            image.reset();
+        }
+        k.relock();
+        frame.image = image;
+        frame.bounds = bounds;
+        frame.state = PrefetchedFrame::eStateDone;
+        prefetchDone.wakeAll();
+        ++prefetchStats.misses;
+
+        return true;
+    }
+
+    if (frame.state == PrefetchedFrame::eStateRendering) {
+        TimeLapse timer;
+        while (frame.state != PrefetchedFrame::eStateDone) {
+            prefetchDone.wait(&prefetchMutex);
+        }
+        prefetchStats.stallTime += timer.getTimeElapsedReset();
+    }
+    ++prefetchStats.hits;
+
+    return true;
+} // TrackerFrameAccessorPrivate::getPrefetchedFrame
+
 TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
                                            bool enabledChannels[3],
                                            int formatHeight)
@@ -240,6 +536,21 @@ TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
 
 TrackerFrameAccessor::~TrackerFrameAccessor()
 {
+    // The frames still being prefetched refer to _imp
+    std::list<QFuture<void> > futures;
+    {
+        QMutexLocker k(&_imp->prefetchMutex);
+        futures.swap(_imp->prefetchFutures);
+        for (std::list<PrefetchedFramePtr>::iterator it = _imp->prefetchedFrames.begin(); it != _imp->prefetchedFrames.end(); ++it) {
+            if ( (*it)->state == PrefetchedFrame::eStateQueued ) {
+                // Do not render it
+                (*it)->state = PrefetchedFrame::eStateDone;
+            }
+        }
+    }
+    for (std::list<QFuture<void> >::iterator it = futures.begin(); it != futures.end(); ++it) {
+        it->waitForFinished();
+    }
 }
 
 void
@@ -252,6 +563,83 @@ TrackerFrameAccessor::getEnabledChannels(bool* r,
     *b = _imp->enabledChannels[2];
 }
 
+void
+TrackerFrameAccessor::prefetchFrames(int frame,
+                                     int frameStep,
+                                     int end)
+{
+    if (frameStep == 0) {
+        return;
+    }
+
+    QMutexLocker k(&_imp->prefetchMutex);
+
+    // Release the frames the tracking went past: the previous frame is kept since it may be the reference frame
+    for (std::list<PrefetchedFramePtr>::iterator it = _imp->prefetchedFrames.begin(); it != _imp->prefetchedFrames.end();) {
+        int distance = ( (*it)->key.frame - frame ) / frameStep;
+        if ( (distance < -1) && ( (*it)->state == PrefetchedFrame::eStateDone ) ) {
+            it = _imp->prefetchedFrames.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (std::list<QFuture<void> >::iterator it = _imp->prefetchFutures.begin(); it != _imp->prefetchFutures.end();) {
+        if ( it->isFinished() ) {
+            it = _imp->prefetchFutures.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // The regions requested at the next frames are around the regions requested at the previous one:
+    // pad them by the size of the largest one, which is the size of the search window of a track
+    std::map<int, RectI> regions;
+    regions.swap(_imp->requestedRegions);
+    const int padding = _imp->requestedRegionsMaxSize;
+    _imp->requestedRegionsMaxSize = 0;
+
+    for (std::map<int, RectI>::const_iterator it = regions.begin(); it != regions.end(); ++it) {
+        RectI roi(it->second.x1 - padding, it->second.y1 - padding, it->second.x2 + padding, it->second.y2 + padding);
+        for (int i = 1; i <= NATRON_TRACKER_PREFETCH_FRAMES; ++i) {
+            int prefetchFrame = frame + i * frameStep;
+            if ( (frameStep > 0) ? (prefetchFrame >= end) : (prefetchFrame <= end) ) {
+                break;
+            }
+            bool found = false;
+            for (std::list<PrefetchedFramePtr>::iterator it2 = _imp->prefetchedFrames.begin(); it2 != _imp->prefetchedFrames.end(); ++it2) {
+                if ( ( (*it2)->key.frame == prefetchFrame ) && ( (*it2)->key.mipMapLevel == it->first ) ) {
+                    if ( ( (*it2)->state == PrefetchedFrame::eStateDone ) && !(*it2)->roi.contains(roi) ) {
+                        // The tracks moved out of the prefetched region: render it again
+                        _imp->prefetchedFrames.erase(it2);
+                    } else {
+                        found = true;
+                    }
+                    break;
+                }
+            }
+            if (found) {
+                continue;
+            }
+            PrefetchedFramePtr prefetched(new PrefetchedFrame);
+            prefetched->key.frame = prefetchFrame;
+            prefetched->key.mipMapLevel = it->first;
+            prefetched->key.mode = mv::FrameAccessor::MONO;
+            prefetched->roi = roi;
+            prefetched->state = PrefetchedFrame::eStateQueued;
+            _imp->prefetchedFrames.push_back(prefetched);
+            _imp->prefetchFutures.push_back( QtConcurrent::run(_imp.get(), &TrackerFrameAccessorPrivate::prefetchFrame, prefetched) );
+        }
+    }
+} // TrackerFrameAccessor::prefetchFrames
+
+TrackerPrefetchStats
+TrackerFrameAccessor::getPrefetchStats() const
+{
+    QMutexLocker k(&_imp->prefetchMutex);
+
+    return _imp->prefetchStats;
+}
+
 double
 TrackerFrameAccessor::invertYCoordinate(double yIn,
                                         double formatHeight)
@@ -320,116 +708,32 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                 return (mv::FrameAccessor::Key)it->second.image.get();
             }
         }
-    }
+        k.unlock();
 
-    EffectInstancePtr effect;
-    if (_imp->trackerInput) {
-        effect = _imp->trackerInput->getEffectInstance();
-    }
-    if (!effect) {
-        return (mv::FrameAccessor::Key)0;
+        // Remember the region, the next frames are prefetched around it
+        QMutexLocker pk(&_imp->prefetchMutex);
+        std::map<int, RectI>::iterator found = _imp->requestedRegions.find(downscale);
+        if ( found == _imp->requestedRegions.end() ) {
+            _imp->requestedRegions.insert( std::make_pair(downscale, roi) );
+        } else {
+            found->second.merge(roi);
+        }
+        _imp->requestedRegionsMaxSize = std::max( _imp->requestedRegionsMaxSize, std::max( roi.width(), roi.height() ) );
     }
 
-    // Not in accessor cache, call renderRoI
-    RenderScale scale;
-    scale.y = scale.x = Image::getScaleFromMipMapLevel( (unsigned int)downscale );
-
-
-    RectD precomputedRoD;
-    if (!region) {
-        bool isProjectFormat;
-        StatusEnum stat = effect->getRegionOfDefinition_public(_imp->trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
-        if (stat == eStatusFailed) {
+    FrameAccessorCacheEntry entry;
+    entry.referenceCount = 1;
+    PrefetchedFramePtr prefetched;
+    if ( region && _imp->getPrefetchedFrame(key, roi, &prefetched) ) {
+        if ( !prefetched->image || !roi.intersect(prefetched->bounds, &entry.bounds) ) {
             return (mv::FrameAccessor::Key)0;
         }
-        double par = effect->getAspectRatio(-1);
-        precomputedRoD.toPixelEnclosing( (unsigned int)downscale, par, &roi );
-    }
-
-    std::list<ImageComponents> components;
-    components.push_back( ImageComponents::getRGBComponents() );
-
-    NodePtr node = _imp->context->getNode();
-    const bool isRenderUserInteraction = true;
-    const bool isSequentialRender = false;
-    AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(false, 0);
-    AbortableThread* isAbortable = dynamic_cast<AbortableThread*>( QThread::currentThread() );
-    if (isAbortable) {
-        isAbortable->setAbortInfo( isRenderUserInteraction, abortInfo, node->getEffectInstance() );
-    }
-
-
-    ParallelRenderArgsSetter::CtorArgsPtr tlsArgs(new ParallelRenderArgsSetter::CtorArgs);
-    tlsArgs->time = frame;
-    tlsArgs->view = ViewIdx(0);
-    tlsArgs->isRenderUserInteraction = isRenderUserInteraction;
-    tlsArgs->isSequential = isSequentialRender;
-    tlsArgs->abortInfo = abortInfo;
-    tlsArgs->treeRoot = node;
-    tlsArgs->textureIndex = 0;
-    tlsArgs->timeline = node->getApp()->getTimeLine();
-    tlsArgs->activeRotoPaintNode = NodePtr();
-    tlsArgs->activeRotoDrawableItem = RotoDrawableItemPtr();
-    tlsArgs->isDoingRotoNeatRender = false;
-    tlsArgs->isAnalysis = true;
-    tlsArgs->draftMode = false;
-    tlsArgs->stats = RenderStatsPtr();
-    ParallelRenderArgsSetter frameRenderArgs(tlsArgs); // Stats
-    EffectInstance::RenderRoIArgs args( frame,
-                                        scale,
-                                        downscale,
-                                        ViewIdx(0),
-                                        false,
-                                        roi,
-                                        precomputedRoD,
-                                        components,
-                                        eImageBitDepthFloat,
-                                        true,
-                                        _imp->context->getNode()->getEffectInstance(),
-                                        eStorageModeRAM /*returnOpenGLTex*/,
-                                        frame);
-    std::map<ImageComponents, ImagePtr> planes;
-    EffectInstance::RenderRoIRetCode stat = effect->renderRoI(args, &planes);
-    if ( (stat != EffectInstance::eRenderRoIRetCodeOk) || planes.empty() ) {
-#ifdef TRACE_LIB_MV
-        qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Failed to call renderRoI on input at frame" << frame << "with RoI x1="
-                 << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2;
-#endif
-
+        entry.image.reset( new MvFloatImage( entry.bounds.height(), entry.bounds.width() ) );
+        copyMvFloatImage(*prefetched->image, prefetched->bounds, entry.bounds, *entry.image);
+    } else if ( !_imp->renderImage(frame, downscale, region == 0, roi, &entry.image, &entry.bounds) ) {
         return (mv::FrameAccessor::Key)0;
     }
 
-    assert( !planes.empty() );
-    const ImagePtr& sourceImage = planes.begin()->second;
-    RectI sourceBounds = sourceImage->getBounds();
-    RectI intersectedRoI;
-    if ( !roi.intersect(sourceBounds, &intersectedRoI) ) {
-#ifdef TRACE_LIB_MV
-        qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "RoI does not intersect the source image bounds (RoI x1="
-                 << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2 << ")";
-#endif
-
-        return (mv::FrameAccessor::Key)0;
-    }
-
-#ifdef TRACE_LIB_MV
-    qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "renderRoi (frame" << frame << ") OK  (BOUNDS= x1="
-             << sourceBounds.x1 << "y1=" << sourceBounds.y1 << "x2=" << sourceBounds.x2 << "y2=" << sourceBounds.y2 << ") (ROI = " << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2 << ")";
-#endif
-
-    /*
-       Copy the Natron image to the LivMV float image
-     */
-    FrameAccessorCacheEntry entry;
-    entry.image.reset( new MvFloatImage( intersectedRoI.height(), intersectedRoI.width() ) );
-    entry.bounds = intersectedRoI;
-    entry.referenceCount = 1;
-    natronImageToLibMvFloatImage(_imp->enabledChannels,
-                                 sourceImage.get(),
-                                 intersectedRoI,
-                                 *entry.image);
-    // we ignore the transform parameter and do it in natronImageToLibMvFloatImage instead
-
     *destination = entry.image.get();
     //destination->CopyFrom<float>(*entry.image);
 
@@ -440,7 +744,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     }
 #ifdef TRACE_LIB_MV
     qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Rendered frame" << frame << "with RoI x1="
-             << intersectedRoI.x1 << "y1=" << intersectedRoI.y1 << "x2=" << intersectedRoI.x2 << "y2=" << intersectedRoI.y2;
+             << entry.bounds.x1 << "y1=" << entry.bounds.y1 << "x2=" << entry.bounds.x2 << "y2=" << entry.bounds.y2;
 #endif
 
     return (mv::FrameAccessor::Key)entry.image.get();
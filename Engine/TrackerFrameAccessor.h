@@ -31,13 +31,47 @@
 #include <boost/scoped_ptr.hpp>
 #endif
 
+#include "Global/GlobalDefines.h"
 #include "Engine/EngineFwd.h"
 
 #include <libmv/autotrack/frame_accessor.h>
 
+// Number of frames after the tracked frame (in the track direction) rendered ahead of time by the frame accessor
+#define NATRON_TRACKER_PREFETCH_FRAMES 4
 
 NATRON_NAMESPACE_ENTER;
 
+/**
+ * @brief Counters of the images requested by the trackers, to measure how often prefetched frames avoid rendering them synchronously.
+ **/
+struct TrackerPrefetchStats
+{
+    // Number of images copied from a prefetched frame
+    U64 hits;
+
+    // Number of images that had to be rendered when they were requested
+    U64 misses;
+
+    // Number of frames rendered in the background
+    U64 framesPrefetched;
+
+    // Time spent by the trackers waiting for frames still being prefetched, in seconds
+    double stallTime;
+
+    TrackerPrefetchStats()
+        : hits(0)
+        , misses(0)
+        , framesPrefetched(0)
+        , stallTime(0.)
+    {
+    }
+
+    double getHitRate() const
+    {
+        return hits + misses ? (double)hits / (hits + misses) : 0.;
+    }
+};
+
 struct TrackerFrameAccessorPrivate;
 class TrackerFrameAccessor
     : public mv::FrameAccessor
@@ -53,6 +87,13 @@ public:
 
     void getEnabledChannels(bool* r, bool* g, bool* b) const;
 
+    /**
+     * @brief Called before tracking the given frame: starts rendering the next NATRON_TRACKER_PREFETCH_FRAMES frames in the
+     * direction of frameStep (up to end, excluded) in the background, in the regions requested while tracking the previous frame.
+     * Prefetched frames are shared by all tracks and are released once the tracking went past them.
+     **/
+    void prefetchFrames(int frame, int frameStep, int end);
+
 
     // Get a possibly-filtered version of a frame of a video. Downscale will
     // cause the input image to get downscaled by 2^downscale for pyramid access.
@@ -78,6 +119,11 @@ public:
     static double invertYCoordinate(double yIn, double formatHeight);
     static void convertLibMVRegionToRectI(const mv::Region& region, int formatHeight, RectI* roi);
 
+    /**
+     * @brief Returns the counters of the images requested to this frame accessor, i.e: since the track operation started.
+     **/
+    TrackerPrefetchStats getPrefetchStats() const;
+
 private:
 
     boost::scoped_ptr<TrackerFrameAccessorPrivate> _imp;
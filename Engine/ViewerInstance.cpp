@@ -66,6 +66,7 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/Settings.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Timer.h"
 #include "Engine/UpdateViewerParams.h"
@@ -105,7 +106,6 @@ NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 static void scaleToTexture8bits(const RectI& roi,
                                 const RenderViewerArgs & args,
-                                const ViewerInstancePtr& viewer,
                                 const UpdateViewerParams::CachedTile& tile,
                                 U32* output);
 static void scaleToTexture32bits(const RectI& roi,
@@ -115,25 +115,14 @@ static void scaleToTexture32bits(const RectI& roi,
 static MinMaxVal findAutoContrastVminVmax(boost::shared_ptr<const Image> inputImage,
                                                          DisplayChannelsEnum channels,
                                                          const RectI & rect);
+static void findAutoContrastVminVmaxTask(boost::shared_ptr<const Image> inputImage,
+                                         DisplayChannelsEnum channels,
+                                         const RectI* rect,
+                                         MinMaxVal* ret);
 static void renderFunctor(const RectI& roi,
                           const RenderViewerArgs & args,
-                          const ViewerInstancePtr& viewer,
                           UpdateViewerParams::CachedTile tile);
 
-/**
- *@brief Actually converting to ARGB... but it is called BGRA by
-   the texture format GL_UNSIGNED_INT_8_8_8_8_REV
- **/
-static unsigned int toBGRA(unsigned char r, unsigned char g, unsigned char b, unsigned char a) WARN_UNUSED_RETURN;
-unsigned int
-toBGRA(unsigned char r,
-       unsigned char g,
-       unsigned char b,
-       unsigned char a)
-{
-    return (a << 24) | (r << 16) | (g << 8) | b;
-}
-
 const Color::Lut*
 ViewerInstance::lutFromColorspace(ViewerColorSpaceEnum cs)
 {
@@ -1816,6 +1805,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                 updateParams->offset = -vmin / ( vmax - vmin);
             }
 
+            QReadLocker k(&_imp->gammaLookupMutex);
             const RenderViewerArgs args(colorImage,
                                         alphaImage,
                                         inArgs.channels,
@@ -1824,23 +1814,21 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                                         updateParams->gain,
                                         updateParams->gamma == 0. ? 0. : 1. / updateParams->gamma,
                                         updateParams->offset,
+                                        _imp->gammaLookup.empty() ? 0 : &_imp->gammaLookup[0],
                                         lutFromColorspace(srcColorSpace),
                                         lutFromColorspace(updateParams->lut),
                                         alphaChannelIndex,
                                         viewerRenderRoiOnly,
                                         tileRowElements);
-            QReadLocker k(&_imp->gammaLookupMutex);
             for (std::list<UpdateViewerParams::CachedTile>::iterator it = unCachedTiles.begin(); it != unCachedTiles.end(); ++it) {
                 renderFunctor(viewerRenderRoI,
                               args,
-                              shared_from_this(),
                               *it);
             }
         } else {
-            bool runInCurrentThread = QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
-            if ( !runInCurrentThread && (splitRoi.size() > 1) ) {
-                runInCurrentThread = true;
-            }
+            // When the tiles are run by the scheduler this thread renders its share of them, so there is no need
+            // to check whether other threads are available
+            bool runInCurrentThread = splitRoi.size() > 1;
 
 
             ///if autoContrast is enabled, find out the vmin/vmax before rendering and mapping against new values
@@ -1854,19 +1842,22 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                     vmax = vMinMax.max;
                 } else {
                     std::vector<RectI> splitRects = viewerRenderRoI.splitIntoSmallerRects( appPTR->getHardwareIdealThreadCount() );
-                    QFuture<MinMaxVal> future = QtConcurrent::mapped( splitRects,
-                                                                                       boost::bind(findAutoContrastVminVmax,
-                                                                                                   colorImage,
-                                                                                                   inArgs.channels,
-                                                                                                   _1) );
-                    future.waitForFinished();
-                    QList<MinMaxVal> results = future.results();
-                    Q_FOREACH (const MinMaxVal &vMinMax, results) {
-                        if (vMinMax.min < vmin) {
-                            vmin = vMinMax.min;
+                    std::vector<MinMaxVal> results( splitRects.size() );
+                    std::vector<TaskScheduler::Task> tasks( splitRects.size() );
+                    for (std::size_t i = 0; i < splitRects.size(); ++i) {
+                        tasks[i] = boost::bind(findAutoContrastVminVmaxTask,
+                                               colorImage,
+                                               inArgs.channels,
+                                               &splitRects[i],
+                                               &results[i]);
+                    }
+                    appPTR->getTaskScheduler()->runAndWait(tasks);
+                    for (std::vector<MinMaxVal>::const_iterator it = results.begin(); it != results.end(); ++it) {
+                        if (it->min < vmin) {
+                            vmin = it->min;
                         }
-                        if (vMinMax.max > vmax) {
-                            vmax = vMinMax.max;
+                        if (it->max > vmax) {
+                            vmax = it->max;
                         }
                     }
                 } // runInCurrentThread
@@ -1884,6 +1875,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                 }
             }
 
+            QReadLocker k(&_imp->gammaLookupMutex);
             const RenderViewerArgs args(colorImage,
                                         alphaImage,
                                         inArgs.channels,
@@ -1892,6 +1884,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                                         updateParams->gain,
                                         updateParams->gamma == 0. ? 0. : 1. / updateParams->gamma,
                                         updateParams->offset,
+                                        _imp->gammaLookup.empty() ? 0 : &_imp->gammaLookup[0],
                                         lutFromColorspace(srcColorSpace),
                                         lutFromColorspace(updateParams->lut),
                                         alphaChannelIndex,
@@ -1899,19 +1892,20 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                                         tileRowElements);
 
             if (runInCurrentThread) {
-                QReadLocker k(&_imp->gammaLookupMutex);
                 for (std::list<UpdateViewerParams::CachedTile>::iterator it = unCachedTiles.begin(); it != unCachedTiles.end(); ++it) {
                     renderFunctor(viewerRenderRoI,
-                                  args, shared_from_this(), *it);
+                                  args, *it);
                 }
             } else {
-                QReadLocker k(&_imp->gammaLookupMutex);
-                QtConcurrent::map( unCachedTiles,
-                                   boost::bind(&renderFunctor,
-                                               viewerRenderRoI,
-                                               args,
-                                               shared_from_this(),
-                                               _1) ).waitForFinished();
+                std::vector<TaskScheduler::Task> tasks;
+                tasks.reserve( unCachedTiles.size() );
+                for (std::list<UpdateViewerParams::CachedTile>::iterator it = unCachedTiles.begin(); it != unCachedTiles.end(); ++it) {
+                    tasks.push_back( boost::bind(&renderFunctor,
+                                                 viewerRenderRoI,
+                                                 boost::cref(args),
+                                                 *it) );
+                }
+                appPTR->getTaskScheduler()->runAndWait(tasks);
             }
 
             if (inArgs.isDoingPartialUpdates) {
@@ -1972,7 +1966,6 @@ ViewerInstance::updateViewer(boost::shared_ptr<UpdateViewerParams> & frame)
 void
 renderFunctor(const RectI& roi,
               const RenderViewerArgs & args,
-              const ViewerInstancePtr& viewer,
               UpdateViewerParams::CachedTile tile)
 {
     if ( (args.bitDepth == eImageBitDepthFloat) ) {
@@ -1980,7 +1973,7 @@ renderFunctor(const RectI& roi,
         scaleToTexture32bits(roi, args, tile, (float*)tile.ramBuffer);
     } else {
         // texture is stored as sRGB/Rec709 compressed 8-bit RGBA
-        scaleToTexture8bits(roi, args, viewer, tile, (U32*)tile.ramBuffer);
+        scaleToTexture8bits(roi, args, tile, (U32*)tile.ramBuffer);
     }
 }
 
@@ -2102,402 +2095,157 @@ findAutoContrastVminVmax(boost::shared_ptr<const Image> inputImage,
     }
 } // findAutoContrastVminVmax
 
-template <typename PIX, int maxValue, bool opaque, bool applyMatte, int rOffset, int gOffset, int bOffset>
-void
-scaleToTexture8bits_generic(const RectI& roi,
-                            const RenderViewerArgs & args,
-                            int nComps,
-                            const ViewerInstancePtr& viewer,
-                            const UpdateViewerParams::CachedTile& tile,
-                            U32* tileBuffer)
-{
-    const size_t pixelSize = sizeof(PIX);
-    const bool luminance = (args.channels == eDisplayChannelsY);
-    Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
-    const RectI srcImgBounds = args.inputImage->getBounds();
-
-    if ( (args.renderOnlyRoI && !tile.rect.contains(roi)) || (!args.renderOnlyRoI && !roi.contains(tile.rect)) ) {
-        return;
-    }
-    assert(tile.rect.x2 > tile.rect.x1);
-
-    int dstRowElements;
-    U32* dst_pixels;
-    if (args.renderOnlyRoI) {
-        dstRowElements = tile.rect.width();
-        dst_pixels = tileBuffer + (roi.y1 - tile.rect.y1) * dstRowElements + (roi.x1 - tile.rect.x1);
-    } else {
-        dstRowElements = args.tileRowElements;
-        dst_pixels = tileBuffer + (tile.rect.y1 - tile.rectRounded.y1) * args.tileRowElements + (tile.rect.x1 - tile.rectRounded.x1);
-    }
-
-    const int y1 = args.renderOnlyRoI ? roi.y1 : tile.rect.y1;
-    const int y2 = args.renderOnlyRoI ? roi.y2 : tile.rect.y2;
-    const int x1 = args.renderOnlyRoI ? roi.x1 : tile.rect.x1;
-    const int x2 = args.renderOnlyRoI ? roi.x2 : tile.rect.x2;
-    const PIX* src_pixels = (const PIX*)acc.pixelAt(x1, y1);
-    const int srcRowElements = (int)args.inputImage->getRowElements();
-    boost::shared_ptr<Image::ReadAccess> matteAcc;
-    if (applyMatte) {
-        matteAcc.reset( new Image::ReadAccess( args.matteImage.get() ) );
-    }
-
-    for (int y = y1; y < y2;
-         ++y,
-         dst_pixels += dstRowElements) {
-        // coverity[dont_call]
-        int start = (int)( rand() % (x2 - x1) );
-
-
-        for (int backward = 0; backward < 2; ++backward) {
-            int index = backward ? start - 1 : start;
-
-            assert( backward == 1 || ( index >= 0 && index < (x2 - x1) ) );
-
-            unsigned error_r = 0x80;
-            unsigned error_g = 0x80;
-            unsigned error_b = 0x80;
-
-            while (index < (x2 - x1) && index >= 0) {
-                double r = 0.;
-                double g = 0.;
-                double b = 0.;
-                int uA = 0;
-                double a = 0;
-                if (nComps >= 4) {
-                    r = (src_pixels ? src_pixels[index * nComps + rOffset] : 0.);
-                    g = (src_pixels ? src_pixels[index * nComps + gOffset] : 0.);
-                    b = (src_pixels ? src_pixels[index * nComps + bOffset] : 0.);
-                    if (opaque) {
-                        a = 1;
-                        uA = 255;
-                    } else {
-                        a = src_pixels ? src_pixels[index * nComps + 3] : 0;
-                        uA = Color::floatToInt<256>(a);
-                    }
-                } else if (nComps == 3) {
-                    // coverity[dead_error_line]
-                    r = (src_pixels && rOffset < nComps) ? src_pixels[index * nComps + rOffset] : 0.;
-                    // coverity[dead_error_line]
-                    g = (src_pixels && gOffset < nComps) ? src_pixels[index * nComps + gOffset] : 0.;
-                    // coverity[dead_error_line]
-                    b = (src_pixels && bOffset < nComps) ? src_pixels[index * nComps + bOffset] : 0.;
-                    a = (src_pixels ? 1 : 0);
-                    uA = a * 255;
-                } else if (nComps == 2) {
-                    // coverity[dead_error_line]
-                    r = (src_pixels && rOffset < nComps) ? src_pixels[index * nComps + rOffset] : 0.;
-                    // coverity[dead_error_line]
-                    g = (src_pixels && gOffset < nComps) ? src_pixels[index * nComps + gOffset] : 0.;
-                    b = 0;
-                    a = (src_pixels ? 1 : 0);
-                    uA = a * 255;
-                } else if (nComps == 1) {
-                    // coverity[dead_error_line]
-                    r = (src_pixels && rOffset < nComps) ? src_pixels[index * nComps + rOffset] : 0.;
-                    g = b = r;
-                    a = (src_pixels ? 1 : 0);
-                    uA = a * 255;
-                } else {
-                    assert(false);
-                }
-
-
-                switch (pixelSize) {
-                case sizeof(unsigned char):     //byte
-                    if (args.srcColorSpace) {
-                        r = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)r );
-                        g = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)g );
-                        b = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)b );
-                    } else {
-                        r = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
-                        g = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)g );
-                        b = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)b );
-                    }
-                    break;
-                case sizeof(unsigned short):     //short
-                    if (args.srcColorSpace) {
-                        r = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)r );
-                        g = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)g );
-                        b = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)b );
-                    } else {
-                        r = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)r );
-                        g = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)g );
-                        b = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)b );
-                    }
-                    break;
-                case sizeof(float):     //float
-                    if (args.srcColorSpace) {
-                        r = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(r);
-                        g = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(g);
-                        b = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(b);
-                    }
-                    break;
-                default:
-                    break;
-                }
-
-                //args.gamma is in fact 1. / gamma at this point
-                if  (args.gamma == 0) {
-                    r = 0;
-                    g = 0.;
-                    b = 0.;
-                } else if (args.gamma == 1.) {
-                    r = r * args.gain + args.offset;
-                    g = g * args.gain + args.offset;
-                    b = b * args.gain + args.offset;
-                } else {
-                    r = viewer->interpolateGammaLut(r * args.gain + args.offset);
-                    g = viewer->interpolateGammaLut(g * args.gain + args.offset);
-                    b = viewer->interpolateGammaLut(b * args.gain + args.offset);
-                }
-
-
-                if (luminance) {
-                    r = 0.299 * r + 0.587 * g + 0.114 * b;
-                    g = r;
-                    b = r;
-                }
-
-
-                U8 uR, uG, uB;
-                if (!args.colorSpace) {
-                    uR = Color::floatToInt<256>(r);
-                    uG = Color::floatToInt<256>(g);
-                    uB = Color::floatToInt<256>(b);
-                } else {
-                    error_r = (error_r & 0xff) + args.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(r);
-                    error_g = (error_g & 0xff) + args.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(g);
-                    error_b = (error_b & 0xff) + args.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(b);
-                    assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
-                    uR = (U8)(error_r >> 8);
-                    uG = (U8)(error_g >> 8);
-                    uB = (U8)(error_b >> 8);
-                }
-
-                if (applyMatte) {
-                    double alphaMatteValue = 0;
-                    if (args.matteImage == args.inputImage) {
-                        switch (args.alphaChannelIndex) {
-                        case 0:
-                            alphaMatteValue = r;
-                            break;
-                        case 1:
-                            alphaMatteValue = g;
-                            break;
-                        case 2:
-                            alphaMatteValue = b;
-                            break;
-                        case 3:
-                            alphaMatteValue = a;
-                            break;
-                        default:
-                            break;
-                        }
-                    } else {
-                        const PIX* src_pixels = (const PIX*)matteAcc->pixelAt(x1 + index, y);
-                        if (src_pixels) {
-                            alphaMatteValue = (double)src_pixels[args.alphaChannelIndex];
-                            switch (pixelSize) {
-                            case sizeof(unsigned char):     //byte
-                                alphaMatteValue = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
-                                break;
-                            case sizeof(unsigned short):     //short
-                                alphaMatteValue = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned short)r );
-                                break;
-                            default:
-                                break;
-                            }
-                        }
-                    }
-                    U8 matteA;
-                    if (args.colorSpace) {
-                        matteA = args.colorSpace->toColorSpaceUint8FromLinearFloatFast(alphaMatteValue) / 2;
-                    } else {
-                        matteA = Color::floatToInt<256>(alphaMatteValue) / 2;
-                    }
-                    uR = Image::clampIfInt<U8>( (double)uR + matteA );
-                }
-
-                dst_pixels[index] = toBGRA(uR, uG, uB, uA);
-
-                if (backward) {
-                    --index;
-                } else {
-                    ++index;
-                }
-            } // while (index < args.texRect.w && index >= 0) {
-        } // for (int backward = 0; backward < 2; ++backward) {
-        if (src_pixels) {
-            src_pixels += srcRowElements;
-        }
-    } // for (int y = yRange.first; y < yRange.second;
-} // scaleToTexture8bits_generic
-
-template <typename PIX, int maxValue, int nComps, bool opaque, bool matteOverlay, int rOffset, int gOffset, int bOffset>
 void
-scaleToTexture8bits_internal(const RectI& roi,
-                             const RenderViewerArgs & args,
-                             const ViewerInstancePtr& viewer,
-                             const UpdateViewerParams::CachedTile& tile,
-                             U32* output)
+findAutoContrastVminVmaxTask(boost::shared_ptr<const Image> inputImage,
+                             DisplayChannelsEnum channels,
+                             const RectI* rect,
+                             MinMaxVal* ret)
 {
-    scaleToTexture8bits_generic<PIX, maxValue, opaque, matteOverlay, rOffset, gOffset, bOffset>(roi, args, nComps, viewer, tile, output);
+    *ret = findAutoContrastVminVmax(inputImage, channels, *rect);
 }
 
-template <typename PIX, int maxValue, int nComps, bool opaque, int rOffset, int gOffset, int bOffset>
-void
-scaleToTexture8bitsForMatte(const RectI& roi,
-                            const RenderViewerArgs & args,
-                            const ViewerInstancePtr& viewer,
-                            const UpdateViewerParams::CachedTile& tile,
-                            U32* output)
+static ViewerTextureConvertArgs
+getTextureConvertArgs(const RenderViewerArgs & args)
 {
-    bool applyMate = args.matteImage.get() && args.alphaChannelIndex >= 0;
-
-    if (applyMate) {
-        scaleToTexture8bits_internal<PIX, maxValue, nComps, opaque, true, rOffset, gOffset, bOffset>(roi, args, viewer, tile, output);
-    } else {
-        scaleToTexture8bits_internal<PIX, maxValue, nComps, opaque, false, rOffset, gOffset, bOffset>(roi, args, viewer, tile, output);
-    }
-}
-
-template <typename PIX, int maxValue, bool opaque, int rOffset, int gOffset, int bOffset>
-void
-scaleToTexture8bitsForDepthForComponents(const RectI& roi,
-                                         const RenderViewerArgs & args,
-                                         const ViewerInstancePtr& viewer,
-                                         const UpdateViewerParams::CachedTile& tile,
-                                         U32* output)
-{
-    int nComps = args.inputImage->getComponents().getNumComponents();
-
-    switch (nComps) {
-    case 4:
-        scaleToTexture8bitsForMatte<PIX, maxValue, 4, opaque, rOffset, gOffset, bOffset>(roi, args, viewer, tile, output);
-        break;
-    case 3:
-        scaleToTexture8bitsForMatte<PIX, maxValue, 3, opaque, rOffset, gOffset, bOffset>(roi, args, viewer, tile, output);
-        break;
-    case 2:
-        scaleToTexture8bitsForMatte<PIX, maxValue, 2, opaque, rOffset, gOffset, bOffset>(roi, args, viewer, tile, output);
-        break;
-    case 1:
-        scaleToTexture8bitsForMatte<PIX, maxValue, 1, opaque, rOffset, gOffset, bOffset>(roi, args, viewer, tile, output);
-        break;
-    default:
-        bool applyMate = args.matteImage.get() && args.alphaChannelIndex >= 0;
-        if (applyMate) {
-            scaleToTexture8bits_generic<PIX, maxValue, opaque, true, rOffset, gOffset, bOffset>(roi, args, nComps, viewer, tile, output);
-        } else {
-            scaleToTexture8bits_generic<PIX, maxValue, opaque, false, rOffset, gOffset, bOffset>(roi, args, nComps, viewer, tile, output);
-        }
-        break;
-    }
-}
+    ViewerTextureConvertArgs convertArgs;
 
-template <typename PIX, int maxValue, bool opaque>
-void
-scaleToTexture8bitsForPremult(const RectI& roi,
-                              const RenderViewerArgs & args,
-                              const ViewerInstancePtr& viewer,
-                              const UpdateViewerParams::CachedTile& tile,
-                              U32* output)
-{
+    convertArgs.srcDepth = args.inputImage->getBitDepth();
+    convertArgs.srcNComps = (int)args.inputImage->getComponentsCount();
     switch (args.channels) {
     case eDisplayChannelsRGB:
     case eDisplayChannelsY:
     case eDisplayChannelsMatte:
-
-        scaleToTexture8bitsForDepthForComponents<PIX, maxValue, opaque, 0, 1, 2>(roi, args, viewer, tile, output);
+        convertArgs.rOffset = 0;
+        convertArgs.gOffset = 1;
+        convertArgs.bOffset = 2;
         break;
     case eDisplayChannelsG:
-        scaleToTexture8bitsForDepthForComponents<PIX, maxValue, opaque, 1, 1, 1>(roi, args, viewer, tile, output);
+        convertArgs.rOffset = convertArgs.gOffset = convertArgs.bOffset = 1;
         break;
     case eDisplayChannelsB:
-        scaleToTexture8bitsForDepthForComponents<PIX, maxValue, opaque, 2, 2, 2>(roi, args, viewer, tile, output);
+        convertArgs.rOffset = convertArgs.gOffset = convertArgs.bOffset = 2;
         break;
     case eDisplayChannelsA:
-        switch (args.alphaChannelIndex) {
-        case -1:
-            scaleToTexture8bitsForDepthForComponents<PIX, maxValue, opaque, 3, 3, 3>(roi, args, viewer, tile, output);
-            break;
-        case 0:
-            scaleToTexture8bitsForDepthForComponents<PIX, maxValue, opaque, 0, 0, 0>(roi, args, viewer, tile, output);
-            break;
-        case 1:
-            scaleToTexture8bitsForDepthForComponents<PIX, maxValue, opaque, 1, 1, 1>(roi, args, viewer, tile, output);
-            break;
-        case 2:
-            scaleToTexture8bitsForDepthForComponents<PIX, maxValue, opaque, 2, 2, 2>(roi, args, viewer, tile, output);
-            break;
-        case 3:
-            scaleToTexture8bitsForDepthForComponents<PIX, maxValue, opaque, 3, 3, 3>(roi, args, viewer, tile, output);
-            break;
-        default:
-            scaleToTexture8bitsForDepthForComponents<PIX, maxValue, opaque, 3, 3, 3>(roi, args, viewer, tile, output);
-        }
-
+        convertArgs.rOffset = convertArgs.gOffset = convertArgs.bOffset =
+                                                        (args.alphaChannelIndex >= 0 && args.alphaChannelIndex <= 3) ? args.alphaChannelIndex : 3;
         break;
     case eDisplayChannelsR:
     default:
-        scaleToTexture8bitsForDepthForComponents<PIX, maxValue, opaque, 0, 0, 0>(roi, args, viewer, tile, output);
-
+        convertArgs.rOffset = convertArgs.gOffset = convertArgs.bOffset = 0;
         break;
     }
+    convertArgs.opaque = (args.srcPremult == eImagePremultiplicationOpaque);
+    convertArgs.luminance = (args.channels == eDisplayChannelsY);
+    convertArgs.gain = (float)args.gain;
+    convertArgs.offset = (float)args.offset;
+    convertArgs.gamma = (float)args.gamma;
+    convertArgs.gammaLut = args.gammaLut;
+    convertArgs.srcColorSpace = args.srcColorSpace;
+    convertArgs.colorSpace = args.colorSpace;
+
+    return convertArgs;
 }
 
-template <typename PIX, int maxValue>
-void
-scaleToTexture8bitsForDepth(const RectI& roi,
-                            const RenderViewerArgs & args,
-                            const ViewerInstancePtr& viewer,
-                            const UpdateViewerParams::CachedTile& tile,
-                            U32* output)
-{
-    switch (args.srcPremult) {
-    case eImagePremultiplicationOpaque:
-        scaleToTexture8bitsForPremult<PIX, maxValue, true>(roi, args, viewer, tile, output);
-        break;
-    case eImagePremultiplicationPremultiplied:
-    case eImagePremultiplicationUnPremultiplied:
-    default:
-        scaleToTexture8bitsForPremult<PIX, maxValue, false>(roi, args, viewer, tile, output);
-        break;
+/**
+ * @brief Returns the rectangle of the tile to convert and the offset (in elements) of its bottom-left texel in the tile buffer.
+ * texelElements is the number of buffer elements per texel.
+ **/
+static bool
+getTextureTileRect(const RectI& roi,
+                   const RenderViewerArgs & args,
+                   const UpdateViewerParams::CachedTile& tile,
+                   int texelElements,
+                   RectI* rect,
+                   int* dstRowElements,
+                   std::size_t* dstOffset)
+{
+    if ( (args.renderOnlyRoI && !tile.rect.contains(roi)) || (!args.renderOnlyRoI && !roi.contains(tile.rect)) ) {
+        return false;
+    }
+    assert(tile.rect.x2 > tile.rect.x1);
+
+    if (args.renderOnlyRoI) {
+        *rect = roi;
+        *dstRowElements = tile.rect.width() * texelElements;
+        *dstOffset = (roi.y1 - tile.rect.y1) * *dstRowElements + (roi.x1 - tile.rect.x1) * texelElements;
+    } else {
+        *rect = tile.rect;
+        *dstRowElements = (int)args.tileRowElements;
+        *dstOffset = (tile.rect.y1 - tile.rectRounded.y1) * *dstRowElements + (tile.rect.x1 - tile.rectRounded.x1) * texelElements;
+    }
+
+    return !rect->isNull();
+}
+
+/**
+ * @brief Fills matte with the alpha channel of the matte image over [x1,x2) on row y, 0 outside of its bounds.
+ **/
+static void
+getMatteRow(const RenderViewerArgs & args,
+            const Image::ReadAccess & matteAcc,
+            int x1,
+            int x2,
+            int y,
+            float* matte)
+{
+    std::fill(matte, matte + (x2 - x1), 0.f);
+    const RectI matteBounds = args.matteImage->getBounds();
+    if ( (y < matteBounds.y1) || (y >= matteBounds.y2) ) {
+        return;
     }
+    const int mx1 = std::max(x1, matteBounds.x1);
+    const int mx2 = std::min(x2, matteBounds.x2);
+    if (mx1 >= mx2) {
+        return;
+    }
+    ViewerTextureRowConverter::getChannelRow(args.matteImage->getBitDepth(),
+                                             (int)args.matteImage->getComponentsCount(),
+                                             args.alphaChannelIndex,
+                                             matteAcc.pixelAt(mx1, y),
+                                             mx2 - mx1,
+                                             matte + (mx1 - x1) );
 }
 
 void
 scaleToTexture8bits(const RectI& roi,
                     const RenderViewerArgs & args,
-                    const ViewerInstancePtr& viewer,
                     const UpdateViewerParams::CachedTile& tile,
                     U32* output)
 {
     assert(output);
-    switch ( args.inputImage->getBitDepth() ) {
-    case eImageBitDepthFloat:
-        scaleToTexture8bitsForDepth<float, 1>(roi, args, viewer, tile, output);
-        break;
-    case eImageBitDepthByte:
-        scaleToTexture8bitsForDepth<unsigned char, 255>(roi, args, viewer, tile, output);
-        break;
-    case eImageBitDepthShort:
-        scaleToTexture8bitsForDepth<unsigned short, 65535>(roi, args, viewer, tile, output);
-        break;
-    case eImageBitDepthHalf:
-        assert(false);
-        break;
-    case eImageBitDepthNone:
-        break;
+    RectI rect;
+    int dstRowElements;
+    std::size_t dstOffset;
+    if ( !getTextureTileRect(roi, args, tile, 1, &rect, &dstRowElements, &dstOffset) ) {
+        return;
     }
-} // scaleToTexture8bits
+    if ( (args.inputImage->getBitDepth() == eImageBitDepthHalf) || (args.inputImage->getBitDepth() == eImageBitDepthNone) ) {
+        assert(args.inputImage->getBitDepth() == eImageBitDepthNone);
 
-float
-ViewerInstance::interpolateGammaLut(float value)
-{
-    return _imp->lookupGammaLut(value);
-}
+        return;
+    }
+
+    const int width = rect.width();
+    ViewerTextureRowConverter converter(getTextureConvertArgs(args), width);
+    Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
+    const bool applyMatte = args.matteImage && args.alphaChannelIndex >= 0;
+    boost::shared_ptr<Image::ReadAccess> matteAcc;
+    std::vector<float> matte;
+    if (applyMatte) {
+        matteAcc.reset( new Image::ReadAccess( args.matteImage.get() ) );
+        matte.resize(width);
+    }
+
+    U32* dst_pixels = output + dstOffset;
+    for (int y = rect.y1; y < rect.y2; ++y, dst_pixels += dstRowElements) {
+        if (applyMatte) {
+            getMatteRow(args, *matteAcc, rect.x1, rect.x2, y, &matte[0]);
+        }
+        // coverity[dont_call]
+        int ditherStart = (int)( rand() % width );
+        converter.convertRowTo8bits(acc.pixelAt(rect.x1, y), applyMatte ? &matte[0] : 0, width, ditherStart, dst_pixels);
+    }
+} // scaleToTexture8bits
 
 void
 ViewerInstance::markAllOnGoingRendersAsAborted(bool keepOldestRender)
@@ -2523,326 +2271,42 @@ ViewerInstance::markAllOnGoingRendersAsAborted(bool keepOldestRender)
     }
 }
 
-template <typename PIX, int maxValue, bool opaque, bool applyMatte, int rOffset, int gOffset, int bOffset>
 void
-scaleToTexture32bitsGeneric(const RectI& roi,
-                            const RenderViewerArgs & args,
-                            int nComps,
-                            const UpdateViewerParams::CachedTile& tile,
-                            float *tileBuffer)
-{
-    const size_t pixelSize = sizeof(PIX);
-    const bool luminance = (args.channels == eDisplayChannelsY);
-    const int dstRowElements = args.renderOnlyRoI ? tile.rect.width() * 4 : args.tileRowElements;
-    Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
-    boost::shared_ptr<Image::ReadAccess> matteAcc;
-
-    if (applyMatte) {
-        matteAcc.reset( new Image::ReadAccess( args.matteImage.get() ) );
-    }
-
-    assert( (args.renderOnlyRoI && roi.x1 >= tile.rect.x1 && roi.x2 <= tile.rect.x2 && roi.y1 >= tile.rect.y1 && roi.y2 <= tile.rect.y2) || (!args.renderOnlyRoI && tile.rect.x1 >= roi.x1 && tile.rect.x2 <= roi.x2 && tile.rect.y1 >= roi.y1 && tile.rect.y2 <= roi.y2) );
-    assert(tile.rect.x2 > tile.rect.x1);
-
-    float* dst_pixels;
-    if (args.renderOnlyRoI) {
-        dst_pixels = tileBuffer + (roi.y1 - tile.rect.y1) * dstRowElements + (roi.x1 - tile.rect.x1) * 4;
-    } else {
-        dst_pixels = tileBuffer + (tile.rect.y1 - tile.rectRounded.y1) * dstRowElements + (tile.rect.x1 - tile.rectRounded.x1) * 4;
+scaleToTexture32bits(const RectI& roi,
+                     const RenderViewerArgs & args,
+                     const UpdateViewerParams::CachedTile& tile,
+                     float *output)
+{
+    assert(output);
+    RectI rect;
+    int dstRowElements;
+    std::size_t dstOffset;
+    if ( !getTextureTileRect(roi, args, tile, 4, &rect, &dstRowElements, &dstOffset) ) {
+        return;
     }
+    if ( (args.inputImage->getBitDepth() == eImageBitDepthHalf) || (args.inputImage->getBitDepth() == eImageBitDepthNone) ) {
+        assert(args.inputImage->getBitDepth() == eImageBitDepthNone);
 
-    const int y1 = args.renderOnlyRoI ? roi.y1 : tile.rect.y1;
-    const int y2 = args.renderOnlyRoI ? roi.y2 : tile.rect.y2;
-    const int x1 = args.renderOnlyRoI ? roi.x1 : tile.rect.x1;
-    const int x2 = args.renderOnlyRoI ? roi.x2 : tile.rect.x2;
-    const float* src_pixels = (const float*)acc.pixelAt(x1, y1);
-    const int srcRowElements = (const int)args.inputImage->getRowElements();
-
-    for (int y = y1; y < y2;
-         ++y,
-         dst_pixels += dstRowElements) {
-        for (int x = 0; x < (x2 - x1);
-             ++x) {
-            double r = 0.;
-            double g = 0.;
-            double b = 0.;
-            double a = 0.;
-
-            if (nComps >= 4) {
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
-                g = (src_pixels && gOffset < nComps) ? src_pixels[x * nComps + gOffset] : 0.;
-                b = (src_pixels && bOffset < nComps) ? src_pixels[x * nComps + bOffset] : 0.;
-                if (opaque) {
-                    a = 1.;
-                } else {
-                    a = src_pixels ? src_pixels[x * nComps + 3] : 0.;
-                }
-            } else if (nComps == 3) {
-                // coverity[dead_error_line]
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
-                // coverity[dead_error_line]
-                g = (src_pixels && gOffset < nComps) ? src_pixels[x * nComps + gOffset] : 0.;
-                // coverity[dead_error_line]
-                b = (src_pixels && bOffset < nComps) ? src_pixels[x * nComps + bOffset] : 0.;
-                a = 1.;
-            } else if (nComps == 2) {
-                // coverity[dead_error_line]
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
-                // coverity[dead_error_line]
-                g = (src_pixels && gOffset < nComps) ? src_pixels[x * nComps + gOffset] : 0.;
-                b = 0.;
-                a = 1.;
-            } else if (nComps == 1) {
-                // coverity[dead_error_line]
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
-                g = b = r;
-                a = 1.;
-            } else {
-                assert(false);
-            }
-
-
-            switch (pixelSize) {
-            case sizeof(unsigned char):
-                if (args.srcColorSpace) {
-                    r = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)r );
-                    g = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)g );
-                    b = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)b );
-                } else {
-                    r = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
-                    g = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)g );
-                    b = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)b );
-                }
-                break;
-            case sizeof(unsigned short):
-                if (args.srcColorSpace) {
-                    r = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)r );
-                    g = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)g );
-                    b = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)b );
-                } else {
-                    r = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)r );
-                    g = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)g );
-                    b = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)b );
-                }
-                break;
-            case sizeof(float):
-                if (args.srcColorSpace) {
-                    r = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(r);
-                    g = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(g);
-                    b = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(b);
-                }
-                break;
-            default:
-                break;
-            }
-
-
-            if (luminance) {
-                r = 0.299 * r + 0.587 * g + 0.114 * b;
-                g = r;
-                b = r;
-            }
-
-            if (applyMatte) {
-                double alphaMatteValue = 0;
-                if (args.matteImage == args.inputImage) {
-                    switch (args.alphaChannelIndex) {
-                    case 0:
-                        alphaMatteValue = r;
-                        break;
-                    case 1:
-                        alphaMatteValue = g;
-                        break;
-                    case 2:
-                        alphaMatteValue = b;
-                        break;
-                    case 3:
-                        alphaMatteValue = a;
-                        break;
-                    default:
-                        break;
-                    }
-                } else {
-                    const PIX* src_pixels = (const PIX*)matteAcc->pixelAt(x, y);
-                    if (src_pixels) {
-                        alphaMatteValue = (double)src_pixels[args.alphaChannelIndex];
-                        switch (pixelSize) {
-                        case sizeof(unsigned char):     //byte
-                            alphaMatteValue = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
-                            break;
-                        case sizeof(unsigned short):     //short
-                            alphaMatteValue = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned short)r );
-                            break;
-                        default:
-                            break;
-                        }
-                    }
-                }
-                r += alphaMatteValue * 0.5;
-            }
-
-
-            dst_pixels[x * 4] = Image::clamp(r, 0., 1.);
-            dst_pixels[x * 4 + 1] = Image::clamp(g, 0., 1.);
-            dst_pixels[x * 4 + 2] = Image::clamp(b, 0., 1.);
-            dst_pixels[x * 4 + 3] = Image::clamp(a, 0., 1.);
-        }
-        if (src_pixels) {
-            src_pixels += srcRowElements;
-        }
+        return;
     }
-} // scaleToTexture32bitsGeneric
-
-template <typename PIX, int maxValue, int nComps, bool opaque, bool applyMatte, int rOffset, int gOffset, int bOffset>
-void
-scaleToTexture32bitsInternal(const RectI& roi,
-                             const RenderViewerArgs & args,
-                             const UpdateViewerParams::CachedTile& tile,
-                             float *output)
-{
-    scaleToTexture32bitsGeneric<PIX, maxValue, opaque, applyMatte, rOffset, gOffset, bOffset>(roi, args, nComps, tile, output);
-}
-
-template <typename PIX, int maxValue, int nComps, bool opaque, int rOffset, int gOffset, int bOffset>
-void
-scaleToTexture32bitsForMatte(const RectI& roi,
-                             const RenderViewerArgs & args,
-                             const UpdateViewerParams::CachedTile& tile,
-                             float *output)
-{
-    bool applyMatte = args.matteImage.get() && args.alphaChannelIndex >= 0;
 
+    const int width = rect.width();
+    ViewerTextureRowConverter converter(getTextureConvertArgs(args), width);
+    Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
+    const bool applyMatte = args.matteImage && args.alphaChannelIndex >= 0;
+    boost::shared_ptr<Image::ReadAccess> matteAcc;
+    std::vector<float> matte;
     if (applyMatte) {
-        scaleToTexture32bitsInternal<PIX, maxValue, nComps, opaque, true, rOffset, gOffset, bOffset>(roi, args, tile, output);
-    } else {
-        scaleToTexture32bitsInternal<PIX, maxValue, nComps, opaque, false, rOffset, gOffset, bOffset>(roi, args, tile, output);
+        matteAcc.reset( new Image::ReadAccess( args.matteImage.get() ) );
+        matte.resize(width);
     }
-}
-
-template <typename PIX, int maxValue, bool opaque, int rOffset, int gOffset, int bOffset>
-void
-scaleToTexture32bitsForDepthForComponents(const RectI& roi,
-                                          const RenderViewerArgs & args,
-                                          const UpdateViewerParams::CachedTile& tile,
-                                          float *output)
-{
-    int nComps = args.inputImage->getComponents().getNumComponents();
 
-    switch (nComps) {
-    case 4:
-        scaleToTexture32bitsForMatte<PIX, maxValue, 4, opaque, rOffset, gOffset, bOffset>(roi, args, tile, output);
-        break;
-    case 3:
-        scaleToTexture32bitsForMatte<PIX, maxValue, 3, opaque, rOffset, gOffset, bOffset>(roi, args, tile, output);
-        break;
-    case 2:
-        scaleToTexture32bitsForMatte<PIX, maxValue, 2, opaque, rOffset, gOffset, bOffset>(roi, args, tile, output);
-        break;
-    case 1:
-        scaleToTexture32bitsForMatte<PIX, maxValue, 1, opaque, rOffset, gOffset, bOffset>(roi, args, tile, output);
-        break;
-    default:
-        bool applyMatte = args.matteImage.get() && args.alphaChannelIndex >= 0;
+    float* dst_pixels = output + dstOffset;
+    for (int y = rect.y1; y < rect.y2; ++y, dst_pixels += dstRowElements) {
         if (applyMatte) {
-            scaleToTexture32bitsGeneric<PIX, maxValue, opaque, true, rOffset, gOffset, bOffset>(roi, args, nComps, tile, output);
-        } else {
-            scaleToTexture32bitsGeneric<PIX, maxValue, opaque, false, rOffset, gOffset, bOffset>(roi, args, nComps, tile, output);
+            getMatteRow(args, *matteAcc, rect.x1, rect.x2, y, &matte[0]);
         }
-        break;
-    }
-}
-
-template <typename PIX, int maxValue, bool opaque>
-void
-scaleToTexture32bitsForPremultForComponents(const RectI& roi,
-                                            const RenderViewerArgs & args,
-                                            const UpdateViewerParams::CachedTile& tile,
-                                            float *output)
-{
-    switch (args.channels) {
-    case eDisplayChannelsRGB:
-    case eDisplayChannelsY:
-    case eDisplayChannelsMatte:
-        scaleToTexture32bitsForDepthForComponents<PIX, maxValue, opaque, 0, 1, 2>(roi, args, tile, output);
-        break;
-    case eDisplayChannelsG:
-        scaleToTexture32bitsForDepthForComponents<PIX, maxValue, opaque, 1, 1, 1>(roi, args, tile, output);
-        break;
-    case eDisplayChannelsB:
-        scaleToTexture32bitsForDepthForComponents<PIX, maxValue, opaque, 2, 2, 2>(roi, args, tile, output);
-        break;
-    case eDisplayChannelsA:
-        switch (args.alphaChannelIndex) {
-        case -1:
-            scaleToTexture32bitsForDepthForComponents<PIX, maxValue, opaque, 3, 3, 3>(roi, args, tile, output);
-            break;
-        case 0:
-            scaleToTexture32bitsForDepthForComponents<PIX, maxValue, opaque, 0, 0, 0>(roi, args, tile, output);
-            break;
-        case 1:
-            scaleToTexture32bitsForDepthForComponents<PIX, maxValue, opaque, 1, 1, 1>(roi, args, tile, output);
-            break;
-        case 2:
-            scaleToTexture32bitsForDepthForComponents<PIX, maxValue, opaque, 2, 2, 2>(roi, args, tile, output);
-            break;
-        case 3:
-            scaleToTexture32bitsForDepthForComponents<PIX, maxValue, opaque, 3, 3, 3>(roi, args, tile, output);
-            break;
-        default:
-            scaleToTexture32bitsForDepthForComponents<PIX, maxValue, opaque, 3, 3, 3>(roi, args, tile, output);
-            break;
-        }
-
-        break;
-    case eDisplayChannelsR:
-    default:
-        scaleToTexture32bitsForDepthForComponents<PIX, maxValue, opaque, 0, 0, 0>(roi, args, tile, output);
-        break;
-    }
-}
-
-template <typename PIX, int maxValue>
-void
-scaleToTexture32bitsForPremult(const RectI& roi,
-                               const RenderViewerArgs & args,
-                               const UpdateViewerParams::CachedTile& tile,
-                               float *output)
-{
-    switch (args.srcPremult) {
-    case eImagePremultiplicationOpaque:
-        scaleToTexture32bitsForPremultForComponents<PIX, maxValue, true>(roi, args, tile, output);
-        break;
-    case eImagePremultiplicationPremultiplied:
-    case eImagePremultiplicationUnPremultiplied:
-    default:
-        scaleToTexture32bitsForPremultForComponents<PIX, maxValue, false>(roi, args, tile, output);
-        break;
-    }
-}
-
-void
-scaleToTexture32bits(const RectI& roi,
-                     const RenderViewerArgs & args,
-                     const UpdateViewerParams::CachedTile& tile,
-                     float *output)
-{
-    assert(output);
-
-    switch ( args.inputImage->getBitDepth() ) {
-    case eImageBitDepthFloat:
-        scaleToTexture32bitsForPremult<float, 1>(roi, args, tile, output);
-        break;
-    case eImageBitDepthByte:
-        scaleToTexture32bitsForPremult<unsigned char, 255>(roi, args, tile, output);
-        break;
-    case eImageBitDepthShort:
-        scaleToTexture32bitsForPremult<unsigned short, 65535>(roi, args, tile, output);
-        break;
-    case eImageBitDepthHalf:
-        assert(false);
-        break;
-    case eImageBitDepthNone:
-        break;
+        converter.convertRowTo32bits(acc.pixelAt(rect.x1, y), applyMatte ? &matte[0] : 0, width, dst_pixels);
     }
 } // scaleToTexture32bits
 
@@ -3472,9 +2936,10 @@ void
 ViewerInstance::reportStats(int time,
                             ViewIdx view,
                             double wallTime,
+                            int nodesRehashedByLastEdit,
                             const RenderStatsMap& stats)
 {
-    Q_EMIT renderStatsAvailable(time, view, wallTime, stats);
+    Q_EMIT renderStatsAvailable(time, view, wallTime, nodesRehashedByLastEdit, stats);
 }
 
 NATRON_NAMESPACE_EXIT;
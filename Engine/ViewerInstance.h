@@ -313,8 +313,6 @@ public:
 
     struct ViewerInstancePrivate;
 
-    float interpolateGammaLut(float value);
-
     void markAllOnGoingRendersAsAborted(bool keepOldestRender);
 
     /**
@@ -330,7 +328,7 @@ public:
     void setDoingPartialUpdates(bool doing);
     bool isDoingPartialUpdates() const;
 
-    virtual void reportStats(int time, ViewIdx view, double wallTime, const RenderStatsMap& stats) OVERRIDE FINAL;
+    virtual void reportStats(int time, ViewIdx view, double wallTime, int nodesRehashedByLastEdit, const RenderStatsMap& stats) OVERRIDE FINAL;
 
     ///Only callable on MT
     void setActivateInputChangeRequestedFromViewer(bool fromViewer);
@@ -362,7 +360,7 @@ public Q_SLOTS:
 
 Q_SIGNALS:
 
-    void renderStatsAvailable(int time, ViewIdx view, double wallTime, const RenderStatsMap& stats);
+    void renderStatsAvailable(int time, ViewIdx view, double wallTime, int nodesRehashedByLastEdit, const RenderStatsMap& stats);
 
     void s_callRedrawOnMainThread();
 
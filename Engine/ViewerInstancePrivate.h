@@ -49,10 +49,9 @@
 #include "Engine/Settings.h"
 #include "Engine/Image.h"
 #include "Engine/TextureRect.h"
+#include "Engine/ViewerTextureConvert.h"
 #include "Engine/EngineFwd.h"
 
-#define GAMMA_LUT_NB_VALUES 1023
-
 NATRON_NAMESPACE_ENTER;
 
 
@@ -78,6 +77,7 @@ struct RenderViewerArgs
                      double gain_,
                      double gamma_,
                      double offset_,
+                     const float* gammaLut_,
                      const Color::Lut* srcColorSpace_,
                      const Color::Lut* colorSpace_,
                      int alphaChannelIndex_,
@@ -91,6 +91,7 @@ struct RenderViewerArgs
         , gain(gain_)
         , gamma(gamma_)
         , offset(offset_)
+        , gammaLut(gammaLut_)
         , srcColorSpace(srcColorSpace_)
         , colorSpace(colorSpace_)
         , alphaChannelIndex(alphaChannelIndex_)
@@ -107,6 +108,8 @@ struct RenderViewerArgs
     double gain;
     double gamma;
     double offset;
+    // The gamma lookup table of the viewer: the caller holds gammaLookupMutex for reading while the args are used
+    const float* gammaLut;
     const Color::Lut* srcColorSpace;
     const Color::Lut* colorSpace;
     int alphaChannelIndex;
@@ -326,23 +329,6 @@ public:
         }
     }
 
-    float lookupGammaLut(float value) const
-    {
-        if (value < 0.) {
-            return 0.;
-        } else if (value > 1.) {
-            return 1.;
-        } else {
-            int i = (int)(value * GAMMA_LUT_NB_VALUES);
-            assert(0 <= i && i <= GAMMA_LUT_NB_VALUES);
-            float alpha = std::max( 0.f, std::min(value * GAMMA_LUT_NB_VALUES - i, 1.f) );
-            float a = gammaLookup[i];
-            float b = (i  < GAMMA_LUT_NB_VALUES) ? gammaLookup[i + 1] : 0.f;
-
-            return a * (1.f - alpha) + b * alpha;
-        }
-    }
-
 public Q_SLOTS:
 
     /**
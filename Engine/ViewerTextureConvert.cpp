@@ -0,0 +1,709 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ViewerTextureConvert.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cstring> // for std::memset
+
+#ifdef NATRON_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "Engine/Lut.h"
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// All the passes below work on planar float rows.
+// The SSE2 versions process the bulk of the row 4 pixels at a time and return the number of pixels processed:
+// the remaining ones are processed by the scalar code, which computes exactly the same thing in single precision.
+
+template <int nComps, int rOffset, int gOffset, int bOffset, bool opaque>
+void
+deinterleaveRow(const float* src,
+                int width,
+                float* r,
+                float* g,
+                float* b,
+                float* a)
+{
+    for (int x = 0; x < width; ++x, src += nComps) {
+        if (nComps == 1) {
+            r[x] = rOffset < 1 ? src[0] : 0.f;
+            g[x] = r[x];
+            b[x] = r[x];
+        } else {
+            r[x] = rOffset < nComps ? src[rOffset] : 0.f;
+            g[x] = gOffset < nComps ? src[gOffset] : 0.f;
+            b[x] = bOffset < nComps ? src[bOffset] : 0.f;
+        }
+        a[x] = (nComps == 4 && !opaque) ? src[nComps - 1] : 1.f;
+    }
+}
+
+template <int nComps, bool opaque>
+ViewerTextureRowConverter::DeinterleaveRowFunc
+getDeinterleaveRowFuncForComps(int rOffset,
+                               int gOffset,
+                               int bOffset)
+{
+    if ( (rOffset == 0) && (gOffset == 1) && (bOffset == 2) ) {
+        return &deinterleaveRow<nComps, 0, 1, 2, opaque>;
+    }
+    if ( (rOffset == gOffset) && (gOffset == bOffset) ) {
+        switch (rOffset) {
+        case 0:
+
+            return &deinterleaveRow<nComps, 0, 0, 0, opaque>;
+        case 1:
+
+            return &deinterleaveRow<nComps, 1, 1, 1, opaque>;
+        case 2:
+
+            return &deinterleaveRow<nComps, 2, 2, 2, opaque>;
+        case 3:
+
+            return &deinterleaveRow<nComps, 3, 3, 3, opaque>;
+        default:
+            break;
+        }
+    }
+
+    return 0;
+}
+
+template <bool opaque>
+ViewerTextureRowConverter::DeinterleaveRowFunc
+getDeinterleaveRowFuncForOpaque(const ViewerTextureConvertArgs& args)
+{
+    switch (args.srcNComps) {
+    case 1:
+
+        return getDeinterleaveRowFuncForComps<1, opaque>(args.rOffset, args.gOffset, args.bOffset);
+    case 2:
+
+        return getDeinterleaveRowFuncForComps<2, opaque>(args.rOffset, args.gOffset, args.bOffset);
+    case 3:
+
+        return getDeinterleaveRowFuncForComps<3, opaque>(args.rOffset, args.gOffset, args.bOffset);
+    case 4:
+
+        return getDeinterleaveRowFuncForComps<4, opaque>(args.rOffset, args.gOffset, args.bOffset);
+    default:
+
+        return 0;
+    }
+}
+
+// Any layout that has no specialization above, which should not happen with the channels the viewer displays
+void
+deinterleaveRowGeneric(const ViewerTextureConvertArgs& args,
+                       const float* src,
+                       int width,
+                       float* r,
+                       float* g,
+                       float* b,
+                       float* a)
+{
+    const int nComps = args.srcNComps;
+
+    for (int x = 0; x < width; ++x, src += nComps) {
+        r[x] = args.rOffset < nComps ? src[args.rOffset] : 0.f;
+        g[x] = args.gOffset < nComps ? src[args.gOffset] : 0.f;
+        b[x] = args.bOffset < nComps ? src[args.bOffset] : 0.f;
+        a[x] = (nComps == 4 && !args.opaque) ? src[3] : 1.f;
+    }
+}
+
+inline float
+toLinear(const Color::Lut* lut,
+         unsigned char v)
+{
+    return lut->fromColorSpaceUint8ToLinearFloatFast(v);
+}
+
+inline float
+toLinear(const Color::Lut* lut,
+         unsigned short v)
+{
+    return lut->fromColorSpaceUint16ToLinearFloatFast(v);
+}
+
+inline float
+toLinear(const Color::Lut* lut,
+         float v)
+{
+    return lut->fromColorSpaceFloatToLinearFloat(v);
+}
+
+// Converts one channel of the source from its color-space to linear. This is a table lookup
+// for 8 and 16-bit images, so it reads the source values rather than the floats they were converted to.
+template <typename PIX>
+void
+channelToLinear(const Color::Lut* lut,
+                const PIX* src,
+                int nComps,
+                int channel,
+                int width,
+                float* dst)
+{
+    if (channel >= nComps) {
+        return;
+    }
+    src += channel;
+    for (int x = 0; x < width; ++x, src += nComps) {
+        dst[x] = toLinear(lut, *src);
+    }
+}
+
+template <typename PIX>
+void
+rowToLinear(const ViewerTextureConvertArgs& args,
+            const PIX* src,
+            int width,
+            float* r,
+            float* g,
+            float* b)
+{
+    if (args.srcNComps == 1) {
+        if (args.rOffset < 1) {
+            channelToLinear(args.srcColorSpace, src, 1, 0, width, r);
+            std::copy(r, r + width, g);
+            std::copy(r, r + width, b);
+        }
+
+        return;
+    }
+    channelToLinear(args.srcColorSpace, src, args.srcNComps, args.rOffset, width, r);
+    channelToLinear(args.srcColorSpace, src, args.srcNComps, args.gOffset, width, g);
+    channelToLinear(args.srcColorSpace, src, args.srcNComps, args.bOffset, width, b);
+}
+
+// Same as floatToInt<256>, in single precision
+inline int
+floatToByte(float v)
+{
+    v = v > 0.f ? v : 0.f;
+    v = v < 1.f ? v : 1.f;
+
+    return (int)(v * 255.f + 0.5f);
+}
+
+inline float
+clampUnit(float v)
+{
+    v = v > 0.f ? v : 0.f;
+
+    return v < 1.f ? v : 1.f;
+}
+
+inline float
+lookupGammaLut(const float* lut,
+               float v)
+{
+    v = clampUnit(v);
+    float s = v * GAMMA_LUT_NB_VALUES;
+    int i = (int)s;
+    float alpha = clampUnit(s - i);
+    float lo = lut[i];
+    float hi = lut[std::min(i + 1, GAMMA_LUT_NB_VALUES)];
+
+    return lo * (1.f - alpha) + hi * alpha;
+}
+
+// Actually converting to ARGB... but it is called BGRA by the texture format GL_UNSIGNED_INT_8_8_8_8_REV
+inline U32
+toBGRA(int r,
+       int g,
+       int b,
+       int a)
+{
+    return ( (U32)a << 24 ) | ( (U32)r << 16 ) | ( (U32)g << 8 ) | (U32)b;
+}
+
+#ifdef NATRON_USE_SSE2
+
+inline __m128
+clampUnit_SSE2(__m128 v)
+{
+    // _mm_max_ps returns its second operand if the first one is a NaN
+    return _mm_min_ps( _mm_max_ps( v, _mm_setzero_ps() ), _mm_set1_ps(1.f) );
+}
+
+inline __m128i
+floatToByte_SSE2(__m128 v)
+{
+    return _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( clampUnit_SSE2(v), _mm_set1_ps(255.f) ), _mm_set1_ps(0.5f) ) );
+}
+
+int
+applyGainRow_SSE2(float* v,
+                  int width,
+                  float gain,
+                  float offset)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 o = _mm_set1_ps(offset);
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        _mm_storeu_ps( v + x, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(v + x), g), o) );
+    }
+
+    return x;
+}
+
+int
+applyGainGammaRow_SSE2(float* v,
+                       int width,
+                       float gain,
+                       float offset,
+                       const float* lut)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 o = _mm_set1_ps(offset);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 lutSize = _mm_set1_ps( (float)GAMMA_LUT_NB_VALUES );
+    const __m128i lastIndex = _mm_set1_epi32(GAMMA_LUT_NB_VALUES);
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128 s = _mm_mul_ps( clampUnit_SSE2( _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(v + x), g), o) ), lutSize );
+        __m128i i = _mm_cvttps_epi32(s);
+        __m128 alpha = clampUnit_SSE2( _mm_sub_ps( s, _mm_cvtepi32_ps(i) ) );
+        // i + 1 clamped to the last index: SSE2 has no _mm_min_epi32, but indices are positive and fit in 16 bits
+        __m128i next = _mm_min_epi16( _mm_add_epi32( i, _mm_set1_epi32(1) ), lastIndex );
+        int idx[4], nextIdx[4];
+        _mm_storeu_si128( (__m128i*)idx, i );
+        _mm_storeu_si128( (__m128i*)nextIdx, next );
+        __m128 lo = _mm_setr_ps(lut[idx[0]], lut[idx[1]], lut[idx[2]], lut[idx[3]]);
+        __m128 hi = _mm_setr_ps(lut[nextIdx[0]], lut[nextIdx[1]], lut[nextIdx[2]], lut[nextIdx[3]]);
+        _mm_storeu_ps( v + x, _mm_add_ps( _mm_mul_ps( lo, _mm_sub_ps(one, alpha) ), _mm_mul_ps(hi, alpha) ) );
+    }
+
+    return x;
+}
+
+int
+luminanceRow_SSE2(float* r,
+                  float* g,
+                  float* b,
+                  int width)
+{
+    const __m128 wr = _mm_set1_ps(0.299f);
+    const __m128 wg = _mm_set1_ps(0.587f);
+    const __m128 wb = _mm_set1_ps(0.114f);
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128 l = _mm_add_ps( _mm_add_ps( _mm_mul_ps( wr, _mm_loadu_ps(r + x) ), _mm_mul_ps( wg, _mm_loadu_ps(g + x) ) ),
+                               _mm_mul_ps( wb, _mm_loadu_ps(b + x) ) );
+        _mm_storeu_ps(r + x, l);
+        _mm_storeu_ps(g + x, l);
+        _mm_storeu_ps(b + x, l);
+    }
+
+    return x;
+}
+
+int
+packBGRA8Row_SSE2(const float* r,
+                  const float* g,
+                  const float* b,
+                  const float* a,
+                  const float* matte,
+                  int width,
+                  U32* dst)
+{
+    const __m128i maxByte = _mm_set1_epi32(255);
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i uR = floatToByte_SSE2( _mm_loadu_ps(r + x) );
+        if (matte) {
+            // values are at most 255 + 127, hence the 16-bit min is enough
+            uR = _mm_min_epi16( _mm_add_epi32( uR, _mm_srli_epi32(floatToByte_SSE2( _mm_loadu_ps(matte + x) ), 1) ), maxByte );
+        }
+        __m128i uG = floatToByte_SSE2( _mm_loadu_ps(g + x) );
+        __m128i uB = floatToByte_SSE2( _mm_loadu_ps(b + x) );
+        __m128i uA = floatToByte_SSE2( _mm_loadu_ps(a + x) );
+        __m128i texel = _mm_or_si128( _mm_or_si128( _mm_slli_epi32(uA, 24), _mm_slli_epi32(uR, 16) ),
+                                      _mm_or_si128( _mm_slli_epi32(uG, 8), uB ) );
+        _mm_storeu_si128( (__m128i*)(dst + x), texel );
+    }
+
+    return x;
+}
+
+int
+packRGBA32Row_SSE2(const float* r,
+                   const float* g,
+                   const float* b,
+                   const float* a,
+                   const float* matte,
+                   int width,
+                   float* dst)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128 vr = _mm_loadu_ps(r + x);
+        if (matte) {
+            vr = _mm_add_ps( vr, _mm_mul_ps(_mm_loadu_ps(matte + x), half) );
+        }
+        vr = clampUnit_SSE2(vr);
+        __m128 vg = clampUnit_SSE2( _mm_loadu_ps(g + x) );
+        __m128 vb = clampUnit_SSE2( _mm_loadu_ps(b + x) );
+        __m128 va = clampUnit_SSE2( _mm_loadu_ps(a + x) );
+        _MM_TRANSPOSE4_PS(vr, vg, vb, va);
+        _mm_storeu_ps(dst + x * 4, vr);
+        _mm_storeu_ps(dst + x * 4 + 4, vg);
+        _mm_storeu_ps(dst + x * 4 + 8, vb);
+        _mm_storeu_ps(dst + x * 4 + 12, va);
+    }
+
+    return x;
+}
+
+#endif // NATRON_USE_SSE2
+
+void
+applyGainGammaRow(float* v,
+                  int width,
+                  float gain,
+                  float offset,
+                  float gamma,
+                  const float* lut)
+{
+    if (gamma == 0.f) {
+        std::fill(v, v + width, 0.f);
+
+        return;
+    }
+    int x = 0;
+    if (gamma == 1.f) {
+#ifdef NATRON_USE_SSE2
+        if ( Color::isSIMDEnabled() ) {
+            x = applyGainRow_SSE2(v, width, gain, offset);
+        }
+#endif
+        for (; x < width; ++x) {
+            v[x] = v[x] * gain + offset;
+        }
+    } else {
+        assert(lut);
+#ifdef NATRON_USE_SSE2
+        if ( Color::isSIMDEnabled() ) {
+            x = applyGainGammaRow_SSE2(v, width, gain, offset, lut);
+        }
+#endif
+        for (; x < width; ++x) {
+            v[x] = lookupGammaLut(lut, v[x] * gain + offset);
+        }
+    }
+}
+
+void
+luminanceRow(float* r,
+             float* g,
+             float* b,
+             int width)
+{
+    int x = 0;
+
+#ifdef NATRON_USE_SSE2
+    if ( Color::isSIMDEnabled() ) {
+        x = luminanceRow_SSE2(r, g, b, width);
+    }
+#endif
+    for (; x < width; ++x) {
+        float l = 0.299f * r[x] + 0.587f * g[x] + 0.114f * b[x];
+        r[x] = l;
+        g[x] = l;
+        b[x] = l;
+    }
+}
+
+template <typename PIX>
+void
+getChannelRowForDepth(int nComps,
+                      int channel,
+                      const PIX* src,
+                      int width,
+                      float* dst)
+{
+    src += channel;
+    for (int x = 0; x < width; ++x, src += nComps) {
+        dst[x] = Color::intToFloat<256>(*src);
+    }
+}
+
+template <>
+void
+getChannelRowForDepth<unsigned short>(int nComps,
+                                      int channel,
+                                      const unsigned short* src,
+                                      int width,
+                                      float* dst)
+{
+    src += channel;
+    for (int x = 0; x < width; ++x, src += nComps) {
+        dst[x] = Color::intToFloat<65536>(*src);
+    }
+}
+
+template <>
+void
+getChannelRowForDepth<float>(int nComps,
+                             int channel,
+                             const float* src,
+                             int width,
+                             float* dst)
+{
+    src += channel;
+    for (int x = 0; x < width; ++x, src += nComps) {
+        dst[x] = *src;
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+ViewerTextureRowConverter::ViewerTextureRowConverter(const ViewerTextureConvertArgs& args,
+                                                     int maxWidth)
+    : _args(args)
+    , _deinterleave(0)
+    , _interleaved(args.srcDepth == eImageBitDepthFloat ? 0 : maxWidth * args.srcNComps)
+    , _r(maxWidth)
+    , _g(maxWidth)
+    , _b(maxWidth)
+    , _a(maxWidth)
+{
+    if (args.opaque) {
+        _deinterleave = getDeinterleaveRowFuncForOpaque<true>(args);
+    } else {
+        _deinterleave = getDeinterleaveRowFuncForOpaque<false>(args);
+    }
+}
+
+void
+ViewerTextureRowConverter::loadRow(const void* src,
+                                   int width)
+{
+    assert( width <= (int)_r.size() );
+    float* r = &_r[0];
+    float* g = &_g[0];
+    float* b = &_b[0];
+    float* a = &_a[0];
+
+    const float* interleaved = 0;
+    if (src) {
+        switch (_args.srcDepth) {
+        case eImageBitDepthFloat:
+            interleaved = (const float*)src;
+            break;
+        case eImageBitDepthByte:
+            Color::convertDepthRow( (const unsigned char*)src, &_interleaved[0], width * _args.srcNComps );
+            interleaved = &_interleaved[0];
+            break;
+        case eImageBitDepthShort:
+            Color::convertDepthRow( (const unsigned short*)src, &_interleaved[0], width * _args.srcNComps );
+            interleaved = &_interleaved[0];
+            break;
+        case eImageBitDepthHalf:
+        case eImageBitDepthNone:
+            assert(false);
+            break;
+        }
+    }
+    if (!interleaved) {
+        std::fill(r, r + width, 0.f);
+        std::fill(g, g + width, 0.f);
+        std::fill(b, b + width, 0.f);
+        std::fill(a, a + width, 0.f);
+
+        return;
+    }
+
+    if (_deinterleave) {
+        _deinterleave(interleaved, width, r, g, b, a);
+    } else {
+        deinterleaveRowGeneric(_args, interleaved, width, r, g, b, a);
+    }
+
+    if (_args.srcColorSpace) {
+        switch (_args.srcDepth) {
+        case eImageBitDepthFloat:
+            rowToLinear(_args, (const float*)src, width, r, g, b);
+            break;
+        case eImageBitDepthByte:
+            rowToLinear(_args, (const unsigned char*)src, width, r, g, b);
+            break;
+        case eImageBitDepthShort:
+            rowToLinear(_args, (const unsigned short*)src, width, r, g, b);
+            break;
+        default:
+            break;
+        }
+    }
+} // ViewerTextureRowConverter::loadRow
+
+void
+ViewerTextureRowConverter::convertRowTo8bits(const void* src,
+                                             const float* matte,
+                                             int width,
+                                             int ditherStart,
+                                             U32* dst)
+{
+    if (width <= 0) {
+        return;
+    }
+    loadRow(src, width);
+
+    float* r = &_r[0];
+    float* g = &_g[0];
+    float* b = &_b[0];
+    const float* a = &_a[0];
+
+    applyGainGammaRow(r, width, _args.gain, _args.offset, _args.gamma, _args.gammaLut);
+    applyGainGammaRow(g, width, _args.gain, _args.offset, _args.gamma, _args.gammaLut);
+    applyGainGammaRow(b, width, _args.gain, _args.offset, _args.gamma, _args.gammaLut);
+
+    if (_args.luminance) {
+        luminanceRow(r, g, b, width);
+    }
+
+    if (!_args.colorSpace) {
+        int x = 0;
+#ifdef NATRON_USE_SSE2
+        if ( Color::isSIMDEnabled() ) {
+            x = packBGRA8Row_SSE2(r, g, b, a, matte, width, dst);
+        }
+#endif
+        for (; x < width; ++x) {
+            int uR = floatToByte(r[x]);
+            if (matte) {
+                uR = std::min(uR + floatToByte(matte[x]) / 2, 255);
+            }
+            dst[x] = toBGRA( uR, floatToByte(g[x]), floatToByte(b[x]), floatToByte(a[x]) );
+        }
+
+        return;
+    }
+
+    // Error diffusion is sequential: start at a random position in the row so that the error pattern does not
+    // appear as vertical lines, and diffuse forward then backward from there.
+    assert(ditherStart >= 0 && ditherStart < width);
+    const Color::Lut* lut = _args.colorSpace;
+    for (int backward = 0; backward < 2; ++backward) {
+        unsigned errorR = 0x80;
+        unsigned errorG = 0x80;
+        unsigned errorB = 0x80;
+        const int step = backward ? -1 : 1;
+        for (int x = backward ? ditherStart - 1 : ditherStart; x >= 0 && x < width; x += step) {
+            errorR = (errorR & 0xff) + lut->toColorSpaceUint8xxFromLinearFloatFast(r[x]);
+            errorG = (errorG & 0xff) + lut->toColorSpaceUint8xxFromLinearFloatFast(g[x]);
+            errorB = (errorB & 0xff) + lut->toColorSpaceUint8xxFromLinearFloatFast(b[x]);
+            assert(errorR < 0x10000 && errorG < 0x10000 && errorB < 0x10000);
+            int uR = (int)(errorR >> 8);
+            if (matte) {
+                uR = std::min(uR + lut->toColorSpaceUint8FromLinearFloatFast(matte[x]) / 2, 255);
+            }
+            dst[x] = toBGRA( uR, (int)(errorG >> 8), (int)(errorB >> 8), floatToByte(a[x]) );
+        }
+    }
+} // ViewerTextureRowConverter::convertRowTo8bits
+
+void
+ViewerTextureRowConverter::convertRowTo32bits(const void* src,
+                                              const float* matte,
+                                              int width,
+                                              float* dst)
+{
+    if (width <= 0) {
+        return;
+    }
+    loadRow(src, width);
+
+    float* r = &_r[0];
+    float* g = &_g[0];
+    float* b = &_b[0];
+    const float* a = &_a[0];
+
+    if (_args.luminance) {
+        luminanceRow(r, g, b, width);
+    }
+
+    int x = 0;
+#ifdef NATRON_USE_SSE2
+    if ( Color::isSIMDEnabled() ) {
+        x = packRGBA32Row_SSE2(r, g, b, a, matte, width, dst);
+    }
+#endif
+    for (; x < width; ++x) {
+        float vr = r[x];
+        if (matte) {
+            vr += matte[x] * 0.5f;
+        }
+        dst[x * 4] = clampUnit(vr);
+        dst[x * 4 + 1] = clampUnit(g[x]);
+        dst[x * 4 + 2] = clampUnit(b[x]);
+        dst[x * 4 + 3] = clampUnit(a[x]);
+    }
+}
+
+void
+ViewerTextureRowConverter::getChannelRow(ImageBitDepthEnum depth,
+                                         int nComps,
+                                         int channel,
+                                         const void* src,
+                                         int width,
+                                         float* dst)
+{
+    if ( !src || (channel < 0) || (channel >= nComps) ) {
+        std::fill(dst, dst + width, 0.f);
+
+        return;
+    }
+    switch (depth) {
+    case eImageBitDepthByte:
+        getChannelRowForDepth(nComps, channel, (const unsigned char*)src, width, dst);
+        break;
+    case eImageBitDepthShort:
+        getChannelRowForDepth(nComps, channel, (const unsigned short*)src, width, dst);
+        break;
+    case eImageBitDepthFloat:
+        getChannelRowForDepth(nComps, channel, (const float*)src, width, dst);
+        break;
+    case eImageBitDepthHalf:
+    case eImageBitDepthNone:
+        std::fill(dst, dst + width, 0.f);
+        break;
+    }
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,147 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_ViewerTextureConvert_h
+#define Natron_Engine_ViewerTextureConvert_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/EngineFwd.h"
+
+#define GAMMA_LUT_NB_VALUES 1023
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Describes how the pixels of the image displayed by a viewer are converted to its OpenGL texture.
+ **/
+struct ViewerTextureConvertArgs
+{
+    ImageBitDepthEnum srcDepth;
+    int srcNComps;
+
+    // Index in a source pixel of the channel displayed in the red, green and blue channels of the texture.
+    // A channel whose index is not lower than srcNComps is black.
+    int rOffset, gOffset, bOffset;
+
+    // If true the alpha channel of the source is ignored and the texture is opaque
+    bool opaque;
+
+    // If true the luminance of the color is displayed
+    bool luminance;
+
+    // Only used for 8-bit textures: with float textures they are applied by the OpenGL shader
+    float gain;
+    float offset;
+    // This is 1 / gamma: 0 means the texture is black, 1 means gamma is not applied
+    float gamma;
+    // GAMMA_LUT_NB_VALUES + 1 samples of pow(x, gamma) in [0,1], only read when gamma is neither 0 nor 1
+    const float* gammaLut;
+
+    // Color-space of the source (NULL if linear) and of the 8-bit texture (NULL if linear)
+    const Color::Lut* srcColorSpace;
+    const Color::Lut* colorSpace;
+
+    ViewerTextureConvertArgs()
+        : srcDepth(eImageBitDepthFloat)
+        , srcNComps(4)
+        , rOffset(0)
+        , gOffset(1)
+        , bOffset(2)
+        , opaque(false)
+        , luminance(false)
+        , gain(1.f)
+        , offset(0.f)
+        , gamma(1.f)
+        , gammaLut(0)
+        , srcColorSpace(0)
+        , colorSpace(0)
+    {
+    }
+};
+
+/**
+ * @brief Converts rows of the image displayed by a viewer to its 8-bit BGRA or float RGBA texture.
+ * Each row goes through a few passes over planar float buffers (depth conversion, channel selection, fused
+ * gain/offset/gamma, luminance, packing): each pass is specialized for the source layout and channels at
+ * construction, and the arithmetic passes use SSE2 when Color::isSIMDEnabled().
+ * A converter holds scratch buffers, hence it must only be used by one thread at a time.
+ **/
+class ViewerTextureRowConverter
+{
+public:
+
+    typedef void (*DeinterleaveRowFunc)(const float* src, int width, float* r, float* g, float* b, float* a);
+
+    /**
+     * @brief maxWidth is the maximum number of pixels passed to the convert functions
+     **/
+    ViewerTextureRowConverter(const ViewerTextureConvertArgs& args,
+                              int maxWidth);
+
+    /**
+     * @brief Converts width pixels of src to BGRA 8-bit texels. If src is NULL the pixels are considered black and transparent.
+     * If matte is not NULL, the matte values (linear, in [0,1]) are added in red at half intensity.
+     * When converting to a color-space, the quantization error is diffused from ditherStart forward, then backward.
+     **/
+    void convertRowTo8bits(const void* src,
+                           const float* matte,
+                           int width,
+                           int ditherStart,
+                           U32* dst);
+
+    /**
+     * @brief Converts width pixels of src to RGBA float texels clamped to [0,1].
+     **/
+    void convertRowTo32bits(const void* src,
+                            const float* matte,
+                            int width,
+                            float* dst);
+
+    /**
+     * @brief Extracts one channel of width pixels of src, converted to float without any color-space conversion.
+     **/
+    static void getChannelRow(ImageBitDepthEnum depth,
+                              int nComps,
+                              int channel,
+                              const void* src,
+                              int width,
+                              float* dst);
+
+private:
+
+    void loadRow(const void* src, int width);
+
+    ViewerTextureConvertArgs _args;
+    DeinterleaveRowFunc _deinterleave;
+    std::vector<float> _interleaved;
+    std::vector<float> _r, _g, _b, _a;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_ViewerTextureConvert_h
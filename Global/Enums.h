@@ -467,6 +467,12 @@ enum StorageModeEnum
     eStorageModeGLTex //< will be allocated as an OpenGL texture
 };
 
+enum CacheEvictionPolicyEnum
+{
+    eCacheEvictionPolicyLRU = 0, //< the least recently used entry is evicted first
+    eCacheEvictionPolicy2Q //< entries used only once are evicted before the ones used again after a while, so that scans do not evict the working set
+};
+
 enum OrientationEnum
 {
     eOrientationHorizontal = 0x1,
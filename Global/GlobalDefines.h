@@ -115,7 +115,7 @@ typedef OfxRangeD RangeD;
 #define kBgProcessServerCreatedShort "--bg_server_created"
 
 //Increment this to wipe all disk cache structure and ensure that the user has a clean cache when starting the next version of Natron
-#define NATRON_CACHE_VERSION 4
+#define NATRON_CACHE_VERSION 6
 #define kNatronCacheVersionSettingsKey "NatronCacheVersionSettingsKey"
 
 
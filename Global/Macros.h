@@ -36,6 +36,12 @@
 #define __NATRON_LINUX__
 #endif
 
+// SSE2 is always available on x86-64, and on x86 when the compiler was told to use it.
+// Files using the SSE2 intrinsics should include <emmintrin.h> when this is defined.
+#if !defined(SBK_RUN) && ( defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) )
+#define NATRON_USE_SSE2
+#endif
+
 #ifdef SBK_RUN
 
 // run shiboken without the Natron namespace, and add NATRON_NAMESPACE_USING to each cpp afterwards
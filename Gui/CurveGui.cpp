@@ -27,6 +27,7 @@
 #include <cmath>
 #include <algorithm> // min, max
 #include <stdexcept>
+#include <vector>
 
 #include <QtCore/QThread>
 #include <QtCore/QObject>
@@ -216,6 +217,17 @@ CurveGui::getCurveYRange() const
     return getInternalCurve()->getCurveYRange();
 }
 
+void
+CurveGui::evaluateValues(bool useExpr,
+                         const double* x,
+                         int n,
+                         double* y) const
+{
+    for (int i = 0; i < n; ++i) {
+        y[i] = evaluate(useExpr, x[i]);
+    }
+}
+
 CurvePtr
 CurveGui::getInternalCurve() const
 {
@@ -326,26 +338,42 @@ CurveGui::drawCurve(int curveIndex,
             std::list<double>::const_iterator lastUpperItCoords = keysWidgetCoords.end();
             KeyFrameSet::const_iterator lastUpperIt = keyframes.end();
 
+            // The points do not depend on the values of the curve: find them all first and evaluate the curve at once
+            std::vector<double> xs, ys;
+            std::vector<double> evaluatedXs;
+            std::vector<std::size_t> evaluatedIndices;
             while ( x1 < (widgetWidth - 1) ) {
-                double x, y;
                 if (!isX1AKey) {
-                    x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                    y = evaluate(false, x);
+                    double x = _curveWidget->toZoomCoordinates(x1, 0).x();
+                    evaluatedIndices.push_back( xs.size() );
+                    evaluatedXs.push_back(x);
+                    xs.push_back(x);
+                    ys.push_back(0.);
                 } else {
-                    x = x1Key.getTime();
-                    y = x1Key.getValue();
+                    xs.push_back( x1Key.getTime() );
+                    ys.push_back( x1Key.getValue() );
                 }
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
                 nextPointForSegment(x1, keyframes, keysWidgetCoords, curveYRange, xminCurveWidgetCoord, xmaxCurveWidgetCoord, &lastUpperIt, &lastUpperItCoords, &x2, &x1Key, &isX1AKey);
                 x1 = x2;
             }
             //also add the last point
             {
                 double x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                double y = evaluate(false, x);
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
+                evaluatedIndices.push_back( xs.size() );
+                evaluatedXs.push_back(x);
+                xs.push_back(x);
+                ys.push_back(0.);
+            }
+
+            std::vector<double> evaluatedYs( evaluatedXs.size() );
+            evaluateValues( false, &evaluatedXs[0], (int)evaluatedXs.size(), &evaluatedYs[0] );
+            for (std::size_t i = 0; i < evaluatedIndices.size(); ++i) {
+                ys[evaluatedIndices[i]] = evaluatedYs[i];
+            }
+            vertices.reserve( vertices.size() + 2 * xs.size() );
+            for (std::size_t i = 0; i < xs.size(); ++i) {
+                vertices.push_back( (float)xs[i] );
+                vertices.push_back( (float)ys[i] );
             }
         } catch (...) {
         }
@@ -656,6 +684,26 @@ KnobCurveGui::evaluate(bool useExpr,
     }
 }
 
+void
+KnobCurveGui::evaluateValues(bool useExpr,
+                             const double* x,
+                             int n,
+                             double* y) const
+{
+    if (useExpr) {
+        CurveGui::evaluateValues(useExpr, x, n, y);
+    } else {
+        KnobParametricPtr isParametric = toKnobParametric( getInternalKnob() );
+        if (isParametric) {
+            isParametric->getParametricCurve(_dimension)->getValuesAt(x, n, y);
+        } else {
+            assert(_internalCurve);
+
+            _internalCurve->getValuesAt(x, n, y, false);
+        }
+    }
+}
+
 CurvePtr
 KnobCurveGui::getInternalCurve() const
 {
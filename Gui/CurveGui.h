@@ -116,6 +116,11 @@ public:
      * The coordinates are those of the curve, not of the widget.
      **/
     virtual double evaluate(bool useExpr, double x) const = 0;
+
+    /**
+     * @brief Same as evaluate for each of the n positions in x, written to y.
+     **/
+    virtual void evaluateValues(bool useExpr, const double* x, int n, double* y) const;
     virtual CurvePtr  getInternalCurve() const;
 
     void drawCurve(int curveIndex, int curvesCount);
@@ -197,6 +202,7 @@ public:
     }
 
     virtual double evaluate(bool useExpr, double x) const OVERRIDE FINAL WARN_UNUSED_RETURN;
+    virtual void evaluateValues(bool useExpr, const double* x, int n, double* y) const OVERRIDE FINAL;
     RotoContextPtr getRotoContext() const { return _roto; }
 
     KnobIPtr getInternalKnob() const;
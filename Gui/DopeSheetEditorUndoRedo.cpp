@@ -962,35 +962,32 @@ DSPasteKeysCommand::addOrRemoveKeyframe(bool add)
         if (!knobContext) {
             continue;
         }
-        for (std::size_t i = 0; i < _keys.size(); ++i) {
-
-            int dim = knobContext->getDimension();
-            KnobIPtr knob = knobContext->getInternalKnob();
-            knob->beginChanges();
+        int dim = knobContext->getDimension();
+        KnobIPtr knob = knobContext->getInternalKnob();
 
+        // Paste all keyframes at once: pasted curves may have a keyframe on every frame
+        std::list<KeyFrame> keys;
+        std::list<double> times;
+        for (std::size_t i = 0; i < _keys.size(); ++i) {
             double keyTime = _keys[i].key.getTime();
             double setTime = _pasteRelativeToRefTime ? keyTime - _keys[_refKeyindex].key.getTime() + _refTime : keyTime;
+            KeyFrame k = _keys[i].key;
+            k.setTime(setTime);
+            keys.push_back(k);
+            times.push_back(setTime);
+        }
 
-            if (add) {
-
-                for (int j = 0; j < knob->getDimension(); ++j) {
-                    if ( (dim == -1) || (j == dim) ) {
-                        KeyFrame k = _keys[i].key;
-                        k.setTime(setTime);
-
-                        knob->setKeyFrame(k, ViewSpec::all(), j, eValueChangedReasonNatronGuiEdited);
-                    }
-                }
-            } else {
-                for (int j = 0; j < knob->getDimension(); ++j) {
-                    if ( (dim == -1) || (j == dim) ) {
-                        knob->deleteValueAtTime(eCurveChangeReasonDopeSheet, setTime, ViewSpec::all(), j, i == 0);
-                    }
+        knob->beginChanges();
+        for (int j = 0; j < knob->getDimension(); ++j) {
+            if ( (dim == -1) || (j == dim) ) {
+                if (add) {
+                    knob->setKeyFrames(keys, ViewSpec::all(), j, eValueChangedReasonNatronGuiEdited);
+                } else {
+                    knob->deleteValuesAtTime(eCurveChangeReasonDopeSheet, times, ViewSpec::all(), j, true);
                 }
             }
-            
-            knob->endChanges();
         }
+        knob->endChanges();
     }
 
 
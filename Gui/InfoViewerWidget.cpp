@@ -37,6 +37,7 @@
 #include "Engine/ViewerInstance.h"
 #include "Engine/Lut.h"
 #include "Engine/Image.h"
+#include "Engine/Utils.h" // convertFromPlainText
 #include "Gui/GuiApplicationManager.h"
 #include "Gui/ViewerGL.h"
 #include "Gui/Label.h"
@@ -191,10 +192,11 @@ InfoViewerWidget::setFps(double actualFps,
     } else if ( actualFps < (desiredFps / 2.f) ) {
         colorStr = QString::fromUtf8("red");
     }
-    QString str = QString::fromUtf8("<font color=\"") + colorStr + QString::fromUtf8("\" face=\"%2\" size=%3>%1 fps</font>")
+    QString str = QString::fromUtf8("<font color=\"") + colorStr + QString::fromUtf8("\" face=\"%2\" size=%3>%1 fps%4</font>")
                   .arg( QString::number(actualFps, 'f', 1) )
                   .arg( font.family() )
-                  .arg( font.pixelSize() );
+                  .arg( font.pixelSize() )
+                  .arg(_playbackBufferText);
 
     _fpsLabel->setText(str);
     if ( !_fpsLabel->isVisible() ) {
@@ -202,9 +204,29 @@ InfoViewerWidget::setFps(double actualFps,
     }
 }
 
+void
+InfoViewerWidget::setPlaybackBufferStats(int bufferedFrames,
+                                         int readAheadFrames,
+                                         int underruns,
+                                         int cancelledFrames)
+{
+    _playbackBufferText = QString::fromUtf8(" (%1/%2)").arg(bufferedFrames).arg(readAheadFrames);
+    _fpsLabel->setToolTip( NATRON_NAMESPACE::convertFromPlainText(tr("Frames rendered ahead of the playhead: %1 out of %2.\n"
+                                                                    "Underruns (frames displayed late because they were not rendered yet): %3.\n"
+                                                                    "Frames discarded because the playhead jumped: %4.\n"
+                                                                    "If underruns keep increasing, raise the \"Playback read-ahead\" "
+                                                                    "in the Threading tab of the preferences.")
+                                                                 .arg(bufferedFrames)
+                                                                 .arg(readAheadFrames)
+                                                                 .arg(underruns)
+                                                                 .arg(cancelledFrames), NATRON_NAMESPACE::WhiteSpaceNormal) );
+}
+
 void
 InfoViewerWidget::hideFps()
 {
+    _playbackBufferText.clear();
+    _fpsLabel->setToolTip( QString() );
     if ( _fpsLabel->isVisible() ) {
         _fpsLabel->hide();
     }
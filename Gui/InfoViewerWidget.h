@@ -79,6 +79,7 @@ public Q_SLOTS:
     void hideColorAndMouseInfo();
     void showColorAndMouseInfo();
     void setFps(double actualFps, double desiredFps);
+    void setPlaybackBufferStats(int bufferedFrames, int readAheadFrames, int underruns, int cancelledFrames);
     void hideFps();
 
 private:
@@ -100,6 +101,7 @@ private:
     Label* color;
     Label* hvl_lastOption;
     Label* _fpsLabel;
+    QString _playbackBufferText; //< fill of the read-ahead buffer, displayed after the fps
     ImageComponents _comp;
     bool _colorValid;
     bool _colorApprox;
@@ -25,6 +25,7 @@
 #include "NodeGraph.h"
 #include "NodeGraphPrivate.h"
 
+#include <algorithm> // max
 #include <cmath>
 #include <stdexcept>
 
@@ -40,6 +41,8 @@ CLANG_DIAG_ON(uninitialized)
 
 #include <SequenceParsing.h>
 
+#include "Engine/BufferPool.h"
+#include "Engine/Cache.h" // CacheCompressionStats
 #include "Engine/KnobSerialization.h" // createDefaultValueForParam
 #include "Engine/Node.h"
 #include "Engine/Project.h"
@@ -261,6 +264,24 @@ NodeGraph::updateCacheSizeText()
     quint64 diskSize = appPTR->getCachesTotalDiskSize();
     QString diskCacheSizeStr = QDirModelPrivate_size(diskSize);
     QString newText = tr("Memory cache: %1 / Disk cache: %2").arg(cacheSizeStr).arg(diskCacheSizeStr);
+    CacheCompressionStats compressionStats = appPTR->getNodeCacheCompressionStats();
+    if (compressionStats.nEntries > 0) {
+        double avgDecompressionTime = compressionStats.nDecompressions ? compressionStats.decompressionTime * 1000. / compressionStats.nDecompressions : 0.;
+        newText.append( tr(" / Compressed: %1 (ratio %2:1, %3 ms per decompression)")
+                        .arg( QDirModelPrivate_size(compressionStats.compressedSize) )
+                        .arg( (double)compressionStats.originalSize / std::max( (std::size_t)1, compressionStats.compressedSize ), 0, 'f', 1 )
+                        .arg(avgDecompressionTime, 0, 'f', 2) );
+    }
+    CacheAccessStats accessStats = appPTR->getNodeCacheAccessStats();
+    if (accessStats.memoryHits + accessStats.compressedHits + accessStats.diskHits + accessStats.misses > 0) {
+        newText.append( tr(" / Hit rate: %1%").arg(accessStats.getHitRate() * 100., 0, 'f', 1) );
+    }
+    BufferPoolStats poolStats = BufferPool::getStats();
+    if (poolStats.nAllocations > 0) {
+        newText.append( tr(" / Buffer pool: %1 (%2% reused)")
+                        .arg( QDirModelPrivate_size(poolStats.retainedSize) )
+                        .arg(poolStats.nReused * 100. / poolStats.nAllocations, 0, 'f', 1) );
+    }
     if (newText != oldText) {
         _imp->_cacheSizeText->setText(newText);
     }
@@ -703,6 +703,8 @@ struct RenderStatsDialogPrivate
     Label* totalTimeSpentDescLabel;
     Label* totalTimeSpentValueLabel;
     double totalSpentTime;
+    Label* nodesRehashedDescLabel;
+    Label* nodesRehashedValueLabel;
     Button* resetButton;
     QWidget* filterContainer;
     QHBoxLayout* filterLayout;
@@ -729,6 +731,8 @@ struct RenderStatsDialogPrivate
         , totalTimeSpentDescLabel(0)
         , totalTimeSpentValueLabel(0)
         , totalSpentTime(0)
+        , nodesRehashedDescLabel(0)
+        , nodesRehashedValueLabel(0)
         , resetButton(0)
         , filterContainer(0)
         , filterLayout(0)
@@ -810,6 +814,19 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
     _imp->globalInfosLayout->addWidget(_imp->totalTimeSpentDescLabel);
     _imp->globalInfosLayout->addWidget(_imp->totalTimeSpentValueLabel);
 
+    _imp->globalInfosLayout->addSpacing(10);
+
+    QString rehashTt = NATRON_NAMESPACE::convertFromPlainText(tr("Number of nodes whose own hash had to be recomputed by the last edit of the node graph "
+                                                                 "before the last frame was rendered. The other nodes downstream of the edit only combined "
+                                                                 "their inputs hash again."), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->nodesRehashedDescLabel = new Label(tr("Nodes rehashed by last edit:"), _imp->globalInfosContainer);
+    _imp->nodesRehashedDescLabel->setToolTip(rehashTt);
+    _imp->nodesRehashedValueLabel = new Label(QString::fromUtf8("0"), _imp->globalInfosContainer);
+    _imp->nodesRehashedValueLabel->setToolTip(rehashTt);
+
+    _imp->globalInfosLayout->addWidget(_imp->nodesRehashedDescLabel);
+    _imp->globalInfosLayout->addWidget(_imp->nodesRehashedValueLabel);
+
     _imp->resetButton = new Button(tr("Reset"), _imp->globalInfosContainer);
     _imp->resetButton->setToolTip( tr("Clears the statistics.") );
     QObject::connect( _imp->resetButton, SIGNAL(clicked(bool)), this, SLOT(resetStats()) );
@@ -972,12 +989,14 @@ RenderStatsDialog::resetStats()
     _imp->model->clearRows();
     _imp->totalTimeSpentValueLabel->setText( QString::fromUtf8("0.0 sec") );
     _imp->totalSpentTime = 0;
+    _imp->nodesRehashedValueLabel->setText( QString::fromUtf8("0") );
 }
 
 void
 RenderStatsDialog::addStats(int /*time*/,
                             ViewIdx /*view*/,
                             double wallTime,
+                            int nodesRehashedByLastEdit,
                             const std::map<NodePtr, NodeRenderStats >& stats)
 {
     if ( !_imp->accumulateCheckbox->isChecked() ) {
@@ -987,6 +1006,7 @@ RenderStatsDialog::addStats(int /*time*/,
 
     _imp->totalSpentTime += wallTime;
     _imp->totalTimeSpentValueLabel->setText( Timer::printAsTime(_imp->totalSpentTime, false) );
+    _imp->nodesRehashedValueLabel->setText( QString::number(nodesRehashedByLastEdit) );
 
     for (std::map<NodePtr, NodeRenderStats >::const_iterator it = stats.begin(); it != stats.end(); ++it) {
         _imp->model->editNodeRow(it->first, it->second);
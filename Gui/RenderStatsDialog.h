@@ -61,7 +61,7 @@ public:
 
     virtual ~RenderStatsDialog();
 
-    void addStats(int time, ViewIdx view, double wallTime, const std::map<NodePtr, NodeRenderStats >& stats);
+    void addStats(int time, ViewIdx view, double wallTime, int nodesRehashedByLastEdit, const std::map<NodePtr, NodeRenderStats >& stats);
 
 public Q_SLOTS:
 
@@ -1000,8 +1000,8 @@ ViewerTab::ViewerTab(const std::list<NodeGuiPtr> & existingNodesContext,
     ViewerInstancePtr viewerNode = _imp->viewerNode.lock();
     NodePtr wrapperNode = viewerNode->getNode();
     RenderEnginePtr engine = viewerNode->getRenderEngine();
-    QObject::connect( viewerNode.get(), SIGNAL(renderStatsAvailable(int,ViewIdx,double,RenderStatsMap)),
-                      this, SLOT(onRenderStatsAvailable(int,ViewIdx,double,RenderStatsMap)) );
+    QObject::connect( viewerNode.get(), SIGNAL(renderStatsAvailable(int,ViewIdx,double,int,RenderStatsMap)),
+                      this, SLOT(onRenderStatsAvailable(int,ViewIdx,double,int,RenderStatsMap)) );
     QObject::connect( wrapperNode.get(), SIGNAL(inputChanged(int)), this, SLOT(onInputChanged(int)) );
     QObject::connect( wrapperNode.get(), SIGNAL(inputLabelChanged(int,QString)), this, SLOT(onInputNameChanged(int,QString)) );
     QObject::connect( viewerNode.get(), SIGNAL(clipPreferencesChanged()), this, SLOT(onClipPreferencesChanged()) );
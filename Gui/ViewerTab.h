@@ -439,7 +439,7 @@ public Q_SLOTS:
 
     void onSyncViewersButtonPressed(bool clicked);
 
-    void onRenderStatsAvailable(int time, ViewIdx view, double wallTime, const RenderStatsMap& stats);
+    void onRenderStatsAvailable(int time, ViewIdx view, double wallTime, int nodesRehashedByLastEdit, const RenderStatsMap& stats);
 
     void nextLayer();
     void previousLayer();
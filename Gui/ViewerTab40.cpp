@@ -148,10 +148,13 @@ ViewerTab::manageSlotsForInfoWidget(int textureIndex,
     assert(engine);
     if (connect) {
         QObject::connect( engine.get(), SIGNAL(fpsChanged(double,double)), _imp->infoWidget[textureIndex], SLOT(setFps(double,double)) );
+        QObject::connect( engine.get(), SIGNAL(playbackBufferStatsChanged(int,int,int,int)), _imp->infoWidget[textureIndex], SLOT(setPlaybackBufferStats(int,int,int,int)) );
         QObject::connect( engine.get(), SIGNAL(renderFinished(int)), _imp->infoWidget[textureIndex], SLOT(hideFps()) );
     } else {
         QObject::disconnect( engine.get(), SIGNAL(fpsChanged(double,double)), _imp->infoWidget[textureIndex],
                              SLOT(setFps(double,double)) );
+        QObject::disconnect( engine.get(), SIGNAL(playbackBufferStatsChanged(int,int,int,int)), _imp->infoWidget[textureIndex],
+                             SLOT(setPlaybackBufferStats(int,int,int,int)) );
         QObject::disconnect( engine.get(), SIGNAL(renderFinished(int)), _imp->infoWidget[textureIndex], SLOT(hideFps()) );
     }
 }
@@ -1288,12 +1291,13 @@ void
 ViewerTab::onRenderStatsAvailable(int time,
                                   ViewIdx view,
                                   double wallTime,
+                                  int nodesRehashedByLastEdit,
                                   const RenderStatsMap& stats)
 {
     assert( QThread::currentThread() == qApp->thread() );
     RenderStatsDialog* dialog = getGui()->getRenderStatsDialog();
     if (dialog) {
-        dialog->addStats(time, view, wallTime, stats);
+        dialog->addStats(time, view, wallTime, nodesRehashedByLastEdit, stats);
     }
 }
 
@@ -0,0 +1,296 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/Bezier.h"
+#include "Engine/BezierTessellationCache.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+/**
+ * @brief The control points of a closed shape: 4 per segment, the last point of a segment being the first of the next one.
+ **/
+typedef std::vector<Point> ShapeControlPoints;
+
+static ShapeControlPoints
+makeCircle(int nSegments,
+           double radius)
+{
+    ShapeControlPoints ret;
+    const double step = 2. * M_PI / nSegments;
+    // Tangent length approximating a circle with cubic segments
+    const double tangent = radius * 4. / 3. * std::tan(step / 4.);
+
+    for (int i = 0; i < nSegments; ++i) {
+        double a0 = step * i;
+        double a1 = step * (i + 1);
+        Point p[4];
+        p[0].x = radius * std::cos(a0);
+        p[0].y = radius * std::sin(a0);
+        p[1].x = p[0].x - tangent * std::sin(a0);
+        p[1].y = p[0].y + tangent * std::cos(a0);
+        p[3].x = radius * std::cos(a1);
+        p[3].y = radius * std::sin(a1);
+        p[2].x = p[3].x + tangent * std::sin(a1);
+        p[2].y = p[3].y - tangent * std::cos(a1);
+        ret.insert(ret.end(), p, p + 4);
+    }
+
+    return ret;
+}
+
+static void
+tessellateSegment(const Point* cps,
+                  int nbPointsPerSegment,
+                  std::vector<ParametricPoint>* points)
+{
+    double incr = 1. / (double)(nbPointsPerSegment - 1);
+
+    for (int i = 0; i < nbPointsPerSegment; ++i) {
+        ParametricPoint p;
+        Point cur;
+        p.t = incr * i;
+        Bezier::bezierPoint(cps[0], cps[1], cps[2], cps[3], p.t, &cur);
+        p.x = cur.x;
+        p.y = cur.y;
+        points->push_back(p);
+    }
+}
+
+// Tessellates the shape the way Bezier does, with or without the cache
+static void
+tessellate(const ShapeControlPoints& shape,
+           const BezierTessellationCache::Key& key,
+           BezierTessellationCache* cache,
+           std::vector<ParametricPoint>* points)
+{
+    const int nbPointsPerSegment = (int)key.tessellation;
+
+    points->clear();
+    if (cache) {
+        cache->begin(key);
+    }
+    for (std::size_t i = 0; i < shape.size(); i += 4) {
+        if (!cache) {
+            tessellateSegment(&shape[i], nbPointsPerSegment, points);
+            continue;
+        }
+        std::vector<ParametricPoint>& cachedPoints = cache->getPoints();
+        std::size_t firstPoint = cachedPoints.size();
+        if ( !cache->appendCachedSegment(&shape[i]) ) {
+            tessellateSegment(&shape[i], nbPointsPerSegment, &cachedPoints);
+            cache->appendSegment(&shape[i], firstPoint);
+        }
+        points->insert( points->end(), cachedPoints.begin() + firstPoint, cachedPoints.end() );
+    }
+    if (cache) {
+        cache->end();
+    }
+}
+
+static void
+expectSamePoints(const std::vector<ParametricPoint>& expected,
+                 const std::vector<ParametricPoint>& points)
+{
+    ASSERT_EQ( expected.size(), points.size() );
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i].x, points[i].x);
+        EXPECT_EQ(expected[i].y, points[i].y);
+        EXPECT_EQ(expected[i].t, points[i].t);
+    }
+}
+
+// Returns the counters accumulated since start
+static BezierTessellationStats
+getStatsSince(const BezierTessellationStats& start)
+{
+    BezierTessellationStats ret = BezierTessellationCache::getStats();
+
+    ret.tessellations -= start.tessellations;
+    ret.segmentsReused -= start.segmentsReused;
+    ret.segmentsEvaluated -= start.segmentsEvaluated;
+
+    return ret;
+}
+
+static BezierTessellationCache::Key
+makeKey(double time,
+        unsigned int mipMapLevel)
+{
+    BezierTessellationCache::Key key;
+
+    key.time = time;
+    key.mipMapLevel = mipMapLevel;
+    key.tessellation = 20;
+
+    return key;
+}
+
+TEST(BezierTessellationCache, OnlyChangedSegmentsAreEvaluated) {
+    BezierTessellationCache cache;
+    ShapeControlPoints shape = makeCircle(8, 100.);
+    std::vector<ParametricPoint> expected, points;
+    BezierTessellationStats start = BezierTessellationCache::getStats();
+
+    tessellate(shape, makeKey(1, 0), &cache, &points);
+    tessellate(shape, makeKey(1, 0), 0, &expected);
+    expectSamePoints(expected, points);
+    BezierTessellationStats stats = getStatsSince(start);
+    EXPECT_EQ( (U64)1, stats.tessellations );
+    EXPECT_EQ( (U64)0, stats.segmentsReused );
+    EXPECT_EQ( (U64)8, stats.segmentsEvaluated );
+
+    // The same shape at the same time is entirely reused
+    tessellate(shape, makeKey(1, 0), &cache, &points);
+    expectSamePoints(expected, points);
+    stats = getStatsSince(start);
+    EXPECT_EQ( (U64)8, stats.segmentsReused );
+
+    // Moving a control point at another time only changes the 2 segments around it
+    shape[3].x += 10.;
+    shape[4] = shape[3];
+    tessellate(shape, makeKey(2, 0), &cache, &points);
+    tessellate(shape, makeKey(2, 0), 0, &expected);
+    expectSamePoints(expected, points);
+    stats = getStatsSince(start);
+    EXPECT_EQ( (U64)14, stats.segmentsReused );
+    EXPECT_EQ( (U64)10, stats.segmentsEvaluated );
+    EXPECT_NEAR(14. / 24., stats.getHitRate(), 1e-12);
+
+    // Going back to the first time, whose tessellation is still cached
+    shape[3].x -= 10.;
+    shape[4] = shape[3];
+    tessellate(shape, makeKey(1, 0), &cache, &points);
+    tessellate(shape, makeKey(1, 0), 0, &expected);
+    expectSamePoints(expected, points);
+    stats = getStatsSince(start);
+    EXPECT_EQ( (U64)22, stats.segmentsReused );
+    EXPECT_EQ( (U64)10, stats.segmentsEvaluated );
+}
+
+TEST(BezierTessellationCache, InsertedAndRemovedControlPoints) {
+    BezierTessellationCache cache;
+    ShapeControlPoints shape = makeCircle(8, 100.);
+    ShapeControlPoints split = makeCircle(16, 100.);
+    std::vector<ParametricPoint> expected, points;
+
+    tessellate(shape, makeKey(1, 0), &cache, &points);
+
+    // Replace the 3rd segment by 2 segments
+    ShapeControlPoints inserted(shape.begin(), shape.begin() + 8);
+    inserted.insert( inserted.end(), split.begin() + 16, split.begin() + 24 );
+    inserted.insert( inserted.end(), shape.begin() + 12, shape.end() );
+    BezierTessellationStats start = BezierTessellationCache::getStats();
+    tessellate(inserted, makeKey(1, 0), &cache, &points);
+    tessellate(inserted, makeKey(1, 0), 0, &expected);
+    expectSamePoints(expected, points);
+    BezierTessellationStats stats = getStatsSince(start);
+    EXPECT_EQ( (U64)7, stats.segmentsReused );
+    EXPECT_EQ( (U64)2, stats.segmentsEvaluated );
+
+    // Removing it again reuses the segments of the first tessellation
+    start = BezierTessellationCache::getStats();
+    tessellate(shape, makeKey(1, 0), &cache, &points);
+    tessellate(shape, makeKey(1, 0), 0, &expected);
+    expectSamePoints(expected, points);
+    stats = getStatsSince(start);
+    EXPECT_EQ( (U64)7, stats.segmentsReused );
+    EXPECT_EQ( (U64)1, stats.segmentsEvaluated );
+}
+
+TEST(BezierTessellationCache, IncompatibleKeysAndEviction) {
+    BezierTessellationCache cache;
+    ShapeControlPoints shape = makeCircle(4, 100.);
+    std::vector<ParametricPoint> points;
+
+    for (unsigned int i = 0; i < NATRON_BEZIER_TESSELLATION_CACHE_MAX_ENTRIES; ++i) {
+        tessellate(shape, makeKey(1, i), &cache, &points);
+    }
+
+    // Segments are never shared between mipmap levels or tessellation precisions
+    BezierTessellationStats start = BezierTessellationCache::getStats();
+    BezierTessellationCache::Key key = makeKey(1, NATRON_BEZIER_TESSELLATION_CACHE_MAX_ENTRIES);
+    tessellate(shape, key, &cache, &points);
+    key = makeKey(1, 1);
+    key.tessellation = 10;
+    tessellate(shape, key, &cache, &points);
+    key.useGuiCurves = true;
+    tessellate(shape, key, &cache, &points);
+    EXPECT_EQ( (U64)0, getStatsSince(start).segmentsReused );
+
+    // The least recently used tessellations were evicted, the last ones are kept
+    start = BezierTessellationCache::getStats();
+    tessellate(shape, makeKey(1, 0), &cache, &points);
+    tessellate(shape, makeKey(1, 1), &cache, &points);
+    EXPECT_EQ( (U64)0, getStatsSince(start).segmentsReused );
+    tessellate(shape, key, &cache, &points);
+    EXPECT_EQ( (U64)4, getStatsSince(start).segmentsReused );
+
+    cache.clear();
+    start = BezierTessellationCache::getStats();
+    tessellate(shape, key, &cache, &points);
+    EXPECT_EQ( (U64)0, getStatsSince(start).segmentsReused );
+}
+
+// Not a correctness test: prints the time taken to tessellate a shape with many control points when a few of them move
+TEST(BezierTessellationCache, DISABLED_BenchmarkLargeShape) {
+    const int nSegments = 2000;
+    const int nFrames = 50;
+    BezierTessellationCache cache;
+    ShapeControlPoints shape = makeCircle(nSegments, 1000.);
+    std::vector<ParametricPoint> points;
+    BezierTessellationCache::Key key = makeKey(0, 0);
+
+    key.tessellation = 100;
+    TimeLapse timer;
+    for (int i = 0; i < nFrames; ++i) {
+        shape[4 * i + 3].x += 1.;
+        shape[4 * i + 4] = shape[4 * i + 3];
+        key.time = i;
+        tessellate(shape, key, 0, &points);
+    }
+    double uncachedTime = timer.getTimeElapsedReset();
+
+    BezierTessellationStats start = BezierTessellationCache::getStats();
+    for (int i = 0; i < nFrames; ++i) {
+        shape[4 * i + 3].x += 1.;
+        shape[4 * i + 4] = shape[4 * i + 3];
+        key.time = i;
+        tessellate(shape, key, &cache, &points);
+    }
+    double cachedTime = timer.getTimeElapsedReset();
+    BezierTessellationStats stats = getStatsSince(start);
+
+    std::cout << "Tessellating " << nFrames << " frames of a shape with " << nSegments << " segments: "
+              << uncachedTime * 1000. << " ms without cache, " << cachedTime * 1000. << " ms with cache (hit rate "
+              << stats.getHitRate() * 100. << "%)" << std::endl;
+    EXPECT_GT(stats.getHitRate(), 0.9);
+}
@@ -0,0 +1,139 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <gtest/gtest.h>
+
+#include "Engine/BufferPool.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+// A 4K RGBA float image
+static const std::size_t k4KImageSize = 3840 * 2160 * 4 * sizeof(float);
+
+TEST(BufferPool, SizeClasses) {
+    EXPECT_EQ( (std::size_t)1000, BufferPool::getAllocatedSize(1000) );
+    EXPECT_EQ( (std::size_t)NATRON_BUFFER_POOL_MIN_SIZE, BufferPool::getAllocatedSize(NATRON_BUFFER_POOL_MIN_SIZE) );
+    for (std::size_t size = NATRON_BUFFER_POOL_MIN_SIZE; size < 64 * 1024 * 1024; size = size * 3 / 2 + 4095) {
+        std::size_t allocated = BufferPool::getAllocatedSize(size);
+        EXPECT_GE(allocated, size);
+        EXPECT_LE(allocated, size + size / 8);
+        EXPECT_EQ( allocated, BufferPool::getAllocatedSize(allocated) );
+    }
+}
+
+TEST(BufferPool, ReusesReleasedBuffers) {
+    BufferPool::trim();
+    BufferPool::setMaximumRetainedSize(3 * k4KImageSize);
+    BufferPoolStats before = BufferPool::getStats();
+
+    void* a = BufferPool::allocate(k4KImageSize);
+    void* b = BufferPool::allocate(k4KImageSize);
+    BufferPool::release(a, k4KImageSize);
+    BufferPool::release(b, k4KImageSize);
+    EXPECT_EQ( (std::size_t)2, BufferPool::getStats().nRetainedBuffers );
+
+    // The most recently released buffer is reused first, a buffer of a size in the same class is reused as well
+    void* c = BufferPool::allocate(k4KImageSize - 100);
+    EXPECT_EQ(b, c);
+    // Another size class
+    void* d = BufferPool::allocate(k4KImageSize / 2);
+    EXPECT_NE(a, d);
+
+    BufferPoolStats stats = BufferPool::getStats();
+    EXPECT_EQ( (U64)4, stats.nAllocations - before.nAllocations );
+    EXPECT_EQ( (U64)1, stats.nReused - before.nReused );
+    EXPECT_EQ( (std::size_t)1, stats.nRetainedBuffers );
+    EXPECT_EQ(BufferPool::getAllocatedSize(k4KImageSize), stats.retainedSize);
+
+    // The least recently released buffers are freed first when the pool is full
+    BufferPool::release(c, k4KImageSize - 100);
+    BufferPool::release(d, k4KImageSize / 2);
+    BufferPool::setMaximumRetainedSize( BufferPool::getAllocatedSize(k4KImageSize) + BufferPool::getAllocatedSize(k4KImageSize / 2) - 1 );
+    stats = BufferPool::getStats();
+    EXPECT_EQ( (std::size_t)1, stats.nRetainedBuffers );
+    void* e = BufferPool::allocate(k4KImageSize / 2);
+    EXPECT_EQ(d, e);
+    BufferPool::release(e, k4KImageSize / 2);
+
+    BufferPool::trim();
+    EXPECT_EQ( (std::size_t)0, BufferPool::getStats().retainedSize );
+
+    // Small buffers are not pooled
+    void* small = BufferPool::allocate(100);
+    BufferPool::release(small, 100);
+    EXPECT_EQ( (std::size_t)0, BufferPool::getStats().nRetainedBuffers );
+}
+
+TEST(BufferPool, ReallocatePreservesData) {
+    std::size_t size = 1000;
+    unsigned char* data = (unsigned char*)BufferPool::allocate(size);
+
+    for (std::size_t i = 0; i < size; ++i) {
+        data[i] = (unsigned char)i;
+    }
+    // from a small buffer to a pooled one and back
+    const std::size_t sizes[3] = { NATRON_BUFFER_POOL_MIN_SIZE * 3, NATRON_BUFFER_POOL_MIN_SIZE * 3 + 10, 500 };
+    for (int s = 0; s < 3; ++s) {
+        data = (unsigned char*)BufferPool::reallocate(data, size, sizes[s]);
+        size = sizes[s];
+        for (std::size_t i = 0; i < 500; ++i) {
+            ASSERT_EQ( (unsigned char)i, data[i] );
+        }
+    }
+    BufferPool::release(data, size);
+}
+
+// Not a correctness test: prints the time taken to allocate, fill and free 4K images, as during playback
+TEST(BufferPool, DISABLED_Benchmark4KImages) {
+    const int nIterations = 20;
+    // read back from the buffers so that the compiler does not optimize the allocations away
+    unsigned int checksum = 0;
+
+    BufferPool::setMaximumRetainedSize(4 * k4KImageSize);
+    for (int pooled = 0; pooled < 2; ++pooled) {
+        BufferPool::trim();
+        TimeLapse timer;
+        for (int i = 0; i < nIterations; ++i) {
+            void* data = pooled ? BufferPool::allocate(k4KImageSize) : malloc(k4KImageSize);
+            ASSERT_TRUE(data != 0);
+            std::memset(data, i, k4KImageSize);
+            checksum += ( (volatile unsigned char*)data )[k4KImageSize - 1 - i];
+            if (pooled) {
+                BufferPool::release(data, k4KImageSize);
+            } else {
+                free(data);
+            }
+        }
+        std::cout << (pooled ? "BufferPool" : "malloc") << ": " << timer.getTimeSinceCreation() * 1000. / nIterations
+                  << " ms per 4K image allocated, filled and freed" << std::endl;
+    }
+    EXPECT_EQ( (unsigned int)(nIterations * (nIterations - 1)), checksum );
+    BufferPool::trim();
+}
@@ -0,0 +1,136 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/CacheCompression.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+static void
+checkRoundTrip(const std::vector<float>& pixels,
+               std::size_t size,
+               std::size_t pixelBytes)
+{
+    std::string compressed;
+
+    ASSERT_TRUE( CacheCompression::compress(&pixels[0], size, pixelBytes, size + 64, &compressed) );
+    ASSERT_EQ( size, CacheCompression::getDecompressedSize(compressed) );
+    std::vector<float> decompressed(pixels.size() + 1, -1.f);
+    ASSERT_TRUE( CacheCompression::decompress(compressed, &decompressed[0], size) );
+    EXPECT_EQ( 0, std::memcmp(&pixels[0], &decompressed[0], size) );
+    // Nothing is written past the end
+    EXPECT_EQ( -1.f, decompressed[pixels.size()] );
+}
+
+// A 4-channel float matte: black with an opaque square and a soft edge
+static std::vector<float>
+makeMatte(int width,
+          int height)
+{
+    std::vector<float> ret(width * height * 4, 0.f);
+
+    for (int y = height / 4; y < height * 3 / 4; ++y) {
+        for (int x = width / 4; x < width * 3 / 4; ++x) {
+            float v = (x == width / 4 || y == height / 4) ? 0.5f : 1.f;
+            for (int c = 0; c < 4; ++c) {
+                ret[(y * width + x) * 4 + c] = v;
+            }
+        }
+    }
+
+    return ret;
+}
+
+TEST(CacheCompression, RoundTrip) {
+    std::vector<float> pixels = makeMatte(67, 31);
+
+    // Odd sizes and pixel sizes that are not a multiple of a word
+    checkRoundTrip(pixels, pixels.size() * sizeof(float), 16);
+    checkRoundTrip(pixels, pixels.size() * sizeof(float) - 3, 16);
+    checkRoundTrip(pixels, pixels.size() * sizeof(float), 12);
+    checkRoundTrip(pixels, pixels.size() * sizeof(float), 6);
+    checkRoundTrip(pixels, pixels.size() * sizeof(float), 1);
+
+    srand(2000);
+    for (std::size_t i = 0; i < pixels.size(); i += 7) {
+        // coverity[dont_call]
+        pixels[i] = rand() / (float)RAND_MAX;
+    }
+    checkRoundTrip(pixels, pixels.size() * sizeof(float), 16);
+    checkRoundTrip(pixels, 5, 16);
+}
+
+TEST(CacheCompression, Ratio) {
+    std::vector<float> matte = makeMatte(512, 512);
+    const std::size_t size = matte.size() * sizeof(float);
+    std::string compressed;
+
+    ASSERT_TRUE( CacheCompression::compress(&matte[0], size, 16, size / 2, &compressed) );
+    // One run per row of the square, and one for the black areas
+    EXPECT_LT( compressed.size(), size / 100 );
+
+    // Noise does not compress: give up
+    std::vector<float> noise(matte.size());
+    srand(2000);
+    for (std::size_t i = 0; i < noise.size(); ++i) {
+        // coverity[dont_call]
+        noise[i] = rand() / (float)RAND_MAX;
+    }
+    EXPECT_FALSE( CacheCompression::compress(&noise[0], size, 16, size / 2, &compressed) );
+    EXPECT_TRUE( compressed.empty() );
+
+    // Corrupted data is rejected
+    ASSERT_TRUE( CacheCompression::compress(&matte[0], size, 16, size / 2, &compressed) );
+    compressed.resize(compressed.size() - 1);
+    EXPECT_FALSE( CacheCompression::decompress(compressed, &noise[0], size) );
+}
+
+// Not a correctness test: prints the throughput on a 4K float matte
+TEST(CacheCompression, DISABLED_Benchmark4KMatte) {
+    std::vector<float> matte = makeMatte(3840, 2160);
+    const std::size_t size = matte.size() * sizeof(float);
+    const int nIterations = 5;
+    std::string compressed;
+    TimeLapse timer;
+
+    for (int i = 0; i < nIterations; ++i) {
+        ASSERT_TRUE( CacheCompression::compress(&matte[0], size, 16, size / 2, &compressed) );
+    }
+    double compressTime = timer.getTimeElapsedReset() / nIterations;
+    for (int i = 0; i < nIterations; ++i) {
+        ASSERT_TRUE( CacheCompression::decompress(compressed, &matte[0], size) );
+    }
+    double decompressTime = timer.getTimeElapsedReset() / nIterations;
+    std::cout << "4K float matte: " << size / (1024 * 1024) << " MiB compressed to " << compressed.size() << " bytes in "
+              << compressTime * 1000. << " ms, decompressed in " << decompressTime * 1000. << " ms" << std::endl;
+}
@@ -0,0 +1,229 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include "Engine/LRUHashTable.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+typedef boost::shared_ptr<int> TestValue;
+typedef Boost2QHashTable<U64, TestValue> TestTable;
+
+static bool
+contains(TestTable& table,
+         U64 key)
+{
+    return table.find(key) != table.end();
+}
+
+TEST(CacheEvictionPolicy, LRUOrder) {
+    TestTable table;
+
+    for (U64 i = 0; i < 4; ++i) {
+        table.insert( i, TestValue( new int(i) ) );
+    }
+    // 0 becomes the most recently used
+    ASSERT_TRUE( table(0) != table.end() );
+
+    // Values used elsewhere are never evicted
+    TestValue used = table.find(1)->second.front();
+
+    std::pair<U64, TestValue> evicted = table.evict();
+    EXPECT_EQ( (U64)2, evicted.first );
+    evicted = table.evict();
+    EXPECT_EQ( (U64)3, evicted.first );
+    evicted = table.evict();
+    EXPECT_EQ( (U64)0, evicted.first );
+    evicted = table.evict();
+    EXPECT_FALSE(evicted.second);
+    EXPECT_EQ( (unsigned int)1, table.size() );
+    EXPECT_EQ( (std::size_t)0, table.getProbationSize() );
+}
+
+TEST(CacheEvictionPolicy, TwoQueues) {
+    TestTable table;
+
+    table.setEvictionPolicy(eCacheEvictionPolicy2Q);
+    for (U64 i = 0; i < 8; ++i) {
+        table.insert( i, TestValue( new int(i) ) );
+    }
+    EXPECT_EQ( (std::size_t)8, table.getProbationSize() );
+
+    // Using a key in probation does not protect it
+    ASSERT_TRUE( table(0) != table.end() );
+    std::pair<U64, TestValue> evicted = table.evict();
+    EXPECT_EQ( (U64)0, evicted.first );
+
+    // A key evicted from probation and inserted again is protected
+    table.insert(0, evicted.second);
+    EXPECT_EQ( (std::size_t)7, table.getProbationSize() );
+
+    // Erasing the first key of the probation queue
+    table.erase( table.find(1) );
+    EXPECT_EQ( (std::size_t)6, table.getProbationSize() );
+    for (U64 i = 2; i < 8; ++i) {
+        evicted = table.evict();
+        EXPECT_EQ(i, evicted.first);
+    }
+    EXPECT_EQ( (std::size_t)0, table.getProbationSize() );
+    evicted = table.evict();
+    EXPECT_EQ( (U64)0, evicted.first );
+    EXPECT_EQ( (unsigned int)0, table.size() );
+
+    // Switching back to LRU protects all keys, in their current order
+    table.insert( 10, TestValue( new int(10) ) );
+    table.insert( 11, TestValue( new int(11) ) );
+    table.setEvictionPolicy(eCacheEvictionPolicyLRU);
+    EXPECT_EQ( (std::size_t)0, table.getProbationSize() );
+    ASSERT_TRUE( table(10) != table.end() );
+    evicted = table.evict();
+    EXPECT_EQ( (U64)11, evicted.first );
+
+    // A copy keeps the queues
+    table.setEvictionPolicy(eCacheEvictionPolicy2Q);
+    table.insert( 12, TestValue( new int(12) ) );
+    table.insert( 13, TestValue( new int(13) ) );
+    TestTable copy(table);
+    table.clear();
+    evicted = std::pair<U64, TestValue>();
+    EXPECT_EQ( (std::size_t)2, copy.getProbationSize() );
+    EXPECT_EQ( (U64)12, copy.evict().first );
+    EXPECT_TRUE( contains(copy, 10) );
+    EXPECT_FALSE( contains(copy, 12) );
+}
+
+/**
+ * @brief An access trace of the image cache: the hash of each image requested, in order.
+ **/
+typedef std::vector<U64> AccessTrace;
+
+// Images rendered while tweaking a graph: the same few frames of the nodes being edited are requested over and over,
+// interleaved with flipbook renders of the whole sequence, each frame being seen once per render
+static AccessTrace
+makeTweakAndFlipbookTrace()
+{
+    AccessTrace ret;
+    const int nWorkingSet = 60;
+    const int nFrames = 300;
+    U64 nextFlipbookHash = 1000000;
+
+    srand(2000);
+    for (int round = 0; round < 40; ++round) {
+        for (int i = 0; i < 4 * nWorkingSet; ++i) {
+            // coverity[dont_call]
+            ret.push_back( rand() % nWorkingSet );
+        }
+        // a flipbook after a tweak renders new images
+        if (round % 2 == 0) {
+            for (int i = 0; i < nFrames; ++i) {
+                ret.push_back(nextFlipbookHash++);
+            }
+        }
+    }
+
+    return ret;
+}
+
+// Playback of a sequence going back and forth over a range of frames that fits in the cache
+static AccessTrace
+makePlaybackTrace()
+{
+    AccessTrace ret;
+
+    for (int loop = 0; loop < 20; ++loop) {
+        for (int i = 0; i < 80; ++i) {
+            ret.push_back(loop / 5 * 20 + i);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Replays the trace through a cache holding at most capacity images and returns the hit rate.
+ **/
+static double
+replayTrace(const AccessTrace& trace,
+            CacheEvictionPolicyEnum policy,
+            unsigned int capacity)
+{
+    TestTable table;
+    std::size_t nHits = 0;
+
+    table.setEvictionPolicy(policy);
+    for (AccessTrace::const_iterator it = trace.begin(); it != trace.end(); ++it) {
+        if ( table(*it) != table.end() ) {
+            ++nHits;
+        } else {
+            table.insert( *it, TestValue( new int(0) ) );
+            while (table.size() > capacity) {
+                if ( !table.evict().second ) {
+                    break;
+                }
+            }
+        }
+    }
+
+    return trace.empty() ? 0. : (double)nHits / trace.size();
+}
+
+static void
+printHitRates(const char* name,
+              const AccessTrace& trace,
+              unsigned int capacity,
+              double* lruHitRate,
+              double* twoQHitRate)
+{
+    TimeLapse timer;
+
+    *lruHitRate = replayTrace(trace, eCacheEvictionPolicyLRU, capacity);
+    double lruTime = timer.getTimeElapsedReset();
+    *twoQHitRate = replayTrace(trace, eCacheEvictionPolicy2Q, capacity);
+    double twoQTime = timer.getTimeElapsedReset();
+    std::cout << name << " (" << trace.size() << " accesses, " << capacity << " images): LRU hit rate "
+              << *lruHitRate * 100. << "% (" << lruTime * 1000. << " ms), 2Q hit rate "
+              << *twoQHitRate * 100. << "% (" << twoQTime * 1000. << " ms)" << std::endl;
+}
+
+TEST(CacheEvictionPolicy, ReplayTraces) {
+    double lruHitRate, twoQHitRate;
+
+    // The flipbooks evict the working set from a LRU cache, not from a 2Q cache.
+    // Flipbook frames are always missed, which caps the hit rate at about 61%
+    printHitRates("Tweaks and flipbooks", makeTweakAndFlipbookTrace(), 100, &lruHitRate, &twoQHitRate);
+    EXPECT_GT(twoQHitRate, lruHitRate + 0.05);
+
+    // Everything fits in the cache except when the range moves: both policies behave the same
+    printHitRates("Playback", makePlaybackTrace(), 100, &lruHitRate, &twoQHitRate);
+    EXPECT_NEAR(lruHitRate, twoQHitRate, 0.05);
+}
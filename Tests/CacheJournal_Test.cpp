@@ -0,0 +1,252 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "Engine/CacheJournal.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+static std::string
+getTestJournalPath()
+{
+    return QDir::temp().absoluteFilePath( QString::fromUtf8("NatronCacheJournalTest." NATRON_CACHE_FILE_EXT) ).toStdString();
+}
+
+static CacheJournal::Record
+makeTestRecord(int i,
+               bool tiled)
+{
+    CacheJournal::Record ret;
+    std::stringstream ss;
+
+    ret.hash = 0x9e3779b97f4a7c15ULL * (U64)(i + 1);
+    if (tiled) {
+        ss << "/cache/ViewerCache/CachePart" << i / 1000;
+        ret.dataOffset = (U64)(i % 1000) * 262144;
+        ret.dataSize = 262144;
+    } else {
+        ss << "/cache/DiskCache/" << std::hex << (ret.hash >> 56) << "/" << ret.hash << "." NATRON_CACHE_FILE_EXT;
+        ret.dataSize = 1024 * 1024;
+    }
+    ret.filePath = ss.str();
+    // Roughly the size of a serialized image key and params
+    ret.payload.assign(150, (char)(i & 0xff));
+
+    return ret;
+}
+
+TEST(CacheJournal, ReplayKeepsLiveEntries) {
+    const std::string path = getTestJournalPath();
+    std::vector<CacheJournal::Record> records;
+    {
+        CacheJournal journal(path, 1);
+        ASSERT_TRUE( journal.open(records) );
+        for (int i = 0; i < 4; ++i) {
+            journal.appendAdd( makeTestRecord(i, true) );
+        }
+        CacheJournal::Record r1 = makeTestRecord(1, true);
+        journal.appendRemove(r1.hash, r1.filePath, r1.dataOffset);
+
+        // A new entry stored where entry 2 was replaces it
+        CacheJournal::Record replaced = makeTestRecord(2, true);
+        replaced.hash = 42;
+        journal.appendAdd(replaced);
+
+        // Removing an entry that was never added is harmless
+        CacheJournal::Record unknown = makeTestRecord(10, true);
+        journal.appendRemove(unknown.hash, unknown.filePath, unknown.dataOffset);
+    }
+
+    {
+        CacheJournal journal(path, 1);
+        ASSERT_TRUE( journal.replay(&records) );
+    }
+    ASSERT_EQ( (std::size_t)3, records.size() );
+    EXPECT_EQ( makeTestRecord(0, true).hash, records[0].hash );
+    EXPECT_EQ( makeTestRecord(3, true).hash, records[1].hash );
+    EXPECT_EQ( (U64)42, records[2].hash );
+    EXPECT_EQ( makeTestRecord(2, true).dataOffset, records[2].dataOffset );
+    EXPECT_EQ( makeTestRecord(3, true).payload, records[1].payload );
+
+    // A journal written with another version is not replayed
+    {
+        CacheJournal journal(path, 2);
+        std::vector<CacheJournal::Record> otherVersion;
+        EXPECT_FALSE( journal.replay(&otherVersion) );
+    }
+
+    QFile::remove( QString::fromUtf8( path.c_str() ) );
+    QFile::remove( QString::fromUtf8( ( path + ".lock" ).c_str() ) );
+}
+
+TEST(CacheJournal, TornTailIsIgnored) {
+    const std::string path = getTestJournalPath();
+    std::vector<CacheJournal::Record> records;
+
+    for (int i = 0; i < 10; ++i) {
+        records.push_back( makeTestRecord(i, false) );
+    }
+    {
+        CacheJournal journal(path, 1);
+        ASSERT_TRUE( journal.open(records) );
+        journal.appendAdd( makeTestRecord(10, false) );
+        journal.flush();
+    }
+
+    // Simulate a crash while the last record was being written
+    QFile file( QString::fromUtf8( path.c_str() ) );
+    ASSERT_TRUE( file.resize(file.size() - 7) );
+
+    std::vector<CacheJournal::Record> replayed;
+    {
+        CacheJournal journal(path, 1);
+        ASSERT_TRUE( journal.replay(&replayed) );
+
+        // Re-opening the journal discards the torn record
+        ASSERT_TRUE( journal.open(replayed) );
+        journal.appendAdd( makeTestRecord(11, false) );
+    }
+    ASSERT_EQ( (std::size_t)10, replayed.size() );
+    EXPECT_EQ( records[9].filePath, replayed[9].filePath );
+
+    {
+        CacheJournal journal(path, 1);
+        ASSERT_TRUE( journal.replay(&replayed) );
+    }
+    ASSERT_EQ( (std::size_t)11, replayed.size() );
+    EXPECT_EQ( makeTestRecord(11, false).hash, replayed[10].hash );
+
+    QFile::remove( QString::fromUtf8( path.c_str() ) );
+    QFile::remove( QString::fromUtf8( ( path + ".lock" ).c_str() ) );
+}
+
+// Two journals on the same file stand for two processes sharing a cache
+TEST(CacheJournal, CompactionKeepsRecordsOfOtherJournals) {
+    const std::string path = getTestJournalPath();
+    std::vector<CacheJournal::Record> records;
+
+    for (int i = 0; i < 5; ++i) {
+        records.push_back( makeTestRecord(i, false) );
+    }
+    {
+        CacheJournal other(path, 1);
+        ASSERT_TRUE( other.open(records) );
+
+        CacheJournal journal(path, 1);
+        std::vector<CacheJournal::Record> replayed;
+        ASSERT_TRUE( journal.replay(&replayed) );
+        ASSERT_EQ( (std::size_t)5, replayed.size() );
+
+        // Entries journaled by the other process while this one was restoring its entries
+        other.appendAdd( makeTestRecord(5, false) );
+        other.appendAdd( makeTestRecord(6, false) );
+        other.flush();
+
+        // Only 3 entries could be restored
+        replayed.resize(3);
+        ASSERT_TRUE( journal.open(replayed) );
+    }
+    {
+        CacheJournal journal(path, 1);
+        ASSERT_TRUE( journal.replay(&records) );
+    }
+    ASSERT_EQ( (std::size_t)5, records.size() );
+    EXPECT_EQ( makeTestRecord(2, false).hash, records[2].hash );
+    EXPECT_EQ( makeTestRecord(6, false).hash, records[4].hash );
+
+    // A journal compacted by another process after this one replayed it is left as is
+    {
+        CacheJournal journal(path, 1);
+        std::vector<CacheJournal::Record> replayed;
+        ASSERT_TRUE( journal.replay(&replayed) );
+        {
+            CacheJournal other(path, 1);
+            std::vector<CacheJournal::Record> otherReplayed;
+            ASSERT_TRUE( other.replay(&otherReplayed) );
+            ASSERT_TRUE( other.open(otherReplayed) );
+            other.appendAdd( makeTestRecord(7, false) );
+        }
+        replayed.clear();
+        ASSERT_TRUE( journal.open(replayed) );
+    }
+    {
+        CacheJournal journal(path, 1);
+        ASSERT_TRUE( journal.replay(&records) );
+    }
+    ASSERT_EQ( (std::size_t)6, records.size() );
+    EXPECT_EQ( makeTestRecord(7, false).hash, records[5].hash );
+
+    QFile::remove( QString::fromUtf8( path.c_str() ) );
+    QFile::remove( QString::fromUtf8( ( path + ".lock" ).c_str() ) );
+}
+
+// Not a correctness test: prints the time taken to restore the index of a cache with 1 million entries
+TEST(CacheJournal, DISABLED_Benchmark1MEntries) {
+    const std::string path = getTestJournalPath();
+    const int nEntries = 1000000;
+    std::vector<CacheJournal::Record> records;
+
+    records.reserve(nEntries);
+    for (int i = 0; i < nEntries; ++i) {
+        records.push_back( makeTestRecord(i, true) );
+    }
+
+    {
+        CacheJournal journal(path, 1);
+        TimeLapse timer;
+        ASSERT_TRUE( journal.open(records) );
+        std::cout << "Writing a journal of " << nEntries << " entries: " << timer.getTimeElapsedReset() * 1000. << " ms" << std::endl;
+
+        // Entries evicted and replaced during the session
+        for (int i = 0; i < nEntries / 10; ++i) {
+            journal.appendRemove(records[i].hash, records[i].filePath, records[i].dataOffset);
+            journal.appendAdd(records[i]);
+        }
+        journal.flush();
+        std::cout << "Journaling " << nEntries / 10 << " evictions and additions: " << timer.getTimeElapsedReset() * 1000. << " ms" << std::endl;
+    }
+
+    std::vector<CacheJournal::Record> replayed;
+    {
+        CacheJournal journal(path, 1);
+        TimeLapse timer;
+        ASSERT_TRUE( journal.replay(&replayed) );
+        std::cout << "Replaying a journal of " << nEntries << " entries: " << timer.getTimeSinceCreation() * 1000. << " ms" << std::endl;
+    }
+    ASSERT_EQ( records.size(), replayed.size() );
+
+    QFile::remove( QString::fromUtf8( path.c_str() ) );
+    QFile::remove( QString::fromUtf8( ( path + ".lock" ).c_str() ) );
+}
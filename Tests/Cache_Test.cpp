@@ -0,0 +1,279 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+
+#include "Engine/Cache.h"
+#include "Engine/Image.h"
+#include "Engine/ImageParams.h"
+#include "Engine/Timer.h"
+#include "Engine/ViewIdx.h"
+
+#include "BaseTest.h"
+
+NATRON_NAMESPACE_USING
+
+static ImageParamsPtr
+makeTestImageParams()
+{
+    RectI bounds(0, 0, 1, 1);
+    RectD rod(0, 0, 1, 1);
+
+    return ImageParamsPtr( new ImageParams(rod, 1., 0, bounds, eImageBitDepthFloat, eImageFieldingOrderNone,
+                                           eImagePremultiplicationPremultiplied, false, ImageComponents::getRGBAComponents(),
+                                           eStorageModeRAM, GL_TEXTURE_2D) );
+}
+
+static void
+fillTestCache(ImageCache* cache,
+              int nEntries,
+              std::vector<ImageKey>* keys)
+{
+    ImageParamsPtr params = makeTestImageParams();
+
+    for (int i = 0; i < nEntries; ++i) {
+        ImageKey key(0, (U64)i + 1, false, 0, ViewIdx(0), 1., false, false);
+        ImagePtr entry;
+        cache->getOrCreate(key, params, 0, &entry);
+        keys->push_back(key);
+    }
+}
+
+class CacheLookupThread
+    : public QThread
+{
+    const ImageCache* _cache;
+    const std::vector<ImageKey>* _keys;
+    int _nLookups;
+    int _seed;
+
+public:
+
+    CacheLookupThread(const ImageCache* cache,
+                      const std::vector<ImageKey>* keys,
+                      int nLookups,
+                      int seed)
+        : QThread()
+        , _cache(cache)
+        , _keys(keys)
+        , _nLookups(nLookups)
+        , _seed(seed)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        std::list<ImagePtr> entries;
+        std::size_t nKeys = _keys->size();
+
+        for (int i = 0; i < _nLookups; ++i) {
+            // Walk the keys with a large prime stride so that threads do not hit the same entries in lock-step
+            _cache->get( (*_keys)[( (std::size_t)_seed + (std::size_t)i * 7919 ) % nKeys], &entries );
+            entries.clear();
+        }
+    }
+};
+
+TEST_F(BaseTest, CacheShardsLookup)
+{
+    ImageCache cache("ShardsTestCache", NATRON_CACHE_VERSION, 1024 * 1024 * 1024, 1., 8);
+
+    ASSERT_EQ(8, cache.getShardsCount());
+
+    std::vector<ImageKey> keys;
+    fillTestCache(&cache, 256, &keys);
+
+    // Every entry must be found, whichever shard it falls into
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        std::list<ImagePtr> entries;
+        EXPECT_TRUE( cache.get(keys[i], &entries) );
+        EXPECT_EQ( (std::size_t)1, entries.size() );
+    }
+
+    std::list<ImagePtr> copy;
+    cache.getCopy(&copy);
+    EXPECT_EQ( keys.size(), copy.size() );
+    copy.clear();
+
+    cache.removeEntry( keys[0].getHash() );
+    std::list<ImagePtr> entries;
+    EXPECT_FALSE( cache.get(keys[0], &entries) );
+
+    // Nothing holds a reference to the entries, hence they can all be evicted
+    int nEvicted = 0;
+    while ( cache.evictLRUInMemoryEntry() ) {
+        ++nEvicted;
+    }
+    EXPECT_EQ( (int)keys.size() - 1, nEvicted );
+    cache.waitForDeleterThread();
+}
+
+class CacheAllocationThread
+    : public QThread
+{
+    const ImageCache* _cache;
+    int _nAllocations;
+
+public:
+
+    CacheAllocationThread(const ImageCache* cache,
+                          int nAllocations)
+        : QThread()
+        , _cache(cache)
+        , _nAllocations(nAllocations)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        ImageParamsPtr params = makeTestImageParams();
+        ImageKey key;
+
+        for (int i = 0; i < _nAllocations; ++i) {
+            // Allocating and freeing small buffers notifies the cache of every size change
+            Image image(key, params, _cache);
+            image.allocateMemory();
+        }
+    }
+};
+
+TEST_F(BaseTest, CacheConcurrentSizeAccounting)
+{
+    ImageCache cache("SizeAccountingTestCache", NATRON_CACHE_VERSION, 1024 * 1024 * 1024, 1., 1);
+    const int nThreads = std::max(2, QThread::idealThreadCount());
+    std::vector<CacheAllocationThread*> threads;
+
+    for (int i = 0; i < nThreads; ++i) {
+        threads.push_back( new CacheAllocationThread(&cache, 10000) );
+    }
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->start();
+    }
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->wait();
+        delete threads[i];
+    }
+
+    // Every allocation was matched by a deallocation: the counters must be back to 0
+    EXPECT_EQ( (std::size_t)0, cache.getMemoryCacheSize() );
+    EXPECT_EQ( (std::size_t)0, cache.getDiskCacheSize() );
+}
+
+TEST(CacheFile, UniqueFileNames)
+{
+    std::string first = CacheAPI::generateUniqueFileNameSuffix();
+    std::string second = CacheAPI::generateUniqueFileNameSuffix();
+
+    EXPECT_NE(first, second);
+    // checkFileNameMatchesHash strips everything after the last '_' of the file name
+    EXPECT_EQ(std::string::npos, first.find('_'));
+}
+
+TEST(CacheFile, ReOpenChecksFooter)
+{
+    const QString path = QDir::temp().absoluteFilePath( QString::fromUtf8("NatronCacheFileTest." NATRON_CACHE_FILE_EXT) );
+    QFile::remove(path);
+
+    {
+        Buffer<unsigned char> buffer;
+        ASSERT_TRUE( buffer.allocateMMAP( 64, 0x1234, path.toStdString() ) );
+        EXPECT_EQ( (std::size_t)64, buffer.size() );
+        std::memset(buffer.writable(), 42, 64);
+        buffer.deallocate();
+
+        // Same entry
+        buffer.reOpenFileMapping(64, 0x1234);
+        EXPECT_EQ( (std::size_t)64, buffer.size() );
+        EXPECT_EQ(42, buffer.readable()[63]);
+        buffer.deallocate();
+
+        // The file of another entry or of another size is never mapped
+        EXPECT_THROW(buffer.reOpenFileMapping(64, 0x4321), std::exception);
+        EXPECT_THROW(buffer.reOpenFileMapping(32, 0x1234), std::exception);
+
+        // A smaller file created in place of the original one
+        ASSERT_TRUE( QFile::remove(path) );
+        {
+            QFile file(path);
+            ASSERT_TRUE( file.open(QIODevice::WriteOnly) );
+            file.write( QByteArray(16, 0) );
+        }
+        EXPECT_THROW(buffer.reOpenFileMapping(64, 0x1234), std::exception);
+    }
+    QFile::remove(path);
+}
+
+/**
+ * @brief Measures the number of cache lookups per second with an increasing number of threads,
+ * with a single lock and with one shard per hardware thread.
+ **/
+TEST_F(BaseTest, DISABLED_CacheShardsContentionBenchmark)
+{
+    const int nLookupsPerThread = 100000;
+    const int maxThreads = std::max(2, QThread::idealThreadCount());
+    std::vector<int> shardsCounts;
+
+    shardsCounts.push_back(1);
+    shardsCounts.push_back(maxThreads);
+
+    for (std::size_t s = 0; s < shardsCounts.size(); ++s) {
+        ImageCache cache("ShardsBenchmarkCache", NATRON_CACHE_VERSION, 1024 * 1024 * 1024, 1., shardsCounts[s]);
+        std::vector<ImageKey> keys;
+        fillTestCache(&cache, 4096, &keys);
+
+        for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+            std::vector<CacheLookupThread*> threads;
+            for (int i = 0; i < nThreads; ++i) {
+                threads.push_back( new CacheLookupThread(&cache, &keys, nLookupsPerThread, i * 104729) );
+            }
+
+            TimeLapse timer;
+            for (int i = 0; i < nThreads; ++i) {
+                threads[i]->start();
+            }
+            for (int i = 0; i < nThreads; ++i) {
+                threads[i]->wait();
+                delete threads[i];
+            }
+            double elapsed = std::max(1e-6, timer.getTimeSinceCreation());
+
+            std::cout << "Cache lookups: " << cache.getShardsCount() << " shard(s), " << nThreads << " thread(s): "
+                      << (U64)( (double)nThreads * nLookupsPerThread / elapsed ) << " lookups/sec" << std::endl;
+        }
+        cache.waitForDeleterThread();
+    }
+}
@@ -24,12 +24,21 @@
 
 #include "Global/Macros.h"
 
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include <QtCore/QString>
 #include <QtCore/QDir>
+#include <QtCore/QMutex>
 
 #include "Engine/Curve.h"
+#include "Engine/Interpolation.h"
+#include "Engine/Timer.h"
 
 NATRON_NAMESPACE_USING
 
@@ -123,4 +132,252 @@ TEST(Curve, Basic)
     KeyFrame k2(1., 20.);
 }
 
+TEST(Curve, BatchValues)
+{
+    Curve c;
+
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(0., 10.) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(10., 20., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(20., 0., 0., 0., eKeyframeTypeConstant) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(30., 5.) ) );
+
+    // Increasing times, decreasing times and times on keyframes
+    std::vector<double> times;
+    for (double t = -5.; t <= 35.; t += 0.25) {
+        times.push_back(t);
+    }
+    for (double t = 35.; t >= -5.; t -= 2.5) {
+        times.push_back(t);
+    }
+    std::vector<double> values( times.size() );
+    c.getValuesAt( &times[0], (int)times.size(), &values[0] );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        EXPECT_EQ( c.getValueAt(times[i]), values[i] );
+    }
+
+    // Editing the curve updates the values
+    EXPECT_FALSE( c.addKeyFrame( KeyFrame(10., 40., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_EQ( 40., c.getValueAt(10.) );
+    double t = 10.;
+    double v;
+    c.getValuesAt(&t, 1, &v);
+    EXPECT_EQ(40., v);
+    c.removeKeyFrameWithTime(10.);
+    c.getValuesAt(&t, 1, &v);
+    EXPECT_EQ( c.getValueAt(10.), v );
+    EXPECT_NE(40., v);
+}
+
+// The curve evaluation before keyframes snapshots: the set of keyframes is searched under the curve mutex
+static double
+getValueAtWithKeyFrameSet(const KeyFrameSet& keys,
+                          QMutex* mutex,
+                          double t)
+{
+    QMutexLocker l(mutex);
+    KeyFrameSet::const_iterator itup = keys.upper_bound( KeyFrame(t, 0.) );
+
+    if ( itup == keys.begin() ) {
+        return Interpolation::interpolate(itup->getTime() - 1., itup->getValue(), 0., itup->getLeftDerivative(), itup->getTime(), itup->getValue(),
+                                          t, eKeyframeTypeNone, itup->getInterpolation());
+    } else if ( itup == keys.end() ) {
+        KeyFrameSet::const_reverse_iterator last = keys.rbegin();
+
+        return Interpolation::interpolate(last->getTime(), last->getValue(), last->getRightDerivative(), 0., last->getTime() + 1., last->getValue(),
+                                          t, last->getInterpolation(), eKeyframeTypeNone);
+    }
+    KeyFrameSet::const_iterator itcur = itup;
+    --itcur;
+
+    return Interpolation::interpolate(itcur->getTime(), itcur->getValue(), itcur->getRightDerivative(), itup->getLeftDerivative(), itup->getTime(), itup->getValue(),
+                                      t, itcur->getInterpolation(), itup->getInterpolation());
+}
+
+// Not a correctness test: prints the time taken to evaluate a curve with 10k keyframes
+TEST(Curve, DISABLED_Benchmark10kKeys)
+{
+    Curve c;
+    const int nKeys = 10000;
+    const KeyframeTypeEnum interpolations[] = {
+        eKeyframeTypeConstant, eKeyframeTypeLinear, eKeyframeTypeSmooth, eKeyframeTypeCubic, eKeyframeTypeFree
+    };
+
+    srand(2000);
+    for (int i = 0; i < nKeys; ++i) {
+        // coverity[dont_call]
+        double derivative = rand() % 10 - 5;
+        // coverity[dont_call]
+        c.addKeyFrame( KeyFrame(i * 1.5, rand() % 100, derivative, derivative, interpolations[rand() % 5]) );
+    }
+    KeyFrameSet keys = c.getKeyFrames_mt_safe();
+    QMutex mutex(QMutex::Recursive);
+
+    const int nTimes = 1000000;
+    std::vector<double> times(nTimes);
+    for (int i = 0; i < nTimes; ++i) {
+        times[i] = -10. + i * (nKeys * 1.5 + 20.) / nTimes;
+    }
+    std::vector<double> keyFrameSetValues(nTimes), values(nTimes), batchValues(nTimes);
+
+    TimeLapse timer;
+    for (int i = 0; i < nTimes; ++i) {
+        keyFrameSetValues[i] = getValueAtWithKeyFrameSet(keys, &mutex, times[i]);
+    }
+    double keyFrameSetTime = timer.getTimeElapsedReset();
+    for (int i = 0; i < nTimes; ++i) {
+        values[i] = c.getValueAt(times[i]);
+    }
+    double getValueAtTime = timer.getTimeElapsedReset();
+    c.getValuesAt(&times[0], nTimes, &batchValues[0]);
+    double getValuesAtTime = timer.getTimeElapsedReset();
+
+    std::cout << nTimes << " evaluations of a curve with " << nKeys << " keyframes: locked keyframe set "
+              << keyFrameSetTime * 1000. << " ms, getValueAt " << getValueAtTime * 1000. << " ms, getValuesAt "
+              << getValuesAtTime * 1000. << " ms" << std::endl;
+
+    for (int i = 0; i < nTimes; ++i) {
+        ASSERT_EQ(keyFrameSetValues[i], values[i]);
+        ASSERT_EQ(keyFrameSetValues[i], batchValues[i]);
+    }
+}
+
+static void
+expectSameKeyFrames(const Curve& a,
+                    const Curve& b)
+{
+    KeyFrameSet aKeys = a.getKeyFrames_mt_safe();
+    KeyFrameSet bKeys = b.getKeyFrames_mt_safe();
 
+    ASSERT_EQ( aKeys.size(), bKeys.size() );
+    for (KeyFrameSet::const_iterator ita = aKeys.begin(), itb = bKeys.begin(); ita != aKeys.end(); ++ita, ++itb) {
+        EXPECT_EQ(ita->getTime(), itb->getTime());
+        EXPECT_EQ(ita->getValue(), itb->getValue());
+        EXPECT_EQ(ita->getInterpolation(), itb->getInterpolation());
+        EXPECT_EQ(ita->getLeftDerivative(), itb->getLeftDerivative());
+        EXPECT_EQ(ita->getRightDerivative(), itb->getRightDerivative());
+    }
+}
+
+TEST(Curve, BulkKeyFrames)
+{
+    // Interpolations whose derivatives only depend on the neighbour values, so that the order in which
+    // derivatives are refreshed does not matter
+    const KeyframeTypeEnum interpolations[] = {
+        eKeyframeTypeConstant, eKeyframeTypeSmooth, eKeyframeTypeCatmullRom, eKeyframeTypeHorizontal
+    };
+    const int nKeys = 500;
+    std::list<KeyFrame> keys;
+
+    srand(2000);
+    for (int i = 0; i < nKeys; ++i) {
+        // coverity[dont_call]
+        double derivative = rand() % 10 - 5;
+        // coverity[dont_call]
+        KeyframeTypeEnum interp = (i == 0 || i == nKeys - 1) ? eKeyframeTypeFree : interpolations[rand() % 4];
+        // coverity[dont_call]
+        keys.push_back( KeyFrame(i, rand() % 100, derivative, derivative, interp) );
+    }
+
+    Curve a, b;
+    for (std::list<KeyFrame>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        a.addKeyFrame(*it);
+    }
+    std::list<double> keysAdded;
+    EXPECT_EQ( nKeys, b.addKeyFrames(keys, &keysAdded) );
+    EXPECT_EQ( (std::size_t)nKeys, keysAdded.size() );
+    expectSameKeyFrames(a, b);
+
+    // Replacing existing keyframes
+    std::list<KeyFrame> replacedKeys;
+    for (int i = 0; i < nKeys; i += 7) {
+        // coverity[dont_call]
+        replacedKeys.push_back( KeyFrame(i, -3., 0., 0., interpolations[rand() % 4]) );
+    }
+    for (std::list<KeyFrame>::const_iterator it = replacedKeys.begin(); it != replacedKeys.end(); ++it) {
+        a.addKeyFrame(*it);
+    }
+    EXPECT_EQ( 0, b.addKeyFrames(replacedKeys) );
+    expectSameKeyFrames(a, b);
+
+    // Removing keyframes, including the first one and a time without keyframe
+    std::list<double> times;
+    for (int i = 0; i < nKeys; i += 3) {
+        times.push_back(i);
+        a.removeKeyFrameWithTime(i);
+    }
+    times.push_back(nKeys + 0.5);
+    std::list<double> keysRemoved;
+    b.removeKeyFramesWithTimes(times, &keysRemoved);
+    EXPECT_EQ(times.size() - 1, keysRemoved.size());
+    expectSameKeyFrames(a, b);
+}
+
+TEST(Curve, UniformTimesLookup)
+{
+    Curve c;
+    std::list<KeyFrame> keys;
+
+    // 0.1 is not exactly representable: keyframe times are slightly off the grid
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back( KeyFrame(3.3 + i * 0.1, std::sin(i * 0.05) * 10., 0., 0., i % 3 ? eKeyframeTypeSmooth : eKeyframeTypeLinear) );
+    }
+    c.addKeyFrames(keys);
+
+    KeyFrameSet keySet = c.getKeyFrames_mt_safe();
+    QMutex mutex(QMutex::Recursive);
+    for (double t = 0.; t < 110.; t += 0.0137) {
+        ASSERT_EQ( getValueAtWithKeyFrameSet(keySet, &mutex, t), c.getValueAt(t) );
+    }
+    // On and just before each keyframe
+    for (KeyFrameSet::const_iterator it = keySet.begin(); it != keySet.end(); ++it) {
+        double t = it->getTime();
+        ASSERT_EQ( getValueAtWithKeyFrameSet(keySet, &mutex, t), c.getValueAt(t) );
+        double before = t - std::abs(t) * std::numeric_limits<double>::epsilon();
+        ASSERT_EQ( getValueAtWithKeyFrameSet(keySet, &mutex, before), c.getValueAt(before) );
+    }
+
+    // A keyframe between two others breaks the uniform spacing
+    c.addKeyFrame( KeyFrame(3.35, 1.) );
+    keySet = c.getKeyFrames_mt_safe();
+    for (double t = 0.; t < 110.; t += 0.0137) {
+        ASSERT_EQ( getValueAtWithKeyFrameSet(keySet, &mutex, t), c.getValueAt(t) );
+    }
+}
+
+// Not a correctness test: prints the time taken to set and remove the keyframes of a curve with a keyframe on every frame
+TEST(Curve, DISABLED_BenchmarkDenseKeyFrames)
+{
+    const int nKeys = 20000;
+    std::list<KeyFrame> keys;
+    std::list<double> removedTimes;
+
+    srand(2000);
+    for (int i = 0; i < nKeys; ++i) {
+        // coverity[dont_call]
+        keys.push_back( KeyFrame(i, rand() % 100) );
+        if (i % 2) {
+            removedTimes.push_back(i);
+        }
+    }
+
+    Curve a, b;
+    TimeLapse timer;
+    for (std::list<KeyFrame>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        a.addKeyFrame(*it);
+    }
+    double addKeyFrameTime = timer.getTimeElapsedReset();
+    b.addKeyFrames(keys);
+    double addKeyFramesTime = timer.getTimeElapsedReset();
+    for (std::list<double>::const_iterator it = removedTimes.begin(); it != removedTimes.end(); ++it) {
+        a.removeKeyFrameWithTime(*it);
+    }
+    double removeKeyFrameTime = timer.getTimeElapsedReset();
+    b.removeKeyFramesWithTimes(removedTimes);
+    double removeKeyFramesTime = timer.getTimeElapsedReset();
+
+    std::cout << "Setting " << nKeys << " keyframes: addKeyFrame " << addKeyFrameTime * 1000. << " ms, addKeyFrames "
+              << addKeyFramesTime * 1000. << " ms. Removing " << removedTimes.size() << " keyframes: removeKeyFrameWithTime "
+              << removeKeyFrameTime * 1000. << " ms, removeKeyFramesWithTimes " << removeKeyFramesTime * 1000. << " ms" << std::endl;
+
+    expectSameKeyFrames(a, b);
+}
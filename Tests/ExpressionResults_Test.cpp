@@ -0,0 +1,85 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <gtest/gtest.h>
+
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+
+#include "BaseTest.h"
+
+NATRON_NAMESPACE_USING
+
+// Returns true if the value of the expression at the given time was found in the results cache
+static bool
+isExpressionResultCached(const KnobDoublePtr& knob,
+                         double time,
+                         double expectedValue)
+{
+    U64 hits, misses;
+
+    knob->getExpressionsResultsStats(&hits, &misses);
+    EXPECT_DOUBLE_EQ( expectedValue, knob->getValueAtTime(time) );
+
+    U64 newHits, newMisses;
+    knob->getExpressionsResultsStats(&newHits, &newMisses);
+    EXPECT_EQ(hits + misses + 1, newHits + newMisses);
+
+    return newHits == hits + 1;
+}
+
+TEST_F(BaseTest, ExpressionResultsInvalidation)
+{
+    NodePtr source = createNode(_generatorPluginID);
+    NodePtr target = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(source && target);
+    KnobDoublePtr sourceSlope = toKnobDouble( source->getKnobByName("noiseZSlope") );
+    KnobDoublePtr targetSlope = toKnobDouble( target->getKnobByName("noiseZSlope") );
+    KnobBoolPtr targetDisabled = toKnobBool( target->getKnobByName(kDisableNodeKnobName) );
+    ASSERT_TRUE(sourceSlope && targetSlope && targetDisabled);
+
+    sourceSlope->setValue(0.1);
+    targetSlope->setExpression(0, source->getScriptName_mt_safe() + ".noiseZSlope.get() * 2", false, true);
+    EXPECT_TRUE( targetSlope->hasExpressionWithTrackedDependencies(0) );
+
+    EXPECT_FALSE( isExpressionResultCached(targetSlope, 10, 0.2) );
+    EXPECT_TRUE( isExpressionResultCached(targetSlope, 10, 0.2) );
+
+    // Changing a knob the expression does not depend on keeps its results, even on the same node
+    targetDisabled->setValue(true);
+    EXPECT_TRUE( isExpressionResultCached(targetSlope, 10, 0.2) );
+
+    // Changing a knob it depends on invalidates them
+    sourceSlope->setValue(0.3);
+    EXPECT_FALSE( isExpressionResultCached(targetSlope, 10, 0.6) );
+    EXPECT_TRUE( isExpressionResultCached(targetSlope, 10, 0.6) );
+
+    // Expressions using the values of their own knob are still invalidated by any change of the node
+    targetSlope->setExpression(0, "thisParam.getValue() + " + source->getScriptName_mt_safe() + ".noiseZSlope.get()", false, true);
+    EXPECT_FALSE( targetSlope->hasExpressionWithTrackedDependencies(0) );
+}
@@ -25,9 +25,14 @@
 #include "Global/Macros.h"
 
 #include <cstdlib>
+#include <iostream>
+#include <vector>
 #include <gtest/gtest.h>
 
+#include <QtCore/QString>
+
 #include "Engine/Hash64.h"
+#include "Engine/Timer.h"
 
 NATRON_NAMESPACE_USING
 
@@ -90,3 +95,145 @@ TEST(Hash64,
     EXPECT_NE(hash1, hash2);
 } // TEST
 
+
+TEST(Hash64,
+     IncrementalCompute)
+{
+    // computeHash() may be called at any point without altering the running state
+    Hash64 hash1, hash2;
+
+    for (int i = 0; i < 11; ++i) {
+        hash1.append<int>(i);
+        hash1.computeHash();
+        hash2.append<int>(i);
+    }
+    hash2.computeHash();
+    EXPECT_EQ(hash1, hash2);
+
+    // all sizes around the 4 values stripe give distinct hashes
+    std::vector<U64> values;
+    for (int n = 1; n < 10; ++n) {
+        Hash64 h;
+        for (int i = 0; i < n; ++i) {
+            h.append<int>(0);
+        }
+        h.computeHash();
+        ASSERT_TRUE( h.valid() );
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            EXPECT_NE(values[i], h.value());
+        }
+        values.push_back( h.value() );
+    }
+}
+
+TEST(Hash64,
+     QStringTest)
+{
+    Hash64 hash1, hash2, hash3;
+
+    Hash64_appendQString( &hash1, QString::fromUtf8("/path/to/sequence.####.exr") );
+    hash1.computeHash();
+    Hash64_appendQString( &hash2, QString::fromUtf8("/path/to/sequence.####.exr") );
+    hash2.computeHash();
+    EXPECT_EQ(hash1, hash2);
+
+    // consecutive strings must not hash as their concatenation
+    hash1.reset();
+    hash2.reset();
+    Hash64_appendQString( &hash1, QString::fromUtf8("ab") );
+    Hash64_appendQString( &hash1, QString::fromUtf8("c") );
+    hash1.computeHash();
+    Hash64_appendQString( &hash2, QString::fromUtf8("a") );
+    Hash64_appendQString( &hash2, QString::fromUtf8("bc") );
+    hash2.computeHash();
+    Hash64_appendQString( &hash3, QString::fromUtf8("abc") );
+    hash3.computeHash();
+    EXPECT_NE(hash1, hash2);
+    EXPECT_NE(hash1, hash3);
+    EXPECT_NE(hash2, hash3);
+}
+
+// Reference values computed with the xxHash library (XXH64)
+TEST(Hash64,
+     ReferenceValues)
+{
+    unsigned char buffer[128];
+
+    for (int i = 0; i < 128; ++i) {
+        buffer[i] = (unsigned char)(i * 31 + 7);
+    }
+
+    // empty input
+    EXPECT_EQ( 0xEF46DB3751D8E999ULL, Hash64::xxHash64(buffer, 0) );
+    EXPECT_EQ( 0xAC75FDA2929B17EFULL, Hash64::xxHash64(buffer, 0, 2654435761ULL) );
+
+    // less than a 32 bytes stripe: 1 byte, 4 bytes and 8 bytes tails
+    EXPECT_EQ( 0x44BC2CF5AD770999ULL, Hash64::xxHash64("abc", 3) );
+    EXPECT_EQ( 0x1318DF30094A85FDULL, Hash64::xxHash64("abc", 3, 2654435761ULL) );
+    EXPECT_EQ( 0x9CA7E6A41C4FC5C9ULL, Hash64::xxHash64("Natron node hash", 16) );
+    EXPECT_EQ( 0x5B8B20848026A972ULL, Hash64::xxHash64("Natron streaming hash, 31 bytes", 31) );
+
+    // full stripes
+    EXPECT_EQ( 0x8D57D6A4671CC43DULL, Hash64::xxHash64(buffer, 32) );
+
+    // unaligned start, and a tail of 4 bytes and 1 byte after the stripes
+    EXPECT_EQ( 0x58F9EF300BC65CDAULL, Hash64::xxHash64(buffer + 1, 101) );
+    EXPECT_EQ( 0x0BD91D831ED2418FULL, Hash64::xxHash64(buffer + 1, 101, 0x9E3779B97F4A7C15ULL) );
+}
+
+TEST(Hash64,
+     StreamingMatchesReference)
+{
+    // XXH64 with seed 0 of the little-endian bytes of the n values 1, 0x0123456789ABCDEF + 1, ...
+    const U64 expected[9] = {
+        0x9F29CB17A2A49995ULL, 0x19048E4F9F4F0E90ULL, 0x9FCA5D07F7FF028EULL,
+        0xB12C2212FC853B0FULL, 0xD4C4F93A60B8EABFULL, 0xEE8CCAD6B7464679ULL,
+        0x83C4F2BA0896D5FFULL, 0xAD2206B1F44FC08CULL, 0xAFBC42C36605FD4BULL
+    };
+
+    for (int n = 1; n <= 9; ++n) {
+        Hash64 hash;
+        unsigned char bytes[9 * 8];
+        for (int i = 0; i < n; ++i) {
+            U64 v = (U64)i * 0x0123456789ABCDEFULL + 1;
+            hash.append<U64>(v);
+            for (int b = 0; b < 8; ++b) {
+                bytes[i * 8 + b] = (unsigned char)(v >> (8 * b));
+            }
+        }
+        hash.computeHash();
+        EXPECT_EQ( expected[n - 1], hash.value() ) << n << " values";
+        EXPECT_EQ( Hash64::xxHash64(bytes, n * 8), hash.value() ) << n << " values";
+    }
+}
+
+// Not a correctness test: prints the throughput of hashing something close
+// to what Node::computeHashInternal feeds for a node with many knobs and a
+// few long string knobs (file paths, expressions).
+TEST(Hash64,
+     DISABLED_Benchmark)
+{
+    const int nIterations = 20000;
+    const int nKnobValues = 200;
+    QString path = QString::fromUtf8("/very/long/path/to/the/project/footage/shot_010/plate/v003/plate_shot_010_v003.####.exr");
+    QString expression = QString::fromUtf8("thisGroup.Transform1.translate.get()[dimension] * frame / 24. + random(frame, 0.5)");
+    U64 sum = 0;
+    TimeLapse timer;
+
+    for (int it = 0; it < nIterations; ++it) {
+        Hash64 hash;
+        for (int i = 0; i < nKnobValues; ++i) {
+            hash.append<double>(i * 0.5 + it);
+        }
+        for (int i = 0; i < 4; ++i) {
+            Hash64_appendQString(&hash, path);
+            Hash64_appendQString(&hash, expression);
+        }
+        hash.computeHash();
+        sum += hash.value();
+    }
+    double elapsed = timer.getTimeSinceCreation();
+    EXPECT_NE(sum, (U64)0);
+    std::cout << "Hash64: " << nIterations << " node hashes in " << elapsed << " s ("
+              << (elapsed > 0. ? nIterations / elapsed : 0.) << " hashes/s)" << std::endl;
+}
@@ -24,14 +24,33 @@
 
 #include "Global/Macros.h"
 
+#include <cstdlib>
 #include <cstring>
 #include <gtest/gtest.h>
 
 #include "Engine/Image.h"
+#include "Engine/Lut.h"
 #include "Engine/ViewIdx.h"
 
 NATRON_NAMESPACE_USING
 
+// Returns true if all the pixels of rect in the bitmap have the given state
+static bool
+bitmapOnlyContains(const Bitmap& bm,
+                   const RectI& rect,
+                   char state)
+{
+    for (int y = rect.y1; y < rect.y2; ++y) {
+        for (int x = rect.x1; x < rect.x2; ++x) {
+            if (bm.getPixel(x, y) != state) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 TEST(BitmapTest,
      SimpleRect)
 {
@@ -51,8 +70,10 @@ TEST(BitmapTest,
     ASSERT_TRUE(rod == nonRenderedRectsUnion);
 
     ///assert that the "underlying" bitmap is clean
-    const char* map = bm.getBitmap();
-    ASSERT_TRUE( !memchr( map, 1, rod.area() ) );
+    ASSERT_TRUE( bitmapOnlyContains(bm, rod, 0) );
+
+    ///2 bits per pixel
+    ASSERT_TRUE( bm.getMemorySize() <= (std::size_t)(rod.area() / 4 + rod.height() * 8) );
 
     RectI halfRoD(0, 0, 100, 50);
     bm.markForRendered(halfRoD);
@@ -66,14 +87,12 @@ TEST(BitmapTest,
 
 
     ///assert that the underlying bitmap is marked as expected
-    const char* start = map;
 
     ///check that there are only ones in the rendered half
-    ASSERT_TRUE( !memchr( start, 0, halfRoD.area() ) );
+    ASSERT_TRUE( bitmapOnlyContains(bm, halfRoD, 1) );
 
     ///check that there are only 0s in the non rendered half
-    start = map + halfRoD.area();
-    ASSERT_TRUE( !memchr( start, 1, halfRoD.area() ) );
+    ASSERT_TRUE( bitmapOnlyContains(bm, nonRenderedHalf, 0) );
 
     ///mark for renderer the other half of the rod
     bm.markForRendered(nonRenderedHalf);
@@ -82,7 +101,7 @@ TEST(BitmapTest,
     nonRenderedRects.clear();
     bm.minimalNonMarkedRects(rod, nonRenderedRects);
     ASSERT_TRUE( nonRenderedRects.empty() );
-    ASSERT_TRUE( !memchr( map, 0, rod.area() ) );
+    ASSERT_TRUE( bitmapOnlyContains(bm, rod, 1) );
 
     ///More complex example where A,B,C,D are not rendered check that both trimap & bitmap yield the same result
     // BBBBBBBBBBBBBB
@@ -114,6 +133,65 @@ TEST(BitmapTest,
     EXPECT_TRUE(nonRenderedRects.size() == 3);
 } // TEST
 
+TEST(BitmapTest,
+     UnalignedBoundsAndCopy)
+{
+    // The bounds are not a multiple of the 32 pixels stored per word
+    RectI bounds(-37, -5, 93, 20);
+    Bitmap bm(bounds);
+    RectI rendered(-30, -5, 60, 20);
+
+    bm.markForRendered(rendered);
+    ASSERT_TRUE( bitmapOnlyContains(bm, rendered, 1) );
+    ASSERT_TRUE( bitmapOnlyContains(bm, RectI(-37, -5, -30, 20), 0) );
+    ASSERT_TRUE( bitmapOnlyContains(bm, RectI(60, -5, 93, 20), 0) );
+
+    std::list<RectI> nonRenderedRects;
+    bm.minimalNonMarkedRects(bounds, nonRenderedRects);
+    ASSERT_EQ( (std::size_t)2, nonRenderedRects.size() );
+    EXPECT_TRUE( nonRenderedRects.front() == RectI(-37, -5, -30, 20) );
+    EXPECT_TRUE( nonRenderedRects.back() == RectI(60, -5, 93, 20) );
+    EXPECT_TRUE( bm.minimalNonMarkedBbox(rendered).isNull() );
+
+    // A pixel being rendered elsewhere in the middle of the rendered area
+    bool beingRenderedElseWhere = false;
+    bm.markForRendering( RectI(10, 0, 11, 1) );
+    nonRenderedRects.clear();
+    bm.minimalNonMarkedRects_trimap(rendered, nonRenderedRects, &beingRenderedElseWhere);
+    EXPECT_TRUE( nonRenderedRects.empty() );
+    EXPECT_TRUE(beingRenderedElseWhere);
+    EXPECT_TRUE( bm.minimalNonMarkedBbox(rendered) == RectI(10, 0, 11, 1) );
+
+    // Copy to a bitmap with a different alignment
+    Bitmap other( RectI(-100, -10, 100, 30) );
+    other.markForRendering( other.getBounds() );
+    RectI copied(-35, -3, 90, 18);
+    other.copyBitmapPortion(copied, bm);
+    for (int y = other.getBounds().y1; y < other.getBounds().y2; ++y) {
+        for (int x = other.getBounds().x1; x < other.getBounds().x2; ++x) {
+            bool inside = x >= copied.x1 && x < copied.x2 && y >= copied.y1 && y < copied.y2;
+            ASSERT_EQ(inside ? bm.getPixel(x, y) : 2, other.getPixel(x, y)) << x << "," << y;
+        }
+    }
+}
+
+TEST(BitmapTest,
+     ImageSizeCountsPackedBitmap)
+{
+    // 130 pixels wide: each row of the bitmap takes 5 words of 32 pixels
+    RectI bounds(-37, -5, 93, 20);
+    RectD rod(-37, -5, 93, 20);
+    ImagePtr img( new Image(ImageComponents::getRGBAComponents(), rod, bounds, 0, 1., eImageBitDepthFloat,
+                            eImagePremultiplicationPremultiplied, eImageFieldingOrderNone, true) );
+
+    EXPECT_EQ( (std::size_t)bounds.area() * 4 * sizeof(float), img->dataSize() );
+    EXPECT_EQ( img->dataSize() + (std::size_t)5 * bounds.height() * sizeof(U64), img->size() );
+
+    ImagePtr noBitmap( new Image(ImageComponents::getRGBAComponents(), rod, bounds, 0, 1., eImageBitDepthFloat,
+                                 eImagePremultiplicationPremultiplied, eImageFieldingOrderNone, false) );
+    EXPECT_EQ( noBitmap->dataSize(), noBitmap->size() );
+}
+
 TEST(ImageKeyTest, Equality) {
     srand(2000);
     // coverity[dont_call]
@@ -157,3 +235,108 @@ TEST(ImageKeyTest, Difference) {
     ASSERT_TRUE(keyHash1 != keyHash2);
 }
 
+
+static const ImageComponents&
+componentsForCount(int nComps)
+{
+    switch (nComps) {
+    case 1:
+        return ImageComponents::getAlphaComponents();
+    case 2:
+        return ImageComponents::getXYComponents();
+    case 3:
+        return ImageComponents::getRGBComponents();
+    default:
+        return ImageComponents::getRGBAComponents();
+    }
+}
+
+static int
+bytesPerComponent(ImageBitDepthEnum depth)
+{
+    return depth == eImageBitDepthByte ? 1 : (depth == eImageBitDepthShort ? 2 : 4);
+}
+
+static ImagePtr
+makeRandomImage(int nComps,
+                ImageBitDepthEnum depth,
+                const RectI& bounds,
+                unsigned int level)
+{
+    RectD rod(0, 0, 64, 64);
+    ImagePtr img( new Image(componentsForCount(nComps), rod, bounds, level, 1., depth, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone) );
+    Image::WriteAccess acc = img->getWriteRights();
+    unsigned char* data = acc.pixelAt(bounds.x1, bounds.y1);
+    int n = bounds.area() * nComps;
+
+    for (int i = 0; i < n; ++i) {
+        // coverity[dont_call]
+        int v = rand();
+        switch (depth) {
+        case eImageBitDepthByte:
+            data[i] = (unsigned char)v;
+            break;
+        case eImageBitDepthShort:
+            ( (unsigned short*)data )[i] = (unsigned short)v;
+            break;
+        default:
+            ( (float*)data )[i] = v / (float)RAND_MAX;
+            break;
+        }
+    }
+
+    return img;
+}
+
+static bool
+imagesEqual(const ImagePtr& a,
+            const ImagePtr& b)
+{
+    if ( a->getBounds() != b->getBounds() ) {
+        return false;
+    }
+    Image::ReadAccess accA = a->getReadRights();
+    Image::ReadAccess accB = b->getReadRights();
+    const RectI& bounds = a->getBounds();
+
+    return std::memcmp( accA.pixelAt(bounds.x1, bounds.y1), accB.pixelAt(bounds.x1, bounds.y1),
+                        bounds.area() * a->getComponentsCount() * bytesPerComponent( a->getBitDepth() ) ) == 0;
+}
+
+// Check that building 3 mipmap levels at once gives the same result as halving 3 times, and that
+// the SIMD box filters give the same result as the scalar code.
+TEST(ImageMipMapTest,
+     DownscaleMatchesScalarAndSequential)
+{
+    ImageBitDepthEnum depths[3] = {
+        eImageBitDepthByte, eImageBitDepthShort, eImageBitDepthFloat
+    };
+    // odd sizes and origin to exercise the borders
+    RectI bounds(-3, 1, 70, 46);
+    RectD rod(0, 0, 64, 64);
+
+    srand(2000);
+    for (int d = 0; d < 3; ++d) {
+        for (int nComps = 1; nComps <= 4; ++nComps) {
+            ImagePtr src = makeRandomImage(nComps, depths[d], bounds, 0);
+            RectI level3Bounds = bounds.downscalePowerOfTwoSmallestEnclosing(3);
+
+            ImagePtr fused = makeRandomImage(nComps, depths[d], level3Bounds, 3);
+            src->downscaleMipMap(rod, bounds, 0, 3, false, fused.get());
+
+            Color::setSIMDEnabled(false);
+            ImagePtr scalar = makeRandomImage(nComps, depths[d], level3Bounds, 3);
+            src->downscaleMipMap(rod, bounds, 0, 3, false, scalar.get());
+            Color::setSIMDEnabled(true);
+            EXPECT_TRUE( imagesEqual(fused, scalar) ) << "depth " << depths[d] << ", " << nComps << " components";
+
+            ImagePtr previous = src;
+            for (unsigned int level = 1; level <= 3; ++level) {
+                ImagePtr halved = makeRandomImage(nComps, depths[d], bounds.downscalePowerOfTwoSmallestEnclosing(level), level);
+                previous->downscaleMipMap(rod, previous->getBounds(), level - 1, level, false, halved.get());
+                previous = halved;
+            }
+            EXPECT_TRUE( imagesEqual(fused, previous) ) << "depth " << depths[d] << ", " << nComps << " components";
+        }
+    }
+}
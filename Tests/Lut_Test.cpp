@@ -25,8 +25,12 @@
 #include "Global/Macros.h"
 
 #include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
 #include <gtest/gtest.h>
 #include "Engine/Lut.h"
+#include "Engine/Timer.h"
 
 NATRON_NAMESPACE_USING
 using namespace NATRON_NAMESPACE::Color;
@@ -51,3 +55,106 @@ TEST(Lut, IntConversions) {
         EXPECT_EQ( i, uint8xxToChar( charToUint8xx(i) ) );
     }
 }
+
+template <typename SRCPIX, typename DSTPIX>
+static void
+checkConvertDepthRow(const std::vector<SRCPIX>& input)
+{
+    // odd sizes so that the scalar remainder is exercised as well
+    int n = (int)input.size() - 3;
+    std::vector<DSTPIX> simd(n), scalar(n);
+
+    setSIMDEnabled(true);
+    convertDepthRow(&input[0], &simd[0], n);
+    setSIMDEnabled(false);
+    convertDepthRow(&input[0], &scalar[0], n);
+    setSIMDEnabled(true);
+    EXPECT_EQ( 0, std::memcmp( &simd[0], &scalar[0], n * sizeof(DSTPIX) ) );
+}
+
+static std::vector<float>
+makeFloatTestRow()
+{
+    std::vector<float> ret;
+
+    // all exact 8 and 16 bits values, values out of the [0,1] range and random values
+    for (int i = 0; i < 0x10000; ++i) {
+        ret.push_back( intToFloat<65536>(i) );
+    }
+    for (int i = 0; i < 0x100; ++i) {
+        ret.push_back( intToFloat<256>(i) );
+    }
+    srand(2000);
+    for (int i = 0; i < 0x10000; ++i) {
+        // coverity[dont_call]
+        ret.push_back( rand() / (float)RAND_MAX * 1.4f - 0.2f );
+    }
+
+    return ret;
+}
+
+TEST(Lut, RowConversionsMatchScalar) {
+    if ( !isSIMDAvailable() ) {
+        std::cout << "SIMD row converters not available, nothing to compare" << std::endl;
+
+        return;
+    }
+    std::vector<float> floats = makeFloatTestRow();
+    std::vector<unsigned char> bytes;
+    std::vector<unsigned short> shorts;
+    for (int i = 0; i < 0x10000 + 17; ++i) {
+        bytes.push_back( (unsigned char)(i & 0xff) );
+        shorts.push_back( (unsigned short)(i & 0xffff) );
+    }
+
+    checkConvertDepthRow<unsigned char, float>(bytes);
+    checkConvertDepthRow<unsigned short, float>(shorts);
+    checkConvertDepthRow<float, unsigned char>(floats);
+    checkConvertDepthRow<float, unsigned short>(floats);
+    checkConvertDepthRow<unsigned short, unsigned char>(shorts);
+    checkConvertDepthRow<unsigned char, unsigned short>(bytes);
+
+    int nPixels = (int)floats.size() / 3 - 1;
+    std::vector<float> simd(nPixels * 4), scalar(nPixels * 4);
+    setSIMDEnabled(true);
+    expandRGBToRGBARow(&floats[0], &simd[0], nPixels, 1.f);
+    setSIMDEnabled(false);
+    expandRGBToRGBARow(&floats[0], &scalar[0], nPixels, 1.f);
+    setSIMDEnabled(true);
+    EXPECT_EQ( 0, std::memcmp( &simd[0], &scalar[0], simd.size() * sizeof(float) ) );
+}
+
+template <typename SRCPIX, typename DSTPIX>
+static void
+benchmarkConvertDepthRow(const char* name)
+{
+    const int nPixels = 1920 * 1080;
+    const int nIterations = 20;
+    std::vector<SRCPIX> input(nPixels * 4);
+    std::vector<DSTPIX> output(nPixels * 4);
+
+    for (int simd = 0; simd < 2; ++simd) {
+        if ( simd && !isSIMDAvailable() ) {
+            break;
+        }
+        setSIMDEnabled(simd);
+        TimeLapse timer;
+        for (int i = 0; i < nIterations; ++i) {
+            convertDepthRow(&input[0], &output[0], nPixels * 4);
+        }
+        double elapsed = timer.getTimeSinceCreation();
+        std::cout << name << (simd ? " (SIMD): " : " (scalar): ")
+                  << (elapsed > 0. ? nPixels * (double)nIterations / elapsed / 1e6 : 0.) << " MPix/s (RGBA)" << std::endl;
+    }
+    setSIMDEnabled(true);
+}
+
+// Not a correctness test: prints the throughput of each kernel
+TEST(Lut, DISABLED_RowConversionsBenchmark) {
+    benchmarkConvertDepthRow<unsigned char, float>("byte to float");
+    benchmarkConvertDepthRow<unsigned short, float>("short to float");
+    benchmarkConvertDepthRow<float, unsigned char>("float to byte");
+    benchmarkConvertDepthRow<float, unsigned short>("float to short");
+    benchmarkConvertDepthRow<unsigned short, unsigned char>("short to byte");
+    benchmarkConvertDepthRow<unsigned char, unsigned short>("byte to short");
+}
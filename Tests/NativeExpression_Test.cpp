@@ -0,0 +1,310 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/NativeExpression.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+/**
+ * @brief A node Blur1 with the parameters size (Double, 2 dimensions), passes (Int), color (Color, 3 dimensions),
+ * and enabled (Bool), which is also thisNode. thisParam is a Double parameter. Values are the parameter index + 10 * the dimension + the time.
+ **/
+class TestScope
+    : public NativeExpression::Scope
+    , public NativeExpression::Context
+{
+public:
+
+    TestScope()
+        : evaluationTime(0.)
+    {
+    }
+
+    virtual ~TestScope() {}
+
+    virtual bool isNameDeclared(const std::string& name) const OVERRIDE FINAL
+    {
+        return name == "Blur1" || name == "thisNode" || name == "random";
+    }
+
+    virtual int getParamIndex(const std::string& nodeName,
+                              const std::string& paramName,
+                              NativeExpression::ParamTypeEnum* type,
+                              int* nDims) OVERRIDE FINAL
+    {
+        if (nodeName == "thisParam") {
+            *type = NativeExpression::eParamTypeDouble;
+            *nDims = 1;
+
+            return 0;
+        }
+        if ( (nodeName != "Blur1") && (nodeName != "thisNode") ) {
+            return -1;
+        }
+        if (paramName == "size") {
+            *type = NativeExpression::eParamTypeDouble;
+            *nDims = 2;
+
+            return 1;
+        } else if (paramName == "passes") {
+            *type = NativeExpression::eParamTypeInt;
+            *nDims = 1;
+
+            return 2;
+        } else if (paramName == "color") {
+            *type = NativeExpression::eParamTypeColor;
+            *nDims = 3;
+
+            return 3;
+        } else if (paramName == "enabled") {
+            *type = NativeExpression::eParamTypeBool;
+            *nDims = 1;
+
+            return 4;
+        }
+
+        return -1;
+    }
+
+    virtual bool getParamValue(int paramIndex,
+                               int dimension,
+                               bool atTime,
+                               double time,
+                               double* value) OVERRIDE FINAL
+    {
+        *value = paramIndex + 10 * dimension + (atTime ? time : evaluationTime);
+
+        return true;
+    }
+
+    double evaluationTime;
+};
+
+static bool
+evaluate(const std::string& expression,
+         double frame,
+         double* value,
+         bool* isInt)
+{
+    TestScope scope;
+    NativeExpression program;
+    std::string error;
+
+    if ( !program.compile(expression, scope, &error) ) {
+        return false;
+    }
+    scope.evaluationTime = frame;
+
+    return program.evaluate(frame, 0, 1, scope, value, isInt);
+}
+
+static void
+expectResult(const std::string& expression,
+             double expected,
+             bool expectedIsInt,
+             double frame = 1.)
+{
+    double value = 0.;
+    bool isInt = false;
+
+    ASSERT_TRUE( evaluate(expression, frame, &value, &isInt) ) << expression;
+    EXPECT_DOUBLE_EQ(expected, value) << expression;
+    EXPECT_EQ(expectedIsInt, isInt) << expression;
+}
+
+static bool
+compiles(const std::string& expression)
+{
+    TestScope scope;
+    NativeExpression program;
+    std::string error;
+
+    return program.compile(expression, scope, &error);
+}
+
+TEST(NativeExpression, Python2Semantics) {
+    expectResult("1 + 2 * 3", 7, true);
+    expectResult("(1 + 2) * 3", 9, true);
+    expectResult("7 / 2", 3, true);
+    expectResult("-7 / 2", -4, true);
+    expectResult("7 / 2.", 3.5, false);
+    expectResult("7.5 // 2", 3, false);
+    expectResult("-7 % 3", 2, true);
+    expectResult("7 % -3", -2, true);
+    expectResult("-2 ** 2", -4, true);
+    expectResult("2 ** -1", 0.5, false);
+    expectResult("2 ** 3 ** 2", 512, true);
+    expectResult("1e3 + .5", 1000.5, false);
+    expectResult("3 < 4", 1, true);
+    expectResult("3 + 1 == 4.", 1, true);
+    expectResult("abs(-3)", 3, true);
+    expectResult("floor(2.5) + ceil(2.5)", 5, false);
+    expectResult("round(2.5) + round(-2.5)", 0, false);
+    expectResult("round(0.49999999999999994)", 0, false);
+    expectResult("int(-3.7)", -3, true);
+    expectResult("float(3)", 3, false);
+    expectResult("max(1, 2.5, 2)", 2.5, false);
+    expectResult("min(3, 1, 2)", 1, true);
+    expectResult("sqrt(16) + pow(2, 3)", 12, false);
+    expectResult("log(8, 2)", 3, false);
+    expectResult("degrees(pi)", 180, false);
+    expectResult("frame * 2", 10, true, 5.);
+    expectResult("frame * 2", 11, false, 5.5);
+    expectResult("dimension + view", 1, true);
+}
+
+TEST(NativeExpression, Parameters) {
+    // At frame 1
+    expectResult("thisParam.get()", 1, false);
+    expectResult("thisParam.getValue() + thisParam.getValueAtTime(frame + 2)", 4, false);
+    expectResult("Blur1.size.get()[1]", 12, false);
+    expectResult("Blur1.size.get().y", 12, false);
+    expectResult("Blur1.size.get(5).x", 6, false);
+    expectResult("Blur1.size.getValue(1)", 12, false);
+    expectResult("Blur1.size.getValueAtTime(frame - 1, 1)", 11, false);
+    expectResult("Blur1.passes.get() / 2", 1, true);
+    expectResult("Blur1.color.get().b", 24, false);
+    expectResult("Blur1.color.get()[3]", 1, false);
+    expectResult("Blur1.enabled.get() + 1", 6, true);
+}
+
+TEST(NativeExpression, Unsupported) {
+    // Anything but the common subset is left to Python
+    EXPECT_FALSE( compiles("") );
+    EXPECT_FALSE( compiles("frame if frame > 1 else 0") );
+    EXPECT_FALSE( compiles("frame > 1 and frame < 10") );
+    EXPECT_FALSE( compiles("1 < frame < 10") );
+    EXPECT_FALSE( compiles("\"text\"") );
+    EXPECT_FALSE( compiles("(1, 2)") );
+    EXPECT_FALSE( compiles("010") );
+    EXPECT_FALSE( compiles("0x10") );
+    EXPECT_FALSE( compiles("random()") );
+    EXPECT_FALSE( compiles("math.sin(frame)") );
+    EXPECT_FALSE( compiles("unknown(frame)") );
+    EXPECT_FALSE( compiles("sin()") );
+    EXPECT_FALSE( compiles("Blur1") );
+    EXPECT_FALSE( compiles("Blur1.size.get()") );
+    EXPECT_FALSE( compiles("Blur1.size.get()[2]") );
+    EXPECT_FALSE( compiles("Blur1.size.getValue(2)") );
+    EXPECT_FALSE( compiles("Blur1.size.getValue(dimension)") );
+    EXPECT_FALSE( compiles("Blur1.passes.get()[0]") );
+    EXPECT_FALSE( compiles("Blur1.missing.get()") );
+    EXPECT_FALSE( compiles("Blur1.size.getDerivativeAtTime(frame)") );
+    EXPECT_FALSE( compiles("Merge1.mix.get()") );
+    EXPECT_FALSE( compiles("thisNode.size.get().z") );
+
+    // Evaluations raising an exception in Python fail
+    double value;
+    bool isInt;
+    EXPECT_FALSE( evaluate("1 / (frame - 1)", 1., &value, &isInt) );
+    EXPECT_FALSE( evaluate("frame % 0", 1., &value, &isInt) );
+    EXPECT_FALSE( evaluate("sqrt(-frame)", 1., &value, &isInt) );
+    EXPECT_FALSE( evaluate("log(frame - 1)", 1., &value, &isInt) );
+    EXPECT_FALSE( evaluate("(-frame) ** 0.5", 1., &value, &isInt) );
+    EXPECT_FALSE( evaluate("10. ** 400", 1., &value, &isInt) );
+}
+
+// Not a correctness test: prints the number of evaluations per second of a typical expression, natively and by Python.
+// The Python version only declares the variables it uses, where Natron declares all the nodes of the group before
+// each evaluation, so the actual speedup is higher.
+TEST(NativeExpression, DISABLED_BenchmarkEvaluations) {
+    const std::string expression = "thisNode.size.get().x * 2 + sin(frame / 10.) * thisParam.getValue()";
+    const int nEvaluations = 200000;
+
+    TestScope scope;
+    NativeExpression program;
+    std::string error;
+    ASSERT_TRUE( program.compile(expression, scope, &error) ) << error;
+
+    TimeLapse timer;
+    double nativeSum = 0.;
+    for (int i = 0; i < nEvaluations; ++i) {
+        double value = 0.;
+        scope.evaluationTime = i;
+        ASSERT_TRUE( program.evaluate(i, 0, 0, scope, &value) );
+        nativeSum += value;
+    }
+    double nativeTime = timer.getTimeElapsedReset();
+
+    if ( !Py_IsInitialized() ) {
+        Py_Initialize();
+    }
+    PyObject* mainModule = PyImport_AddModule("__main__"); // borrowed ref
+    ASSERT_TRUE(mainModule);
+    PyObject* globalDict = PyModule_GetDict(mainModule); // borrowed ref
+
+    // Mimics the parameters of the Python API and the function KnobHelper::validateExpression() declares
+    std::stringstream ss;
+    ss << "from math import *\n"
+       << "class NativeExpressionTestParam:\n"
+       << "    def __init__(self, value):\n"
+       << "        self.value = value\n"
+       << "    def get(self):\n"
+       << "        return (self.value, self.value + 10)\n"
+       << "    def getValue(self, dimension = 0):\n"
+       << "        return self.value + 10 * dimension\n"
+       << "class NativeExpressionTestNode:\n"
+       << "    pass\n"
+       << "nativeExpressionTestNode = NativeExpressionTestNode()\n"
+       << "def nativeExpressionTest(frame, view):\n"
+       << "    thisNode = nativeExpressionTestNode\n"
+       << "    thisNode.size = NativeExpressionTestParam(1 + frame)\n"
+       << "    thisParam = NativeExpressionTestParam(frame)\n"
+       << "    ret = thisNode.size.get()[0] * 2 + sin(frame / 10.) * thisParam.getValue()\n"
+       << "    return ret\n";
+    PyObject* v = PyRun_String(ss.str().c_str(), Py_file_input, globalDict, 0);
+    ASSERT_TRUE(v);
+    Py_DECREF(v);
+
+    timer.getTimeElapsedReset();
+    double pythonSum = 0.;
+    for (int i = 0; i < nEvaluations; ++i) {
+        // As KnobHelper::executeExpression()
+        std::stringstream script;
+        script << "ret = nativeExpressionTest(" << i << ", 0)\n";
+        v = PyRun_String(script.str().c_str(), Py_file_input, globalDict, 0);
+        ASSERT_TRUE(v);
+        Py_DECREF(v);
+        PyObject* ret = PyObject_GetAttrString(mainModule, "ret"); // new ref
+        ASSERT_TRUE(ret);
+        pythonSum += PyFloat_AsDouble(ret);
+        Py_DECREF(ret);
+    }
+    double pythonTime = timer.getTimeElapsedReset();
+
+    EXPECT_NEAR(pythonSum, nativeSum, std::fabs(nativeSum) * 1e-9);
+    std::cout << expression << ": " << nEvaluations / nativeTime << " evaluations/s natively, "
+              << nEvaluations / pythonTime << " evaluations/s by Python ("
+              << pythonTime / nativeTime << "x)" << std::endl;
+}
@@ -0,0 +1,122 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "Engine/Cache.h"
+#include "Engine/RenderBenchmark.h"
+
+NATRON_NAMESPACE_USING
+
+static RenderBenchmark::Frame
+makeTestFrame(const std::string& writerName,
+              int time,
+              double blurTime)
+{
+    RenderBenchmark::Frame ret;
+
+    ret.writerName = writerName;
+    ret.time = time;
+    ret.wallTime = blurTime * 2.;
+
+    RenderBenchmark::NodeTime blur;
+    blur.nodeName = "Blur1";
+    blur.timeSpent = blurTime;
+    blur.cacheMisses = 1;
+    ret.nodes.push_back(blur);
+
+    RenderBenchmark::NodeTime read;
+    read.nodeName = "Group1.\"Read\"";
+    read.timeSpent = blurTime / 2.;
+    read.cacheHits = 1;
+    ret.nodes.push_back(read);
+
+    return ret;
+}
+
+TEST(RenderBenchmark, RecordsRuns) {
+    RenderBenchmark benchmark;
+    CacheAccessStats cacheStats;
+
+    // Frames rendered outside of a run are ignored
+    benchmark.addFrame( makeTestFrame("Write1", 1, 1.) );
+
+    cacheStats.misses = 10;
+    benchmark.startRun(true, cacheStats);
+    // Frames may be rendered out of order by parallel renders
+    benchmark.addFrame( makeTestFrame("Write2", 1, 1.) );
+    benchmark.addFrame( makeTestFrame("Write1", 2, 1.) );
+    benchmark.addFrame( makeTestFrame("Write1", 1, 1.) );
+    cacheStats.misses = 16;
+    cacheStats.memoryHits = 2;
+    benchmark.endRun(cacheStats);
+
+    benchmark.startRun(false, cacheStats);
+    benchmark.addFrame( makeTestFrame("Write1", 1, 0.5) );
+    cacheStats.memoryHits = 8;
+    benchmark.endRun(cacheStats);
+
+    ASSERT_EQ(2, benchmark.getRunsCount());
+    std::vector<RenderBenchmark::Frame> frames = benchmark.getRunFrames(0);
+    ASSERT_EQ( (std::size_t)3, frames.size() );
+    EXPECT_EQ( std::string("Write1"), frames[0].writerName );
+    EXPECT_EQ(1, frames[0].time);
+    EXPECT_EQ(2, frames[1].time);
+    EXPECT_EQ( std::string("Write2"), frames[2].writerName );
+    EXPECT_EQ( (std::size_t)1, benchmark.getRunFrames(1).size() );
+    EXPECT_GE(benchmark.getRunWallTime(0), 0.);
+
+    const std::string path = QDir::temp().absoluteFilePath( QString::fromUtf8("NatronRenderBenchmarkTest.json") ).toStdString();
+    ASSERT_TRUE( benchmark.writeReport(path, "/Projects/comp.ntp") );
+
+    std::string report;
+    {
+        std::ifstream ifile( path.c_str() );
+        std::stringstream ss;
+        ss << ifile.rdbuf();
+        report = ss.str();
+    }
+    QFile::remove( QString::fromUtf8( path.c_str() ) );
+
+    EXPECT_NE( std::string::npos, report.find("\"project\": \"/Projects/comp.ntp\"") );
+    EXPECT_NE( std::string::npos, report.find("\"run\": 0, \"cacheCold\": true") );
+    EXPECT_NE( std::string::npos, report.find("\"run\": 1, \"cacheCold\": false") );
+
+    // Cache lookups are counted from the start of each run
+    EXPECT_NE( std::string::npos, report.find("{\"memoryHits\": 2, \"compressedHits\": 0, \"diskHits\": 0, \"misses\": 6") );
+    EXPECT_NE( std::string::npos, report.find("{\"memoryHits\": 6, \"compressedHits\": 0, \"diskHits\": 0, \"misses\": 0") );
+
+    // Time spent by each node over the whole run
+    EXPECT_NE( std::string::npos, report.find("\"nodes\": {\"Blur1\": 3, \"Group1.\\\"Read\\\"\": 1.5}") );
+    EXPECT_NE( std::string::npos, report.find("{\"node\": \"Blur1\", \"time\": 0.5, \"cacheHits\": 0, \"cacheMisses\": 1, \"cacheHitsDownscaled\": 0}") );
+}
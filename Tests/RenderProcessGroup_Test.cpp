@@ -0,0 +1,95 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QStringList>
+
+#include "Engine/CLArgs.h"
+#include "Engine/ProcessHandler.h"
+
+NATRON_NAMESPACE_USING
+
+typedef std::vector<std::pair<int, int> > FrameRanges;
+
+TEST(RenderProcessGroup, SplitFrameRange) {
+    FrameRanges ranges;
+
+    // 10 frames in 3 processes: the first one renders one more frame
+    RenderProcessGroup::splitFrameRange(1, 10, 1, 3, &ranges);
+    ASSERT_EQ( (std::size_t)3, ranges.size() );
+    EXPECT_EQ( std::make_pair(1, 4), ranges[0] );
+    EXPECT_EQ( std::make_pair(5, 7), ranges[1] );
+    EXPECT_EQ( std::make_pair(8, 10), ranges[2] );
+
+    // Parts start and end on frames that are rendered: 1,3,5,7,9,11
+    RenderProcessGroup::splitFrameRange(1, 12, 2, 4, &ranges);
+    ASSERT_EQ( (std::size_t)4, ranges.size() );
+    EXPECT_EQ( std::make_pair(1, 3), ranges[0] );
+    EXPECT_EQ( std::make_pair(5, 7), ranges[1] );
+    EXPECT_EQ( std::make_pair(9, 9), ranges[2] );
+    EXPECT_EQ( std::make_pair(11, 11), ranges[3] );
+
+    // No more processes than frames
+    RenderProcessGroup::splitFrameRange(5, 6, 1, 8, &ranges);
+    ASSERT_EQ( (std::size_t)2, ranges.size() );
+    EXPECT_EQ( std::make_pair(5, 5), ranges[0] );
+    EXPECT_EQ( std::make_pair(6, 6), ranges[1] );
+
+    RenderProcessGroup::splitFrameRange(42, 42, 1, 4, &ranges);
+    ASSERT_EQ( (std::size_t)1, ranges.size() );
+    EXPECT_EQ( std::make_pair(42, 42), ranges[0] );
+
+    RenderProcessGroup::splitFrameRange(10, 1, 1, 4, &ranges);
+    EXPECT_TRUE( ranges.empty() );
+}
+
+TEST(RenderProcessGroup, ProcessArgs) {
+    QStringList args;
+
+    args << QString::fromUtf8("NatronRenderer") << QString::fromUtf8("--reuse-disk-cache")
+         << QString::fromUtf8("--trace") << QString::fromUtf8("/tmp/render.json")
+         << QString::fromUtf8("-c") << QString::fromUtf8("print(1)")
+         << QString::fromUtf8("--processes") << QString::fromUtf8("4")
+         << QString::fromUtf8("project.ntp");
+    CLArgs cl(args, true);
+    ASSERT_EQ( 0, cl.getError() );
+
+    // Each process writes its own trace
+    QStringList expected;
+    expected << QString::fromUtf8("-c") << QString::fromUtf8("print(1)")
+             << QString::fromUtf8("--reuse-disk-cache")
+             << QString::fromUtf8("--trace") << QString::fromUtf8("/tmp/render_2.json");
+    EXPECT_EQ( expected, RenderProcessGroup::getProcessArgs(cl, 1) );
+
+    // Nothing is forwarded when the options are not given
+    QStringList plainArgs;
+    plainArgs << QString::fromUtf8("NatronRenderer") << QString::fromUtf8("project.ntp");
+    CLArgs plain(plainArgs, true);
+    EXPECT_TRUE( RenderProcessGroup::getProcessArgs(plain, 0).isEmpty() );
+}
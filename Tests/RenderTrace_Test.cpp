@@ -0,0 +1,160 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+
+#include "Engine/RenderTrace.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+#define N_SPANS_PER_THREAD 1000
+
+class SpanRecorderThread
+    : public QThread
+{
+public:
+
+    SpanRecorderThread(int index)
+        : QThread()
+    {
+        setObjectName( QString::fromUtf8("Recorder %1").arg(index) );
+    }
+
+    virtual void run()
+    {
+        for (int i = 0; i < N_SPANS_PER_THREAD; ++i) {
+            RenderTraceScope outer("test", "outer");
+            RenderTraceScope inner( "test", "inner", std::string("detail \"quoted\"") );
+        }
+    }
+};
+
+static std::size_t
+countOccurrences(const std::string& str,
+                 const std::string& pattern)
+{
+    std::size_t ret = 0;
+
+    for (std::size_t pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + pattern.size())) {
+        ++ret;
+    }
+
+    return ret;
+}
+
+TEST(RenderTrace, RecordsSpansOfAllThreads) {
+    const int nThreads = 4;
+
+    {
+        // Not recorded
+        RenderTraceScope scope("test", "disabled");
+    }
+    RenderTrace::start();
+    EXPECT_TRUE( RenderTrace::isEnabled() );
+    {
+        RenderTraceScope scope("test", "main");
+        SpanRecorderThread* threads[nThreads];
+        for (int i = 0; i < nThreads; ++i) {
+            threads[i] = new SpanRecorderThread(i);
+            threads[i]->start();
+        }
+        for (int i = 0; i < nThreads; ++i) {
+            threads[i]->wait();
+            delete threads[i];
+        }
+    }
+    RenderTrace::stop();
+    {
+        RenderTraceScope scope("test", "disabled");
+    }
+
+    // The events of threads that are destroyed are kept
+    const std::size_t nEvents = nThreads * N_SPANS_PER_THREAD * 2 + 1;
+    EXPECT_EQ( nEvents, RenderTrace::getEventsCount() );
+
+    const std::string path = QDir::temp().absoluteFilePath( QString::fromUtf8("NatronRenderTraceTest.json") ).toStdString();
+    ASSERT_TRUE( RenderTrace::writeChromeTrace(path) );
+
+    std::string trace;
+    {
+        std::ifstream ifile( path.c_str() );
+        std::stringstream ss;
+        ss << ifile.rdbuf();
+        trace = ss.str();
+    }
+    QFile::remove( QString::fromUtf8( path.c_str() ) );
+
+    EXPECT_EQ( (std::size_t)0, trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") );
+    EXPECT_EQ( trace.size() - 4, trace.rfind("\n]}\n") );
+    EXPECT_EQ( nEvents, countOccurrences(trace, "\"ph\":\"X\"") );
+    EXPECT_EQ( (std::size_t)nThreads * N_SPANS_PER_THREAD, countOccurrences(trace, "\"name\":\"inner detail \\\"quoted\\\"\"") );
+    EXPECT_EQ( std::string::npos, trace.find("disabled") );
+    for (int i = 0; i < nThreads; ++i) {
+        std::stringstream ss;
+        ss << "\"args\":{\"name\":\"Recorder " << i << "\"}";
+        EXPECT_EQ( (std::size_t)1, countOccurrences( trace, ss.str() ) );
+    }
+
+    // Starting again discards the events
+    RenderTrace::start();
+    EXPECT_EQ( (std::size_t)0, RenderTrace::getEventsCount() );
+    RenderTrace::stop();
+}
+
+// Not a correctness test: prints the cost of a span when tracing is disabled and enabled
+TEST(RenderTrace, DISABLED_BenchmarkOverhead) {
+    const int nSpans = 1000000;
+    TimeLapse timer;
+
+    for (int i = 0; i < nSpans; ++i) {
+        RenderTraceScope scope("test", "span");
+    }
+    double disabledTime = timer.getTimeElapsedReset();
+
+    RenderTrace::start();
+    for (int i = 0; i < nSpans; ++i) {
+        RenderTraceScope scope("test", "span");
+    }
+    double enabledTime = timer.getTimeElapsedReset();
+    RenderTrace::stop();
+    EXPECT_EQ( (std::size_t)nSpans, RenderTrace::getEventsCount() );
+
+    std::cout << "Span with tracing disabled: " << disabledTime * 1e9 / nSpans << " ns, enabled: "
+              << enabledTime * 1e9 / nSpans << " ns" << std::endl;
+
+    // Release the memory of the events
+    RenderTrace::start();
+    RenderTrace::stop();
+}
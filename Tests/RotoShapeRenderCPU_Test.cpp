@@ -0,0 +1,506 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <iostream>
+#include <list>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/Bezier.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Image.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/RectI.h"
+#include "Engine/RotoBezierTriangulation.h"
+#include "Engine/RotoContext.h"
+#include "Engine/RotoShapeRenderCairo.h"
+#include "Engine/RotoShapeRenderCPU.h"
+#include "Engine/Timer.h"
+
+#include "BaseTest.h"
+
+NATRON_NAMESPACE_USING
+
+typedef RotoBezierTriangulation::PolygonData PolygonData;
+
+static void
+addPoint(double x,
+         double y,
+         std::vector<ParametricPoint>* polygon)
+{
+    ParametricPoint p;
+
+    p.x = x;
+    p.y = y;
+    p.t = 0.;
+    polygon->push_back(p);
+}
+
+static void
+addFeatherVertex(double x,
+                 double y,
+                 bool isInner,
+                 PolygonData* data)
+{
+    RotoBezierTriangulation::RotoFeatherVertex v;
+
+    v.x = x;
+    v.y = y;
+    v.isInner = isInner;
+    data->featherMesh.push_back(v);
+}
+
+// A circle polygon with a feather ring of the given width around it, like computeTriangles builds them
+static void
+makeFeatheredCircle(double cx,
+                    double cy,
+                    double radius,
+                    double featherDist,
+                    int nPoints,
+                    PolygonData* data)
+{
+    for (int i = 0; i < nPoints; ++i) {
+        double a0 = 2. * M_PI * i / nPoints;
+        double a1 = 2. * M_PI * (i + 1) / nPoints;
+        addPoint(cx + radius * std::cos(a0), cy + radius * std::sin(a0), &data->bezierPolygonJoined);
+        if (featherDist > 0) {
+            double r = radius + featherDist;
+            addFeatherVertex(cx + radius * std::cos(a0), cy + radius * std::sin(a0), true, data);
+            addFeatherVertex(cx + r * std::cos(a0), cy + r * std::sin(a0), false, data);
+            addFeatherVertex(cx + radius * std::cos(a1), cy + radius * std::sin(a1), true, data);
+            addFeatherVertex(cx + radius * std::cos(a1), cy + radius * std::sin(a1), true, data);
+            addFeatherVertex(cx + r * std::cos(a0), cy + r * std::sin(a0), false, data);
+            addFeatherVertex(cx + r * std::cos(a1), cy + r * std::sin(a1), false, data);
+        }
+    }
+}
+
+static std::vector<float>
+render(const PolygonData& data,
+       RampTypeEnum type,
+       double fallOff,
+       const RectI& tile)
+{
+    std::vector<float> coverage( (std::size_t)tile.width() * tile.height(), 0.f );
+    std::vector<float> accumulation;
+
+    RotoShapeRenderCPU::renderCoverage_cpu(data, type, fallOff, tile, &coverage.front(), &accumulation);
+
+    return coverage;
+}
+
+TEST(RotoShapeRenderCPU, ExactCoverageOfPolygonEdges) {
+    PolygonData data;
+
+    addPoint(2.25, 1.5, &data.bezierPolygonJoined);
+    addPoint(7.75, 1.5, &data.bezierPolygonJoined);
+    addPoint(7.75, 5., &data.bezierPolygonJoined);
+    addPoint(2.25, 5., &data.bezierPolygonJoined);
+
+    RectI tile(0, 0, 10, 6);
+    std::vector<float> coverage = render(data, eRampTypeLinear, 1., tile);
+    for (int y = 0; y < tile.height(); ++y) {
+        double coverY = std::max( 0., std::min(y + 1., 5.) - std::max(y + 0., 1.5) );
+        for (int x = 0; x < tile.width(); ++x) {
+            double coverX = std::max( 0., std::min(x + 1., 7.75) - std::max(x + 0., 2.25) );
+            EXPECT_NEAR(coverX * coverY, coverage[y * tile.width() + x], 1e-5) << "x=" << x << " y=" << y;
+        }
+    }
+
+    // A slanted edge: the triangle (0,0) (8,0) (0,8) covers half of the pixels on its diagonal
+    PolygonData triangle;
+    addPoint(0., 0., &triangle.bezierPolygonJoined);
+    addPoint(8., 0., &triangle.bezierPolygonJoined);
+    addPoint(0., 8., &triangle.bezierPolygonJoined);
+    tile = RectI(0, 0, 8, 8);
+    coverage = render(triangle, eRampTypeLinear, 1., tile);
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            float expected = x + y < 7 ? 1.f : (x + y == 7 ? 0.5f : 0.f);
+            EXPECT_NEAR(expected, coverage[y * 8 + x], 1e-5) << "x=" << x << " y=" << y;
+        }
+    }
+}
+
+// A square with a square inside, the inner contour going in the given direction
+static void
+makeNestedSquares(bool sameDirection,
+                  PolygonData* data)
+{
+    addPoint(0., 0., &data->bezierPolygonJoined);
+    addPoint(8., 0., &data->bezierPolygonJoined);
+    addPoint(8., 8., &data->bezierPolygonJoined);
+    addPoint(0., 8., &data->bezierPolygonJoined);
+    addPoint(0., 0., &data->bezierPolygonJoined);
+    addPoint(2., 2., &data->bezierPolygonJoined);
+    if (sameDirection) {
+        addPoint(6., 2., &data->bezierPolygonJoined);
+        addPoint(6., 6., &data->bezierPolygonJoined);
+        addPoint(2., 6., &data->bezierPolygonJoined);
+    } else {
+        addPoint(2., 6., &data->bezierPolygonJoined);
+        addPoint(6., 6., &data->bezierPolygonJoined);
+        addPoint(6., 2., &data->bezierPolygonJoined);
+    }
+    addPoint(2., 2., &data->bezierPolygonJoined);
+}
+
+TEST(RotoShapeRenderCPU, NonZeroWindingFill) {
+    // The inner square overlaps the outter one: it is filled, like Cairo does with CAIRO_FILL_RULE_WINDING
+    PolygonData overlapping;
+
+    makeNestedSquares(true, &overlapping);
+    std::vector<float> coverage = render(overlapping, eRampTypeLinear, 1., RectI(0, 0, 8, 8));
+    EXPECT_NEAR(1.f, coverage[1 * 8 + 1], 1e-5);
+    EXPECT_NEAR(1.f, coverage[4 * 8 + 4], 1e-5);
+    EXPECT_NEAR(1.f, coverage[7 * 8 + 6], 1e-5);
+
+    // Going the other way, it cancels the winding of the outter one and is a hole
+    PolygonData hole;
+    makeNestedSquares(false, &hole);
+    coverage = render(hole, eRampTypeLinear, 1., RectI(0, 0, 8, 8));
+    EXPECT_NEAR(1.f, coverage[1 * 8 + 1], 1e-5);
+    EXPECT_NEAR(0.f, coverage[4 * 8 + 4], 1e-5);
+    EXPECT_NEAR(1.f, coverage[7 * 8 + 6], 1e-5);
+}
+
+TEST(RotoShapeRenderCPU, FeatherRamp) {
+    PolygonData data;
+
+    makeFeatheredCircle(0., 0., 50., 20., 256, &data);
+
+    // Along the x axis, the coverage decreases linearly in the feather, then is raised to the power of the fall-off
+    const double fallOffs[2] = {1., 2.};
+    for (int f = 0; f < 2; ++f) {
+        RectI tile(0, 0, 80, 1);
+        std::vector<float> coverage = render(data, eRampTypeLinear, fallOffs[f], tile);
+        for (int x = 0; x < 49; ++x) {
+            EXPECT_NEAR(1.f, coverage[x], 1e-5);
+        }
+        for (int x = 51; x < 69; ++x) {
+            double t = 1. - (x + 0.5 - 50.) / 20.;
+            EXPECT_NEAR(std::pow(t, fallOffs[f]), coverage[x], 0.01) << "x=" << x;
+        }
+        for (int x = 71; x < 80; ++x) {
+            EXPECT_EQ(0.f, coverage[x]);
+        }
+    }
+
+    RectI tile(0, 0, 80, 1);
+    std::vector<float> smooth = render(data, eRampTypeSmooth, 1., tile);
+    double t = 1. - (60.5 - 50.) / 20.;
+    EXPECT_NEAR(t * t * (3. - 2. * t), smooth[60], 0.01);
+}
+
+TEST(RotoShapeRenderCPU, TilesMatchFullRender) {
+    PolygonData data;
+
+    makeFeatheredCircle(61.3, 47.7, 40.2, 12.5, 100, &data);
+
+    RectI full(0, 0, 128, 100);
+    std::vector<float> expected = render(data, eRampTypeEaseOut, 1.5, full);
+    for (int y = 0; y < full.y2; y += 7) {
+        for (int x = 0; x < full.x2; x += 33) {
+            RectI tile( x, y, std::min(x + 33, full.x2), std::min(y + 7, full.y2) );
+            std::vector<float> coverage = render(data, eRampTypeEaseOut, 1.5, tile);
+            for (int ty = tile.y1; ty < tile.y2; ++ty) {
+                for (int tx = tile.x1; tx < tile.x2; ++tx) {
+                    ASSERT_NEAR(expected[ty * full.width() + tx], coverage[(ty - tile.y1) * tile.width() + tx - tile.x1], 1e-5)
+                        << "x=" << tx << " y=" << ty;
+                }
+            }
+        }
+    }
+}
+
+#ifdef ROTO_SHAPE_RENDER_ENABLE_CAIRO
+
+// Renders the bezier into an alpha image of the roi with the CPU renderer or the Cairo renderer
+static ImagePtr
+renderBezierMask(const BezierPtr& bezier,
+                 double time,
+                 const RectI& roi,
+                 bool useCairo)
+{
+    const ImageComponents& alpha = ImageComponents::getAlphaComponents();
+    ImagePtr img( new Image(alpha, RectD(roi.x1, roi.y1, roi.x2, roi.y2), roi, 0, 1., eImageBitDepthFloat,
+                            eImagePremultiplicationPremultiplied, eImageFieldingOrderNone) );
+
+    img->fillZero(roi);
+    if (useCairo) {
+        std::list<std::list<std::pair<Point, double> > > strokes;
+        Point lastCenter;
+        lastCenter.x = lastCenter.y = 0.;
+        double distToNext = 0.;
+        RotoShapeRenderCairo::renderMaskInternal_cairo(bezier, roi, alpha, time, time, 1., time, eImageBitDepthFloat, 0, false,
+                                                       0., lastCenter, strokes, img, &distToNext, &lastCenter);
+    } else {
+        RotoShapeRenderCPU::renderBezier_cpu(bezier.get(), 1., time, time, time, 1., 0, roi, img);
+    }
+
+    return img;
+}
+
+static float
+getPixel(const ImagePtr& img,
+         int x,
+         int y)
+{
+    Image::ReadAccess acc = img->getReadRights();
+
+    return *(const float*)acc.pixelAt(x, y);
+}
+
+// Cairo renders the shapes without antialiasing: the masks differ on their edges only, which weigh little in the mean
+static double
+meanAbsoluteDifference(const ImagePtr& a,
+                       const ImagePtr& b,
+                       const RectI& roi)
+{
+    double sum = 0.;
+
+    for (int y = roi.y1; y < roi.y2; ++y) {
+        for (int x = roi.x1; x < roi.x2; ++x) {
+            sum += std::fabs( getPixel(a, x, y) - getPixel(b, x, y) );
+        }
+    }
+
+    return sum / roi.area();
+}
+
+TEST_F(BaseTest, RotoShapeRenderCPUMatchesCairo)
+{
+    NodePtr roto = createNode( QString::fromUtf8(PLUGINID_NATRON_ROTO) );
+
+    ASSERT_TRUE(roto);
+    RotoContextPtr context = roto->getRotoContext();
+    ASSERT_TRUE(context);
+
+    const double time = 1.;
+    const RectI roi(0, 0, 100, 100);
+
+    BezierPtr square = context->makeSquare(20., 80., 50., time);
+
+    // A pentagram: its contour overlaps itself and winds twice around the pentagon at its center
+    BezierPtr star = context->makeBezier(50., 90., kRotoBezierBaseName, time, false);
+    for (int i = 1; i < 5; ++i) {
+        double a = M_PI / 2. + i * 4. * M_PI / 5.;
+        star->addControlPoint(50. + 40. * std::cos(a), 50. + 40. * std::sin(a), time);
+    }
+    star->setCurveFinished(true);
+
+    BezierPtr shapes[2] = {square, star};
+    for (int i = 0; i < 2; ++i) {
+        shapes[i]->getFeatherKnob()->setValue(0.);
+        ImagePtr cpu = renderBezierMask(shapes[i], time, roi, false);
+        ImagePtr cairo = renderBezierMask(shapes[i], time, roi, true);
+
+        // The hole an even-odd fill leaves in the pentagram would be more than 5% of the roi
+        EXPECT_LT(meanAbsoluteDifference(cpu, cairo, roi), 0.02) << "shape " << i;
+        EXPECT_NEAR(1.f, getPixel(cpu, 50, 50), 1e-5) << "shape " << i;
+        EXPECT_NEAR(1.f, getPixel(cairo, 50, 50), 1e-5) << "shape " << i;
+        EXPECT_EQ(0.f, getPixel(cpu, 2, 2)) << "shape " << i;
+    }
+}
+
+#endif // ROTO_SHAPE_RENDER_ENABLE_CAIRO
+
+// Not a correctness test: prints the time taken to rasterize a large feathered shape
+TEST(RotoShapeRenderCPU, DISABLED_BenchmarkLargeShape) {
+    PolygonData data;
+
+    makeFeatheredCircle(2048., 1080., 1000., 100., 4000, &data);
+
+    RectI roi(0, 0, 4096, 2160);
+    const int nRows = ROTO_SHAPE_RENDER_CPU_TILE_ROWS;
+    std::vector<float> coverage( (std::size_t)roi.width() * nRows );
+    std::vector<float> accumulation;
+    TimeLapse timer;
+    double sum = 0.;
+    for (int y = roi.y1; y < roi.y2; y += nRows) {
+        RectI tile( roi.x1, y, roi.x2, std::min(y + nRows, roi.y2) );
+        std::fill(coverage.begin(), coverage.end(), 0.f);
+        RotoShapeRenderCPU::renderCoverage_cpu(data, eRampTypeSmooth, 1., tile, &coverage.front(), &accumulation);
+        sum += coverage[tile.width() / 2];
+    }
+    double elapsed = timer.getTimeElapsedReset();
+
+    std::cout << "Rasterizing a feathered shape with " << data.bezierPolygonJoined.size() << " points on a "
+              << roi.width() << "x" << roi.height() << " RoI: " << elapsed * 1000. << " ms on one thread" << std::endl;
+    EXPECT_GT(sum, 0.);
+}
+
+static RotoShapeRenderCPU::StrokeDot
+makeDot(double x,
+        double y,
+        double internalRadius,
+        double externalRadius,
+        float alpha,
+        const std::vector<float>& falloff)
+{
+    RotoShapeRenderCPU::StrokeDot dot;
+
+    dot.x = x;
+    dot.y = y;
+    dot.internalRadius = internalRadius;
+    dot.externalRadius = externalRadius;
+    dot.alpha = alpha;
+    dot.falloff = &falloff.front();
+
+    return dot;
+}
+
+// Opacity of the pixel (x,y) in the dot, computed the way the Cairo renderer does
+static double
+referenceDotValue(const RotoShapeRenderCPU::StrokeDot& dot,
+                  int x,
+                  int y)
+{
+    double dx = x + 0.5 - dot.x;
+    double dy = y + 0.5 - dot.y;
+    double dist = std::sqrt(dx * dx + dy * dy);
+
+    if (dist > dot.externalRadius) {
+        return 0.;
+    }
+    double t = dot.externalRadius > dot.internalRadius ? (dist - dot.internalRadius) / (dot.externalRadius - dot.internalRadius) : 0.;
+    t = std::max( 0., std::min(t, 1.) );
+
+    return dot.falloff[(int)(t * (ROTO_SHAPE_RENDER_CPU_FALLOFF_SAMPLES - 1) + 0.5)] * dot.alpha;
+}
+
+TEST(RotoShapeRenderCPU, DotFalloff) {
+    std::vector<float> falloff;
+
+    RotoShapeRenderCPU::computeDotFalloff(1., &falloff);
+    ASSERT_EQ( (std::size_t)ROTO_SHAPE_RENDER_CPU_FALLOFF_SAMPLES, falloff.size() );
+    for (std::size_t i = 0; i < falloff.size(); ++i) {
+        EXPECT_EQ(1.f, falloff[i]);
+    }
+
+    // Opaque at the internal radius, transparent at the external radius
+    RotoShapeRenderCPU::computeDotFalloff(0.5, &falloff);
+    EXPECT_NEAR(1.f, falloff.front(), 1e-6);
+    EXPECT_NEAR(0.f, falloff.back(), 1e-6);
+    for (std::size_t i = 1; i < falloff.size(); ++i) {
+        EXPECT_LE(falloff[i], falloff[i - 1]);
+    }
+}
+
+TEST(RotoShapeRenderCPU, DotsMatchReference) {
+    std::vector<float> soft, hard;
+
+    RotoShapeRenderCPU::computeDotFalloff(0.2, &soft);
+    RotoShapeRenderCPU::computeDotFalloff(1., &hard);
+
+    std::vector<RotoShapeRenderCPU::StrokeDot> dots;
+    dots.push_back( makeDot(20.3, 15.7, 2., 9.5, 0.8f, soft) );
+    dots.push_back( makeDot(3.5, 40., 0.5, 6., 1.f, soft) );
+    dots.push_back( makeDot(50., 30.2, 4., 4., 0.6f, hard) );
+
+    RectI tile(0, 0, 64, 48);
+    for (int buildUp = 0; buildUp < 2; ++buildUp) {
+        std::vector<float> coverage( (std::size_t)tile.width() * tile.height(), 0.f );
+        RotoShapeRenderCPU::renderDots_cpu(dots, buildUp, tile, &coverage.front());
+        for (int y = tile.y1; y < tile.y2; ++y) {
+            for (int x = tile.x1; x < tile.x2; ++x) {
+                double expected = 0.;
+                for (std::size_t i = 0; i < dots.size(); ++i) {
+                    double value = referenceDotValue(dots[i], x, y);
+                    expected = buildUp ? value + expected * (1. - value) : std::max(expected, value);
+                }
+                // The float evaluation may pick the neighbouring sample of the fall-off
+                ASSERT_NEAR(expected, coverage[y * tile.width() + x], 0.02) << "x=" << x << " y=" << y;
+            }
+        }
+    }
+
+    // Two overlapping dots are composited over each other with build-up, otherwise the maximum is kept
+    std::vector<RotoShapeRenderCPU::StrokeDot> overlapping(2, makeDot(5., 5., 3., 3., 0.5f, hard));
+    std::vector<float> coverage(100, 0.f);
+    RotoShapeRenderCPU::renderDots_cpu(overlapping, true, RectI(0, 0, 10, 10), &coverage.front());
+    EXPECT_NEAR(0.75f, coverage[5 * 10 + 5], 1e-6);
+    std::fill(coverage.begin(), coverage.end(), 0.f);
+    RotoShapeRenderCPU::renderDots_cpu(overlapping, false, RectI(0, 0, 10, 10), &coverage.front());
+    EXPECT_NEAR(0.5f, coverage[5 * 10 + 5], 1e-6);
+    EXPECT_EQ(0.f, coverage[0]);
+}
+
+TEST(RotoShapeRenderCPU, DotTilesMatchFullRender) {
+    std::vector<float> falloff;
+
+    RotoShapeRenderCPU::computeDotFalloff(0.3, &falloff);
+
+    std::vector<RotoShapeRenderCPU::StrokeDot> dots;
+    for (int i = 0; i < 200; ++i) {
+        dots.push_back( makeDot(10. + i * 0.5, 50. + 30. * std::sin(i * 0.1), 1.5, 7.3, 0.3f, falloff) );
+    }
+
+    RectI full(0, 0, 128, 100);
+    std::vector<float> expected( (std::size_t)full.width() * full.height(), 0.f );
+    RotoShapeRenderCPU::renderDots_cpu(dots, true, full, &expected.front());
+    for (int y = 0; y < full.y2; y += 9) {
+        for (int x = 0; x < full.x2; x += 31) {
+            RectI tile( x, y, std::min(x + 31, full.x2), std::min(y + 9, full.y2) );
+            std::vector<float> coverage( (std::size_t)tile.width() * tile.height(), 0.f );
+            RotoShapeRenderCPU::renderDots_cpu(dots, true, tile, &coverage.front());
+            for (int ty = tile.y1; ty < tile.y2; ++ty) {
+                for (int tx = tile.x1; tx < tile.x2; ++tx) {
+                    ASSERT_EQ(expected[ty * full.width() + tx], coverage[(ty - tile.y1) * tile.width() + tx - tile.x1])
+                        << "x=" << tx << " y=" << ty;
+                }
+            }
+        }
+    }
+}
+
+// Not a correctness test: prints the time taken to splat the dots of a long stroke with a small spacing
+TEST(RotoShapeRenderCPU, DISABLED_BenchmarkStrokeDots) {
+    std::vector<float> falloff;
+
+    RotoShapeRenderCPU::computeDotFalloff(0.2, &falloff);
+
+    const int nDots = 20000;
+    std::vector<RotoShapeRenderCPU::StrokeDot> dots;
+    for (int i = 0; i < nDots; ++i) {
+        double a = 2. * M_PI * i / nDots;
+        dots.push_back( makeDot(1024. + 800. * std::cos(3. * a), 540. + 400. * std::sin(2. * a), 3., 12., 0.2f, falloff) );
+    }
+
+    RectI roi(0, 0, 2048, 1080);
+    std::vector<float> coverage( (std::size_t)roi.width() * roi.height(), 0.f );
+    TimeLapse timer;
+    RotoShapeRenderCPU::renderDots_cpu(dots, true, roi, &coverage.front());
+    double elapsed = timer.getTimeElapsedReset();
+
+    std::cout << "Splatting " << nDots << " dots on a " << roi.width() << "x" << roi.height() << " RoI: "
+              << elapsed * 1000. << " ms on one thread" << std::endl;
+    EXPECT_GT(coverage[540 * 2048 + 1824], 0.f);
+}
@@ -0,0 +1,229 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/bind.hpp>
+#endif
+
+#include "Engine/TaskScheduler.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+static void
+incrementCounter(QAtomicInt* counter)
+{
+    counter->ref();
+}
+
+static void
+recordThread(QMutex* mutex,
+             std::set<QThread*>* threads)
+{
+    QThread::msleep(1);
+    QMutexLocker k(mutex);
+    threads->insert( QThread::currentThread() );
+}
+
+static void
+recordBusyWorkers(const TaskScheduler* scheduler,
+                  QMutex* mutex,
+                  int* maxBusyWorkers)
+{
+    QThread::msleep(1);
+    QMutexLocker k(mutex);
+    *maxBusyWorkers = std::max( *maxBusyWorkers, scheduler->getNumBusyWorkers() );
+}
+
+static void
+throwError()
+{
+    throw std::runtime_error("task error");
+}
+
+// A fake tile: some arithmetic followed by an optional nested batch, as a tile rendering an upstream node would do
+static void
+renderFakeTile(TaskScheduler* scheduler,
+               int nIterations,
+               int depth,
+               QAtomicInt* nTilesRendered,
+               double* result)
+{
+    double sum = 0.;
+
+    for (int i = 0; i < nIterations; ++i) {
+        sum += std::sqrt( (double)i );
+    }
+    *result = sum;
+    nTilesRendered->ref();
+
+    if (depth > 0) {
+        std::vector<double> results(4);
+        std::vector<TaskScheduler::Task> tasks;
+        for (int i = 0; i < 4; ++i) {
+            tasks.push_back( boost::bind(renderFakeTile, scheduler, nIterations, depth - 1, nTilesRendered, &results[i]) );
+        }
+        scheduler->runAndWait(tasks);
+    }
+}
+
+TEST(TaskScheduler,
+     AllTasksRunOnce)
+{
+    for (int nWorkers = 0; nWorkers <= 4; ++nWorkers) {
+        TaskScheduler scheduler(nWorkers);
+        const int nTasks = 100;
+        std::vector<QAtomicInt> counters(nTasks);
+        std::vector<TaskScheduler::Task> tasks;
+        for (int i = 0; i < nTasks; ++i) {
+            tasks.push_back( boost::bind(incrementCounter, &counters[i]) );
+        }
+        for (int pass = 0; pass < 10; ++pass) {
+            scheduler.runAndWait(tasks);
+        }
+        for (int i = 0; i < nTasks; ++i) {
+            EXPECT_EQ(10, (int)counters[i]) << "task " << i << " with " << nWorkers << " workers";
+        }
+    }
+}
+
+TEST(TaskScheduler,
+     NestedBatches)
+{
+    // More nested batches than workers: every waiting thread must be able to complete its own batch
+    TaskScheduler scheduler(2);
+    QAtomicInt nTilesRendered;
+    std::vector<double> results(8);
+    std::vector<TaskScheduler::Task> tasks;
+
+    for (int i = 0; i < 8; ++i) {
+        tasks.push_back( boost::bind(renderFakeTile, &scheduler, 1000, 3, &nTilesRendered, &results[i]) );
+    }
+    scheduler.runAndWait(tasks);
+    // 8 * (1 + 4 + 16 + 64) tiles
+    EXPECT_EQ(8 * 85, (int)nTilesRendered);
+}
+
+TEST(TaskScheduler,
+     ActiveWorkersLimit)
+{
+    TaskScheduler scheduler(4);
+    QMutex mutex;
+    std::set<QThread*> threads;
+    std::vector<TaskScheduler::Task> tasks( 40, boost::bind(recordThread, &mutex, &threads) );
+
+    scheduler.setNumActiveWorkers(1);
+    scheduler.runAndWait(tasks);
+    // The calling thread and at most one worker
+    EXPECT_LE( (int)threads.size(), 2 );
+
+    threads.clear();
+    scheduler.setNumActiveWorkers(0);
+    scheduler.runAndWait(tasks);
+    ASSERT_EQ( 1, (int)threads.size() );
+    EXPECT_EQ( QThread::currentThread(), *threads.begin() );
+
+    scheduler.setNumActiveWorkers(100);
+    EXPECT_EQ( 4, scheduler.getNumActiveWorkers() );
+}
+
+TEST(TaskScheduler,
+     BusyWorkers)
+{
+    TaskScheduler scheduler(4);
+    QMutex mutex;
+    int maxBusyWorkers = 0;
+    std::vector<TaskScheduler::Task> tasks( 40, boost::bind(recordBusyWorkers, &scheduler, &mutex, &maxBusyWorkers) );
+
+    EXPECT_EQ( 0, scheduler.getNumBusyWorkers() );
+    scheduler.setNumActiveWorkers(2);
+    scheduler.runAndWait(tasks);
+    EXPECT_LE(maxBusyWorkers, 2);
+
+    // A worker may still be returning from its last task when runAndWait() returns
+    for (int i = 0; i < 1000 && scheduler.getNumBusyWorkers() > 0; ++i) {
+        QThread::msleep(1);
+    }
+    EXPECT_EQ( 0, scheduler.getNumBusyWorkers() );
+}
+
+TEST(TaskScheduler,
+     TaskExceptionIsReported)
+{
+    TaskScheduler scheduler(2);
+    std::vector<QAtomicInt> counters(10);
+    std::vector<TaskScheduler::Task> tasks;
+
+    for (int i = 0; i < 10; ++i) {
+        tasks.push_back( boost::bind(incrementCounter, &counters[i]) );
+    }
+    tasks.push_back(throwError);
+    EXPECT_THROW(scheduler.runAndWait(tasks), std::runtime_error);
+    // The other tasks still ran
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(1, (int)counters[i]);
+    }
+}
+
+TEST(TaskScheduler,
+     DISABLED_ScalingBenchmark)
+{
+    const int nTiles = 64;
+    const int nIterations = 200000;
+    int maxWorkers = std::max(1, QThread::idealThreadCount() - 1);
+    double elapsedOneThread = 0.;
+
+    for (int nWorkers = 0; nWorkers <= maxWorkers; nWorkers = nWorkers ? nWorkers * 2 : 1) {
+        TaskScheduler scheduler(nWorkers);
+        QAtomicInt nTilesRendered;
+        std::vector<double> results(nTiles);
+        std::vector<TaskScheduler::Task> tasks;
+        for (int i = 0; i < nTiles; ++i) {
+            tasks.push_back( boost::bind(renderFakeTile, &scheduler, nIterations, 1, &nTilesRendered, &results[i]) );
+        }
+        TimeLapse timer;
+        scheduler.runAndWait(tasks);
+        double elapsed = timer.getTimeSinceCreation();
+        EXPECT_EQ(nTiles * 5, (int)nTilesRendered);
+        if (nWorkers == 0) {
+            elapsedOneThread = elapsed;
+        }
+        std::cout << "TaskScheduler: " << nWorkers + 1 << " thread(s): " << nTiles * 5 << " tiles in " << elapsed << " s (speedup "
+                  << (elapsed > 0. ? elapsedOneThread / elapsed : 0.) << "x)" << std::endl;
+    }
+}
@@ -49,12 +49,26 @@ SOURCES += \
     google-test/src/gtest_main.cc \
     google-mock/src/gmock-all.cc \
     BaseTest.cpp \
+    BezierTessellationCache_Test.cpp \
+    BufferPool_Test.cpp \
+    Cache_Test.cpp \
+    CacheCompression_Test.cpp \
+    CacheEvictionPolicy_Test.cpp \
+    CacheJournal_Test.cpp \
+    ExpressionResults_Test.cpp \
     Hash64_Test.cpp \
     Image_Test.cpp \
     Lut_Test.cpp \
+    NativeExpression_Test.cpp \
+    RenderBenchmark_Test.cpp \
+    RenderProcessGroup_Test.cpp \
+    RenderTrace_Test.cpp \
+    RotoShapeRenderCPU_Test.cpp \
+    TaskScheduler_Test.cpp \
     KnobFile_Test.cpp \
     Curve_Test.cpp \
-    Tracker_Test.cpp
+    Tracker_Test.cpp \
+    ViewerTextureConvert_Test.cpp
 
 HEADERS += \
     BaseTest.h
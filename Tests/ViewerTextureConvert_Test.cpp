@@ -0,0 +1,226 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include <gtest/gtest.h>
+#include "Engine/Lut.h"
+#include "Engine/Timer.h"
+#include "Engine/ViewerTextureConvert.h"
+
+NATRON_NAMESPACE_USING
+
+static std::vector<float>
+makeGammaLut(double gamma)
+{
+    std::vector<float> ret(GAMMA_LUT_NB_VALUES + 1);
+
+    for (int i = 0; i <= GAMMA_LUT_NB_VALUES; ++i) {
+        ret[i] = (float)std::pow(double(i) / GAMMA_LUT_NB_VALUES, gamma);
+    }
+
+    return ret;
+}
+
+// A row of float RGBA pixels with values in and out of the [0,1] range, and a few NaNs
+static std::vector<float>
+makeFloatTestRow(int width)
+{
+    std::vector<float> ret(width * 4);
+
+    srand(2000);
+    for (std::size_t i = 0; i < ret.size(); ++i) {
+        // coverity[dont_call]
+        ret[i] = rand() / (float)RAND_MAX * 1.4f - 0.2f;
+    }
+    ret[5] = std::numeric_limits<float>::quiet_NaN();
+    ret[42] = std::numeric_limits<float>::infinity();
+
+    return ret;
+}
+
+// odd width so that the scalar remainder is exercised as well
+static const int kTestRowWidth = 1023;
+
+static void
+checkConvertRow(const ViewerTextureConvertArgs& args,
+                const void* src,
+                const float* matte)
+{
+    std::vector<U32> simd8(kTestRowWidth), scalar8(kTestRowWidth);
+    std::vector<float> simd32(kTestRowWidth * 4), scalar32(kTestRowWidth * 4);
+
+    Color::setSIMDEnabled(true);
+    {
+        ViewerTextureRowConverter converter(args, kTestRowWidth);
+        converter.convertRowTo8bits(src, matte, kTestRowWidth, kTestRowWidth / 3, &simd8[0]);
+        converter.convertRowTo32bits(src, matte, kTestRowWidth, &simd32[0]);
+    }
+    Color::setSIMDEnabled(false);
+    {
+        ViewerTextureRowConverter converter(args, kTestRowWidth);
+        converter.convertRowTo8bits(src, matte, kTestRowWidth, kTestRowWidth / 3, &scalar8[0]);
+        converter.convertRowTo32bits(src, matte, kTestRowWidth, &scalar32[0]);
+    }
+    Color::setSIMDEnabled(true);
+    EXPECT_EQ( 0, std::memcmp( &simd8[0], &scalar8[0], simd8.size() * sizeof(U32) ) );
+    EXPECT_EQ( 0, std::memcmp( &simd32[0], &scalar32[0], simd32.size() * sizeof(float) ) );
+}
+
+TEST(ViewerTextureConvert, RowConversionsMatchScalar) {
+    if ( !Color::isSIMDAvailable() ) {
+        std::cout << "SIMD row converters not available, nothing to compare" << std::endl;
+
+        return;
+    }
+    std::vector<float> floats = makeFloatTestRow(kTestRowWidth);
+    std::vector<unsigned char> bytes(floats.size());
+    Color::convertDepthRow( &floats[0], &bytes[0], (int)floats.size() );
+    std::vector<float> matte(kTestRowWidth);
+    for (int x = 0; x < kTestRowWidth; ++x) {
+        matte[x] = floats[x * 4 + 3];
+    }
+    std::vector<float> gammaLut = makeGammaLut(1. / 2.2);
+
+    ViewerTextureConvertArgs args;
+    checkConvertRow(args, &floats[0], 0);
+    checkConvertRow(args, &floats[0], &matte[0]);
+
+    args.gain = 1.5f;
+    args.offset = -0.1f;
+    checkConvertRow(args, &floats[0], 0);
+
+    args.gamma = 1.f / 2.2f;
+    args.gammaLut = &gammaLut[0];
+    checkConvertRow(args, &floats[0], &matte[0]);
+
+    args.luminance = true;
+    checkConvertRow(args, &floats[0], 0);
+
+    args.luminance = false;
+    args.opaque = true;
+    args.rOffset = args.gOffset = args.bOffset = 3;
+    checkConvertRow(args, &floats[0], 0);
+
+    args = ViewerTextureConvertArgs();
+    args.srcDepth = eImageBitDepthByte;
+    checkConvertRow(args, &bytes[0], &matte[0]);
+
+    args.srcNComps = 3;
+    checkConvertRow(args, &bytes[0], 0);
+
+    args.colorSpace = Color::LutManager::sRGBLut();
+    args.srcColorSpace = Color::LutManager::sRGBLut();
+    checkConvertRow(args, &bytes[0], &matte[0]);
+}
+
+TEST(ViewerTextureConvert, ChannelSelection) {
+    const float pixels[8] = { 0.f, 0.25f, 0.5f, 0.75f, 1.f, 1.f, 1.f, 1.f };
+    ViewerTextureConvertArgs args;
+
+    args.srcNComps = 4;
+    args.rOffset = args.gOffset = args.bOffset = 2;
+    args.opaque = true;
+    std::vector<U32> texels(2);
+    ViewerTextureRowConverter converter(args, 2);
+    converter.convertRowTo8bits(pixels, 0, 2, 0, &texels[0]);
+    // blue channel displayed in gray, opaque
+    EXPECT_EQ( (U32)0xff808080, texels[0] );
+    EXPECT_EQ( (U32)0xffffffff, texels[1] );
+
+    // a NULL row is black and transparent
+    converter.convertRowTo8bits(0, 0, 2, 0, &texels[0]);
+    EXPECT_EQ( (U32)0, texels[0] );
+
+    const unsigned short shorts[4] = { 0, 65535, 32768, 65535 };
+    float channel[2];
+    ViewerTextureRowConverter::getChannelRow(eImageBitDepthShort, 2, 1, shorts, 2, channel);
+    EXPECT_EQ( 1.f, channel[0] );
+    EXPECT_EQ( 1.f, channel[1] );
+}
+
+static void
+benchmarkConvertFrame(const char* name,
+                      const ViewerTextureConvertArgs& args,
+                      const void* src,
+                      std::size_t srcRowBytes)
+{
+    const int width = 3840;
+    const int height = 2160;
+    const int nIterations = 5;
+    std::vector<U32> texture(width);
+
+    for (int simd = 0; simd < 2; ++simd) {
+        if ( simd && !Color::isSIMDAvailable() ) {
+            break;
+        }
+        Color::setSIMDEnabled(simd);
+        ViewerTextureRowConverter converter(args, width);
+        TimeLapse timer;
+        for (int i = 0; i < nIterations; ++i) {
+            for (int y = 0; y < height; ++y) {
+                converter.convertRowTo8bits( (const unsigned char*)src + (y % 16) * srcRowBytes, 0, width, y % width, &texture[0] );
+            }
+        }
+        double elapsed = timer.getTimeSinceCreation();
+        std::cout << name << (simd ? " (SIMD): " : " (scalar): ")
+                  << elapsed * 1000. / nIterations << " ms per 4K frame" << std::endl;
+    }
+    Color::setSIMDEnabled(true);
+}
+
+// Not a correctness test: prints the time taken to convert a 4K frame to an 8-bit texture
+TEST(ViewerTextureConvert, DISABLED_Benchmark4K) {
+    const int width = 3840;
+    // 16 distinct rows are enough and keep the source in cache, so that the conversion itself is measured
+    std::vector<float> floats(width * 4 * 16);
+    srand(2000);
+    for (std::size_t i = 0; i < floats.size(); ++i) {
+        // coverity[dont_call]
+        floats[i] = rand() / (float)RAND_MAX;
+    }
+    std::vector<unsigned char> bytes(floats.size());
+    Color::convertDepthRow( &floats[0], &bytes[0], (int)floats.size() );
+    std::vector<float> gammaLut = makeGammaLut(1. / 2.2);
+
+    ViewerTextureConvertArgs args;
+    benchmarkConvertFrame("float RGBA to 8-bit", args, &floats[0], width * 4 * sizeof(float));
+
+    args.gamma = 1.f / 2.2f;
+    args.gammaLut = &gammaLut[0];
+    benchmarkConvertFrame("float RGBA to 8-bit with gamma", args, &floats[0], width * 4 * sizeof(float));
+
+    args = ViewerTextureConvertArgs();
+    args.srcDepth = eImageBitDepthByte;
+    benchmarkConvertFrame("byte RGBA to 8-bit", args, &bytes[0], width * 4);
+
+    args.colorSpace = Color::LutManager::sRGBLut();
+    benchmarkConvertFrame("byte RGBA to 8-bit sRGB (dithered)", args, &bytes[0], width * 4);
+}